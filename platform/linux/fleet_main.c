@@ -0,0 +1,242 @@
+/**
+ * @file fleet_main.c
+ * @brief pdqfleet: virtual Stratum V1 miner fleet for load testing
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Points thousands of simulated miners at a pool or at pdqminer --proxy
+ * and reports connections, share rate and latency percentiles. The shared
+ * Stratum client logs every line it sends or receives, so stdout is
+ * discarded unless --verbose is given; reports go to stderr.
+ */
+
+#include "pdq_types.h"
+#include "linux_event.h"
+#include "linux_fleet.h"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+static volatile int s_Running = 1;
+static uint32_t     s_DurationSec = 0;
+static uint32_t     s_ReportSec = 5;
+static uint32_t     s_Ticks = 0;
+static uint64_t     s_LastSubmits = 0;
+
+static void PrintUsage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options]\n\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --host HOST          Stratum V1 server (default: 127.0.0.1)\n");
+    fprintf(stderr, "  --port PORT          Server port (default: 3333)\n");
+    fprintf(stderr, "  --miners N           Simulated miners (default: 100, max %u)\n",
+            (unsigned)PDQ_FLEET_MAX_MINERS);
+    fprintf(stderr, "  --ramp N             New connections per second, 0 for all at once\n");
+    fprintf(stderr, "                       (default: 100)\n");
+    fprintf(stderr, "  --share-interval MS  Mean time between shares per miner (default: 10000)\n");
+    fprintf(stderr, "  --hashrate H         Per-miner H/s (k, M, G, T suffixes); shares then\n");
+    fprintf(stderr, "                       follow the difficulty the server sets\n");
+    fprintf(stderr, "  --reconnect MS       Reconnect dropped miners after MS, 0 to leave them\n");
+    fprintf(stderr, "                       down (default: 1000)\n");
+    fprintf(stderr, "  --user NAME          Miners authorize as NAME.<n> (default: fleet)\n");
+    fprintf(stderr, "  --password PW        Authorize password (default: x)\n");
+    fprintf(stderr, "  --duration SEC       Stop after SEC seconds, 0 to run until ^C (default: 0)\n");
+    fprintf(stderr, "  --report SEC         Seconds between reports (default: 5)\n");
+    fprintf(stderr, "  --seed N             Seed for share timing and nonces (default: time)\n");
+    fprintf(stderr, "  --verbose            Keep the Stratum client's per-line log on stdout\n");
+    fprintf(stderr, "  --help               Show this help\n");
+}
+
+static double ParseRate(const char* p_Text) {
+    char* end;
+    double value = strtod(p_Text, &end);
+    switch (*end) {
+        case 'k': case 'K': value *= 1e3; break;
+        case 'M': value *= 1e6; break;
+        case 'G': value *= 1e9; break;
+        case 'T': value *= 1e12; break;
+        default: break;
+    }
+    return value;
+}
+
+static void PrintLatency(const char* p_Label, const PdqFleetLatency_t* p_Lat) {
+    if (p_Lat->Count == 0) {
+        fprintf(stderr, "[FLEET]   %-9s n=0\n", p_Label);
+        return;
+    }
+    fprintf(stderr, "[FLEET]   %-9s n=%lu p50=%u p90=%u p99=%u p99.9=%u max=%u ms\n", p_Label,
+            (unsigned long)p_Lat->Count, (unsigned)p_Lat->P50Ms, (unsigned)p_Lat->P90Ms,
+            (unsigned)p_Lat->P99Ms, (unsigned)p_Lat->P999Ms, (unsigned)p_Lat->MaxMs);
+}
+
+static void Report(const char* p_Title, bool SinceLast, uint32_t Seconds) {
+    PdqFleetStats_t stats;
+    PdqFleetLatency_t submit, handshake;
+    PdqFleetGetStats(&stats);
+    PdqFleetGetLatency(&submit, &handshake, SinceLast);
+
+    uint64_t submits = SinceLast ? stats.Submits - s_LastSubmits : stats.Submits;
+    s_LastSubmits = stats.Submits;
+    fprintf(stderr, "[FLEET] %s: %u/%u ready (%u started), %.1f submits/s\n", p_Title,
+            (unsigned)stats.Ready, (unsigned)stats.Miners, (unsigned)stats.Started,
+            Seconds ? (double)submits / Seconds : 0.0);
+    fprintf(stderr, "[FLEET]   handshakes=%lu failures=%lu drops=%lu\n",
+            (unsigned long)stats.Handshakes, (unsigned long)stats.Failures, (unsigned long)stats.Drops);
+    fprintf(stderr, "[FLEET]   submits=%lu accepted=%lu rejected=%lu timed-out=%lu unsent=%lu\n",
+            (unsigned long)stats.Submits, (unsigned long)stats.Accepted, (unsigned long)stats.Rejected,
+            (unsigned long)stats.TimedOut, (unsigned long)stats.Unsent);
+    PrintLatency("submit", &submit);
+    PrintLatency("handshake", &handshake);
+}
+
+static void OnSecond(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    (void)Events;
+    (void)p_Arg;
+    s_Ticks++;
+    if (s_ReportSec && s_Ticks % s_ReportSec == 0) {
+        char title[32];
+        snprintf(title, sizeof(title), "%us", (unsigned)s_Ticks);
+        Report(title, true, s_ReportSec);
+    }
+    if (s_DurationSec && s_Ticks >= s_DurationSec) s_Running = 0;
+}
+
+static void OnSignal(int Sig, uint32_t Events, void* p_Arg) {
+    (void)Sig;
+    (void)Events;
+    (void)p_Arg;
+    s_Running = 0;
+}
+
+/* Every miner holds a socket, and a raced connect briefly holds more */
+static void RaiseFileLimit(uint32_t Miners) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return;
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    if (rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < (rlim_t)Miners + 64) {
+        fprintf(stderr, "[FLEET] Warning: open file limit %lu is low for %u miners\n",
+                (unsigned long)rl.rlim_cur, (unsigned)Miners);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    PdqFleetConfig_t config;
+    memset(&config, 0, sizeof(config));
+    config.p_Host = "127.0.0.1";
+    config.Port = 3333;
+    config.Miners = 100;
+    config.RampPerSec = 100;
+    config.ShareIntervalMs = 10000;
+    config.ReconnectMs = 1000;
+    config.p_User = "fleet";
+    config.Seed = (uint32_t)time(NULL) ^ (uint32_t)getpid();
+    bool verbose = false;
+
+    static struct option longOpts[] = {
+        {"host",           required_argument, 0, 'H'},
+        {"port",           required_argument, 0, 'P'},
+        {"miners",         required_argument, 0, 'n'},
+        {"ramp",           required_argument, 0, 'r'},
+        {"share-interval", required_argument, 0, 's'},
+        {"hashrate",       required_argument, 0, 'R'},
+        {"reconnect",      required_argument, 0, 'c'},
+        {"user",           required_argument, 0, 'u'},
+        {"password",       required_argument, 0, 'p'},
+        {"duration",       required_argument, 0, 'd'},
+        {"report",         required_argument, 0, 'i'},
+        {"seed",           required_argument, 0, 'S'},
+        {"verbose",        no_argument,       0, 'v'},
+        {"help",           no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "H:P:n:r:s:R:c:u:p:d:i:S:vh", longOpts, NULL)) != -1) {
+        switch (opt) {
+            case 'H': config.p_Host = optarg; break;
+            case 'P': config.Port = (uint16_t)atoi(optarg); break;
+            case 'n': config.Miners = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'r': config.RampPerSec = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 's': config.ShareIntervalMs = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'R': config.HashRate = ParseRate(optarg); break;
+            case 'c': config.ReconnectMs = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'u': config.p_User = optarg; break;
+            case 'p': config.p_Password = optarg; break;
+            case 'd': s_DurationSec = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'i': s_ReportSec = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'S': config.Seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'v': verbose = true; break;
+            case 'h':
+                PrintUsage(argv[0]);
+                return 0;
+            default:
+                PrintUsage(argv[0]);
+                return 1;
+        }
+    }
+    if (config.Miners == 0 || config.Miners > PDQ_FLEET_MAX_MINERS || config.Port == 0 ||
+        (config.ShareIntervalMs == 0 && config.HashRate <= 0.0)) {
+        fprintf(stderr, "Error: need 1..%u miners, a port, and a share interval or hashrate\n\n",
+                (unsigned)PDQ_FLEET_MAX_MINERS);
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (!verbose) {
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDOUT_FILENO);
+            close(devNull);
+        }
+    }
+    RaiseFileLimit(config.Miners);
+    /* A server closing thousands of sockets at once must not kill us */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (PdqEventLoopInit() != PdqOk) {
+        fprintf(stderr, "[FLEET] Event loop init failed\n");
+        return 1;
+    }
+    PdqEventAddSignal(SIGINT, OnSignal, NULL);
+    PdqEventAddSignal(SIGTERM, OnSignal, NULL);
+
+    fprintf(stderr, "[FLEET] %u miners -> %s:%u, ramp %u/s, ", (unsigned)config.Miners,
+            config.p_Host, (unsigned)config.Port, (unsigned)config.RampPerSec);
+    if (config.HashRate > 0.0) {
+        fprintf(stderr, "%.3g H/s each at the server's difficulty\n", config.HashRate);
+    } else {
+        fprintf(stderr, "a share every %u ms each\n", (unsigned)config.ShareIntervalMs);
+    }
+
+    if (PdqFleetStart(&config) != PdqOk) {
+        fprintf(stderr, "[FLEET] Start failed\n");
+        PdqEventLoopDestroy();
+        return 1;
+    }
+    PdqEventAddTimer(1000, OnSecond, NULL);
+
+    int exitCode = 0;
+    while (s_Running) {
+        if (PdqEventRunOnce(-1) < 0) {
+            fprintf(stderr, "[FLEET] Event loop failed\n");
+            exitCode = 1;
+            break;
+        }
+    }
+
+    Report("Total", false, s_Ticks);
+    PdqFleetStop();
+    PdqEventLoopDestroy();
+    return exitCode;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file linux_capture.c
+ * @brief Stratum session capture implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "linux_capture.h"
+#include <stdlib.h>
+#include <string.h>
+
+PdqError_t PdqCaptureOpen(PdqCaptureWriter_t* p_Cap, const char* p_Path) {
+    if (!p_Cap || !p_Path) return PdqErrorInvalidParam;
+    memset(p_Cap, 0, sizeof(*p_Cap));
+    /* "e": an upgrade's exec must not leave the new image this FILE's fd */
+    p_Cap->p_File = fopen(p_Path, "we");
+    if (!p_Cap->p_File) return PdqErrorInvalidParam;
+    /* Line buffered, so a miner that is killed leaves a usable capture */
+    setvbuf(p_Cap->p_File, NULL, _IOLBF, 0);
+    fprintf(p_Cap->p_File, "%s\n", PDQ_CAPTURE_MAGIC);
+    return PdqOk;
+}
+
+PdqError_t PdqCaptureResume(PdqCaptureWriter_t* p_Cap, const char* p_Path) {
+    if (!p_Cap || !p_Path) return PdqErrorInvalidParam;
+    FILE* f = fopen(p_Path, "re");
+    if (!f) return PdqCaptureOpen(p_Cap, p_Path);
+
+    memset(p_Cap, 0, sizeof(*p_Cap));
+    char* line = NULL;
+    size_t lineCap = 0;
+    ssize_t n;
+    bool first = true;
+    bool ours = true;
+    while (ours && (n = getline(&line, &lineCap, f)) >= 0) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+        if (first) {
+            first = false;
+            ours = strcmp(line, PDQ_CAPTURE_MAGIC) == 0;
+            continue;
+        }
+        int stream;
+        int label = 0;
+        if (sscanf(line, "# stream %d %n", &stream, &label) != 1 || label == 0 ||
+            stream <= 0 || stream > PDQ_CAPTURE_MAX_STREAMS) {
+            continue;
+        }
+        snprintf(p_Cap->ResumedLabels[stream - 1], PDQ_CAPTURE_MAX_LABEL, "%s", line + label);
+        if (stream > p_Cap->ResumedCount) p_Cap->ResumedCount = stream;
+    }
+    free(line);
+    fclose(f);
+    if (first) return PdqCaptureOpen(p_Cap, p_Path);
+    if (!ours) return PdqErrorInvalidParam;
+
+    p_Cap->StreamCount = p_Cap->ResumedCount;
+    p_Cap->p_File = fopen(p_Path, "ae");
+    if (!p_Cap->p_File) return PdqErrorInvalidParam;
+    setvbuf(p_Cap->p_File, NULL, _IOLBF, 0);
+    fprintf(p_Cap->p_File, "# resumed\n");
+    return PdqOk;
+}
+
+int PdqCaptureAddStream(PdqCaptureWriter_t* p_Cap, const char* p_Label) {
+    if (!p_Cap || !p_Cap->p_File) return 0;
+    /* A handed-over session carries on in the stream it was recorded in */
+    for (int i = 0; i < p_Cap->ResumedCount; i++) {
+        if (!(p_Cap->Reclaimed & (1u << i)) && p_Cap->ResumedLabels[i][0] &&
+            strcmp(p_Cap->ResumedLabels[i], p_Label ? p_Label : "") == 0) {
+            p_Cap->Reclaimed |= 1u << i;
+            return i + 1;
+        }
+    }
+    if (p_Cap->StreamCount >= PDQ_CAPTURE_MAX_STREAMS) return 0;
+    int stream = ++p_Cap->StreamCount;
+    fprintf(p_Cap->p_File, "# stream %d %s\n", stream, p_Label ? p_Label : "");
+    return stream;
+}
+
+void PdqCaptureWrite(PdqCaptureWriter_t* p_Cap, int Stream, bool Outbound,
+                     const char* p_Line, size_t Len, uint64_t NowMs) {
+    if (!p_Cap || !p_Cap->p_File || Stream <= 0 || !p_Line) return;
+    uint64_t delay = (p_Cap->LastMs && NowMs > p_Cap->LastMs) ? NowMs - p_Cap->LastMs : 0;
+    p_Cap->LastMs = NowMs ? NowMs : 1;
+    fprintf(p_Cap->p_File, "+%lu %d%c %.*s\n", (unsigned long)delay, Stream,
+            Outbound ? '>' : '<', (int)Len, p_Line);
+    p_Cap->Lines++;
+}
+
+void PdqCaptureClose(PdqCaptureWriter_t* p_Cap) {
+    if (!p_Cap || !p_Cap->p_File) return;
+    fclose(p_Cap->p_File);
+    p_Cap->p_File = NULL;
+}
+
+/* "+<ms> <stream><dir> <json>" */
+static bool ParseEntry(char* line, PdqCaptureEntry_t* p_Entry) {
+    char* p = line + 1;
+    char* end;
+    unsigned long delay = strtoul(p, &end, 10);
+    if (end == p || *end != ' ') return false;
+    p = end + 1;
+    unsigned long stream = strtoul(p, &end, 10);
+    if (end == p || stream == 0 || stream > PDQ_CAPTURE_MAX_STREAMS) return false;
+    if ((*end != '<' && *end != '>') || end[1] != ' ' || end[2] == '\0') return false;
+
+    p_Entry->DelayMs = delay > UINT32_MAX ? UINT32_MAX : (uint32_t)delay;
+    p_Entry->Stream = (uint8_t)stream;
+    p_Entry->Outbound = *end == '>';
+    p_Entry->p_Line = strdup(end + 2);
+    return p_Entry->p_Line != NULL;
+}
+
+PdqError_t PdqCaptureLoad(PdqCaptureLog_t* p_Log, const char* p_Path) {
+    if (!p_Log || !p_Path) return PdqErrorInvalidParam;
+    memset(p_Log, 0, sizeof(*p_Log));
+    FILE* f = fopen(p_Path, "r");
+    if (!f) return PdqErrorInvalidParam;
+
+    char* line = NULL;
+    size_t lineCap = 0;
+    size_t cap = 0;
+    ssize_t n;
+    bool first = true;
+    PdqError_t err = PdqOk;
+    while ((n = getline(&line, &lineCap, f)) >= 0) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = '\0';
+        if (first) {
+            first = false;
+            if (strcmp(line, PDQ_CAPTURE_MAGIC) != 0) {
+                err = PdqErrorInvalidParam;
+                break;
+            }
+            continue;
+        }
+        if (n == 0) continue;
+        if (line[0] == '#') {
+            int stream;
+            if (sscanf(line, "# stream %d", &stream) == 1 &&
+                stream > p_Log->StreamCount && stream <= PDQ_CAPTURE_MAX_STREAMS) {
+                p_Log->StreamCount = stream;
+            }
+            continue;
+        }
+        if (line[0] != '+' || (size_t)n > PDQ_CAPTURE_MAX_LINE) {
+            p_Log->Skipped++;
+            continue;
+        }
+
+        if (p_Log->Count == cap) {
+            size_t newCap = cap ? cap * 2 : 256;
+            PdqCaptureEntry_t* grown = (PdqCaptureEntry_t*)realloc(p_Log->p_Entries,
+                                                                   newCap * sizeof(*grown));
+            if (!grown) {
+                err = PdqErrorNoMemory;
+                break;
+            }
+            p_Log->p_Entries = grown;
+            cap = newCap;
+        }
+        if (ParseEntry(line, &p_Log->p_Entries[p_Log->Count])) {
+            if (p_Log->p_Entries[p_Log->Count].Stream > p_Log->StreamCount) {
+                p_Log->StreamCount = p_Log->p_Entries[p_Log->Count].Stream;
+            }
+            p_Log->Count++;
+        } else {
+            p_Log->Skipped++;
+        }
+    }
+    if (first) err = PdqErrorInvalidParam;
+    free(line);
+    fclose(f);
+    if (err != PdqOk) PdqCaptureFree(p_Log);
+    return err;
+}
+
+void PdqCaptureFree(PdqCaptureLog_t* p_Log) {
+    if (!p_Log) return;
+    for (size_t i = 0; i < p_Log->Count; i++) free(p_Log->p_Entries[i].p_Line);
+    free(p_Log->p_Entries);
+    memset(p_Log, 0, sizeof(*p_Log));
+}
@@ -0,0 +1,94 @@
+/**
+ * @file linux_capture.h
+ * @brief Stratum session capture files: recording and loading
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * A capture is a text file with one line per Stratum message:
+ *
+ *     # pdqcap 1
+ *     # stream 1 pool.example.com:3333
+ *     +0 1> {"id":1,"method":"mining.subscribe","params":["PDQminer/1.0"]}
+ *     +41 1< {"id":1,"result":[...],"error":null}
+ *
+ * "+<ms>" is the time since the previous message in the file, then the
+ * stream number and '>' for a line sent to the pool or '<' for one it
+ * sent. A stream is one pool connection slot; several interleave when
+ * the miner keeps more than one pool open. Lines starting with '#' are
+ * comments, apart from the stream labels. The messages are kept as the
+ * pool sent them, so a capture can be grepped and fed to jq.
+ *
+ * pdqminer --record writes captures; the mock pool replays them. After
+ * a binary upgrade the new process appends to the same capture, and a
+ * session it was handed keeps writing under its old stream number.
+ */
+
+#ifndef PDQ_LINUX_CAPTURE_H
+#define PDQ_LINUX_CAPTURE_H
+
+#include "pdq_types.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_CAPTURE_MAGIC       "# pdqcap 1"
+#define PDQ_CAPTURE_MAX_STREAMS 16
+#define PDQ_CAPTURE_MAX_LINE    (256u * 1024u)  /* Longer messages are skipped on load */
+#define PDQ_CAPTURE_MAX_LABEL   80
+
+typedef struct {
+    FILE*    p_File;
+    uint64_t LastMs;                /* Time of the previous message, 0 before the first */
+    int      StreamCount;
+    uint32_t Lines;
+    /* Streams declared before a resume, free for AddStream to claim back */
+    int      ResumedCount;
+    uint32_t Reclaimed;             /* Bit per resumed stream */
+    char     ResumedLabels[PDQ_CAPTURE_MAX_STREAMS][PDQ_CAPTURE_MAX_LABEL];
+} PdqCaptureWriter_t;
+
+typedef struct {
+    uint32_t DelayMs;               /* Since the previous entry, in any stream */
+    uint8_t  Stream;
+    bool     Outbound;              /* Sent to the pool */
+    char*    p_Line;
+} PdqCaptureEntry_t;
+
+typedef struct {
+    PdqCaptureEntry_t* p_Entries;
+    size_t             Count;
+    int                StreamCount;
+    uint32_t           Skipped;     /* Malformed or over-long lines */
+} PdqCaptureLog_t;
+
+/* Creates or truncates p_Path and writes the header. The file is closed
+ * on exec. */
+PdqError_t PdqCaptureOpen(PdqCaptureWriter_t* p_Cap, const char* p_Path);
+
+/* Appends to the capture at p_Path, as the process after an upgrade
+ * does; a missing or empty file is started afresh. Fails with
+ * PdqErrorInvalidParam when the file is not a capture. */
+PdqError_t PdqCaptureResume(PdqCaptureWriter_t* p_Cap, const char* p_Path);
+
+/* Declares the next stream with a free-form label (usually host:port)
+ * and returns its number, starting at 1, or 0 when none are left. After
+ * a resume, a label the file already declared gets its number back. */
+int        PdqCaptureAddStream(PdqCaptureWriter_t* p_Cap, const char* p_Label);
+
+/* One message, without its newline. NowMs is any monotonic clock. */
+void       PdqCaptureWrite(PdqCaptureWriter_t* p_Cap, int Stream, bool Outbound,
+                           const char* p_Line, size_t Len, uint64_t NowMs);
+void       PdqCaptureClose(PdqCaptureWriter_t* p_Cap);
+
+/* Reads a whole capture into memory. Fails with PdqErrorInvalidParam
+ * when the file is not a capture. */
+PdqError_t PdqCaptureLoad(PdqCaptureLog_t* p_Log, const char* p_Path);
+void       PdqCaptureFree(PdqCaptureLog_t* p_Log);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,7 +20,7 @@
 
 #define PDQ_LINUX_CONFIG_MAX_KEYS   32
 #define PDQ_LINUX_CONFIG_KEY_LEN    32
-#define PDQ_LINUX_CONFIG_VAL_LEN    256
+#define PDQ_LINUX_CONFIG_VAL_LEN    1024    /* Room for a "pools" list */
 #define PDQ_LINUX_CONFIG_MAGIC_KEY  "__pdq_valid__"
 
 typedef struct {
@@ -61,6 +61,8 @@ static void EnsureDir(void) {
 /* Minimal JSON parser — handles flat {"key":"value",...} objects.
  * We deliberately avoid external dependencies. */
 static void LoadFile(void) {
+    /* Called again on a reload: a key gone from the file is gone */
+    s_Count = 0;
     FILE* f = fopen(s_ConfigPath, "r");
     if (!f) return;
 
@@ -75,7 +77,6 @@ static void LoadFile(void) {
     fclose(f);
     buf[nr] = '\0';
 
-    s_Count = 0;
     const char* p = buf;
 
     /* Skip to first '{' */
@@ -0,0 +1,477 @@
+/**
+ * @file linux_event.c
+ * @brief Event loop implementation (epoll on Linux, poll() elsewhere)
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Watches are kept in a table indexed by fd. Each registration carries a
+ * generation number so an event that was already harvested for an fd
+ * that a callback closed (and the kernel reused) is not delivered to the
+ * new owner.
+ */
+
+#include "linux_event.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#define PDQ_EVENT_USE_EPOLL 1
+#else
+#include <poll.h>
+#define PDQ_EVENT_USE_EPOLL 0
+#endif
+
+#define PDQ_EVENT_MAX_BATCH   64
+#define PDQ_EVENT_MAX_TIMERS  16
+#define PDQ_EVENT_MAX_SIGNALS 32
+
+typedef enum {
+    WatchKindFd = 0,
+    WatchKindTimer,
+    WatchKindSignal
+} WatchKind_t;
+
+typedef struct {
+    PdqEventCallback_t Callback;
+    void*              p_Arg;
+    uint32_t           Events;
+    uint32_t           Generation;
+    uint8_t            Kind;
+    bool               Active;
+} Watch_t;
+
+typedef struct {
+    PdqEventCallback_t Callback;
+    void*              p_Arg;
+} SignalSlot_t;
+
+static Watch_t*     s_Watches = NULL;
+static int          s_WatchCap = 0;
+static SignalSlot_t s_Signals[PDQ_EVENT_MAX_SIGNALS];
+static int          s_SignalFd = -1;
+static bool         s_Initialized = false;
+
+#if PDQ_EVENT_USE_EPOLL
+static int          s_EpollFd = -1;
+static sigset_t     s_SignalMask;
+#else
+typedef struct {
+    PdqEventCallback_t Callback;
+    void*              p_Arg;
+    uint32_t           PeriodMs;
+    uint64_t           NextMs;
+    bool               Active;
+} SoftTimer_t;
+
+static SoftTimer_t  s_Timers[PDQ_EVENT_MAX_TIMERS];
+static int          s_SignalPipe[2] = {-1, -1};
+#endif
+
+#if !PDQ_EVENT_USE_EPOLL
+static uint64_t GetMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void SetNonBlocking(int Fd) {
+    int flags = fcntl(Fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(Fd, F_SETFL, flags | O_NONBLOCK);
+    fcntl(Fd, F_SETFD, FD_CLOEXEC);
+}
+#endif
+
+static bool GrowTable(int Fd) {
+    if (Fd < s_WatchCap) return true;
+    int newCap = s_WatchCap ? s_WatchCap : 64;
+    while (newCap <= Fd) newCap *= 2;
+    Watch_t* p = (Watch_t*)realloc(s_Watches, (size_t)newCap * sizeof(Watch_t));
+    if (!p) return false;
+    memset(p + s_WatchCap, 0, (size_t)(newCap - s_WatchCap) * sizeof(Watch_t));
+    s_Watches = p;
+    s_WatchCap = newCap;
+    return true;
+}
+
+static PdqError_t AddWatch(int Fd, uint32_t Events, uint8_t Kind,
+                           PdqEventCallback_t Callback, void* p_Arg) {
+    if (Fd < 0 || !Callback) return PdqErrorInvalidParam;
+    if (!GrowTable(Fd)) return PdqErrorNoMemory;
+
+    Watch_t* w = &s_Watches[Fd];
+    if (w->Active) return PdqErrorInvalidParam;
+
+    w->Callback = Callback;
+    w->p_Arg = p_Arg;
+    w->Events = Events;
+    w->Kind = Kind;
+    w->Generation++;
+    w->Active = true;
+
+#if PDQ_EVENT_USE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    if (Events & PDQ_EVENT_READ) ev.events |= EPOLLIN;
+    if (Events & PDQ_EVENT_WRITE) ev.events |= EPOLLOUT;
+    ev.data.u64 = (uint64_t)(uint32_t)Fd | ((uint64_t)w->Generation << 32);
+    if (epoll_ctl(s_EpollFd, EPOLL_CTL_ADD, Fd, &ev) < 0) {
+        w->Active = false;
+        return PdqErrorInvalidParam;
+    }
+#endif
+    return PdqOk;
+}
+
+static void Dispatch(int Fd, uint32_t Generation, uint32_t Ready) {
+    if (Fd < 0 || Fd >= s_WatchCap) return;
+    Watch_t* w = &s_Watches[Fd];
+    if (!w->Active || w->Generation != Generation) return;
+
+    if (w->Kind == WatchKindTimer) {
+#if PDQ_EVENT_USE_EPOLL
+        uint64_t expirations;
+        if (read(Fd, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) return;
+#endif
+        w->Callback(Fd, PDQ_EVENT_READ, w->p_Arg);
+        return;
+    }
+
+    if (w->Kind == WatchKindSignal) {
+#if PDQ_EVENT_USE_EPOLL
+        struct signalfd_siginfo si;
+        while (read(Fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+            int sig = (int)si.ssi_signo;
+            if (sig > 0 && sig < PDQ_EVENT_MAX_SIGNALS && s_Signals[sig].Callback) {
+                s_Signals[sig].Callback(sig, PDQ_EVENT_READ, s_Signals[sig].p_Arg);
+            }
+        }
+#else
+        uint8_t sigs[16];
+        ssize_t n;
+        while ((n = read(Fd, sigs, sizeof(sigs))) > 0) {
+            for (ssize_t i = 0; i < n; i++) {
+                int sig = sigs[i];
+                if (sig > 0 && sig < PDQ_EVENT_MAX_SIGNALS && s_Signals[sig].Callback) {
+                    s_Signals[sig].Callback(sig, PDQ_EVENT_READ, s_Signals[sig].p_Arg);
+                }
+            }
+        }
+#endif
+        return;
+    }
+
+    w->Callback(Fd, Ready, w->p_Arg);
+}
+
+#if !PDQ_EVENT_USE_EPOLL
+static void SignalPipeHandler(int Sig) {
+    int saved = errno;
+    uint8_t b = (uint8_t)Sig;
+    if (s_SignalPipe[1] >= 0) {
+        ssize_t n = write(s_SignalPipe[1], &b, 1);
+        (void)n;
+    }
+    errno = saved;
+}
+#endif
+
+/* ---- Public API ---- */
+
+PdqError_t PdqEventLoopInit(void) {
+    if (s_Initialized) return PdqOk;
+    memset(s_Signals, 0, sizeof(s_Signals));
+
+#if PDQ_EVENT_USE_EPOLL
+    s_EpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (s_EpollFd < 0) {
+        fprintf(stderr, "[Event] epoll_create1 failed: %s\n", strerror(errno));
+        return PdqErrorNoMemory;
+    }
+    sigemptyset(&s_SignalMask);
+#else
+    memset(s_Timers, 0, sizeof(s_Timers));
+#endif
+
+    s_Initialized = true;
+    return PdqOk;
+}
+
+void PdqEventLoopDestroy(void) {
+    if (!s_Initialized) return;
+#if PDQ_EVENT_USE_EPOLL
+    for (int fd = 0; fd < s_WatchCap; fd++) {
+        if (s_Watches[fd].Active && s_Watches[fd].Kind == WatchKindTimer) close(fd);
+    }
+    if (s_SignalFd >= 0) close(s_SignalFd);
+    close(s_EpollFd);
+    s_EpollFd = -1;
+#else
+    if (s_SignalPipe[0] >= 0) {
+        close(s_SignalPipe[0]);
+        close(s_SignalPipe[1]);
+        s_SignalPipe[0] = s_SignalPipe[1] = -1;
+    }
+#endif
+    s_SignalFd = -1;
+    free(s_Watches);
+    s_Watches = NULL;
+    s_WatchCap = 0;
+    s_Initialized = false;
+}
+
+PdqError_t PdqEventAdd(int Fd, uint32_t Events, PdqEventCallback_t Callback, void* p_Arg) {
+    return AddWatch(Fd, Events, WatchKindFd, Callback, p_Arg);
+}
+
+PdqError_t PdqEventModify(int Fd, uint32_t Events) {
+    if (Fd < 0 || Fd >= s_WatchCap || !s_Watches[Fd].Active) return PdqErrorInvalidParam;
+    if (s_Watches[Fd].Events == Events) return PdqOk;
+    s_Watches[Fd].Events = Events;
+
+#if PDQ_EVENT_USE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    if (Events & PDQ_EVENT_READ) ev.events |= EPOLLIN;
+    if (Events & PDQ_EVENT_WRITE) ev.events |= EPOLLOUT;
+    ev.data.u64 = (uint64_t)(uint32_t)Fd | ((uint64_t)s_Watches[Fd].Generation << 32);
+    if (epoll_ctl(s_EpollFd, EPOLL_CTL_MOD, Fd, &ev) < 0) return PdqErrorInvalidParam;
+#endif
+    return PdqOk;
+}
+
+PdqError_t PdqEventRemove(int Fd) {
+    if (Fd < 0 || Fd >= s_WatchCap || !s_Watches[Fd].Active) return PdqErrorInvalidParam;
+    s_Watches[Fd].Active = false;
+#if PDQ_EVENT_USE_EPOLL
+    /* EBADF is expected when the owner already closed the fd */
+    epoll_ctl(s_EpollFd, EPOLL_CTL_DEL, Fd, NULL);
+#endif
+    return PdqOk;
+}
+
+bool PdqEventIsWatched(int Fd) {
+    return Fd >= 0 && Fd < s_WatchCap && s_Watches[Fd].Active;
+}
+
+int PdqEventAddTimer(uint32_t PeriodMs, PdqEventCallback_t Callback, void* p_Arg) {
+    if (PeriodMs == 0 || !Callback) return -1;
+
+#if PDQ_EVENT_USE_EPOLL
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct itimerspec its;
+    its.it_interval.tv_sec = PeriodMs / 1000;
+    its.it_interval.tv_nsec = (long)(PeriodMs % 1000) * 1000000L;
+    its.it_value = its.it_interval;
+    if (timerfd_settime(fd, 0, &its, NULL) < 0 ||
+        AddWatch(fd, PDQ_EVENT_READ, WatchKindTimer, Callback, p_Arg) != PdqOk) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    for (int i = 0; i < PDQ_EVENT_MAX_TIMERS; i++) {
+        if (!s_Timers[i].Active) {
+            s_Timers[i].Callback = Callback;
+            s_Timers[i].p_Arg = p_Arg;
+            s_Timers[i].PeriodMs = PeriodMs;
+            s_Timers[i].NextMs = GetMillis() + PeriodMs;
+            s_Timers[i].Active = true;
+            return i;
+        }
+    }
+    return -1;
+#endif
+}
+
+PdqError_t PdqEventRemoveTimer(int TimerId) {
+#if PDQ_EVENT_USE_EPOLL
+    if (PdqEventRemove(TimerId) != PdqOk) return PdqErrorInvalidParam;
+    close(TimerId);
+#else
+    if (TimerId < 0 || TimerId >= PDQ_EVENT_MAX_TIMERS) return PdqErrorInvalidParam;
+    s_Timers[TimerId].Active = false;
+#endif
+    return PdqOk;
+}
+
+PdqError_t PdqEventAddSignal(int Sig, PdqEventCallback_t Callback, void* p_Arg) {
+    if (Sig <= 0 || Sig >= PDQ_EVENT_MAX_SIGNALS || !Callback) return PdqErrorInvalidParam;
+    s_Signals[Sig].Callback = Callback;
+    s_Signals[Sig].p_Arg = p_Arg;
+
+#if PDQ_EVENT_USE_EPOLL
+    sigaddset(&s_SignalMask, Sig);
+    if (sigprocmask(SIG_BLOCK, &s_SignalMask, NULL) < 0) return PdqErrorInvalidParam;
+
+    if (s_SignalFd < 0) {
+        s_SignalFd = signalfd(-1, &s_SignalMask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (s_SignalFd < 0) return PdqErrorNoMemory;
+        return AddWatch(s_SignalFd, PDQ_EVENT_READ, WatchKindSignal, Callback, NULL);
+    }
+    /* Passing the existing fd updates its mask in place */
+    if (signalfd(s_SignalFd, &s_SignalMask, 0) < 0) return PdqErrorInvalidParam;
+#else
+    if (s_SignalPipe[0] < 0) {
+        if (pipe(s_SignalPipe) < 0) return PdqErrorNoMemory;
+        SetNonBlocking(s_SignalPipe[0]);
+        SetNonBlocking(s_SignalPipe[1]);
+        s_SignalFd = s_SignalPipe[0];
+        PdqError_t err = AddWatch(s_SignalFd, PDQ_EVENT_READ, WatchKindSignal, Callback, NULL);
+        if (err != PdqOk) return err;
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SignalPipeHandler;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(Sig, &sa, NULL) < 0) return PdqErrorInvalidParam;
+#endif
+    return PdqOk;
+}
+
+int PdqEventRunOnce(int TimeoutMs) {
+    int dispatched = 0;
+
+#if PDQ_EVENT_USE_EPOLL
+    struct epoll_event events[PDQ_EVENT_MAX_BATCH];
+    int n = epoll_wait(s_EpollFd, events, PDQ_EVENT_MAX_BATCH, TimeoutMs);
+    if (n < 0) return (errno == EINTR) ? 0 : -1;
+
+    for (int i = 0; i < n; i++) {
+        int fd = (int)(uint32_t)events[i].data.u64;
+        uint32_t gen = (uint32_t)(events[i].data.u64 >> 32);
+        uint32_t ready = 0;
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) ready |= PDQ_EVENT_READ;
+        if (events[i].events & EPOLLOUT) ready |= PDQ_EVENT_WRITE;
+        if (events[i].events & EPOLLERR) ready |= PDQ_EVENT_ERROR;
+        Dispatch(fd, gen, ready);
+        dispatched++;
+    }
+#else
+    /* Clamp the wait to the nearest software timer deadline */
+    uint64_t now = GetMillis();
+    for (int i = 0; i < PDQ_EVENT_MAX_TIMERS; i++) {
+        if (!s_Timers[i].Active) continue;
+        int until = (s_Timers[i].NextMs > now) ? (int)(s_Timers[i].NextMs - now) : 0;
+        if (TimeoutMs < 0 || until < TimeoutMs) TimeoutMs = until;
+    }
+
+    int count = 0;
+    for (int fd = 0; fd < s_WatchCap; fd++) {
+        if (s_Watches[fd].Active) count++;
+    }
+
+    struct pollfd* pfds = NULL;
+    uint32_t* gens = NULL;
+    if (count > 0) {
+        pfds = (struct pollfd*)calloc((size_t)count, sizeof(struct pollfd));
+        gens = (uint32_t*)calloc((size_t)count, sizeof(uint32_t));
+        if (!pfds || !gens) {
+            free(pfds);
+            free(gens);
+            return -1;
+        }
+        int j = 0;
+        for (int fd = 0; fd < s_WatchCap; fd++) {
+            if (!s_Watches[fd].Active) continue;
+            pfds[j].fd = fd;
+            if (s_Watches[fd].Events & PDQ_EVENT_READ) pfds[j].events |= POLLIN;
+            if (s_Watches[fd].Events & PDQ_EVENT_WRITE) pfds[j].events |= POLLOUT;
+            gens[j] = s_Watches[fd].Generation;
+            j++;
+        }
+    }
+
+    int n = poll(pfds, (nfds_t)count, TimeoutMs);
+    if (n < 0 && errno != EINTR) {
+        free(pfds);
+        free(gens);
+        return -1;
+    }
+
+    for (int j = 0; n > 0 && j < count; j++) {
+        if (!pfds[j].revents) continue;
+        uint32_t ready = 0;
+        if (pfds[j].revents & (POLLIN | POLLHUP)) ready |= PDQ_EVENT_READ;
+        if (pfds[j].revents & POLLOUT) ready |= PDQ_EVENT_WRITE;
+        if (pfds[j].revents & (POLLERR | POLLNVAL)) ready |= PDQ_EVENT_ERROR;
+        Dispatch(pfds[j].fd, gens[j], ready);
+        dispatched++;
+    }
+    free(pfds);
+    free(gens);
+
+    now = GetMillis();
+    for (int i = 0; i < PDQ_EVENT_MAX_TIMERS; i++) {
+        if (!s_Timers[i].Active || s_Timers[i].NextMs > now) continue;
+        while (s_Timers[i].NextMs <= now) s_Timers[i].NextMs += s_Timers[i].PeriodMs;
+        s_Timers[i].Callback(i, PDQ_EVENT_READ, s_Timers[i].p_Arg);
+        dispatched++;
+    }
+#endif
+
+    return dispatched;
+}
+
+PdqError_t PdqEventNotifierInit(PdqEventNotifier_t* p_Notifier) {
+    if (!p_Notifier) return PdqErrorInvalidParam;
+#if PDQ_EVENT_USE_EPOLL
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) return PdqErrorNoMemory;
+    p_Notifier->ReadFd = fd;
+    p_Notifier->WriteFd = fd;
+#else
+    int fds[2];
+    if (pipe(fds) < 0) return PdqErrorNoMemory;
+    SetNonBlocking(fds[0]);
+    SetNonBlocking(fds[1]);
+    p_Notifier->ReadFd = fds[0];
+    p_Notifier->WriteFd = fds[1];
+#endif
+    return PdqOk;
+}
+
+void PdqEventNotifierSignal(PdqEventNotifier_t* p_Notifier) {
+    if (!p_Notifier || p_Notifier->WriteFd < 0) return;
+#if PDQ_EVENT_USE_EPOLL
+    uint64_t one = 1;
+    ssize_t n = write(p_Notifier->WriteFd, &one, sizeof(one));
+#else
+    uint8_t one = 1;
+    ssize_t n = write(p_Notifier->WriteFd, &one, 1);  /* EAGAIN: already pending */
+#endif
+    (void)n;
+}
+
+void PdqEventNotifierDrain(PdqEventNotifier_t* p_Notifier) {
+    if (!p_Notifier || p_Notifier->ReadFd < 0) return;
+#if PDQ_EVENT_USE_EPOLL
+    uint64_t count;
+    ssize_t n = read(p_Notifier->ReadFd, &count, sizeof(count));
+    (void)n;
+#else
+    uint8_t buf[64];
+    while (read(p_Notifier->ReadFd, buf, sizeof(buf)) > 0) {}
+#endif
+}
+
+void PdqEventNotifierClose(PdqEventNotifier_t* p_Notifier) {
+    if (!p_Notifier) return;
+    if (p_Notifier->ReadFd >= 0) close(p_Notifier->ReadFd);
+    if (p_Notifier->WriteFd >= 0 && p_Notifier->WriteFd != p_Notifier->ReadFd) {
+        close(p_Notifier->WriteFd);
+    }
+    p_Notifier->ReadFd = -1;
+    p_Notifier->WriteFd = -1;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file linux_event.h
+ * @brief Single-threaded event loop for the Linux control plane
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Thin reactor over epoll/eventfd/timerfd/signalfd. On hosts without
+ * epoll (macOS) the same API is served by poll(), a self-pipe and
+ * software timers so the native build keeps working.
+ *
+ * All functions except PdqEventNotifierSignal() must be called from the
+ * thread that runs the loop.
+ */
+
+#ifndef PDQ_LINUX_EVENT_H
+#define PDQ_LINUX_EVENT_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_EVENT_READ   0x01
+#define PDQ_EVENT_WRITE  0x02
+#define PDQ_EVENT_ERROR  0x04  /* Reported only, never requested */
+
+typedef void (*PdqEventCallback_t)(int Fd, uint32_t Events, void* p_Arg);
+
+/* Cross-thread wakeup. Signal() is safe from any thread and from signal
+ * handlers; the loop side watches ReadFd and calls Drain(). */
+typedef struct {
+    int ReadFd;
+    int WriteFd;
+} PdqEventNotifier_t;
+
+PdqError_t PdqEventLoopInit(void);
+void       PdqEventLoopDestroy(void);
+
+PdqError_t PdqEventAdd(int Fd, uint32_t Events, PdqEventCallback_t Callback, void* p_Arg);
+PdqError_t PdqEventModify(int Fd, uint32_t Events);
+PdqError_t PdqEventRemove(int Fd);
+bool       PdqEventIsWatched(int Fd);
+
+/* Periodic timer. Returns a timer id (>= 0) passed to the callback as Fd,
+ * or -1 on failure. */
+int        PdqEventAddTimer(uint32_t PeriodMs, PdqEventCallback_t Callback, void* p_Arg);
+PdqError_t PdqEventRemoveTimer(int TimerId);
+
+/* Deliver Sig through the loop instead of an async handler. Must be
+ * called before any other thread is created so the mask is inherited. */
+PdqError_t PdqEventAddSignal(int Sig, PdqEventCallback_t Callback, void* p_Arg);
+
+/* Wait up to TimeoutMs (-1 = forever) and dispatch ready callbacks.
+ * Returns the number of callbacks run, or -1 on a fatal error. */
+int        PdqEventRunOnce(int TimeoutMs);
+
+PdqError_t PdqEventNotifierInit(PdqEventNotifier_t* p_Notifier);
+void       PdqEventNotifierSignal(PdqEventNotifier_t* p_Notifier);
+void       PdqEventNotifierDrain(PdqEventNotifier_t* p_Notifier);
+void       PdqEventNotifierClose(PdqEventNotifier_t* p_Notifier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
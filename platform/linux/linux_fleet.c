@@ -0,0 +1,339 @@
+/**
+ * @file linux_fleet.c
+ * @brief Virtual miner fleet implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "linux_fleet.h"
+#include "linux_event.h"
+#include "stratum/stratum_client.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    PdqStratumContext_t Ctx;
+    uint32_t Index;
+    int      Fds[PDQ_STRATUM_MAX_ADDRS];
+    int      FdCount;
+    bool     Ready;             /* Counted in Stats.Ready */
+    uint64_t AttemptMs;         /* Start of the current connect, 0 when down */
+    uint64_t RetryMs;           /* Reconnect due, 0 for none */
+    uint64_t NextSubmitMs;
+    double   Difficulty;        /* As the server set it, before the client's floor */
+    uint32_t Rng;
+    uint32_t Extranonce2;
+} Miner_t;
+
+/* Millisecond latency counts, the last bucket holding everything longer */
+typedef struct {
+    uint32_t Counts[PDQ_FLEET_LATENCY_MAX_MS + 1];
+    uint64_t Total;
+} Histogram_t;
+
+static PdqFleetConfig_t s_Config;
+static Miner_t*         s_Miners = NULL;
+static PdqFleetStats_t  s_Stats;
+static Histogram_t      s_SubmitAll, s_SubmitLast;
+static Histogram_t      s_HandshakeAll, s_HandshakeLast;
+static uint64_t         s_StartMs;
+static int              s_Timer = -1;
+static char             s_User[PDQ_MAX_WORKER_LEN + 1];
+static bool             s_Running = false;
+
+static uint64_t GetMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint32_t NextRandom(Miner_t* m) {
+    /* xorshift32: cheap, and plenty for jitter and nonces */
+    uint32_t x = m->Rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    m->Rng = x;
+    return x;
+}
+
+static void Record(Histogram_t* p_All, Histogram_t* p_Last, uint32_t Ms) {
+    if (Ms > PDQ_FLEET_LATENCY_MAX_MS) Ms = PDQ_FLEET_LATENCY_MAX_MS;
+    p_All->Counts[Ms]++;
+    p_All->Total++;
+    p_Last->Counts[Ms]++;
+    p_Last->Total++;
+}
+
+static uint32_t Percentile(const Histogram_t* p_Hist, uint64_t Rank) {
+    uint64_t seen = 0;
+    for (uint32_t ms = 0; ms <= PDQ_FLEET_LATENCY_MAX_MS; ms++) {
+        seen += p_Hist->Counts[ms];
+        if (seen > Rank) return ms;
+    }
+    return PDQ_FLEET_LATENCY_MAX_MS;
+}
+
+static void Summarize(const Histogram_t* p_Hist, PdqFleetLatency_t* p_Out) {
+    memset(p_Out, 0, sizeof(*p_Out));
+    uint64_t n = p_Hist->Total;
+    p_Out->Count = n;
+    if (n == 0) return;
+    p_Out->P50Ms = Percentile(p_Hist, n * 50 / 100);
+    p_Out->P90Ms = Percentile(p_Hist, n * 90 / 100);
+    p_Out->P99Ms = Percentile(p_Hist, n * 99 / 100);
+    p_Out->P999Ms = Percentile(p_Hist, n * 999 / 1000);
+    p_Out->MaxMs = Percentile(p_Hist, n - 1);
+}
+
+/* Mean share interval at the server's difficulty, drawn exponentially */
+static uint64_t NextShareDelay(Miner_t* m) {
+    double meanMs = s_Config.ShareIntervalMs;
+    if (s_Config.HashRate > 0.0) meanMs = m->Difficulty * 4294967296.0 / s_Config.HashRate * 1000.0;
+    double u = (NextRandom(m) >> 8) / 16777216.0;
+    double delay = -log(1.0 - u) * meanMs;
+    return delay < 1.0 ? 1 : (uint64_t)delay;
+}
+
+static void OnMinerEvent(int Fd, uint32_t Events, void* p_Arg);
+
+static void SyncWatch(Miner_t* m) {
+    int fds[PDQ_STRATUM_MAX_ADDRS];
+    bool wantWrite = false;
+    int count = PdqStratumCtxGetPollFds(&m->Ctx, fds, PDQ_STRATUM_MAX_ADDRS, &wantWrite);
+    uint32_t events = wantWrite ? (PDQ_EVENT_READ | PDQ_EVENT_WRITE) : PDQ_EVENT_READ;
+
+    for (int j = 0; j < m->FdCount; j++) {
+        bool kept = false;
+        for (int k = 0; k < count; k++) kept |= (fds[k] == m->Fds[j]);
+        if (!kept) PdqEventRemove(m->Fds[j]);
+    }
+
+    int watched = 0;
+    for (int k = 0; k < count; k++) {
+        bool known = false;
+        for (int j = 0; j < m->FdCount; j++) known |= (fds[k] == m->Fds[j]);
+        if (known) {
+            PdqEventModify(fds[k], events);
+        } else if (PdqEventAdd(fds[k], events, OnMinerEvent, m) != PdqOk) {
+            continue;
+        }
+        m->Fds[watched++] = fds[k];
+    }
+    m->FdCount = watched;
+}
+
+static void Connect(Miner_t* m, uint64_t now) {
+    m->RetryMs = 0;
+    m->AttemptMs = now ? now : 1;
+    if (PdqStratumCtxConnectStart(&m->Ctx, s_Config.p_Host, s_Config.Port) != PdqOk) {
+        s_Stats.Failures++;
+        m->AttemptMs = 0;
+        if (s_Config.ReconnectMs) m->RetryMs = now + s_Config.ReconnectMs;
+    }
+    SyncWatch(m);
+}
+
+/* Session closed or given up on: count it and schedule the reconnect,
+ * spread over up to twice the delay so a mass drop does not come back
+ * as one burst */
+static void GoDown(Miner_t* m, uint64_t now) {
+    if (m->Ready) {
+        m->Ready = false;
+        s_Stats.Ready--;
+        s_Stats.Drops++;
+    } else {
+        s_Stats.Failures++;
+    }
+    PdqStratumCtxDisconnect(&m->Ctx);
+    SyncWatch(m);
+    m->AttemptMs = 0;
+    if (s_Config.ReconnectMs) {
+        m->RetryMs = now + s_Config.ReconnectMs + NextRandom(m) % (s_Config.ReconnectMs + 1);
+    }
+}
+
+/* Moves the handshake along after the context has processed input */
+static void Drive(Miner_t* m, uint64_t now) {
+    if (!m->AttemptMs) return;
+    switch (PdqStratumCtxGetState(&m->Ctx)) {
+        case StratumStateDisconnected:
+            GoDown(m, now);
+            return;
+        case StratumStateConnected:
+            PdqStratumCtxSubscribe(&m->Ctx);
+            break;
+        case StratumStateSubscribed: {
+            char worker[PDQ_MAX_WORKER_LEN + 16];
+            snprintf(worker, sizeof(worker), "%s.%u", s_User, (unsigned)m->Index);
+            PdqStratumCtxAuthorize(&m->Ctx, worker, s_Config.p_Password ? s_Config.p_Password : "x");
+            break;
+        }
+        case StratumStateReady:
+            if (!m->Ready) {
+                m->Ready = true;
+                s_Stats.Ready++;
+                s_Stats.Handshakes++;
+                Record(&s_HandshakeAll, &s_HandshakeLast, (uint32_t)(now - m->AttemptMs));
+                m->NextSubmitMs = now + NextShareDelay(m);
+            }
+            break;
+        default:
+            break;
+    }
+    if (!m->Ready && now - m->AttemptMs > PDQ_FLEET_HANDSHAKE_MS) {
+        GoDown(m, now);
+        return;
+    }
+    SyncWatch(m);
+}
+
+static void OnMinerEvent(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    (void)Events;
+    Miner_t* m = (Miner_t*)p_Arg;
+    PdqStratumCtxProcess(&m->Ctx);
+    Drive(m, GetMillis());
+}
+
+static void OnSubmitResult(void* p_Arg, PdqSubmitResult_t Result, int32_t ErrorCode, uint32_t LatencyMs) {
+    (void)p_Arg;
+    (void)ErrorCode;
+    switch (Result) {
+        case PdqSubmitAccepted:
+            s_Stats.Accepted++;
+            Record(&s_SubmitAll, &s_SubmitLast, LatencyMs);
+            break;
+        case PdqSubmitRejected:
+            s_Stats.Rejected++;
+            Record(&s_SubmitAll, &s_SubmitLast, LatencyMs);
+            break;
+        case PdqSubmitTimedOut:
+            s_Stats.TimedOut++;
+            break;
+        default:
+            /* Stale shares are never sent, and already counted as unsent */
+            break;
+    }
+}
+
+/* set_difficulty as sent, since the context raises it to its floor */
+static void OnLine(void* p_Arg, bool Outbound, const char* p_Line, size_t Len) {
+    (void)Len;
+    if (Outbound || !strstr(p_Line, "mining.set_difficulty")) return;
+    const char* params = strstr(p_Line, "\"params\"");
+    params = params ? strchr(params, '[') : NULL;
+    double diff = params ? strtod(params + 1, NULL) : 0.0;
+    if (diff > 0.0) ((Miner_t*)p_Arg)->Difficulty = diff;
+}
+
+static void Submit(Miner_t* m) {
+    PdqStratumJob_t job;
+    if (PdqStratumCtxGetJob(&m->Ctx, &job) != PdqOk || !job.JobId[0]) return;
+    s_Stats.Submits++;
+    if (PdqStratumCtxSubmitShare(&m->Ctx, job.JobId, ++m->Extranonce2, NextRandom(m), job.NTime) != PdqOk) {
+        s_Stats.Unsent++;
+    }
+}
+
+static void OnTick(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    (void)Events;
+    (void)p_Arg;
+    uint64_t now = GetMillis();
+
+    /* Ramp: however many sessions the elapsed time allows */
+    uint64_t due = s_Config.Miners;
+    if (s_Config.RampPerSec) {
+        due = (now - s_StartMs) * s_Config.RampPerSec / 1000 + 1;
+        if (due > s_Config.Miners) due = s_Config.Miners;
+    }
+    while (s_Stats.Started < due) Connect(&s_Miners[s_Stats.Started++], now);
+
+    for (uint32_t i = 0; i < s_Stats.Started; i++) {
+        Miner_t* m = &s_Miners[i];
+        if (m->Ready) {
+            if (now >= m->NextSubmitMs) {
+                Submit(m);
+                m->NextSubmitMs = now + NextShareDelay(m);
+                SyncWatch(m);
+            }
+        } else if (m->RetryMs && now >= m->RetryMs) {
+            Connect(m, now);
+        } else if (m->AttemptMs) {
+            /* Staggered connects and handshake timeouts run on the clock */
+            PdqStratumCtxProcess(&m->Ctx);
+            Drive(m, now);
+        }
+    }
+}
+
+PdqError_t PdqFleetStart(const PdqFleetConfig_t* p_Config) {
+    if (!p_Config || !p_Config->p_Host || !p_Config->Port || s_Running) return PdqErrorInvalidParam;
+    if (p_Config->Miners == 0 || p_Config->Miners > PDQ_FLEET_MAX_MINERS) return PdqErrorInvalidParam;
+    if (p_Config->ShareIntervalMs == 0 && p_Config->HashRate <= 0.0) return PdqErrorInvalidParam;
+
+    s_Config = *p_Config;
+    snprintf(s_User, sizeof(s_User), "%s", p_Config->p_User ? p_Config->p_User : "fleet");
+    s_Miners = (Miner_t*)calloc(p_Config->Miners, sizeof(Miner_t));
+    if (!s_Miners) return PdqErrorNoMemory;
+
+    memset(&s_Stats, 0, sizeof(s_Stats));
+    memset(&s_SubmitAll, 0, sizeof(s_SubmitAll));
+    memset(&s_SubmitLast, 0, sizeof(s_SubmitLast));
+    memset(&s_HandshakeAll, 0, sizeof(s_HandshakeAll));
+    memset(&s_HandshakeLast, 0, sizeof(s_HandshakeLast));
+    s_Stats.Miners = p_Config->Miners;
+
+    for (uint32_t i = 0; i < p_Config->Miners; i++) {
+        Miner_t* m = &s_Miners[i];
+        PdqStratumCtxInit(&m->Ctx);
+        PdqStratumCtxSetSubmitCallback(&m->Ctx, OnSubmitResult, m);
+        PdqStratumCtxSetLineCallback(&m->Ctx, OnLine, m);
+        m->Index = i;
+        m->Difficulty = 1.0;
+        m->Rng = (p_Config->Seed ^ 0x9e3779b9u) + i * 0x85ebca6bu;
+        if (m->Rng == 0) m->Rng = 1;
+    }
+
+    s_StartMs = GetMillis();
+    s_Timer = PdqEventAddTimer(PDQ_FLEET_TICK_MS, OnTick, NULL);
+    if (s_Timer < 0) {
+        free(s_Miners);
+        s_Miners = NULL;
+        return PdqErrorNoMemory;
+    }
+    s_Running = true;
+    return PdqOk;
+}
+
+void PdqFleetStop(void) {
+    if (!s_Running) return;
+    PdqEventRemoveTimer(s_Timer);
+    s_Timer = -1;
+    for (uint32_t i = 0; i < s_Config.Miners; i++) {
+        Miner_t* m = &s_Miners[i];
+        for (int j = 0; j < m->FdCount; j++) PdqEventRemove(m->Fds[j]);
+        PdqStratumCtxRelease(&m->Ctx);
+    }
+    free(s_Miners);
+    s_Miners = NULL;
+    s_Running = false;
+}
+
+void PdqFleetGetStats(PdqFleetStats_t* p_Stats) {
+    if (p_Stats) *p_Stats = s_Stats;
+}
+
+void PdqFleetGetLatency(PdqFleetLatency_t* p_Submit, PdqFleetLatency_t* p_Handshake, bool SinceLast) {
+    if (p_Submit) Summarize(SinceLast ? &s_SubmitLast : &s_SubmitAll, p_Submit);
+    if (p_Handshake) Summarize(SinceLast ? &s_HandshakeLast : &s_HandshakeAll, p_Handshake);
+    if (SinceLast) {
+        memset(&s_SubmitLast, 0, sizeof(s_SubmitLast));
+        memset(&s_HandshakeLast, 0, sizeof(s_HandshakeLast));
+    }
+}
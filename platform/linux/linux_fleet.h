@@ -0,0 +1,88 @@
+/**
+ * @file linux_fleet.h
+ * @brief Virtual miner fleet: Stratum V1 load from one process
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Opens up to thousands of Stratum V1 sessions to one server with the
+ * shared stratum_client.c contexts, each behaving like a miner: it
+ * subscribes, authorizes, and submits shares for its current job at a
+ * realistic rate, without hashing. Share intervals are exponentially
+ * distributed around a fixed mean, or around the mean a miner of a given
+ * hashrate would see at the difficulty the server set for it. Nonces are
+ * random, so a server that verifies shares rejects them as low
+ * difficulty; it still does all the work of checking them.
+ *
+ * Sessions are ramped in at a fixed rate and, if the server drops them,
+ * reconnect after a delay. Handshake and submit latencies go into
+ * millisecond histograms for percentiles.
+ *
+ * Runs on the event loop; all functions must be called from the thread
+ * that runs it.
+ */
+
+#ifndef PDQ_LINUX_FLEET_H
+#define PDQ_LINUX_FLEET_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_FLEET_MAX_MINERS        65536
+#define PDQ_FLEET_TICK_MS           10      /* Ramp, submit and reconnect timer */
+#define PDQ_FLEET_HANDSHAKE_MS      30000   /* Connect to first job, else retry */
+#define PDQ_FLEET_LATENCY_MAX_MS    60000   /* Histogram range; longer counts as this */
+
+typedef struct {
+    const char* p_Host;
+    uint16_t    Port;
+    uint32_t    Miners;
+    uint32_t    RampPerSec;         /* New sessions per second, 0 for all at once */
+    uint32_t    ShareIntervalMs;    /* Mean time between shares ... */
+    double      HashRate;           /* ... or, when non-zero, from this H/s per miner */
+    uint32_t    ReconnectMs;        /* After a drop or failed connect, 0 stays down */
+    const char* p_User;             /* Miners authorize as <User>.<n> */
+    const char* p_Password;         /* NULL for "x" */
+    uint32_t    Seed;               /* For share timing and nonces */
+} PdqFleetConfig_t;
+
+typedef struct {
+    uint32_t Miners;                /* Configured */
+    uint32_t Started;               /* Ramped in so far */
+    uint32_t Ready;                 /* Authorized, with a job, right now */
+    uint64_t Handshakes;            /* Sessions that reached their first job */
+    uint64_t Failures;              /* Connects or handshakes that did not */
+    uint64_t Drops;                 /* Ready sessions the server closed */
+    uint64_t Submits;
+    uint64_t Accepted;
+    uint64_t Rejected;
+    uint64_t TimedOut;
+    uint64_t Unsent;                /* Full send queue or stale job */
+} PdqFleetStats_t;
+
+typedef struct {
+    uint64_t Count;
+    uint32_t P50Ms;
+    uint32_t P90Ms;
+    uint32_t P99Ms;
+    uint32_t P999Ms;
+    uint32_t MaxMs;
+} PdqFleetLatency_t;
+
+PdqError_t PdqFleetStart(const PdqFleetConfig_t* p_Config);
+void       PdqFleetStop(void);
+void       PdqFleetGetStats(PdqFleetStats_t* p_Stats);
+
+/* Submit (sent to answered) and handshake (connect to first job)
+ * latencies. SinceLast covers the time since the last SinceLast call,
+ * otherwise the whole run. */
+void       PdqFleetGetLatency(PdqFleetLatency_t* p_Submit, PdqFleetLatency_t* p_Handshake,
+                              bool SinceLast);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
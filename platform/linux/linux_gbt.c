@@ -0,0 +1,1343 @@
+/**
+ * @file linux_gbt.c
+ * @brief getblocktemplate solo mining implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * A mainnet template lists a few thousand transactions, far more tokens
+ * than the Stratum tokenizer indexes, so a reply is not tokenized whole:
+ * the transactions array is located with a structural scan and each
+ * entry tokenized on its own, then blanked out so the rest of the
+ * template fits a small token array. Raw transactions stay hex, exactly
+ * as the node sent them, until they are copied into submitblock.
+ */
+
+#include "linux_gbt.h"
+#include "linux_event.h"
+#include "stratum/stratum_json.h"
+#include "core/sha256_engine.h"
+#include "core/target.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifdef MSG_NOSIGNAL
+#define GBT_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define GBT_SEND_FLAGS 0
+#endif
+
+#define GBT_MAX_TOKENS       256    /* Template without its transactions */
+#define GBT_TX_TOKENS        64     /* One transactions entry */
+#define GBT_ERROR_TOKENS     16
+#define GBT_LONGPOLL_ID_MAX  128
+#define GBT_LONGPOLL_MIN_MS  1000   /* A longpoll dropped sooner failed outright */
+#define GBT_READ_CHUNK       65536
+#define GBT_COMMITMENT_MAX   64
+#define GBT_EXTRANONCE1_LEN  4
+#define GBT_EXTRANONCE2_LEN  4
+#define GBT_DEFAULT_TAG      "/PDQminer/"
+
+typedef struct RpcCall RpcCall_t;
+
+/* p_Body is NULL when the call failed or the node refused it at the HTTP
+ * level; otherwise it is the NUL-terminated JSON-RPC reply */
+typedef void (*RpcDone_t)(RpcCall_t* p_Call, char* p_Body, size_t Len);
+
+struct RpcCall {
+    int       Fd;
+    bool      Busy;
+    bool      Connected;
+    uint64_t  StartMs;
+    uint64_t  DeadlineMs;       /* 0 waits as long as the node takes */
+    char*     p_Out;
+    size_t    OutLen;
+    size_t    OutSent;
+    char*     p_In;
+    size_t    InLen;
+    size_t    InCap;
+    size_t    BodyStart;        /* 0 until the headers are in */
+    size_t    ContentLength;    /* SIZE_MAX when the node did not say */
+    RpcDone_t Done;
+};
+
+/* One getblocktemplate reply, turned into the pieces of a Stratum job.
+ * The coinbase is split around the extranonce in its non-witness form,
+ * the one the txid and the merkle root are hashed over. */
+typedef struct {
+    uint32_t  Id;               /* Job id, as 8 hex digits */
+    uint64_t  FetchedMs;
+    uint8_t   Fingerprint[32];  /* Tells a changed template from a repeat */
+    uint8_t   PrevBlockHash[32];/* Header byte order */
+    uint32_t  Version;
+    uint32_t  NBits;
+    uint32_t  CurTime;
+    uint32_t  Height;
+    uint64_t  CoinbaseValue;
+    bool      Witness;          /* Carries a witness commitment */
+    uint8_t*  p_Coinbase1;
+    uint32_t  Coinbase1Len;
+    uint8_t*  p_Coinbase2;
+    uint32_t  Coinbase2Len;
+    uint8_t   (*p_Branches)[32];
+    uint16_t  BranchCount;
+    uint32_t  TxCount;
+    char*     p_TxHex;          /* Raw transactions, concatenated */
+    size_t    TxHexLen;
+} GbtTemplate_t;
+
+typedef struct {
+    char*    p_Body;
+    size_t   Len;
+    uint64_t QueuedMs;
+} GbtSubmit_t;
+
+static bool            s_Running = false;
+static PdqGbtConfig_t  s_Config;
+static PdqGbtStats_t   s_Stats;
+static struct sockaddr_storage s_Addr;
+static socklen_t       s_AddrLen = 0;
+static char            s_HostHeader[PDQ_MAX_HOST_LEN + 8];
+static uint8_t         s_Script[PDQ_GBT_SCRIPT_MAX];
+static size_t          s_ScriptLen = 0;
+static char            s_Tag[PDQ_GBT_TAG_MAX + 1];
+
+static PdqGbtJobCallback_t        s_OnJob = NULL;
+static PdqStratumSubmitCallback_t s_OnSubmit = NULL;
+static void*           s_CallbackArg = NULL;
+
+static RpcCall_t       s_TemplateCall = {.Fd = -1};
+static RpcCall_t       s_SubmitCall = {.Fd = -1};
+static bool            s_LongPolling = false;
+static char            s_LongPollId[GBT_LONGPOLL_ID_MAX + 1];
+static uint64_t        s_NextFetchMs = 0;
+static bool            s_Ready = false;
+
+static GbtTemplate_t   s_Templates[PDQ_GBT_TEMPLATES];
+static int             s_Current = -1;
+static uint32_t        s_TemplateSeq = 0;
+static bool            s_NewJob = false;
+static bool            s_CleanPending = false;
+static uint64_t        s_LastJobMs = 0;
+static uint8_t         s_Extranonce1[GBT_EXTRANONCE1_LEN];
+static uint32_t        s_Extranonce2 = 0;
+
+static GbtSubmit_t     s_Submits[PDQ_GBT_SUBMIT_QUEUE];
+static uint8_t         s_SubmitCount = 0;
+static uint64_t        s_SubmitStartMs = 0;
+
+static PdqJsonToken_t  s_Tokens[GBT_MAX_TOKENS];
+
+static const char s_Hex[] = "0123456789abcdef";
+
+static uint64_t GetMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static int HexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static char* PutHex(char* p_Out, const uint8_t* p_Data, size_t Len) {
+    for (size_t i = 0; i < Len; i++) {
+        *p_Out++ = s_Hex[p_Data[i] >> 4];
+        *p_Out++ = s_Hex[p_Data[i] & 0x0f];
+    }
+    return p_Out;
+}
+
+static size_t PutVarInt(uint8_t* p_Out, uint64_t Value) {
+    if (Value < 0xfd) {
+        p_Out[0] = (uint8_t)Value;
+        return 1;
+    }
+    size_t bytes = Value <= 0xffff ? 2 : (Value <= 0xffffffffu ? 4 : 8);
+    p_Out[0] = bytes == 2 ? 0xfd : (bytes == 4 ? 0xfe : 0xff);
+    for (size_t i = 0; i < bytes; i++) p_Out[1 + i] = (uint8_t)(Value >> (8 * i));
+    return 1 + bytes;
+}
+
+static void PutLe32(uint8_t* p_Out, uint32_t Value) {
+    for (int i = 0; i < 4; i++) p_Out[i] = (uint8_t)(Value >> (8 * i));
+}
+
+/* ---- Payout address ---- */
+
+static const char s_Base58[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+static const char s_Bech32[] = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+#define BECH32_CONST    1u
+#define BECH32M_CONST   0x2bc830a3u
+
+static PdqError_t Base58ToScript(const char* p_Address, uint8_t* p_Script, size_t* p_Len) {
+    uint8_t raw[25];
+    size_t len = strlen(p_Address);
+    if (len < 26 || len > 35) return PdqErrorInvalidParam;
+
+    /* Big-number base conversion into a fixed 25-byte buffer; leading
+     * '1's are leading zero bytes and fall out of it naturally */
+    memset(raw, 0, sizeof(raw));
+    for (size_t i = 0; i < len; i++) {
+        const char* p = strchr(s_Base58, p_Address[i]);
+        if (!p || !*p) return PdqErrorInvalidParam;
+        uint32_t carry = (uint32_t)(p - s_Base58);
+        for (int j = (int)sizeof(raw) - 1; j >= 0; j--) {
+            carry += 58u * raw[j];
+            raw[j] = (uint8_t)carry;
+            carry >>= 8;
+        }
+        if (carry) return PdqErrorInvalidParam;
+    }
+
+    uint8_t check[32];
+    PdqSha256d(raw, 21, check);
+    if (memcmp(check, raw + 21, 4) != 0) return PdqErrorInvalidParam;
+
+    switch (raw[0]) {
+        case 0x00:  /* P2PKH, mainnet */
+        case 0x6f:  /* P2PKH, test networks */
+            p_Script[0] = 0x76;
+            p_Script[1] = 0xa9;
+            p_Script[2] = 0x14;
+            memcpy(p_Script + 3, raw + 1, 20);
+            p_Script[23] = 0x88;
+            p_Script[24] = 0xac;
+            *p_Len = 25;
+            return PdqOk;
+        case 0x05:  /* P2SH, mainnet */
+        case 0xc4:  /* P2SH, test networks */
+            p_Script[0] = 0xa9;
+            p_Script[1] = 0x14;
+            memcpy(p_Script + 2, raw + 1, 20);
+            p_Script[22] = 0x87;
+            *p_Len = 23;
+            return PdqOk;
+        default:
+            return PdqErrorInvalidParam;
+    }
+}
+
+static uint32_t Bech32Polymod(uint32_t Chk, uint8_t Value) {
+    static const uint32_t s_Gen[5] = {0x3b6a57b2u, 0x26508e6du, 0x1ea119fau, 0x3d4233ddu, 0x2a1462b3u};
+    uint8_t top = (uint8_t)(Chk >> 25);
+    Chk = ((Chk & 0x1ffffffu) << 5) ^ Value;
+    for (int i = 0; i < 5; i++) {
+        if ((top >> i) & 1) Chk ^= s_Gen[i];
+    }
+    return Chk;
+}
+
+static PdqError_t Bech32ToScript(const char* p_Address, uint8_t* p_Script, size_t* p_Len) {
+    size_t len = strlen(p_Address);
+    const char* sep = strrchr(p_Address, '1');
+    if (len > 90 || !sep) return PdqErrorInvalidParam;
+    size_t hrpLen = (size_t)(sep - p_Address);
+    size_t dataLen = len - hrpLen - 1;
+    if (dataLen < 7) return PdqErrorInvalidParam;
+
+    char hrp[8];
+    if (hrpLen >= sizeof(hrp)) return PdqErrorInvalidParam;
+    bool lower = false, upper = false;
+    for (size_t i = 0; i < len; i++) {
+        lower |= (p_Address[i] >= 'a' && p_Address[i] <= 'z');
+        upper |= (p_Address[i] >= 'A' && p_Address[i] <= 'Z');
+    }
+    if (lower && upper) return PdqErrorInvalidParam;
+    for (size_t i = 0; i < hrpLen; i++) {
+        char c = p_Address[i];
+        hrp[i] = (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+    }
+    hrp[hrpLen] = '\0';
+    if (strcmp(hrp, "bc") != 0 && strcmp(hrp, "tb") != 0 && strcmp(hrp, "bcrt") != 0) {
+        return PdqErrorInvalidParam;
+    }
+
+    uint32_t chk = 1;
+    for (size_t i = 0; i < hrpLen; i++) chk = Bech32Polymod(chk, (uint8_t)(hrp[i] >> 5));
+    chk = Bech32Polymod(chk, 0);
+    for (size_t i = 0; i < hrpLen; i++) chk = Bech32Polymod(chk, (uint8_t)(hrp[i] & 31));
+
+    uint8_t data[90];
+    for (size_t i = 0; i < dataLen; i++) {
+        char c = sep[1 + i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c + 32);
+        const char* p = strchr(s_Bech32, c);
+        if (!p || !*p) return PdqErrorInvalidParam;
+        data[i] = (uint8_t)(p - s_Bech32);
+        chk = Bech32Polymod(chk, data[i]);
+    }
+
+    /* BIP350: version 0 keeps the original checksum, later versions
+     * must use bech32m */
+    uint8_t version = data[0];
+    if (version > 16 || chk != (version == 0 ? BECH32_CONST : BECH32M_CONST)) return PdqErrorInvalidParam;
+
+    uint8_t program[40];
+    size_t programLen = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (size_t i = 1; i < dataLen - 6; i++) {
+        acc = (acc << 5) | data[i];
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            if (programLen == sizeof(program)) return PdqErrorInvalidParam;
+            program[programLen++] = (uint8_t)(acc >> bits);
+        }
+    }
+    if (bits >= 5 || (acc & ((1u << bits) - 1)) != 0) return PdqErrorInvalidParam;
+    if (programLen < 2 || (version == 0 && programLen != 20 && programLen != 32)) return PdqErrorInvalidParam;
+
+    p_Script[0] = version == 0 ? 0x00 : (uint8_t)(0x50 + version);
+    p_Script[1] = (uint8_t)programLen;
+    memcpy(p_Script + 2, program, programLen);
+    *p_Len = programLen + 2;
+    return PdqOk;
+}
+
+PdqError_t PdqGbtAddressToScript(const char* p_Address, uint8_t* p_Script, size_t* p_Len) {
+    if (!p_Address || !p_Script || !p_Len) return PdqErrorInvalidParam;
+    if (Bech32ToScript(p_Address, p_Script, p_Len) == PdqOk) return PdqOk;
+    return Base58ToScript(p_Address, p_Script, p_Len);
+}
+
+/* ---- Structural JSON scan ----
+ * Just enough to find a member's value and step over whole values,
+ * whatever their size. Positions are byte offsets into the reply. */
+
+static size_t SkipWs(const char* p_Text, size_t Pos, size_t Len) {
+    while (Pos < Len && (p_Text[Pos] == ' ' || p_Text[Pos] == '\t' ||
+                         p_Text[Pos] == '\r' || p_Text[Pos] == '\n')) {
+        Pos++;
+    }
+    return Pos;
+}
+
+/* One past the value starting at Pos, or 0 if it runs off the end */
+static size_t ValueEnd(const char* p_Text, size_t Pos, size_t Len) {
+    if (Pos >= Len) return 0;
+    char c = p_Text[Pos];
+    if (c == '"') {
+        for (size_t i = Pos + 1; i < Len; i++) {
+            if (p_Text[i] == '\\') {
+                i++;
+            } else if (p_Text[i] == '"') {
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+    if (c == '{' || c == '[') {
+        int depth = 0;
+        for (size_t i = Pos; i < Len; i++) {
+            char d = p_Text[i];
+            if (d == '"') {
+                size_t end = ValueEnd(p_Text, i, Len);
+                if (end == 0) return 0;
+                i = end - 1;
+            } else if (d == '{' || d == '[') {
+                depth++;
+            } else if ((d == '}' || d == ']') && --depth == 0) {
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+    size_t i = Pos;
+    while (i < Len && p_Text[i] != ',' && p_Text[i] != '}' && p_Text[i] != ']' &&
+           p_Text[i] != ' ' && p_Text[i] != '\r' && p_Text[i] != '\n' && p_Text[i] != '\t') {
+        i++;
+    }
+    return i;
+}
+
+/* Value of member p_Key in the object spanning [Start, End) */
+static bool FindMember(const char* p_Text, size_t Start, size_t End, const char* p_Key,
+                       size_t* p_ValueStart, size_t* p_ValueEnd) {
+    size_t keyLen = strlen(p_Key);
+    size_t pos = SkipWs(p_Text, Start + 1, End);
+    while (pos < End && p_Text[pos] == '"') {
+        size_t keyEnd = ValueEnd(p_Text, pos, End);
+        if (keyEnd == 0) return false;
+        bool match = (keyEnd - pos - 2 == keyLen) && memcmp(p_Text + pos + 1, p_Key, keyLen) == 0;
+        pos = SkipWs(p_Text, keyEnd, End);
+        if (pos >= End || p_Text[pos] != ':') return false;
+        pos = SkipWs(p_Text, pos + 1, End);
+        size_t valueEnd = ValueEnd(p_Text, pos, End);
+        if (valueEnd == 0) return false;
+        if (match) {
+            *p_ValueStart = pos;
+            *p_ValueEnd = valueEnd;
+            return true;
+        }
+        pos = SkipWs(p_Text, valueEnd, End);
+        if (pos >= End || p_Text[pos] != ',') return false;
+        pos = SkipWs(p_Text, pos + 1, End);
+    }
+    return false;
+}
+
+static bool IsNull(const char* p_Text, size_t Start, size_t End) {
+    return End - Start == 4 && memcmp(p_Text + Start, "null", 4) == 0;
+}
+
+/* Locate result and error in a JSON-RPC reply; logs the node's error */
+static bool SplitReply(const char* p_Method, const char* p_Body, size_t Len,
+                       size_t* p_ResultStart, size_t* p_ResultEnd) {
+    size_t root = SkipWs(p_Body, 0, Len);
+    size_t rootEnd = ValueEnd(p_Body, root, Len);
+    if (rootEnd == 0 || p_Body[root] != '{') {
+        printf("[GBT] %s: malformed reply\n", p_Method);
+        return false;
+    }
+
+    size_t errStart, errEnd;
+    if (FindMember(p_Body, root, rootEnd, "error", &errStart, &errEnd) && !IsNull(p_Body, errStart, errEnd)) {
+        PdqJsonDoc_t doc;
+        PdqJsonToken_t tokens[GBT_ERROR_TOKENS];
+        char message[160] = "";
+        int64_t code = 0;
+        if (PdqJsonParse(&doc, p_Body + errStart, errEnd - errStart, tokens, GBT_ERROR_TOKENS) == PdqOk) {
+            PdqJsonGetString(&doc, PdqJsonObjectGet(&doc, 0, "message"), message, sizeof(message));
+            PdqJsonGetInt(&doc, PdqJsonObjectGet(&doc, 0, "code"), &code);
+        }
+        printf("[GBT] %s failed: %s (%lld)\n", p_Method, message, (long long)code);
+        return false;
+    }
+    if (!FindMember(p_Body, root, rootEnd, "result", p_ResultStart, p_ResultEnd)) {
+        printf("[GBT] %s: reply without a result\n", p_Method);
+        return false;
+    }
+    return true;
+}
+
+/* ---- Templates ---- */
+
+static void FreeTemplate(GbtTemplate_t* p_Template) {
+    free(p_Template->p_Coinbase1);
+    free(p_Template->p_Coinbase2);
+    free(p_Template->p_Branches);
+    free(p_Template->p_TxHex);
+    memset(p_Template, 0, sizeof(*p_Template));
+}
+
+static GbtTemplate_t* FindTemplate(const char* p_JobId) {
+    char* end = NULL;
+    unsigned long id = strtoul(p_JobId, &end, 16);
+    if (end == p_JobId || *end != '\0') return NULL;
+    for (int i = 0; i < PDQ_GBT_TEMPLATES; i++) {
+        if (s_Templates[i].p_Coinbase1 && s_Templates[i].Id == (uint32_t)id) return &s_Templates[i];
+    }
+    return NULL;
+}
+
+static void TemplateToJob(const GbtTemplate_t* p_Template, PdqStratumJob_t* p_Job) {
+    memset(p_Job, 0, sizeof(*p_Job));
+    snprintf(p_Job->JobId, sizeof(p_Job->JobId), "%08x", (unsigned)p_Template->Id);
+    memcpy(p_Job->PrevBlockHash, p_Template->PrevBlockHash, 32);
+    p_Job->p_Coinbase1 = p_Template->p_Coinbase1;
+    p_Job->Coinbase1Len = p_Template->Coinbase1Len;
+    p_Job->p_Coinbase2 = p_Template->p_Coinbase2;
+    p_Job->Coinbase2Len = p_Template->Coinbase2Len;
+    p_Job->p_MerkleBranches = (const uint8_t (*)[32])p_Template->p_Branches;
+    p_Job->MerkleBranchCount = p_Template->BranchCount;
+    p_Job->Version = p_Template->Version;
+    p_Job->NBits = p_Template->NBits;
+    p_Job->NTime = p_Template->CurTime;
+}
+
+/* Branches of the coinbase's merkle path, the Stratum way: p_Hashes holds
+ * the other txids (room for one more) and is consumed level by level */
+static uint16_t BuildBranches(uint8_t (*p_Hashes)[32], uint32_t Count, uint8_t (*p_Branches)[32]) {
+    uint16_t steps = 0;
+    while (Count > 0) {
+        memcpy(p_Branches[steps++], p_Hashes[0], 32);
+        /* The level below is the coinbase path plus Count hashes; an odd
+         * total pairs the last hash with itself */
+        if (Count % 2 == 0) memcpy(p_Hashes[Count], p_Hashes[Count - 1], 32);
+        uint32_t next = Count / 2;
+        for (uint32_t k = 0; k < next; k++) {
+            uint8_t concat[64];
+            memcpy(concat, p_Hashes[1 + 2 * k], 32);
+            memcpy(concat + 32, p_Hashes[2 + 2 * k], 32);
+            PdqSha256d(concat, 64, p_Hashes[k]);
+        }
+        Count = next;
+    }
+    return steps;
+}
+
+/* CScript() << Height, which BIP34 requires the scriptSig to start with */
+static size_t PutHeight(uint8_t* p_Out, uint32_t Height) {
+    if (Height == 0) {
+        p_Out[0] = 0x00;
+        return 1;
+    }
+    if (Height <= 16) {
+        p_Out[0] = (uint8_t)(0x50 + Height);
+        return 1;
+    }
+    uint8_t n = 0;
+    while (Height) {
+        p_Out[1 + n++] = (uint8_t)Height;
+        Height >>= 8;
+    }
+    if (p_Out[n] & 0x80) p_Out[1 + n++] = 0;
+    p_Out[0] = n;
+    return 1 + (size_t)n;
+}
+
+/* Version 2, one null input whose scriptSig is the height, then the
+ * extranonce push, then the tag; the whole value to the payout script
+ * and, for segwit templates, the witness commitment. */
+static PdqError_t BuildCoinbase(GbtTemplate_t* p_Template, const uint8_t* p_Commitment, size_t CommitmentLen) {
+    uint8_t height[6];
+    size_t heightLen = PutHeight(height, p_Template->Height);
+    size_t tagLen = strlen(s_Tag);
+    size_t scriptLen = heightLen + 1 + GBT_EXTRANONCE1_LEN + GBT_EXTRANONCE2_LEN + (tagLen ? 1 + tagLen : 0);
+
+    uint8_t* cb1 = (uint8_t*)malloc(4 + 1 + 36 + 1 + heightLen + 1);
+    uint8_t* cb2 = (uint8_t*)malloc(1 + tagLen + 4 + 1 + 2 * (8 + 1 + GBT_COMMITMENT_MAX) + 4);
+    if (!cb1 || !cb2) {
+        free(cb1);
+        free(cb2);
+        return PdqErrorNoMemory;
+    }
+
+    size_t n = 0;
+    PutLe32(cb1 + n, 2);
+    n += 4;
+    cb1[n++] = 1;
+    memset(cb1 + n, 0, 32);
+    n += 32;
+    memset(cb1 + n, 0xff, 4);
+    n += 4;
+    cb1[n++] = (uint8_t)scriptLen;
+    memcpy(cb1 + n, height, heightLen);
+    n += heightLen;
+    cb1[n++] = GBT_EXTRANONCE1_LEN + GBT_EXTRANONCE2_LEN;
+    p_Template->p_Coinbase1 = cb1;
+    p_Template->Coinbase1Len = (uint32_t)n;
+
+    n = 0;
+    if (tagLen) {
+        cb2[n++] = (uint8_t)tagLen;
+        memcpy(cb2 + n, s_Tag, tagLen);
+        n += tagLen;
+    }
+    memset(cb2 + n, 0xff, 4);
+    n += 4;
+    cb2[n++] = CommitmentLen ? 2 : 1;
+    for (int i = 0; i < 8; i++) cb2[n++] = (uint8_t)(p_Template->CoinbaseValue >> (8 * i));
+    cb2[n++] = (uint8_t)s_ScriptLen;
+    memcpy(cb2 + n, s_Script, s_ScriptLen);
+    n += s_ScriptLen;
+    if (CommitmentLen) {
+        memset(cb2 + n, 0, 8);
+        n += 8;
+        cb2[n++] = (uint8_t)CommitmentLen;
+        memcpy(cb2 + n, p_Commitment, CommitmentLen);
+        n += CommitmentLen;
+    }
+    memset(cb2 + n, 0, 4);
+    n += 4;
+    p_Template->p_Coinbase2 = cb2;
+    p_Template->Coinbase2Len = (uint32_t)n;
+    p_Template->Witness = CommitmentLen > 0;
+    return PdqOk;
+}
+
+/* Walk the transactions array entry by entry: txids (header byte order)
+ * into p_Hashes, raw hex appended to the template */
+static PdqError_t ReadTransactions(char* p_Body, size_t Start, size_t End, GbtTemplate_t* p_Template,
+                                   uint8_t (**pp_Hashes)[32]) {
+    uint32_t cap = 64;
+    uint8_t (*hashes)[32] = (uint8_t (*)[32])malloc((size_t)(cap + 1) * 32);
+    size_t hexCap = 4096;
+    char* hex = (char*)malloc(hexCap);
+    if (!hashes || !hex) {
+        free(hashes);
+        free(hex);
+        return PdqErrorNoMemory;
+    }
+
+    PdqError_t err = PdqOk;
+    uint32_t count = 0;
+    size_t hexLen = 0;
+    size_t pos = SkipWs(p_Body, Start + 1, End);
+    while (pos < End && p_Body[pos] != ']') {
+        size_t entryEnd = ValueEnd(p_Body, pos, End);
+        PdqJsonDoc_t doc;
+        PdqJsonToken_t tokens[GBT_TX_TOKENS];
+        if (entryEnd == 0 ||
+            PdqJsonParse(&doc, p_Body + pos, entryEnd - pos, tokens, GBT_TX_TOKENS) != PdqOk) {
+            err = PdqErrorParse;
+            break;
+        }
+
+        int data = PdqJsonObjectGet(&doc, 0, "data");
+        uint8_t txid[32];
+        if (PdqJsonTypeOf(&doc, data) != PdqJsonString ||
+            PdqJsonGetHex(&doc, PdqJsonObjectGet(&doc, 0, "txid"), txid, 32) != 32) {
+            err = PdqErrorParse;
+            break;
+        }
+        size_t dataLen = tokens[data].End - tokens[data].Start;
+        const char* p_Data = p_Body + pos + tokens[data].Start;
+        for (size_t i = 0; i < dataLen && err == PdqOk; i++) {
+            if (HexDigit(p_Data[i]) < 0) err = PdqErrorParse;
+        }
+        if (err != PdqOk || dataLen == 0 || (dataLen & 1)) {
+            err = PdqErrorParse;
+            break;
+        }
+
+        if (count == cap) {
+            cap *= 2;
+            uint8_t (*grown)[32] = (uint8_t (*)[32])realloc(hashes, (size_t)(cap + 1) * 32);
+            if (!grown) {
+                err = PdqErrorNoMemory;
+                break;
+            }
+            hashes = grown;
+        }
+        for (int i = 0; i < 32; i++) hashes[count][i] = txid[31 - i];
+        count++;
+
+        if (hexLen + dataLen > hexCap) {
+            while (hexLen + dataLen > hexCap) hexCap *= 2;
+            char* grown = (char*)realloc(hex, hexCap);
+            if (!grown) {
+                err = PdqErrorNoMemory;
+                break;
+            }
+            hex = grown;
+        }
+        memcpy(hex + hexLen, p_Data, dataLen);
+        hexLen += dataLen;
+
+        pos = SkipWs(p_Body, entryEnd, End);
+        if (pos < End && p_Body[pos] == ',') pos = SkipWs(p_Body, pos + 1, End);
+    }
+    if (err == PdqOk && (pos >= End || p_Body[pos] != ']')) err = PdqErrorParse;
+    if (err != PdqOk) {
+        free(hashes);
+        free(hex);
+        return err;
+    }
+
+    p_Template->TxCount = count;
+    p_Template->p_TxHex = hex;
+    p_Template->TxHexLen = hexLen;
+    *pp_Hashes = hashes;
+    return PdqOk;
+}
+
+/* Everything a repeat of the same work would reproduce */
+static void Fingerprint(const GbtTemplate_t* p_Template, const uint8_t (*p_Hashes)[32], uint8_t* p_Out) {
+    PdqSha256Context_t sha;
+    PdqSha256Init(&sha);
+    PdqSha256Update(&sha, p_Template->PrevBlockHash, 32);
+    PdqSha256Update(&sha, (const uint8_t*)&p_Template->Version, sizeof(p_Template->Version));
+    PdqSha256Update(&sha, (const uint8_t*)&p_Template->NBits, sizeof(p_Template->NBits));
+    PdqSha256Update(&sha, (const uint8_t*)&p_Template->CoinbaseValue, sizeof(p_Template->CoinbaseValue));
+    PdqSha256Update(&sha, (const uint8_t*)p_Hashes, (size_t)p_Template->TxCount * 32);
+    PdqSha256Final(&sha, p_Out);
+}
+
+/* Decode a getblocktemplate result and make it the current template.
+ * Returns PdqOk for a repeat of the current one as well, installing
+ * nothing; *p_Installed tells the two apart. */
+static PdqError_t InstallTemplate(char* p_Body, size_t Start, size_t End, bool* p_Installed) {
+    *p_Installed = false;
+    if (p_Body[Start] != '{') return PdqErrorParse;
+
+    GbtTemplate_t t;
+    memset(&t, 0, sizeof(t));
+    uint8_t (*hashes)[32] = NULL;
+
+    size_t txStart, txEnd;
+    if (!FindMember(p_Body, Start, End, "transactions", &txStart, &txEnd) || p_Body[txStart] != '[') {
+        return PdqErrorParse;
+    }
+    PdqError_t err = ReadTransactions(p_Body, txStart, txEnd, &t, &hashes);
+    if (err != PdqOk) return err;
+
+    /* With the transactions out of the way the rest is a few dozen tokens */
+    memset(p_Body + txStart + 1, ' ', txEnd - txStart - 2);
+    PdqJsonDoc_t doc;
+    int64_t version = 0, value = 0, curTime = 0, height = 0;
+    uint8_t prev[32];
+    uint8_t commitment[GBT_COMMITMENT_MAX];
+    int32_t commitmentLen = 0;
+    err = PdqJsonParse(&doc, p_Body + Start, End - Start, s_Tokens, GBT_MAX_TOKENS);
+    if (err == PdqOk &&
+        (!PdqJsonGetInt(&doc, PdqJsonObjectGet(&doc, 0, "version"), &version) ||
+         !PdqJsonGetInt(&doc, PdqJsonObjectGet(&doc, 0, "coinbasevalue"), &value) ||
+         !PdqJsonGetInt(&doc, PdqJsonObjectGet(&doc, 0, "curtime"), &curTime) ||
+         !PdqJsonGetInt(&doc, PdqJsonObjectGet(&doc, 0, "height"), &height) ||
+         !PdqJsonGetHexU32(&doc, PdqJsonObjectGet(&doc, 0, "bits"), &t.NBits) ||
+         PdqJsonGetHex(&doc, PdqJsonObjectGet(&doc, 0, "previousblockhash"), prev, 32) != 32 ||
+         value < 0 || height < 0 || height > 0x7fffffff || curTime < 0)) {
+        err = PdqErrorParse;
+    }
+    int witness = err == PdqOk ? PdqJsonObjectGet(&doc, 0, "default_witness_commitment") : -1;
+    if (witness >= 0) {
+        commitmentLen = PdqJsonGetHex(&doc, witness, commitment, sizeof(commitment));
+        if (commitmentLen <= 0) err = PdqErrorParse;
+    }
+    if (err != PdqOk) {
+        free(hashes);
+        FreeTemplate(&t);
+        return PdqErrorParse;
+    }
+
+    t.Version = (uint32_t)version;
+    t.CoinbaseValue = (uint64_t)value;
+    t.CurTime = (uint32_t)curTime;
+    t.Height = (uint32_t)height;
+    for (int i = 0; i < 32; i++) t.PrevBlockHash[i] = prev[31 - i];
+
+    /* A template the node sends again unchanged (polling) is not news */
+    Fingerprint(&t, (const uint8_t (*)[32])hashes, t.Fingerprint);
+    GbtTemplate_t* p_Current = s_Current >= 0 ? &s_Templates[s_Current] : NULL;
+    if (p_Current && memcmp(p_Current->Fingerprint, t.Fingerprint, 32) == 0) {
+        free(hashes);
+        FreeTemplate(&t);
+        return PdqOk;
+    }
+
+    /* 2^16 branches would be a block of 2^65535 transactions */
+    t.p_Branches = (uint8_t (*)[32])malloc(32 * 32);
+    if (!t.p_Branches || BuildCoinbase(&t, commitment, (size_t)commitmentLen) != PdqOk) {
+        free(hashes);
+        FreeTemplate(&t);
+        return PdqErrorNoMemory;
+    }
+    t.BranchCount = BuildBranches(hashes, t.TxCount, t.p_Branches);
+    free(hashes);
+
+    bool clean = !p_Current || memcmp(p_Current->PrevBlockHash, t.PrevBlockHash, 32) != 0;
+    int slot = (s_Current + 1) % PDQ_GBT_TEMPLATES;
+    if (clean) {
+        /* Work on the old tip cannot become a block any more */
+        for (int i = 0; i < PDQ_GBT_TEMPLATES; i++) FreeTemplate(&s_Templates[i]);
+        slot = 0;
+    } else {
+        FreeTemplate(&s_Templates[slot]);
+    }
+    t.Id = ++s_TemplateSeq;
+    t.FetchedMs = GetMillis();
+    s_Templates[slot] = t;
+    s_Current = slot;
+    s_CleanPending |= clean;
+
+    s_Stats.Templates++;
+    s_Stats.Height = t.Height;
+    s_Stats.Transactions = t.TxCount;
+    s_Stats.CoinbaseValue = t.CoinbaseValue;
+    *p_Installed = true;
+
+    printf("[GBT] Template %08x: height %lu, %lu txs, %.8f BTC%s\n",
+           (unsigned)t.Id, (unsigned long)t.Height, (unsigned long)t.TxCount,
+           (double)t.CoinbaseValue / 100000000.0, clean ? ", new block" : "");
+    return PdqOk;
+}
+
+/* ---- RPC transport ---- */
+
+static const char s_Base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void Base64(const char* p_In, size_t Len, char* p_Out) {
+    const uint8_t* p = (const uint8_t*)p_In;
+    size_t i = 0;
+    for (; i + 2 < Len; i += 3) {
+        uint32_t v = ((uint32_t)p[i] << 16) | ((uint32_t)p[i + 1] << 8) | p[i + 2];
+        *p_Out++ = s_Base64[(v >> 18) & 63];
+        *p_Out++ = s_Base64[(v >> 12) & 63];
+        *p_Out++ = s_Base64[(v >> 6) & 63];
+        *p_Out++ = s_Base64[v & 63];
+    }
+    if (i < Len) {
+        uint32_t v = (uint32_t)p[i] << 16;
+        if (i + 1 < Len) v |= (uint32_t)p[i + 1] << 8;
+        *p_Out++ = s_Base64[(v >> 18) & 63];
+        *p_Out++ = s_Base64[(v >> 12) & 63];
+        *p_Out++ = (i + 1 < Len) ? s_Base64[(v >> 6) & 63] : '=';
+        *p_Out++ = '=';
+    }
+    *p_Out = '\0';
+}
+
+/* The Authorization header line, or "" without credentials. The cookie
+ * is read on every call: the node writes a new one each time it starts. */
+static bool BuildAuthHeader(char* p_Out, size_t Size) {
+    char cred[256];
+    size_t len = 0;
+    p_Out[0] = '\0';
+    if (s_Config.p_User) {
+        int n = snprintf(cred, sizeof(cred), "%s:%s", s_Config.p_User,
+                         s_Config.p_Password ? s_Config.p_Password : "");
+        if (n < 0 || (size_t)n >= sizeof(cred)) return false;
+        len = (size_t)n;
+    } else if (s_Config.p_CookieFile) {
+        FILE* f = fopen(s_Config.p_CookieFile, "r");
+        if (!f) {
+            printf("[GBT] Cannot read RPC cookie %s: %s\n", s_Config.p_CookieFile, strerror(errno));
+            return false;
+        }
+        len = fread(cred, 1, sizeof(cred) - 1, f);
+        fclose(f);
+        while (len > 0 && (cred[len - 1] == '\n' || cred[len - 1] == '\r')) len--;
+    } else {
+        return true;
+    }
+
+    char encoded[(sizeof(cred) + 2) / 3 * 4 + 1];
+    Base64(cred, len, encoded);
+    int n = snprintf(p_Out, Size, "Authorization: Basic %s\r\n", encoded);
+    return n > 0 && (size_t)n < Size;
+}
+
+static void RpcClose(RpcCall_t* p_Call) {
+    if (p_Call->Fd >= 0) {
+        PdqEventRemove(p_Call->Fd);
+        close(p_Call->Fd);
+        p_Call->Fd = -1;
+    }
+    free(p_Call->p_Out);
+    p_Call->p_Out = NULL;
+    free(p_Call->p_In);
+    p_Call->p_In = NULL;
+    p_Call->InLen = p_Call->InCap = 0;
+    p_Call->Busy = false;
+}
+
+/* Close the connection and hand the body on. The callback may start the
+ * next call on the same slot, so the reply buffer is detached first. */
+static void RpcFinish(RpcCall_t* p_Call, bool Complete) {
+    char* p_In = p_Call->p_In;
+    size_t inLen = p_Call->InLen;
+    size_t bodyStart = p_Call->BodyStart;
+    RpcDone_t done = p_Call->Done;
+    p_Call->p_In = NULL;
+    RpcClose(p_Call);
+
+    char* p_Body = NULL;
+    size_t bodyLen = 0;
+    if (Complete && p_In && bodyStart) {
+        int status = 0;
+        sscanf(p_In, "HTTP/%*d.%*d %d", &status);
+        /* Core answers RPC errors with 500 and the error in the body */
+        if (status == 200 || status == 500) {
+            p_Body = p_In + bodyStart;
+            bodyLen = inLen - bodyStart;
+            if (p_Call->ContentLength != SIZE_MAX && p_Call->ContentLength < bodyLen) {
+                bodyLen = p_Call->ContentLength;
+            }
+            p_Body[bodyLen] = '\0';
+        } else {
+            printf("[GBT] RPC refused: HTTP %d%s\n", status,
+                   status == 401 ? " (check the RPC credentials)" : "");
+        }
+    }
+    if (done) done(p_Call, p_Body, bodyLen);
+    free(p_In);
+}
+
+/* Note the end of the headers and the announced body length, once */
+static void RpcScanHeaders(RpcCall_t* p_Call) {
+    if (p_Call->BodyStart) return;
+    char* end = strstr(p_Call->p_In, "\r\n\r\n");
+    if (!end) return;
+    *end = '\0';
+    for (char* line = strstr(p_Call->p_In, "\r\n"); line; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+            p_Call->ContentLength = (size_t)strtoull(line + 17, NULL, 10);
+        }
+    }
+    *end = '\r';
+    p_Call->BodyStart = (size_t)(end - p_Call->p_In) + 4;
+}
+
+static void OnRpcEvent(int Fd, uint32_t Events, void* p_Arg) {
+    RpcCall_t* p_Call = (RpcCall_t*)p_Arg;
+    (void)Events;
+
+    if (!p_Call->Connected) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(Fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0) {
+            printf("[GBT] Cannot reach the node: %s\n", strerror(error ? error : errno));
+            RpcFinish(p_Call, false);
+            return;
+        }
+        p_Call->Connected = true;
+    }
+
+    if (p_Call->OutSent < p_Call->OutLen) {
+        ssize_t n = send(Fd, p_Call->p_Out + p_Call->OutSent, p_Call->OutLen - p_Call->OutSent, GBT_SEND_FLAGS);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            RpcFinish(p_Call, false);
+            return;
+        }
+        if (n > 0) p_Call->OutSent += (size_t)n;
+        if (p_Call->OutSent == p_Call->OutLen) {
+            free(p_Call->p_Out);
+            p_Call->p_Out = NULL;
+            PdqEventModify(Fd, PDQ_EVENT_READ);
+        }
+        return;
+    }
+
+    for (;;) {
+        if (p_Call->InCap - p_Call->InLen < GBT_READ_CHUNK + 1) {
+            size_t cap = p_Call->InCap ? p_Call->InCap * 2 : 4 * GBT_READ_CHUNK;
+            if (cap > PDQ_GBT_MAX_RESPONSE + GBT_READ_CHUNK + 1) {
+                printf("[GBT] RPC reply over %u bytes, dropped\n", (unsigned)PDQ_GBT_MAX_RESPONSE);
+                RpcFinish(p_Call, false);
+                return;
+            }
+            char* grown = (char*)realloc(p_Call->p_In, cap);
+            if (!grown) {
+                RpcFinish(p_Call, false);
+                return;
+            }
+            p_Call->p_In = grown;
+            p_Call->InCap = cap;
+        }
+        ssize_t n = recv(Fd, p_Call->p_In + p_Call->InLen, p_Call->InCap - p_Call->InLen - 1, 0);
+        if (n > 0) {
+            p_Call->InLen += (size_t)n;
+            p_Call->p_In[p_Call->InLen] = '\0';
+            continue;
+        }
+        if (n == 0) {
+            RpcScanHeaders(p_Call);
+            RpcFinish(p_Call, true);
+            return;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        RpcFinish(p_Call, false);
+        return;
+    }
+
+    RpcScanHeaders(p_Call);
+    if (p_Call->BodyStart && p_Call->ContentLength != SIZE_MAX &&
+        p_Call->InLen - p_Call->BodyStart >= p_Call->ContentLength) {
+        RpcFinish(p_Call, true);
+    }
+}
+
+/* POST p_Body to the node on a fresh connection */
+static PdqError_t RpcStart(RpcCall_t* p_Call, const char* p_Body, size_t BodyLen,
+                           uint32_t TimeoutMs, RpcDone_t Done) {
+    char auth[512];
+    if (!BuildAuthHeader(auth, sizeof(auth))) return PdqErrorAuthFailed;
+
+    char head[768];
+    int headLen = snprintf(head, sizeof(head),
+                           "POST / HTTP/1.1\r\n"
+                           "Host: %s\r\n"
+                           "%s"
+                           "Content-Type: application/json\r\n"
+                           "Content-Length: %lu\r\n"
+                           "Connection: close\r\n\r\n",
+                           s_HostHeader, auth, (unsigned long)BodyLen);
+    if (headLen < 0 || (size_t)headLen >= sizeof(head)) return PdqErrorBufferTooSmall;
+
+    memset(p_Call, 0, sizeof(*p_Call));
+    p_Call->Fd = -1;
+    p_Call->ContentLength = SIZE_MAX;
+    p_Call->p_Out = (char*)malloc((size_t)headLen + BodyLen);
+    if (!p_Call->p_Out) return PdqErrorNoMemory;
+    memcpy(p_Call->p_Out, head, (size_t)headLen);
+    memcpy(p_Call->p_Out + headLen, p_Body, BodyLen);
+    p_Call->OutLen = (size_t)headLen + BodyLen;
+
+    int fd = socket(s_Addr.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        RpcClose(p_Call);
+        return PdqErrorNotConnected;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    p_Call->Fd = fd;
+
+    if ((connect(fd, (struct sockaddr*)&s_Addr, s_AddrLen) != 0 && errno != EINPROGRESS) ||
+        PdqEventAdd(fd, PDQ_EVENT_WRITE, OnRpcEvent, p_Call) != PdqOk) {
+        printf("[GBT] Cannot reach the node: %s\n", strerror(errno));
+        RpcClose(p_Call);
+        return PdqErrorNotConnected;
+    }
+    p_Call->Busy = true;
+    p_Call->Done = Done;
+    p_Call->StartMs = GetMillis();
+    p_Call->DeadlineMs = TimeoutMs ? p_Call->StartMs + TimeoutMs : 0;
+    return PdqOk;
+}
+
+/* ---- Template fetches ---- */
+
+static void OnTemplate(RpcCall_t* p_Call, char* p_Body, size_t Len);
+
+static void RequestTemplate(bool LongPoll) {
+    char body[256 + GBT_LONGPOLL_ID_MAX];
+    int len;
+    if (LongPoll) {
+        len = snprintf(body, sizeof(body),
+                       "{\"jsonrpc\":\"1.0\",\"id\":\"pdq\",\"method\":\"getblocktemplate\","
+                       "\"params\":[{\"rules\":[\"segwit\"],\"longpollid\":\"%s\"}]}", s_LongPollId);
+    } else {
+        len = snprintf(body, sizeof(body),
+                       "{\"jsonrpc\":\"1.0\",\"id\":\"pdq\",\"method\":\"getblocktemplate\","
+                       "\"params\":[{\"rules\":[\"segwit\"]}]}");
+    }
+
+    s_LongPolling = LongPoll;
+    if (RpcStart(&s_TemplateCall, body, (size_t)len, LongPoll ? 0 : PDQ_GBT_RPC_TIMEOUT_MS, OnTemplate) != PdqOk) {
+        s_Stats.RpcErrors++;
+        s_Ready = false;
+        s_NextFetchMs = GetMillis() + PDQ_GBT_RETRY_MS;
+    }
+}
+
+/* Keep the node's longpollid if it is safe to echo back unescaped */
+static void TakeLongPollId(const char* p_Body, size_t Start, size_t End) {
+    size_t idStart, idEnd;
+    s_LongPollId[0] = '\0';
+    if (!FindMember(p_Body, Start, End, "longpollid", &idStart, &idEnd) || p_Body[idStart] != '"') return;
+    size_t len = idEnd - idStart - 2;
+    if (len == 0 || len > GBT_LONGPOLL_ID_MAX) return;
+    for (size_t i = 0; i < len; i++) {
+        char c = p_Body[idStart + 1 + i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) return;
+    }
+    memcpy(s_LongPollId, p_Body + idStart + 1, len);
+    s_LongPollId[len] = '\0';
+}
+
+static void OnTemplate(RpcCall_t* p_Call, char* p_Body, size_t Len) {
+    uint64_t now = GetMillis();
+    bool wasLongPoll = s_LongPolling;
+    s_LongPolling = false;
+    if (!s_Running) return;
+
+    size_t start, end;
+    bool installed = false;
+    PdqError_t err = PdqErrorNotConnected;
+    if (p_Body && SplitReply("getblocktemplate", p_Body, Len, &start, &end)) {
+        TakeLongPollId(p_Body, start, end);
+        err = InstallTemplate(p_Body, start, end, &installed);
+        if (err != PdqOk) printf("[GBT] Unusable template\n");
+    }
+
+    if (err != PdqOk) {
+        /* A longpoll the node (or rpcservertimeout) cut off after a
+         * while is routine: fetch afresh at once, which resumes it */
+        if (wasLongPoll && !p_Body && now - p_Call->StartMs >= GBT_LONGPOLL_MIN_MS) {
+            RequestTemplate(false);
+            return;
+        }
+        s_Stats.RpcErrors++;
+        s_Ready = false;
+        s_NextFetchMs = now + PDQ_GBT_RETRY_MS;
+        return;
+    }
+
+    if (!s_Ready) printf("[GBT] Node ready on %s\n", s_HostHeader);
+    s_Ready = true;
+    if (installed) {
+        if (wasLongPoll) s_Stats.LongPolls++;
+        s_NewJob = true;
+        if (s_OnJob) s_OnJob(s_CallbackArg);
+    }
+    if (s_LongPollId[0]) {
+        RequestTemplate(true);
+    } else {
+        s_NextFetchMs = now + (s_Config.PollMs ? s_Config.PollMs : PDQ_GBT_POLL_MS);
+    }
+}
+
+/* ---- Block submission ---- */
+
+static void OnSubmitted(RpcCall_t* p_Call, char* p_Body, size_t Len);
+
+static void StartNextSubmit(void) {
+    while (s_SubmitCount > 0 && !s_SubmitCall.Busy) {
+        GbtSubmit_t next = s_Submits[0];
+        s_SubmitCount--;
+        memmove(&s_Submits[0], &s_Submits[1], s_SubmitCount * sizeof(s_Submits[0]));
+        s_SubmitStartMs = next.QueuedMs;
+        PdqError_t err = RpcStart(&s_SubmitCall, next.p_Body, next.Len, PDQ_GBT_RPC_TIMEOUT_MS, OnSubmitted);
+        free(next.p_Body);
+        if (err != PdqOk) {
+            s_Stats.BlocksRejected++;
+            if (s_OnSubmit) s_OnSubmit(s_CallbackArg, PdqSubmitTimedOut, -1, (uint32_t)(GetMillis() - next.QueuedMs));
+        }
+    }
+}
+
+static void OnSubmitted(RpcCall_t* p_Call, char* p_Body, size_t Len) {
+    (void)p_Call;
+    uint32_t latency = (uint32_t)(GetMillis() - s_SubmitStartMs);
+    PdqSubmitResult_t result = PdqSubmitTimedOut;
+
+    size_t start, end;
+    if (p_Body && SplitReply("submitblock", p_Body, Len, &start, &end)) {
+        /* null is acceptance; anything else is the reason it was not */
+        if (IsNull(p_Body, start, end)) {
+            result = PdqSubmitAccepted;
+            printf("[GBT] *** BLOCK ACCEPTED *** (%lu ms)\n", (unsigned long)latency);
+        } else {
+            result = PdqSubmitRejected;
+            printf("[GBT] Block rejected: %.*s\n", (int)(end - start), p_Body + start);
+        }
+    } else if (p_Body) {
+        result = PdqSubmitRejected;
+    }
+
+    if (result == PdqSubmitAccepted) {
+        s_Stats.BlocksAccepted++;
+    } else {
+        s_Stats.BlocksRejected++;
+    }
+    if (s_OnSubmit) s_OnSubmit(s_CallbackArg, result, result == PdqSubmitAccepted ? 0 : -1, latency);
+
+    /* Our own block moved the tip; without a longpoll, ask at once */
+    if (s_Running && !s_TemplateCall.Busy) RequestTemplate(false);
+    StartNextSubmit();
+}
+
+/* The block for a share as submitblock hex inside its JSON-RPC request */
+static char* BuildSubmit(const GbtTemplate_t* p_Template, const uint8_t* p_Header,
+                         const uint8_t* p_Extranonce2, size_t* p_Len) {
+    static const char s_Head[] = "{\"jsonrpc\":\"1.0\",\"id\":\"pdq\",\"method\":\"submitblock\",\"params\":[\"";
+    static const char s_Tail[] = "\"]}";
+    size_t coinbaseLen = p_Template->Coinbase1Len + GBT_EXTRANONCE1_LEN + GBT_EXTRANONCE2_LEN +
+                         p_Template->Coinbase2Len + (p_Template->Witness ? 2 + 34 : 0);
+    size_t size = sizeof(s_Head) + 2 * (80 + 9 + coinbaseLen) + p_Template->TxHexLen + sizeof(s_Tail);
+    char* p_Out = (char*)malloc(size);
+    if (!p_Out) return NULL;
+
+    char* p = p_Out;
+    memcpy(p, s_Head, sizeof(s_Head) - 1);
+    p += sizeof(s_Head) - 1;
+    p = PutHex(p, p_Header, 80);
+    uint8_t count[9];
+    p = PutHex(p, count, PutVarInt(count, (uint64_t)p_Template->TxCount + 1));
+
+    /* The block carries the coinbase in its witness form: marker and
+     * flag after the version, the 32-byte reserved value the commitment
+     * was computed with before the locktime */
+    const uint8_t* cb1 = p_Template->p_Coinbase1;
+    const uint8_t* cb2 = p_Template->p_Coinbase2;
+    static const uint8_t s_MarkerFlag[2] = {0x00, 0x01};
+    static const uint8_t s_Reserved[34] = {0x01, 0x20};
+    p = PutHex(p, cb1, 4);
+    if (p_Template->Witness) p = PutHex(p, s_MarkerFlag, 2);
+    p = PutHex(p, cb1 + 4, p_Template->Coinbase1Len - 4);
+    p = PutHex(p, s_Extranonce1, GBT_EXTRANONCE1_LEN);
+    p = PutHex(p, p_Extranonce2, GBT_EXTRANONCE2_LEN);
+    p = PutHex(p, cb2, p_Template->Coinbase2Len - 4);
+    if (p_Template->Witness) p = PutHex(p, s_Reserved, sizeof(s_Reserved));
+    p = PutHex(p, cb2 + p_Template->Coinbase2Len - 4, 4);
+
+    memcpy(p, p_Template->p_TxHex, p_Template->TxHexLen);
+    p += p_Template->TxHexLen;
+    memcpy(p, s_Tail, sizeof(s_Tail) - 1);
+    p += sizeof(s_Tail) - 1;
+    *p_Len = (size_t)(p - p_Out);
+    return p_Out;
+}
+
+/* ---- Public API ---- */
+
+PdqError_t PdqGbtStart(const PdqGbtConfig_t* p_Config) {
+    if (!p_Config || !p_Config->p_Host || !p_Config->p_PayoutAddress) return PdqErrorInvalidParam;
+    if (s_Running) PdqGbtStop();
+
+    s_Config = *p_Config;
+    if (!s_Config.Port) s_Config.Port = PDQ_GBT_DEFAULT_PORT;
+    if (PdqGbtAddressToScript(s_Config.p_PayoutAddress, s_Script, &s_ScriptLen) != PdqOk) {
+        fprintf(stderr, "[GBT] Cannot pay to %s: not a valid Bitcoin address\n", s_Config.p_PayoutAddress);
+        return PdqErrorInvalidParam;
+    }
+    snprintf(s_Tag, sizeof(s_Tag), "%s", s_Config.p_CoinbaseTag ? s_Config.p_CoinbaseTag : GBT_DEFAULT_TAG);
+
+    /* Resolved once, blocking: the node is expected to be local */
+    char port[8];
+    snprintf(port, sizeof(port), "%u", (unsigned)s_Config.Port);
+    struct addrinfo hints, *p_Result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int rc = getaddrinfo(s_Config.p_Host, port, &hints, &p_Result);
+    if (rc != 0 || !p_Result) {
+        fprintf(stderr, "[GBT] Cannot resolve %s: %s\n", s_Config.p_Host, gai_strerror(rc));
+        return PdqErrorNotConnected;
+    }
+    memcpy(&s_Addr, p_Result->ai_addr, p_Result->ai_addrlen);
+    s_AddrLen = (socklen_t)p_Result->ai_addrlen;
+    freeaddrinfo(p_Result);
+    snprintf(s_HostHeader, sizeof(s_HostHeader), "%s:%u", s_Config.p_Host, (unsigned)s_Config.Port);
+
+    memset(&s_Stats, 0, sizeof(s_Stats));
+    uint32_t seed = ((uint32_t)GetMillis() ^ ((uint32_t)getpid() * 2654435761u)) | 1;
+    seed ^= (uint32_t)time(NULL) * 0x9e3779b9u;
+    PutLe32(s_Extranonce1, seed);
+    s_Extranonce2 = 0;
+    s_Current = -1;
+    s_NewJob = false;
+    s_CleanPending = false;
+    s_LongPollId[0] = '\0';
+    s_Ready = false;
+    s_Running = true;
+
+    printf("[GBT] Solo mining on %s, paying %s\n", s_HostHeader, s_Config.p_PayoutAddress);
+    RequestTemplate(false);
+    return PdqOk;
+}
+
+void PdqGbtStop(void) {
+    s_Running = false;
+    s_TemplateCall.Done = NULL;
+    s_SubmitCall.Done = NULL;
+    RpcClose(&s_TemplateCall);
+    RpcClose(&s_SubmitCall);
+    for (uint8_t i = 0; i < s_SubmitCount; i++) free(s_Submits[i].p_Body);
+    s_SubmitCount = 0;
+    for (int i = 0; i < PDQ_GBT_TEMPLATES; i++) FreeTemplate(&s_Templates[i]);
+    s_Current = -1;
+    s_NewJob = false;
+    s_Ready = false;
+    s_NextFetchMs = 0;
+}
+
+void PdqGbtSetCallbacks(PdqGbtJobCallback_t OnJob, PdqStratumSubmitCallback_t OnSubmit, void* p_Arg) {
+    s_OnJob = OnJob;
+    s_OnSubmit = OnSubmit;
+    s_CallbackArg = p_Arg;
+}
+
+bool PdqGbtIsReady(void) {
+    return s_Running && s_Ready && s_Current >= 0;
+}
+
+bool PdqGbtHasNewJob(void) {
+    return s_Running && s_NewJob && s_Current >= 0;
+}
+
+PdqError_t PdqGbtBuildNextJob(PdqMiningJob_t* p_Job, bool* p_Clean) {
+    if (!p_Job) return PdqErrorInvalidParam;
+    if (s_Current < 0) return PdqErrorInvalidJob;
+
+    const GbtTemplate_t* p_Template = &s_Templates[s_Current];
+    PdqStratumJob_t job;
+    TemplateToJob(p_Template, &job);
+
+    /* The template's clock, moved on by the time it has been held */
+    job.NTime += (uint32_t)((GetMillis() - p_Template->FetchedMs) / 1000);
+
+    PdqError_t err = PdqStratumBuildMiningJob(&job, s_Extranonce1, GBT_EXTRANONCE1_LEN,
+                                              s_Extranonce2++, GBT_EXTRANONCE2_LEN, 1.0, p_Job);
+    if (err != PdqOk) return err;
+    memcpy(p_Job->Target, p_Job->NetworkTarget, sizeof(p_Job->Target));
+
+    if (p_Clean) *p_Clean = s_CleanPending;
+    s_CleanPending = false;
+    s_NewJob = false;
+    s_LastJobMs = GetMillis();
+    return PdqOk;
+}
+
+PdqError_t PdqGbtSubmitBlock(const PdqShareInfo_t* p_Share) {
+    if (!p_Share || !s_Running) return PdqErrorInvalidParam;
+    const GbtTemplate_t* p_Template = FindTemplate(p_Share->JobId);
+    if (!p_Template) {
+        printf("[GBT] Block on retired template %s dropped\n", p_Share->JobId);
+        return PdqErrorInvalidParam;
+    }
+
+    PdqStratumJob_t job;
+    TemplateToJob(p_Template, &job);
+    uint8_t extranonce2[GBT_EXTRANONCE2_LEN];
+    PutLe32(extranonce2, p_Share->Extranonce2);
+    uint8_t header[80];
+    PdqStratumBuildHeader(&job, s_Extranonce1, GBT_EXTRANONCE1_LEN, extranonce2, GBT_EXTRANONCE2_LEN, header);
+    PutLe32(header + 68, p_Share->NTime);
+    PutLe32(header + 76, p_Share->Nonce);
+
+    uint32_t hash[8], target[8];
+    PdqTargetHashHeader(header, hash);
+    if (PdqTargetFromNBits(p_Template->NBits, target) != PdqOk || PdqTargetCompare(hash, target) > 0) {
+        printf("[GBT] Share above the network target, not submitted\n");
+        return PdqErrorInvalidParam;
+    }
+
+    if (s_SubmitCount == PDQ_GBT_SUBMIT_QUEUE) return PdqErrorBufferTooSmall;
+    size_t len = 0;
+    char* p_Body = BuildSubmit(p_Template, header, extranonce2, &len);
+    if (!p_Body) return PdqErrorNoMemory;
+
+    s_Submits[s_SubmitCount].p_Body = p_Body;
+    s_Submits[s_SubmitCount].Len = len;
+    s_Submits[s_SubmitCount].QueuedMs = GetMillis();
+    s_SubmitCount++;
+    s_Stats.BlocksSubmitted++;
+    printf("[GBT] Submitting block at height %lu (%lu txs)\n",
+           (unsigned long)p_Template->Height, (unsigned long)p_Template->TxCount + 1);
+    StartNextSubmit();
+    return PdqOk;
+}
+
+void PdqGbtTick(uint64_t NowMs) {
+    if (!s_Running) return;
+
+    if (s_TemplateCall.Busy && s_TemplateCall.DeadlineMs && NowMs >= s_TemplateCall.DeadlineMs) {
+        printf("[GBT] getblocktemplate timed out\n");
+        RpcFinish(&s_TemplateCall, false);
+    }
+    if (s_SubmitCall.Busy && s_SubmitCall.DeadlineMs && NowMs >= s_SubmitCall.DeadlineMs) {
+        printf("[GBT] submitblock timed out\n");
+        RpcFinish(&s_SubmitCall, false);
+    }
+    if (!s_TemplateCall.Busy && s_NextFetchMs && NowMs >= s_NextFetchMs) {
+        s_NextFetchMs = 0;
+        RequestTemplate(false);
+    }
+
+    /* Like a pool's periodic notify: fresh extranonce2, fresh ntime */
+    if (s_Current >= 0 && !s_NewJob && NowMs - s_LastJobMs >= PDQ_GBT_REFRESH_MS) {
+        s_NewJob = true;
+        if (s_OnJob) s_OnJob(s_CallbackArg);
+    }
+}
+
+void PdqGbtGetStats(PdqGbtStats_t* p_Stats) {
+    if (p_Stats) *p_Stats = s_Stats;
+}
+
+double PdqGbtGetDifficulty(void) {
+    uint32_t target[8];
+    if (s_Current < 0 || PdqTargetFromNBits(s_Templates[s_Current].NBits, target) != PdqOk) return 0.0;
+    return PdqTargetToDifficulty(target);
+}
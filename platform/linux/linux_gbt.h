@@ -0,0 +1,108 @@
+/**
+ * @file linux_gbt.h
+ * @brief Solo mining from a local bitcoind via getblocktemplate
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Takes work straight from a Bitcoin Core node over JSON-RPC instead of
+ * a pool. Templates are fetched with getblocktemplate and, when the node
+ * offers a longpollid, kept current with long polling; otherwise the
+ * node is polled. Each template becomes a job the way a Stratum notify
+ * does: this module builds the coinbase (BIP34 height, an 8-byte
+ * extranonce, the payout and the segwit witness commitment) and the
+ * merkle branches, so the job goes through PdqStratumBuildMiningJob and
+ * the miners cannot tell the difference.
+ *
+ * A share found on such a job meets the network target, and is sent to
+ * the node with submitblock as soon as it is handed over.
+ *
+ * RPC calls are non-blocking HTTP/1.1 on the event loop, one connection
+ * per call. All functions must be called from the thread that runs the
+ * event loop.
+ */
+
+#ifndef PDQ_LINUX_GBT_H
+#define PDQ_LINUX_GBT_H
+
+#include "pdq_types.h"
+#include "stratum/stratum_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_GBT_DEFAULT_PORT        8332
+#define PDQ_GBT_POLL_MS             5000    /* Template refresh without longpoll */
+#define PDQ_GBT_REFRESH_MS          30000   /* New extranonce on an unchanged template */
+#define PDQ_GBT_RPC_TIMEOUT_MS      30000   /* Any call but a longpoll */
+#define PDQ_GBT_RETRY_MS            5000    /* After a failed template fetch */
+#define PDQ_GBT_TEMPLATES           4       /* Templates still accepted for submit */
+#define PDQ_GBT_SUBMIT_QUEUE        4       /* Blocks waiting for the submit connection */
+#define PDQ_GBT_MAX_RESPONSE        (64u * 1024u * 1024u)
+#define PDQ_GBT_TAG_MAX             32      /* Coinbase tag bytes */
+#define PDQ_GBT_SCRIPT_MAX          42      /* Longest payout scriptPubKey */
+
+typedef struct {
+    const char* p_Host;             /* Address or name of the node */
+    uint16_t    Port;               /* 0 for PDQ_GBT_DEFAULT_PORT */
+    const char* p_User;             /* rpcuser/rpcpassword, or NULL ... */
+    const char* p_Password;
+    const char* p_CookieFile;       /* ... to read the node's .cookie on each call */
+    const char* p_PayoutAddress;    /* The coinbase pays its whole value here */
+    const char* p_CoinbaseTag;      /* NULL for "/PDQminer/" */
+    uint32_t    PollMs;             /* 0 for PDQ_GBT_POLL_MS */
+} PdqGbtConfig_t;
+
+typedef struct {
+    uint32_t Templates;             /* Accepted from the node */
+    uint32_t LongPolls;             /* Of those, delivered by a longpoll */
+    uint32_t RpcErrors;             /* Failed or refused template fetches */
+    uint32_t Height;                /* Of the block being mined */
+    uint32_t Transactions;          /* In the current template, coinbase excluded */
+    uint64_t CoinbaseValue;         /* Satoshis */
+    uint32_t BlocksSubmitted;
+    uint32_t BlocksAccepted;
+    uint32_t BlocksRejected;        /* Refused by the node, or the call failed */
+} PdqGbtStats_t;
+
+/* A new template (or a refresh of the current one) is ready to build */
+typedef void (*PdqGbtJobCallback_t)(void* p_Arg);
+
+PdqError_t PdqGbtStart(const PdqGbtConfig_t* p_Config);
+void       PdqGbtStop(void);
+
+/* OnSubmit gets one call per PdqGbtSubmitBlock that returned PdqOk:
+ * PdqSubmitAccepted when the node took the block, PdqSubmitRejected when
+ * it named a reason, PdqSubmitTimedOut when the call failed */
+void       PdqGbtSetCallbacks(PdqGbtJobCallback_t OnJob, PdqStratumSubmitCallback_t OnSubmit, void* p_Arg);
+
+/* A template is in hand and the node answered the last fetch */
+bool       PdqGbtIsReady(void);
+bool       PdqGbtHasNewJob(void);
+
+/* Job for the latest template with the next extranonce2; its share
+ * target is the network target. p_Clean reports a new previous block. */
+PdqError_t PdqGbtBuildNextJob(PdqMiningJob_t* p_Job, bool* p_Clean);
+
+/* Assemble the block for a share and submitblock it. PdqErrorInvalidParam
+ * for a share that misses the network target or names no known template. */
+PdqError_t PdqGbtSubmitBlock(const PdqShareInfo_t* p_Share);
+
+/* Polling, RPC timeouts and extranonce refresh; call about once a second */
+void       PdqGbtTick(uint64_t NowMs);
+
+void       PdqGbtGetStats(PdqGbtStats_t* p_Stats);
+
+/* Network difficulty of the current template, 0 without one */
+double     PdqGbtGetDifficulty(void);
+
+/* scriptPubKey for a base58check (P2PKH, P2SH) or bech32/bech32m
+ * (segwit v0, v1+) address on mainnet, testnet, signet or regtest.
+ * p_Script holds PDQ_GBT_SCRIPT_MAX bytes. */
+PdqError_t PdqGbtAddressToScript(const char* p_Address, uint8_t* p_Script, size_t* p_Len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,477 @@
+/**
+ * @file linux_http.c
+ * @brief Non-blocking HTTP/1.1 server implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Clients live in a small fixed table. A client with a response still
+ * going out is watched for writability only, so it cannot queue more
+ * work until it reads what it asked for; pipelined requests wait in its
+ * input buffer meanwhile. Responses are sent straight from the shared
+ * render buffer, and only the part the socket would not take is copied
+ * to the client.
+ */
+
+#include "linux_http.h"
+#include "linux_event.h"
+#include "api/device_api.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifdef MSG_NOSIGNAL
+#define HTTP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define HTTP_SEND_FLAGS 0
+#endif
+
+#define HTTP_ACCEPT_BATCH   16
+#define HTTP_HEAD_MAX       256     /* Status line and response headers */
+#define HTTP_TICK_MS        1000
+
+typedef struct {
+    int      Fd;                    /* -1 for a free slot */
+    char     In[PDQ_HTTP_REQUEST_MAX];
+    uint32_t InLen;
+    char*    p_Out;                 /* Unsent rest of the response */
+    uint32_t OutLen;
+    uint32_t OutSent;
+    bool     CloseAfter;            /* Once the response is out */
+    uint64_t DeadlineMs;
+} HttpClient_t;
+
+static bool           s_Running = false;
+static int            s_ListenFd = -1;
+static int            s_TimerId = -1;
+static uint16_t       s_Port = 0;
+static PdqHttpStats_t s_Stats;
+static HttpClient_t   s_Clients[PDQ_HTTP_MAX_CLIENTS];
+static char           s_Head[PDQ_HTTP_REQUEST_MAX + 1];    /* Parsed copy of one request head */
+static char           s_Body[PDQ_HTTP_RESPONSE_MAX];
+
+static uint64_t GetMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static const char* Reason(int Status) {
+    switch (Status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Content Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        case 505: return "HTTP Version Not Supported";
+        default:  return "Internal Server Error";
+    }
+}
+
+/* ---- Connections ---- */
+
+static void CloseClient(HttpClient_t* c) {
+    if (c->Fd < 0) return;
+    PdqEventRemove(c->Fd);
+    close(c->Fd);
+    free(c->p_Out);
+    c->Fd = -1;
+    c->p_Out = NULL;
+    c->InLen = 0;
+    c->OutLen = 0;
+    c->OutSent = 0;
+    s_Stats.Clients--;
+}
+
+static void WatchClient(HttpClient_t* c) {
+    PdqEventModify(c->Fd, c->OutLen ? PDQ_EVENT_WRITE : PDQ_EVENT_READ);
+}
+
+/* Send the queued rest; false if the connection failed */
+static bool FlushClient(HttpClient_t* c) {
+    while (c->OutSent < c->OutLen) {
+        ssize_t n = send(c->Fd, c->p_Out + c->OutSent, c->OutLen - c->OutSent, HTTP_SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        c->OutSent += (uint32_t)n;
+        c->DeadlineMs = GetMillis() + PDQ_HTTP_IDLE_MS;
+    }
+    free(c->p_Out);
+    c->p_Out = NULL;
+    c->OutLen = 0;
+    c->OutSent = 0;
+    return true;
+}
+
+/* Write head and body as far as the socket takes them and keep a copy of
+ * the rest */
+static void Respond(HttpClient_t* c, int Status, const char* p_Type, const char* p_Body, size_t Len) {
+    char head[HTTP_HEAD_MAX];
+    int headLen = snprintf(head, sizeof(head),
+                           "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\n"
+                           "Cache-Control: no-store\r\nConnection: %s\r\n\r\n",
+                           Status, Reason(Status), p_Type, (unsigned long)Len,
+                           c->CloseAfter ? "close" : "keep-alive");
+    if (headLen < 0 || headLen >= (int)sizeof(head)) {
+        CloseClient(c);
+        return;
+    }
+
+    struct iovec iov[2] = {{head, (size_t)headLen}, {(void*)p_Body, Len}};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    ssize_t n;
+    do {
+        n = sendmsg(c->Fd, &msg, HTTP_SEND_FLAGS);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        CloseClient(c);
+        return;
+    }
+
+    size_t sent = n > 0 ? (size_t)n : 0;
+    size_t total = (size_t)headLen + Len;
+    c->DeadlineMs = GetMillis() + PDQ_HTTP_IDLE_MS;
+    if (sent == total) {
+        if (c->CloseAfter) CloseClient(c);
+        return;
+    }
+
+    c->p_Out = (char*)malloc(total - sent);
+    if (!c->p_Out) {
+        CloseClient(c);
+        return;
+    }
+    size_t headRest = sent < (size_t)headLen ? (size_t)headLen - sent : 0;
+    memcpy(c->p_Out, head + (size_t)headLen - headRest, headRest);
+    memcpy(c->p_Out + headRest, p_Body + (Len - (total - sent - headRest)), total - sent - headRest);
+    c->OutLen = (uint32_t)(total - sent);
+    c->OutSent = 0;
+    WatchClient(c);
+}
+
+static void RespondError(HttpClient_t* c, int Status, const char* p_Message) {
+    int len = snprintf(s_Body, sizeof(s_Body), "{\"error\":\"%s\"}", p_Message);
+    s_Stats.Errors++;
+    c->CloseAfter = true;
+    Respond(c, Status, "application/json", s_Body, (size_t)len);
+}
+
+/* ---- Requests ---- */
+
+/* Next header line of the copied head: splits "Name: value" in place and
+ * advances *pp_Pos. False at the end of the head. */
+static bool NextHeader(char** pp_Pos, char** pp_Name, char** pp_Value) {
+    char* line = *pp_Pos;
+    if (!*line) return false;
+    char* eol = strstr(line, "\r\n");
+    if (eol) {
+        *eol = '\0';
+        *pp_Pos = eol + 2;
+    } else {
+        *pp_Pos = line + strlen(line);
+    }
+    char* colon = strchr(line, ':');
+    if (!colon) {
+        *pp_Name = line;
+        *pp_Value = NULL;
+        return true;
+    }
+    *colon = '\0';
+    char* value = colon + 1;
+    while (*value == ' ' || *value == '\t') value++;
+    char* end = value + strlen(value);
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+    *pp_Name = line;
+    *pp_Value = value;
+    return true;
+}
+
+/* Answer the first request in c->In if it is complete. Returns the bytes
+ * it took, 0 if more are needed, or -1 once the connection is done for. */
+static int HandleRequest(HttpClient_t* c) {
+    char* end = (char*)memmem(c->In, c->InLen, "\r\n\r\n", 4);
+    if (!end) {
+        if (c->InLen == sizeof(c->In)) {
+            RespondError(c, 431, "request head too large");
+            return -1;
+        }
+        return 0;
+    }
+    uint32_t headLen = (uint32_t)(end - c->In) + 4;
+    memcpy(s_Head, c->In, headLen - 2);
+    s_Head[headLen - 2] = '\0';
+
+    /* Request line: METHOD SP target SP version */
+    char* pos = s_Head;
+    char* line = pos;
+    char* eol = strstr(pos, "\r\n");
+    *eol = '\0';
+    pos = eol + 2;
+    char* method = line;
+    char* target = strchr(method, ' ');
+    char* version = target ? strchr(target + 1, ' ') : NULL;
+    if (!target || !version) {
+        RespondError(c, 400, "bad request line");
+        return -1;
+    }
+    *target++ = '\0';
+    *version++ = '\0';
+    if (strcmp(version, "HTTP/1.1") == 0) {
+        c->CloseAfter = false;
+    } else if (strcmp(version, "HTTP/1.0") == 0) {
+        c->CloseAfter = true;
+    } else {
+        RespondError(c, 505, "HTTP/1.x only");
+        return -1;
+    }
+    char* query = strchr(target, '?');
+    if (query) *query = '\0';
+
+    const char* auth = NULL;
+    unsigned long bodyLen = 0;
+    char* name;
+    char* value;
+    while (NextHeader(&pos, &name, &value)) {
+        if (!value) {
+            RespondError(c, 400, "bad header");
+            return -1;
+        }
+        if (strcasecmp(name, "Content-Length") == 0) {
+            char* num;
+            bodyLen = strtoul(value, &num, 10);
+            if (*num || !isdigit((unsigned char)value[0])) {
+                RespondError(c, 400, "bad content length");
+                return -1;
+            }
+        } else if (strcasecmp(name, "Transfer-Encoding") == 0) {
+            RespondError(c, 501, "chunked bodies not supported");
+            return -1;
+        } else if (strcasecmp(name, "Authorization") == 0) {
+            auth = value;
+        } else if (strcasecmp(name, "Connection") == 0) {
+            if (strcasecmp(value, "close") == 0) c->CloseAfter = true;
+            if (strcasecmp(value, "keep-alive") == 0) c->CloseAfter = false;
+        }
+    }
+    if (bodyLen > sizeof(c->In) - headLen) {
+        RespondError(c, 413, "request body too large");
+        return -1;
+    }
+    if (c->InLen < headLen + bodyLen) return 0;
+
+    PdqApiRequest_t req;
+    PdqApiResponse_t resp;
+    req.p_Method = method;
+    req.p_Path = target;
+    req.p_Authorization = auth;
+    req.p_Body = c->In + headLen;
+    req.BodyLen = bodyLen;
+    req.NowMs = GetMillis();
+    PdqApiHandle(&req, s_Body, sizeof(s_Body), &resp);
+    s_Stats.Requests++;
+    Respond(c, resp.Status, resp.p_ContentType, s_Body, resp.Len);
+    return c->Fd >= 0 ? (int)(headLen + bodyLen) : -1;
+}
+
+/* Answer buffered requests in order while nothing is waiting to go out */
+static void HandleRequests(HttpClient_t* c) {
+    while (c->Fd >= 0 && c->OutLen == 0 && c->InLen > 0) {
+        int used = HandleRequest(c);
+        if (used < 0) {
+            if (c->Fd >= 0 && c->OutLen == 0) CloseClient(c);
+            return;
+        }
+        if (used == 0) return;
+        c->InLen -= (uint32_t)used;
+        memmove(c->In, c->In + used, c->InLen);
+        if (c->CloseAfter) c->InLen = 0;
+    }
+}
+
+static void ReadClient(HttpClient_t* c) {
+    while (c->InLen < sizeof(c->In)) {
+        ssize_t n = recv(c->Fd, c->In + c->InLen, sizeof(c->In) - c->InLen, 0);
+        if (n == 0) {
+            CloseClient(c);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                CloseClient(c);
+                return;
+            }
+            break;
+        }
+        c->InLen += (uint32_t)n;
+    }
+    HandleRequests(c);
+}
+
+static void OnClientEvent(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    HttpClient_t* c = (HttpClient_t*)p_Arg;
+
+    if (Events & PDQ_EVENT_ERROR) {
+        CloseClient(c);
+        return;
+    }
+    if (Events & PDQ_EVENT_WRITE) {
+        if (!FlushClient(c)) {
+            CloseClient(c);
+            return;
+        }
+        if (c->OutLen) return;
+        if (c->CloseAfter) {
+            CloseClient(c);
+            return;
+        }
+        WatchClient(c);
+        HandleRequests(c);
+        return;
+    }
+    if (Events & PDQ_EVENT_READ) ReadClient(c);
+}
+
+static void AddClient(int Fd) {
+    int one = 1;
+    fcntl(Fd, F_SETFL, fcntl(Fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(Fd, F_SETFD, FD_CLOEXEC);
+    setsockopt(Fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    HttpClient_t* c = NULL;
+    for (int i = 0; i < PDQ_HTTP_MAX_CLIENTS && !c; i++) {
+        if (s_Clients[i].Fd < 0) c = &s_Clients[i];
+    }
+    if (!c) {
+        static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n"
+                                   "Connection: close\r\n\r\n";
+        send(Fd, busy, sizeof(busy) - 1, HTTP_SEND_FLAGS);
+        close(Fd);
+        s_Stats.Refused++;
+        return;
+    }
+    if (PdqEventAdd(Fd, PDQ_EVENT_READ, OnClientEvent, c) != PdqOk) {
+        close(Fd);
+        return;
+    }
+    c->Fd = Fd;
+    c->InLen = 0;
+    c->CloseAfter = false;
+    c->DeadlineMs = GetMillis() + PDQ_HTTP_IDLE_MS;
+    s_Stats.Clients++;
+    s_Stats.Connections++;
+}
+
+static void OnListen(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Events;
+    (void)p_Arg;
+    for (int i = 0; i < HTTP_ACCEPT_BATCH; i++) {
+        int fd = accept(Fd, NULL, NULL);
+        if (fd >= 0) {
+            AddClient(fd);
+            continue;
+        }
+        if (errno == EINTR) continue;
+        return;
+    }
+}
+
+/* Requests held open, responses not read and idle keep-alives all end
+ * at the deadline */
+static void OnTick(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    (void)Events;
+    (void)p_Arg;
+    uint64_t now = GetMillis();
+    for (int i = 0; i < PDQ_HTTP_MAX_CLIENTS; i++) {
+        if (s_Clients[i].Fd < 0 || now < s_Clients[i].DeadlineMs) continue;
+        CloseClient(&s_Clients[i]);
+        s_Stats.TimedOut++;
+    }
+}
+
+/* ---- API ---- */
+
+PdqError_t PdqHttpStart(uint16_t Port, const char* p_BindAddress) {
+    if (s_Running) return PdqErrorInvalidParam;
+
+    memset(&s_Stats, 0, sizeof(s_Stats));
+    for (int i = 0; i < PDQ_HTTP_MAX_CLIENTS; i++) {
+        s_Clients[i].Fd = -1;
+        s_Clients[i].p_Out = NULL;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(Port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (p_BindAddress && inet_pton(AF_INET, p_BindAddress, &addr.sin_addr) != 1) return PdqErrorInvalidParam;
+
+    s_ListenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (s_ListenFd < 0) return PdqErrorNotConnected;
+    int one = 1;
+    setsockopt(s_ListenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    fcntl(s_ListenFd, F_SETFL, fcntl(s_ListenFd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(s_ListenFd, F_SETFD, FD_CLOEXEC);
+
+    socklen_t len = sizeof(addr);
+    if (bind(s_ListenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(s_ListenFd, PDQ_HTTP_MAX_CLIENTS) != 0 ||
+        getsockname(s_ListenFd, (struct sockaddr*)&addr, &len) != 0 ||
+        PdqEventAdd(s_ListenFd, PDQ_EVENT_READ, OnListen, NULL) != PdqOk) {
+        fprintf(stderr, "[API] Cannot listen on port %u: %s\n", (unsigned)Port, strerror(errno));
+        close(s_ListenFd);
+        s_ListenFd = -1;
+        return PdqErrorNotConnected;
+    }
+    s_TimerId = PdqEventAddTimer(HTTP_TICK_MS, OnTick, NULL);
+    s_Port = ntohs(addr.sin_port);
+    s_Running = true;
+    printf("[API] Listening on port %u\n", (unsigned)s_Port);
+    return PdqOk;
+}
+
+void PdqHttpStop(void) {
+    if (!s_Running) return;
+    for (int i = 0; i < PDQ_HTTP_MAX_CLIENTS; i++) CloseClient(&s_Clients[i]);
+    if (s_TimerId >= 0) {
+        PdqEventRemoveTimer(s_TimerId);
+        s_TimerId = -1;
+    }
+    PdqEventRemove(s_ListenFd);
+    close(s_ListenFd);
+    s_ListenFd = -1;
+    s_Port = 0;
+    s_Running = false;
+}
+
+uint16_t PdqHttpGetPort(void) {
+    return s_Port;
+}
+
+void PdqHttpGetStats(PdqHttpStats_t* p_Stats) {
+    if (p_Stats) *p_Stats = s_Stats;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file linux_http.h
+ * @brief Non-blocking HTTP/1.1 server for the device API
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Serves api/device_api.h from the event loop, so PDQManager can poll
+ * the miner and Prometheus can scrape /metrics. Nothing here blocks:
+ * requests are read as they arrive, each response is rendered in one go
+ * from a snapshot of the counters and written as far as the socket
+ * takes it, and the rest goes out when the socket drains. A scrape
+ * costs the loop the time to render a page, never the time a slow or
+ * stalled client takes; the miner threads are not involved at all.
+ *
+ * Connections are kept alive and answered in order. A client that holds
+ * a request open, stops reading its response or sits idle is closed
+ * after PDQ_HTTP_IDLE_MS; one over PDQ_HTTP_MAX_CLIENTS is refused.
+ *
+ * All functions must be called from the thread that runs the event loop.
+ */
+
+#ifndef PDQ_LINUX_HTTP_H
+#define PDQ_LINUX_HTTP_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_HTTP_MAX_CLIENTS    16
+#define PDQ_HTTP_REQUEST_MAX    8192    /* Request line, headers and body */
+#define PDQ_HTTP_RESPONSE_MAX   65536   /* Rendered body */
+#define PDQ_HTTP_IDLE_MS        10000
+
+typedef struct {
+    uint32_t Clients;               /* Open connections */
+    uint32_t Connections;           /* Accepted since start */
+    uint32_t Refused;               /* Over the client limit */
+    uint32_t Requests;
+    uint32_t Errors;                /* Malformed, too large or unsupported */
+    uint32_t TimedOut;
+} PdqHttpStats_t;
+
+/* Port 0 picks an ephemeral port; p_BindAddress NULL listens on all
+ * interfaces */
+PdqError_t PdqHttpStart(uint16_t Port, const char* p_BindAddress);
+void       PdqHttpStop(void);
+uint16_t   PdqHttpGetPort(void);
+void       PdqHttpGetStats(PdqHttpStats_t* p_Stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,54 +6,41 @@
  *
  * Replaces the FreeRTOS dual-core mining_task.c with POSIX threads.
  * Supports N configurable mining threads, each scanning a non-overlapping
- * slice of the 4 GiB nonce space using the software SHA256 path.
+ * slice of the 4 GiB nonce space using the software SHA256 path. The
+ * threads of one pool serve every mining context attached to it; see
+ * linux_mining.h.
  */
 
 #include "core/mining_task.h"
 #include "core/sha256_engine.h"
+#include "core/target.h"
+#include "linux_mining.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <pthread.h>
-#include <time.h>
-#include <stdatomic.h>
 
-#define PDQ_SHARE_QUEUE_SIZE     16
 #define PDQ_NONCE_BATCH_SIZE     4096
-#define PDQ_MAX_THREADS          32
 
 /* Configurable thread count — set before PdqMiningStart() */
 static int s_NumThreads = 2;
 
+/* Optional wakeup for the control loop, signalled once per queued share */
+static PdqEventNotifier_t* s_ShareNotifier = NULL;
+
+/* What the mining_task.h API drives */
+static PdqMiningPool_t    s_DefaultPool;
+static PdqMiningContext_t s_DefaultCtx;
+
 void PdqMiningSetThreadCount(int n) {
     if (n < 1) n = 1;
-    if (n > PDQ_MAX_THREADS) n = PDQ_MAX_THREADS;
+    if (n > PDQ_MINING_MAX_THREADS) n = PDQ_MINING_MAX_THREADS;
     s_NumThreads = n;
 }
 
-typedef struct {
-    volatile int            Running;
-    volatile int            HasJob;
-    atomic_uint             JobVersion;
-    atomic_uint_fast64_t    TotalHashes;
-    atomic_uint             HashRate;
-    atomic_uint             SharesAccepted;
-    atomic_uint             SharesRejected;
-    atomic_uint             BlocksFound;
-    struct timespec         StartTime;
-    PdqMiningJob_t          CurrentJob;
-    pthread_mutex_t         JobMutex;
-
-    /* Lock-free share ring buffer */
-    PdqShareInfo_t          ShareBuffer[PDQ_SHARE_QUEUE_SIZE];
-    atomic_uint             ShareHead;
-    atomic_uint             ShareTail;
-
-    pthread_t               Threads[PDQ_MAX_THREADS];
-    int                     ThreadCount;
-} MiningState_t;
-
-static MiningState_t s_State;
+void PdqMiningSetShareNotifier(PdqEventNotifier_t* p_Notifier) {
+    s_ShareNotifier = p_Notifier;
+    s_DefaultPool.p_Notifier = p_Notifier;
+}
 
 static uint64_t GetMillis(void) {
     struct timespec ts;
@@ -61,191 +48,429 @@ static uint64_t GetMillis(void) {
     return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
 }
 
-static void QueueShare(const PdqMiningJob_t* p_Job, uint32_t Nonce) {
-    unsigned head = atomic_load(&s_State.ShareHead);
-    unsigned next = (head + 1) % PDQ_SHARE_QUEUE_SIZE;
-    if (next == atomic_load(&s_State.ShareTail)) {
-        printf("[Mining] WARN: Share queue full, dropping share nonce=%08X\n", Nonce);
+static void QueueShare(PdqMiningContext_t* p_Ctx, const PdqMiningJob_t* p_Job, uint32_t Nonce, bool Block) {
+    PdqShareInfo_t* ring = Block ? p_Ctx->BlockBuffer : p_Ctx->ShareBuffer;
+    atomic_uint* p_head = Block ? &p_Ctx->BlockHead : &p_Ctx->ShareHead;
+    atomic_uint* p_tail = Block ? &p_Ctx->BlockTail : &p_Ctx->ShareTail;
+    unsigned size = Block ? PDQ_MINING_BLOCK_QUEUE_SIZE : PDQ_MINING_SHARE_QUEUE_SIZE;
+
+    unsigned head = atomic_load(p_head);
+    unsigned next = (head + 1) % size;
+    if (next == atomic_load(p_tail)) {
+        printf("[Mining] WARN: %s queue full, dropping nonce=%08X\n",
+               Block ? "Block" : "Share", Nonce);
         return;
     }
 
-    PdqShareInfo_t* s = &s_State.ShareBuffer[head];
+    PdqShareInfo_t* s = &ring[head];
     strncpy(s->JobId, p_Job->JobId, 64);
     s->JobId[64] = '\0';
     s->Extranonce2 = p_Job->Extranonce2;
     s->Nonce = Nonce;
     s->NTime = p_Job->NTime;
-    atomic_store(&s_State.ShareHead, next);
+    s->ExtranonceGen = p_Job->ExtranonceGen;
+    s->BlockCandidate = Block;
+    atomic_store(p_head, next);
+
+    if (p_Ctx->p_Pool && p_Ctx->p_Pool->p_Notifier) {
+        PdqEventNotifierSignal(p_Ctx->p_Pool->p_Notifier);
+    }
 }
 
 typedef struct {
+    PdqMiningPool_t* p_Pool;
     int      ThreadIndex;
-    uint32_t NonceStart;
-    uint32_t NonceEnd;
 } ThreadArg_t;
 
+/* Thread Index's share of the 32-bit nonce space when Threads split it */
+static void NonceRange(int Threads, int Index, uint32_t* p_Start, uint32_t* p_End) {
+    uint64_t perThread = 0x100000000ULL / (uint64_t)Threads;
+    *p_Start = (uint32_t)(perThread * (uint64_t)Index);
+    *p_End = (Index == Threads - 1) ? 0xFFFFFFFF : (uint32_t)(perThread * (uint64_t)(Index + 1) - 1);
+}
+
+/* One thread's progress on one context: a private copy of its job, the
+ * nonce range the thread took it with and where the next slice starts.
+ * The range stays with the job, so a resize never hands out nonces a
+ * thread has already been through. */
+typedef struct {
+    PdqMiningJob_t Job;
+    unsigned       JobVersion;
+    uint32_t       Next;
+    uint32_t       End;
+    bool           Valid;
+} ThreadSlot_t;
+
+/* Whether the thread holding p_Slot has work on the context: its own
+ * copy of the current job, or a job not yet split under an older layout
+ * (others hold parts of those nonces). Under SchedMutex. */
+static bool CanMine(const PdqMiningContext_t* p_Ctx, const ThreadSlot_t* p_Slot) {
+    unsigned version = atomic_load(&p_Ctx->JobVersion);
+    if (p_Slot->Valid && p_Slot->JobVersion == version) return true;
+    return version != p_Ctx->RetiredVersion;
+}
+
+/* Smooth weighted round robin over the contexts that have work: each
+ * one earns its weight per pick and the winner pays back the total, so
+ * slices interleave in proportion to the weights. */
+static PdqMiningContext_t* PickContext(PdqMiningPool_t* p_Pool, const ThreadSlot_t* p_Slots, int* p_Index) {
+    PdqMiningContext_t* best = NULL;
+    int64_t total = 0;
+
+    pthread_mutex_lock(&p_Pool->SchedMutex);
+    for (int i = 0; i < p_Pool->ContextCount; i++) {
+        PdqMiningContext_t* ctx = p_Pool->p_Contexts[i];
+        if (!ctx->HasJob || ctx->Paused || !CanMine(ctx, &p_Slots[i])) continue;
+        ctx->Credit += ctx->Weight;
+        total += ctx->Weight;
+        if (!best || ctx->Credit > best->Credit) {
+            best = ctx;
+            *p_Index = i;
+        }
+    }
+    if (best) best->Credit -= total;
+    pthread_mutex_unlock(&p_Pool->SchedMutex);
+    return best;
+}
+
+/* Hash up to one slice of the context's job, stopping early when the job
+ * changes, the context is paused or the pool is resized. Returns the
+ * hashes done. */
+static uint64_t MineSlice(PdqMiningPool_t* p_Pool, PdqMiningContext_t* p_Ctx, ThreadSlot_t* p_Slot,
+                          int Index, unsigned Layout) {
+    uint32_t NonceEnd = p_Slot->End;
+    PdqMiningJob_t* job = &p_Slot->Job;
+    uint64_t hashes = 0;
+    uint32_t base = p_Slot->Next;
+
+    while (p_Pool->Running && !p_Ctx->Paused && hashes < PDQ_MINING_SLICE_NONCES &&
+           atomic_load(&p_Ctx->JobVersion) == p_Slot->JobVersion &&
+           atomic_load(&p_Pool->Layout) == Layout) {
+        job->NonceStart = base;
+        uint32_t batchEnd = base + PDQ_NONCE_BATCH_SIZE - 1;
+        if (batchEnd > NonceEnd || batchEnd < base) batchEnd = NonceEnd;
+        job->NonceEnd = batchEnd;
+
+        uint32_t nonce;
+        bool found;
+        PdqSha256MineBlock(job, &nonce, &found);
+
+        if (found)
+            hashes += (nonce - job->NonceStart + 1);
+        else
+            hashes += (job->NonceEnd - job->NonceStart + 1);
+
+        if (found) {
+            uint32_t hash[8];
+            PdqTargetHashJob(job, nonce, hash);
+            switch (PdqTargetClassify(job, hash)) {
+                case PdqHitBlock:
+                    atomic_fetch_add(&p_Ctx->BlocksFound, 1);
+                    QueueShare(p_Ctx, job, nonce, true);
+                    printf("[Mine-%d] *** BLOCK CANDIDATE *** nonce=%08X\n", Index, nonce);
+                    break;
+                case PdqHitShare:
+                    QueueShare(p_Ctx, job, nonce, false);
+                    printf("[Mine-%d] *** SHARE FOUND *** nonce=%08X\n", Index, nonce);
+                    break;
+                default:
+                    printf("[Mine-%d] WARN: nonce=%08X above target, dropped\n", Index, nonce);
+                    break;
+            }
+        }
+
+        if (batchEnd >= NonceEnd) {
+            /* Range done: start it over on a fresh copy of the job */
+            p_Slot->Valid = false;
+            break;
+        }
+        base = batchEnd + 1;
+    }
+
+    p_Slot->Next = base;
+    return hashes;
+}
+
 static void* MiningThread(void* arg) {
     ThreadArg_t* ta = (ThreadArg_t*)arg;
-    uint32_t myNonceStart = ta->NonceStart;
-    uint32_t myNonceEnd = ta->NonceEnd;
+    PdqMiningPool_t* pool = ta->p_Pool;
     int idx = ta->ThreadIndex;
     free(ta);
 
+    uint32_t myNonceStart, myNonceEnd;
+    pthread_mutex_lock(&pool->SchedMutex);
+    unsigned layout = atomic_load(&pool->Layout);
+    NonceRange(pool->ThreadCount, idx, &myNonceStart, &myNonceEnd);
+    pthread_mutex_unlock(&pool->SchedMutex);
+
+    ThreadSlot_t* slots = (ThreadSlot_t*)calloc(PDQ_MINING_MAX_CONTEXTS, sizeof(ThreadSlot_t));
+    if (!slots) {
+        printf("[Mine-%d] ERROR: out of memory\n", idx);
+        return NULL;
+    }
+
     printf("[Mine-%d] Thread started, nonce range %08X-%08X\n",
            idx, myNonceStart, myNonceEnd);
 
-    uint64_t localHashes = 0;
-    uint64_t lastReport = GetMillis();
+    while (pool->Running) {
+        /* A resize splits the nonce space again for the jobs to come;
+         * threads past the new count end, the others finish the jobs
+         * they hold on the ranges they took them with */
+        if (atomic_load(&pool->Layout) != layout) {
+            pthread_mutex_lock(&pool->SchedMutex);
+            int threads = pool->ThreadCount;
+            layout = atomic_load(&pool->Layout);
+            pthread_mutex_unlock(&pool->SchedMutex);
+            if (idx >= threads) break;
+            NonceRange(threads, idx, &myNonceStart, &myNonceEnd);
+        }
 
-    while (s_State.Running) {
-        if (!s_State.HasJob) {
+        int index = 0;
+        PdqMiningContext_t* ctx = PickContext(pool, slots, &index);
+        if (!ctx) {
             struct timespec ts = {0, 10000000}; /* 10ms */
             nanosleep(&ts, NULL);
             continue;
         }
 
-        pthread_mutex_lock(&s_State.JobMutex);
-        PdqMiningJob_t job = s_State.CurrentJob;
-        unsigned myJobVer = atomic_load(&s_State.JobVersion);
-        job.NonceStart = myNonceStart;
-        job.NonceEnd = myNonceEnd;
-        pthread_mutex_unlock(&s_State.JobMutex);
-
-        uint32_t base = myNonceStart;
-        while (s_State.Running && atomic_load(&s_State.JobVersion) == myJobVer) {
-            job.NonceStart = base;
-            uint32_t batchEnd = base + PDQ_NONCE_BATCH_SIZE - 1;
-            if (batchEnd > myNonceEnd || batchEnd < base) batchEnd = myNonceEnd;
-            job.NonceEnd = batchEnd;
-
-            uint32_t nonce;
-            bool found;
-            PdqSha256MineBlock(&job, &nonce, &found);
-
-            if (found)
-                localHashes += (nonce - job.NonceStart + 1);
-            else
-                localHashes += (job.NonceEnd - job.NonceStart + 1);
-
-            if (found) {
-                QueueShare(&job, nonce);
-                atomic_fetch_add(&s_State.BlocksFound, 1);
-                printf("[Mine-%d] *** SHARE FOUND *** nonce=%08X\n", idx, nonce);
-            }
-
-            uint64_t now = GetMillis();
-            if (now - lastReport > 1000) {
-                atomic_fetch_add(&s_State.TotalHashes, localHashes);
-                localHashes = 0;
-                lastReport = now;
+        ThreadSlot_t* slot = &slots[index];
+        if (!slot->Valid || slot->JobVersion != atomic_load(&ctx->JobVersion)) {
+            /* Under the scheduler lock, so no resize comes between the
+             * layout this range is from and taking the job with it */
+            pthread_mutex_lock(&pool->SchedMutex);
+            pthread_mutex_lock(&ctx->JobMutex);
+            slot->Valid = atomic_load(&pool->Layout) == layout &&
+                          atomic_load(&ctx->JobVersion) != ctx->RetiredVersion;
+            if (slot->Valid) {
+                slot->Job = ctx->CurrentJob;
+                slot->JobVersion = atomic_load(&ctx->JobVersion);
+                ctx->TakenVersion = slot->JobVersion;
+                slot->Next = myNonceStart;
+                slot->End = myNonceEnd;
             }
-
-            if (batchEnd >= myNonceEnd) break;
-            base = batchEnd + 1;
+            pthread_mutex_unlock(&ctx->JobMutex);
+            pthread_mutex_unlock(&pool->SchedMutex);
+            if (!slot->Valid) continue;
         }
-    }
 
-    /* Flush remaining hashes */
-    if (localHashes > 0) {
-        atomic_fetch_add(&s_State.TotalHashes, localHashes);
+        uint64_t hashes = MineSlice(pool, ctx, slot, idx, layout);
+        if (hashes > 0) {
+            atomic_fetch_add(&ctx->TotalHashes, hashes);
+            atomic_fetch_add(&pool->ThreadHashes[idx], hashes);
+        }
     }
 
+    free(slots);
     printf("[Mine-%d] Thread exiting\n", idx);
     return NULL;
 }
 
-PdqError_t PdqMiningInit(void) {
-    memset(&s_State, 0, sizeof(s_State));
-    pthread_mutex_init(&s_State.JobMutex, NULL);
-    atomic_store(&s_State.ShareHead, 0);
-    atomic_store(&s_State.ShareTail, 0);
-    atomic_store(&s_State.JobVersion, 0);
-    atomic_store(&s_State.TotalHashes, 0);
-    atomic_store(&s_State.HashRate, 0);
-    atomic_store(&s_State.SharesAccepted, 0);
-    atomic_store(&s_State.SharesRejected, 0);
-    atomic_store(&s_State.BlocksFound, 0);
+/* ---- Pool ---- */
+
+PdqError_t PdqMiningPoolInit(PdqMiningPool_t* p_Pool, int Threads, PdqEventNotifier_t* p_Notifier) {
+    if (!p_Pool) return PdqErrorInvalidParam;
+    memset(p_Pool, 0, sizeof(*p_Pool));
+    if (Threads < 1) Threads = 1;
+    if (Threads > PDQ_MINING_MAX_THREADS) Threads = PDQ_MINING_MAX_THREADS;
+    p_Pool->ThreadCount = Threads;
+    p_Pool->p_Notifier = p_Notifier;
+    pthread_mutex_init(&p_Pool->SchedMutex, NULL);
     return PdqOk;
 }
 
-PdqError_t PdqMiningStart(void) {
-    if (s_State.Running) return PdqOk;
-
-    s_State.Running = 1;
-    clock_gettime(CLOCK_MONOTONIC, &s_State.StartTime);
+PdqError_t PdqMiningPoolAttach(PdqMiningPool_t* p_Pool, PdqMiningContext_t* p_Ctx, uint32_t Weight) {
+    if (!p_Pool || !p_Ctx || p_Pool->Running) return PdqErrorInvalidParam;
+    if (p_Pool->ContextCount >= PDQ_MINING_MAX_CONTEXTS) return PdqErrorNoMemory;
+    p_Ctx->p_Pool = p_Pool;
+    p_Ctx->Weight = Weight ? Weight : 1;
+    p_Ctx->Credit = 0;
+    p_Pool->p_Contexts[p_Pool->ContextCount++] = p_Ctx;
+    return PdqOk;
+}
 
-    int n = s_NumThreads;
-    s_State.ThreadCount = n;
+/* Split the nonce space between Threads from the next job on. A job the
+ * running threads have started on is retired: they finish what they
+ * hold of it, and nobody takes up a new part. */
+static void SetLayout(PdqMiningPool_t* p_Pool, int Threads) {
+    pthread_mutex_lock(&p_Pool->SchedMutex);
+    for (int i = 0; p_Pool->ThreadCount > 0 && i < p_Pool->ContextCount; i++) {
+        PdqMiningContext_t* ctx = p_Pool->p_Contexts[i];
+        if (ctx->TakenVersion == atomic_load(&ctx->JobVersion)) ctx->RetiredVersion = ctx->TakenVersion;
+    }
+    p_Pool->ThreadCount = Threads;
+    atomic_fetch_add(&p_Pool->Layout, 1);
+    pthread_mutex_unlock(&p_Pool->SchedMutex);
+}
 
-    /* Split 32-bit nonce space evenly across threads */
-    uint64_t total = 0x100000000ULL;
-    uint64_t perThread = total / (uint64_t)n;
+/* Grow a running pool from ThreadCount to Threads. The running threads
+ * move to their share of the new split when they see the layout change. */
+static PdqError_t StartThreads(PdqMiningPool_t* p_Pool, int Threads) {
+    int old = p_Pool->ThreadCount;
+    SetLayout(p_Pool, Threads);
 
-    for (int i = 0; i < n; i++) {
+    for (int i = old; i < Threads; i++) {
         ThreadArg_t* ta = (ThreadArg_t*)malloc(sizeof(ThreadArg_t));
-        if (!ta) return PdqErrorNoMemory;
-        ta->ThreadIndex = i;
-        ta->NonceStart = (uint32_t)(perThread * (uint64_t)i);
-        ta->NonceEnd = (i == n - 1) ? 0xFFFFFFFF : (uint32_t)(perThread * (uint64_t)(i + 1) - 1);
-
-        if (pthread_create(&s_State.Threads[i], NULL, MiningThread, ta) != 0) {
+        if (ta) {
+            ta->p_Pool = p_Pool;
+            ta->ThreadIndex = i;
+        }
+        if (!ta || pthread_create(&p_Pool->Threads[i], NULL, MiningThread, ta) != 0) {
             free(ta);
+            /* Run with the threads there are, split between them */
+            SetLayout(p_Pool, i);
             return PdqErrorNoMemory;
         }
     }
+    return PdqOk;
+}
+
+PdqError_t PdqMiningPoolStart(PdqMiningPool_t* p_Pool) {
+    if (!p_Pool) return PdqErrorInvalidParam;
+    if (p_Pool->Running) return PdqOk;
+
+    p_Pool->Running = 1;
+    clock_gettime(CLOCK_MONOTONIC, &p_Pool->StartTime);
+    p_Pool->RateMs = GetMillis();
+
+    /* Each thread scans its own slice of the nonce space */
+    int n = p_Pool->ThreadCount;
+    p_Pool->ThreadCount = 0;
+    PdqError_t err = StartThreads(p_Pool, n);
+    printf("[Mining] Started %d thread(s)\n", p_Pool->ThreadCount);
+    return err;
+}
+
+PdqError_t PdqMiningPoolResize(PdqMiningPool_t* p_Pool, int Threads) {
+    if (!p_Pool) return PdqErrorInvalidParam;
+    if (Threads < 1) Threads = 1;
+    if (Threads > PDQ_MINING_MAX_THREADS) Threads = PDQ_MINING_MAX_THREADS;
+    if (!p_Pool->Running) {
+        p_Pool->ThreadCount = Threads;
+        return PdqOk;
+    }
 
-    printf("[Mining] Started %d thread(s)\n", n);
+    int old = p_Pool->ThreadCount;
+    if (Threads > old) return StartThreads(p_Pool, Threads);
+    if (Threads == old) return PdqOk;
+
+    /* The surplus threads see the new layout within a batch and end */
+    SetLayout(p_Pool, Threads);
+    for (int i = Threads; i < old; i++) pthread_join(p_Pool->Threads[i], NULL);
     return PdqOk;
 }
 
-PdqError_t PdqMiningStop(void) {
-    s_State.Running = 0;
-    for (int i = 0; i < s_State.ThreadCount; i++) {
-        pthread_join(s_State.Threads[i], NULL);
+PdqError_t PdqMiningPoolSetWeight(PdqMiningPool_t* p_Pool, PdqMiningContext_t* p_Ctx, uint32_t Weight) {
+    if (!p_Pool || !p_Ctx || p_Ctx->p_Pool != p_Pool) return PdqErrorInvalidParam;
+    pthread_mutex_lock(&p_Pool->SchedMutex);
+    p_Ctx->Weight = Weight ? Weight : 1;
+    for (int i = 0; i < p_Pool->ContextCount; i++) p_Pool->p_Contexts[i]->Credit = 0;
+    pthread_mutex_unlock(&p_Pool->SchedMutex);
+    return PdqOk;
+}
+
+PdqError_t PdqMiningPoolStop(PdqMiningPool_t* p_Pool) {
+    if (!p_Pool) return PdqErrorInvalidParam;
+    p_Pool->Running = 0;
+    for (int i = 0; i < p_Pool->ThreadCount; i++) {
+        pthread_join(p_Pool->Threads[i], NULL);
     }
     printf("[Mining] All threads stopped\n");
     return PdqOk;
 }
 
-PdqError_t PdqMiningSetJob(const PdqMiningJob_t* p_Job) {
-    if (!p_Job) return PdqErrorInvalidParam;
+bool PdqMiningPoolIsRunning(const PdqMiningPool_t* p_Pool) {
+    return p_Pool && p_Pool->Running != 0;
+}
 
-    pthread_mutex_lock(&s_State.JobMutex);
-    memcpy(&s_State.CurrentJob, p_Job, sizeof(PdqMiningJob_t));
-    atomic_fetch_add(&s_State.JobVersion, 1);
-    s_State.HasJob = 1;
-    pthread_mutex_unlock(&s_State.JobMutex);
+int PdqMiningPoolGetThreadStats(PdqMiningPool_t* p_Pool, PdqMiningThreadStats_t* p_Stats, int Max) {
+    if (!p_Pool || !p_Stats || !p_Pool->Running) return 0;
 
+    uint64_t now = GetMillis();
+    uint64_t elapsed = now - p_Pool->RateMs;
+    bool update = elapsed >= 1000;
+    for (int i = 0; i < PDQ_MINING_MAX_THREADS && update; i++) {
+        uint64_t total = atomic_load(&p_Pool->ThreadHashes[i]);
+        p_Pool->ThreadRate[i] = (uint32_t)((total - p_Pool->RateHashes[i]) * 1000 / elapsed);
+        p_Pool->RateHashes[i] = total;
+    }
+    if (update) p_Pool->RateMs = now;
+
+    int n = p_Pool->ThreadCount < Max ? p_Pool->ThreadCount : Max;
+    for (int i = 0; i < n; i++) {
+        p_Stats[i].TotalHashes = atomic_load(&p_Pool->ThreadHashes[i]);
+        p_Stats[i].HashRate = p_Pool->ThreadRate[i];
+    }
+    return n;
+}
+
+/* ---- Context ---- */
+
+PdqError_t PdqMiningCtxInit(PdqMiningContext_t* p_Ctx) {
+    if (!p_Ctx) return PdqErrorInvalidParam;
+    memset(p_Ctx, 0, sizeof(*p_Ctx));
+    pthread_mutex_init(&p_Ctx->JobMutex, NULL);
+    p_Ctx->Weight = 1;
+    p_Ctx->RateMs = GetMillis();
     return PdqOk;
 }
 
-PdqError_t PdqMiningGetStats(PdqMinerStats_t* p_Stats) {
-    if (!p_Stats) return PdqErrorInvalidParam;
+PdqError_t PdqMiningCtxSetJob(PdqMiningContext_t* p_Ctx, const PdqMiningJob_t* p_Job) {
+    if (!p_Ctx || !p_Job) return PdqErrorInvalidParam;
+
+    pthread_mutex_lock(&p_Ctx->JobMutex);
+    memcpy(&p_Ctx->CurrentJob, p_Job, sizeof(PdqMiningJob_t));
+    atomic_fetch_add(&p_Ctx->JobVersion, 1);
+    p_Ctx->HasJob = 1;
+    pthread_mutex_unlock(&p_Ctx->JobMutex);
 
-    static uint64_t lastTotal = 0;
-    static uint64_t lastTime = 0;
+    return PdqOk;
+}
+
+PdqError_t PdqMiningCtxSetLanWork(PdqMiningContext_t* p_Ctx, const PdqLanWork_t* p_Work) {
+    if (!p_Ctx || !p_Work) return PdqErrorInvalidParam;
+
+    pthread_mutex_lock(&p_Ctx->JobMutex);
+    PdqLanWorkToJob(p_Work, &p_Ctx->CurrentJob);
+    atomic_fetch_add(&p_Ctx->JobVersion, 1);
+    p_Ctx->HasJob = 1;
+    pthread_mutex_unlock(&p_Ctx->JobMutex);
+
+    return PdqOk;
+}
+
+PdqError_t PdqMiningCtxGetStats(PdqMiningContext_t* p_Ctx, PdqMinerStats_t* p_Stats) {
+    if (!p_Ctx || !p_Stats) return PdqErrorInvalidParam;
 
     uint64_t now = GetMillis();
-    uint64_t elapsed = now - lastTime;
+    uint64_t elapsed = now - p_Ctx->RateMs;
 
     if (elapsed >= 1000) {
-        uint64_t currentTotal = atomic_load(&s_State.TotalHashes);
-        uint64_t delta = currentTotal - lastTotal;
-        atomic_store(&s_State.HashRate, (unsigned)(delta * 1000 / elapsed));
-        lastTotal = currentTotal;
-        lastTime = now;
+        uint64_t currentTotal = atomic_load(&p_Ctx->TotalHashes);
+        uint64_t delta = currentTotal - p_Ctx->RateHashes;
+        atomic_store(&p_Ctx->HashRate, (unsigned)(delta * 1000 / elapsed));
+        p_Ctx->RateHashes = currentTotal;
+        p_Ctx->RateMs = now;
     }
 
-    uint64_t upMs = now - ((uint64_t)s_State.StartTime.tv_sec * 1000 +
-                           (uint64_t)s_State.StartTime.tv_nsec / 1000000);
+    uint64_t upMs = 0;
+    if (p_Ctx->p_Pool && p_Ctx->p_Pool->Running) {
+        const struct timespec* start = &p_Ctx->p_Pool->StartTime;
+        upMs = now - ((uint64_t)start->tv_sec * 1000 + (uint64_t)start->tv_nsec / 1000000);
+    }
 
-    p_Stats->HashRate = atomic_load(&s_State.HashRate);
+    p_Stats->HashRate = atomic_load(&p_Ctx->HashRate);
     p_Stats->HashRateSw = p_Stats->HashRate;
     p_Stats->HashRateHw = 0;
-    p_Stats->TotalHashes = atomic_load(&s_State.TotalHashes);
-    p_Stats->SharesAccepted = atomic_load(&s_State.SharesAccepted);
-    p_Stats->SharesRejected = atomic_load(&s_State.SharesRejected);
-    p_Stats->BlocksFound = atomic_load(&s_State.BlocksFound);
+    p_Stats->TotalHashes = atomic_load(&p_Ctx->TotalHashes);
+    p_Stats->SharesAccepted = atomic_load(&p_Ctx->SharesAccepted);
+    p_Stats->SharesRejected = atomic_load(&p_Ctx->SharesRejected);
+    p_Stats->SharesTimedOut = atomic_load(&p_Ctx->SharesTimedOut);
+    p_Stats->SharesStale = atomic_load(&p_Ctx->SharesStale);
+    for (int i = 0; i < PDQ_SUBMIT_LATENCY_BUCKETS; i++) {
+        p_Stats->SubmitLatencyHist[i] = atomic_load(&p_Ctx->SubmitLatencyHist[i]);
+    }
+    p_Stats->SubmitLatencySumMs = atomic_load(&p_Ctx->SubmitLatencySumMs);
+    p_Stats->BlocksFound = atomic_load(&p_Ctx->BlocksFound);
     p_Stats->Uptime = (uint32_t)(upMs / 1000);
     p_Stats->Temperature = 0.0f;
     p_Stats->Difficulty = 0.0;
@@ -256,32 +481,111 @@ PdqError_t PdqMiningGetStats(PdqMinerStats_t* p_Stats) {
     return PdqOk;
 }
 
+bool PdqMiningCtxHasShare(PdqMiningContext_t* p_Ctx) {
+    return atomic_load(&p_Ctx->BlockHead) != atomic_load(&p_Ctx->BlockTail) ||
+           atomic_load(&p_Ctx->ShareHead) != atomic_load(&p_Ctx->ShareTail);
+}
+
+/* Block candidates come out ahead of any queued share */
+PdqError_t PdqMiningCtxGetShare(PdqMiningContext_t* p_Ctx, PdqShareInfo_t* p_Share) {
+    if (!p_Ctx || !p_Share) return PdqErrorInvalidParam;
+    unsigned tail = atomic_load(&p_Ctx->BlockTail);
+    if (tail != atomic_load(&p_Ctx->BlockHead)) {
+        *p_Share = p_Ctx->BlockBuffer[tail];
+        atomic_store(&p_Ctx->BlockTail, (tail + 1) % PDQ_MINING_BLOCK_QUEUE_SIZE);
+        return PdqOk;
+    }
+
+    tail = atomic_load(&p_Ctx->ShareTail);
+    if (tail == atomic_load(&p_Ctx->ShareHead)) return PdqErrorInvalidParam;
+    *p_Share = p_Ctx->ShareBuffer[tail];
+    atomic_store(&p_Ctx->ShareTail, (tail + 1) % PDQ_MINING_SHARE_QUEUE_SIZE);
+    return PdqOk;
+}
+
+void PdqMiningCtxClearShares(PdqMiningContext_t* p_Ctx) {
+    atomic_store(&p_Ctx->ShareHead, 0);
+    atomic_store(&p_Ctx->ShareTail, 0);
+    atomic_store(&p_Ctx->BlockHead, 0);
+    atomic_store(&p_Ctx->BlockTail, 0);
+}
+
+/* Park the context while there is no pool to submit to. Threads finish
+ * the slice in hand, then give its turns to the other contexts, or idle.
+ * The job is kept, so resuming without a new notify continues on the
+ * same work. */
+void PdqMiningCtxPause(PdqMiningContext_t* p_Ctx) {
+    p_Ctx->Paused = 1;
+}
+
+void PdqMiningCtxResume(PdqMiningContext_t* p_Ctx) {
+    p_Ctx->Paused = 0;
+}
+
+void PdqMiningCtxRecordSubmitResult(PdqMiningContext_t* p_Ctx, PdqSubmitResult_t Result,
+                                    uint32_t LatencyMs) {
+    switch (Result) {
+        case PdqSubmitAccepted: atomic_fetch_add(&p_Ctx->SharesAccepted, 1); break;
+        case PdqSubmitRejected: atomic_fetch_add(&p_Ctx->SharesRejected, 1); break;
+        case PdqSubmitStale:    atomic_fetch_add(&p_Ctx->SharesStale, 1); return;
+        default:                atomic_fetch_add(&p_Ctx->SharesTimedOut, 1); return;
+    }
+    atomic_fetch_add(&p_Ctx->SubmitLatencyHist[PdqSubmitLatencyBucket(LatencyMs)], 1);
+    atomic_fetch_add(&p_Ctx->SubmitLatencySumMs, LatencyMs);
+}
+
+/* ---- mining_task.h API on the default context ---- */
+
+PdqError_t PdqMiningInit(void) {
+    PdqMiningCtxInit(&s_DefaultCtx);
+    PdqMiningPoolInit(&s_DefaultPool, s_NumThreads, s_ShareNotifier);
+    return PdqMiningPoolAttach(&s_DefaultPool, &s_DefaultCtx, 1);
+}
+
+PdqError_t PdqMiningStart(void) {
+    return PdqMiningPoolStart(&s_DefaultPool);
+}
+
+PdqError_t PdqMiningStop(void) {
+    return PdqMiningPoolStop(&s_DefaultPool);
+}
+
+PdqError_t PdqMiningSetJob(const PdqMiningJob_t* p_Job) {
+    return PdqMiningCtxSetJob(&s_DefaultCtx, p_Job);
+}
+
+PdqError_t PdqMiningSetLanWork(const PdqLanWork_t* p_Work) {
+    return PdqMiningCtxSetLanWork(&s_DefaultCtx, p_Work);
+}
+
+PdqError_t PdqMiningGetStats(PdqMinerStats_t* p_Stats) {
+    return PdqMiningCtxGetStats(&s_DefaultCtx, p_Stats);
+}
+
 bool PdqMiningIsRunning(void) {
-    return s_State.Running != 0;
+    return PdqMiningPoolIsRunning(&s_DefaultPool);
 }
 
 bool PdqMiningHasShare(void) {
-    return atomic_load(&s_State.ShareHead) != atomic_load(&s_State.ShareTail);
+    return PdqMiningCtxHasShare(&s_DefaultCtx);
 }
 
 PdqError_t PdqMiningGetShare(PdqShareInfo_t* p_Share) {
-    if (!p_Share) return PdqErrorInvalidParam;
-    unsigned tail = atomic_load(&s_State.ShareTail);
-    if (tail == atomic_load(&s_State.ShareHead)) return PdqErrorInvalidParam;
-    *p_Share = s_State.ShareBuffer[tail];
-    atomic_store(&s_State.ShareTail, (tail + 1) % PDQ_SHARE_QUEUE_SIZE);
-    return PdqOk;
+    return PdqMiningCtxGetShare(&s_DefaultCtx, p_Share);
 }
 
 void PdqMiningClearShares(void) {
-    atomic_store(&s_State.ShareHead, 0);
-    atomic_store(&s_State.ShareTail, 0);
+    PdqMiningCtxClearShares(&s_DefaultCtx);
 }
 
 void PdqMiningPause(void) {
-    /* No-op on Linux */
+    PdqMiningCtxPause(&s_DefaultCtx);
 }
 
 void PdqMiningResume(void) {
-    /* No-op on Linux */
+    PdqMiningCtxResume(&s_DefaultCtx);
+}
+
+void PdqMiningRecordSubmitResult(PdqSubmitResult_t Result, uint32_t LatencyMs) {
+    PdqMiningCtxRecordSubmitResult(&s_DefaultCtx, Result, LatencyMs);
 }
@@ -0,0 +1,148 @@
+/**
+ * @file linux_mining.h
+ * @brief Mining contexts sharing one pthread pool
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * A mining context holds everything one work source needs: its current
+ * job, its share and block queues, and its hash and share counters. A
+ * mining pool is one set of threads that hashes for every context
+ * attached to it, so a process can mine for several pool sessions
+ * without each one bringing its own threads.
+ *
+ * Threads take work a slice at a time (PDQ_MINING_SLICE_NONCES) and hand
+ * each slice to the context that is furthest behind its weight, so the
+ * hashrate splits between contexts in proportion to their weights.
+ * Contexts that have no job yet or are paused are skipped, and their
+ * share goes to the others.
+ *
+ * The mining_task.h functions act on a default context attached alone
+ * to a default pool.
+ */
+
+#ifndef PDQ_LINUX_MINING_H
+#define PDQ_LINUX_MINING_H
+
+#include "pdq_types.h"
+#include "stratum/lan_proto.h"
+#include "linux_event.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_MINING_MAX_THREADS      32
+#define PDQ_MINING_MAX_CONTEXTS     8
+#define PDQ_MINING_SHARE_QUEUE_SIZE 16
+#define PDQ_MINING_BLOCK_QUEUE_SIZE 4
+#define PDQ_MINING_SLICE_NONCES     65536   /* Scheduling quantum per thread */
+
+typedef struct PdqMiningPool PdqMiningPool_t;
+
+typedef struct {
+    uint64_t TotalHashes;           /* Across every context, since the pool started */
+    uint32_t HashRate;              /* H/s over the last second or more */
+} PdqMiningThreadStats_t;
+
+typedef struct {
+    PdqMiningPool_t*        p_Pool;
+    uint32_t                Weight;
+    int64_t                 Credit;         /* Scheduler balance, under the pool's lock */
+
+    volatile int            HasJob;
+    volatile int            Paused;
+    atomic_uint             JobVersion;
+    unsigned                TakenVersion;   /* Last job a thread took a range of ... */
+    unsigned                RetiredVersion; /* ... and one split under an older layout; under the pool's lock */
+    PdqMiningJob_t          CurrentJob;
+    pthread_mutex_t         JobMutex;
+
+    atomic_uint_fast64_t    TotalHashes;
+    atomic_uint             HashRate;
+    uint64_t                RateHashes;     /* TotalHashes and time at the last rate update */
+    uint64_t                RateMs;
+    atomic_uint             SharesAccepted;
+    atomic_uint             SharesRejected;
+    atomic_uint             SharesTimedOut;
+    atomic_uint             SharesStale;
+    atomic_uint             SubmitLatencyHist[PDQ_SUBMIT_LATENCY_BUCKETS];
+    atomic_uint_fast64_t    SubmitLatencySumMs;
+    atomic_uint             BlocksFound;
+
+    /* Lock-free share ring buffer */
+    PdqShareInfo_t          ShareBuffer[PDQ_MINING_SHARE_QUEUE_SIZE];
+    atomic_uint             ShareHead;
+    atomic_uint             ShareTail;
+
+    /* Block candidates bypass the share ring, so a backlog of ordinary
+     * shares can neither delay nor drop them */
+    PdqShareInfo_t          BlockBuffer[PDQ_MINING_BLOCK_QUEUE_SIZE];
+    atomic_uint             BlockHead;
+    atomic_uint             BlockTail;
+} PdqMiningContext_t;
+
+struct PdqMiningPool {
+    volatile int            Running;
+    int                     ThreadCount;    /* Changed under SchedMutex ... */
+    atomic_uint             Layout;         /* ... which bumps this */
+    pthread_t               Threads[PDQ_MINING_MAX_THREADS];
+    atomic_uint_fast64_t    ThreadHashes[PDQ_MINING_MAX_THREADS];
+    uint64_t                RateHashes[PDQ_MINING_MAX_THREADS];  /* ThreadHashes and time at ... */
+    uint64_t                RateMs;                             /* ... the last rate update */
+    uint32_t                ThreadRate[PDQ_MINING_MAX_THREADS];
+    struct timespec         StartTime;
+    PdqEventNotifier_t*     p_Notifier;     /* Signalled once per queued share */
+
+    pthread_mutex_t         SchedMutex;
+    PdqMiningContext_t*     p_Contexts[PDQ_MINING_MAX_CONTEXTS];
+    int                     ContextCount;
+};
+
+/* Default pool settings for the mining_task.h API; set before PdqMiningStart() */
+void       PdqMiningSetThreadCount(int n);
+void       PdqMiningSetShareNotifier(PdqEventNotifier_t* p_Notifier);
+
+/* Threads is clamped to 1..PDQ_MINING_MAX_THREADS. p_Notifier may be NULL. */
+PdqError_t PdqMiningPoolInit(PdqMiningPool_t* p_Pool, int Threads, PdqEventNotifier_t* p_Notifier);
+
+/* Contexts are attached before the pool starts and stay attached until
+ * it stops. Weight 0 counts as 1. */
+PdqError_t PdqMiningPoolAttach(PdqMiningPool_t* p_Pool, PdqMiningContext_t* p_Ctx, uint32_t Weight);
+PdqError_t PdqMiningPoolStart(PdqMiningPool_t* p_Pool);
+PdqError_t PdqMiningPoolStop(PdqMiningPool_t* p_Pool);
+
+/* Change the thread count of a running pool without stopping it: new
+ * threads are started, or the surplus ones finish their batch and are
+ * joined. The new split applies from each context's next job; the
+ * remaining threads finish the current ones on their old ranges, so no
+ * nonce is hashed twice, and new threads wait for the next
+ * PdqMiningCtxSetJob. Call from the thread that started the pool. */
+PdqError_t PdqMiningPoolResize(PdqMiningPool_t* p_Pool, int Threads);
+PdqError_t PdqMiningPoolSetWeight(PdqMiningPool_t* p_Pool, PdqMiningContext_t* p_Ctx, uint32_t Weight);
+bool       PdqMiningPoolIsRunning(const PdqMiningPool_t* p_Pool);
+
+/* Per-thread counters for the running threads; returns how many were
+ * filled. Rates are refreshed at most once a second, so call it from one
+ * thread only. */
+int        PdqMiningPoolGetThreadStats(PdqMiningPool_t* p_Pool, PdqMiningThreadStats_t* p_Stats, int Max);
+
+PdqError_t PdqMiningCtxInit(PdqMiningContext_t* p_Ctx);
+PdqError_t PdqMiningCtxSetJob(PdqMiningContext_t* p_Ctx, const PdqMiningJob_t* p_Job);
+PdqError_t PdqMiningCtxSetLanWork(PdqMiningContext_t* p_Ctx, const PdqLanWork_t* p_Work);
+PdqError_t PdqMiningCtxGetStats(PdqMiningContext_t* p_Ctx, PdqMinerStats_t* p_Stats);
+bool       PdqMiningCtxHasShare(PdqMiningContext_t* p_Ctx);
+PdqError_t PdqMiningCtxGetShare(PdqMiningContext_t* p_Ctx, PdqShareInfo_t* p_Share);
+void       PdqMiningCtxClearShares(PdqMiningContext_t* p_Ctx);
+void       PdqMiningCtxPause(PdqMiningContext_t* p_Ctx);
+void       PdqMiningCtxResume(PdqMiningContext_t* p_Ctx);
+void       PdqMiningCtxRecordSubmitResult(PdqMiningContext_t* p_Ctx, PdqSubmitResult_t Result,
+                                          uint32_t LatencyMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
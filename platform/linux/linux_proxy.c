@@ -0,0 +1,1280 @@
+/**
+ * @file linux_proxy.c
+ * @brief Stratum V1 proxy implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Clients are heap objects referenced from a dense array, so broadcasts
+ * walk only live connections; closing swaps the last entry into the gap,
+ * which is why every broadcast walks the array backwards. A closed
+ * client is freed on the next entry into this module rather than on the
+ * spot, so a close deep inside a request handler never leaves the
+ * caller holding a dangling pointer.
+ */
+
+#include "linux_proxy.h"
+#include "linux_event.h"
+#include "stratum/stratum_json.h"
+#include "stratum/vardiff.h"
+#include "stratum/lan_proto.h"
+#include "core/target.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#ifdef MSG_NOSIGNAL
+#define PROXY_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define PROXY_SEND_FLAGS 0
+#endif
+
+#define PROXY_MAX_TOKENS     48
+#define PROXY_ACCEPT_BATCH   64     /* Connections taken per wakeup */
+#define PROXY_READ_PASSES    4      /* Reads per wakeup before yielding to others */
+#define PROXY_MAX_PREFIX_LEN 4
+#define PROXY_LAN_WORKS      16     /* Work a binary device may still submit on */
+#define HASHES_PER_DIFF1     4294967296.0
+
+typedef enum {
+    PrefixFree = 0,
+    PrefixInUse,
+    PrefixParked        /* Session closed, kept for a resume */
+} PrefixState_t;
+
+typedef struct {
+    uint64_t ParkedUntilMs;
+    uint32_t Token;
+    uint8_t  State;
+} PrefixSlot_t;
+
+/* A copy of an upstream job: the decoded fields with their own storage,
+ * and the downstream mining.notify up to the clean_jobs flag */
+typedef struct {
+    PdqStratumJob_t Job;
+    uint32_t        Seq;            /* Identifies the job to binary devices' work */
+    uint32_t        NetworkTarget[8];
+    uint8_t*        p_Data;
+    uint32_t        DataCap;
+    char*           p_Notify;
+    uint32_t        NotifyLen;
+    uint32_t        NotifyCap;
+} ProxyJob_t;
+
+/* Work handed to a binary device, found again by the tag its shares carry */
+typedef struct {
+    uint32_t Tag;
+    uint32_t JobSeq;
+    uint32_t Roll;                  /* The device's part of extranonce2 */
+} ProxyWork_t;
+
+typedef struct ProxyClient {
+    int                 Fd;
+    uint32_t            Slot;           /* Index in s_Clients */
+    int32_t             Prefix;         /* -1 until subscribed */
+    bool                Authorized;
+    bool                ExtranonceSub;
+    bool                Binary;         /* Speaks lan_proto.h rather than JSON */
+    uint64_t            ConnectedMs;
+    double              Difficulty;
+    double              PrevDifficulty; /* Still honoured until the next job, 0 if none */
+    uint32_t            ShareTarget[8]; /* For the easier of the two */
+    uint64_t            WindowStartMs;
+    uint32_t            WindowShares;
+    char                Worker[PDQ_MAX_WORKER_LEN + 1];
+    uint32_t            NextTag;
+    uint32_t            NextRoll;
+    ProxyWork_t         Works[PROXY_LAN_WORKS];
+    char                In[PDQ_PROXY_LINE_MAX] __attribute__((aligned(4)));
+    uint32_t            InLen;
+    char*               p_Out;
+    uint32_t            OutLen;
+    uint32_t            OutCap;
+    struct ProxyClient* p_NextDead;
+} ProxyClient_t;
+
+static bool               s_Running = false;
+static int                s_ListenFd = -1;
+static int                s_SpareFd = -1;
+static uint16_t           s_Port = 0;
+static PdqProxyConfig_t   s_Config;
+static PdqVardiffConfig_t s_Vardiff;
+static PdqProxyStats_t    s_Stats;
+
+static ProxyClient_t**    s_Clients = NULL;
+static uint32_t           s_ClientCount = 0;
+static uint32_t           s_ClientCap = 0;
+static ProxyClient_t*     s_Dead = NULL;
+
+/* Upstream session and how its extranonce2 is split */
+static PdqStratumContext_t* s_Upstream = NULL;
+static bool               s_HaveExtranonce = false;
+static uint8_t            s_Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+static uint8_t            s_Extranonce1Len = 0;
+static uint8_t            s_Extranonce2Size = 0;
+static uint8_t            s_PrefixLen = 0;
+static PrefixSlot_t*      s_Prefixes = NULL;
+static uint32_t           s_PrefixCount = 0;
+static uint32_t           s_NextPrefix = 0;
+static uint32_t           s_TokenState = 1;
+
+static ProxyJob_t         s_Jobs[PDQ_PROXY_JOB_HISTORY];
+static uint8_t            s_JobCount = 0;
+static uint8_t            s_JobNext = 0;
+static uint32_t           s_JobSeq = 0;
+
+/* Hashes of accepted shares, open addressing; 0 marks a free slot */
+static uint64_t*          s_Seen = NULL;
+static uint32_t           s_SeenCount = 0;
+
+static PdqJsonToken_t     s_Tokens[PROXY_MAX_TOKENS];
+static char               s_Line[PDQ_PROXY_LINE_MAX];
+
+static uint64_t GetMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint32_t NextToken(void) {
+    /* xorshift32: session tokens only need to be hard to guess by accident */
+    uint32_t x = s_TokenState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    s_TokenState = x;
+    return x;
+}
+
+static bool Reserve(void** pp_Buffer, uint32_t* p_Cap, uint32_t Need) {
+    if (Need == 0) Need = 1;
+    if (*p_Cap >= Need) return true;
+    uint32_t cap = *p_Cap ? *p_Cap : 256;
+    while (cap < Need) cap *= 2;
+    void* p = realloc(*pp_Buffer, cap);
+    if (!p) return false;
+    *pp_Buffer = p;
+    *p_Cap = cap;
+    return true;
+}
+
+static char* PutHex(char* p_Out, const uint8_t* p_In, size_t Len) {
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < Len; i++) {
+        *p_Out++ = hex[p_In[i] >> 4];
+        *p_Out++ = hex[p_In[i] & 0x0F];
+    }
+    return p_Out;
+}
+
+static char* PutJsonString(char* p_Out, const char* p_Str) {
+    *p_Out++ = '"';
+    for (; *p_Str; p_Str++) {
+        if ((unsigned char)*p_Str < 0x20) continue;
+        if (*p_Str == '"' || *p_Str == '\\') *p_Out++ = '\\';
+        *p_Out++ = *p_Str;
+    }
+    *p_Out++ = '"';
+    return p_Out;
+}
+
+/* ---- Output ---- */
+
+static void CloseClient(ProxyClient_t* c, const char* Reason);
+
+static void WatchClient(ProxyClient_t* c) {
+    PdqEventModify(c->Fd, c->OutLen ? (PDQ_EVENT_READ | PDQ_EVENT_WRITE) : PDQ_EVENT_READ);
+}
+
+static bool FlushClient(ProxyClient_t* c) {
+    uint32_t sent = 0;
+    while (sent < c->OutLen) {
+        ssize_t n = send(c->Fd, c->p_Out + sent, c->OutLen - sent, PROXY_SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        sent += (uint32_t)n;
+    }
+    memmove(c->p_Out, c->p_Out + sent, c->OutLen - sent);
+    c->OutLen -= sent;
+    return true;
+}
+
+/* Write now if nothing is queued, queue the rest. A device that stops
+ * reading is dropped once PDQ_PROXY_TX_MAX bytes are waiting for it. */
+static void SendText(ProxyClient_t* c, const char* p_Text, size_t Len) {
+    if (c->Fd < 0) return;
+
+    size_t sent = 0;
+    if (c->OutLen == 0) {
+        ssize_t n = send(c->Fd, p_Text, Len, PROXY_SEND_FLAGS);
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            CloseClient(c, NULL);
+            return;
+        }
+        if (n > 0) sent = (size_t)n;
+    }
+    if (sent == Len) return;
+
+    size_t rest = Len - sent;
+    if (c->OutLen + rest > PDQ_PROXY_TX_MAX) {
+        CloseClient(c, "not reading");
+        return;
+    }
+    if (!Reserve((void**)&c->p_Out, &c->OutCap, c->OutLen + (uint32_t)rest)) {
+        CloseClient(c, "out of memory");
+        return;
+    }
+    bool wasIdle = c->OutLen == 0;
+    memcpy(c->p_Out + c->OutLen, p_Text + sent, rest);
+    c->OutLen += (uint32_t)rest;
+    if (wasIdle) WatchClient(c);
+}
+
+static void SendLine(ProxyClient_t* c, int Len) {
+    if (Len > 0 && Len < (int)sizeof(s_Line)) SendText(c, s_Line, (size_t)Len);
+}
+
+static void Reply(ProxyClient_t* c, const char* p_Id, const char* p_Result) {
+    SendLine(c, snprintf(s_Line, sizeof(s_Line),
+                         "{\"id\":%s,\"result\":%s,\"error\":null}\n", p_Id, p_Result));
+}
+
+static void ReplyError(ProxyClient_t* c, const char* p_Id, int Code, const char* p_Message) {
+    SendLine(c, snprintf(s_Line, sizeof(s_Line),
+                         "{\"id\":%s,\"result\":null,\"error\":[%d,\"%s\",null]}\n",
+                         p_Id, Code, p_Message));
+}
+
+/* ---- Jobs ---- */
+
+static ProxyJob_t* NewestJob(void) {
+    if (s_JobCount == 0) return NULL;
+    return &s_Jobs[(s_JobNext + PDQ_PROXY_JOB_HISTORY - 1) % PDQ_PROXY_JOB_HISTORY];
+}
+
+static ProxyJob_t* FindJob(const PdqJsonDoc_t* p_Doc, int Token) {
+    for (uint8_t i = 1; i <= s_JobCount; i++) {
+        ProxyJob_t* j = &s_Jobs[(s_JobNext + PDQ_PROXY_JOB_HISTORY - i) % PDQ_PROXY_JOB_HISTORY];
+        if (PdqJsonEquals(p_Doc, Token, j->Job.JobId)) return j;
+    }
+    return NULL;
+}
+
+static ProxyJob_t* FindJobSeq(uint32_t Seq) {
+    for (uint8_t i = 1; i <= s_JobCount; i++) {
+        ProxyJob_t* j = &s_Jobs[(s_JobNext + PDQ_PROXY_JOB_HISTORY - i) % PDQ_PROXY_JOB_HISTORY];
+        if (j->Seq == Seq) return j;
+    }
+    return NULL;
+}
+
+/* The notify line with the flag in place. The tail is patched into the
+ * job's own buffer, so the line is only valid until the next call. */
+static const char* JobLine(ProxyJob_t* j, bool Clean, size_t* p_Len) {
+    const char* tail = Clean ? "true]}\n" : "false]}\n";
+    size_t tailLen = strlen(tail);
+    memcpy(j->p_Notify + j->NotifyLen, tail, tailLen + 1);
+    *p_Len = j->NotifyLen + tailLen;
+    return j->p_Notify;
+}
+
+static void SendLanWork(ProxyClient_t* c, bool Clean);
+
+static void SendJob(ProxyClient_t* c, bool Clean) {
+    if (c->Binary) {
+        SendLanWork(c, Clean);
+        return;
+    }
+    ProxyJob_t* j = NewestJob();
+    if (!j) return;
+    size_t len;
+    const char* line = JobLine(j, Clean, &len);
+    SendText(c, line, len);
+}
+
+static PdqError_t StoreJob(const PdqStratumJob_t* p_Src) {
+    ProxyJob_t* j = &s_Jobs[s_JobNext];
+    uint32_t branchBytes = (uint32_t)p_Src->MerkleBranchCount * 32;
+    uint32_t dataLen = p_Src->Coinbase1Len + p_Src->Coinbase2Len + branchBytes;
+    uint32_t lineCap = 160 + 2 * PDQ_STRATUM_MAX_JOBID_LEN + 64 +
+                       2 * (p_Src->Coinbase1Len + p_Src->Coinbase2Len) +
+                       (uint32_t)p_Src->MerkleBranchCount * 67 + 40;
+    if (!Reserve((void**)&j->p_Data, &j->DataCap, dataLen) ||
+        !Reserve((void**)&j->p_Notify, &j->NotifyCap, lineCap)) {
+        return PdqErrorNoMemory;
+    }
+
+    j->Job = *p_Src;
+    j->Seq = ++s_JobSeq;
+    uint8_t* p = j->p_Data;
+    memcpy(p, p_Src->p_Coinbase1, p_Src->Coinbase1Len);
+    j->Job.p_Coinbase1 = p;
+    p += p_Src->Coinbase1Len;
+    memcpy(p, p_Src->p_Coinbase2, p_Src->Coinbase2Len);
+    j->Job.p_Coinbase2 = p;
+    p += p_Src->Coinbase2Len;
+    if (branchBytes) memcpy(p, p_Src->p_MerkleBranches, branchBytes);
+    j->Job.p_MerkleBranches = (const uint8_t (*)[32])p;
+    j->Job.CleanJobs = false;
+    if (PdqTargetFromNBits(p_Src->NBits, j->NetworkTarget) != PdqOk) {
+        memset(j->NetworkTarget, 0, sizeof(j->NetworkTarget));
+    }
+
+    /* Stratum sends the previous block hash as 32-bit words in the
+     * opposite order to the one the decoder keeps */
+    uint8_t prevHash[32];
+    for (int w = 0; w < 8; w++) {
+        for (int b = 0; b < 4; b++) prevHash[w * 4 + b] = p_Src->PrevBlockHash[w * 4 + 3 - b];
+    }
+
+    char* out = j->p_Notify;
+    out += sprintf(out, "{\"id\":null,\"method\":\"mining.notify\",\"params\":[");
+    out = PutJsonString(out, p_Src->JobId);
+    out += sprintf(out, ",\"");
+    out = PutHex(out, prevHash, 32);
+    out += sprintf(out, "\",\"");
+    out = PutHex(out, p_Src->p_Coinbase1, p_Src->Coinbase1Len);
+    out += sprintf(out, "\",\"");
+    out = PutHex(out, p_Src->p_Coinbase2, p_Src->Coinbase2Len);
+    out += sprintf(out, "\",[");
+    for (uint16_t i = 0; i < p_Src->MerkleBranchCount; i++) {
+        out += sprintf(out, i ? ",\"" : "\"");
+        out = PutHex(out, p_Src->p_MerkleBranches[i], 32);
+        *out++ = '"';
+    }
+    out += sprintf(out, "],\"%08x\",\"%08x\",\"%08x\",",
+                   (unsigned)p_Src->Version, (unsigned)p_Src->NBits, (unsigned)p_Src->NTime);
+    j->NotifyLen = (uint32_t)(out - j->p_Notify);
+
+    s_JobNext = (uint8_t)((s_JobNext + 1) % PDQ_PROXY_JOB_HISTORY);
+    if (s_JobCount < PDQ_PROXY_JOB_HISTORY) s_JobCount++;
+    return PdqOk;
+}
+
+/* ---- Duplicate shares ---- */
+
+static void ClearSeen(void) {
+    if (s_Seen) memset(s_Seen, 0, PDQ_PROXY_DEDUPE_SLOTS * sizeof(uint64_t));
+    s_SeenCount = 0;
+}
+
+/* False if this hash was accepted before. Keyed on the low 64 bits of
+ * the hash, the part a share's difficulty leaves random. */
+static bool Remember(const uint32_t* p_Hash) {
+    uint64_t key = ((uint64_t)p_Hash[1] << 32) | p_Hash[0];
+    if (key == 0) key = 1;
+    if (s_SeenCount >= PDQ_PROXY_DEDUPE_SLOTS / 4 * 3) ClearSeen();
+
+    uint32_t i = (uint32_t)(key ^ (key >> 32)) & (PDQ_PROXY_DEDUPE_SLOTS - 1);
+    while (s_Seen[i]) {
+        if (s_Seen[i] == key) return false;
+        i = (i + 1) & (PDQ_PROXY_DEDUPE_SLOTS - 1);
+    }
+    s_Seen[i] = key;
+    s_SeenCount++;
+    return true;
+}
+
+/* ---- Extranonce prefixes ---- */
+
+/* Bytes of the upstream extranonce2 reserved for the prefix. Devices
+ * keep at least two bytes to roll, and up to 65536 of them fit. */
+static uint8_t PrefixLenFor(uint8_t Extranonce2Size) {
+    if (Extranonce2Size < 2) return 0;
+    if (Extranonce2Size < 4) return 1;
+    if (Extranonce2Size == 4) return 2;
+    uint8_t len = (uint8_t)(Extranonce2Size - 4);
+    return len > PROXY_MAX_PREFIX_LEN ? PROXY_MAX_PREFIX_LEN : len;
+}
+
+static void PutPrefix(uint8_t* p_Out, uint32_t Prefix) {
+    for (uint8_t i = 0; i < s_PrefixLen; i++) {
+        uint8_t shift = (uint8_t)(8 * (s_PrefixLen - 1 - i));
+        p_Out[i] = shift < 32 ? (uint8_t)(Prefix >> shift) : 0;
+    }
+}
+
+/* The offered session's prefix if it is parked under the same token,
+ * else the next free one */
+static int32_t ClaimPrefix(int64_t Offered, uint32_t Token, uint64_t NowMs) {
+    if (Offered >= 0 && Offered < (int64_t)s_PrefixCount) {
+        PrefixSlot_t* slot = &s_Prefixes[Offered];
+        if (slot->State == PrefixParked && slot->Token == Token) {
+            slot->State = PrefixInUse;
+            s_Stats.Resumes++;
+            return (int32_t)Offered;
+        }
+    }
+
+    for (uint32_t k = 0; k < s_PrefixCount; k++) {
+        uint32_t i = (s_NextPrefix + k) % s_PrefixCount;
+        PrefixSlot_t* slot = &s_Prefixes[i];
+        if (slot->State == PrefixInUse) continue;
+        if (slot->State == PrefixParked && slot->ParkedUntilMs > NowMs) continue;
+        slot->State = PrefixInUse;
+        slot->Token = NextToken();
+        s_NextPrefix = (i + 1) % s_PrefixCount;
+        return (int32_t)i;
+    }
+    return -1;
+}
+
+static void ReleasePrefix(ProxyClient_t* c) {
+    if (c->Prefix < 0 || (uint32_t)c->Prefix >= s_PrefixCount) return;
+    PrefixSlot_t* slot = &s_Prefixes[c->Prefix];
+    slot->State = PrefixParked;
+    slot->ParkedUntilMs = GetMillis() + PDQ_PROXY_RESUME_MS;
+    c->Prefix = -1;
+}
+
+/* The full upstream extranonce2 of a binary device's work: its prefix,
+ * then the roll counter little-endian, as PdqStratumBuildMiningJob lays
+ * out a counter */
+static void PutExtranonce2(const ProxyClient_t* c, uint32_t Roll, uint8_t* p_Out) {
+    PutPrefix(p_Out, (uint32_t)c->Prefix);
+    for (uint8_t i = s_PrefixLen; i < s_Extranonce2Size; i++) {
+        uint8_t shift = (uint8_t)(8 * (i - s_PrefixLen));
+        p_Out[i] = shift < 32 ? (uint8_t)(Roll >> shift) : 0;
+    }
+}
+
+static int FormatExtranonce1(const ProxyClient_t* c, char* p_Out) {
+    uint8_t prefix[PROXY_MAX_PREFIX_LEN];
+    PutPrefix(prefix, (uint32_t)c->Prefix);
+    char* p = PutHex(p_Out, s_Extranonce1, s_Extranonce1Len);
+    p = PutHex(p, prefix, s_PrefixLen);
+    *p = '\0';
+    return (int)(p - p_Out);
+}
+
+/* ---- Difficulty ---- */
+
+static void UpdateShareTarget(ProxyClient_t* c) {
+    double easiest = c->Difficulty;
+    if (c->PrevDifficulty > 0.0 && c->PrevDifficulty < easiest) easiest = c->PrevDifficulty;
+    PdqTargetFromDifficulty(easiest, c->ShareTarget);
+}
+
+static double ClampDifficulty(double Difficulty) {
+    if (Difficulty < s_Vardiff.MinDifficulty) return s_Vardiff.MinDifficulty;
+    if (Difficulty > s_Vardiff.MaxDifficulty) return s_Vardiff.MaxDifficulty;
+    return Difficulty;
+}
+
+/* Binary devices get their target with every piece of work */
+static void SendDifficulty(ProxyClient_t* c) {
+    if (c->Binary) return;
+    SendLine(c, snprintf(s_Line, sizeof(s_Line),
+                         "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[%.8g]}\n",
+                         c->Difficulty));
+}
+
+/* Shares already in flight were found at the old difficulty, so it stays
+ * acceptable until the next job. Most miners only apply a new difficulty
+ * to new work, hence the job is sent again. */
+static void SetDifficulty(ProxyClient_t* c, double Difficulty) {
+    if (Difficulty == c->Difficulty) return;
+    c->PrevDifficulty = c->Difficulty;
+    c->Difficulty = Difficulty;
+    UpdateShareTarget(c);
+    if (c->Authorized) {
+        SendDifficulty(c);
+        SendJob(c, false);
+    }
+}
+
+/* Share-count vardiff: the proxy never sees a device's hashrate, only its
+ * shares. A window without any counts as one share in twice the window.
+ * A device flooding shares far below the band is retargeted at once. */
+static void Retarget(ProxyClient_t* c, uint64_t NowMs) {
+    if (s_Config.ShareIntervalMs == 0 || NowMs < c->WindowStartMs) return;
+
+    uint64_t elapsed = NowMs - c->WindowStartMs;
+    bool flood = c->WindowShares >= 4 * PDQ_VARDIFF_MIN_SHARES &&
+                 elapsed * 4 < (uint64_t)c->WindowShares * s_Vardiff.IntervalLowMs;
+    if (elapsed < s_Vardiff.RetargetMs && !flood) return;
+    if (elapsed == 0) elapsed = 1;
+
+    double intervalMs = c->WindowShares ? (double)elapsed / c->WindowShares : 2.0 * (double)elapsed;
+    c->WindowStartMs = NowMs;
+    c->WindowShares = 0;
+    if (intervalMs >= s_Vardiff.IntervalLowMs && intervalMs <= s_Vardiff.IntervalHighMs) return;
+
+    double ideal = ClampDifficulty(c->Difficulty * s_Vardiff.TargetIntervalMs / intervalMs);
+    double ratio = ideal / c->Difficulty;
+    if (ratio > 1.0 - PDQ_VARDIFF_MIN_STEP && ratio < 1.0 + PDQ_VARDIFF_MIN_STEP) return;
+
+    s_Stats.Retargets++;
+    SetDifficulty(c, ideal);
+}
+
+/* ---- Requests ---- */
+
+/* The request id echoed back verbatim: a number, a short string or null */
+static void FormatId(const PdqJsonDoc_t* p_Doc, int Token, char* p_Out, size_t Size) {
+    PdqJsonType_t type = PdqJsonTypeOf(p_Doc, Token);
+    const PdqJsonToken_t* t = (Token >= 0) ? &p_Doc->p_Tokens[Token] : NULL;
+    size_t len = t ? t->End - t->Start : 0;
+    if (type == PdqJsonNumber && len + 1 <= Size) {
+        memcpy(p_Out, p_Doc->p_Json + t->Start, len);
+        p_Out[len] = '\0';
+    } else if (type == PdqJsonString && len + 3 <= Size) {
+        p_Out[0] = '"';
+        memcpy(p_Out + 1, p_Doc->p_Json + t->Start, len);
+        p_Out[len + 1] = '"';
+        p_Out[len + 2] = '\0';
+    } else {
+        snprintf(p_Out, Size, "null");
+    }
+}
+
+/* A session id is the prefix and its token, 8 hex digits each */
+static bool ParseSessionId(const PdqJsonDoc_t* p_Doc, int Token, int64_t* p_Prefix, uint32_t* p_Token) {
+    char id[20];
+    if (PdqJsonGetString(p_Doc, Token, id, sizeof(id)) != 16) return false;
+    uint64_t v = 0;
+    for (int i = 0; i < 16; i++) {
+        char ch = id[i];
+        uint8_t d;
+        if (ch >= '0' && ch <= '9') d = (uint8_t)(ch - '0');
+        else if (ch >= 'a' && ch <= 'f') d = (uint8_t)(ch - 'a' + 10);
+        else if (ch >= 'A' && ch <= 'F') d = (uint8_t)(ch - 'A' + 10);
+        else return false;
+        v = (v << 4) | d;
+    }
+    *p_Prefix = (int64_t)(v >> 32);
+    *p_Token = (uint32_t)v;
+    return true;
+}
+
+static void HandleSubscribe(ProxyClient_t* c, const PdqJsonDoc_t* p_Doc, int Params, const char* p_Id) {
+    if (!s_HaveExtranonce) {
+        ReplyError(c, p_Id, 20, "Upstream pool not ready");
+        return;
+    }
+    if (c->Prefix < 0) {
+        int64_t offered = -1;
+        uint32_t token = 0;
+        ParseSessionId(p_Doc, PdqJsonArrayGet(p_Doc, Params, 1), &offered, &token);
+        c->Prefix = ClaimPrefix(offered, token, GetMillis());
+        if (c->Prefix < 0) {
+            ReplyError(c, p_Id, 20, "Proxy full");
+            CloseClient(c, "no extranonce prefix left");
+            return;
+        }
+    }
+
+    char extranonce1[2 * (PDQ_STRATUM_MAX_EXTRANONCE_LEN + PROXY_MAX_PREFIX_LEN) + 1];
+    FormatExtranonce1(c, extranonce1);
+    char session[17];
+    snprintf(session, sizeof(session), "%08x%08x",
+             (unsigned)c->Prefix, (unsigned)s_Prefixes[c->Prefix].Token);
+    SendLine(c, snprintf(s_Line, sizeof(s_Line),
+                         "{\"id\":%s,\"result\":[[[\"mining.set_difficulty\",\"%s\"],"
+                         "[\"mining.notify\",\"%s\"]],\"%s\",%u],\"error\":null}\n",
+                         p_Id, session, session, extranonce1,
+                         (unsigned)(s_Extranonce2Size - s_PrefixLen)));
+}
+
+/* Workers are not checked: the pool only ever sees the proxy's own */
+static void HandleAuthorize(ProxyClient_t* c, const PdqJsonDoc_t* p_Doc, int Params, const char* p_Id) {
+    if (c->Prefix < 0) {
+        ReplyError(c, p_Id, 25, "Not subscribed");
+        return;
+    }
+    PdqJsonGetString(p_Doc, PdqJsonArrayGet(p_Doc, Params, 0), c->Worker, sizeof(c->Worker));
+    bool first = !c->Authorized;
+    c->Authorized = true;
+    Reply(c, p_Id, "true");
+    if (!first) return;
+
+    /* A device that reconnects is mining again one round trip later */
+    c->WindowStartMs = GetMillis();
+    c->WindowShares = 0;
+    SendDifficulty(c);
+    SendJob(c, true);
+}
+
+static void HandleSuggest(ProxyClient_t* c, const PdqJsonDoc_t* p_Doc, int Params, const char* p_Id) {
+    double suggested;
+    if (!PdqJsonGetDouble(p_Doc, PdqJsonArrayGet(p_Doc, Params, 0), &suggested) || suggested <= 0.0) {
+        ReplyError(c, p_Id, 20, "Invalid difficulty");
+        return;
+    }
+    Reply(c, p_Id, "true");
+    SetDifficulty(c, ClampDifficulty(suggested));
+    c->WindowStartMs = GetMillis();
+    c->WindowShares = 0;
+}
+
+/* Verify a share on one of the device's jobs. 0 if it is accepted and
+ * counted, else the Stratum error code with the reason in pp_Message. */
+static int CheckShare(ProxyClient_t* c, const ProxyJob_t* p_Job, const uint8_t* p_Extranonce2,
+                      uint32_t NTime, uint32_t Nonce, uint32_t* p_Hash, const char** pp_Message) {
+    if (NTime < p_Job->Job.NTime || NTime - p_Job->Job.NTime > PDQ_PROXY_NTIME_RANGE) {
+        s_Stats.SharesRejected++;
+        *pp_Message = "Time out of range";
+        return 20;
+    }
+
+    uint8_t header[80];
+    PdqStratumBuildHeader(&p_Job->Job, s_Extranonce1, s_Extranonce1Len,
+                          p_Extranonce2, s_Extranonce2Size, header);
+    for (int i = 0; i < 4; i++) {
+        header[68 + i] = (uint8_t)(NTime >> (8 * i));
+        header[76 + i] = (uint8_t)(Nonce >> (8 * i));
+    }
+    PdqTargetHashHeader(header, p_Hash);
+
+    if (PdqTargetCompare(p_Hash, c->ShareTarget) > 0) {
+        s_Stats.SharesRejected++;
+        *pp_Message = "Low difficulty share";
+        return 23;
+    }
+    if (!Remember(p_Hash)) {
+        s_Stats.SharesDuplicate++;
+        *pp_Message = "Duplicate share";
+        return 22;
+    }
+
+    double credited = c->PrevDifficulty > 0.0 && c->PrevDifficulty < c->Difficulty
+                    ? c->PrevDifficulty : c->Difficulty;
+    s_Stats.SharesAccepted++;
+    s_Stats.TotalHashes += (uint64_t)(credited * HASHES_PER_DIFF1);
+    c->WindowShares++;
+    return 0;
+}
+
+/* Pass an accepted share on if it also meets the pool's difficulty */
+static void ForwardShare(const ProxyClient_t* c, const ProxyJob_t* p_Job, const uint8_t* p_Extranonce2,
+                         uint32_t NTime, uint32_t Nonce, const uint32_t* p_Hash) {
+    bool block = PdqTargetCompare(p_Hash, p_Job->NetworkTarget) <= 0;
+    uint32_t poolTarget[8];
+    PdqTargetFromDifficulty(s_Upstream ? PdqStratumCtxGetDifficulty(s_Upstream) : 1.0, poolTarget);
+    if (!block && PdqTargetCompare(p_Hash, poolTarget) > 0) return;
+
+    if (s_Upstream && PdqStratumCtxIsReady(s_Upstream) &&
+        PdqStratumCtxSubmitShareBytes(s_Upstream, p_Job->Job.JobId, p_Extranonce2, s_Extranonce2Size,
+                                      Nonce, NTime) == PdqOk) {
+        s_Stats.SharesForwarded++;
+    } else {
+        s_Stats.SharesUnforwarded++;
+    }
+    if (block) printf("[PROXY] Block candidate from %s: nonce=%08X\n", c->Worker, Nonce);
+}
+
+/* mining.submit [worker, job, extranonce2, ntime, nonce] */
+static void HandleSubmit(ProxyClient_t* c, const PdqJsonDoc_t* p_Doc, int Params, const char* p_Id) {
+    if (!c->Authorized) {
+        ReplyError(c, p_Id, 24, "Unauthorized worker");
+        return;
+    }
+
+    ProxyJob_t* job = FindJob(p_Doc, PdqJsonArrayGet(p_Doc, Params, 1));
+    if (!job) {
+        s_Stats.SharesStale++;
+        ReplyError(c, p_Id, 21, "Job not found");
+        return;
+    }
+
+    uint8_t extranonce2[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    PutPrefix(extranonce2, (uint32_t)c->Prefix);
+    int32_t rolled = PdqJsonGetHex(p_Doc, PdqJsonArrayGet(p_Doc, Params, 2), extranonce2 + s_PrefixLen,
+                                   sizeof(extranonce2) - s_PrefixLen);
+    uint32_t ntime, nonce;
+    if (rolled != (int32_t)(s_Extranonce2Size - s_PrefixLen) ||
+        !PdqJsonGetHexU32(p_Doc, PdqJsonArrayGet(p_Doc, Params, 3), &ntime) ||
+        !PdqJsonGetHexU32(p_Doc, PdqJsonArrayGet(p_Doc, Params, 4), &nonce)) {
+        s_Stats.SharesRejected++;
+        ReplyError(c, p_Id, 20, "Malformed share");
+        return;
+    }
+
+    uint32_t hash[8];
+    const char* message = NULL;
+    int code = CheckShare(c, job, extranonce2, ntime, nonce, hash, &message);
+    if (code != 0) {
+        ReplyError(c, p_Id, code, message);
+        return;
+    }
+    Reply(c, p_Id, "true");
+    ForwardShare(c, job, extranonce2, ntime, nonce, hash);
+    if (c->Fd >= 0) Retarget(c, GetMillis());
+}
+
+static void HandleLine(ProxyClient_t* c, const char* p_Line, size_t Len) {
+    PdqJsonDoc_t doc;
+    if (PdqJsonParse(&doc, p_Line, Len, s_Tokens, PROXY_MAX_TOKENS) != PdqOk ||
+        PdqJsonTypeOf(&doc, 0) != PdqJsonObject) {
+        CloseClient(c, "malformed request");
+        return;
+    }
+
+    char id[24];
+    FormatId(&doc, PdqJsonObjectGet(&doc, 0, "id"), id, sizeof(id));
+    int method = PdqJsonObjectGet(&doc, 0, "method");
+    int params = PdqJsonObjectGet(&doc, 0, "params");
+
+    if (PdqJsonEquals(&doc, method, "mining.submit")) {
+        HandleSubmit(c, &doc, params, id);
+    } else if (PdqJsonEquals(&doc, method, "mining.subscribe")) {
+        HandleSubscribe(c, &doc, params, id);
+    } else if (PdqJsonEquals(&doc, method, "mining.authorize")) {
+        HandleAuthorize(c, &doc, params, id);
+    } else if (PdqJsonEquals(&doc, method, "mining.extranonce.subscribe")) {
+        c->ExtranonceSub = true;
+        Reply(c, id, "true");
+    } else if (PdqJsonEquals(&doc, method, "mining.suggest_difficulty")) {
+        HandleSuggest(c, &doc, params, id);
+    } else if (method >= 0) {
+        ReplyError(c, id, 20, "Unsupported method");
+    }
+}
+
+/* ---- Binary devices ---- */
+
+/* Fresh work on the newest job: the next roll of the device's extranonce2,
+ * hashed into a header here so the device only has to search nonces */
+static void SendLanWork(ProxyClient_t* c, bool Clean) {
+    ProxyJob_t* j = NewestJob();
+    if (!j || c->Prefix < 0) return;
+
+    ProxyWork_t* w = &c->Works[c->NextTag % PROXY_LAN_WORKS];
+    w->Tag = c->NextTag++;
+    if (c->NextTag == 0) c->NextTag = 1;
+    w->JobSeq = j->Seq;
+    w->Roll = c->NextRoll++;
+
+    uint8_t extranonce2[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t header[80];
+    PutExtranonce2(c, w->Roll, extranonce2);
+    PdqStratumBuildHeader(&j->Job, s_Extranonce1, s_Extranonce1Len, extranonce2, s_Extranonce2Size, header);
+
+    PdqMiningJob_t job;
+    memset(&job, 0, sizeof(job));
+    PdqStratumHeaderToMiningJob(header, &job);
+    PdqTargetFromDifficulty(c->Difficulty, job.Target);
+    job.NonceStart = 0;
+    job.NonceEnd = 0xFFFFFFFF;
+    job.Extranonce2 = w->Roll;
+    job.NTime = j->Job.NTime;
+
+    PdqLanWork_t msg;
+    PdqLanEncodeWork(&job, w->Tag, Clean ? PDQ_LAN_WORK_CLEAN : 0, &msg);
+    SendText(c, (const char*)&msg, sizeof(msg));
+}
+
+static void SendResult(ProxyClient_t* c, uint32_t Tag, uint32_t Nonce, int32_t Code) {
+    PdqLanResult_t msg;
+    PdqLanEncodeResult(Tag, Nonce, Code, &msg);
+    SendText(c, (const char*)&msg, sizeof(msg));
+}
+
+/* The binary subscribe and authorize in one: the device gets a prefix
+ * the first time and new work every time */
+static void HandleWorkRequest(ProxyClient_t* c, const PdqLanWorkRequest_t* p_Req) {
+    if (!s_HaveExtranonce) {
+        SendResult(c, 0, 0, 20);
+        return;
+    }
+    if (c->Prefix < 0) {
+        c->Prefix = ClaimPrefix(-1, 0, GetMillis());
+        if (c->Prefix < 0) {
+            SendResult(c, 0, 0, 20);
+            CloseClient(c, "no extranonce prefix left");
+            return;
+        }
+    }
+    if (!c->Authorized) {
+        size_t len = strnlen(p_Req->Worker, PDQ_LAN_WORKER_LEN);
+        memcpy(c->Worker, p_Req->Worker, len);
+        c->Worker[len] = '\0';
+        c->Authorized = true;
+        c->WindowStartMs = GetMillis();
+        c->WindowShares = 0;
+    }
+    SendLanWork(c, true);
+}
+
+static void HandleLanShare(ProxyClient_t* c, const PdqLanShare_t* p_Share) {
+    if (!c->Authorized) {
+        SendResult(c, p_Share->JobTag, p_Share->Nonce, 24);
+        return;
+    }
+
+    const ProxyWork_t* w = &c->Works[p_Share->JobTag % PROXY_LAN_WORKS];
+    ProxyJob_t* job = (p_Share->JobTag != 0 && w->Tag == p_Share->JobTag) ? FindJobSeq(w->JobSeq) : NULL;
+    if (!job) {
+        s_Stats.SharesStale++;
+        SendResult(c, p_Share->JobTag, p_Share->Nonce, 21);
+        return;
+    }
+
+    uint8_t extranonce2[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    PutExtranonce2(c, w->Roll, extranonce2);
+    uint32_t hash[8];
+    const char* message = NULL;
+    int code = CheckShare(c, job, extranonce2, p_Share->NTime, p_Share->Nonce, hash, &message);
+    SendResult(c, p_Share->JobTag, p_Share->Nonce, code);
+    if (code != 0) return;
+    ForwardShare(c, job, extranonce2, p_Share->NTime, p_Share->Nonce, hash);
+    if (c->Fd >= 0) Retarget(c, GetMillis());
+}
+
+static void HandleMessage(ProxyClient_t* c, const char* p_Msg, size_t Len) {
+    const PdqLanHeader_t* header = (const PdqLanHeader_t*)p_Msg;
+    if (header->Type == PDQ_LAN_MSG_SHARE) {
+        const PdqLanShare_t* share = PdqLanViewShare(p_Msg, Len);
+        if (share) {
+            HandleLanShare(c, share);
+            return;
+        }
+    } else if (header->Type == PDQ_LAN_MSG_WORK_REQUEST) {
+        const PdqLanWorkRequest_t* req = PdqLanViewWorkRequest(p_Msg, Len);
+        if (req) {
+            HandleWorkRequest(c, req);
+            return;
+        }
+    }
+    CloseClient(c, "malformed message");
+}
+
+/* ---- Connections ---- */
+
+static void CloseClient(ProxyClient_t* c, const char* Reason) {
+    if (c->Fd < 0) return;
+    if (Reason) {
+        printf("[PROXY] Closing %s: %s\n", c->Worker[0] ? c->Worker : "device", Reason);
+        s_Stats.Dropped++;
+    }
+    PdqEventRemove(c->Fd);
+    close(c->Fd);
+    c->Fd = -1;
+    ReleasePrefix(c);
+
+    s_Clients[c->Slot] = s_Clients[--s_ClientCount];
+    s_Clients[c->Slot]->Slot = c->Slot;
+    c->p_NextDead = s_Dead;
+    s_Dead = c;
+}
+
+static void ReapClients(void) {
+    while (s_Dead) {
+        ProxyClient_t* c = s_Dead;
+        s_Dead = c->p_NextDead;
+        free(c->p_Out);
+        free(c);
+    }
+}
+
+static void CloseAll(const char* Reason) {
+    for (uint32_t i = s_ClientCount; i-- > 0;) CloseClient(s_Clients[i], Reason);
+}
+
+/* Every complete line in c->In; returns the bytes consumed */
+static uint32_t HandleLines(ProxyClient_t* c) {
+    char* start = c->In;
+    char* end = c->In + c->InLen;
+    char* nl;
+    while (c->Fd >= 0 && (nl = (char*)memchr(start, '\n', (size_t)(end - start))) != NULL) {
+        size_t len = (size_t)(nl - start);
+        if (len > 0 && start[len - 1] == '\r') len--;
+        if (len > 0) HandleLine(c, start, len);
+        start = nl + 1;
+    }
+    return (uint32_t)(start - c->In);
+}
+
+/* Every complete binary message in c->In, read in place. Messages are
+ * whole words and the rest is moved to the front, so each one starts
+ * 4-byte aligned. */
+static uint32_t HandleMessages(ProxyClient_t* c) {
+    uint32_t pos = 0;
+    while (c->Fd >= 0) {
+        int32_t len = PdqLanMessageLength((const uint8_t*)c->In + pos, c->InLen - pos);
+        if (len < 0) {
+            CloseClient(c, "malformed message");
+            break;
+        }
+        if (len == 0 || (uint32_t)len > c->InLen - pos) break;
+        HandleMessage(c, c->In + pos, (size_t)len);
+        pos += (uint32_t)len;
+    }
+    return pos;
+}
+
+static void ReadClient(ProxyClient_t* c) {
+    for (int pass = 0; pass < PROXY_READ_PASSES && c->Fd >= 0; pass++) {
+        ssize_t n = recv(c->Fd, c->In + c->InLen, sizeof(c->In) - c->InLen, 0);
+        if (n == 0) {
+            CloseClient(c, NULL);
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) CloseClient(c, NULL);
+            return;
+        }
+        /* The first byte decides: JSON opens with a brace, LAN messages
+         * with their magic */
+        if (c->InLen == 0 && c->Prefix < 0 && !c->Authorized && c->In[0] == PDQ_LAN_MAGIC0) {
+            c->Binary = true;
+        }
+        c->InLen += (uint32_t)n;
+
+        uint32_t used = c->Binary ? HandleMessages(c) : HandleLines(c);
+        if (c->Fd < 0) return;
+
+        c->InLen -= used;
+        memmove(c->In, c->In + used, c->InLen);
+        if (c->InLen == sizeof(c->In)) {
+            CloseClient(c, "request too long");
+            return;
+        }
+    }
+}
+
+static void OnClientEvent(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    ProxyClient_t* c = (ProxyClient_t*)p_Arg;
+    ReapClients();
+
+    if (Events & PDQ_EVENT_ERROR) {
+        CloseClient(c, NULL);
+        return;
+    }
+    if (Events & PDQ_EVENT_WRITE) {
+        if (!FlushClient(c)) {
+            CloseClient(c, NULL);
+            return;
+        }
+        if (c->OutLen == 0) WatchClient(c);
+    }
+    if (Events & PDQ_EVENT_READ) ReadClient(c);
+}
+
+static void AddClient(int Fd) {
+    int one = 1;
+    int flags = fcntl(Fd, F_GETFL, 0);
+    fcntl(Fd, F_SETFL, flags | O_NONBLOCK);
+    fcntl(Fd, F_SETFD, FD_CLOEXEC);
+    setsockopt(Fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (s_ClientCount == s_ClientCap) {
+        uint32_t cap = s_ClientCap ? s_ClientCap * 2 : 64;
+        ProxyClient_t** p = (ProxyClient_t**)realloc(s_Clients, cap * sizeof(ProxyClient_t*));
+        if (!p) {
+            close(Fd);
+            return;
+        }
+        s_Clients = p;
+        s_ClientCap = cap;
+    }
+
+    ProxyClient_t* c = (ProxyClient_t*)calloc(1, sizeof(ProxyClient_t));
+    if (!c || PdqEventAdd(Fd, PDQ_EVENT_READ, OnClientEvent, c) != PdqOk) {
+        free(c);
+        close(Fd);
+        return;
+    }
+    c->Fd = Fd;
+    c->Prefix = -1;
+    c->NextTag = 1;
+    c->ConnectedMs = GetMillis();
+    c->Difficulty = s_Config.Difficulty;
+    UpdateShareTarget(c);
+    c->Slot = s_ClientCount;
+    s_Clients[s_ClientCount++] = c;
+    s_Stats.Connections++;
+}
+
+static void OnListen(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Events;
+    (void)p_Arg;
+    ReapClients();
+
+    for (int i = 0; i < PROXY_ACCEPT_BATCH; i++) {
+        int fd = accept(Fd, NULL, NULL);
+        if (fd >= 0) {
+            AddClient(fd);
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if ((errno == EMFILE || errno == ENFILE) && s_SpareFd >= 0) {
+            /* Out of descriptors: the pending connection would wake the
+             * loop forever, so free the spare to accept and shed it */
+            close(s_SpareFd);
+            fd = accept(Fd, NULL, NULL);
+            if (fd >= 0) close(fd);
+            s_SpareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+            printf("[PROXY] Out of file descriptors, connection refused\n");
+        }
+        return;
+    }
+}
+
+/* Thousands of devices need thousands of descriptors */
+static void RaiseFileLimit(void) {
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) != 0 || lim.rlim_cur >= lim.rlim_max) return;
+    rlim_t old = lim.rlim_cur;
+    lim.rlim_cur = lim.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        printf("[PROXY] File descriptor limit %lu -> %lu\n",
+               (unsigned long)old, (unsigned long)lim.rlim_cur);
+    }
+}
+
+/* ---- Upstream ---- */
+
+static void ApplyExtranonce(const uint8_t* p_Extranonce1, uint8_t Extranonce1Len, uint8_t Extranonce2Size) {
+    uint8_t prefixLen = PrefixLenFor(Extranonce2Size);
+
+    /* Jobs and shares of the old session are worth nothing to the new one */
+    s_JobCount = 0;
+    ClearSeen();
+
+    if (prefixLen == 0) {
+        printf("[PROXY] Upstream extranonce2 of %u byte(s) is too short to share\n",
+               (unsigned)Extranonce2Size);
+        s_HaveExtranonce = false;
+        CloseAll("upstream extranonce2 too short");
+        return;
+    }
+
+    memcpy(s_Extranonce1, p_Extranonce1, Extranonce1Len);
+    s_Extranonce1Len = Extranonce1Len;
+    s_Extranonce2Size = Extranonce2Size;
+    s_HaveExtranonce = true;
+
+    if (prefixLen != s_PrefixLen) {
+        for (uint32_t i = s_ClientCount; i-- > 0;) {
+            if (s_Clients[i]->Prefix >= 0) CloseClient(s_Clients[i], "extranonce layout changed");
+        }
+        uint32_t count = prefixLen >= 2 ? PDQ_PROXY_MAX_PREFIXES : 256;
+        PrefixSlot_t* p = (PrefixSlot_t*)calloc(count, sizeof(PrefixSlot_t));
+        if (!p) {
+            s_HaveExtranonce = false;
+            return;
+        }
+        free(s_Prefixes);
+        s_Prefixes = p;
+        s_PrefixCount = count;
+        s_PrefixLen = prefixLen;
+        s_NextPrefix = 0;
+    } else {
+        /* Same layout: every prefix still fits, only extranonce1 moved.
+         * Binary devices get it with their next piece of work. */
+        for (uint32_t i = s_ClientCount; i-- > 0;) {
+            ProxyClient_t* c = s_Clients[i];
+            if (c->Prefix < 0 || c->Binary) continue;
+            if (!c->ExtranonceSub) {
+                CloseClient(c, "extranonce changed");
+                continue;
+            }
+            char extranonce1[2 * (PDQ_STRATUM_MAX_EXTRANONCE_LEN + PROXY_MAX_PREFIX_LEN) + 1];
+            FormatExtranonce1(c, extranonce1);
+            SendLine(c, snprintf(s_Line, sizeof(s_Line),
+                                 "{\"id\":null,\"method\":\"mining.set_extranonce\",\"params\":[\"%s\",%u]}\n",
+                                 extranonce1, (unsigned)(s_Extranonce2Size - s_PrefixLen)));
+        }
+    }
+
+    char hex[2 * PDQ_STRATUM_MAX_EXTRANONCE_LEN + 1];
+    *PutHex(hex, s_Extranonce1, s_Extranonce1Len) = '\0';
+    printf("[PROXY] Upstream extranonce1 %s, %u-byte prefix for up to %lu devices\n",
+           hex, (unsigned)s_PrefixLen, (unsigned long)s_PrefixCount);
+}
+
+static void SyncExtranonce(void) {
+    uint8_t extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t len = 0;
+    PdqStratumCtxGetExtranonce(s_Upstream, extranonce1, &len);
+    uint8_t size = PdqStratumCtxGetExtranonce2Size(s_Upstream);
+    if (s_HaveExtranonce && len == s_Extranonce1Len && size == s_Extranonce2Size &&
+        memcmp(extranonce1, s_Extranonce1, len) == 0) {
+        return;
+    }
+    ApplyExtranonce(extranonce1, len, size);
+}
+
+void PdqProxySetUpstream(PdqStratumContext_t* p_Upstream) {
+    ReapClients();
+    s_Upstream = p_Upstream;
+    if (s_Running && s_Upstream && PdqStratumCtxIsReady(s_Upstream)) SyncExtranonce();
+}
+
+void PdqProxyOnJob(void) {
+    ReapClients();
+    if (!s_Running || !s_Upstream || !PdqStratumCtxIsReady(s_Upstream)) return;
+
+    /* mining.set_extranonce arrives between jobs */
+    SyncExtranonce();
+    if (!s_HaveExtranonce) return;
+
+    PdqStratumJob_t job;
+    if (PdqStratumCtxGetJob(s_Upstream, &job) != PdqOk || job.JobId[0] == '\0') return;
+
+    ProxyJob_t* newest = NewestJob();
+    if (newest && !job.CleanJobs && strcmp(newest->Job.JobId, job.JobId) == 0) return;
+
+    bool clean = job.CleanJobs || !newest ||
+                 memcmp(newest->Job.PrevBlockHash, job.PrevBlockHash, 32) != 0;
+    if (clean) {
+        s_JobCount = 0;
+        ClearSeen();
+    }
+    if (StoreJob(&job) != PdqOk) {
+        printf("[PROXY] Out of memory for job %s\n", job.JobId);
+        return;
+    }
+
+    uint32_t sent = 0;
+    for (uint32_t i = s_ClientCount; i-- > 0;) {
+        ProxyClient_t* c = s_Clients[i];
+        if (!c->Authorized) continue;
+        if (c->PrevDifficulty > 0.0) {
+            c->PrevDifficulty = 0.0;
+            UpdateShareTarget(c);
+        }
+        SendJob(c, clean);
+        sent++;
+    }
+    printf("[PROXY] Job %s to %lu device(s)%s\n", job.JobId, (unsigned long)sent, clean ? " (clean)" : "");
+}
+
+void PdqProxyRecordSubmitResult(PdqSubmitResult_t Result) {
+    if (Result == PdqSubmitAccepted) {
+        s_Stats.UpstreamAccepted++;
+    } else {
+        s_Stats.UpstreamRejected++;
+    }
+}
+
+void PdqProxyTick(uint64_t NowMs) {
+    ReapClients();
+    for (uint32_t i = s_ClientCount; i-- > 0;) {
+        ProxyClient_t* c = s_Clients[i];
+        if (c->Authorized) {
+            Retarget(c, NowMs);
+        } else if (NowMs - c->ConnectedMs > PDQ_PROXY_HANDSHAKE_MS) {
+            CloseClient(c, "handshake timeout");
+        }
+    }
+}
+
+void PdqProxyGetStats(PdqProxyStats_t* p_Stats) {
+    if (!p_Stats) return;
+    *p_Stats = s_Stats;
+    p_Stats->Clients = s_ClientCount;
+}
+
+uint16_t PdqProxyGetPort(void) {
+    return s_Port;
+}
+
+PdqError_t PdqProxyStart(const PdqProxyConfig_t* p_Config) {
+    if (!p_Config || s_Running) return PdqErrorInvalidParam;
+
+    s_Config = *p_Config;
+    PdqVardiffDefaults(&s_Vardiff, s_Config.ShareIntervalMs);
+    if (s_Config.RetargetMs) s_Vardiff.RetargetMs = s_Config.RetargetMs;
+    s_Vardiff.MinDifficulty = s_Config.MinDifficulty > 0.0 ? s_Config.MinDifficulty : PDQ_PROXY_MIN_DIFFICULTY;
+    s_Vardiff.MaxDifficulty = s_Config.MaxDifficulty > 0.0 ? s_Config.MaxDifficulty : PDQ_VARDIFF_MAX_DIFFICULTY;
+    if (s_Vardiff.MaxDifficulty < s_Vardiff.MinDifficulty) s_Vardiff.MaxDifficulty = s_Vardiff.MinDifficulty;
+    s_Config.Difficulty = ClampDifficulty(s_Config.Difficulty > 0.0 ? s_Config.Difficulty : 1.0);
+
+    memset(&s_Stats, 0, sizeof(s_Stats));
+    s_Seen = (uint64_t*)calloc(PDQ_PROXY_DEDUPE_SLOTS, sizeof(uint64_t));
+    if (!s_Seen) return PdqErrorNoMemory;
+    s_SeenCount = 0;
+
+    RaiseFileLimit();
+
+    s_ListenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (s_ListenFd < 0) {
+        PdqProxyStop();
+        return PdqErrorNotConnected;
+    }
+    int one = 1;
+    setsockopt(s_ListenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    fcntl(s_ListenFd, F_SETFL, fcntl(s_ListenFd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(s_ListenFd, F_SETFD, FD_CLOEXEC);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(s_Config.Port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (s_Config.p_BindAddress && inet_pton(AF_INET, s_Config.p_BindAddress, &addr.sin_addr) != 1) {
+        PdqProxyStop();
+        return PdqErrorInvalidParam;
+    }
+
+    socklen_t len = sizeof(addr);
+    if (bind(s_ListenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(s_ListenFd, SOMAXCONN) != 0 ||
+        getsockname(s_ListenFd, (struct sockaddr*)&addr, &len) != 0 ||
+        PdqEventAdd(s_ListenFd, PDQ_EVENT_READ, OnListen, NULL) != PdqOk) {
+        fprintf(stderr, "[PROXY] Cannot listen on port %u: %s\n", (unsigned)s_Config.Port, strerror(errno));
+        PdqProxyStop();
+        return PdqErrorNotConnected;
+    }
+    s_Port = ntohs(addr.sin_port);
+    s_SpareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    s_TokenState = ((uint32_t)GetMillis() ^ ((uint32_t)getpid() * 2654435761u)) | 1;
+    s_Running = true;
+
+    printf("[PROXY] Listening on port %u (difficulty %.8g", (unsigned)s_Port, s_Config.Difficulty);
+    if (s_Config.ShareIntervalMs) {
+        printf(", retuned for a share every %lu s", (unsigned long)(s_Config.ShareIntervalMs / 1000));
+    }
+    printf(")\n");
+    return PdqOk;
+}
+
+void PdqProxyStop(void) {
+    CloseAll(NULL);
+    ReapClients();
+    if (s_ListenFd >= 0) {
+        PdqEventRemove(s_ListenFd);
+        close(s_ListenFd);
+        s_ListenFd = -1;
+    }
+    if (s_SpareFd >= 0) {
+        close(s_SpareFd);
+        s_SpareFd = -1;
+    }
+    for (int i = 0; i < PDQ_PROXY_JOB_HISTORY; i++) {
+        free(s_Jobs[i].p_Data);
+        free(s_Jobs[i].p_Notify);
+    }
+    memset(s_Jobs, 0, sizeof(s_Jobs));
+    s_JobCount = 0;
+    s_JobNext = 0;
+    free(s_Clients);
+    s_Clients = NULL;
+    s_ClientCap = 0;
+    free(s_Prefixes);
+    s_Prefixes = NULL;
+    s_PrefixCount = 0;
+    s_PrefixLen = 0;
+    free(s_Seen);
+    s_Seen = NULL;
+    s_Upstream = NULL;
+    s_HaveExtranonce = false;
+    s_Port = 0;
+    s_Running = false;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file linux_proxy.h
+ * @brief Stratum V1 proxy: one upstream pool session shared by a fleet
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Serves Stratum V1 to downstream miners (ESP32 boards, other PDQminer
+ * instances) from the event loop, and relays their work over the single
+ * upstream session main.c keeps with the pool supervisor.
+ *
+ * The upstream extranonce2 is split: its leading bytes become a per-
+ * connection prefix appended to extranonce1, so every device searches a
+ * disjoint part of the coinbase space and the pool sees one worker. Each
+ * share is re-hashed here and checked against the device's own
+ * difficulty before it is answered; only shares that also meet the
+ * pool's difficulty (or the network target) go upstream. Downstream
+ * difficulty is retargeted per connection from the share rate.
+ *
+ * The same port serves devices speaking the binary protocol of
+ * stratum/lan_proto.h, told apart by the first byte they send. Those
+ * get ready-to-hash work built here for their own extranonce2, so they
+ * never parse JSON or hash a coinbase.
+ *
+ * All functions must be called from the thread that runs the event loop.
+ */
+
+#ifndef PDQ_LINUX_PROXY_H
+#define PDQ_LINUX_PROXY_H
+
+#include "pdq_types.h"
+#include "stratum/stratum_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_PROXY_MAX_PREFIXES      65536   /* Downstream sessions per upstream session */
+#define PDQ_PROXY_LINE_MAX          512     /* Longest downstream request */
+#define PDQ_PROXY_TX_MAX            65536   /* Unsent bytes before a client is dropped */
+#define PDQ_PROXY_JOB_HISTORY       8       /* Jobs still accepted for submit */
+#define PDQ_PROXY_RESUME_MS         120000  /* A closed session's prefix is kept this long */
+#define PDQ_PROXY_HANDSHAKE_MS      30000   /* Time to subscribe and authorize */
+#define PDQ_PROXY_DEDUPE_SLOTS      65536   /* Share hashes remembered per block */
+#define PDQ_PROXY_MIN_DIFFICULTY    0.0001  /* Default downstream floor */
+#define PDQ_PROXY_NTIME_RANGE       7200    /* Seconds a share's ntime may run ahead */
+
+typedef struct {
+    uint16_t    Port;               /* 0 picks an ephemeral port */
+    const char* p_BindAddress;      /* NULL listens on all interfaces */
+    double      Difficulty;         /* Initial downstream difficulty */
+    double      MinDifficulty;      /* 0 for PDQ_PROXY_MIN_DIFFICULTY */
+    double      MaxDifficulty;      /* 0 for PDQ_VARDIFF_MAX_DIFFICULTY */
+    uint32_t    ShareIntervalMs;    /* Per-connection vardiff target, 0 keeps Difficulty */
+    uint32_t    RetargetMs;         /* Vardiff window, 0 for PDQ_VARDIFF_RETARGET_MS */
+} PdqProxyConfig_t;
+
+typedef struct {
+    uint32_t Clients;               /* Open downstream connections */
+    uint32_t Connections;           /* Accepted since start */
+    uint32_t Resumes;               /* Sessions that got their prefix back */
+    uint32_t Dropped;               /* Closed for slow reads, bad input or timeouts */
+    uint32_t SharesAccepted;
+    uint32_t SharesRejected;        /* Above the device target, malformed */
+    uint32_t SharesStale;           /* Unknown or retired job */
+    uint32_t SharesDuplicate;
+    uint32_t SharesForwarded;       /* Sent upstream */
+    uint32_t SharesUnforwarded;     /* Met the pool target while it was down */
+    uint32_t UpstreamAccepted;
+    uint32_t UpstreamRejected;      /* Rejected, timed out or dropped as stale */
+    uint32_t Retargets;             /* Downstream difficulty changes */
+    uint64_t TotalHashes;           /* Work represented by accepted shares */
+} PdqProxyStats_t;
+
+PdqError_t PdqProxyStart(const PdqProxyConfig_t* p_Config);
+void       PdqProxyStop(void);
+uint16_t   PdqProxyGetPort(void);
+
+/* The session shares are forwarded to; NULL while the pool is down.
+ * Devices keep their connections and cached job across an outage. A
+ * new session with a different extranonce1 is announced to devices that
+ * sent mining.extranonce.subscribe; the others are closed to reconnect. */
+void       PdqProxySetUpstream(PdqStratumContext_t* p_Upstream);
+
+/* Take the upstream session's current job and broadcast it */
+void       PdqProxyOnJob(void);
+
+/* Submit results for forwarded shares, from the upstream submit callback */
+void       PdqProxyRecordSubmitResult(PdqSubmitResult_t Result);
+
+/* Vardiff retargets and handshake timeouts; call about once a second */
+void       PdqProxyTick(uint64_t NowMs);
+
+void       PdqProxyGetStats(PdqProxyStats_t* p_Stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,179 @@
+/**
+ * @file linux_shm.c
+ * @brief Shared-memory stats implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * The release fence after the counter goes odd keeps the stats writes
+ * behind it; the release store that makes it even keeps them ahead. On
+ * the reader's side the acquire load and the acquire fence after the
+ * copy pair with those, so a copy that saw the same even value before
+ * and after holds no half-written publish.
+ */
+
+#include "linux_shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHM_READ_TRIES  10000
+
+static bool MakePath(char* p_Path, size_t Size, const char* p_Name) {
+    if (!p_Name || !p_Name[0] || strlen(p_Name) > PDQ_SHM_NAME_MAX || strchr(p_Name, '/')) return false;
+    snprintf(p_Path, Size, "/%s", p_Name);
+    return true;
+}
+
+static bool KeepsHistory(const PdqShmRegion_t* p_Region) {
+    return p_Region->Magic == PDQ_SHM_MAGIC && p_Region->Version == PDQ_SHM_VERSION &&
+           p_Region->Size == sizeof(PdqShmRegion_t) && p_Region->Stats.HistoryCount <= PDQ_SHM_HISTORY &&
+           p_Region->Stats.HistoryNext < PDQ_SHM_HISTORY;
+}
+
+/* ---- Writer ---- */
+
+PdqError_t PdqShmWriterOpen(PdqShmWriter_t* p_Writer, const char* p_Name) {
+    if (!p_Writer) return PdqErrorInvalidParam;
+    memset(p_Writer, 0, sizeof(*p_Writer));
+    if (!MakePath(p_Writer->Path, sizeof(p_Writer->Path), p_Name)) return PdqErrorInvalidParam;
+
+    int fd = shm_open(p_Writer->Path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "[SHM] Cannot open %s: %s\n", p_Writer->Path, strerror(errno));
+        return PdqErrorNotConnected;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        ((size_t)st.st_size != sizeof(PdqShmRegion_t) && ftruncate(fd, sizeof(PdqShmRegion_t)) != 0)) {
+        fprintf(stderr, "[SHM] Cannot size %s: %s\n", p_Writer->Path, strerror(errno));
+        close(fd);
+        return PdqErrorNoMemory;
+    }
+    void* map = mmap(NULL, sizeof(PdqShmRegion_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[SHM] Cannot map %s: %s\n", p_Writer->Path, strerror(errno));
+        return PdqErrorNoMemory;
+    }
+    PdqShmRegion_t* region = (PdqShmRegion_t*)map;
+
+    /* Readers of a region left behind see a publish under way until the
+     * header and stats are reset */
+    uint32_t seq = atomic_load_explicit(&region->Seq, memory_order_relaxed) | 1;
+    atomic_store_explicit(&region->Seq, seq, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (KeepsHistory(region)) {
+        memset(&region->Stats, 0, offsetof(PdqShmStats_t, HistoryCount));
+    } else {
+        memset(&region->Stats, 0, sizeof(region->Stats));
+    }
+    region->Magic = PDQ_SHM_MAGIC;
+    region->Version = PDQ_SHM_VERSION;
+    region->Size = sizeof(PdqShmRegion_t);
+    region->Pid = (int32_t)getpid();
+    atomic_store_explicit(&region->Seq, seq + 1, memory_order_release);
+
+    p_Writer->p_Region = region;
+    printf("[SHM] Publishing stats to /dev/shm%s\n", p_Writer->Path);
+    return PdqOk;
+}
+
+void PdqShmPublish(PdqShmWriter_t* p_Writer, const PdqShmStats_t* p_Stats) {
+    if (!p_Writer || !p_Writer->p_Region || !p_Stats) return;
+    PdqShmRegion_t* region = p_Writer->p_Region;
+    PdqShmStats_t* out = &region->Stats;
+
+    uint32_t seq = atomic_load_explicit(&region->Seq, memory_order_relaxed);
+    atomic_store_explicit(&region->Seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(out, p_Stats, offsetof(PdqShmStats_t, HistoryCount));
+    PdqShmSample_t* sample = &out->History[out->HistoryNext];
+    sample->TimeMs = p_Stats->UpdatedMs;
+    sample->TotalHashes = p_Stats->Total.TotalHashes;
+    sample->HashRate = p_Stats->Total.HashRate;
+    sample->SharesAccepted = p_Stats->Total.SharesAccepted;
+    sample->SharesRejected = p_Stats->Total.SharesRejected;
+    sample->SharesStale = p_Stats->Total.SharesStale;
+    out->HistoryNext = (out->HistoryNext + 1) % PDQ_SHM_HISTORY;
+    if (out->HistoryCount < PDQ_SHM_HISTORY) out->HistoryCount++;
+
+    atomic_store_explicit(&region->Seq, seq + 2, memory_order_release);
+}
+
+void PdqShmWriterClose(PdqShmWriter_t* p_Writer) {
+    if (!p_Writer || !p_Writer->p_Region) return;
+    munmap(p_Writer->p_Region, sizeof(PdqShmRegion_t));
+    shm_unlink(p_Writer->Path);
+    p_Writer->p_Region = NULL;
+}
+
+/* ---- Reader ---- */
+
+PdqError_t PdqShmReaderOpen(PdqShmReader_t* p_Reader, const char* p_Name) {
+    char path[PDQ_SHM_NAME_MAX + 2];
+    if (!p_Reader) return PdqErrorInvalidParam;
+    p_Reader->p_Region = NULL;
+    if (!MakePath(path, sizeof(path), p_Name)) return PdqErrorInvalidParam;
+
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0) return PdqErrorNotConnected;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(uint32_t) * 3) {
+        close(fd);
+        return PdqErrorParse;
+    }
+    /* Map what is there: the header says whether it is our layout */
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return PdqErrorNoMemory;
+
+    const PdqShmRegion_t* region = (const PdqShmRegion_t*)map;
+    if (size != sizeof(PdqShmRegion_t) || region->Magic != PDQ_SHM_MAGIC ||
+        region->Version != PDQ_SHM_VERSION || region->Size != sizeof(PdqShmRegion_t)) {
+        munmap(map, size);
+        return PdqErrorParse;
+    }
+    p_Reader->p_Region = region;
+    return PdqOk;
+}
+
+PdqError_t PdqShmRead(const PdqShmReader_t* p_Reader, PdqShmStats_t* p_Stats) {
+    if (!p_Reader || !p_Reader->p_Region || !p_Stats) return PdqErrorInvalidParam;
+    PdqShmRegion_t* region = (PdqShmRegion_t*)p_Reader->p_Region;
+
+    for (int i = 0; i < SHM_READ_TRIES; i++) {
+        uint32_t before = atomic_load_explicit(&region->Seq, memory_order_acquire);
+        if (before & 1) {
+            if (i > 100) usleep(10);
+            continue;
+        }
+        memcpy(p_Stats, &region->Stats, sizeof(*p_Stats));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&region->Seq, memory_order_relaxed) == before) return PdqOk;
+    }
+    return PdqErrorTimeout;
+}
+
+int32_t PdqShmReaderGetPid(const PdqShmReader_t* p_Reader) {
+    return p_Reader && p_Reader->p_Region ? p_Reader->p_Region->Pid : 0;
+}
+
+void PdqShmReaderClose(PdqShmReader_t* p_Reader) {
+    if (!p_Reader || !p_Reader->p_Region) return;
+    munmap((void*)p_Reader->p_Region, sizeof(PdqShmRegion_t));
+    p_Reader->p_Region = NULL;
+}
+
+const PdqShmSample_t* PdqShmHistoryAt(const PdqShmStats_t* p_Stats, uint32_t Age) {
+    if (!p_Stats || Age >= p_Stats->HistoryCount || p_Stats->HistoryCount > PDQ_SHM_HISTORY) return NULL;
+    uint32_t slot = (p_Stats->HistoryNext + PDQ_SHM_HISTORY - 1 - Age) % PDQ_SHM_HISTORY;
+    return &p_Stats->History[slot];
+}
@@ -0,0 +1,133 @@
+/**
+ * @file linux_shm.h
+ * @brief Miner stats published in shared memory
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * pdqminer --stats-shm NAME maps /dev/shm/NAME and rewrites it once a
+ * second with the totals, per-thread rates, per-pool counters and one
+ * more sample in a ring of recent seconds. A monitor maps the same file
+ * read-only and copies it out whenever it likes: no socket, no request
+ * for the miner to answer and no lock to take against it.
+ *
+ * A sequence counter guards the copy (a seqlock). The writer makes it
+ * odd before it touches the stats and even again after; a reader that
+ * sees it odd, or changed across its copy, copies again. The writer
+ * never waits for readers, and a reader only waits out the few
+ * microseconds of one publish.
+ *
+ * The layout is fixed-size with no pointers. PDQ_SHM_VERSION changes
+ * whenever it does, PdqMinerStats_t included, and readers refuse any
+ * other version.
+ */
+
+#ifndef PDQ_LINUX_SHM_H
+#define PDQ_LINUX_SHM_H
+
+#include "pdq_types.h"
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_SHM_MAGIC           0x53514450u     /* "PDQS" */
+#define PDQ_SHM_VERSION         1
+#define PDQ_SHM_DEFAULT_NAME    "pdqminer"
+#define PDQ_SHM_NAME_MAX        64
+#define PDQ_SHM_MAX_THREADS     32
+#define PDQ_SHM_MAX_POOLS       8
+#define PDQ_SHM_HISTORY         600             /* Seconds */
+
+/* One second of history */
+typedef struct {
+    uint64_t TimeMs;            /* Wall clock, ms since the epoch */
+    uint64_t TotalHashes;
+    uint32_t HashRate;
+    uint32_t SharesAccepted;
+    uint32_t SharesRejected;
+    uint32_t SharesStale;
+} PdqShmSample_t;
+
+typedef struct {
+    char            Host[PDQ_MAX_HOST_LEN + 1];
+    uint8_t         Ready;
+    uint8_t         Backup;
+    uint8_t         Parked;
+    uint16_t        Port;
+    uint32_t        Weight;
+    double          Difficulty;
+    PdqMinerStats_t Stats;
+} PdqShmPool_t;
+
+typedef struct {
+    uint64_t        UpdatedMs;      /* Wall clock of the last publish */
+    uint32_t        UptimeSec;
+    char            Mode[8];        /* "pool", "sv2", "solo" or "proxy" */
+    PdqMinerStats_t Total;
+    uint32_t        ThreadCount;
+    uint32_t        ThreadHashRate[PDQ_SHM_MAX_THREADS];
+    uint64_t        ThreadHashes[PDQ_SHM_MAX_THREADS];
+    uint32_t        PoolCount;
+    PdqShmPool_t    Pools[PDQ_SHM_MAX_POOLS];
+    /* Kept by the writer; its samples survive a restart of the miner */
+    uint32_t        HistoryCount;   /* Valid samples, up to PDQ_SHM_HISTORY */
+    uint32_t        HistoryNext;    /* Slot the next sample goes to */
+    PdqShmSample_t  History[PDQ_SHM_HISTORY];
+} PdqShmStats_t;
+
+typedef struct {
+    uint32_t         Magic;
+    uint32_t         Version;
+    uint32_t         Size;          /* sizeof(PdqShmRegion_t) */
+    int32_t          Pid;           /* Of the writer */
+    _Atomic uint32_t Seq;           /* Odd while a publish is under way */
+    uint32_t         Reserved;
+    PdqShmStats_t    Stats;
+} PdqShmRegion_t;
+
+typedef struct {
+    PdqShmRegion_t* p_Region;
+    char            Path[PDQ_SHM_NAME_MAX + 2];
+} PdqShmWriter_t;
+
+typedef struct {
+    const PdqShmRegion_t* p_Region;
+} PdqShmReader_t;
+
+/* ---- Writer (pdqminer) ---- */
+
+/* Create or take over /dev/shm/p_Name. A region left by an earlier run
+ * of the same version keeps its history; everything else starts at zero. */
+PdqError_t PdqShmWriterOpen(PdqShmWriter_t* p_Writer, const char* p_Name);
+
+/* Publish p_Stats and append a sample of its totals to the history. The
+ * history fields of p_Stats are ignored. */
+void       PdqShmPublish(PdqShmWriter_t* p_Writer, const PdqShmStats_t* p_Stats);
+
+/* Unmap and remove the file; readers keep the last copy they mapped */
+void       PdqShmWriterClose(PdqShmWriter_t* p_Writer);
+
+/* ---- Reader ---- */
+
+/* PdqErrorNotConnected if nothing is published under p_Name,
+ * PdqErrorParse if the region is from another version */
+PdqError_t PdqShmReaderOpen(PdqShmReader_t* p_Reader, const char* p_Name);
+
+/* Consistent copy of the stats. PdqErrorTimeout only if the writer died
+ * mid-publish. */
+PdqError_t PdqShmRead(const PdqShmReader_t* p_Reader, PdqShmStats_t* p_Stats);
+
+/* Writer's process ID, 0 if not open */
+int32_t    PdqShmReaderGetPid(const PdqShmReader_t* p_Reader);
+
+void       PdqShmReaderClose(PdqShmReader_t* p_Reader);
+
+/* Sample Age seconds before the newest (Age 0), NULL past the history */
+const PdqShmSample_t* PdqShmHistoryAt(const PdqShmStats_t* p_Stats, uint32_t Age);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
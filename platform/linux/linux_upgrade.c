@@ -0,0 +1,218 @@
+/**
+ * @file linux_upgrade.c
+ * @brief Binary upgrade implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "linux_upgrade.h"
+#include "stratum/sv2_proto.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+    char     Host[PDQ_MAX_HOST_LEN + 1];
+    uint16_t Port;
+    char     Worker[PDQ_MAX_WORKER_LEN + 1];
+    int      Socket;            /* -1 once restored */
+    uint8_t* p_State;
+    uint32_t StateLen;
+} Handoff_t;
+
+static Handoff_t s_Handoffs[PDQ_UPGRADE_MAX_SESSIONS];
+static int       s_Count = 0;
+
+static void ClearHandoffs(void) {
+    for (int i = 0; i < s_Count; i++) free(s_Handoffs[i].p_State);
+    memset(s_Handoffs, 0, sizeof(s_Handoffs));
+    s_Count = 0;
+}
+
+static void SetCloseOnExec(int Fd, bool On) {
+    int flags = fcntl(Fd, F_GETFD);
+    if (flags < 0) return;
+    fcntl(Fd, F_SETFD, On ? (flags | FD_CLOEXEC) : (flags & ~FD_CLOEXEC));
+}
+
+PdqError_t PdqUpgradeAdd(const PdqStratumContext_t* p_Ctx, const char* p_Host, uint16_t Port) {
+    if (!p_Ctx || !p_Host || s_Count >= PDQ_UPGRADE_MAX_SESSIONS) return PdqErrorInvalidParam;
+
+    Handoff_t* h = &s_Handoffs[s_Count];
+    uint32_t size = PdqStratumCtxStateSize(p_Ctx);
+    h->p_State = (uint8_t*)malloc(size);
+    if (!h->p_State) return PdqErrorNoMemory;
+    PdqError_t err = PdqStratumCtxSaveState(p_Ctx, h->p_State, size, &h->StateLen);
+    if (err != PdqOk) {
+        free(h->p_State);
+        h->p_State = NULL;
+        return err;
+    }
+    snprintf(h->Host, sizeof(h->Host), "%s", p_Host);
+    h->Port = Port;
+    snprintf(h->Worker, sizeof(h->Worker), "%s", p_Ctx->Worker);
+    h->Socket = PdqStratumCtxGetSocket(p_Ctx);
+    s_Count++;
+    return PdqOk;
+}
+
+/* The blob goes to an unlinked file, so nothing is left behind whether
+ * or not the new process starts */
+static int WriteBlob(void) {
+    size_t size = 16;
+    for (int i = 0; i < s_Count; i++) size += 2 * 256 + 16 + s_Handoffs[i].StateLen;
+    uint8_t* buf = (uint8_t*)malloc(size);
+    if (!buf) return -1;
+
+    PdqSv2Writer_t w;
+    PdqSv2WriterInit(&w, buf, (uint32_t)size);
+    PdqSv2PutU32(&w, PDQ_UPGRADE_MAGIC);
+    PdqSv2PutU8(&w, PDQ_UPGRADE_VERSION);
+    PdqSv2PutU8(&w, (uint8_t)s_Count);
+    for (int i = 0; i < s_Count; i++) {
+        const Handoff_t* h = &s_Handoffs[i];
+        PdqSv2PutStr(&w, h->Host);
+        PdqSv2PutU16(&w, h->Port);
+        PdqSv2PutStr(&w, h->Worker);
+        PdqSv2PutU32(&w, (uint32_t)h->Socket);
+        PdqSv2PutU32(&w, h->StateLen);
+        PdqSv2PutBytes(&w, h->p_State, h->StateLen);
+    }
+
+    int fd = -1;
+    FILE* f = w.Overflow ? NULL : tmpfile();
+    if (f && fwrite(buf, 1, w.Len, f) == w.Len && fflush(f) == 0) {
+        /* dup() leaves close-on-exec clear; the FILE itself is closed */
+        fd = dup(fileno(f));
+    }
+    if (f) fclose(f);
+    free(buf);
+    return fd;
+}
+
+PdqError_t PdqUpgradeExec(char* const* p_Argv) {
+    if (!p_Argv || !p_Argv[0]) return PdqErrorInvalidParam;
+
+    int blob = WriteBlob();
+    if (blob < 0) {
+        fprintf(stderr, "[UPGRADE] Cannot write the session handoff: %s\n", strerror(errno));
+        ClearHandoffs();
+        return PdqErrorNoMemory;
+    }
+    char value[16];
+    snprintf(value, sizeof(value), "%d", blob);
+    setenv(PDQ_UPGRADE_ENV, value, 1);
+    for (int i = 0; i < s_Count; i++) SetCloseOnExec(s_Handoffs[i].Socket, false);
+
+    printf("[UPGRADE] Executing %s with %d pool session(s)\n", p_Argv[0], s_Count);
+    fflush(stdout);
+    execvp(p_Argv[0], p_Argv);
+
+    /* Still here: the old binary keeps running with everything it had */
+    fprintf(stderr, "[UPGRADE] exec %s failed: %s\n", p_Argv[0], strerror(errno));
+    for (int i = 0; i < s_Count; i++) SetCloseOnExec(s_Handoffs[i].Socket, true);
+    unsetenv(PDQ_UPGRADE_ENV);
+    close(blob);
+    ClearHandoffs();
+    return PdqErrorInvalidParam;
+}
+
+static uint8_t* ReadBlob(int Fd, uint32_t* p_Len) {
+    struct stat st;
+    if (fstat(Fd, &st) != 0 || st.st_size <= 0 || st.st_size > 64 * 1024 * 1024) return NULL;
+    uint8_t* buf = (uint8_t*)malloc((size_t)st.st_size);
+    if (!buf) return NULL;
+    size_t got = 0;
+    while (got < (size_t)st.st_size) {
+        ssize_t n = pread(Fd, buf + got, (size_t)st.st_size - got, (off_t)got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            free(buf);
+            return NULL;
+        }
+        got += (size_t)n;
+    }
+    *p_Len = (uint32_t)got;
+    return buf;
+}
+
+int PdqUpgradeLoad(void) {
+    const char* env = getenv(PDQ_UPGRADE_ENV);
+    if (!env || !env[0]) return 0;
+    int blob = atoi(env);
+    unsetenv(PDQ_UPGRADE_ENV);
+    if (blob < 0 || fcntl(blob, F_GETFD) < 0) return 0;
+
+    uint32_t len = 0;
+    uint8_t* buf = ReadBlob(blob, &len);
+    close(blob);
+    if (!buf) {
+        fprintf(stderr, "[UPGRADE] Session handoff unreadable, reconnecting\n");
+        return 0;
+    }
+
+    ClearHandoffs();
+    PdqSv2Reader_t r;
+    PdqSv2ReaderInit(&r, buf, len);
+    if (PdqSv2GetU32(&r) != PDQ_UPGRADE_MAGIC || PdqSv2GetU8(&r) != PDQ_UPGRADE_VERSION) {
+        fprintf(stderr, "[UPGRADE] Session handoff from an incompatible version, reconnecting\n");
+        free(buf);
+        return 0;
+    }
+    uint8_t count = PdqSv2GetU8(&r);
+    for (uint8_t i = 0; i < count && !r.Error; i++) {
+        Handoff_t* h = &s_Handoffs[s_Count];
+        PdqSv2GetStr(&r, h->Host, sizeof(h->Host));
+        h->Port = PdqSv2GetU16(&r);
+        PdqSv2GetStr(&r, h->Worker, sizeof(h->Worker));
+        h->Socket = (int)PdqSv2GetU32(&r);
+        h->StateLen = PdqSv2GetU32(&r);
+        if (r.Error || h->StateLen > len - r.Pos) break;
+        h->p_State = (uint8_t*)malloc(h->StateLen ? h->StateLen : 1);
+        if (!h->p_State) {
+            close(h->Socket);
+            break;
+        }
+        PdqSv2GetBytes(&r, h->p_State, h->StateLen);
+        /* Inherited without close-on-exec; a later upgrade sets it again */
+        SetCloseOnExec(h->Socket, true);
+        if (++s_Count == PDQ_UPGRADE_MAX_SESSIONS) break;
+    }
+    free(buf);
+    return s_Count;
+}
+
+PdqError_t PdqUpgradeRestore(PdqStratumContext_t* p_Ctx, const char* p_Host, uint16_t Port,
+                             const char* p_Worker) {
+    if (!p_Ctx || !p_Host || !p_Worker) return PdqErrorInvalidParam;
+    for (int i = 0; i < s_Count; i++) {
+        Handoff_t* h = &s_Handoffs[i];
+        if (h->Socket < 0 || h->Port != Port || strcmp(h->Host, p_Host) != 0 ||
+            strncmp(h->Worker, p_Worker, PDQ_MAX_WORKER_LEN) != 0) {
+            continue;
+        }
+        PdqError_t err = PdqStratumCtxRestoreState(p_Ctx, h->Socket, h->p_State, h->StateLen);
+        if (err != PdqOk) {
+            fprintf(stderr, "[UPGRADE] Session for %s:%u did not restore, reconnecting\n", p_Host, Port);
+            close(h->Socket);
+        }
+        h->Socket = -1;
+        return err;
+    }
+    return PdqErrorNotConnected;
+}
+
+void PdqUpgradeFinish(void) {
+    for (int i = 0; i < s_Count; i++) {
+        if (s_Handoffs[i].Socket < 0) continue;
+        printf("[UPGRADE] No pool configured for %s:%u any more, closing its session\n",
+               s_Handoffs[i].Host, s_Handoffs[i].Port);
+        close(s_Handoffs[i].Socket);
+    }
+    ClearHandoffs();
+}
@@ -0,0 +1,56 @@
+/**
+ * @file linux_upgrade.h
+ * @brief Binary upgrade: re-exec with the pool sessions handed over
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * The running process saves each live Stratum V1 session
+ * (PdqStratumCtxSaveState) into a blob in an unlinked temporary file,
+ * clears close-on-exec on the blob and the pool sockets, and execs the
+ * binary on disk with the same arguments. PDQ_UPGRADE_FD tells the new
+ * process where the blob is; it restores each session into the matching
+ * pool's context and carries on without reconnecting. Sessions nobody
+ * claims are closed.
+ *
+ * Blob: "PDQU", version, count, then per session the pool host, port
+ * and worker, the inherited socket number and the saved state.
+ */
+
+#ifndef PDQ_LINUX_UPGRADE_H
+#define PDQ_LINUX_UPGRADE_H
+
+#include "pdq_types.h"
+#include "stratum/stratum_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_UPGRADE_ENV             "PDQ_UPGRADE_FD"
+#define PDQ_UPGRADE_MAGIC           0x55514450u     /* "PDQU" */
+#define PDQ_UPGRADE_VERSION         1
+#define PDQ_UPGRADE_MAX_SESSIONS    16
+
+/* Old process: queue a Ready session for the handoff, then exec. Exec
+ * only returns on failure, with nothing handed over and every session
+ * still owned by the caller. */
+PdqError_t PdqUpgradeAdd(const PdqStratumContext_t* p_Ctx, const char* p_Host, uint16_t Port);
+PdqError_t PdqUpgradeExec(char* const* p_Argv);
+
+/* New process: load the handed-over sessions, if this process was
+ * started by an upgrade. Returns how many there are. */
+int        PdqUpgradeLoad(void);
+
+/* Restore the session for this pool and worker into an initialized,
+ * disconnected context. PdqErrorNotConnected when there is none. */
+PdqError_t PdqUpgradeRestore(PdqStratumContext_t* p_Ctx, const char* p_Host, uint16_t Port,
+                             const char* p_Worker);
+
+/* Close the sockets of sessions nobody restored, and free the blob */
+void       PdqUpgradeFinish(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
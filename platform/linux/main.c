@@ -5,7 +5,8 @@
  * @license GPL-3.0
  *
  * Replaces Arduino setup()/loop() with standard main().
- * Accepts configuration via CLI args or environment variables.
+ * Accepts configuration via CLI args, environment variables or the JSON
+ * config file; SIGHUP re-reads the file and applies what changed.
  */
 
 #include "pdq_types.h"
@@ -13,29 +14,177 @@
 #include "config/config_manager.h"
 #include "network/wifi_manager.h"
 #include "stratum/stratum_client.h"
+#include "stratum/pool_supervisor.h"
+#include "stratum/vardiff.h"
+#include "stratum/sv2_client.h"
+#include "stratum/sv2_noise.h"
 #include "core/mining_task.h"
 #include "core/sha256_engine.h"
 #include "api/device_api.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
-#include <time.h>
 #include <getopt.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "linux_event.h"
+#include "linux_mining.h"
+#include "linux_proxy.h"
+#include "linux_gbt.h"
+#include "linux_capture.h"
+#include "linux_upgrade.h"
+#include "linux_http.h"
+#include "linux_shm.h"
 
-/* Defined in linux_mining.c */
-extern void PdqMiningSetThreadCount(int n);
+#define PDQ_STATS_TICK_MS        1000
+#define PDQ_STATS_PRINT_TICKS    10
+#define PDQ_SV2_RETRY_MS         5000
+#define PDQ_POOL_LIST_MAX        1024    /* Characters in a pool list */
 
 static volatile int s_Running = 1;
 
-static void SignalHandler(int sig) {
-    (void)sig;
+/* One Stratum V1 pool session and the mining context it feeds. Plain
+ * mining runs one per entry of the pool list, all sharing the miner
+ * threads by weight; every other mode uses session 0 alone. */
+typedef struct {
+    PdqPoolSupervisor_t Supervisor;
+    PdqMiningContext_t  Miner;
+    PdqVardiff_t        Vardiff;
+    uint32_t            Weight;
+    PdqDeviceConfig_t   Config;         /* Pools and credentials it was set up with */
+    bool                Parked;
+    uint32_t            Jobs;           /* Handed to the miners ... */
+    uint32_t            CleanJobs;      /* ... of which retired the previous one */
+    int                 Fds[2][PDQ_STRATUM_MAX_ADDRS];
+    int                 FdCount[2];
+} PoolSession_t;
+
+/* One entry of a pool list: [WALLET[.WORKER]@]HOST[:PORT][*WEIGHT] */
+typedef struct {
+    char     Host[PDQ_MAX_HOST_LEN + 1];
+    uint16_t Port;
+    char     Wallet[PDQ_MAX_WALLET_LEN + 1];    /* Empty for --wallet */
+    char     Worker[PDQ_MAX_WORKER_LEN + 1];    /* Empty for --worker */
+    uint32_t Weight;
+} PoolEntry_t;
+
+/* What SIGHUP can change. Each comes from the command line if it was
+ * given there, else the environment, else the config file, else the
+ * default. */
+typedef struct {
+    char     PoolHost[PDQ_MAX_HOST_LEN + 1];
+    uint16_t PoolPort;
+    char     BackupHost[PDQ_MAX_HOST_LEN + 1];
+    uint16_t BackupPort;
+    char     Wallet[PDQ_MAX_WALLET_LEN + 1];
+    char     Worker[PDQ_MAX_WORKER_LEN + 1];
+    int      Threads;
+    double   Difficulty;
+    int      ShareInterval;
+    char     PoolList[PDQ_POOL_LIST_MAX];
+} Settings_t;
+
+#define SET_POOL_HOST       (1u << 0)
+#define SET_POOL_PORT       (1u << 1)
+#define SET_BACKUP_HOST     (1u << 2)
+#define SET_BACKUP_PORT     (1u << 3)
+#define SET_WALLET          (1u << 4)
+#define SET_WORKER          (1u << 5)
+#define SET_THREADS         (1u << 6)
+#define SET_DIFFICULTY      (1u << 7)
+#define SET_SHARE_INTERVAL  (1u << 8)
+#define SET_POOL_LIST       (1u << 9)
+
+static Settings_t s_Cli;            /* Given on the command line ... */
+static uint32_t   s_CliSet = 0;     /* ... for these SET_ bits */
+static Settings_t s_Settings;       /* In effect */
+static PdqPoolSupervisorConfig_t s_Tuning;
+
+/* Control-loop state shared by the event callbacks */
+static PdqEventNotifier_t s_ShareNotifier = {-1, -1};
+static PoolSession_t s_Sessions[PDQ_MINING_MAX_CONTEXTS];
+static int      s_SessionCount = 1;
+static PdqMiningPool_t s_Miners;
+static uint32_t s_StatsTicks = 0;
+static bool     s_MiningStarted = false;
+static bool     s_VardiffOn = false;
+
+/* --sv2: one Stratum V2 session in place of the supervisor */
+static bool     s_UseSv2 = false;
+static PdqSv2Context_t s_Sv2;
+static int      s_Sv2Fd = -1;
+static uint64_t s_Sv2RetryMs = 0;
+static char     s_Sv2User[PDQ_MAX_WALLET_LEN + PDQ_MAX_WORKER_LEN + 2];
+static PdqDeviceConfig_t s_Config;
+
+/* --proxy: serve downstream miners instead of mining locally */
+static bool     s_UseProxy = false;
+
+/* --solo: work from a local bitcoind's getblocktemplate, no pool */
+static bool     s_UseSolo = false;
+
+/* --record: every Stratum V1 line to and from the pools, for the mock pool */
+static PdqCaptureWriter_t s_Capture;
+static PdqShmWriter_t     s_Shm;
+
+/* SIGUSR2 re-executes the binary with these arguments */
+static char**   s_Argv = NULL;
+
+/* --api-port: device API and /metrics over HTTP */
+static uint64_t s_StartMs = 0;
+static uint32_t s_CpuMhz = 0;
+static char     s_SoloHost[PDQ_MAX_HOST_LEN + 1] = "";
+static uint16_t s_SoloPort = 0;
+
+static uint64_t GetMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void OnStratumLine(void* p_Arg, bool Outbound, const char* p_Line, size_t Len) {
+    PdqCaptureWrite(&s_Capture, (int)(intptr_t)p_Arg, Outbound, p_Line, Len, GetMillis());
+}
+
+static void OnSignal(int Sig, uint32_t Events, void* p_Arg) {
+    (void)Events;
+    (void)p_Arg;
+    (void)Sig;
     printf("\n[PDQminer] Shutting down...\n");
     s_Running = 0;
 }
 
+static void SubmitShares(void);
+
+/* Binary upgrade: exec whatever binary is now at argv[0], handing it
+ * every authorized Stratum V1 session with its job and queued shares.
+ * The miner threads simply end with this image. SV2 and solo sessions
+ * are not handed over; the new process reconnects them. */
+static void OnUpgradeSignal(int Sig, uint32_t Events, void* p_Arg) {
+    (void)Sig;
+    (void)Events;
+    (void)p_Arg;
+    printf("[PDQminer] Upgrade requested\n");
+    SubmitShares();
+    for (int i = 0; !s_UseSv2 && !s_UseSolo && i < s_SessionCount; i++) {
+        PdqPoolSupervisor_t* sup = &s_Sessions[i].Supervisor;
+        PdqStratumContext_t* ctx = PdqPoolSupervisorGetContext(sup);
+        const PdqPoolConfig_t* pool = PdqPoolSupervisorGetActivePool(sup);
+        if (PdqStratumCtxIsReady(ctx) && PdqUpgradeAdd(ctx, pool->Host, pool->Port) != PdqOk) {
+            printf("[PDQminer] %s:%u cannot be handed over, the new process reconnects it\n",
+                   pool->Host, pool->Port);
+        }
+    }
+    if (s_Capture.p_File) fflush(s_Capture.p_File);
+    PdqUpgradeExec(s_Argv);
+    printf("[PDQminer] Upgrade failed, carrying on\n");
+}
+
 static void PrintUsage(const char* prog) {
     printf("Usage: %s [options]\n\n", prog);
     printf("Options:\n");
@@ -45,11 +194,43 @@ static void PrintUsage(const char* prog) {
     printf("  --worker NAME      Worker name (default: pdqlinux)\n");
     printf("  --threads N        Mining threads (default: 2)\n");
     printf("  --difficulty D     Suggested difficulty (default: 1.0)\n");
-    printf("  --config FILE      JSON config file path\n");
+    printf("  --share-interval S Retune the suggested difficulty for one share\n");
+    printf("                     every S seconds, 0 to keep it fixed (default: 20)\n");
+    printf("  --backup-host HOST Backup pool host (default: none)\n");
+    printf("  --backup-port PORT Backup pool port (default: 3333)\n");
+    printf("  --pool-timeout SEC Drop a pool silent for SEC seconds (default: 120)\n");
+    printf("  --hot-standby      Keep the backup pool session authorized in parallel\n");
+    printf("  --race-pools       Connect to both pools at startup, keep the fastest\n");
+    printf("  --pools LIST       Mine on several pools at once, splitting the threads by\n");
+    printf("                     weight: comma-separated [WALLET[.WORKER]@]HOST[:PORT][*WEIGHT]\n");
+    printf("  --sv2              Stratum V2 (standard channel, Noise encrypted) to the pool\n");
+    printf("  --sv2-authority KEY\n");
+    printf("                     Pool authority public key (base58check or hex) the SV2\n");
+    printf("                     pool certificate must be signed with (default: unchecked)\n");
+    printf("  --proxy PORT       Serve Stratum V1 to downstream miners on PORT instead of\n");
+    printf("                     mining; --difficulty and --share-interval apply to them\n");
+    printf("  --solo HOST[:PORT] Solo mine from a bitcoind's getblocktemplate (port 8332),\n");
+    printf("                     paying blocks to --wallet; no pool is used\n");
+    printf("  --rpc-user USER    bitcoind RPC user for --solo\n");
+    printf("  --rpc-password PW  bitcoind RPC password for --solo\n");
+    printf("  --rpc-cookie FILE  bitcoind cookie file when no user is given\n");
+    printf("                     (default: ~/.bitcoin/.cookie)\n");
+    printf("  --record FILE      Write the Stratum V1 sessions to FILE, for replay\n");
+    printf("                     by the mock pool\n");
+    printf("  --api-port PORT    Serve the device API and Prometheus /metrics over HTTP\n");
+    printf("                     on PORT (default: off)\n");
+    printf("  --api-bind ADDR    Listen on ADDR only (default: all interfaces)\n");
+    printf("  --api-password PW  Password for /api/auth; /api/config needs its token\n");
+    printf("  --stats-shm NAME   Publish stats once a second to /dev/shm/NAME for pdqstat\n");
+    printf("  --config FILE      JSON config file path; SIGHUP reloads it\n");
     printf("  --help             Show this help\n");
-    printf("\nEnvironment variables (override defaults, overridden by CLI):\n");
+    printf("\nEnvironment variables (override the config file and defaults, overridden by CLI):\n");
     printf("  PDQ_POOL_HOST, PDQ_POOL_PORT, PDQ_WALLET, PDQ_WORKER,\n");
-    printf("  PDQ_THREADS, PDQ_DIFFICULTY\n");
+    printf("  PDQ_THREADS, PDQ_DIFFICULTY, PDQ_SHARE_INTERVAL, PDQ_BACKUP_HOST,\n");
+    printf("  PDQ_BACKUP_PORT, PDQ_POOL_TIMEOUT, PDQ_HOT_STANDBY, PDQ_RACE_POOLS,\n");
+    printf("  PDQ_SV2, PDQ_PROXY_PORT, PDQ_SOLO, PDQ_RPC_USER, PDQ_RPC_PASSWORD,\n");
+    printf("  PDQ_RPC_COOKIE, PDQ_POOLS, PDQ_RECORD, PDQ_API_PORT, PDQ_API_BIND,\n");
+    printf("  PDQ_API_PASSWORD, PDQ_STATS_SHM\n");
 }
 
 static const char* EnvOr(const char* env, const char* fallback) {
@@ -57,36 +238,1043 @@ static const char* EnvOr(const char* env, const char* fallback) {
     return (v && v[0]) ? v : fallback;
 }
 
-static uint64_t GetMillis(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+static uint16_t ParsePortOr(const char* str, uint16_t fallback) {
+    long v = strtol(str, NULL, 10);
+    return (v > 0 && v <= 65535) ? (uint16_t)v : fallback;
+}
+
+static uint16_t ParsePort(const char* str) {
+    return ParsePortOr(str, 3333);
+}
+
+static int ParseThreads(const char* str) {
+    long v = strtol(str, NULL, 10);
+    return (v > 0 && v <= 32) ? (int)v : 2;
+}
+
+static int ParseShareInterval(const char* str) {
+    long v = strtol(str, NULL, 10);
+    return (v >= 0 && v <= 3600) ? (int)v : 20;
+}
+
+/* HOST, HOST:PORT or [ADDR]:PORT; a bare IPv6 address has no port */
+static void ParseHostPort(const char* str, char* host, size_t hostSize, uint16_t* port, uint16_t fallback) {
+    const char* colon = strrchr(str, ':');
+    *port = fallback;
+    if (str[0] == '[') {
+        const char* close = strchr(str, ']');
+        size_t len = close ? (size_t)(close - str - 1) : strlen(str + 1);
+        snprintf(host, hostSize, "%.*s", (int)len, str + 1);
+        if (close && close[1] == ':') *port = ParsePortOr(close + 2, fallback);
+    } else if (colon && colon == strchr(str, ':')) {
+        snprintf(host, hostSize, "%.*s", (int)(colon - str), str);
+        *port = ParsePortOr(colon + 1, fallback);
+    } else {
+        snprintf(host, hostSize, "%s", str);
+    }
+}
+
+/* Pool list: comma-separated [WALLET[.WORKER]@]HOST[:PORT][*WEIGHT].
+ * Returns the number of entries, or -1 for a malformed one. */
+static int ParsePoolList(const char* list, PoolEntry_t* entries, int maxEntries) {
+    char buf[PDQ_POOL_LIST_MAX];
+    char* save = NULL;
+    int count = 0;
+
+    snprintf(buf, sizeof(buf), "%s", list);
+    for (char* tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        while (*tok == ' ' || *tok == '\t') tok++;
+        char* end = tok + strlen(tok);
+        while (end > tok && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+        if (!*tok) continue;
+        if (count == maxEntries) {
+            fprintf(stderr, "[PDQminer] Pool list holds at most %d pools\n", maxEntries);
+            return -1;
+        }
+
+        PoolEntry_t* entry = &entries[count];
+        memset(entry, 0, sizeof(*entry));
+        entry->Weight = 1;
+
+        char* star = strrchr(tok, '*');
+        if (star) {
+            char* stop = NULL;
+            long weight = strtol(star + 1, &stop, 10);
+            if (weight < 1 || weight > 1000 || *stop) return -1;
+            entry->Weight = (uint32_t)weight;
+            *star = '\0';
+        }
+        char* at = strchr(tok, '@');
+        if (at) {
+            *at = '\0';
+            char* dot = strchr(tok, '.');
+            if (dot) {
+                *dot = '\0';
+                snprintf(entry->Worker, sizeof(entry->Worker), "%s", dot + 1);
+            }
+            snprintf(entry->Wallet, sizeof(entry->Wallet), "%s", tok);
+            tok = at + 1;
+        }
+        ParseHostPort(tok, entry->Host, sizeof(entry->Host), &entry->Port, 3333);
+        if (!entry->Host[0]) return -1;
+        count++;
+    }
+    return count;
+}
+
+/* A setting from the environment, else the config file; NULL for neither */
+static const char* Lookup(const char* env, const char* key, char* buf, size_t size) {
+    const char* v = getenv(env);
+    if (v && v[0]) return v;
+    if (PdqConfigGetString(key, buf, size) == PdqOk && buf[0]) return buf;
+    return NULL;
+}
+
+static void CopySetting(char* dst, size_t size, const char* env, const char* key, const char* fallback) {
+    char buf[PDQ_POOL_LIST_MAX];
+    const char* v = Lookup(env, key, buf, sizeof(buf));
+    snprintf(dst, size, "%s", v ? v : fallback);
+}
+
+/* Settings as startup or a reload sees them, the config file already loaded */
+static void ResolveSettings(Settings_t* out) {
+    char buf[64];
+    const char* v;
+    memset(out, 0, sizeof(*out));
+
+    CopySetting(out->PoolHost, sizeof(out->PoolHost), "PDQ_POOL_HOST", PDQ_CONFIG_KEY_POOL1_HOST,
+                "pool.nerdminers.org");
+    v = Lookup("PDQ_POOL_PORT", PDQ_CONFIG_KEY_POOL1_PORT, buf, sizeof(buf));
+    out->PoolPort = ParsePort(v ? v : "3333");
+    CopySetting(out->BackupHost, sizeof(out->BackupHost), "PDQ_BACKUP_HOST", PDQ_CONFIG_KEY_POOL2_HOST, "");
+    v = Lookup("PDQ_BACKUP_PORT", PDQ_CONFIG_KEY_POOL2_PORT, buf, sizeof(buf));
+    out->BackupPort = ParsePort(v ? v : "3333");
+    CopySetting(out->Wallet, sizeof(out->Wallet), "PDQ_WALLET", PDQ_CONFIG_KEY_WALLET, "");
+    CopySetting(out->Worker, sizeof(out->Worker), "PDQ_WORKER", PDQ_CONFIG_KEY_WORKER, "pdqlinux");
+    v = Lookup("PDQ_THREADS", PDQ_CONFIG_KEY_THREADS, buf, sizeof(buf));
+    out->Threads = ParseThreads(v ? v : "2");
+    v = Lookup("PDQ_DIFFICULTY", PDQ_CONFIG_KEY_DIFFICULTY, buf, sizeof(buf));
+    out->Difficulty = atof(v ? v : "1.0");
+    v = Lookup("PDQ_SHARE_INTERVAL", PDQ_CONFIG_KEY_SHARE_INTERVAL, buf, sizeof(buf));
+    out->ShareInterval = ParseShareInterval(v ? v : "20");
+    CopySetting(out->PoolList, sizeof(out->PoolList), "PDQ_POOLS", PDQ_CONFIG_KEY_POOLS, "");
+
+    if (s_CliSet & SET_POOL_HOST) memcpy(out->PoolHost, s_Cli.PoolHost, sizeof(out->PoolHost));
+    if (s_CliSet & SET_POOL_PORT) out->PoolPort = s_Cli.PoolPort;
+    if (s_CliSet & SET_BACKUP_HOST) memcpy(out->BackupHost, s_Cli.BackupHost, sizeof(out->BackupHost));
+    if (s_CliSet & SET_BACKUP_PORT) out->BackupPort = s_Cli.BackupPort;
+    if (s_CliSet & SET_WALLET) memcpy(out->Wallet, s_Cli.Wallet, sizeof(out->Wallet));
+    if (s_CliSet & SET_WORKER) memcpy(out->Worker, s_Cli.Worker, sizeof(out->Worker));
+    if (s_CliSet & SET_THREADS) out->Threads = s_Cli.Threads;
+    if (s_CliSet & SET_DIFFICULTY) out->Difficulty = s_Cli.Difficulty;
+    if (s_CliSet & SET_SHARE_INTERVAL) out->ShareInterval = s_Cli.ShareInterval;
+    if (s_CliSet & SET_POOL_LIST) memcpy(out->PoolList, s_Cli.PoolList, sizeof(out->PoolList));
+}
+
+/* The primary and backup pools and credentials before any pool list */
+static void BaseConfig(const Settings_t* settings, PdqDeviceConfig_t* out) {
+    memset(out, 0, sizeof(*out));
+    snprintf(out->PrimaryPool.Host, sizeof(out->PrimaryPool.Host), "%s", settings->PoolHost);
+    out->PrimaryPool.Port = settings->PoolPort;
+    snprintf(out->WalletAddress, sizeof(out->WalletAddress), "%s", settings->Wallet);
+    snprintf(out->WorkerName, sizeof(out->WorkerName), "%s", settings->Worker);
+    snprintf(out->BackupPool.Host, sizeof(out->BackupPool.Host), "%s", settings->BackupHost);
+    out->BackupPool.Port = settings->BackupPort;
+}
+
+/* Session i's pools and credentials: entry i of a pool list, with no
+ * backup, or the base config when there is no list */
+static void SessionConfig(const PdqDeviceConfig_t* base, const PoolEntry_t* entries, int entryCount, int i,
+                          PdqDeviceConfig_t* out, uint32_t* weight) {
+    *out = *base;
+    *weight = 1;
+    if (entryCount == 0) return;
+    const PoolEntry_t* entry = &entries[i];
+    memcpy(out->PrimaryPool.Host, entry->Host, sizeof(out->PrimaryPool.Host));
+    out->PrimaryPool.Port = entry->Port;
+    memset(&out->BackupPool, 0, sizeof(out->BackupPool));
+    if (entry->Wallet[0]) snprintf(out->WalletAddress, sizeof(out->WalletAddress), "%s", entry->Wallet);
+    if (entry->Worker[0]) snprintf(out->WorkerName, sizeof(out->WorkerName), "%s", entry->Worker);
+    *weight = entry->Weight;
+}
+
+/* Log prefix naming the session when there is more than one */
+static const char* SessionTag(const PoolSession_t* session) {
+    static char tag[16];
+    if (s_SessionCount <= 1) return "";
+    snprintf(tag, sizeof(tag), "#%d ", (int)(session - s_Sessions) + 1);
+    return tag;
+}
+
+/* Hand a built job to a session's miners, waking them if they were parked */
+static void MineJob(PoolSession_t* session, PdqMiningJob_t* job, double poolDiff, bool clean) {
+    session->Jobs++;
+    if (clean) session->CleanJobs++;
+    job->NonceStart = 0;
+    job->NonceEnd = 0xFFFFFFFF;
+    PdqMiningCtxSetJob(&session->Miner, job);
+    printf("[PDQminer] %sNew job: %s (diff=%.1f)\n", SessionTag(session), job->JobId, poolDiff);
+
+    if (session->Parked) {
+        PdqMiningCtxResume(&session->Miner);
+        session->Parked = false;
+        printf("[PDQminer] %sMining resumed\n", SessionTag(session));
+    }
+}
+
+/* Shares found now could not be submitted: park the session on its
+ * current job until work arrives again. Its share of the threads goes to
+ * the other sessions meanwhile. */
+static void ParkSession(PoolSession_t* session, const char* source) {
+    if (!s_MiningStarted || session->Parked) return;
+    PdqMiningCtxPause(&session->Miner);
+    session->Parked = true;
+    printf("[PDQminer] %sMining parked while the %s is unavailable\n", SessionTag(session), source);
+}
+
+static void StartMining(void);
+
+/* Build a mining job from a session's latest notify */
+static void DispatchSessionJob(PoolSession_t* session) {
+    PdqStratumContext_t* ctx = PdqPoolSupervisorGetContext(&session->Supervisor);
+    if (!s_MiningStarted || !PdqStratumCtxHasNewJob(ctx)) return;
+
+    PdqStratumJob_t stratumJob;
+    PdqStratumCtxGetJob(ctx, &stratumJob);
+
+    if (stratumJob.CleanJobs) {
+        PdqMiningCtxClearShares(&session->Miner);
+    }
+
+    /* Extranonce1 and the extranonce2 counter belong to the session, so
+     * the context builds the job: both change on reconnect or failover. */
+    PdqMiningJob_t job;
+    if (PdqStratumCtxBuildNextJob(ctx, &job) != PdqOk) return;
+    MineJob(session, &job, PdqStratumCtxGetDifficulty(ctx), stratumJob.CleanJobs);
+}
+
+static void DispatchNewJob(void) {
+    PoolSession_t* session = &s_Sessions[0];
+
+    if (s_UseSolo) {
+        /* The first template starts the miners; a new tip retires the
+         * shares queued on the old one */
+        PdqMiningJob_t job;
+        bool clean = false;
+        if (!PdqGbtHasNewJob() || PdqGbtBuildNextJob(&job, &clean) != PdqOk) return;
+        if (!s_MiningStarted) {
+            StartMining();
+        } else if (clean) {
+            PdqMiningCtxClearShares(&session->Miner);
+        }
+        MineJob(session, &job, PdqGbtGetDifficulty(), clean);
+        return;
+    }
+    if (s_UseSv2) {
+        /* A standard job is a whole header; a new one always replaces the
+         * old, and SetNewPrevHash has already retired what was queued */
+        PdqMiningJob_t job;
+        if (!s_MiningStarted || !PdqSv2CtxHasNewJob(&s_Sv2) ||
+            PdqSv2CtxBuildJob(&s_Sv2, &job) != PdqOk) {
+            return;
+        }
+        MineJob(session, &job, PdqSv2CtxGetDifficulty(&s_Sv2), false);
+        return;
+    }
+    if (s_UseProxy) {
+        if (PdqStratumCtxHasNewJob(PdqPoolSupervisorGetContext(&session->Supervisor))) PdqProxyOnJob();
+        return;
+    }
+
+    for (int i = 0; i < s_SessionCount; i++) DispatchSessionJob(&s_Sessions[i]);
+}
+
+/* Drain every queued share into one corked batch, so a burst leaves in
+ * a single write. If the socket backs up, the rest waits until it
+ * drains: the pool descriptor is watched for writability meanwhile.
+ * Block candidates dequeue first and are flushed on their own. */
+static void SubmitSessionShares(PoolSession_t* session) {
+    PdqMiningContext_t* miner = &session->Miner;
+    PdqStratumContext_t* ctx = PdqPoolSupervisorGetContext(&session->Supervisor);
+    if (!PdqStratumCtxIsReady(ctx)) return;
+
+    PdqStratumCtxCork(ctx, true);
+    while (PdqMiningCtxHasShare(miner)) {
+        if (PdqStratumCtxGetTxSpace(ctx) < PDQ_STRATUM_SEND_BUFFER_SIZE &&
+            (PdqStratumCtxFlush(ctx) != PdqOk ||
+             PdqStratumCtxGetTxSpace(ctx) < PDQ_STRATUM_SEND_BUFFER_SIZE)) {
+            break;
+        }
+
+        PdqShareInfo_t share;
+        if (PdqMiningCtxGetShare(miner, &share) != PdqOk ||
+            PdqStratumCtxSubmitMinedShare(ctx, &share) != PdqOk) {
+            continue;
+        }
+        if (share.BlockCandidate) {
+            PdqStratumCtxFlush(ctx);
+            printf("[PDQminer] %sBlock candidate submitted: nonce=%08X\n", SessionTag(session), share.Nonce);
+        } else {
+            printf("[PDQminer] %sShare submitted: nonce=%08X\n", SessionTag(session), share.Nonce);
+        }
+    }
+    PdqStratumCtxCork(ctx, false);
+}
+
+static void SubmitShares(void) {
+    PdqMiningContext_t* miner = &s_Sessions[0].Miner;
+
+    /* The proxy forwards its devices' shares as they arrive */
+    if (s_UseProxy || !s_MiningStarted) return;
+    if (s_UseSolo) {
+        /* Solo jobs carry the network target: every share is a block */
+        while (PdqMiningCtxHasShare(miner)) {
+            PdqShareInfo_t share;
+            if (PdqMiningCtxGetShare(miner, &share) != PdqOk || PdqGbtSubmitBlock(&share) != PdqOk) continue;
+            printf("[PDQminer] Block candidate submitted: nonce=%08X\n", share.Nonce);
+        }
+        return;
+    }
+    if (s_UseSv2) {
+        while (PdqSv2CtxIsReady(&s_Sv2) && PdqMiningCtxHasShare(miner)) {
+            PdqShareInfo_t share;
+            if (PdqMiningCtxGetShare(miner, &share) != PdqOk ||
+                PdqSv2CtxSubmitShare(&s_Sv2, share.JobId, share.Nonce, share.NTime) != PdqOk) {
+                continue;
+            }
+            printf("[PDQminer] %s submitted: nonce=%08X\n",
+                   share.BlockCandidate ? "Block candidate" : "Share", share.Nonce);
+        }
+        return;
+    }
+
+    for (int i = 0; i < s_SessionCount; i++) SubmitSessionShares(&s_Sessions[i]);
+}
+
+/* Pool answered a submit (or never will): feed the share stats of the
+ * session it came from, passed as p_Arg */
+static void OnSubmitResult(void* p_Arg, PdqSubmitResult_t result, int32_t errorCode, uint32_t latencyMs) {
+    PoolSession_t* session = (PoolSession_t*)p_Arg;
+    (void)errorCode;
+    if (s_UseProxy) {
+        PdqProxyRecordSubmitResult(result);
+        return;
+    }
+    PdqMiningCtxRecordSubmitResult(&session->Miner, result, latencyMs);
+}
+
+/* One thread pool for every session, each attached with its weight */
+static void StartMining(void) {
+    PdqMiningPoolInit(&s_Miners, s_Settings.Threads, &s_ShareNotifier);
+    for (int i = 0; i < s_SessionCount; i++) {
+        PdqMiningCtxInit(&s_Sessions[i].Miner);
+        PdqMiningPoolAttach(&s_Miners, &s_Sessions[i].Miner, s_Sessions[i].Weight);
+    }
+    PdqMiningPoolStart(&s_Miners);
+
+    s_MiningStarted = true;
+    printf("[PDQminer] Mining started with %d thread(s)\n\n", s_Settings.Threads);
+}
+
+/* Let a session's supervisor advance it and react to what it reports */
+static void DriveSession(PoolSession_t* session) {
+    uint32_t events = PdqPoolSupervisorProcess(&session->Supervisor, GetMillis());
+
+    if (events & PDQ_POOL_EVENT_LOST) ParkSession(session, "pool");
+
+    if (events & PDQ_POOL_EVENT_READY) {
+        const PdqPoolConfig_t* pool = PdqPoolSupervisorGetActivePool(&session->Supervisor);
+        printf("[PDQminer] %sAuthorized on %s:%u\n", SessionTag(session), pool->Host, pool->Port);
+        if (!s_MiningStarted) {
+            StartMining();
+        } else if (!PdqPoolSupervisorSessionKept(&session->Supervisor)) {
+            /* Queued shares carry the previous session's extranonce1; a
+             * resumed session keeps it, so those still go out */
+            PdqMiningCtxClearShares(&session->Miner);
+        }
+
+        /* Hot standby: the new pool's job is already built */
+        PdqMiningJob_t job;
+        if (PdqPoolSupervisorTakeSwitchJob(&session->Supervisor, &job)) {
+            MineJob(session, &job,
+                    PdqStratumCtxGetDifficulty(PdqPoolSupervisorGetContext(&session->Supervisor)), true);
+        }
+    }
+}
+
+static void DrivePool(void) {
+    PoolSession_t* session = &s_Sessions[0];
+
+    if (s_UseSolo) {
+        /* A block found while the node is unreachable could not be
+         * submitted, so the miners wait for it */
+        PdqGbtTick(GetMillis());
+        if (!PdqGbtIsReady()) {
+            ParkSession(session, "node");
+        } else if (session->Parked) {
+            PdqMiningCtxResume(&session->Miner);
+            session->Parked = false;
+            printf("[PDQminer] Node is back, mining resumed\n");
+        }
+        return;
+    }
+    if (s_UseSv2) {
+        uint64_t now = GetMillis();
+        bool wasReady = PdqSv2CtxIsReady(&s_Sv2);
+        if (PdqSv2CtxGetState(&s_Sv2) == Sv2StateDisconnected) {
+            if (now < s_Sv2RetryMs) return;
+            s_Sv2RetryMs = now + PDQ_SV2_RETRY_MS;
+            PdqSv2CtxConnectStart(&s_Sv2, s_Config.PrimaryPool.Host, s_Config.PrimaryPool.Port,
+                                  s_Sv2User, 0.0f);
+            return;
+        }
+        PdqSv2CtxProcess(&s_Sv2);
+
+        if (wasReady && !PdqSv2CtxIsReady(&s_Sv2)) ParkSession(session, "pool");
+        if (!wasReady && PdqSv2CtxIsReady(&s_Sv2)) {
+            printf("[PDQminer] SV2 channel open on %s:%u\n",
+                   s_Config.PrimaryPool.Host, s_Config.PrimaryPool.Port);
+            if (!s_MiningStarted) {
+                StartMining();
+            } else {
+                PdqMiningCtxClearShares(&session->Miner);
+            }
+        }
+        return;
+    }
+    if (s_UseProxy) {
+        /* Devices keep their connections and current job through an
+         * outage; their shares are checked but not forwarded meanwhile */
+        uint32_t events = PdqPoolSupervisorProcess(&session->Supervisor, GetMillis());
+        if (events & PDQ_POOL_EVENT_LOST) {
+            PdqProxySetUpstream(NULL);
+            printf("[PDQminer] Pool unavailable, holding downstream shares\n");
+        }
+        if (events & PDQ_POOL_EVENT_READY) {
+            const PdqPoolConfig_t* pool = PdqPoolSupervisorGetActivePool(&session->Supervisor);
+            printf("[PDQminer] Authorized on %s:%u\n", pool->Host, pool->Port);
+            PdqProxySetUpstream(PdqPoolSupervisorGetContext(&session->Supervisor));
+            PdqProxyOnJob();
+        }
+        return;
+    }
+
+    for (int i = 0; i < s_SessionCount; i++) DriveSession(&s_Sessions[i]);
+}
+
+/* Earliest staggered connect attempt across the sessions, -1 for none */
+static int GetWakeupMs(void) {
+    if (s_UseSv2 || s_UseSolo) return -1;
+    int wakeup = -1;
+    for (int i = 0; i < s_SessionCount; i++) {
+        int ms = PdqPoolSupervisorGetWakeupMs(&s_Sessions[i].Supervisor);
+        if (ms >= 0 && (wakeup < 0 || ms < wakeup)) wakeup = ms;
+    }
+    return wakeup;
+}
+
+static void OnPoolEvent(int Fd, uint32_t Events, void* p_Arg);
+
+/* Keep the epoll registrations in step with the pool sessions, whose
+ * descriptors change between resolving, connecting and connected, and
+ * disappear when a pool drops the connection. While addresses are raced
+ * a session has one descriptor per connect attempt. */
+static void SyncSessionWatch(PoolSession_t* session) {
+    for (uint8_t i = 0; i < 2; i++) {
+        PdqStratumContext_t* ctx = PdqPoolSupervisorGetSessionContext(&session->Supervisor, i);
+        int fds[PDQ_STRATUM_MAX_ADDRS];
+        bool wantWrite = false;
+        int count = ctx ? PdqStratumCtxGetPollFds(ctx, fds, PDQ_STRATUM_MAX_ADDRS, &wantWrite) : 0;
+        uint32_t events = wantWrite ? (PDQ_EVENT_READ | PDQ_EVENT_WRITE) : PDQ_EVENT_READ;
+
+        /* Drop registrations the session no longer uses */
+        for (int j = 0; j < session->FdCount[i]; j++) {
+            bool kept = false;
+            for (int k = 0; k < count; k++) kept |= (fds[k] == session->Fds[i][j]);
+            if (!kept) PdqEventRemove(session->Fds[i][j]);
+        }
+
+        int watched = 0;
+        for (int k = 0; k < count; k++) {
+            bool known = false;
+            for (int j = 0; j < session->FdCount[i]; j++) known |= (fds[k] == session->Fds[i][j]);
+            if (known) {
+                PdqEventModify(fds[k], events);
+            } else if (PdqEventAdd(fds[k], events, OnPoolEvent, NULL) != PdqOk) {
+                continue;
+            }
+            session->Fds[i][watched++] = fds[k];
+        }
+        session->FdCount[i] = watched;
+    }
+}
+
+static void SyncPoolWatch(void) {
+    /* The solo RPC connections register themselves */
+    if (s_UseSolo) return;
+    if (s_UseSv2) {
+        bool wantWrite = false;
+        int fd = PdqSv2CtxGetPollFd(&s_Sv2, &wantWrite);
+        uint32_t events = wantWrite ? (PDQ_EVENT_READ | PDQ_EVENT_WRITE) : PDQ_EVENT_READ;
+        if (fd != s_Sv2Fd && s_Sv2Fd >= 0) PdqEventRemove(s_Sv2Fd);
+        if (fd >= 0 && fd == s_Sv2Fd) {
+            PdqEventModify(fd, events);
+        } else if (fd >= 0 && PdqEventAdd(fd, events, OnPoolEvent, NULL) != PdqOk) {
+            fd = -1;
+        }
+        s_Sv2Fd = fd;
+        return;
+    }
+
+    for (int i = 0; i < s_SessionCount; i++) SyncSessionWatch(&s_Sessions[i]);
+}
+
+static void OnPoolEvent(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    (void)Events;
+    (void)p_Arg;
+    DrivePool();
+    DispatchNewJob();
+    SubmitShares();
+    SyncPoolWatch();
+}
+
+/* The node handed over a template, or the current one is due a new
+ * extranonce */
+static void OnGbtJob(void* p_Arg) {
+    (void)p_Arg;
+    DispatchNewJob();
+}
+
+static void OnShareEvent(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    (void)Events;
+    (void)p_Arg;
+    PdqEventNotifierDrain(&s_ShareNotifier);
+    SubmitShares();
+    SyncPoolWatch();
+}
+
+/* Submit throughput and outbound queue depth across every session */
+static void PrintSubmitStats(void) {
+    static uint32_t s_LastSubmitted = 0;
+    if (s_UseSolo) {
+        PdqGbtStats_t gbt;
+        PdqGbtGetStats(&gbt);
+        printf("[GBT] Height: %lu | Txs: %lu | Value: %.8f BTC | Templates: %lu (longpoll %lu, errors %lu) | "
+               "Blocks: %lu (acc %lu, rej %lu)\n",
+               (unsigned long)gbt.Height, (unsigned long)gbt.Transactions, gbt.CoinbaseValue / 1e8,
+               (unsigned long)gbt.Templates, (unsigned long)gbt.LongPolls, (unsigned long)gbt.RpcErrors,
+               (unsigned long)gbt.BlocksSubmitted, (unsigned long)gbt.BlocksAccepted,
+               (unsigned long)gbt.BlocksRejected);
+        return;
+    }
+    if (s_UseSv2) return;
+    uint32_t submitted = 0, queued = 0, peak = 0, messages = 0, writes = 0;
+
+    for (int s = 0; s < s_SessionCount; s++) {
+        for (uint8_t i = 0; i < 2; i++) {
+            PdqStratumContext_t* ctx = PdqPoolSupervisorGetSessionContext(&s_Sessions[s].Supervisor, i);
+            if (!ctx) continue;
+            PdqStratumSubmitStats_t submit;
+            PdqStratumTxStats_t tx;
+            PdqStratumCtxGetSubmitStats(ctx, &submit);
+            PdqStratumCtxGetTxStats(ctx, &tx);
+            submitted += submit.Submitted;
+            queued += PdqStratumCtxGetTxQueued(ctx);
+            if (tx.QueuedPeak > peak) peak = tx.QueuedPeak;
+            messages += tx.Messages;
+            writes += tx.Writes;
+        }
+    }
+
+    double seconds = (PDQ_STATS_TICK_MS * PDQ_STATS_PRINT_TICKS) / 1000.0;
+    printf("[POOL] Submits: %.1f/s | TX queue: %lu B (peak %lu B) | %.1f msgs/write\n",
+           (submitted - s_LastSubmitted) / seconds,
+           (unsigned long)queued, (unsigned long)peak,
+           writes ? (double)messages / writes : 0.0);
+    s_LastSubmitted = submitted;
+}
+
+/* Client-side vardiff: retune a session's suggested difficulty from the
+ * hashrate its context measured and its share rate */
+static void TuneDifficulty(PoolSession_t* session, uint64_t totalHashes, uint32_t found, uint64_t hashRate) {
+    /* SV2 pools set the channel target themselves; solo mines at the
+     * network target */
+    if (s_UseSv2 || s_UseSolo) return;
+    PdqStratumContext_t* ctx = PdqPoolSupervisorGetContext(&session->Supervisor);
+    if (!s_VardiffOn || !PdqStratumCtxIsReady(ctx)) return;
+
+    double suggest;
+    if (PdqVardiffUpdate(&session->Vardiff, GetMillis(), totalHashes, found,
+                         PdqStratumCtxGetDifficulty(ctx), &suggest)) {
+        printf("[PDQminer] %sVardiff: %lu KH/s at diff %.2f, suggesting %.2f\n", SessionTag(session),
+               (unsigned long)(hashRate / 1000), PdqStratumCtxGetDifficulty(ctx), suggest);
+        PdqPoolSupervisorSuggestDifficulty(&session->Supervisor, suggest);
+    }
+}
+
+/* Proxy mode: the fleet's hashrate is what its accepted shares stand for,
+ * and the upstream difficulty is tuned to the rate shares are forwarded */
+static void ProxyTick(void) {
+    static uint64_t s_LastHashes = 0;
+    static uint64_t s_LastMs = 0;
+    uint64_t now = GetMillis();
+    PdqProxyTick(now);
+
+    PdqProxyStats_t stats;
+    PdqProxyGetStats(&stats);
+    TuneDifficulty(&s_Sessions[0], stats.TotalHashes, stats.SharesForwarded, 0);
+
+    if (++s_StatsTicks % PDQ_STATS_PRINT_TICKS != 0) return;
+    double seconds = s_LastMs ? (now - s_LastMs) / 1000.0 : 0.0;
+    uint64_t hashRate = seconds > 0.0 ? (uint64_t)((stats.TotalHashes - s_LastHashes) / seconds) : 0;
+    s_LastHashes = stats.TotalHashes;
+    s_LastMs = now;
+    printf("[PROXY] Devices: %lu | ~%lu KH/s | Shares: %lu (rej %lu, stale %lu, dup %lu) | "
+           "Forwarded: %lu (pool acc %lu, rej %lu, held %lu)\n",
+           (unsigned long)stats.Clients, (unsigned long)(hashRate / 1000),
+           (unsigned long)stats.SharesAccepted, (unsigned long)stats.SharesRejected,
+           (unsigned long)stats.SharesStale, (unsigned long)stats.SharesDuplicate,
+           (unsigned long)stats.SharesForwarded, (unsigned long)stats.UpstreamAccepted,
+           (unsigned long)stats.UpstreamRejected, (unsigned long)stats.SharesUnforwarded);
+}
+
+/* The device API's view of one work source */
+static void SnapshotPool(PoolSession_t* session, PdqApiPool_t* out) {
+    out->Weight = session->Weight;
+    out->Parked = session->Parked;
+    out->Jobs = session->Jobs;
+    out->CleanJobs = session->CleanJobs;
+    if (s_MiningStarted) PdqMiningCtxGetStats(&session->Miner, &out->Stats);
+
+    if (s_UseSolo) {
+        snprintf(out->Host, sizeof(out->Host), "%s", s_SoloHost);
+        out->Port = s_SoloPort;
+        out->Ready = PdqGbtIsReady();
+        out->Difficulty = PdqGbtGetDifficulty();
+        return;
+    }
+    if (s_UseSv2) {
+        snprintf(out->Host, sizeof(out->Host), "%s", s_Config.PrimaryPool.Host);
+        out->Port = s_Config.PrimaryPool.Port;
+        out->Ready = PdqSv2CtxIsReady(&s_Sv2);
+        out->Difficulty = PdqSv2CtxGetDifficulty(&s_Sv2);
+        return;
+    }
+    const PdqPoolConfig_t* pool = PdqPoolSupervisorGetActivePool(&session->Supervisor);
+    PdqStratumContext_t* ctx = PdqPoolSupervisorGetContext(&session->Supervisor);
+    snprintf(out->Host, sizeof(out->Host), "%s", pool->Host);
+    out->Port = pool->Port;
+    out->Ready = PdqStratumCtxIsReady(ctx);
+    out->Backup = PdqPoolSupervisorGetState(&session->Supervisor) == PoolStateBackupConnected;
+    out->Difficulty = PdqStratumCtxGetDifficulty(ctx);
+    if (s_UseProxy) {
+        /* The fleet's shares, as forwarded to the pool */
+        PdqProxyStats_t proxy;
+        PdqProxyGetStats(&proxy);
+        out->Stats.TotalHashes = proxy.TotalHashes;
+        out->Stats.SharesAccepted = proxy.UpstreamAccepted;
+        out->Stats.SharesRejected = proxy.UpstreamRejected;
+    }
+}
+
+/* Filled per API request on the loop thread; the miner threads' counters
+ * are atomics, so this never waits on them */
+static void FillApiSnapshot(void* p_Arg, PdqApiSnapshot_t* snap) {
+    (void)p_Arg;
+    snprintf(snap->DeviceId, sizeof(snap->DeviceId), "PDQ_%08X", PdqHalGetChipId());
+    snap->p_Hardware = "linux";
+    snap->p_Mode = s_UseSolo ? "solo" : s_UseSv2 ? "sv2" : s_UseProxy ? "proxy" : "pool";
+    snap->UptimeSec = (uint32_t)((GetMillis() - s_StartMs) / 1000);
+    snap->FreeHeap = PdqHalGetFreeHeap();
+    snap->CpuMhz = s_CpuMhz;
+    snap->Temperature = PdqHalGetTemperature();
+    snap->Config = s_Config;
+
+    if (s_MiningStarted) {
+        PdqMiningThreadStats_t threads[PDQ_MINING_MAX_THREADS];
+        int n = PdqMiningPoolGetThreadStats(&s_Miners, threads, PDQ_API_MAX_THREADS);
+        for (int i = 0; i < n; i++) {
+            snap->ThreadHashRate[i] = threads[i].HashRate;
+            snap->ThreadHashes[i] = threads[i].TotalHashes;
+        }
+        snap->ThreadCount = (uint32_t)n;
+    }
+    snap->PoolCount = (uint32_t)s_SessionCount;
+    for (int i = 0; i < s_SessionCount && i < PDQ_API_MAX_POOLS; i++) SnapshotPool(&s_Sessions[i], &snap->Pools[i]);
+}
+
+/* Serve the device API; tokens for --api-password derive from a random
+ * secret so they cannot be guessed from the password */
+static PdqError_t StartApi(uint16_t port, const char* bind, const char* password) {
+    uint8_t secret[32];
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || read(fd, secret, sizeof(secret)) != (ssize_t)sizeof(secret)) {
+        fprintf(stderr, "[API] Cannot read /dev/urandom\n");
+        if (fd >= 0) close(fd);
+        return PdqErrorInvalidParam;
+    }
+    close(fd);
+
+    PdqApiSetSource(FillApiSnapshot, NULL);
+    PdqApiSetPassword(password, secret, sizeof(secret));
+    memset(secret, 0, sizeof(secret));
+    return PdqHttpStart(port, bind);
+}
+
+/* Once a second into --stats-shm, from the same snapshot the API serves */
+static void PublishStats(void) {
+    static PdqApiSnapshot_t snap;
+    static PdqShmStats_t out;
+    struct timespec now;
+
+    if (!s_Shm.p_Region) return;
+    memset(&snap, 0, sizeof(snap));
+    FillApiSnapshot(NULL, &snap);
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    memset(&out, 0, offsetof(PdqShmStats_t, HistoryCount));
+    out.UpdatedMs = (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+    out.UptimeSec = snap.UptimeSec;
+    snprintf(out.Mode, sizeof(out.Mode), "%s", snap.p_Mode);
+    out.ThreadCount = snap.ThreadCount < PDQ_SHM_MAX_THREADS ? snap.ThreadCount : PDQ_SHM_MAX_THREADS;
+    memcpy(out.ThreadHashRate, snap.ThreadHashRate, out.ThreadCount * sizeof(out.ThreadHashRate[0]));
+    memcpy(out.ThreadHashes, snap.ThreadHashes, out.ThreadCount * sizeof(out.ThreadHashes[0]));
+    out.PoolCount = snap.PoolCount < PDQ_SHM_MAX_POOLS ? snap.PoolCount : PDQ_SHM_MAX_POOLS;
+    for (uint32_t i = 0; i < out.PoolCount; i++) {
+        const PdqApiPool_t* pool = &snap.Pools[i];
+        PdqShmPool_t* dst = &out.Pools[i];
+        PdqMinerStats_t* total = &out.Total;
+        snprintf(dst->Host, sizeof(dst->Host), "%s", pool->Host);
+        dst->Port = pool->Port;
+        dst->Ready = pool->Ready;
+        dst->Backup = pool->Backup;
+        dst->Parked = pool->Parked;
+        dst->Weight = pool->Weight;
+        dst->Difficulty = pool->Difficulty;
+        dst->Stats = pool->Stats;
+
+        total->HashRate += pool->Stats.HashRate;
+        total->TotalHashes += pool->Stats.TotalHashes;
+        total->SharesAccepted += pool->Stats.SharesAccepted;
+        total->SharesRejected += pool->Stats.SharesRejected;
+        total->SharesTimedOut += pool->Stats.SharesTimedOut;
+        total->SharesStale += pool->Stats.SharesStale;
+        total->BlocksFound += pool->Stats.BlocksFound;
+        total->SubmitLatencySumMs += pool->Stats.SubmitLatencySumMs;
+        for (int b = 0; b < PDQ_SUBMIT_LATENCY_BUCKETS; b++) {
+            total->SubmitLatencyHist[b] += pool->Stats.SubmitLatencyHist[b];
+        }
+    }
+    out.Total.Uptime = snap.UptimeSec;
+    out.Total.Temperature = snap.Temperature;
+    if (out.PoolCount) out.Total.Difficulty = out.Pools[0].Difficulty;
+    PdqShmPublish(&s_Shm, &out);
+}
+
+static void OnStatsTick(int Fd, uint32_t Events, void* p_Arg) {
+    (void)Fd;
+    (void)Events;
+    (void)p_Arg;
+
+    /* Drives per-stage timeouts, reconnect backoff and the pool watchdog */
+    DrivePool();
+    DispatchNewJob();
+    SyncPoolWatch();
+
+    PdqHalFeedWdt();
+    PublishStats();
+    if (s_UseProxy) {
+        ProxyTick();
+        return;
+    }
+    if (!s_MiningStarted) return;
+
+    /* Each session's vardiff sees the hashrate its context got */
+    PdqMinerStats_t stats;
+    PdqMinerStats_t sessionStats[PDQ_MINING_MAX_CONTEXTS];
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < s_SessionCount; i++) {
+        PdqMinerStats_t* own = &sessionStats[i];
+        PdqMiningCtxGetStats(&s_Sessions[i].Miner, own);
+        TuneDifficulty(&s_Sessions[i], own->TotalHashes,
+                       own->SharesAccepted + own->SharesRejected + own->SharesTimedOut + own->SharesStale,
+                       own->HashRate);
+        stats.HashRate += own->HashRate;
+        stats.TotalHashes += own->TotalHashes;
+        stats.SharesAccepted += own->SharesAccepted;
+        stats.SharesRejected += own->SharesRejected;
+        stats.SharesTimedOut += own->SharesTimedOut;
+        stats.SharesStale += own->SharesStale;
+        stats.BlocksFound += own->BlocksFound;
+        stats.Uptime = own->Uptime;
+    }
+    PdqApiProcess();
+
+    if (++s_StatsTicks % PDQ_STATS_PRINT_TICKS == 0) {
+        printf("[PDQminer] Hashrate: %lu KH/s | Shares: %lu (rej %lu, no reply %lu, stale %lu) | Blocks: %lu | Uptime: %lus\n",
+               (unsigned long)(stats.HashRate / 1000),
+               (unsigned long)stats.SharesAccepted,
+               (unsigned long)stats.SharesRejected,
+               (unsigned long)stats.SharesTimedOut,
+               (unsigned long)stats.SharesStale,
+               (unsigned long)stats.BlocksFound,
+               (unsigned long)stats.Uptime);
+        for (int i = 0; s_SessionCount > 1 && i < s_SessionCount; i++) {
+            const PdqPoolConfig_t* pool = PdqPoolSupervisorGetActivePool(&s_Sessions[i].Supervisor);
+            printf("[PDQminer] #%d %s:%u (weight %lu%s): %lu KH/s | Shares: %lu (rej %lu)\n",
+                   i + 1, pool->Host, pool->Port, (unsigned long)s_Sessions[i].Weight,
+                   s_Sessions[i].Parked ? ", parked" : "",
+                   (unsigned long)(sessionStats[i].HashRate / 1000),
+                   (unsigned long)sessionStats[i].SharesAccepted,
+                   (unsigned long)sessionStats[i].SharesRejected);
+        }
+        PrintSubmitStats();
+    }
+}
+
+/* Supervisor, callbacks, capture streams and vardiff for one session */
+static PdqError_t SetupSession(PoolSession_t* session, const PdqDeviceConfig_t* poolConfig) {
+    PdqError_t err = PdqPoolSupervisorInit(&session->Supervisor, poolConfig, s_Settings.Difficulty, &s_Tuning);
+    if (err != PdqOk) return err;
+    session->Config = *poolConfig;
+    for (uint8_t j = 0; j < 2; j++) {
+        PdqStratumCtxSetSubmitCallback(PdqPoolSupervisorGetSessionContext(&session->Supervisor, j),
+                                       OnSubmitResult, session);
+    }
+    for (uint8_t j = 0; s_Capture.p_File && j < 2; j++) {
+        PdqStratumContext_t* ctx = PdqPoolSupervisorGetSessionContext(&session->Supervisor, j);
+        const PdqPoolConfig_t* pool = j ? &poolConfig->BackupPool : &poolConfig->PrimaryPool;
+        if (!ctx) continue;
+        char label[PDQ_MAX_HOST_LEN + 16];
+        snprintf(label, sizeof(label), "%s:%u", pool->Host, pool->Port);
+        int stream = PdqCaptureAddStream(&s_Capture, label);
+        PdqStratumCtxSetLineCallback(ctx, OnStratumLine, (void*)(intptr_t)stream);
+    }
+    if (s_VardiffOn) {
+        PdqVardiffConfig_t vardiff;
+        PdqVardiffDefaults(&vardiff, (uint32_t)s_Settings.ShareInterval * 1000);
+        PdqVardiffInit(&session->Vardiff, &vardiff, s_Settings.Difficulty);
+    }
+    return PdqOk;
+}
+
+static bool SameLogin(const PdqDeviceConfig_t* a, const PdqDeviceConfig_t* b) {
+    return strcmp(a->PrimaryPool.Host, b->PrimaryPool.Host) == 0 && a->PrimaryPool.Port == b->PrimaryPool.Port &&
+           strcmp(a->BackupPool.Host, b->BackupPool.Host) == 0 && a->BackupPool.Port == b->BackupPool.Port &&
+           strcmp(a->WalletAddress, b->WalletAddress) == 0 && strcmp(a->WorkerName, b->WorkerName) == 0;
+}
+
+/* A resize retires the jobs the threads were splitting, so give every
+ * session fresh work at once, on the next extranonce2, rather than leave
+ * the new split idle until the pool's next notify. An SV2 standard job
+ * has no extranonce2 to roll and waits for the pool's next one. */
+static void RefreshJobs(void) {
+    PdqMiningJob_t job;
+    if (s_UseSolo) {
+        bool clean = false;
+        if (s_Sessions[0].Parked || PdqGbtBuildNextJob(&job, &clean) != PdqOk) return;
+        if (clean) PdqMiningCtxClearShares(&s_Sessions[0].Miner);
+        MineJob(&s_Sessions[0], &job, PdqGbtGetDifficulty(), clean);
+        return;
+    }
+    for (int i = 0; !s_UseSv2 && i < s_SessionCount; i++) {
+        PoolSession_t* session = &s_Sessions[i];
+        PdqStratumContext_t* ctx = PdqPoolSupervisorGetContext(&session->Supervisor);
+        if (session->Parked || !session->Miner.HasJob || !PdqStratumCtxIsReady(ctx) ||
+            PdqStratumCtxBuildNextJob(ctx, &job) != PdqOk) {
+            continue;
+        }
+        MineJob(session, &job, PdqStratumCtxGetDifficulty(ctx), false);
+    }
+}
+
+/* Reload: new threads join the running pool or surplus ones finish
+ * their batch; the others never stop */
+static bool ReloadThreads(const Settings_t* next) {
+    if (next->Threads == s_Settings.Threads) return false;
+    printf("[PDQminer] Threads: %d -> %d\n", s_Settings.Threads, next->Threads);
+    s_Settings.Threads = next->Threads;
+    if (s_MiningStarted) {
+        PdqMiningPoolResize(&s_Miners, next->Threads);
+        RefreshJobs();
+    }
+    return true;
+}
+
+/* Reload: suggest the new difficulty on the sessions as they are, and
+ * start vardiff over from it */
+static bool ReloadDifficulty(const Settings_t* next) {
+    if (next->Difficulty == s_Settings.Difficulty && next->ShareInterval == s_Settings.ShareInterval) {
+        return false;
+    }
+    if (next->Difficulty != s_Settings.Difficulty) {
+        printf("[PDQminer] Difficulty: %.2f -> %.2f\n", s_Settings.Difficulty, next->Difficulty);
+    }
+    if (next->ShareInterval != s_Settings.ShareInterval) {
+        printf("[PDQminer] Share interval: %d -> %d s\n", s_Settings.ShareInterval, next->ShareInterval);
+    }
+    bool suggest = next->Difficulty != s_Settings.Difficulty;
+    s_Settings.Difficulty = next->Difficulty;
+    s_Settings.ShareInterval = next->ShareInterval;
+    s_VardiffOn = next->ShareInterval > 0;
+    /* An SV2 pool sets the target itself */
+    for (int i = 0; !s_UseSv2 && i < s_SessionCount; i++) {
+        PoolSession_t* session = &s_Sessions[i];
+        if (suggest) PdqPoolSupervisorSuggestDifficulty(&session->Supervisor, next->Difficulty);
+        if (s_VardiffOn) {
+            PdqVardiffConfig_t vardiff;
+            PdqVardiffDefaults(&vardiff, (uint32_t)next->ShareInterval * 1000);
+            PdqVardiffInit(&session->Vardiff, &vardiff, next->Difficulty);
+        }
+    }
+    return true;
+}
+
+/* Reload: re-weight the sessions, and reconnect only those whose pools
+ * or credentials changed. Adding or removing pools needs a new process. */
+static bool ReloadPools(Settings_t* next) {
+    PoolEntry_t entries[PDQ_MINING_MAX_CONTEXTS];
+    int entryCount = next->PoolList[0] ? ParsePoolList(next->PoolList, entries, PDQ_MINING_MAX_CONTEXTS) : 0;
+    bool walletPerPool = entryCount > 0;
+    for (int i = 0; i < entryCount; i++) walletPerPool &= (entries[i].Wallet[0] != '\0');
+
+    bool wasList = s_Settings.PoolList[0] != '\0';
+    const char* problem = NULL;
+    if (entryCount < 0 || (next->PoolList[0] && entryCount == 0)) {
+        problem = "the pool list does not parse";
+    } else if (!next->Wallet[0] && !walletPerPool) {
+        problem = "there is no wallet";
+    } else if ((entryCount > 0) != wasList || (wasList && entryCount != s_SessionCount)) {
+        problem = "the number of pools changed; restart or send SIGUSR2 for that";
+    }
+    if (problem) {
+        printf("[PDQminer] Keeping the current pools: %s\n", problem);
+        return false;
+    }
+
+    PdqDeviceConfig_t base;
+    BaseConfig(next, &base);
+    bool changed = false;
+    if (s_UseSv2) {
+        if (SameLogin(&base, &s_Config)) return false;
+        s_Config = base;
+        snprintf(s_Sv2User, sizeof(s_Sv2User), "%s.%s", base.WalletAddress, base.WorkerName);
+        printf("[PDQminer] Pool changed, reconnecting to %s:%u\n", base.PrimaryPool.Host, base.PrimaryPool.Port);
+        ParkSession(&s_Sessions[0], "pool");
+        PdqSv2CtxDisconnect(&s_Sv2);
+        s_Sv2RetryMs = 0;
+        return true;
+    }
+    s_Config = base;
+
+    for (int i = 0; i < s_SessionCount; i++) {
+        PoolSession_t* session = &s_Sessions[i];
+        PdqDeviceConfig_t poolConfig;
+        uint32_t weight;
+        SessionConfig(&base, entries, entryCount, i, &poolConfig, &weight);
+
+        if (weight != session->Weight) {
+            printf("[PDQminer] %sWeight: %lu -> %lu\n", SessionTag(session), (unsigned long)session->Weight,
+                   (unsigned long)weight);
+            session->Weight = weight;
+            if (s_MiningStarted) PdqMiningPoolSetWeight(&s_Miners, &session->Miner, weight);
+            changed = true;
+        }
+        if (SameLogin(&poolConfig, &session->Config)) continue;
+
+        /* The miners stay on the old job, parked, until the new pool's
+         * first job */
+        PdqDeviceConfig_t old = session->Config;
+        printf("[PDQminer] %sPool changed, reconnecting to %s:%u\n", SessionTag(session),
+               poolConfig.PrimaryPool.Host, poolConfig.PrimaryPool.Port);
+        ParkSession(session, "pool");
+        if (s_UseProxy) PdqProxySetUpstream(NULL);
+        PdqPoolSupervisorStop(&session->Supervisor);
+        if (SetupSession(session, &poolConfig) != PdqOk) SetupSession(session, &old);
+        PdqPoolSupervisorStart(&session->Supervisor, GetMillis());
+        changed = true;
+    }
+    return changed;
+}
+
+/* SIGHUP: read the config file again and apply what changed, keeping the
+ * miner threads running. Settings given on the command line stay. */
+static void OnReloadSignal(int Sig, uint32_t Events, void* p_Arg) {
+    (void)Sig;
+    (void)Events;
+    (void)p_Arg;
+    printf("[PDQminer] Reloading configuration\n");
+    PdqConfigInit();
+    Settings_t next;
+    ResolveSettings(&next);
+
+    bool changed = ReloadThreads(&next);
+    if (!s_UseSolo) {
+        changed |= ReloadDifficulty(&next);
+        if (ReloadPools(&next)) {
+            changed = true;
+            memcpy(s_Settings.PoolHost, next.PoolHost, sizeof(s_Settings.PoolHost));
+            s_Settings.PoolPort = next.PoolPort;
+            memcpy(s_Settings.BackupHost, next.BackupHost, sizeof(s_Settings.BackupHost));
+            s_Settings.BackupPort = next.BackupPort;
+            memcpy(s_Settings.Wallet, next.Wallet, sizeof(s_Settings.Wallet));
+            memcpy(s_Settings.Worker, next.Worker, sizeof(s_Settings.Worker));
+            memcpy(s_Settings.PoolList, next.PoolList, sizeof(s_Settings.PoolList));
+        }
+    }
+    if (!changed) {
+        printf("[PDQminer] Configuration unchanged\n");
+        return;
+    }
+    SyncPoolWatch();
+    OnPoolEvent(-1, 0, NULL);
 }
 
 int main(int argc, char* argv[]) {
-    /* Defaults from env vars, then hardcoded fallbacks */
-    char poolHost[PDQ_MAX_HOST_LEN + 1];
-    uint16_t poolPort;
-    char wallet[PDQ_MAX_WALLET_LEN + 1];
-    char worker[PDQ_MAX_WORKER_LEN + 1];
-    int threads;
-    double difficulty;
+    s_Argv = argv;
+    /* Defaults from env vars, then hardcoded fallbacks. The settings a
+     * reload can change are resolved once the config file is loaded. */
+    int poolTimeout;
+    bool hotStandby;
+    bool racePools;
+    bool useSv2;
+    char sv2Authority[128];
+    uint16_t proxyPort;
+    char soloHost[PDQ_MAX_HOST_LEN + 1] = "";
+    uint16_t soloPort = PDQ_GBT_DEFAULT_PORT;
+    char rpcUser[128];
+    char rpcPassword[128];
+    char rpcCookie[256];
+    char recordFile[256];
+    uint16_t apiPort;
+    char apiBind[64];
+    char apiPassword[PDQ_MAX_PASSWORD_LEN + 1];
+    char shmName[PDQ_SHM_NAME_MAX + 1];
     const char* configFile = NULL;
+    s_StartMs = GetMillis();
 
-    snprintf(poolHost, sizeof(poolHost), "%s", EnvOr("PDQ_POOL_HOST", "pool.nerdminers.org"));
     {
-        const char* portStr = EnvOr("PDQ_POOL_PORT", "3333");
-        long portVal = strtol(portStr, NULL, 10);
-        poolPort = (portVal > 0 && portVal <= 65535) ? (uint16_t)portVal : 3333;
+        long timeoutVal = strtol(EnvOr("PDQ_POOL_TIMEOUT", "0"), NULL, 10);
+        poolTimeout = (timeoutVal > 0 && timeoutVal <= 86400) ? (int)timeoutVal : 0;
     }
-    snprintf(wallet, sizeof(wallet), "%s", EnvOr("PDQ_WALLET", ""));
-    snprintf(worker, sizeof(worker), "%s", EnvOr("PDQ_WORKER", "pdqlinux"));
-    {
-        const char* threadStr = EnvOr("PDQ_THREADS", "2");
-        long threadVal = strtol(threadStr, NULL, 10);
-        threads = (threadVal > 0 && threadVal <= 32) ? (int)threadVal : 2;
+    hotStandby = strcmp(EnvOr("PDQ_HOT_STANDBY", "0"), "0") != 0;
+    racePools = strcmp(EnvOr("PDQ_RACE_POOLS", "0"), "0") != 0;
+    useSv2 = strcmp(EnvOr("PDQ_SV2", "0"), "0") != 0;
+    snprintf(sv2Authority, sizeof(sv2Authority), "%s", EnvOr("PDQ_SV2_AUTHORITY", ""));
+    proxyPort = ParsePortOr(EnvOr("PDQ_PROXY_PORT", "0"), 0);
+    if (getenv("PDQ_SOLO")) {
+        ParseHostPort(getenv("PDQ_SOLO"), soloHost, sizeof(soloHost), &soloPort, PDQ_GBT_DEFAULT_PORT);
     }
-    difficulty = atof(EnvOr("PDQ_DIFFICULTY", "1.0"));
+    snprintf(rpcUser, sizeof(rpcUser), "%s", EnvOr("PDQ_RPC_USER", ""));
+    snprintf(rpcPassword, sizeof(rpcPassword), "%s", EnvOr("PDQ_RPC_PASSWORD", ""));
+    snprintf(rpcCookie, sizeof(rpcCookie), "%s", EnvOr("PDQ_RPC_COOKIE", ""));
+    snprintf(recordFile, sizeof(recordFile), "%s", EnvOr("PDQ_RECORD", ""));
+    apiPort = ParsePortOr(EnvOr("PDQ_API_PORT", "0"), 0);
+    snprintf(apiBind, sizeof(apiBind), "%s", EnvOr("PDQ_API_BIND", ""));
+    snprintf(apiPassword, sizeof(apiPassword), "%s", EnvOr("PDQ_API_PASSWORD", ""));
+    snprintf(shmName, sizeof(shmName), "%s", EnvOr("PDQ_STATS_SHM", ""));
 
     /* Parse CLI args */
     static struct option longOpts[] = {
@@ -96,29 +1284,83 @@ int main(int argc, char* argv[]) {
         {"worker",      required_argument, 0, 'W'},
         {"threads",     required_argument, 0, 't'},
         {"difficulty",  required_argument, 0, 'd'},
+        {"share-interval", required_argument, 0, 'i'},
         {"config",      required_argument, 0, 'c'},
+        {"backup-host", required_argument, 0, 'B'},
+        {"backup-port", required_argument, 0, 'b'},
+        {"pool-timeout", required_argument, 0, 'T'},
+        {"hot-standby", no_argument,       0, 'S'},
+        {"race-pools",  no_argument,       0, 'R'},
+        {"pools",       required_argument, 0, 'L'},
+        {"sv2",         no_argument,       0, '2'},
+        {"sv2-authority", required_argument, 0, 'K'},
+        {"proxy",       required_argument, 0, 'X'},
+        {"solo",        required_argument, 0, 'G'},
+        {"rpc-user",    required_argument, 0, 'u'},
+        {"rpc-password", required_argument, 0, 'p'},
+        {"rpc-cookie",  required_argument, 0, 'k'},
+        {"record",      required_argument, 0, 'r'},
+        {"api-port",    required_argument, 0, 'A'},
+        {"api-bind",    required_argument, 0, 'a'},
+        {"api-password", required_argument, 0, 'Q'},
+        {"stats-shm",   required_argument, 0, 'm'},
         {"help",        no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "H:P:w:W:t:d:c:h", longOpts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "H:P:w:W:t:d:i:c:B:b:T:SRL:2K:X:G:u:p:k:r:A:a:Q:m:h", longOpts, NULL)) != -1) {
         switch (opt) {
-            case 'H': snprintf(poolHost, sizeof(poolHost), "%s", optarg); break;
-            case 'P': {
-                long pv = strtol(optarg, NULL, 10);
-                poolPort = (pv > 0 && pv <= 65535) ? (uint16_t)pv : 3333;
+            case 'H':
+                snprintf(s_Cli.PoolHost, sizeof(s_Cli.PoolHost), "%s", optarg);
+                s_CliSet |= SET_POOL_HOST;
                 break;
-            }
-            case 'w': snprintf(wallet, sizeof(wallet), "%s", optarg); break;
-            case 'W': snprintf(worker, sizeof(worker), "%s", optarg); break;
-            case 't': {
-                long tv = strtol(optarg, NULL, 10);
-                threads = (tv > 0 && tv <= 32) ? (int)tv : 2;
+            case 'P': s_Cli.PoolPort = ParsePort(optarg); s_CliSet |= SET_POOL_PORT; break;
+            case 'w':
+                snprintf(s_Cli.Wallet, sizeof(s_Cli.Wallet), "%s", optarg);
+                s_CliSet |= SET_WALLET;
+                break;
+            case 'W':
+                snprintf(s_Cli.Worker, sizeof(s_Cli.Worker), "%s", optarg);
+                s_CliSet |= SET_WORKER;
+                break;
+            case 't': s_Cli.Threads = ParseThreads(optarg); s_CliSet |= SET_THREADS; break;
+            case 'd': s_Cli.Difficulty = atof(optarg); s_CliSet |= SET_DIFFICULTY; break;
+            case 'i':
+                s_Cli.ShareInterval = ParseShareInterval(optarg);
+                s_CliSet |= SET_SHARE_INTERVAL;
                 break;
-            }
-            case 'd': difficulty = atof(optarg); break;
             case 'c': configFile = optarg; break;
+            case 'B':
+                snprintf(s_Cli.BackupHost, sizeof(s_Cli.BackupHost), "%s", optarg);
+                s_CliSet |= SET_BACKUP_HOST;
+                break;
+            case 'b': s_Cli.BackupPort = ParsePort(optarg); s_CliSet |= SET_BACKUP_PORT; break;
+            case 'S': hotStandby = true; break;
+            case 'R': racePools = true; break;
+            case 'L':
+                snprintf(s_Cli.PoolList, sizeof(s_Cli.PoolList), "%s", optarg);
+                s_CliSet |= SET_POOL_LIST;
+                break;
+            case '2': useSv2 = true; break;
+            case 'K': snprintf(sv2Authority, sizeof(sv2Authority), "%s", optarg); break;
+            case 'X': proxyPort = ParsePortOr(optarg, 0); break;
+            case 'G':
+                ParseHostPort(optarg, soloHost, sizeof(soloHost), &soloPort, PDQ_GBT_DEFAULT_PORT);
+                break;
+            case 'u': snprintf(rpcUser, sizeof(rpcUser), "%s", optarg); break;
+            case 'p': snprintf(rpcPassword, sizeof(rpcPassword), "%s", optarg); break;
+            case 'k': snprintf(rpcCookie, sizeof(rpcCookie), "%s", optarg); break;
+            case 'r': snprintf(recordFile, sizeof(recordFile), "%s", optarg); break;
+            case 'A': apiPort = ParsePortOr(optarg, 0); break;
+            case 'a': snprintf(apiBind, sizeof(apiBind), "%s", optarg); break;
+            case 'Q': snprintf(apiPassword, sizeof(apiPassword), "%s", optarg); break;
+            case 'm': snprintf(shmName, sizeof(shmName), "%s", optarg); break;
+            case 'T': {
+                long sv = strtol(optarg, NULL, 10);
+                poolTimeout = (sv > 0 && sv <= 86400) ? (int)sv : 0;
+                break;
+            }
             case 'h':
                 PrintUsage(argv[0]);
                 return 0;
@@ -132,185 +1374,276 @@ int main(int argc, char* argv[]) {
     if (configFile) {
         setenv("PDQ_CONFIG_PATH", configFile, 1);
     }
+    PdqConfigInit();
+    ResolveSettings(&s_Settings);
+    const char* wallet = s_Settings.Wallet;
+    const char* worker = s_Settings.Worker;
+    double difficulty = s_Settings.Difficulty;
+    int shareInterval = s_Settings.ShareInterval;
+
+    PoolEntry_t entries[PDQ_MINING_MAX_CONTEXTS];
+    int entryCount = 0;
+    if (s_Settings.PoolList[0]) {
+        entryCount = ParsePoolList(s_Settings.PoolList, entries, PDQ_MINING_MAX_CONTEXTS);
+        if (entryCount <= 0) {
+            fprintf(stderr, "Error: cannot parse pool list \"%s\"\n\n", s_Settings.PoolList);
+            return 1;
+        }
+        if (useSv2 || proxyPort || soloHost[0]) {
+            fprintf(stderr, "Error: a pool list is for Stratum V1 mining, drop --sv2, --proxy and --solo\n\n");
+            return 1;
+        }
+    }
 
     /* Validate required params */
-    if (wallet[0] == '\0') {
+    bool walletPerPool = entryCount > 0;
+    for (int i = 0; i < entryCount; i++) walletPerPool &= (entries[i].Wallet[0] != '\0');
+    if (wallet[0] == '\0' && !walletPerPool) {
         fprintf(stderr, "Error: --wallet is required (or set PDQ_WALLET env var)\n\n");
         PrintUsage(argv[0]);
         return 1;
     }
-    if (threads < 1) threads = 1;
-    if (threads > 32) threads = 32;
-    if (poolPort == 0) poolPort = 3333;
+    if (useSv2 && proxyPort) {
+        fprintf(stderr, "Error: --proxy needs a Stratum V1 upstream, drop --sv2\n\n");
+        return 1;
+    }
+    if (soloHost[0] && (useSv2 || proxyPort)) {
+        fprintf(stderr, "Error: --solo takes work from the node, drop --sv2 and --proxy\n\n");
+        return 1;
+    }
+    if (soloHost[0] && !rpcUser[0] && !rpcCookie[0]) {
+        snprintf(rpcCookie, sizeof(rpcCookie), "%s/.bitcoin/.cookie", EnvOr("HOME", "."));
+    }
+    if (recordFile[0] && (useSv2 || soloHost[0])) {
+        fprintf(stderr, "Error: --record captures Stratum V1 sessions, drop --sv2 and --solo\n\n");
+        return 1;
+    }
+
+    /* ---- Event loop ----
+     * Signals are routed through signalfd, so this must run before any
+     * thread is created. */
+    if (PdqEventLoopInit() != PdqOk ||
+        PdqEventNotifierInit(&s_ShareNotifier) != PdqOk) {
+        fprintf(stderr, "[PDQminer] Event loop init failed\n");
+        return 1;
+    }
+    PdqEventAddSignal(SIGINT, OnSignal, NULL);
+    PdqEventAddSignal(SIGTERM, OnSignal, NULL);
+    PdqEventAddSignal(SIGUSR2, OnUpgradeSignal, NULL);
+    PdqEventAddSignal(SIGHUP, OnReloadSignal, NULL);
+    bool upgraded = getenv(PDQ_UPGRADE_ENV) != NULL;
+    int handedOver = PdqUpgradeLoad();
+
+    /* The old image recorded to the same file: carry on after it */
+    if (recordFile[0] && (upgraded ? PdqCaptureResume(&s_Capture, recordFile)
+                                   : PdqCaptureOpen(&s_Capture, recordFile)) != PdqOk) {
+        fprintf(stderr, "Error: cannot write capture %s\n\n", recordFile);
+        return 1;
+    }
 
     /* ---- Startup banner ---- */
-    signal(SIGINT, SignalHandler);
-    signal(SIGTERM, SignalHandler);
 
     printf("===========================================\n");
     printf("  PDQminer v%d.%d.%d (Linux)\n",
            PDQ_VERSION_MAJOR, PDQ_VERSION_MINOR, PDQ_VERSION_PATCH);
     printf("===========================================\n");
-    printf("  Pool:       %s:%u\n", poolHost, poolPort);
+    if (soloHost[0]) {
+        printf("  Solo:       %s:%u (getblocktemplate)\n", soloHost, soloPort);
+    } else if (entryCount > 0) {
+        for (int i = 0; i < entryCount; i++) {
+            printf("  Pool %d:     %s:%u (weight %lu)%s%s\n", i + 1, entries[i].Host, entries[i].Port,
+                   (unsigned long)entries[i].Weight, entries[i].Wallet[0] ? " as " : "", entries[i].Wallet);
+        }
+    } else {
+        printf("  Pool:       %s:%u%s\n", s_Settings.PoolHost, s_Settings.PoolPort,
+               useSv2 ? " (Stratum V2)" : "");
+    }
+    if (s_Settings.BackupHost[0] && !soloHost[0] && entryCount == 0) {
+        printf("  Backup:     %s:%u%s\n", s_Settings.BackupHost, s_Settings.BackupPort,
+               hotStandby ? " (hot standby)" : "");
+    }
     printf("  Wallet:     %s\n", wallet);
     printf("  Worker:     %s\n", worker);
-    printf("  Threads:    %d\n", threads);
-    printf("  Difficulty: %.1f\n", difficulty);
+    if (proxyPort) {
+        printf("  Proxy:      port %u (no local mining)\n", proxyPort);
+    } else {
+        printf("  Threads:    %d\n", s_Settings.Threads);
+    }
+    if (soloHost[0]) {
+        printf("  Difficulty: network\n");
+    } else if (shareInterval > 0) {
+        printf("  Difficulty: %.1f (retuned for a share every %d s)\n", difficulty, shareInterval);
+    } else {
+        printf("  Difficulty: %.1f\n", difficulty);
+    }
+    if (recordFile[0]) {
+        printf("  Recording:  %s\n", recordFile);
+    }
+    if (apiPort) {
+        printf("  API:        %s:%u%s\n", apiBind[0] ? apiBind : "*", apiPort,
+               apiPassword[0] ? "" : " (no password, /api/config locked)");
+    }
+    if (shmName[0]) {
+        printf("  Stats:      /dev/shm/%s\n", shmName);
+    }
+    if (handedOver > 0) {
+        printf("  Upgraded:   %d pool session(s) handed over\n", handedOver);
+    }
     printf("===========================================\n\n");
 
     /* ---- Init subsystems ---- */
     PdqHalInit();
-    printf("[PDQminer] CPU: %lu MHz, Chip ID: %08X\n",
-           (unsigned long)PdqHalGetCpuFreqMhz(), PdqHalGetChipId());
+    s_CpuMhz = PdqHalGetCpuFreqMhz();
+    printf("[PDQminer] CPU: %lu MHz, Chip ID: %08X\n", (unsigned long)s_CpuMhz, PdqHalGetChipId());
 
-    PdqConfigInit();
-
-    /* Populate config struct from CLI args */
     PdqDeviceConfig_t config;
-    memset(&config, 0, sizeof(config));
-    snprintf(config.PrimaryPool.Host, sizeof(config.PrimaryPool.Host), "%s", poolHost);
-    config.PrimaryPool.Port = poolPort;
-    snprintf(config.WalletAddress, sizeof(config.WalletAddress), "%s", wallet);
-    snprintf(config.WorkerName, sizeof(config.WorkerName), "%s", worker);
+    BaseConfig(&s_Settings, &config);
 
     /* WiFi stub — just sets "connected" state */
     PdqWifiInit();
     PdqWifiConnect("", "");
 
-    /* ---- Stratum connection ---- */
-    PdqStratumInit();
-    printf("[PDQminer] Connecting to %s:%u...\n", poolHost, poolPort);
-
-    if (PdqStratumConnect(poolHost, poolPort) != PdqOk) {
-        fprintf(stderr, "[PDQminer] Pool connection failed\n");
-        return 1;
-    }
-    printf("[PDQminer] Connected to pool\n");
-
-    PdqStratumSubscribe();
-
-    /* Wait for subscribe */
-    uint64_t startWait = GetMillis();
-    while (PdqStratumGetState() != StratumStateSubscribed && s_Running) {
-        PdqStratumProcess();
-        if (GetMillis() - startWait > 30000) {
-            fprintf(stderr, "[PDQminer] Subscribe timeout\n");
-            return 1;
-        }
-        usleep(100000);
-    }
-    if (!s_Running) return 0;
-
-    uint8_t extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
-    uint8_t extranonce1Len = 0;
-    PdqStratumGetExtranonce(extranonce1, &extranonce1Len);
-    if (extranonce1Len == 0) {
-        fprintf(stderr, "[PDQminer] ERROR: Invalid extranonce1 (zero length)\n");
-        PdqStratumDisconnect();
-        return 1;
-    }
-
-    PdqStratumSuggestDifficulty(difficulty);
-
-    /* Build worker string: "wallet.worker" */
-    char workerFull[PDQ_MAX_WALLET_LEN + 1 + PDQ_MAX_WORKER_LEN + 1];
-    snprintf(workerFull, sizeof(workerFull), "%s.%s", wallet, worker);
-    PdqStratumAuthorize(workerFull, "x");
-
-    startWait = GetMillis();
-    while (PdqStratumGetState() != StratumStateAuthorized &&
-           PdqStratumGetState() != StratumStateReady && s_Running) {
-        PdqStratumProcess();
-        if (GetMillis() - startWait > 30000) {
-            fprintf(stderr, "[PDQminer] Authorize timeout\n");
-            return 1;
-        }
-        usleep(100000);
-    }
-    if (!s_Running) return 0;
-    printf("[PDQminer] Authorized\n");
-
-    /* ---- Start mining ---- */
-    PdqMiningSetThreadCount(threads);
-    PdqMiningInit();
-    PdqMiningStart();
+    /* ---- Stratum connection ----
+     * Resolution, connect, subscribe and authorize all run as a state
+     * machine inside the event loop, owned by the pool supervisor which
+     * also reconnects, watches for silent pools and fails over. */
+    s_Config = config;
 
     PdqApiInit();
+    if (apiPort && StartApi(apiPort, apiBind[0] ? apiBind : NULL, apiPassword) != PdqOk) return 1;
     PdqApiStart();
+    if (shmName[0] && PdqShmWriterOpen(&s_Shm, shmName) != PdqOk) return 1;
 
-    printf("[PDQminer] Mining started with %d thread(s)\n\n", threads);
-
-    /* ---- Main loop ---- */
-    uint32_t extranonce2 = 0;
-    PdqStratumJob_t stratumJob;
-    PdqMinerStats_t stats;
-    uint64_t lastPrint = 0;
-
-    while (s_Running) {
-        PdqStratumProcess();
-        PdqApiProcess();
+    PdqPoolSupervisorDefaults(&s_Tuning);
+    if (poolTimeout > 0) s_Tuning.SilenceTimeoutMs = (uint32_t)poolTimeout * 1000;
+    s_Tuning.HotStandby = hotStandby;
+    s_Tuning.RacePools = racePools;
+    if (hotStandby && (entryCount > 0 || !config.BackupPool.Host[0])) {
+        fprintf(stderr, "[PDQminer] --hot-standby needs a backup pool, ignoring\n");
+    }
 
-        /* Check for new mining jobs */
-        if (PdqStratumHasNewJob()) {
-            PdqStratumGetJob(&stratumJob);
+    if (soloHost[0]) {
+        /* No pool, failover or vardiff: jobs come from the node's
+         * templates and every share is a block */
+        PdqGbtConfig_t gbt;
+        memset(&gbt, 0, sizeof(gbt));
+        gbt.p_Host = soloHost;
+        gbt.Port = soloPort;
+        gbt.p_User = rpcUser[0] ? rpcUser : NULL;
+        gbt.p_Password = rpcPassword;
+        gbt.p_CookieFile = rpcUser[0] ? NULL : rpcCookie;
+        gbt.p_PayoutAddress = wallet;
+        snprintf(s_SoloHost, sizeof(s_SoloHost), "%s", soloHost);
+        s_SoloPort = soloPort;
+        s_UseSolo = true;
+        PdqGbtSetCallbacks(OnGbtJob, OnSubmitResult, &s_Sessions[0]);
+        if (PdqGbtStart(&gbt) != PdqOk) return 1;
+    } else if (useSv2) {
+        /* No failover or vardiff: the SV2 pool sets the target */
+        s_UseSv2 = true;
+        PdqSv2CtxInit(&s_Sv2);
+        PdqSv2CtxSetSubmitCallback(&s_Sv2, OnSubmitResult, &s_Sessions[0]);
+        snprintf(s_Sv2User, sizeof(s_Sv2User), "%s.%s", wallet, worker);
+        if (sv2Authority[0]) {
+            uint8_t authorityKey[32];
+            if (!PdqSv2ParseAuthorityKey(sv2Authority, authorityKey)) {
+                fprintf(stderr, "[PDQminer] Invalid --sv2-authority key: %s\n", sv2Authority);
+                return 1;
+            }
+            PdqSv2CtxSetAuthorityKey(&s_Sv2, authorityKey);
+        } else {
+            printf("[PDQminer] No --sv2-authority: the SV2 pool is encrypted to but not authenticated\n");
+        }
+        if (config.BackupPool.Host[0]) {
+            fprintf(stderr, "[PDQminer] --sv2 uses the primary pool only, ignoring the backup\n");
+        }
+        DrivePool();
+    } else {
+        if (proxyPort) {
+            PdqProxyConfig_t proxy;
+            memset(&proxy, 0, sizeof(proxy));
+            proxy.Port = proxyPort;
+            proxy.Difficulty = difficulty;
+            proxy.ShareIntervalMs = (uint32_t)shareInterval * 1000;
+            if (PdqProxyStart(&proxy) != PdqOk) return 1;
+            s_UseProxy = true;
+        }
 
-            if (stratumJob.CleanJobs) {
-                PdqMiningClearShares();
+        /* One supervisor per listed pool, each without a backup; without
+         * a list, the one session has the CLI's primary and backup */
+        if (entryCount > 0 && config.BackupPool.Host[0]) {
+            fprintf(stderr, "[PDQminer] A pool list has no backup pools, ignoring the backup\n");
+        }
+        s_SessionCount = entryCount > 0 ? entryCount : 1;
+        s_VardiffOn = shareInterval > 0;
+        for (int i = 0; i < s_SessionCount; i++) {
+            PoolSession_t* session = &s_Sessions[i];
+            PdqDeviceConfig_t poolConfig;
+            SessionConfig(&config, entries, entryCount, i, &poolConfig, &session->Weight);
+            if (SetupSession(session, &poolConfig) != PdqOk) {
+                fprintf(stderr, "[PDQminer] Invalid pool configuration\n");
+                return 1;
             }
 
-            PdqMiningJob_t job;
-            extranonce2++;
-
-            double poolDiff = PdqStratumGetDifficulty();
-
-            PdqStratumBuildMiningJob(&stratumJob,
-                                     extranonce1, extranonce1Len,
-                                     extranonce2, PdqStratumGetExtranonce2Size(),
-                                     poolDiff,
-                                     &job);
-
-            job.NonceStart = 0;
-            job.NonceEnd = 0xFFFFFFFF;
-            PdqMiningSetJob(&job);
-            printf("[PDQminer] New job: %s (diff=%.1f)\n", job.JobId, poolDiff);
-        }
-
-        /* Submit found shares */
-        if (PdqStratumIsReady()) {
-            int sharesThisLoop = 0;
-            while (PdqMiningHasShare() && sharesThisLoop < 5) {
-                PdqShareInfo_t share;
-                if (PdqMiningGetShare(&share) == PdqOk) {
-                    PdqStratumSubmitShare(share.JobId, share.Extranonce2,
-                                          share.Nonce, share.NTime);
-                    printf("[PDQminer] Share submitted: nonce=%08X\n", share.Nonce);
-                }
-                sharesThisLoop++;
+            /* After an upgrade the pool's session may already be open */
+            bool resumed = false;
+            for (uint8_t j = 0; handedOver > 0 && !resumed && j < 2; j++) {
+                PdqStratumContext_t* ctx = PdqPoolSupervisorGetSessionContext(&session->Supervisor, j);
+                const PdqPoolConfig_t* pool = j ? &poolConfig.BackupPool : &poolConfig.PrimaryPool;
+                resumed = ctx && PdqUpgradeRestore(ctx, pool->Host, pool->Port,
+                                                   session->Supervisor.Worker) == PdqOk &&
+                          PdqPoolSupervisorResume(&session->Supervisor, j, GetMillis()) == PdqOk;
             }
+            if (!resumed) PdqPoolSupervisorStart(&session->Supervisor, GetMillis());
         }
+    }
+    PdqUpgradeFinish();
 
-        /* Stats logging */
-        PdqMiningGetStats(&stats);
-        uint64_t now = GetMillis();
-        if (now - lastPrint > 10000) {
-            printf("[PDQminer] Hashrate: %lu KH/s | Shares: %lu | Blocks: %lu | Uptime: %lus\n",
-                   (unsigned long)(stats.HashRate / 1000),
-                   (unsigned long)stats.SharesAccepted,
-                   (unsigned long)stats.BlocksFound,
-                   (unsigned long)stats.Uptime);
-            lastPrint = now;
-        }
+    PdqEventAdd(s_ShareNotifier.ReadFd, PDQ_EVENT_READ, OnShareEvent, NULL);
+    PdqEventAddTimer(PDQ_STATS_TICK_MS, OnStatsTick, NULL);
+    SyncPoolWatch();
+    /* Sessions handed over by an upgrade mine their job straight away */
+    if (handedOver > 0) OnPoolEvent(-1, 0, NULL);
 
-        PdqHalFeedWdt();
-        usleep(10000); /* 10ms */
+    /* ---- Main loop ----
+     * Everything is event driven: pool socket readable, a miner queued a
+     * share (eventfd), or the 1 s stats timer fired. Nothing polls. */
+    int exitCode = 0;
+    while (s_Running) {
+        /* Staggered connect attempts are due on a clock, not on a socket */
+        int wakeupMs = GetWakeupMs();
+        int dispatched = PdqEventRunOnce(wakeupMs);
+        if (dispatched < 0) {
+            fprintf(stderr, "[PDQminer] Event loop failed\n");
+            exitCode = 1;
+            break;
+        }
+        if (dispatched == 0 && wakeupMs >= 0) OnPoolEvent(-1, 0, NULL);
     }
 
     /* ---- Shutdown ---- */
-    printf("[PDQminer] Stopping mining...\n");
-    PdqMiningStop();
-    PdqStratumDisconnect();
+    if (s_MiningStarted) {
+        printf("[PDQminer] Stopping mining...\n");
+        PdqMiningPoolStop(&s_Miners);
+    }
+    if (s_UseProxy) PdqProxyStop();
+    if (s_UseSolo) {
+        PdqGbtStop();
+    } else if (s_UseSv2) {
+        PdqSv2CtxDisconnect(&s_Sv2);
+    } else {
+        for (int i = 0; i < s_SessionCount; i++) PdqPoolSupervisorStop(&s_Sessions[i].Supervisor);
+    }
+    PdqHttpStop();
     PdqApiStop();
+    PdqShmWriterClose(&s_Shm);
+    if (s_Capture.p_File) {
+        printf("[PDQminer] Recorded %lu Stratum lines\n", (unsigned long)s_Capture.Lines);
+        PdqCaptureClose(&s_Capture);
+    }
+    PdqEventNotifierClose(&s_ShareNotifier);
+    PdqEventLoopDestroy();
 
     printf("[PDQminer] Shutdown complete.\n");
-    return 0;
+    return exitCode;
 }
@@ -0,0 +1,151 @@
+/**
+ * @file stat_main.c
+ * @brief pdqstat: read the stats pdqminer publishes in shared memory
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Maps /dev/shm/NAME read-only and prints the totals, threads, pools,
+ * average hashrates over the history ring and, on request, the last
+ * samples. The miner is never asked for anything. Exits 1 if nothing is
+ * published under NAME and 2 if the stats are more than
+ * PDQ_STAT_STALE_MS old, so it doubles as a health check.
+ */
+
+#include "pdq_types.h"
+#include "linux_shm.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PDQ_STAT_STALE_MS   5000
+
+static void PrintUsage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options]\n\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --name NAME     Stats published by pdqminer --stats-shm NAME\n");
+    fprintf(stderr, "                  (default: %s)\n", PDQ_SHM_DEFAULT_NAME);
+    fprintf(stderr, "  --history N     Also print the last N one-second samples (max %u)\n",
+            (unsigned)PDQ_SHM_HISTORY);
+    fprintf(stderr, "  --watch SEC     Print again every SEC seconds until ^C\n");
+    fprintf(stderr, "  --help          Show this help\n");
+}
+
+static uint64_t WallMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* Mean H/s over the last Seconds of history, from the hash counter */
+static double AverageRate(const PdqShmStats_t* p_Stats, uint32_t Seconds) {
+    const PdqShmSample_t* newest = PdqShmHistoryAt(p_Stats, 0);
+    if (!newest || p_Stats->HistoryCount < 2) return 0.0;
+    uint32_t age = Seconds < p_Stats->HistoryCount - 1 ? Seconds : p_Stats->HistoryCount - 1;
+    const PdqShmSample_t* oldest = PdqShmHistoryAt(p_Stats, age);
+    if (newest->TimeMs <= oldest->TimeMs || newest->TotalHashes < oldest->TotalHashes) return 0.0;
+    return (double)(newest->TotalHashes - oldest->TotalHashes) * 1000.0 /
+           (double)(newest->TimeMs - oldest->TimeMs);
+}
+
+static void Print(const char* p_Name, int32_t Pid, const PdqShmStats_t* p_Stats, uint32_t History) {
+    const PdqMinerStats_t* t = &p_Stats->Total;
+    uint64_t now = WallMillis();
+    double ago = now > p_Stats->UpdatedMs ? (double)(now - p_Stats->UpdatedMs) / 1000.0 : 0.0;
+
+    printf("%s: pid %ld, %s, up %lus, updated %.1fs ago\n", p_Name, (long)Pid,
+           p_Stats->Mode[0] ? p_Stats->Mode : "-", (unsigned long)p_Stats->UptimeSec, ago);
+    printf("  Hashrate: %.1f KH/s (1m %.1f, 5m %.1f, 10m %.1f) | Hashes: %llu\n",
+           t->HashRate / 1000.0, AverageRate(p_Stats, 60) / 1000.0, AverageRate(p_Stats, 300) / 1000.0,
+           AverageRate(p_Stats, 600) / 1000.0, (unsigned long long)t->TotalHashes);
+    printf("  Shares: %lu (rej %lu, no reply %lu, stale %lu) | Blocks: %lu\n",
+           (unsigned long)t->SharesAccepted, (unsigned long)t->SharesRejected,
+           (unsigned long)t->SharesTimedOut, (unsigned long)t->SharesStale, (unsigned long)t->BlocksFound);
+
+    for (uint32_t i = 0; i < p_Stats->ThreadCount && i < PDQ_SHM_MAX_THREADS; i++) {
+        printf("  Thread %2lu: %.1f KH/s, %llu hashes\n", (unsigned long)i,
+               p_Stats->ThreadHashRate[i] / 1000.0, (unsigned long long)p_Stats->ThreadHashes[i]);
+    }
+    for (uint32_t i = 0; i < p_Stats->PoolCount && i < PDQ_SHM_MAX_POOLS; i++) {
+        const PdqShmPool_t* pool = &p_Stats->Pools[i];
+        printf("  Pool #%lu %s:%u %s%s%s weight %lu diff %g: %.1f KH/s | Shares: %lu (rej %lu)\n",
+               (unsigned long)i + 1, pool->Host, (unsigned)pool->Port, pool->Ready ? "up" : "down",
+               pool->Backup ? ", backup" : "", pool->Parked ? ", parked" : "", (unsigned long)pool->Weight,
+               pool->Difficulty, pool->Stats.HashRate / 1000.0, (unsigned long)pool->Stats.SharesAccepted,
+               (unsigned long)pool->Stats.SharesRejected);
+    }
+
+    for (uint32_t age = 0; age < History; age++) {
+        const PdqShmSample_t* s = PdqShmHistoryAt(p_Stats, age);
+        if (!s) break;
+        if (age == 0) printf("  %8s %12s %10s %10s %10s\n", "age", "KH/s", "accepted", "rejected", "stale");
+        printf("  %7lus %12.1f %10lu %10lu %10lu\n", (unsigned long)((p_Stats->UpdatedMs - s->TimeMs) / 1000),
+               s->HashRate / 1000.0, (unsigned long)s->SharesAccepted, (unsigned long)s->SharesRejected,
+               (unsigned long)s->SharesStale);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* name = PDQ_SHM_DEFAULT_NAME;
+    uint32_t history = 0;
+    uint32_t watchSec = 0;
+
+    static struct option longOpts[] = {
+        {"name",    required_argument, 0, 'n'},
+        {"history", required_argument, 0, 'H'},
+        {"watch",   required_argument, 0, 'w'},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:H:w:h", longOpts, NULL)) != -1) {
+        switch (opt) {
+            case 'n': name = optarg; break;
+            case 'H': history = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'w': watchSec = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'h':
+                PrintUsage(argv[0]);
+                return 0;
+            default:
+                PrintUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    PdqShmReader_t reader = {NULL};
+    static PdqShmStats_t stats;
+    int exitCode = 0;
+    for (;;) {
+        /* A restarted miner publishes in a new file; reopen to find it */
+        if (!reader.p_Region) {
+            PdqError_t err = PdqShmReaderOpen(&reader, name);
+            if (err != PdqOk) {
+                fprintf(stderr, "pdqstat: %s: %s\n", name,
+                        err == PdqErrorParse ? "not stats from this version of pdqminer"
+                                             : "not published (start pdqminer with --stats-shm)");
+                exitCode = 1;
+            }
+        }
+        if (reader.p_Region) {
+            if (PdqShmRead(&reader, &stats) != PdqOk) {
+                fprintf(stderr, "pdqstat: %s: writer stopped mid-update\n", name);
+                exitCode = 2;
+            } else {
+                Print(name, PdqShmReaderGetPid(&reader), &stats, history);
+                exitCode = WallMillis() > stats.UpdatedMs + PDQ_STAT_STALE_MS ? 2 : 0;
+                if (exitCode) fprintf(stderr, "pdqstat: %s: stale, is pdqminer running?\n", name);
+            }
+            if (exitCode) PdqShmReaderClose(&reader);
+        }
+        if (!watchSec) break;
+        fflush(stdout);
+        sleep(watchSec);
+        printf("\n");
+    }
+    PdqShmReaderClose(&reader);
+    return exitCode;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file bench_stratum_json.c
+ * @brief mining.notify parsing microbenchmark
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Runs the receive path for a notify (tokenize the line, then decode the
+ * job fields) over a corpus file and reports throughput and per-notify
+ * latency. Usage: bench_stratum_json <corpus> [passes]
+ */
+
+#include "stratum/stratum_client.h"
+#include "stratum/stratum_json.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAX_LINES     256
+#define BENCH_MAX_LINE_LEN  PDQ_STRATUM_RECV_BUFFER_MAX
+
+static char*  s_Lines[BENCH_MAX_LINES];
+static size_t s_Lens[BENCH_MAX_LINES];
+static int    s_LineCount = 0;
+
+static uint64_t GetNanos(void)
+{
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000000000ULL + (uint64_t)Ts.tv_nsec;
+}
+
+static int CompareU32(const void* p_A, const void* p_B)
+{
+    uint32_t A = *(const uint32_t*)p_A;
+    uint32_t B = *(const uint32_t*)p_B;
+    return (A > B) - (A < B);
+}
+
+static bool LoadCorpus(const char* p_Path)
+{
+    FILE* p_File = fopen(p_Path, "r");
+    if (p_File == NULL) {
+        perror(p_Path);
+        return false;
+    }
+
+    static char Line[BENCH_MAX_LINE_LEN];
+    while (s_LineCount < BENCH_MAX_LINES && fgets(Line, sizeof(Line), p_File)) {
+        size_t Len = strcspn(Line, "\r\n");
+        if (Len == 0 || Line[0] == '#') continue;
+        Line[Len] = '\0';
+        s_Lines[s_LineCount] = strdup(Line);
+        s_Lens[s_LineCount] = Len;
+        s_LineCount++;
+    }
+    fclose(p_File);
+    return s_LineCount > 0;
+}
+
+/* Same work ProcessLine does for a notify, minus the logging */
+static PdqStratumArena_t s_Arena;
+
+static bool DecodeLine(int Index, PdqJsonToken_t* p_Tokens, PdqStratumJob_t* p_Job)
+{
+    PdqJsonDoc_t Doc;
+    if (PdqJsonParse(&Doc, s_Lines[Index], s_Lens[Index], p_Tokens, PDQ_STRATUM_MAX_TOKENS) != PdqOk) {
+        return false;
+    }
+    if (!PdqJsonEquals(&Doc, PdqJsonObjectGet(&Doc, 0, "method"), "mining.notify")) return false;
+    return PdqStratumDecodeNotify(&Doc, PdqJsonObjectGet(&Doc, 0, "params"), &s_Arena, p_Job) == PdqOk;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <corpus> [passes]\n", argv[0]);
+        return 2;
+    }
+    if (!LoadCorpus(argv[1])) return 2;
+    uint32_t Passes = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 100000;
+    if (Passes == 0) Passes = 1;
+
+    static PdqJsonToken_t Tokens[PDQ_STRATUM_MAX_TOKENS];
+    static PdqStratumJob_t Job;
+    size_t Bytes = 0;
+    for (int i = 0; i < s_LineCount; i++) {
+        if (!DecodeLine(i, Tokens, &Job)) {
+            fprintf(stderr, "Corpus line %d is not a valid notify\n", i + 1);
+            return 1;
+        }
+        Bytes += s_Lens[i];
+    }
+
+    /* Bulk run for throughput */
+    uint64_t Messages = (uint64_t)Passes * (uint64_t)s_LineCount;
+    uint64_t Start = GetNanos();
+    for (uint32_t p = 0; p < Passes; p++) {
+        for (int i = 0; i < s_LineCount; i++) DecodeLine(i, Tokens, &Job);
+    }
+    uint64_t Elapsed = GetNanos() - Start;
+
+    /* Timed individually for the latency distribution */
+    uint32_t Samples = (Messages < 100000) ? (uint32_t)Messages : 100000;
+    uint32_t* p_Latency = (uint32_t*)malloc(Samples * sizeof(uint32_t));
+    if (p_Latency == NULL) return 1;
+    for (uint32_t n = 0; n < Samples; n++) {
+        uint64_t T0 = GetNanos();
+        DecodeLine((int)(n % (uint32_t)s_LineCount), Tokens, &Job);
+        p_Latency[n] = (uint32_t)(GetNanos() - T0);
+    }
+    qsort(p_Latency, Samples, sizeof(uint32_t), CompareU32);
+
+    double Seconds = (double)Elapsed / 1e9;
+    printf("Corpus: %d notify messages, %zu bytes average\n", s_LineCount, Bytes / (size_t)s_LineCount);
+    printf("Parsed: %llu messages in %.3f s\n", (unsigned long long)Messages, Seconds);
+    printf("Throughput: %.0f msg/s (%.1f MB/s)\n", (double)Messages / Seconds,
+           (double)Bytes * Passes / Seconds / 1e6);
+    printf("Latency per notify: mean %.0f ns, p50 %u ns, p99 %u ns, max %u ns\n",
+           (double)Elapsed / (double)Messages, p_Latency[Samples / 2],
+           p_Latency[(uint32_t)(Samples * 0.99)], p_Latency[Samples - 1]);
+
+    free(p_Latency);
+    PdqStratumArenaFree(&s_Arena);
+    return 0;
+}
@@ -0,0 +1,341 @@
+/**
+ * @file fake_bitcoind.c
+ * @brief In-process bitcoind JSON-RPC mock for host-side tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "fake_bitcoind.h"
+#include "core/sha256_engine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#ifdef MSG_NOSIGNAL
+#define FAKE_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define FAKE_SEND_FLAGS 0
+#endif
+
+#define FAKE_REQUEST_MAX    65536
+
+static const char s_Hex[] = "0123456789abcdef";
+
+static void ToHex(const uint8_t* p_Data, size_t Len, char* p_Out) {
+    for (size_t i = 0; i < Len; i++) {
+        p_Out[2 * i] = s_Hex[p_Data[i] >> 4];
+        p_Out[2 * i + 1] = s_Hex[p_Data[i] & 0x0f];
+    }
+    p_Out[2 * Len] = '\0';
+}
+
+/* Hash in display order, the way the RPC prints txids and block hashes */
+static void HashToDisplay(const uint8_t* p_Hash, char* p_Out) {
+    uint8_t reversed[32];
+    for (int i = 0; i < 32; i++) reversed[i] = p_Hash[31 - i];
+    ToHex(reversed, 32, p_Out);
+}
+
+static void Base64(const char* p_In, char* p_Out) {
+    static const char s_Table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const uint8_t* p = (const uint8_t*)p_In;
+    size_t len = strlen(p_In);
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)p[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)p[i + 1] << 8;
+        if (i + 2 < len) v |= p[i + 2];
+        *p_Out++ = s_Table[(v >> 18) & 63];
+        *p_Out++ = s_Table[(v >> 12) & 63];
+        *p_Out++ = i + 1 < len ? s_Table[(v >> 6) & 63] : '=';
+        *p_Out++ = i + 2 < len ? s_Table[v & 63] : '=';
+    }
+    *p_Out = '\0';
+}
+
+/* A new tip, and a fresh set of legacy one-in one-out transactions
+ * spending made-up outpoints of it */
+static void MoveTip(PdqFakeBitcoind_t* p_Node) {
+    uint8_t hash[32];
+    uint8_t seed[8] = {'t', 'i', 'p', 0};
+    seed[4] = (uint8_t)p_Node->Height;
+    seed[5] = (uint8_t)(p_Node->Height >> 8);
+    PdqSha256d(seed, sizeof(seed), hash);
+    hash[31] = 0;   /* Looks like a block hash */
+    HashToDisplay(hash, p_Node->PrevHash);
+
+    for (int t = 0; t < PDQ_FAKE_BITCOIND_TXS; t++) {
+        uint8_t tx[PDQ_FAKE_BITCOIND_TX_BYTES];
+        size_t n = 0;
+        tx[n++] = 0x02; tx[n++] = 0; tx[n++] = 0; tx[n++] = 0;
+        tx[n++] = 1;
+        for (int i = 0; i < 32; i++) tx[n++] = (uint8_t)(hash[i] ^ (t + 1));
+        tx[n++] = (uint8_t)t; tx[n++] = 0; tx[n++] = 0; tx[n++] = 0;
+        tx[n++] = 0;
+        tx[n++] = 0xff; tx[n++] = 0xff; tx[n++] = 0xff; tx[n++] = 0xff;
+        tx[n++] = 1;
+        uint64_t value = 100000000ull * (uint64_t)(t + 1);
+        for (int i = 0; i < 8; i++) tx[n++] = (uint8_t)(value >> (8 * i));
+        tx[n++] = 22;
+        tx[n++] = 0x00;
+        tx[n++] = 0x14;
+        for (int i = 0; i < 20; i++) tx[n++] = (uint8_t)(0xa0 + t + i);
+        tx[n++] = 0; tx[n++] = 0; tx[n++] = 0; tx[n++] = 0;
+
+        uint8_t txid[32];
+        PdqSha256d(tx, n, txid);
+        ToHex(tx, n, p_Node->TxHex[t]);
+        HashToDisplay(txid, p_Node->TxId[t]);
+    }
+}
+
+static void CloseClient(PdqFakeBitcoind_t* p_Node, int i) {
+    close(p_Node->Clients[i]);
+    p_Node->Clients[i] = -1;
+    p_Node->RequestLen[i] = 0;
+    if (p_Node->Held[i]) atomic_fetch_sub(&p_Node->Waiting, 1);
+    p_Node->Held[i] = false;
+}
+
+/* One reply per connection, as with Connection: close */
+static void Reply(PdqFakeBitcoind_t* p_Node, int i, const char* p_Status, const char* p_Body) {
+    char head[160];
+    size_t len = strlen(p_Body);
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %lu\r\n"
+                     "Connection: close\r\n\r\n", p_Status, (unsigned long)len);
+    if (send(p_Node->Clients[i], head, (size_t)n, FAKE_SEND_FLAGS) == n && len) {
+        send(p_Node->Clients[i], p_Body, len, FAKE_SEND_FLAGS);
+    }
+    CloseClient(p_Node, i);
+}
+
+static void SendTemplate(PdqFakeBitcoind_t* p_Node, int i) {
+    char body[4096];
+    size_t n = (size_t)snprintf(body, sizeof(body),
+        "{\"result\":{\"capabilities\":[\"proposal\"],\"version\":536870912,"
+        "\"rules\":[\"csv\",\"!segwit\",\"taproot\"],\"vbavailable\":{},\"vbrequired\":0,"
+        "\"previousblockhash\":\"%s\",\"transactions\":[", p_Node->PrevHash);
+    for (int t = 0; t < PDQ_FAKE_BITCOIND_TXS; t++) {
+        n += (size_t)snprintf(body + n, sizeof(body) - n,
+            "%s{\"data\":\"%s\",\"txid\":\"%s\",\"hash\":\"%s\",\"depends\":[],"
+            "\"fee\":1000,\"sigops\":4,\"weight\":%d}",
+            t ? "," : "", p_Node->TxHex[t], p_Node->TxId[t], p_Node->TxId[t],
+            4 * PDQ_FAKE_BITCOIND_TX_BYTES);
+    }
+    snprintf(body + n, sizeof(body) - n,
+        "],\"coinbaseaux\":{},\"coinbasevalue\":%llu,\"longpollid\":\"%s%u\","
+        "\"target\":\"7fffff0000000000000000000000000000000000000000000000000000000000\","
+        "\"mintime\":1700000000,\"mutable\":[\"time\",\"transactions\",\"prevblock\"],"
+        "\"noncerange\":\"00000000ffffffff\",\"sigoplimit\":80000,\"sizelimit\":4000000,"
+        "\"weightlimit\":4000000,\"curtime\":%lu,\"bits\":\"%08x\",\"height\":%u,"
+        "\"default_witness_commitment\":\"%s\"},\"error\":null,\"id\":\"pdq\"}",
+        PDQ_FAKE_BITCOIND_VALUE, p_Node->PrevHash, p_Node->Height,
+        (unsigned long)time(NULL), PDQ_FAKE_BITCOIND_BITS, p_Node->Height,
+        PDQ_FAKE_BITCOIND_COMMITMENT);
+    Reply(p_Node, i, "200 OK", body);
+    atomic_fetch_add(&p_Node->Templates, 1);
+}
+
+static void HandleRequest(PdqFakeBitcoind_t* p_Node, int i, char* p_Request, const char* p_Body) {
+    if (p_Node->p_Auth) {
+        char expected[256] = "Basic ";
+        Base64(p_Node->p_Auth, expected + 6);
+        const char* auth = strcasestr(p_Request, "\r\nAuthorization:");
+        if (auth) {
+            auth += 16;
+            while (*auth == ' ') auth++;
+        }
+        if (!auth || strncmp(auth, expected, strlen(expected)) != 0) {
+            atomic_fetch_add(&p_Node->Unauthorized, 1);
+            Reply(p_Node, i, "401 Unauthorized", "");
+            return;
+        }
+    }
+
+    if (strstr(p_Body, "\"getblocktemplate\"")) {
+        /* A longpoll naming the current tip waits for the next one */
+        char current[96];
+        snprintf(current, sizeof(current), "\"longpollid\":\"%s%u\"", p_Node->PrevHash, p_Node->Height);
+        if (strstr(p_Body, current)) {
+            p_Node->Held[i] = true;
+            atomic_fetch_add(&p_Node->Waiting, 1);
+            return;
+        }
+        SendTemplate(p_Node, i);
+    } else if (strstr(p_Body, "\"submitblock\"")) {
+        const char* hex = strstr(p_Body, "\"params\":[\"");
+        const char* end = hex ? strchr(hex + 11, '"') : NULL;
+        if (!end) {
+            Reply(p_Node, i, "500 Internal Server Error",
+                  "{\"result\":null,\"error\":{\"code\":-22,\"message\":\"Block decode failed\"},\"id\":\"pdq\"}");
+            return;
+        }
+        size_t len = (size_t)(end - hex - 11);
+        char* copy = (char*)malloc(len + 1);
+        if (copy) {
+            memcpy(copy, hex + 11, len);
+            copy[len] = '\0';
+        }
+        free(p_Node->p_LastBlock);
+        p_Node->p_LastBlock = copy;
+        atomic_fetch_add(&p_Node->Submits, 1);
+        if (atomic_load(&p_Node->RejectBlocks)) {
+            Reply(p_Node, i, "200 OK", "{\"result\":\"high-hash\",\"error\":null,\"id\":\"pdq\"}");
+        } else {
+            Reply(p_Node, i, "200 OK", "{\"result\":null,\"error\":null,\"id\":\"pdq\"}");
+            atomic_store(&p_Node->NewBlock, 1);
+        }
+    } else {
+        Reply(p_Node, i, "404 Not Found",
+              "{\"result\":null,\"error\":{\"code\":-32601,\"message\":\"Method not found\"},\"id\":\"pdq\"}");
+    }
+}
+
+static void ReadClient(PdqFakeBitcoind_t* p_Node, int i) {
+    char* request = p_Node->p_Requests[i];
+    size_t space = FAKE_REQUEST_MAX - 1 - p_Node->RequestLen[i];
+    ssize_t n = recv(p_Node->Clients[i], request + p_Node->RequestLen[i], space, 0);
+    if (n <= 0) {
+        CloseClient(p_Node, i);
+        return;
+    }
+    if (p_Node->Held[i]) return;
+    p_Node->RequestLen[i] += (size_t)n;
+    request[p_Node->RequestLen[i]] = '\0';
+
+    char* body = strstr(request, "\r\n\r\n");
+    if (!body) {
+        if (p_Node->RequestLen[i] >= FAKE_REQUEST_MAX - 1) CloseClient(p_Node, i);
+        return;
+    }
+    body += 4;
+    const char* length = strcasestr(request, "\r\nContent-Length:");
+    size_t want = length ? (size_t)strtoul(length + 17, NULL, 10) : 0;
+    if ((size_t)(request + p_Node->RequestLen[i] - body) < want) {
+        if (p_Node->RequestLen[i] >= FAKE_REQUEST_MAX - 1) CloseClient(p_Node, i);
+        return;
+    }
+    HandleRequest(p_Node, i, request, body);
+}
+
+static void* NodeThread(void* arg) {
+    PdqFakeBitcoind_t* p_Node = (PdqFakeBitcoind_t*)arg;
+
+    while (atomic_load(&p_Node->Running)) {
+        struct pollfd fds[PDQ_FAKE_BITCOIND_MAX_CLIENTS + 1];
+        int map[PDQ_FAKE_BITCOIND_MAX_CLIENTS + 1];
+        int n = 0;
+
+        fds[n].fd = p_Node->ListenFd;
+        fds[n].events = POLLIN;
+        map[n++] = -1;
+        for (int i = 0; i < PDQ_FAKE_BITCOIND_MAX_CLIENTS; i++) {
+            if (p_Node->Clients[i] < 0) continue;
+            fds[n].fd = p_Node->Clients[i];
+            fds[n].events = POLLIN;
+            map[n++] = i;
+        }
+
+        poll(fds, (nfds_t)n, 20);
+
+        if (atomic_exchange(&p_Node->NewBlock, 0)) {
+            p_Node->Height++;
+            MoveTip(p_Node);
+            for (int i = 0; i < PDQ_FAKE_BITCOIND_MAX_CLIENTS; i++) {
+                if (p_Node->Clients[i] >= 0 && p_Node->Held[i]) {
+                    atomic_fetch_add(&p_Node->LongPolls, 1);
+                    SendTemplate(p_Node, i);
+                }
+            }
+        }
+
+        for (int k = 1; k < n; k++) {
+            if (fds[k].revents && p_Node->Clients[map[k]] >= 0) ReadClient(p_Node, map[k]);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(p_Node->ListenFd, NULL, NULL);
+            if (fd >= 0) {
+                int slot = -1;
+                for (int i = 0; i < PDQ_FAKE_BITCOIND_MAX_CLIENTS; i++) {
+                    if (p_Node->Clients[i] < 0) { slot = i; break; }
+                }
+                if (slot < 0) {
+                    close(fd);
+                } else {
+                    p_Node->Clients[slot] = fd;
+                    p_Node->RequestLen[slot] = 0;
+                    atomic_fetch_add(&p_Node->Connections, 1);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+PdqError_t PdqFakeBitcoindStart(PdqFakeBitcoind_t* p_Node, uint16_t Port) {
+    if (!p_Node) return PdqErrorInvalidParam;
+
+    const char* auth = p_Node->p_Auth;
+    memset(p_Node, 0, sizeof(*p_Node));
+    p_Node->p_Auth = auth;
+    for (int i = 0; i < PDQ_FAKE_BITCOIND_MAX_CLIENTS; i++) {
+        p_Node->Clients[i] = -1;
+        p_Node->p_Requests[i] = (char*)malloc(FAKE_REQUEST_MAX);
+        if (!p_Node->p_Requests[i]) return PdqErrorNoMemory;
+    }
+    p_Node->Height = PDQ_FAKE_BITCOIND_HEIGHT;
+    MoveTip(p_Node);
+
+    p_Node->ListenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (p_Node->ListenFd < 0) return PdqErrorNotConnected;
+
+    int one = 1;
+    setsockopt(p_Node->ListenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(Port);
+    socklen_t len = sizeof(addr);
+    if (bind(p_Node->ListenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(p_Node->ListenFd, 16) != 0 ||
+        getsockname(p_Node->ListenFd, (struct sockaddr*)&addr, &len) != 0) {
+        close(p_Node->ListenFd);
+        p_Node->ListenFd = -1;
+        return PdqErrorNotConnected;
+    }
+    p_Node->Port = ntohs(addr.sin_port);
+
+    atomic_store(&p_Node->Running, 1);
+    if (pthread_create(&p_Node->Thread, NULL, NodeThread, p_Node) != 0) {
+        close(p_Node->ListenFd);
+        p_Node->ListenFd = -1;
+        atomic_store(&p_Node->Running, 0);
+        return PdqErrorNoMemory;
+    }
+    return PdqOk;
+}
+
+void PdqFakeBitcoindStop(PdqFakeBitcoind_t* p_Node) {
+    if (!p_Node || !atomic_load(&p_Node->Running)) return;
+    atomic_store(&p_Node->Running, 0);
+    pthread_join(p_Node->Thread, NULL);
+    for (int i = 0; i < PDQ_FAKE_BITCOIND_MAX_CLIENTS; i++) {
+        if (p_Node->Clients[i] >= 0) CloseClient(p_Node, i);
+        free(p_Node->p_Requests[i]);
+        p_Node->p_Requests[i] = NULL;
+    }
+    free(p_Node->p_LastBlock);
+    p_Node->p_LastBlock = NULL;
+    close(p_Node->ListenFd);
+    p_Node->ListenFd = -1;
+}
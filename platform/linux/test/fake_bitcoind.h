@@ -0,0 +1,72 @@
+/**
+ * @file fake_bitcoind.h
+ * @brief In-process bitcoind JSON-RPC mock for host-side tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Listens on 127.0.0.1 in a background thread and answers HTTP JSON-RPC
+ * the way a regtest node does for getblocktemplate and submitblock.
+ * Templates carry a handful of legacy transactions, a witness commitment
+ * and a longpollid; a longpoll is held until the tip moves, which an
+ * accepted block or the NewBlock knob does.
+ */
+
+#ifndef PDQ_FAKE_BITCOIND_H
+#define PDQ_FAKE_BITCOIND_H
+
+#include "pdq_types.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_FAKE_BITCOIND_MAX_CLIENTS   8
+#define PDQ_FAKE_BITCOIND_TXS           4       /* Transactions per template */
+#define PDQ_FAKE_BITCOIND_TX_BYTES      82      /* Each one, serialized */
+#define PDQ_FAKE_BITCOIND_HEIGHT        101     /* Of the first template */
+#define PDQ_FAKE_BITCOIND_BITS          0x207fffff
+#define PDQ_FAKE_BITCOIND_VALUE         5000004000ull
+#define PDQ_FAKE_BITCOIND_COMMITMENT \
+    "6a24aa21a9ede2f61c3f71d1defd3fa999dfa36953755c690689799962b48bebd836974e8cf9"
+
+typedef struct {
+    int             ListenFd;
+    uint16_t        Port;
+    pthread_t       Thread;
+    atomic_int      Running;
+    atomic_int      NewBlock;       /* Move the tip on next pass, answering longpolls */
+    atomic_int      RejectBlocks;   /* submitblock answers "high-hash" */
+    const char*     p_Auth;         /* "user:password" to demand, NULL for none */
+
+    int             Clients[PDQ_FAKE_BITCOIND_MAX_CLIENTS];
+    char*           p_Requests[PDQ_FAKE_BITCOIND_MAX_CLIENTS];
+    size_t          RequestLen[PDQ_FAKE_BITCOIND_MAX_CLIENTS];
+    bool            Held[PDQ_FAKE_BITCOIND_MAX_CLIENTS];   /* Longpoll waiting for a tip */
+
+    /* Chain state (pool thread only, readable once a template was served) */
+    uint32_t        Height;
+    char            PrevHash[65];   /* Display order, as in the RPC */
+    char            TxHex[PDQ_FAKE_BITCOIND_TXS][2 * PDQ_FAKE_BITCOIND_TX_BYTES + 1];
+    char            TxId[PDQ_FAKE_BITCOIND_TXS][65];
+
+    char*           p_LastBlock;    /* submitblock hex, written before the reply */
+
+    atomic_uint     Connections;
+    atomic_uint     Templates;
+    atomic_uint     LongPolls;      /* Templates that answered a held longpoll */
+    atomic_uint     Waiting;        /* Longpolls held right now */
+    atomic_uint     Submits;
+    atomic_uint     Unauthorized;
+} PdqFakeBitcoind_t;
+
+/* Port 0 picks an ephemeral port, reported in p_Node->Port */
+PdqError_t PdqFakeBitcoindStart(PdqFakeBitcoind_t* p_Node, uint16_t Port);
+void       PdqFakeBitcoindStop(PdqFakeBitcoind_t* p_Node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,449 @@
+/**
+ * @file fake_pool.c
+ * @brief In-process Stratum V1 pool for host-side tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "fake_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#ifdef MSG_NOSIGNAL
+#define FAKE_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define FAKE_SEND_FLAGS 0
+#endif
+
+/* Block 1eaa720 from a public pool, same as tools/verify_job.py */
+static const char* s_JobId = "1eaa720";
+static const char* s_PrevHash = "770fd8b322f461fc7eb91584447854b4212f96070001d3360000000000000000";
+static const char* s_Coinbase1 =
+    "02000000010000000000000000000000000000000000000000000000000000000000000000"
+    "ffffffff170385520e5075626c69632d506f6f6c";
+/* Coinbase1 padding goes between coinbase1 and the tail */
+static const char* s_NotifyTail =
+    "\","
+    "\"ffffffff029d37ad12000000001976a914b8aa2d1ea325377d3b184f15a95aa6173ade02c788ac"
+    "0000000000000000266a24aa21a9ed6d1579af07100699d569f5cb3c421dc0330015a1e4ddf504"
+    "2b25f0749ca021e100000000\","
+    "[\"55fa8652d8cfa2602cd6064fb64a207a76f882873ef941bab0ef1677b716aea7\"],"
+    "\"20000000\",\"1701f303\",\"69a20ee6\"";
+
+static uint64_t GetMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void SendLine(int fd, const char* line) {
+    size_t len = strlen(line);
+    if (send(fd, line, len, FAKE_SEND_FLAGS) != (ssize_t)len) return;
+    send(fd, "\n", 1, FAKE_SEND_FLAGS);
+}
+
+static void CloseClient(PdqFakePool_t* p_Pool, int i) {
+    close(p_Pool->Clients[i]);
+    p_Pool->Clients[i] = -1;
+    p_Pool->LineLen[i] = 0;
+    p_Pool->Authorized[i] = false;
+    p_Pool->SentMilli[i] = 0;
+}
+
+static void SendDifficulty(PdqFakePool_t* p_Pool, int i) {
+    uint32_t milli = atomic_load(&p_Pool->DifficultyMilli);
+    if (milli == 0) milli = 1000;
+    if (p_Pool->SentMilli[i] == milli) return;
+    char buf[128];
+    snprintf(buf, sizeof(buf), "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[%g]}",
+             milli / 1000.0);
+    SendLine(p_Pool->Clients[i], buf);
+    p_Pool->SentMilli[i] = milli;
+}
+
+/* Sends the current job, after a set_difficulty if the difficulty changed */
+static void SendNotify(PdqFakePool_t* p_Pool, int i) {
+    SendDifficulty(p_Pool, i);
+    size_t pad = 2 * (size_t)atomic_load(&p_Pool->PadCoinbase);
+    size_t size = 1024 + pad;
+    char* buf = (char*)malloc(size);
+    if (!buf) return;
+    int n = snprintf(buf, size, "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"%s\",\"%s\",\"%s",
+                     p_Pool->JobId, p_Pool->PrevHash, s_Coinbase1);
+    memset(buf + n, '0', pad);
+    snprintf(buf + n + pad, size - (size_t)n - pad, "%s,%s]}", s_NotifyTail,
+             p_Pool->JobClean ? "true" : "false");
+    SendLine(p_Pool->Clients[i], buf);
+    free(buf);
+    atomic_fetch_add(&p_Pool->Notifies, 1);
+}
+
+/* Moves to the next job when jobs are numbered; a clean one also gets a
+ * new prevhash, so the client must retire everything it had */
+static void NextJob(PdqFakePool_t* p_Pool, bool clean) {
+    unsigned every = atomic_load(&p_Pool->CleanEvery);
+    if (every == 0) return;
+    p_Pool->JobSeq++;
+    snprintf(p_Pool->JobId, sizeof(p_Pool->JobId), "%x", p_Pool->JobSeq);
+    p_Pool->JobClean = clean || p_Pool->JobSeq % every == 0;
+    if (p_Pool->JobClean) {
+        char seq[9];
+        snprintf(seq, sizeof(seq), "%08x", ++p_Pool->CleanSeq);
+        memcpy(p_Pool->PrevHash, seq, 8);
+        atomic_fetch_add(&p_Pool->CleanJobs, 1);
+    }
+}
+
+static void BroadcastJob(PdqFakePool_t* p_Pool, bool clean) {
+    NextJob(p_Pool, clean);
+    for (int i = 0; i < PDQ_FAKE_POOL_MAX_CLIENTS; i++) {
+        if (p_Pool->Clients[i] >= 0 && p_Pool->Authorized[i]) SendNotify(p_Pool, i);
+    }
+}
+
+static void DropAll(PdqFakePool_t* p_Pool) {
+    for (int i = 0; i < PDQ_FAKE_POOL_MAX_CLIENTS; i++) {
+        if (p_Pool->Clients[i] < 0) continue;
+        CloseClient(p_Pool, i);
+        atomic_fetch_add(&p_Pool->Drops, 1);
+    }
+}
+
+/* What a replay sends from its stream: the pool's notifications, and the
+ * recorded miner's subscribes after its first, which mark reconnects.
+ * Returns the next such entry from k on, or Count, and adds the recorded
+ * time up to it to *p_DelayMs. */
+static size_t NextReplayed(const PdqFakePool_t* p_Pool, size_t k, uint64_t* p_DelayMs) {
+    const PdqCaptureLog_t* log = p_Pool->p_Replay;
+    for (; k < log->Count; k++) {
+        const PdqCaptureEntry_t* e = &log->p_Entries[k];
+        *p_DelayMs += e->DelayMs;
+        if (e->Stream != p_Pool->ReplayStream) continue;
+        if (e->Outbound) {
+            if (strstr(e->p_Line, "mining.subscribe")) return k;
+        } else if (strstr(e->p_Line, "\"method\"") && !strstr(e->p_Line, "client.reconnect")) {
+            return k;
+        }
+    }
+    return log->Count;
+}
+
+/* Just past the recorded miner's first subscribe */
+static size_t ReplayBegin(const PdqFakePool_t* p_Pool) {
+    const PdqCaptureLog_t* log = p_Pool->p_Replay;
+    for (size_t k = 0; k < log->Count; k++) {
+        const PdqCaptureEntry_t* e = &log->p_Entries[k];
+        if (e->Stream == p_Pool->ReplayStream && e->Outbound && strstr(e->p_Line, "mining.subscribe")) {
+            return k + 1;
+        }
+    }
+    return 0;
+}
+
+static void StartReplay(PdqFakePool_t* p_Pool, int i, uint64_t now) {
+    uint64_t delay = 0;
+    p_Pool->ReplayPos[i] = NextReplayed(p_Pool, p_Pool->ReplayResume, &delay);
+    p_Pool->ReplayDueMs[i] = now;
+}
+
+static void ReplayClient(PdqFakePool_t* p_Pool, int i, uint64_t now) {
+    const PdqCaptureLog_t* log = p_Pool->p_Replay;
+    uint32_t speed = p_Pool->ReplaySpeed ? p_Pool->ReplaySpeed : 1;
+
+    while (p_Pool->Clients[i] >= 0 && now >= p_Pool->ReplayDueMs[i]) {
+        size_t k = p_Pool->ReplayPos[i];
+        if (k >= log->Count) {
+            if (!p_Pool->ReplayLoop) return;
+            p_Pool->ReplayResume = ReplayBegin(p_Pool);
+            StartReplay(p_Pool, i, now);
+            if (p_Pool->ReplayPos[i] >= log->Count) return;
+            continue;
+        }
+        const PdqCaptureEntry_t* e = &log->p_Entries[k];
+        uint64_t delay = 0;
+        p_Pool->ReplayPos[i] = NextReplayed(p_Pool, k + 1, &delay);
+        p_Pool->ReplayDueMs[i] += delay / speed;
+        if (e->Outbound) {
+            /* The recorded miner reconnected here; so does this one */
+            p_Pool->ReplayResume = k + 1;
+            CloseClient(p_Pool, i);
+            atomic_fetch_add(&p_Pool->Drops, 1);
+            return;
+        }
+        SendLine(p_Pool->Clients[i], e->p_Line);
+        atomic_fetch_add(&p_Pool->Replayed, 1);
+        if (strstr(e->p_Line, "mining.notify")) atomic_fetch_add(&p_Pool->Notifies, 1);
+    }
+}
+
+static int ParseId(const char* line) {
+    const char* p = strstr(line, "\"id\"");
+    if (!p) return 0;
+    p = strchr(p, ':');
+    return p ? atoi(p + 1) : 0;
+}
+
+static void HandleLine(PdqFakePool_t* p_Pool, int i, const char* line) {
+    int fd = p_Pool->Clients[i];
+    int id = ParseId(line);
+    char buf[256];
+
+    if (atomic_load(&p_Pool->Mute)) return;
+
+    if (strstr(line, "mining.subscribe")) {
+        /* Each subscription gets its own id and extranonce1; offering a
+         * known id back resumes it unless resumption is refused */
+        const char* offered = strstr(line, "\"sess");
+        unsigned session = p_Pool->Sessions;
+        if (offered && !atomic_load(&p_Pool->RefuseResume)) {
+            unsigned n = (unsigned)strtoul(offered + 5, NULL, 16);
+            if (n < p_Pool->Sessions) {
+                session = n;
+                atomic_fetch_add(&p_Pool->Resumes, 1);
+            }
+        }
+        if (session == p_Pool->Sessions) p_Pool->Sessions++;
+        snprintf(buf, sizeof(buf),
+                 "{\"id\":%d,\"result\":[[[\"mining.set_difficulty\",\"diff%x\"],"
+                 "[\"mining.notify\",\"sess%x\"]],\"%08x\",4],\"error\":null}",
+                 id, session, session, 0x2e1a5ba1u + session);
+        SendLine(fd, buf);
+    } else if (strstr(line, "mining.authorize")) {
+        snprintf(buf, sizeof(buf), "{\"id\":%d,\"result\":true,\"error\":null}", id);
+        SendLine(fd, buf);
+        p_Pool->Authorized[i] = true;
+        atomic_fetch_add(&p_Pool->Authorizations, 1);
+        if (p_Pool->p_Replay) {
+            StartReplay(p_Pool, i, GetMillis());
+        } else if (!atomic_load(&p_Pool->Silent)) {
+            SendNotify(p_Pool, i);
+        }
+    } else if (strstr(line, "mining.extranonce.subscribe")) {
+        atomic_fetch_add(&p_Pool->ExtranonceSubscribes, 1);
+        snprintf(buf, sizeof(buf), "{\"id\":%d,\"result\":true,\"error\":null}", id);
+        SendLine(fd, buf);
+    } else if (strstr(line, "mining.suggest_difficulty")) {
+        const char* params = strstr(line, "\"params\"");
+        params = params ? strchr(params, '[') : NULL;
+        atomic_store(&p_Pool->SuggestMilli, params ? (unsigned)(atof(params + 1) * 1000.0) : 0);
+        atomic_fetch_add(&p_Pool->Suggests, 1);
+        if (atomic_load(&p_Pool->Silent)) return;
+        snprintf(buf, sizeof(buf), "{\"id\":%d,\"result\":true,\"error\":null}", id);
+        SendLine(fd, buf);
+    } else if (strstr(line, "mining.submit")) {
+        snprintf(p_Pool->LastSubmit, sizeof(p_Pool->LastSubmit), "%s", line);
+        atomic_fetch_add(&p_Pool->Submits, 1);
+        if (atomic_load(&p_Pool->IgnoreSubmits)) return;
+        if (atomic_load(&p_Pool->RejectSubmits)) {
+            snprintf(buf, sizeof(buf),
+                     "{\"id\":%d,\"result\":null,\"error\":[23,\"Low difficulty share\",null]}", id);
+        } else {
+            snprintf(buf, sizeof(buf), "{\"id\":%d,\"result\":true,\"error\":null}", id);
+        }
+        SendLine(fd, buf);
+    } else if (!atomic_load(&p_Pool->Silent)) {
+        snprintf(buf, sizeof(buf), "{\"id\":%d,\"result\":true,\"error\":null}", id);
+        SendLine(fd, buf);
+    }
+}
+
+static void ReadClient(PdqFakePool_t* p_Pool, int i) {
+    char* line = p_Pool->Lines[i];
+    size_t space = sizeof(p_Pool->Lines[i]) - 1 - p_Pool->LineLen[i];
+    ssize_t n = recv(p_Pool->Clients[i], line + p_Pool->LineLen[i], space, 0);
+    if (n <= 0) {
+        CloseClient(p_Pool, i);
+        return;
+    }
+    p_Pool->LineLen[i] += (size_t)n;
+    line[p_Pool->LineLen[i]] = '\0';
+
+    char* nl;
+    while (p_Pool->Clients[i] >= 0 && (nl = strchr(line, '\n')) != NULL) {
+        *nl = '\0';
+        HandleLine(p_Pool, i, line);
+        size_t used = (size_t)(nl - line) + 1;
+        memmove(line, nl + 1, p_Pool->LineLen[i] - used + 1);
+        p_Pool->LineLen[i] -= used;
+    }
+    if (p_Pool->LineLen[i] >= sizeof(p_Pool->Lines[i]) - 1) CloseClient(p_Pool, i);
+}
+
+static void* PoolThread(void* arg) {
+    PdqFakePool_t* p_Pool = (PdqFakePool_t*)arg;
+    uint64_t lastNotify = GetMillis();
+    uint64_t lastDrop = lastNotify;
+
+    while (atomic_load(&p_Pool->Running)) {
+        struct pollfd fds[PDQ_FAKE_POOL_MAX_CLIENTS + 1];
+        int map[PDQ_FAKE_POOL_MAX_CLIENTS + 1];
+        int n = 0;
+
+        fds[n].fd = p_Pool->ListenFd;
+        fds[n].events = POLLIN;
+        map[n++] = -1;
+        int stalled = atomic_load(&p_Pool->Stalled);
+        for (int i = 0; i < PDQ_FAKE_POOL_MAX_CLIENTS; i++) {
+            if (p_Pool->Clients[i] < 0) continue;
+            fds[n].fd = p_Pool->Clients[i];
+            fds[n].events = stalled ? 0 : POLLIN;
+            map[n++] = i;
+        }
+
+        poll(fds, (nfds_t)n, 20);
+
+        if (atomic_exchange(&p_Pool->DropClients, 0)) {
+            DropAll(p_Pool);
+            continue;
+        }
+
+        if (atomic_exchange(&p_Pool->SetExtranonce, 0)) {
+            for (int i = 0; i < PDQ_FAKE_POOL_MAX_CLIENTS; i++) {
+                if (p_Pool->Clients[i] >= 0 && p_Pool->Authorized[i]) {
+                    SendLine(p_Pool->Clients[i],
+                             "{\"id\":null,\"method\":\"mining.set_extranonce\",\"params\":[\"c0ffee01\",2]}");
+                }
+            }
+        }
+
+        int cleanNow = atomic_exchange(&p_Pool->CleanNow, 0);
+        if (atomic_exchange(&p_Pool->NotifyNow, 0) | cleanNow) BroadcastJob(p_Pool, cleanNow);
+
+        for (int k = 1; k < n; k++) {
+            if (fds[k].revents && !stalled && p_Pool->Clients[map[k]] >= 0) ReadClient(p_Pool, map[k]);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(p_Pool->ListenFd, NULL, NULL);
+            if (fd >= 0) {
+                int slot = -1;
+                for (int i = 0; i < PDQ_FAKE_POOL_MAX_CLIENTS; i++) {
+                    if (p_Pool->Clients[i] < 0) { slot = i; break; }
+                }
+                if (slot < 0) {
+                    close(fd);
+                } else {
+                    p_Pool->Clients[slot] = fd;
+                    atomic_fetch_add(&p_Pool->Connections, 1);
+                }
+            }
+        }
+
+        uint64_t now = GetMillis();
+        uint32_t interval = atomic_load(&p_Pool->NotifyIntervalMs);
+        if (interval && now - lastNotify >= interval) {
+            lastNotify = now;
+            if (!atomic_load(&p_Pool->Silent) && !p_Pool->p_Replay) BroadcastJob(p_Pool, false);
+        }
+
+        uint32_t dropEvery = atomic_load(&p_Pool->DropEveryMs);
+        if (!dropEvery) {
+            lastDrop = now;
+        } else if (now - lastDrop >= dropEvery) {
+            lastDrop = now;
+            atomic_store(&p_Pool->DropClients, 1);
+        }
+
+        for (int i = 0; p_Pool->p_Replay && i < PDQ_FAKE_POOL_MAX_CLIENTS; i++) {
+            if (p_Pool->Clients[i] >= 0 && p_Pool->Authorized[i]) ReplayClient(p_Pool, i, now);
+        }
+    }
+    return NULL;
+}
+
+PdqError_t PdqFakePoolStart(PdqFakePool_t* p_Pool, uint16_t Port) {
+    if (!p_Pool) return PdqErrorInvalidParam;
+
+    /* Settings made before start survive; everything else starts over */
+    unsigned interval = atomic_load(&p_Pool->NotifyIntervalMs);
+    int silent = atomic_load(&p_Pool->Silent);
+    int mute = atomic_load(&p_Pool->Mute);
+    unsigned milli = atomic_load(&p_Pool->DifficultyMilli);
+    unsigned cleanEvery = atomic_load(&p_Pool->CleanEvery);
+    unsigned dropEvery = atomic_load(&p_Pool->DropEveryMs);
+    const PdqCaptureLog_t* replay = p_Pool->p_Replay;
+    uint8_t replayStream = p_Pool->ReplayStream;
+    bool replayLoop = p_Pool->ReplayLoop;
+    uint32_t replaySpeed = p_Pool->ReplaySpeed;
+    memset(p_Pool, 0, sizeof(*p_Pool));
+    atomic_store(&p_Pool->NotifyIntervalMs, interval);
+    atomic_store(&p_Pool->Silent, silent);
+    atomic_store(&p_Pool->Mute, mute);
+    atomic_store(&p_Pool->DifficultyMilli, milli);
+    atomic_store(&p_Pool->CleanEvery, cleanEvery);
+    atomic_store(&p_Pool->DropEveryMs, dropEvery);
+    p_Pool->p_Replay = replay;
+    p_Pool->ReplayStream = replayStream ? replayStream : 1;
+    p_Pool->ReplayLoop = replayLoop;
+    p_Pool->ReplaySpeed = replaySpeed;
+    if (replay) p_Pool->ReplayResume = ReplayBegin(p_Pool);
+    snprintf(p_Pool->JobId, sizeof(p_Pool->JobId), "%s", s_JobId);
+    snprintf(p_Pool->PrevHash, sizeof(p_Pool->PrevHash), "%s", s_PrevHash);
+    p_Pool->JobClean = true;
+    for (int i = 0; i < PDQ_FAKE_POOL_MAX_CLIENTS; i++) p_Pool->Clients[i] = -1;
+
+    p_Pool->ListenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (p_Pool->ListenFd < 0) return PdqErrorNotConnected;
+
+    int one = 1;
+    setsockopt(p_Pool->ListenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(Port);
+    socklen_t len = sizeof(addr);
+    if (bind(p_Pool->ListenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(p_Pool->ListenFd, 16) != 0 ||
+        getsockname(p_Pool->ListenFd, (struct sockaddr*)&addr, &len) != 0) {
+        close(p_Pool->ListenFd);
+        p_Pool->ListenFd = -1;
+        return PdqErrorNotConnected;
+    }
+    p_Pool->Port = ntohs(addr.sin_port);
+
+    atomic_store(&p_Pool->Running, 1);
+    if (pthread_create(&p_Pool->Thread, NULL, PoolThread, p_Pool) != 0) {
+        close(p_Pool->ListenFd);
+        p_Pool->ListenFd = -1;
+        atomic_store(&p_Pool->Running, 0);
+        return PdqErrorNoMemory;
+    }
+    return PdqOk;
+}
+
+void PdqFakePoolStop(PdqFakePool_t* p_Pool) {
+    if (!p_Pool || !atomic_load(&p_Pool->Running)) return;
+    atomic_store(&p_Pool->Running, 0);
+    pthread_join(p_Pool->Thread, NULL);
+    for (int i = 0; i < PDQ_FAKE_POOL_MAX_CLIENTS; i++) {
+        if (p_Pool->Clients[i] >= 0) CloseClient(p_Pool, i);
+    }
+    close(p_Pool->ListenFd);
+    p_Pool->ListenFd = -1;
+}
+
+bool PdqFakePoolHandshake(const PdqFakePool_t* p_Pool, PdqStratumContext_t* p_Ctx,
+                          PdqStratumState_t Target, uint32_t TimeoutMs) {
+    if (PdqStratumCtxConnectStart(p_Ctx, "127.0.0.1", p_Pool->Port) != PdqOk) return false;
+
+    uint64_t deadline = GetMillis() + TimeoutMs;
+    while (GetMillis() < deadline && PdqStratumCtxGetState(p_Ctx) < Target) {
+        PdqStratumCtxProcess(p_Ctx);
+        PdqStratumState_t state = PdqStratumCtxGetState(p_Ctx);
+        if (state == StratumStateConnected) PdqStratumCtxSubscribe(p_Ctx);
+        if (state == StratumStateSubscribed) PdqStratumCtxAuthorize(p_Ctx, "bc1qtest.unit", "x");
+        if (state == StratumStateDisconnected) return false;
+        struct timespec ts = {0, 2000000L};
+        nanosleep(&ts, NULL);
+    }
+    return PdqStratumCtxGetState(p_Ctx) >= Target;
+}
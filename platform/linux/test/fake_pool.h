@@ -0,0 +1,109 @@
+/**
+ * @file fake_pool.h
+ * @brief In-process Stratum V1 pool for host-side tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Listens on 127.0.0.1 in a background thread and speaks just enough
+ * Stratum for the client: subscribe, authorize, set_difficulty, notify
+ * and submit. Behaviour can be changed while running to simulate a
+ * silent or mute pool, or a pool that drops its clients.
+ *
+ * By default every notify is the same block 1eaa720 job with clean_jobs
+ * set. With CleanEvery set, each notify is a new job instead: ids count
+ * up in hex, and every CleanEvery-th job is a clean one on a new
+ * prevhash. With p_Replay set, the pool still answers the handshake and
+ * submits itself, but its jobs come from one stream of a capture: the
+ * pool's notifications are sent to each authorized client at their
+ * recorded pace, and where the recorded miner reconnected the client
+ * is dropped.
+ */
+
+#ifndef PDQ_FAKE_POOL_H
+#define PDQ_FAKE_POOL_H
+
+#include "pdq_types.h"
+#include "linux_capture.h"
+#include "stratum/stratum_client.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_FAKE_POOL_MAX_CLIENTS   8
+
+typedef struct {
+    int             ListenFd;
+    uint16_t        Port;
+    pthread_t       Thread;
+    atomic_int      Running;
+    atomic_int      Silent;         /* Handshake only, never send jobs */
+    atomic_int      Mute;           /* Accept connections, never answer */
+    atomic_int      RejectSubmits;  /* Answer submits with error 23 */
+    atomic_int      IgnoreSubmits;  /* Never answer submits */
+    atomic_int      Stalled;        /* Stop reading, let client sends back up */
+    atomic_int      DropClients;    /* Close all sessions on next pass */
+    atomic_uint     PadCoinbase;    /* Extra coinbase1 bytes per notify, for long lines */
+    atomic_int      SetExtranonce;  /* Send mining.set_extranonce on next pass */
+    atomic_int      RefuseResume;   /* Ignore offered session ids */
+    atomic_int      NotifyNow;      /* Send a job to all clients on next pass */
+    atomic_int      CleanNow;       /* Same, and make it a clean job */
+    atomic_uint     DifficultyMilli;    /* set_difficulty x 1000, 0 for 1 */
+    atomic_uint     CleanEvery;     /* 0 repeats the fixed job */
+    atomic_uint     DropEveryMs;    /* Drop all clients this often, 0 never */
+    atomic_uint     NotifyIntervalMs;
+
+    /* Replay, set before start. The capture must outlive the pool. */
+    const PdqCaptureLog_t* p_Replay;
+    uint8_t         ReplayStream;   /* 0 for the first stream */
+    bool            ReplayLoop;     /* Start over at the end */
+    uint32_t        ReplaySpeed;    /* Delays divided by this, 0 for 1 */
+
+    int             Clients[PDQ_FAKE_POOL_MAX_CLIENTS];
+    char            Lines[PDQ_FAKE_POOL_MAX_CLIENTS][1024];
+    size_t          LineLen[PDQ_FAKE_POOL_MAX_CLIENTS];
+    bool            Authorized[PDQ_FAKE_POOL_MAX_CLIENTS];
+    char            LastSubmit[1024];   /* Written before the reply is sent */
+    uint32_t        SentMilli[PDQ_FAKE_POOL_MAX_CLIENTS];   /* Difficulty each client has */
+    size_t          ReplayPos[PDQ_FAKE_POOL_MAX_CLIENTS];   /* Next entry, Count when done */
+    uint64_t        ReplayDueMs[PDQ_FAKE_POOL_MAX_CLIENTS];
+    size_t          ReplayResume;   /* Where a reconnecting client picks up */
+
+    /* Current job (pool thread only) */
+    char            JobId[16];
+    char            PrevHash[65];
+    bool            JobClean;
+    unsigned        JobSeq;
+    unsigned        CleanSeq;
+
+    atomic_uint     Connections;
+    atomic_uint     Authorizations;
+    atomic_uint     Notifies;
+    atomic_uint     Submits;
+    atomic_uint     CleanJobs;
+    atomic_uint     Drops;          /* Client connections closed by the pool */
+    atomic_uint     Replayed;       /* Capture lines sent */
+    atomic_uint     ExtranonceSubscribes;
+    atomic_uint     Resumes;
+    atomic_uint     Suggests;
+    atomic_uint     SuggestMilli;   /* Last suggested difficulty x 1000 */
+    unsigned        Sessions;       /* Subscriptions issued (pool thread only) */
+} PdqFakePool_t;
+
+/* Port 0 picks an ephemeral port, reported in p_Pool->Port */
+PdqError_t PdqFakePoolStart(PdqFakePool_t* p_Pool, uint16_t Port);
+void       PdqFakePoolStop(PdqFakePool_t* p_Pool);
+
+/* Connect p_Ctx to the pool and drive subscribe and authorize (as worker
+ * bc1qtest.unit) until it reaches Target. False if the session closed or
+ * TimeoutMs ran out first. */
+bool       PdqFakePoolHandshake(const PdqFakePool_t* p_Pool, PdqStratumContext_t* p_Ctx,
+                                PdqStratumState_t Target, uint32_t TimeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,352 @@
+/**
+ * @file fake_sv2_pool.c
+ * @brief In-process Stratum V2 pool for host-side tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "fake_sv2_pool.h"
+#include "stratum/sv2_proto.h"
+#include "core/secp256k1.h"
+#include "core/target.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#ifdef MSG_NOSIGNAL
+#define FAKE_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define FAKE_SEND_FLAGS 0
+#endif
+
+#define FAKE_CHANNEL_ID 7
+
+/* Genesis block merkle root, in header byte order */
+static const uint8_t s_GenesisMerkle[32] = {
+    0x3b, 0xa3, 0xed, 0xfd, 0x7a, 0x7b, 0x12, 0xb2, 0x7a, 0xc7, 0x2c, 0x3e, 0x67, 0x76, 0x8f, 0x61,
+    0x7f, 0xc8, 0x1b, 0xc3, 0x88, 0x8a, 0x51, 0x32, 0x3a, 0x9f, 0xb8, 0xaa, 0x4b, 0x1e, 0x5e, 0x4a
+};
+
+static void SendFrame(PdqFakeSv2Pool_t* p_Pool, int i, PdqSv2Writer_t* w) {
+    uint8_t sealed[512];
+    PdqSv2EndFrame(w);
+    if (w->Overflow) return;
+    PdqSv2NoiseSealFrame(&p_Pool->Send[i], w->p_Data, w->Len, sealed);
+    send(p_Pool->Clients[i], sealed, PdqSv2NoiseFrameSize(w->Len), FAKE_SEND_FLAGS);
+}
+
+static void CloseClient(PdqFakeSv2Pool_t* p_Pool, int i) {
+    close(p_Pool->Clients[i]);
+    p_Pool->Clients[i] = -1;
+    p_Pool->FrameLen[i] = 0;
+    p_Pool->Open[i] = false;
+    p_Pool->Secured[i] = false;
+}
+
+/* Future job for JobId, then the prevhash that activates it. Job 1 is
+ * the genesis block; later ones change the prevhash and merkle root. */
+static void SendBlock(PdqFakeSv2Pool_t* p_Pool, int i) {
+    uint8_t buf[256];
+    PdqSv2Writer_t w;
+    uint8_t merkle[32];
+    uint8_t prev[32];
+    memcpy(merkle, s_GenesisMerkle, 32);
+    memset(prev, 0, 32);
+    merkle[0] ^= (uint8_t)p_Pool->Blocks;
+    prev[31] = (uint8_t)p_Pool->Blocks;
+
+    PdqSv2WriterInit(&w, buf, sizeof(buf));
+    PdqSv2BeginFrame(&w, true, PDQ_SV2_MSG_NEW_MINING_JOB);
+    PdqSv2PutU32(&w, FAKE_CHANNEL_ID);
+    PdqSv2PutU32(&w, p_Pool->JobId);
+    PdqSv2PutU8(&w, 0);                 /* min_ntime absent: future job */
+    PdqSv2PutU32(&w, 1);
+    PdqSv2PutBytes(&w, merkle, 32);
+    SendFrame(p_Pool, i, &w);
+
+    PdqSv2WriterInit(&w, buf, sizeof(buf));
+    PdqSv2BeginFrame(&w, true, PDQ_SV2_MSG_SET_NEW_PREV_HASH);
+    PdqSv2PutU32(&w, FAKE_CHANNEL_ID);
+    PdqSv2PutU32(&w, p_Pool->JobId);
+    PdqSv2PutBytes(&w, prev, 32);
+    PdqSv2PutU32(&w, PDQ_FAKE_SV2_GENESIS_NTIME + p_Pool->Blocks);
+    PdqSv2PutU32(&w, 0x1d00ffff);
+    SendFrame(p_Pool, i, &w);
+}
+
+static void HandleFrame(PdqFakeSv2Pool_t* p_Pool, int i, const PdqSv2FrameHeader_t* hdr,
+                        const uint8_t* payload) {
+    uint8_t buf[256];
+    PdqSv2Writer_t w;
+    PdqSv2Reader_t r;
+    PdqSv2WriterInit(&w, buf, sizeof(buf));
+    PdqSv2ReaderInit(&r, payload, hdr->Length);
+
+    switch (hdr->MsgType) {
+    case PDQ_SV2_MSG_SETUP_CONNECTION:
+        atomic_fetch_add(&p_Pool->Setups, 1);
+        if (atomic_load(&p_Pool->RejectSetup)) {
+            PdqSv2BeginFrame(&w, false, PDQ_SV2_MSG_SETUP_CONNECTION_ERROR);
+            PdqSv2PutU32(&w, 0);
+            PdqSv2PutStr(&w, "unsupported-protocol");
+        } else {
+            PdqSv2BeginFrame(&w, false, PDQ_SV2_MSG_SETUP_CONNECTION_SUCCESS);
+            PdqSv2PutU16(&w, PDQ_SV2_VERSION);
+            PdqSv2PutU32(&w, 0);
+        }
+        SendFrame(p_Pool, i, &w);
+        break;
+
+    case PDQ_SV2_MSG_OPEN_STANDARD_CHANNEL: {
+        uint32_t request = PdqSv2GetU32(&r);
+        PdqSv2GetStr(&r, p_Pool->LastUser, sizeof(p_Pool->LastUser));
+        uint32_t target[8];
+        PdqTargetFromDifficulty(1.0, target);
+        const uint8_t prefix[4] = {0xde, 0xad, 0xbe, 0xef};
+
+        PdqSv2BeginFrame(&w, false, PDQ_SV2_MSG_OPEN_STANDARD_CHANNEL_SUCCESS);
+        PdqSv2PutU32(&w, request);
+        PdqSv2PutU32(&w, FAKE_CHANNEL_ID);
+        PdqSv2PutU256Words(&w, target);
+        PdqSv2PutB032(&w, prefix, sizeof(prefix));
+        PdqSv2PutU32(&w, 0);
+        SendFrame(p_Pool, i, &w);
+        p_Pool->Open[i] = true;
+        atomic_fetch_add(&p_Pool->Channels, 1);
+        SendBlock(p_Pool, i);
+        break;
+    }
+
+    case PDQ_SV2_MSG_SUBMIT_SHARES_STANDARD: {
+        PdqSv2GetU32(&r);
+        uint32_t seq = PdqSv2GetU32(&r);
+        uint32_t job = PdqSv2GetU32(&r);
+        atomic_store(&p_Pool->LastJobId, job);
+        atomic_store(&p_Pool->LastNonce, PdqSv2GetU32(&r));
+        atomic_store(&p_Pool->LastNTime, PdqSv2GetU32(&r));
+        atomic_store(&p_Pool->LastVersion, PdqSv2GetU32(&r));
+        atomic_fetch_add(&p_Pool->Submits, 1);
+
+        const char* error = NULL;
+        if (job != p_Pool->JobId) {
+            atomic_fetch_add(&p_Pool->Stale, 1);
+            error = "stale-share";
+        } else if (atomic_load(&p_Pool->RejectSubmits)) {
+            error = "difficulty-too-low";
+        }
+        if (error) {
+            PdqSv2BeginFrame(&w, true, PDQ_SV2_MSG_SUBMIT_SHARES_ERROR);
+            PdqSv2PutU32(&w, FAKE_CHANNEL_ID);
+            PdqSv2PutU32(&w, seq);
+            PdqSv2PutStr(&w, error);
+        } else {
+            PdqSv2BeginFrame(&w, true, PDQ_SV2_MSG_SUBMIT_SHARES_SUCCESS);
+            PdqSv2PutU32(&w, FAKE_CHANNEL_ID);
+            PdqSv2PutU32(&w, seq);
+            PdqSv2PutU32(&w, 1);
+            PdqSv2PutU64(&w, 1);
+        }
+        SendFrame(p_Pool, i, &w);
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+static void ReadClient(PdqFakeSv2Pool_t* p_Pool, int i) {
+    uint8_t* buf = p_Pool->Frames[i];
+    ssize_t n = recv(p_Pool->Clients[i], buf + p_Pool->FrameLen[i],
+                     sizeof(p_Pool->Frames[i]) - p_Pool->FrameLen[i], 0);
+    if (n <= 0) {
+        CloseClient(p_Pool, i);
+        return;
+    }
+    p_Pool->FrameLen[i] += (size_t)n;
+
+    size_t pos = 0;
+    if (!p_Pool->Secured[i]) {
+        if (p_Pool->FrameLen[i] < PDQ_SV2_NOISE_ACT1_SIZE) return;
+        uint8_t act2[PDQ_SV2_NOISE_ACT2_SIZE];
+        if (PdqSv2NoiseRespond(buf, p_Pool->StaticKey, p_Pool->Certificate, act2,
+                               &p_Pool->Send[i], &p_Pool->Recv[i]) != PdqOk) {
+            CloseClient(p_Pool, i);
+            return;
+        }
+        send(p_Pool->Clients[i], act2, sizeof(act2), FAKE_SEND_FLAGS);
+        p_Pool->Secured[i] = true;
+        atomic_fetch_add(&p_Pool->Handshakes, 1);
+        pos = PDQ_SV2_NOISE_ACT1_SIZE;
+    }
+
+    /* Frames are decrypted only once whole; the client never sends one
+     * longer than a chunk, so header and payload are one message each */
+    while (p_Pool->Clients[i] >= 0 && p_Pool->FrameLen[i] - pos >= PDQ_SV2_NOISE_HEADER_SIZE) {
+        uint8_t plain[PDQ_SV2_HEADER_SIZE];
+        PdqSv2Cipher_t peek = p_Pool->Recv[i];
+        if (!PdqSv2CipherOpen(&peek, buf + pos, PDQ_SV2_NOISE_HEADER_SIZE, plain)) {
+            CloseClient(p_Pool, i);
+            return;
+        }
+        PdqSv2FrameHeader_t hdr;
+        PdqSv2DecodeHeader(plain, &hdr);
+        size_t body = PdqSv2NoisePayloadSize(hdr.Length);
+        size_t len = PDQ_SV2_NOISE_HEADER_SIZE + body;
+        if (len > sizeof(p_Pool->Frames[i])) {
+            CloseClient(p_Pool, i);
+            return;
+        }
+        if (p_Pool->FrameLen[i] - pos < len) break;
+
+        uint8_t* payload = buf + pos + PDQ_SV2_NOISE_HEADER_SIZE;
+        if (body > 0 && !PdqSv2CipherOpen(&peek, payload, (uint32_t)body, payload)) {
+            CloseClient(p_Pool, i);
+            return;
+        }
+        p_Pool->Recv[i] = peek;
+        HandleFrame(p_Pool, i, &hdr, payload);
+        pos += len;
+    }
+    if (p_Pool->Clients[i] < 0) return;
+    memmove(buf, buf + pos, p_Pool->FrameLen[i] - pos);
+    p_Pool->FrameLen[i] -= pos;
+}
+
+static void* PoolThread(void* arg) {
+    PdqFakeSv2Pool_t* p_Pool = (PdqFakeSv2Pool_t*)arg;
+
+    while (atomic_load(&p_Pool->Running)) {
+        struct pollfd fds[PDQ_FAKE_SV2_MAX_CLIENTS + 1];
+        int map[PDQ_FAKE_SV2_MAX_CLIENTS + 1];
+        int n = 0;
+
+        fds[n].fd = p_Pool->ListenFd;
+        fds[n].events = POLLIN;
+        map[n++] = -1;
+        for (int i = 0; i < PDQ_FAKE_SV2_MAX_CLIENTS; i++) {
+            if (p_Pool->Clients[i] < 0) continue;
+            fds[n].fd = p_Pool->Clients[i];
+            fds[n].events = POLLIN;
+            map[n++] = i;
+        }
+
+        poll(fds, (nfds_t)n, 20);
+
+        if (atomic_exchange(&p_Pool->NewBlock, 0)) {
+            p_Pool->JobId++;
+            p_Pool->Blocks++;
+            for (int i = 0; i < PDQ_FAKE_SV2_MAX_CLIENTS; i++) {
+                if (p_Pool->Clients[i] >= 0 && p_Pool->Open[i]) SendBlock(p_Pool, i);
+            }
+        }
+
+        if (atomic_exchange(&p_Pool->SetTarget, 0)) {
+            uint32_t target[8];
+            PdqTargetFromDifficulty(2.0, target);
+            for (int i = 0; i < PDQ_FAKE_SV2_MAX_CLIENTS; i++) {
+                if (p_Pool->Clients[i] < 0 || !p_Pool->Open[i]) continue;
+                uint8_t buf[64];
+                PdqSv2Writer_t w;
+                PdqSv2WriterInit(&w, buf, sizeof(buf));
+                PdqSv2BeginFrame(&w, true, PDQ_SV2_MSG_SET_TARGET);
+                PdqSv2PutU32(&w, FAKE_CHANNEL_ID);
+                PdqSv2PutU256Words(&w, target);
+                SendFrame(p_Pool, i, &w);
+            }
+        }
+
+        for (int k = 1; k < n; k++) {
+            if (fds[k].revents && p_Pool->Clients[map[k]] >= 0) ReadClient(p_Pool, map[k]);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(p_Pool->ListenFd, NULL, NULL);
+            if (fd >= 0) {
+                int slot = -1;
+                for (int i = 0; i < PDQ_FAKE_SV2_MAX_CLIENTS; i++) {
+                    if (p_Pool->Clients[i] < 0) { slot = i; break; }
+                }
+                if (slot < 0) {
+                    close(fd);
+                } else {
+                    p_Pool->Clients[slot] = fd;
+                    atomic_fetch_add(&p_Pool->Connections, 1);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+PdqError_t PdqFakeSv2PoolStart(PdqFakeSv2Pool_t* p_Pool, uint16_t Port) {
+    if (!p_Pool) return PdqErrorInvalidParam;
+
+    int rejectSetup = atomic_load(&p_Pool->RejectSetup);
+    int badCertificate = atomic_load(&p_Pool->BadCertificate);
+    memset(p_Pool, 0, sizeof(*p_Pool));
+    atomic_store(&p_Pool->RejectSetup, rejectSetup);
+    atomic_store(&p_Pool->BadCertificate, badCertificate);
+    p_Pool->JobId = 1;
+
+    /* Fixed keys keep runs reproducible; a bad certificate is signed by
+     * a second authority the client was not told about */
+    uint8_t authority[32];
+    uint8_t signer[32];
+    memset(authority, 0x11, sizeof(authority));
+    memset(signer, badCertificate ? 0x33 : 0x11, sizeof(signer));
+    memset(p_Pool->StaticKey, 0x22, sizeof(p_Pool->StaticKey));
+    PdqSecpPubkeyXOnly(authority, p_Pool->AuthorityKey);
+    uint32_t now = (uint32_t)time(NULL);
+    if (PdqSv2NoiseSignCertificate(signer, p_Pool->StaticKey, now - 3600, now + 3600,
+                                   p_Pool->Certificate) != PdqOk) {
+        return PdqErrorInvalidParam;
+    }
+    for (int i = 0; i < PDQ_FAKE_SV2_MAX_CLIENTS; i++) p_Pool->Clients[i] = -1;
+
+    p_Pool->ListenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (p_Pool->ListenFd < 0) return PdqErrorNotConnected;
+
+    int one = 1;
+    setsockopt(p_Pool->ListenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(Port);
+    socklen_t len = sizeof(addr);
+    if (bind(p_Pool->ListenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(p_Pool->ListenFd, 16) != 0 ||
+        getsockname(p_Pool->ListenFd, (struct sockaddr*)&addr, &len) != 0) {
+        close(p_Pool->ListenFd);
+        p_Pool->ListenFd = -1;
+        return PdqErrorNotConnected;
+    }
+    p_Pool->Port = ntohs(addr.sin_port);
+
+    atomic_store(&p_Pool->Running, 1);
+    if (pthread_create(&p_Pool->Thread, NULL, PoolThread, p_Pool) != 0) {
+        close(p_Pool->ListenFd);
+        p_Pool->ListenFd = -1;
+        atomic_store(&p_Pool->Running, 0);
+        return PdqErrorNoMemory;
+    }
+    return PdqOk;
+}
+
+void PdqFakeSv2PoolStop(PdqFakeSv2Pool_t* p_Pool) {
+    if (!p_Pool || !atomic_load(&p_Pool->Running)) return;
+    atomic_store(&p_Pool->Running, 0);
+    pthread_join(p_Pool->Thread, NULL);
+    for (int i = 0; i < PDQ_FAKE_SV2_MAX_CLIENTS; i++) {
+        if (p_Pool->Clients[i] >= 0) CloseClient(p_Pool, i);
+    }
+    close(p_Pool->ListenFd);
+    p_Pool->ListenFd = -1;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file fake_sv2_pool.h
+ * @brief In-process Stratum V2 pool for host-side tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Listens on 127.0.0.1 in a background thread, answers the Noise NX
+ * handshake as the responder and speaks the encrypted SV2 mining
+ * protocol for standard channels: SetupConnection,
+ * OpenStandardMiningChannel, a future NewMiningJob activated by
+ * SetNewPrevHash, and SubmitSharesStandard. The first job is the genesis
+ * block, so its known nonce is a valid share and block candidate.
+ *
+ * The pool's static key is certified by a fixed authority key, whose
+ * public half is AuthorityKey for the client to pin.
+ */
+
+#ifndef PDQ_FAKE_SV2_POOL_H
+#define PDQ_FAKE_SV2_POOL_H
+
+#include "pdq_types.h"
+#include "stratum/sv2_noise.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_FAKE_SV2_MAX_CLIENTS    8
+#define PDQ_FAKE_SV2_GENESIS_NONCE  0x7c2bac1d
+#define PDQ_FAKE_SV2_GENESIS_NTIME  0x495fab29
+
+typedef struct {
+    int             ListenFd;
+    uint16_t        Port;
+    pthread_t       Thread;
+    atomic_int      Running;
+    atomic_int      RejectSetup;    /* Answer SetupConnection.Error */
+    atomic_int      RejectSubmits;  /* Answer every share with difficulty-too-low */
+    atomic_int      NewBlock;       /* Send a new job and prevhash on next pass */
+    atomic_int      SetTarget;      /* Send SetTarget for difficulty 2 on next pass */
+    atomic_int      BadCertificate; /* Certify the static key with another authority */
+
+    uint8_t         AuthorityKey[32];   /* x-only public key clients verify against */
+    uint8_t         StaticKey[32];
+    uint8_t         Certificate[PDQ_SV2_NOISE_CERT_SIZE];
+
+    int             Clients[PDQ_FAKE_SV2_MAX_CLIENTS];
+    uint8_t         Frames[PDQ_FAKE_SV2_MAX_CLIENTS][1024];
+    size_t          FrameLen[PDQ_FAKE_SV2_MAX_CLIENTS];
+    bool            Open[PDQ_FAKE_SV2_MAX_CLIENTS];
+    bool            Secured[PDQ_FAKE_SV2_MAX_CLIENTS];     /* Handshake done */
+    PdqSv2Cipher_t  Send[PDQ_FAKE_SV2_MAX_CLIENTS];
+    PdqSv2Cipher_t  Recv[PDQ_FAKE_SV2_MAX_CLIENTS];
+    uint32_t        JobId;          /* Current job (pool thread only) */
+    uint32_t        Blocks;         /* Prevhashes sent after genesis */
+
+    atomic_uint     Connections;
+    atomic_uint     Handshakes;
+    atomic_uint     Setups;
+    atomic_uint     Channels;
+    atomic_uint     Submits;
+    atomic_uint     Stale;          /* Shares for a job no longer current */
+    atomic_uint     LastJobId;
+    atomic_uint     LastNonce;
+    atomic_uint     LastNTime;
+    atomic_uint     LastVersion;
+    char            LastUser[64];   /* Written before the channel is answered */
+} PdqFakeSv2Pool_t;
+
+/* Port 0 picks an ephemeral port, reported in p_Pool->Port */
+PdqError_t PdqFakeSv2PoolStart(PdqFakeSv2Pool_t* p_Pool, uint16_t Port);
+void       PdqFakeSv2PoolStop(PdqFakeSv2Pool_t* p_Pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,296 @@
+/**
+ * @file mock_pool.c
+ * @brief Scenario-driven Stratum V1 mock pool for end-to-end runs
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Serves the in-process test pool on a real port so a whole pdqminer
+ * (or a fleet behind its proxy) can be run against it: notify, build,
+ * mine and submit without a live pool. What the pool does and when comes
+ * from a scenario, one command per line:
+ *
+ *     port 3334               listen port, 0 for any (setup only, default 3333)
+ *     replay FILE [stream N] [loop] [speed N]
+ *                             jobs from a capture (setup only)
+ *     difficulty D            set_difficulty sent with the next job
+ *     interval MS             a job every MS, 0 to stop
+ *     clean-every N           number the jobs, every Nth one clean
+ *     drop-every MS           disconnect all miners every MS, 0 to stop
+ *     notify | clean          one job now, clean or not
+ *     disconnect              drop all miners now
+ *     silent|reject|ignore|stall on|off
+ *     exit
+ *
+ * A command prefixed with "@MS " runs MS milliseconds after start, the
+ * others at start. Usage: pdqmockpool [-e COMMAND]... [SCENARIO]
+ *
+ * The exit status is 2 if any command was refused.
+ */
+
+#include "fake_pool.h"
+#include "linux_capture.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MOCK_MAX_STEPS      256
+#define MOCK_LINE_LEN       512
+#define MOCK_STATS_MS       10000
+
+typedef struct
+{
+    uint64_t AtMs;
+    int      Order;                 /* Keeps same-time steps in file order */
+    char     Command[MOCK_LINE_LEN];
+} MockStep_t;
+
+static MockStep_t            s_Steps[MOCK_MAX_STEPS];
+static int                   s_StepCount = 0;
+static PdqFakePool_t         s_Pool;
+static PdqCaptureLog_t       s_Capture;
+static uint16_t              s_Port = 3333;
+static int                   s_BadSteps = 0;
+static volatile sig_atomic_t s_Stop = 0;
+
+static void OnSignal(int Sig)
+{
+    (void)Sig;
+    s_Stop = 1;
+}
+
+static uint64_t GetMillis(void)
+{
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000 + (uint64_t)Ts.tv_nsec / 1000000;
+}
+
+static void SleepMs(uint32_t Ms)
+{
+    struct timespec Ts = {Ms / 1000, (long)(Ms % 1000) * 1000000L};
+    nanosleep(&Ts, NULL);
+}
+
+static bool AddStep(const char* p_Line)
+{
+    while (*p_Line == ' ' || *p_Line == '\t') p_Line++;
+    size_t Len = strcspn(p_Line, "\r\n#");
+    while (Len > 0 && (p_Line[Len - 1] == ' ' || p_Line[Len - 1] == '\t')) Len--;
+    if (Len == 0) return true;
+    if (s_StepCount == MOCK_MAX_STEPS || Len >= MOCK_LINE_LEN) {
+        fprintf(stderr, "[MOCK] Scenario too long at \"%.*s\"\n", (int)Len, p_Line);
+        return false;
+    }
+
+    MockStep_t* p_Step = &s_Steps[s_StepCount];
+    p_Step->AtMs = 0;
+    p_Step->Order = s_StepCount;
+    if (*p_Line == '@') {
+        char* p_End;
+        p_Step->AtMs = strtoull(p_Line + 1, &p_End, 10);
+        if (p_End == p_Line + 1 || *p_End != ' ') {
+            fprintf(stderr, "[MOCK] Bad time in \"%.*s\"\n", (int)Len, p_Line);
+            return false;
+        }
+        while (*p_End == ' ') p_End++;
+        Len -= (size_t)(p_End - p_Line);
+        p_Line = p_End;
+    }
+    memcpy(p_Step->Command, p_Line, Len);
+    p_Step->Command[Len] = '\0';
+    s_StepCount++;
+    return true;
+}
+
+static bool LoadScenario(const char* p_Path)
+{
+    FILE* p_File = strcmp(p_Path, "-") == 0 ? stdin : fopen(p_Path, "r");
+    if (p_File == NULL) {
+        perror(p_Path);
+        return false;
+    }
+    char Line[MOCK_LINE_LEN];
+    bool Ok = true;
+    while (Ok && fgets(Line, sizeof(Line), p_File)) Ok = AddStep(Line);
+    if (p_File != stdin) fclose(p_File);
+    return Ok;
+}
+
+static int CompareSteps(const void* p_A, const void* p_B)
+{
+    const MockStep_t* A = (const MockStep_t*)p_A;
+    const MockStep_t* B = (const MockStep_t*)p_B;
+    if (A->AtMs != B->AtMs) return A->AtMs < B->AtMs ? -1 : 1;
+    return A->Order - B->Order;
+}
+
+static bool ParseSwitch(const char* p_Arg, atomic_int* p_Knob)
+{
+    if (strcmp(p_Arg, "on") == 0) {
+        atomic_store(p_Knob, 1);
+    } else if (strcmp(p_Arg, "off") == 0) {
+        atomic_store(p_Knob, 0);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool SetupReplay(char* p_Args)
+{
+    char* p_Save = NULL;
+    char* p_File = strtok_r(p_Args, " ", &p_Save);
+    if (p_File == NULL) return false;
+    if (PdqCaptureLoad(&s_Capture, p_File) != PdqOk) {
+        fprintf(stderr, "[MOCK] Cannot load capture %s\n", p_File);
+        return false;
+    }
+    s_Pool.p_Replay = &s_Capture;
+    for (char* p_Word; (p_Word = strtok_r(NULL, " ", &p_Save)) != NULL;) {
+        if (strcmp(p_Word, "loop") == 0) {
+            s_Pool.ReplayLoop = true;
+        } else if (strcmp(p_Word, "stream") == 0 && (p_Word = strtok_r(NULL, " ", &p_Save)) != NULL) {
+            s_Pool.ReplayStream = (uint8_t)atoi(p_Word);
+        } else if (strcmp(p_Word, "speed") == 0 && (p_Word = strtok_r(NULL, " ", &p_Save)) != NULL) {
+            s_Pool.ReplaySpeed = (uint32_t)atoi(p_Word);
+        } else {
+            return false;
+        }
+    }
+    printf("[MOCK] Replaying %s: %zu lines, %d streams\n", p_File, s_Capture.Count, s_Capture.StreamCount);
+    return true;
+}
+
+static bool IsSetup(const char* p_Command)
+{
+    return strncmp(p_Command, "port ", 5) == 0 || strncmp(p_Command, "replay ", 7) == 0;
+}
+
+/* Runs one command; setup commands only before the pool starts */
+static bool RunCommand(char* p_Command, bool Started)
+{
+    char* p_Arg = strchr(p_Command, ' ');
+    if (p_Arg != NULL) {
+        *p_Arg++ = '\0';
+        while (*p_Arg == ' ') p_Arg++;
+    } else {
+        p_Arg = p_Command + strlen(p_Command);
+    }
+
+    if (strcmp(p_Command, "port") == 0) {
+        long Port = strtol(p_Arg, NULL, 10);
+        if (Started || Port < 0 || Port > 65535) return false;
+        s_Port = (uint16_t)Port;
+    } else if (strcmp(p_Command, "replay") == 0) {
+        return !Started && SetupReplay(p_Arg);
+    } else if (strcmp(p_Command, "difficulty") == 0) {
+        double Difficulty = atof(p_Arg);
+        if (Difficulty <= 0.0 || Difficulty > 4000000.0) return false;
+        atomic_store(&s_Pool.DifficultyMilli, (unsigned)(Difficulty * 1000.0 + 0.5));
+    } else if (strcmp(p_Command, "interval") == 0) {
+        atomic_store(&s_Pool.NotifyIntervalMs, (unsigned)strtoul(p_Arg, NULL, 10));
+    } else if (strcmp(p_Command, "clean-every") == 0) {
+        atomic_store(&s_Pool.CleanEvery, (unsigned)strtoul(p_Arg, NULL, 10));
+    } else if (strcmp(p_Command, "drop-every") == 0) {
+        atomic_store(&s_Pool.DropEveryMs, (unsigned)strtoul(p_Arg, NULL, 10));
+    } else if (strcmp(p_Command, "notify") == 0) {
+        atomic_store(&s_Pool.NotifyNow, 1);
+    } else if (strcmp(p_Command, "clean") == 0) {
+        atomic_store(&s_Pool.CleanNow, 1);
+    } else if (strcmp(p_Command, "disconnect") == 0) {
+        atomic_store(&s_Pool.DropClients, 1);
+    } else if (strcmp(p_Command, "silent") == 0) {
+        return ParseSwitch(p_Arg, &s_Pool.Silent);
+    } else if (strcmp(p_Command, "reject") == 0) {
+        return ParseSwitch(p_Arg, &s_Pool.RejectSubmits);
+    } else if (strcmp(p_Command, "ignore") == 0) {
+        return ParseSwitch(p_Arg, &s_Pool.IgnoreSubmits);
+    } else if (strcmp(p_Command, "stall") == 0) {
+        return ParseSwitch(p_Arg, &s_Pool.Stalled);
+    } else if (strcmp(p_Command, "exit") == 0) {
+        s_Stop = 1;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool RunStep(int Index, bool Started)
+{
+    char Command[MOCK_LINE_LEN];
+    memcpy(Command, s_Steps[Index].Command, sizeof(Command));
+    if (RunCommand(Command, Started)) return true;
+    fprintf(stderr, "[MOCK] Bad command \"%s\"\n", s_Steps[Index].Command);
+    s_BadSteps++;
+    return false;
+}
+
+static void PrintStats(uint64_t ElapsedMs)
+{
+    printf("[MOCK] %lus: %u connections, %u jobs (%u clean), %u submits, %u drops, %u replayed\n",
+           (unsigned long)(ElapsedMs / 1000),
+           atomic_load(&s_Pool.Connections), atomic_load(&s_Pool.Notifies),
+           atomic_load(&s_Pool.CleanJobs), atomic_load(&s_Pool.Submits),
+           atomic_load(&s_Pool.Drops), atomic_load(&s_Pool.Replayed));
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            if (!AddStep(argv[++i])) return 2;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Usage: %s [-e COMMAND]... [SCENARIO]\n", argv[0]);
+            return 2;
+        } else if (!LoadScenario(argv[i])) {
+            return 2;
+        }
+    }
+    qsort(s_Steps, (size_t)s_StepCount, sizeof(s_Steps[0]), CompareSteps);
+
+    /* Setup steps first, then the pool starts and the other untimed
+     * steps run before anyone is told it is listening */
+    for (int i = 0; i < s_StepCount && s_Steps[i].AtMs == 0; i++) {
+        if (IsSetup(s_Steps[i].Command) && !RunStep(i, false)) return 2;
+    }
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    signal(SIGPIPE, SIG_IGN);
+    if (PdqFakePoolStart(&s_Pool, s_Port) != PdqOk) {
+        fprintf(stderr, "[MOCK] Cannot listen on 127.0.0.1:%u\n", s_Port);
+        return 1;
+    }
+    int Next = 0;
+    for (; Next < s_StepCount && s_Steps[Next].AtMs == 0; Next++) {
+        if (!IsSetup(s_Steps[Next].Command) && !RunStep(Next, true)) {
+            PdqFakePoolStop(&s_Pool);
+            return 2;
+        }
+    }
+    printf("[MOCK] Listening on 127.0.0.1:%u\n", s_Pool.Port);
+    fflush(stdout);
+
+    uint64_t StartMs = GetMillis();
+    uint64_t StatsMs = StartMs;
+    while (!s_Stop) {
+        uint64_t Now = GetMillis();
+        for (; Next < s_StepCount && Now - StartMs >= s_Steps[Next].AtMs; Next++) {
+            printf("[MOCK] @%lu %s\n", (unsigned long)s_Steps[Next].AtMs, s_Steps[Next].Command);
+            RunStep(Next, true);
+        }
+        if (Now - StatsMs >= MOCK_STATS_MS) {
+            StatsMs = Now;
+            PrintStats(Now - StartMs);
+        }
+        SleepMs(10);
+    }
+
+    PdqFakePoolStop(&s_Pool);
+    PrintStats(GetMillis() - StartMs);
+    PdqCaptureFree(&s_Capture);
+    return s_BadSteps ? 2 : 0;
+}
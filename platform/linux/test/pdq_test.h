@@ -0,0 +1,124 @@
+/**
+ * @file pdq_test.h
+ * @brief Minimal Unity-compatible assertions for host-side tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * The firmware tests use Unity through PlatformIO. The Linux tests run
+ * under CTest without PlatformIO, so this header provides the subset of
+ * the Unity API they need with the same names and semantics.
+ */
+
+#ifndef PDQ_TEST_H
+#define PDQ_TEST_H
+
+#include "pdq_types.h"
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+
+static int     s_TestFailures = 0;
+static int     s_TestCount = 0;
+static jmp_buf s_TestAbort;
+
+#define PDQ_TEST_FAIL_(fmt, ...) do { \
+        printf("%s:%d: FAIL: " fmt "\n", __FILE__, __LINE__, __VA_ARGS__); \
+        longjmp(s_TestAbort, 1); \
+    } while (0)
+
+#define TEST_ASSERT_TRUE(c) do { \
+        if (!(c)) PDQ_TEST_FAIL_("%s", #c); \
+    } while (0)
+#define TEST_ASSERT_FALSE(c) TEST_ASSERT_TRUE(!(c))
+#define TEST_ASSERT_NULL(p)     TEST_ASSERT_TRUE((p) == NULL)
+#define TEST_ASSERT_NOT_NULL(p) TEST_ASSERT_TRUE((p) != NULL)
+#define TEST_ASSERT_TRUE_MESSAGE(c, msg) do { \
+        if (!(c)) PDQ_TEST_FAIL_("%s (%s)", #c, msg); \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_INT(e, a) do { \
+        long long e_ = (long long)(e), a_ = (long long)(a); \
+        if (e_ != a_) PDQ_TEST_FAIL_("%s: expected %lld, got %lld", #a, e_, a_); \
+    } while (0)
+#define TEST_ASSERT_EQUAL_INT32(e, a)  TEST_ASSERT_EQUAL_INT(e, a)
+#define TEST_ASSERT_EQUAL_UINT32(e, a) TEST_ASSERT_EQUAL_INT(e, a)
+
+#define TEST_ASSERT_EQUAL_HEX32(e, a) do { \
+        unsigned long e_ = (unsigned long)(e), a_ = (unsigned long)(a); \
+        if (e_ != a_) PDQ_TEST_FAIL_("%s: expected 0x%08lX, got 0x%08lX", #a, e_, a_); \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_STRING(e, a) do { \
+        const char* e_ = (e); const char* a_ = (a); \
+        if (strcmp(e_, a_) != 0) PDQ_TEST_FAIL_("%s: expected \"%s\", got \"%s\"", #a, e_, a_); \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_MEMORY(e, a, n) do { \
+        if (memcmp((e), (a), (n)) != 0) PDQ_TEST_FAIL_("%s: memory differs", #a); \
+    } while (0)
+
+#define TEST_ASSERT_DOUBLE_WITHIN(d, e, a) do { \
+        double e_ = (e), a_ = (a); \
+        if (a_ < e_ - (d) || a_ > e_ + (d)) PDQ_TEST_FAIL_("%s: expected %g, got %g", #a, e_, a_); \
+    } while (0)
+
+/* Clock for tests that poll sockets and threads until a deadline */
+static inline uint64_t GetMillis(void)
+{
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000 + (uint64_t)Ts.tv_nsec / 1000000;
+}
+
+static inline void SleepMs(uint32_t Ms)
+{
+    struct timespec Ts = {Ms / 1000, (long)(Ms % 1000) * 1000000L};
+    nanosleep(&Ts, NULL);
+}
+
+/* What a client's submit callback last reported. Register
+ * PdqTestOnSubmit with a PdqTestSubmits_t as its argument. */
+typedef struct {
+    PdqSubmitResult_t LastResult;
+    int32_t           LastCode;
+    uint32_t          Callbacks;
+} PdqTestSubmits_t;
+
+static inline void PdqTestSubmitsReset(PdqTestSubmits_t* p_Submits)
+{
+    p_Submits->LastResult = PdqSubmitTimedOut;
+    p_Submits->LastCode = -1;
+    p_Submits->Callbacks = 0;
+}
+
+static inline void PdqTestOnSubmit(void* p_Arg, PdqSubmitResult_t Result, int32_t ErrorCode, uint32_t LatencyMs)
+{
+    PdqTestSubmits_t* p_Submits = (PdqTestSubmits_t*)p_Arg;
+    (void)LatencyMs;
+    p_Submits->LastResult = Result;
+    p_Submits->LastCode = ErrorCode;
+    p_Submits->Callbacks++;
+}
+
+void setUp(void);
+void tearDown(void);
+
+#define UNITY_BEGIN() (s_TestFailures = 0, s_TestCount = 0)
+#define UNITY_END()   (printf("\n%d Tests %d Failures\n", s_TestCount, s_TestFailures), \
+                       s_TestFailures ? 1 : 0)
+
+#define RUN_TEST(fn) do { \
+        s_TestCount++; \
+        setUp(); \
+        if (setjmp(s_TestAbort) == 0) { \
+            fn(); \
+            printf("%s: PASS\n", #fn); \
+        } else { \
+            s_TestFailures++; \
+            printf("%s: FAIL\n", #fn); \
+        } \
+        tearDown(); \
+    } while (0)
+
+#endif
@@ -0,0 +1,261 @@
+/**
+ * @file test_capture.c
+ * @brief Session capture, and the fake pool's job numbering, disconnects and replay
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "fake_pool.h"
+#include "linux_capture.h"
+#include "stratum/stratum_client.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_WAIT_MS    5000
+
+static PdqFakePool_t       s_Pool;
+static PdqStratumContext_t s_Ctx;
+static PdqCaptureLog_t     s_Log;
+static char                s_Path[64];
+
+static void WriteFile(const char* p_Text)
+{
+    FILE* p_File = fopen(s_Path, "w");
+    TEST_ASSERT_NOT_NULL(p_File);
+    fputs(p_Text, p_File);
+    fclose(p_File);
+}
+
+/* Connect and run the handshake up to the first job */
+static bool RunHandshake(void)
+{
+    return PdqFakePoolHandshake(&s_Pool, &s_Ctx, StratumStateReady, TEST_WAIT_MS);
+}
+
+/* Process until a job other than p_JobId arrives or the session closes */
+static bool RunUntilJobChanges(const char* p_JobId)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && PdqStratumCtxIsConnected(&s_Ctx)) {
+        PdqStratumCtxProcess(&s_Ctx);
+        if (strcmp(s_Ctx.CurrentJob.JobId, p_JobId) != 0) return true;
+        SleepMs(2);
+    }
+    return false;
+}
+
+static PdqCaptureWriter_t s_Writer;
+
+static void OnLine(void* p_Arg, bool Outbound, const char* p_Line, size_t Len)
+{
+    PdqCaptureWrite(&s_Writer, (int)(intptr_t)p_Arg, Outbound, p_Line, Len, GetMillis());
+}
+
+void setUp(void)
+{
+    memset(&s_Pool, 0, sizeof(s_Pool));
+    memset(&s_Log, 0, sizeof(s_Log));
+    PdqStratumCtxInit(&s_Ctx);
+    snprintf(s_Path, sizeof(s_Path), "/tmp/pdq_capture_XXXXXX");
+    int Fd = mkstemp(s_Path);
+    TEST_ASSERT_TRUE(Fd >= 0);
+    close(Fd);
+}
+
+void tearDown(void)
+{
+    PdqStratumCtxRelease(&s_Ctx);
+    PdqFakePoolStop(&s_Pool);
+    PdqCaptureClose(&s_Writer);
+    PdqCaptureFree(&s_Log);
+    unlink(s_Path);
+}
+
+void Test_Capture_WriteThenLoad_RoundTrips(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqCaptureOpen(&s_Writer, s_Path));
+    TEST_ASSERT_EQUAL_INT(1, PdqCaptureAddStream(&s_Writer, "pool.example.com:3333"));
+    TEST_ASSERT_EQUAL_INT(2, PdqCaptureAddStream(&s_Writer, "backup.example.com:3333"));
+    const char* p_Sub = "{\"id\":1,\"method\":\"mining.subscribe\",\"params\":[]} trailing";
+    PdqCaptureWrite(&s_Writer, 1, true, p_Sub, 48, 1000);
+    PdqCaptureWrite(&s_Writer, 2, false, "{\"id\":null}", 11, 1250);
+    PdqCaptureWrite(&s_Writer, 1, false, "{\"id\":1}", 8, 1250);
+    TEST_ASSERT_EQUAL_UINT32(3, s_Writer.Lines);
+    PdqCaptureClose(&s_Writer);
+
+    /* A stray line does not spoil the rest */
+    FILE* p_File = fopen(s_Path, "a");
+    fputs("+5 x< {}\n+7 1< {\"id\":2}\n", p_File);
+    fclose(p_File);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqCaptureLoad(&s_Log, s_Path));
+    TEST_ASSERT_EQUAL_INT(4, (int)s_Log.Count);
+    TEST_ASSERT_EQUAL_INT(2, s_Log.StreamCount);
+    TEST_ASSERT_EQUAL_UINT32(1, s_Log.Skipped);
+
+    TEST_ASSERT_EQUAL_STRING("{\"id\":1,\"method\":\"mining.subscribe\",\"params\":[]}", s_Log.p_Entries[0].p_Line);
+    TEST_ASSERT_TRUE(s_Log.p_Entries[0].Outbound);
+    TEST_ASSERT_EQUAL_UINT32(0, s_Log.p_Entries[0].DelayMs);
+    TEST_ASSERT_EQUAL_INT(2, s_Log.p_Entries[1].Stream);
+    TEST_ASSERT_FALSE(s_Log.p_Entries[1].Outbound);
+    TEST_ASSERT_EQUAL_UINT32(250, s_Log.p_Entries[1].DelayMs);
+    TEST_ASSERT_EQUAL_UINT32(0, s_Log.p_Entries[2].DelayMs);
+    TEST_ASSERT_EQUAL_UINT32(7, s_Log.p_Entries[3].DelayMs);
+}
+
+void Test_Capture_Load_RefusesOtherFiles(void)
+{
+    WriteFile("{\"id\":1,\"result\":true}\n");
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqCaptureLoad(&s_Log, s_Path));
+    TEST_ASSERT_NULL(s_Log.p_Entries);
+    WriteFile("");
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqCaptureLoad(&s_Log, s_Path));
+}
+
+void Test_Capture_Resume_AppendsAndKeepsStreams(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqCaptureOpen(&s_Writer, s_Path));
+    TEST_ASSERT_TRUE(fcntl(fileno(s_Writer.p_File), F_GETFD) & FD_CLOEXEC);
+    TEST_ASSERT_EQUAL_INT(1, PdqCaptureAddStream(&s_Writer, "pool.example.com:3333"));
+    TEST_ASSERT_EQUAL_INT(2, PdqCaptureAddStream(&s_Writer, "backup.example.com:3333"));
+    PdqCaptureWrite(&s_Writer, 1, true, "{\"id\":1}", 8, 1000);
+    PdqCaptureWrite(&s_Writer, 2, true, "{\"id\":2}", 8, 1000);
+    PdqCaptureClose(&s_Writer);
+
+    /* What the process after an upgrade does: same pools, possibly in
+     * another order, and one new */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqCaptureResume(&s_Writer, s_Path));
+    TEST_ASSERT_TRUE(fcntl(fileno(s_Writer.p_File), F_GETFD) & FD_CLOEXEC);
+    TEST_ASSERT_EQUAL_INT(2, PdqCaptureAddStream(&s_Writer, "backup.example.com:3333"));
+    TEST_ASSERT_EQUAL_INT(1, PdqCaptureAddStream(&s_Writer, "pool.example.com:3333"));
+    TEST_ASSERT_EQUAL_INT(3, PdqCaptureAddStream(&s_Writer, "pool.example.com:3333"));
+    PdqCaptureWrite(&s_Writer, 1, false, "{\"id\":1}", 8, 1100);
+    PdqCaptureWrite(&s_Writer, 3, true, "{\"id\":3}", 8, 1100);
+    PdqCaptureClose(&s_Writer);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqCaptureLoad(&s_Log, s_Path));
+    TEST_ASSERT_EQUAL_INT(4, (int)s_Log.Count);
+    TEST_ASSERT_EQUAL_INT(3, s_Log.StreamCount);
+    TEST_ASSERT_EQUAL_INT(1, s_Log.p_Entries[2].Stream);
+    TEST_ASSERT_FALSE(s_Log.p_Entries[2].Outbound);
+    TEST_ASSERT_EQUAL_INT(3, s_Log.p_Entries[3].Stream);
+
+    /* Never appends to something else */
+    PdqCaptureFree(&s_Log);
+    WriteFile("{\"id\":1,\"result\":true}\n");
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqCaptureResume(&s_Writer, s_Path));
+    TEST_ASSERT_NULL(s_Writer.p_File);
+}
+
+void Test_Capture_LineCallback_RecordsTheSession(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqCaptureOpen(&s_Writer, s_Path));
+    int Stream = PdqCaptureAddStream(&s_Writer, "127.0.0.1");
+    PdqStratumCtxSetLineCallback(&s_Ctx, OnLine, (void*)(intptr_t)Stream);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    PdqCaptureClose(&s_Writer);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqCaptureLoad(&s_Log, s_Path));
+    TEST_ASSERT_TRUE(s_Log.Count >= 5);
+    TEST_ASSERT_TRUE(s_Log.p_Entries[0].Outbound);
+    TEST_ASSERT_NOT_NULL(strstr(s_Log.p_Entries[0].p_Line, "mining.subscribe"));
+    const PdqCaptureEntry_t* p_Last = &s_Log.p_Entries[s_Log.Count - 1];
+    TEST_ASSERT_FALSE(p_Last->Outbound);
+    TEST_ASSERT_NOT_NULL(strstr(p_Last->p_Line, "\"1eaa720\""));
+}
+
+void Test_FakePool_CleanEvery_NumbersJobsAndCleansSome(void)
+{
+    atomic_store(&s_Pool.CleanEvery, 2);
+    atomic_store(&s_Pool.DifficultyMilli, 4000);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, 4.0, PdqStratumCtxGetDifficulty(&s_Ctx));
+
+    /* Job 1 is not clean and keeps the first job alive; job 2 is */
+    atomic_store(&s_Pool.NotifyNow, 1);
+    TEST_ASSERT_TRUE(RunUntilJobChanges("1eaa720"));
+    TEST_ASSERT_EQUAL_STRING("1", s_Ctx.CurrentJob.JobId);
+    TEST_ASSERT_FALSE(s_Ctx.CurrentJob.CleanJobs);
+    TEST_ASSERT_TRUE(PdqStratumCtxIsJobActive(&s_Ctx, "1eaa720"));
+
+    atomic_store(&s_Pool.NotifyNow, 1);
+    TEST_ASSERT_TRUE(RunUntilJobChanges("1"));
+    TEST_ASSERT_EQUAL_STRING("2", s_Ctx.CurrentJob.JobId);
+    TEST_ASSERT_TRUE(s_Ctx.CurrentJob.CleanJobs);
+    TEST_ASSERT_FALSE(PdqStratumCtxIsJobActive(&s_Ctx, "1"));
+    TEST_ASSERT_TRUE(atomic_load(&s_Pool.CleanJobs) >= 1);
+}
+
+void Test_FakePool_DropEvery_Disconnects(void)
+{
+    atomic_store(&s_Pool.DropEveryMs, 300);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && PdqStratumCtxIsConnected(&s_Ctx)) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(5);
+    }
+    TEST_ASSERT_FALSE(PdqStratumCtxIsConnected(&s_Ctx));
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Pool.Drops));
+}
+
+/* Two recorded sessions on stream 1, with a stream 2 that is not replayed */
+static const char* s_Recorded =
+    "# pdqcap 1\n"
+    "# stream 1 pool.example.com:3333\n"
+    "# stream 2 backup.example.com:3333\n"
+    "+0 1> {\"id\":1,\"method\":\"mining.subscribe\",\"params\":[\"PDQminer/1.0\"]}\n"
+    "+20 1< {\"id\":1,\"result\":[[],\"2e1a5ba1\",4],\"error\":null}\n"
+    "+5 1< {\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[2]}\n"
+    "+1 1< {\"id\":null,\"method\":\"mining.notify\",\"params\":[\"r1\","
+    "\"770fd8b322f461fc7eb91584447854b4212f96070001d3360000000000000000\",\"01\",\"02\",[],"
+    "\"20000000\",\"1701f303\",\"69a20ee6\",true]}\n"
+    "+50 2< {\"id\":null,\"method\":\"mining.notify\",\"params\":[\"other\"]}\n"
+    "+50 1< {\"id\":null,\"method\":\"client.reconnect\",\"params\":[]}\n"
+    "+10 1> {\"id\":3,\"method\":\"mining.subscribe\",\"params\":[\"PDQminer/1.0\"]}\n"
+    "+20 1< {\"id\":null,\"method\":\"mining.notify\",\"params\":[\"r2\","
+    "\"770fd8b322f461fc7eb91584447854b4212f96070001d3360000000000000000\",\"01\",\"02\",[],"
+    "\"20000000\",\"1701f303\",\"69a20ee6\",true]}\n";
+
+void Test_FakePool_Replay_SendsTheRecordedJobsAndReconnects(void)
+{
+    WriteFile(s_Recorded);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqCaptureLoad(&s_Log, s_Path));
+    s_Pool.p_Replay = &s_Log;
+    s_Pool.ReplaySpeed = 2;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+
+    TEST_ASSERT_TRUE(RunHandshake());
+    TEST_ASSERT_EQUAL_STRING("r1", s_Ctx.CurrentJob.JobId);
+    TEST_ASSERT_DOUBLE_WITHIN(0.001, 2.0, PdqStratumCtxGetDifficulty(&s_Ctx));
+
+    /* The recorded miner reconnected, so the pool drops this one; the
+     * next connection carries on where the recording did */
+    TEST_ASSERT_FALSE(RunUntilJobChanges("r1"));
+    TEST_ASSERT_FALSE(PdqStratumCtxIsConnected(&s_Ctx));
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Pool.Drops));
+
+    TEST_ASSERT_TRUE(RunHandshake());
+    TEST_ASSERT_EQUAL_STRING("r2", s_Ctx.CurrentJob.JobId);
+    TEST_ASSERT_EQUAL_UINT32(3, atomic_load(&s_Pool.Replayed));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_Capture_WriteThenLoad_RoundTrips);
+    RUN_TEST(Test_Capture_Load_RefusesOtherFiles);
+    RUN_TEST(Test_Capture_Resume_AppendsAndKeepsStreams);
+    RUN_TEST(Test_Capture_LineCallback_RecordsTheSession);
+    RUN_TEST(Test_FakePool_CleanEvery_NumbersJobsAndCleansSome);
+    RUN_TEST(Test_FakePool_DropEvery_Disconnects);
+    RUN_TEST(Test_FakePool_Replay_SendsTheRecordedJobsAndReconnects);
+    return UNITY_END();
+}
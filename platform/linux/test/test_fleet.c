@@ -0,0 +1,212 @@
+/**
+ * @file test_fleet.c
+ * @brief Virtual miner fleet tests against the fake pool
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "fake_pool.h"
+#include "linux_event.h"
+#include "linux_fleet.h"
+#include "stratum/stratum_client.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+
+#define TEST_WAIT_MS    5000
+#define TEST_MINERS     6       /* Within the fake pool's client limit */
+
+static PdqFakePool_t    s_Pool;
+static PdqFleetConfig_t s_Config;
+
+static PdqFleetStats_t Stats(void)
+{
+    PdqFleetStats_t Result;
+    PdqFleetGetStats(&Result);
+    return Result;
+}
+
+static bool PumpUntilReady(uint32_t Ready)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && Stats().Ready < Ready) PdqEventRunOnce(5);
+    return Stats().Ready >= Ready;
+}
+
+static bool PumpUntilAnswered(uint64_t Answers)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && Stats().Accepted + Stats().Rejected < Answers) PdqEventRunOnce(5);
+    return Stats().Accepted + Stats().Rejected >= Answers;
+}
+
+void setUp(void)
+{
+    memset(&s_Pool, 0, sizeof(s_Pool));
+    PdqStratumFlushDnsCache();
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+
+    memset(&s_Config, 0, sizeof(s_Config));
+    s_Config.p_Host = "127.0.0.1";
+    s_Config.Port = s_Pool.Port;
+    s_Config.Miners = TEST_MINERS;
+    s_Config.ShareIntervalMs = 20;
+    s_Config.p_User = "bc1qfleet";
+    s_Config.Seed = 1;
+}
+
+void tearDown(void)
+{
+    PdqFleetStop();
+    PdqFakePoolStop(&s_Pool);
+}
+
+void Test_Fleet_Start_RejectsBadConfig(void)
+{
+    PdqFleetConfig_t Config = s_Config;
+    Config.Miners = 0;
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqFleetStart(&Config));
+    Config.Miners = PDQ_FLEET_MAX_MINERS + 1;
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqFleetStart(&Config));
+    Config = s_Config;
+    Config.ShareIntervalMs = 0;
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqFleetStart(&Config));
+    Config = s_Config;
+    Config.Port = 0;
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqFleetStart(&Config));
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFleetStart(&s_Config));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqFleetStart(&s_Config));
+}
+
+void Test_Fleet_Miners_HandshakeAndSubmit(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFleetStart(&s_Config));
+    TEST_ASSERT_TRUE(PumpUntilReady(TEST_MINERS));
+    TEST_ASSERT_TRUE(PumpUntilAnswered(4 * TEST_MINERS));
+
+    PdqFleetStats_t Result = Stats();
+    TEST_ASSERT_EQUAL_UINT32(TEST_MINERS, Result.Started);
+    TEST_ASSERT_EQUAL_UINT32(TEST_MINERS, (uint32_t)Result.Handshakes);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)Result.Failures);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)Result.Rejected);
+    TEST_ASSERT_EQUAL_UINT32(TEST_MINERS, atomic_load(&s_Pool.Authorizations));
+    TEST_ASSERT_TRUE(atomic_load(&s_Pool.Submits) >= Result.Accepted);
+
+    PdqFleetLatency_t Submit, Handshake;
+    PdqFleetGetLatency(&Submit, &Handshake, true);
+    TEST_ASSERT_EQUAL_UINT32(TEST_MINERS, (uint32_t)Handshake.Count);
+    TEST_ASSERT_TRUE(Submit.Count >= 4 * TEST_MINERS);
+    TEST_ASSERT_TRUE(Submit.P50Ms <= Submit.P99Ms && Submit.P99Ms <= Submit.MaxMs);
+
+    /* The interval copy starts over, the whole-run one does not */
+    PdqFleetGetLatency(&Submit, &Handshake, true);
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)Handshake.Count);
+    PdqFleetGetLatency(&Submit, &Handshake, false);
+    TEST_ASSERT_EQUAL_UINT32(TEST_MINERS, (uint32_t)Handshake.Count);
+}
+
+void Test_Fleet_Ramp_PacesConnections(void)
+{
+    s_Config.RampPerSec = 20;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFleetStart(&s_Config));
+
+    uint64_t Until = GetMillis() + 100;
+    while (GetMillis() < Until) PdqEventRunOnce(5);
+    TEST_ASSERT_TRUE(Stats().Started < TEST_MINERS);
+
+    TEST_ASSERT_TRUE(PumpUntilReady(TEST_MINERS));
+    TEST_ASSERT_EQUAL_UINT32(TEST_MINERS, Stats().Started);
+}
+
+void Test_Fleet_Drop_Reconnects(void)
+{
+    s_Config.ReconnectMs = 50;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFleetStart(&s_Config));
+    TEST_ASSERT_TRUE(PumpUntilReady(TEST_MINERS));
+
+    atomic_store(&s_Pool.DropClients, 1);
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && Stats().Handshakes < 2 * TEST_MINERS) PdqEventRunOnce(5);
+
+    PdqFleetStats_t Result = Stats();
+    TEST_ASSERT_EQUAL_UINT32(TEST_MINERS, (uint32_t)Result.Drops);
+    TEST_ASSERT_EQUAL_UINT32(2 * TEST_MINERS, (uint32_t)Result.Handshakes);
+    TEST_ASSERT_EQUAL_UINT32(TEST_MINERS, Result.Ready);
+}
+
+void Test_Fleet_RejectedShares_Counted(void)
+{
+    atomic_store(&s_Pool.RejectSubmits, 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFleetStart(&s_Config));
+    TEST_ASSERT_TRUE(PumpUntilReady(TEST_MINERS));
+    TEST_ASSERT_TRUE(PumpUntilAnswered(TEST_MINERS));
+
+    PdqFleetStats_t Result = Stats();
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)Result.Accepted);
+    TEST_ASSERT_TRUE(Result.Rejected >= TEST_MINERS);
+}
+
+void Test_Fleet_HashRate_FollowsServerDifficulty(void)
+{
+    /* At difficulty 0.001 this rate is a share every 50 ms; at the
+     * client's floor of 1 it would be one every 50 s */
+    atomic_store(&s_Pool.DifficultyMilli, 1);
+    s_Config.ShareIntervalMs = 0;
+    s_Config.HashRate = 0.001 * 4294967296.0 * 1000.0 / 50.0;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFleetStart(&s_Config));
+    TEST_ASSERT_TRUE(PumpUntilReady(TEST_MINERS));
+    TEST_ASSERT_TRUE(PumpUntilAnswered(2 * TEST_MINERS));
+}
+
+void Test_Fleet_SocketsPastFdSetSize_Mine(void)
+{
+    /* pdqfleet runs thousands of miners, so their sockets get numbers
+     * past FD_SETSIZE; hold the low ones so this fleet's do too */
+    struct rlimit Limit;
+    TEST_ASSERT_EQUAL_INT(0, getrlimit(RLIMIT_NOFILE, &Limit));
+    if (Limit.rlim_max != RLIM_INFINITY && Limit.rlim_max < FD_SETSIZE + 256) {
+        printf("  (skipped: open file limit %lu)\n", (unsigned long)Limit.rlim_max);
+        return;
+    }
+    Limit.rlim_cur = Limit.rlim_max;
+    TEST_ASSERT_EQUAL_INT(0, setrlimit(RLIMIT_NOFILE, &Limit));
+
+    static int Held[FD_SETSIZE + 64];
+    int HeldCount = 0;
+    int Null = open("/dev/null", O_RDONLY);
+    TEST_ASSERT_TRUE(Null >= 0);
+    while (HeldCount < FD_SETSIZE + 64) {
+        int Fd = dup(Null);
+        TEST_ASSERT_TRUE(Fd >= 0);
+        Held[HeldCount++] = Fd;
+        if (Fd >= FD_SETSIZE + 16) break;
+    }
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFleetStart(&s_Config));
+    TEST_ASSERT_TRUE(PumpUntilReady(TEST_MINERS));
+    TEST_ASSERT_TRUE(PumpUntilAnswered(TEST_MINERS));
+
+    PdqFleetStop();
+    for (int i = 0; i < HeldCount; i++) close(Held[i]);
+    close(Null);
+}
+
+int main(void)
+{
+    if (PdqEventLoopInit() != PdqOk) return 1;
+    UNITY_BEGIN();
+    RUN_TEST(Test_Fleet_Start_RejectsBadConfig);
+    RUN_TEST(Test_Fleet_Miners_HandshakeAndSubmit);
+    RUN_TEST(Test_Fleet_Ramp_PacesConnections);
+    RUN_TEST(Test_Fleet_Drop_Reconnects);
+    RUN_TEST(Test_Fleet_RejectedShares_Counted);
+    RUN_TEST(Test_Fleet_HashRate_FollowsServerDifficulty);
+    RUN_TEST(Test_Fleet_SocketsPastFdSetSize_Mine);
+    int Result = UNITY_END();
+    PdqEventLoopDestroy();
+    return Result;
+}
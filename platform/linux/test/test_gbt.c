@@ -0,0 +1,371 @@
+/**
+ * @file test_gbt.c
+ * @brief Solo mining tests: getblocktemplate work and submitblock against a mock node
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "fake_bitcoind.h"
+#include "linux_event.h"
+#include "linux_gbt.h"
+#include "core/sha256_engine.h"
+#include "core/target.h"
+#include <stdlib.h>
+
+#define TEST_WAIT_MS    5000
+#define TEST_PAYOUT     "bcrt1qzqg3yyc5z5tpwxqergd3c8g7ruszzg3r0asqxc"
+
+static const uint8_t s_PayoutScript[22] = {
+    0x00, 0x14, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+    0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23
+};
+
+static PdqFakeBitcoind_t s_Node;
+static PdqTestSubmits_t s_Submits;
+static uint32_t          s_Jobs;
+
+static void OnJob(void* p_Arg)
+{
+    (void)p_Arg;
+    s_Jobs++;
+}
+
+/* What main.c's event loop and stats tick would drive */
+static void Pump(void)
+{
+    PdqEventRunOnce(1);
+    PdqGbtTick(GetMillis());
+}
+
+static PdqError_t StartGbt(const char* p_Password)
+{
+    PdqGbtConfig_t Config;
+    memset(&Config, 0, sizeof(Config));
+    Config.p_Host = "127.0.0.1";
+    Config.Port = s_Node.Port;
+    Config.p_User = "pdq";
+    Config.p_Password = p_Password;
+    Config.p_PayoutAddress = TEST_PAYOUT;
+    return PdqGbtStart(&Config);
+}
+
+static bool PumpUntilJob(void)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && !PdqGbtHasNewJob()) Pump();
+    return PdqGbtHasNewJob();
+}
+
+static bool PumpUntilSubmitted(uint32_t Callbacks)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && s_Submits.Callbacks < Callbacks) Pump();
+    return s_Submits.Callbacks >= Callbacks;
+}
+
+/* A nonce whose header meets the job's (network) target */
+static void FindBlock(const PdqMiningJob_t* p_Job, PdqShareInfo_t* p_Share)
+{
+    uint32_t Hash[8];
+    uint32_t Nonce = 0;
+    for (;; Nonce++) {
+        PdqTargetHashJob(p_Job, Nonce, Hash);
+        if (PdqTargetCompare(Hash, p_Job->Target) <= 0) break;
+    }
+    memset(p_Share, 0, sizeof(*p_Share));
+    strcpy(p_Share->JobId, p_Job->JobId);
+    p_Share->Extranonce2 = p_Job->Extranonce2;
+    p_Share->Nonce = Nonce;
+    p_Share->NTime = p_Job->NTime;
+    p_Share->BlockCandidate = true;
+}
+
+static size_t FromHex(const char* p_Hex, uint8_t* p_Out, size_t Max)
+{
+    size_t Len = strlen(p_Hex) / 2;
+    if (Len > Max) return 0;
+    for (size_t i = 0; i < Len; i++) {
+        unsigned Byte;
+        if (sscanf(p_Hex + 2 * i, "%2x", &Byte) != 1) return 0;
+        p_Out[i] = (uint8_t)Byte;
+    }
+    return Len;
+}
+
+static uint32_t Le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint8_t s_Block[4096];
+
+void setUp(void)
+{
+    memset(&s_Node, 0, sizeof(s_Node));
+    s_Node.p_Auth = "pdq:secret";
+    PdqTestSubmitsReset(&s_Submits);
+    s_Jobs = 0;
+    PdqFakeBitcoindStart(&s_Node, 0);
+    PdqGbtSetCallbacks(OnJob, PdqTestOnSubmit, &s_Submits);
+}
+
+void tearDown(void)
+{
+    PdqGbtStop();
+    PdqFakeBitcoindStop(&s_Node);
+}
+
+void Test_Gbt_AddressToScript_AllStandardKinds(void)
+{
+    uint8_t Script[PDQ_GBT_SCRIPT_MAX];
+    uint8_t Expected[PDQ_GBT_SCRIPT_MAX];
+    size_t Len = 0;
+
+    /* BIP173 and BIP350 examples, plus the classic base58 ones */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtAddressToScript("BC1QW508D6QEJXTDG4Y5R3ZARVARY0C5XW7KV8F3T4", Script, &Len));
+    TEST_ASSERT_EQUAL_INT(22, (int)Len);
+    FromHex("0014751e76e8199196d454941c45d1b3a323f1433bd6", Expected, sizeof(Expected));
+    TEST_ASSERT_EQUAL_MEMORY(Expected, Script, 22);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtAddressToScript(
+        "bc1p0xlxvlhemja6c4dqv22uapctqupfhlxm9h8z3k2e72q4k9hcz7vqzk5jj0", Script, &Len));
+    TEST_ASSERT_EQUAL_INT(34, (int)Len);
+    FromHex("512079be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798", Expected, sizeof(Expected));
+    TEST_ASSERT_EQUAL_MEMORY(Expected, Script, 34);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtAddressToScript("1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVN2", Script, &Len));
+    TEST_ASSERT_EQUAL_INT(25, (int)Len);
+    FromHex("76a91477bff20c60e522dfaa3350c39b030a5d004e839a88ac", Expected, sizeof(Expected));
+    TEST_ASSERT_EQUAL_MEMORY(Expected, Script, 25);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtAddressToScript("3J98t1WpEZ73CNmQviecrnyiWrnqRhWNLy", Script, &Len));
+    TEST_ASSERT_EQUAL_INT(23, (int)Len);
+    FromHex("a914b472a266d0bd89c13706a4132ccfb16f7c3b9fcb87", Expected, sizeof(Expected));
+    TEST_ASSERT_EQUAL_MEMORY(Expected, Script, 23);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtAddressToScript(TEST_PAYOUT, Script, &Len));
+    TEST_ASSERT_EQUAL_INT(22, (int)Len);
+    TEST_ASSERT_EQUAL_MEMORY(s_PayoutScript, Script, 22);
+
+    /* Bad checksums, a v0 program with a bech32m checksum, mixed case */
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqGbtAddressToScript("1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVN3", Script, &Len));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqGbtAddressToScript("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kv8f3t5", Script, &Len));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqGbtAddressToScript("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7kemeawh", Script, &Len));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqGbtAddressToScript("bc1qw508d6qejxtdg4y5r3zarvary0c5xw7KV8F3T4", Script, &Len));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqGbtAddressToScript("", Script, &Len));
+}
+
+void Test_Gbt_Template_MinesAndSubmitsAValidBlock(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartGbt("secret"));
+    TEST_ASSERT_TRUE(PumpUntilJob());
+    TEST_ASSERT_TRUE(PdqGbtIsReady());
+    TEST_ASSERT_EQUAL_INT(1, (int)s_Jobs);
+
+    PdqMiningJob_t Job;
+    bool Clean = false;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtBuildNextJob(&Job, &Clean));
+    TEST_ASSERT_TRUE(Clean);
+    TEST_ASSERT_FALSE(PdqGbtHasNewJob());
+
+    /* Solo work: every share the engine reports is a block */
+    uint32_t NetworkTarget[8];
+    PdqTargetFromNBits(PDQ_FAKE_BITCOIND_BITS, NetworkTarget);
+    TEST_ASSERT_EQUAL_MEMORY(NetworkTarget, Job.NetworkTarget, sizeof(NetworkTarget));
+    TEST_ASSERT_EQUAL_MEMORY(NetworkTarget, Job.Target, sizeof(NetworkTarget));
+
+    PdqShareInfo_t Share;
+    FindBlock(&Job, &Share);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtSubmitBlock(&Share));
+    TEST_ASSERT_TRUE(PumpUntilSubmitted(1));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitAccepted, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_INT(1, (int)atomic_load(&s_Node.Submits));
+
+    /* Header: the share's nonce and time, and a hash under the target */
+    TEST_ASSERT_NOT_NULL(s_Node.p_LastBlock);
+    size_t Len = FromHex(s_Node.p_LastBlock, s_Block, sizeof(s_Block));
+    TEST_ASSERT_TRUE(Len > 81);
+    uint32_t Hash[8];
+    PdqTargetHashHeader(s_Block, Hash);
+    TEST_ASSERT_TRUE(PdqTargetCompare(Hash, NetworkTarget) <= 0);
+    TEST_ASSERT_EQUAL_HEX32(Share.NTime, Le32(s_Block + 68));
+    TEST_ASSERT_EQUAL_HEX32(Share.Nonce, Le32(s_Block + 76));
+    TEST_ASSERT_EQUAL_HEX32(PDQ_FAKE_BITCOIND_BITS, Le32(s_Block + 72));
+    TEST_ASSERT_EQUAL_INT(1 + PDQ_FAKE_BITCOIND_TXS, s_Block[80]);
+
+    /* Coinbase in witness form: BIP34 height, the payout, the commitment
+     * and the reserved value */
+    const uint8_t* p_Cb = s_Block + 81;
+    size_t Pos = 0;
+    TEST_ASSERT_EQUAL_HEX32(2, Le32(p_Cb));
+    TEST_ASSERT_EQUAL_INT(0x00, p_Cb[4]);
+    TEST_ASSERT_EQUAL_INT(0x01, p_Cb[5]);
+    Pos = 6 + 1 + 36;
+    uint8_t ScriptLen = p_Cb[Pos++];
+    TEST_ASSERT_TRUE(ScriptLen >= 2 && ScriptLen <= 100);
+    TEST_ASSERT_EQUAL_INT(0x01, p_Cb[Pos]);
+    TEST_ASSERT_EQUAL_INT(PDQ_FAKE_BITCOIND_HEIGHT, p_Cb[Pos + 1]);
+    Pos += ScriptLen + 4;
+    TEST_ASSERT_EQUAL_INT(2, p_Cb[Pos++]);
+    uint64_t Value = Le32(p_Cb + Pos) | ((uint64_t)Le32(p_Cb + Pos + 4) << 32);
+    TEST_ASSERT_TRUE(Value == PDQ_FAKE_BITCOIND_VALUE);
+    TEST_ASSERT_EQUAL_INT(22, p_Cb[Pos + 8]);
+    TEST_ASSERT_EQUAL_MEMORY(s_PayoutScript, p_Cb + Pos + 9, 22);
+    Pos += 8 + 1 + 22;
+    uint8_t Commitment[38];
+    FromHex(PDQ_FAKE_BITCOIND_COMMITMENT, Commitment, sizeof(Commitment));
+    TEST_ASSERT_EQUAL_INT(38, p_Cb[Pos + 8]);
+    TEST_ASSERT_EQUAL_MEMORY(Commitment, p_Cb + Pos + 9, 38);
+    Pos += 8 + 1 + 38;
+    size_t OutputsEnd = Pos;
+    static const uint8_t s_Reserved[34] = {0x01, 0x20};
+    TEST_ASSERT_EQUAL_MEMORY(s_Reserved, p_Cb + Pos, 34);
+    Pos += 34;
+    TEST_ASSERT_EQUAL_HEX32(0, Le32(p_Cb + Pos));
+    Pos += 4;
+
+    /* The node's transactions follow, unchanged */
+    const uint8_t* p_Txs = p_Cb + Pos;
+    TEST_ASSERT_EQUAL_INT((int)(Len - 81 - Pos), PDQ_FAKE_BITCOIND_TXS * PDQ_FAKE_BITCOIND_TX_BYTES);
+    for (int t = 0; t < PDQ_FAKE_BITCOIND_TXS; t++) {
+        uint8_t Tx[PDQ_FAKE_BITCOIND_TX_BYTES];
+        FromHex(s_Node.TxHex[t], Tx, sizeof(Tx));
+        TEST_ASSERT_EQUAL_MEMORY(Tx, p_Txs + t * PDQ_FAKE_BITCOIND_TX_BYTES, sizeof(Tx));
+    }
+
+    /* Merkle root over the coinbase txid (non-witness form) and the
+     * node's txids, computed the plain way */
+    uint8_t Leaves[8][32];
+    uint8_t Stripped[256];
+    size_t StrippedLen = 0;
+    memcpy(Stripped, p_Cb, 4);
+    memcpy(Stripped + 4, p_Cb + 6, OutputsEnd - 6);
+    StrippedLen = 4 + OutputsEnd - 6;
+    memset(Stripped + StrippedLen, 0, 4);
+    StrippedLen += 4;
+    PdqSha256d(Stripped, StrippedLen, Leaves[0]);
+    for (int t = 0; t < PDQ_FAKE_BITCOIND_TXS; t++) {
+        uint8_t Id[32];
+        FromHex(s_Node.TxId[t], Id, sizeof(Id));
+        for (int i = 0; i < 32; i++) Leaves[1 + t][i] = Id[31 - i];
+    }
+    int Count = 1 + PDQ_FAKE_BITCOIND_TXS;
+    while (Count > 1) {
+        if (Count & 1) memcpy(Leaves[Count], Leaves[Count - 1], 32);
+        for (int i = 0; i < (Count + 1) / 2; i++) {
+            uint8_t Pair[64];
+            memcpy(Pair, Leaves[2 * i], 32);
+            memcpy(Pair + 32, Leaves[2 * i + 1], 32);
+            PdqSha256d(Pair, 64, Leaves[i]);
+        }
+        Count = (Count + 1) / 2;
+    }
+    TEST_ASSERT_EQUAL_MEMORY(Leaves[0], s_Block + 36, 32);
+
+    PdqGbtStats_t Stats;
+    PdqGbtGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(1, (int)Stats.BlocksSubmitted);
+    TEST_ASSERT_EQUAL_INT(1, (int)Stats.BlocksAccepted);
+    TEST_ASSERT_EQUAL_INT(PDQ_FAKE_BITCOIND_TXS, (int)Stats.Transactions);
+}
+
+void Test_Gbt_LongPoll_NewTipCleansWork(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartGbt("secret"));
+    TEST_ASSERT_TRUE(PumpUntilJob());
+    PdqMiningJob_t Old, Job;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtBuildNextJob(&Old, NULL));
+
+    /* A refresh of the same template is new work but not clean */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtBuildNextJob(&Job, NULL));
+    TEST_ASSERT_EQUAL_STRING(Old.JobId, Job.JobId);
+    TEST_ASSERT_TRUE(Job.Extranonce2 == Old.Extranonce2 + 1);
+    TEST_ASSERT_TRUE(memcmp(Job.Midstate, Old.Midstate, 32) != 0);
+
+    /* The held longpoll answers as soon as the tip moves */
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && atomic_load(&s_Node.Waiting) < 1) Pump();
+    atomic_store(&s_Node.NewBlock, 1);
+    TEST_ASSERT_TRUE(PumpUntilJob());
+    bool Clean = false;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtBuildNextJob(&Job, &Clean));
+    TEST_ASSERT_TRUE(Clean);
+    TEST_ASSERT_TRUE(strcmp(Old.JobId, Job.JobId) != 0);
+
+    PdqGbtStats_t Stats;
+    PdqGbtGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(2, (int)Stats.Templates);
+    TEST_ASSERT_EQUAL_INT(1, (int)Stats.LongPolls);
+    TEST_ASSERT_EQUAL_INT(PDQ_FAKE_BITCOIND_HEIGHT + 1, (int)Stats.Height);
+    TEST_ASSERT_EQUAL_INT(1, (int)atomic_load(&s_Node.LongPolls));
+
+    /* Work on the old tip can no longer make a block */
+    PdqShareInfo_t Share;
+    FindBlock(&Old, &Share);
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqGbtSubmitBlock(&Share));
+    TEST_ASSERT_EQUAL_INT(0, (int)atomic_load(&s_Node.Submits));
+}
+
+void Test_Gbt_RejectedBlock_Reported(void)
+{
+    atomic_store(&s_Node.RejectBlocks, 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartGbt("secret"));
+    TEST_ASSERT_TRUE(PumpUntilJob());
+    PdqMiningJob_t Job;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtBuildNextJob(&Job, NULL));
+
+    /* A nonce that misses the target never reaches the node */
+    PdqShareInfo_t Share;
+    FindBlock(&Job, &Share);
+    PdqShareInfo_t Miss = Share;
+    uint32_t Hash[8];
+    for (Miss.Nonce = 0;; Miss.Nonce++) {
+        PdqTargetHashJob(&Job, Miss.Nonce, Hash);
+        if (PdqTargetCompare(Hash, Job.Target) > 0) break;
+    }
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqGbtSubmitBlock(&Miss));
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqGbtSubmitBlock(&Share));
+    TEST_ASSERT_TRUE(PumpUntilSubmitted(1));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitRejected, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_INT(1, (int)atomic_load(&s_Node.Submits));
+
+    PdqGbtStats_t Stats;
+    PdqGbtGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(1, (int)Stats.BlocksRejected);
+    TEST_ASSERT_EQUAL_INT(0, (int)Stats.BlocksAccepted);
+}
+
+void Test_Gbt_BadCredentials_NoWork(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartGbt("wrong"));
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && atomic_load(&s_Node.Unauthorized) < 1) Pump();
+    for (int i = 0; i < 50; i++) Pump();
+
+    TEST_ASSERT_EQUAL_INT(1, (int)atomic_load(&s_Node.Unauthorized));
+    TEST_ASSERT_FALSE(PdqGbtHasNewJob());
+    TEST_ASSERT_FALSE(PdqGbtIsReady());
+    PdqGbtStats_t Stats;
+    PdqGbtGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(1, (int)Stats.RpcErrors);
+    TEST_ASSERT_EQUAL_INT(0, (int)Stats.Templates);
+
+    PdqMiningJob_t Job;
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidJob, PdqGbtBuildNextJob(&Job, NULL));
+}
+
+int main(void)
+{
+    if (PdqEventLoopInit() != PdqOk) return 1;
+    UNITY_BEGIN();
+    RUN_TEST(Test_Gbt_AddressToScript_AllStandardKinds);
+    RUN_TEST(Test_Gbt_Template_MinesAndSubmitsAValidBlock);
+    RUN_TEST(Test_Gbt_LongPoll_NewTipCleansWork);
+    RUN_TEST(Test_Gbt_RejectedBlock_Reported);
+    RUN_TEST(Test_Gbt_BadCredentials_NoWork);
+    int Result = UNITY_END();
+    PdqEventLoopDestroy();
+    return Result;
+}
@@ -0,0 +1,306 @@
+/**
+ * @file test_http.c
+ * @brief Device API and /metrics over the non-blocking HTTP server
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "linux_event.h"
+#include "linux_http.h"
+#include "api/device_api.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define TEST_WAIT_MS    3000
+#define TEST_PASSWORD   "hunter22"
+
+static char     s_Reply[PDQ_HTTP_RESPONSE_MAX + 1024];
+static uint32_t s_Snapshots;
+
+static void FillSnapshot(void* p_Arg, PdqApiSnapshot_t* p_Snap)
+{
+    (void)p_Arg;
+    s_Snapshots++;
+    snprintf(p_Snap->DeviceId, sizeof(p_Snap->DeviceId), "PDQ_0000BEEF");
+    p_Snap->p_Hardware = "test";
+    p_Snap->p_Mode = "pool";
+    p_Snap->UptimeSec = 42;
+    p_Snap->ThreadCount = 2;
+    p_Snap->ThreadHashRate[0] = 1000;
+    p_Snap->ThreadHashRate[1] = 500;
+    p_Snap->ThreadHashes[0] = 10000;
+    p_Snap->ThreadHashes[1] = 5000;
+    p_Snap->PoolCount = 1;
+    PdqApiPool_t* p_Pool = &p_Snap->Pools[0];
+    snprintf(p_Pool->Host, sizeof(p_Pool->Host), "pool.example");
+    p_Pool->Port = 3333;
+    p_Pool->Ready = true;
+    p_Pool->Weight = 1;
+    p_Pool->Difficulty = 0.5;
+    p_Pool->Jobs = 3;
+    p_Pool->CleanJobs = 1;
+    p_Pool->Stats.HashRate = 1500;
+    p_Pool->Stats.TotalHashes = 15000;
+    p_Pool->Stats.SharesAccepted = 7;
+    p_Pool->Stats.SharesRejected = 1;
+    p_Pool->Stats.SubmitLatencyHist[3] = 8;     /* 4-7 ms */
+    p_Pool->Stats.SubmitLatencySumMs = 40;
+    snprintf(p_Snap->Config.WalletAddress, sizeof(p_Snap->Config.WalletAddress), "bc1qtest");
+    snprintf(p_Snap->Config.PrimaryPool.Password, sizeof(p_Snap->Config.PrimaryPool.Password), "poolsecret");
+}
+
+static int Connect(void)
+{
+    struct sockaddr_in Addr;
+    memset(&Addr, 0, sizeof(Addr));
+    Addr.sin_family = AF_INET;
+    Addr.sin_port = htons(PdqHttpGetPort());
+    Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int Fd = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT_TRUE(Fd >= 0);
+    TEST_ASSERT_EQUAL_INT(0, connect(Fd, (struct sockaddr*)&Addr, sizeof(Addr)));
+    fcntl(Fd, F_SETFL, fcntl(Fd, F_GETFL, 0) | O_NONBLOCK);
+    return Fd;
+}
+
+static void Send(int Fd, const char* p_Data)
+{
+    size_t Len = strlen(p_Data);
+    TEST_ASSERT_EQUAL_INT((int)Len, (int)send(Fd, p_Data, Len, MSG_NOSIGNAL));
+}
+
+/* Length of the first complete response in p_Buf, 0 if it is not all there */
+static size_t ResponseLen(const char* p_Buf, size_t Len)
+{
+    const char* p_End = (const char*)memmem(p_Buf, Len, "\r\n\r\n", 4);
+    if (!p_End) return 0;
+    const char* p_Length = strstr(p_Buf, "Content-Length: ");
+    if (!p_Length || p_Length > p_End) return 0;
+    size_t Total = (size_t)(p_End + 4 - p_Buf) + strtoul(p_Length + 16, NULL, 10);
+    return Total <= Len ? Total : 0;
+}
+
+/* Pump the loop until Count responses have arrived on Fd; they are left in
+ * s_Reply. Returns the bytes read, or 0 on timeout. */
+static size_t ReadResponses(int Fd, int Count)
+{
+    size_t Len = 0;
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline) {
+        PdqEventRunOnce(5);
+        ssize_t n = recv(Fd, s_Reply + Len, sizeof(s_Reply) - 1 - Len, 0);
+        if (n > 0) Len += (size_t)n;
+        s_Reply[Len] = '\0';
+
+        size_t Pos = 0;
+        int Found = 0;
+        size_t One;
+        while (Found < Count && (One = ResponseLen(s_Reply + Pos, Len - Pos)) > 0) {
+            Pos += One;
+            Found++;
+        }
+        if (Found == Count) return Len;
+    }
+    return 0;
+}
+
+static const char* Body(void)
+{
+    const char* p_End = strstr(s_Reply, "\r\n\r\n");
+    return p_End ? p_End + 4 : "";
+}
+
+/* One request on its own connection; returns the status */
+static int Request(const char* p_Request)
+{
+    int Fd = Connect();
+    Send(Fd, p_Request);
+    size_t Len = ReadResponses(Fd, 1);
+    close(Fd);
+    TEST_ASSERT_TRUE(Len > 0);
+    return atoi(s_Reply + 9);
+}
+
+static bool PumpUntilClosed(int Fd)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    char Buf[256];
+    while (GetMillis() < Deadline) {
+        PdqEventRunOnce(5);
+        ssize_t n = recv(Fd, Buf, sizeof(Buf), 0);
+        if (n == 0) return true;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return true;
+    }
+    return false;
+}
+
+void setUp(void)
+{
+    s_Snapshots = 0;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqEventLoopInit());
+    PdqApiInit();
+    PdqApiSetSource(FillSnapshot, NULL);
+    PdqApiSetPassword(TEST_PASSWORD, (const uint8_t*)"0123456789abcdef", 16);
+    PdqApiStart();
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqHttpStart(0, "127.0.0.1"));
+    TEST_ASSERT_TRUE(PdqHttpGetPort() != 0);
+}
+
+void tearDown(void)
+{
+    PdqHttpStop();
+    PdqApiStop();
+    PdqApiSetPassword(NULL, NULL, 0);
+    PdqEventLoopDestroy();
+}
+
+void Test_Http_Status_RendersSnapshot(void)
+{
+    TEST_ASSERT_EQUAL_INT(200, Request("GET /api/status HTTP/1.1\r\nHost: x\r\n\r\n"));
+    TEST_ASSERT_NOT_NULL(strstr(s_Reply, "Content-Type: application/json"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\"device_id\":\"PDQ_0000BEEF\""));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\"hashrate_khs\":1.500"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\"shares_accepted\":7"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\"pool_connected\":true"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\"pool_host\":\"pool.example\""));
+    TEST_ASSERT_EQUAL_UINT32(1, s_Snapshots);
+}
+
+void Test_Http_Metrics_PrometheusText(void)
+{
+    TEST_ASSERT_EQUAL_INT(200, Request("GET /metrics?name[]=x HTTP/1.1\r\n\r\n"));
+    TEST_ASSERT_NOT_NULL(strstr(s_Reply, "Content-Type: text/plain; version=0.0.4"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "# TYPE pdq_hashes_total counter\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\npdq_hashrate_hps 1500\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\npdq_thread_hashrate_hps{thread=\"1\"} 500\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\npdq_thread_hashes_total{thread=\"0\"} 10000\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(),
+        "\npdq_shares_total{session=\"0\",pool=\"pool.example:3333\",outcome=\"accepted\"} 7\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(),
+        "\npdq_submit_latency_seconds_bucket{session=\"0\",pool=\"pool.example:3333\",le=\"0.004\"} 0\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(),
+        "\npdq_submit_latency_seconds_bucket{session=\"0\",pool=\"pool.example:3333\",le=\"0.008\"} 8\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(),
+        "\npdq_submit_latency_seconds_bucket{session=\"0\",pool=\"pool.example:3333\",le=\"+Inf\"} 8\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(),
+        "\npdq_submit_latency_seconds_sum{session=\"0\",pool=\"pool.example:3333\"} 0.040\n"));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\npdq_clean_jobs_total{session=\"0\",pool=\"pool.example:3333\"} 1\n"));
+}
+
+void Test_Http_Errors_NotFoundAndMethod(void)
+{
+    TEST_ASSERT_EQUAL_INT(404, Request("GET /nope HTTP/1.1\r\n\r\n"));
+    TEST_ASSERT_EQUAL_INT(405, Request("POST /api/status HTTP/1.1\r\nContent-Length: 0\r\n\r\n"));
+    TEST_ASSERT_EQUAL_INT(405, Request("GET /api/auth HTTP/1.1\r\n\r\n"));
+    TEST_ASSERT_EQUAL_INT(505, Request("GET /api/status HTTP/2.0\r\n\r\n"));
+    TEST_ASSERT_EQUAL_INT(501, Request("POST /api/auth HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(0, s_Snapshots);
+}
+
+void Test_Http_KeepAlive_AnswersPipelinedInOrder(void)
+{
+    int Fd = Connect();
+    Send(Fd, "GET /api/info HTTP/1.1\r\n\r\nGET /nope HTTP/1.1\r\n\r\nGET /metrics HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_TRUE(ReadResponses(Fd, 3) > 0);
+    char* p_First = strstr(s_Reply, "HTTP/1.1 200");
+    char* p_Second = strstr(s_Reply, "HTTP/1.1 404");
+    char* p_Third = strstr(s_Reply, "# HELP pdq_info");
+    TEST_ASSERT_TRUE(p_First == s_Reply);
+    TEST_ASSERT_TRUE(p_Second && p_Third && p_Second < p_Third);
+    TEST_ASSERT_NOT_NULL(strstr(s_Reply, "\"hardware\":\"test\""));
+
+    /* The connection stays usable */
+    Send(Fd, "GET /api/status HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_TRUE(ReadResponses(Fd, 1) > 0);
+    TEST_ASSERT_TRUE(strncmp(s_Reply, "HTTP/1.1 200", 12) == 0);
+    close(Fd);
+
+    PdqHttpStats_t Stats;
+    PdqHttpGetStats(&Stats);
+    TEST_ASSERT_EQUAL_UINT32(1, Stats.Connections);
+    TEST_ASSERT_EQUAL_UINT32(4, Stats.Requests);
+}
+
+void Test_Http_Auth_TokenUnlocksConfig(void)
+{
+    TEST_ASSERT_EQUAL_INT(401, Request("GET /api/config HTTP/1.1\r\n\r\n"));
+    TEST_ASSERT_EQUAL_INT(401, Request("POST /api/auth HTTP/1.1\r\nContent-Length: 22\r\n\r\n"
+                                       "{\"password\":\"wrong!\"}\n"));
+    TEST_ASSERT_EQUAL_INT(400, Request("POST /api/auth HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}"));
+
+    TEST_ASSERT_EQUAL_INT(200, Request("POST /api/auth HTTP/1.1\r\nContent-Length: 23\r\n\r\n"
+                                       "{\"password\":\"" TEST_PASSWORD "\"}"));
+    const char* p_Token = strstr(Body(), "\"token\":\"");
+    TEST_ASSERT_NOT_NULL(p_Token);
+    char Token[PDQ_API_TOKEN_LEN + 1];
+    memcpy(Token, p_Token + 9, PDQ_API_TOKEN_LEN);
+    Token[PDQ_API_TOKEN_LEN] = '\0';
+
+    char Req[256];
+    snprintf(Req, sizeof(Req), "GET /api/config HTTP/1.1\r\nAuthorization: Bearer %s\r\n\r\n", Token);
+    TEST_ASSERT_EQUAL_INT(200, Request(Req));
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\"wallet\":\"bc1qtest\""));
+    TEST_ASSERT_TRUE(strstr(Body(), "poolsecret") == NULL);
+
+    /* Without a password nothing is unlocked, not even by an old token */
+    PdqApiSetPassword(NULL, NULL, 0);
+    TEST_ASSERT_EQUAL_INT(403, Request(Req));
+}
+
+void Test_Http_StalledClient_DoesNotBlockOthers(void)
+{
+    int Slow = Connect();
+    Send(Slow, "GET /api/status HTTP/1.1\r\nHo");
+
+    TEST_ASSERT_EQUAL_INT(200, Request("GET /api/info HTTP/1.1\r\n\r\n"));
+
+    /* The rest of the slow request still gets its answer */
+    Send(Slow, "st: x\r\n\r\n");
+    TEST_ASSERT_TRUE(ReadResponses(Slow, 1) > 0);
+    TEST_ASSERT_NOT_NULL(strstr(Body(), "\"device_id\""));
+    close(Slow);
+}
+
+void Test_Http_Oversized_Refused(void)
+{
+    int Fd = Connect();
+    char Big[PDQ_HTTP_REQUEST_MAX + 64];
+    memset(Big, 'a', sizeof(Big) - 1);
+    Big[sizeof(Big) - 1] = '\0';
+    memcpy(Big, "GET /", 5);
+    Send(Fd, Big);
+    TEST_ASSERT_TRUE(ReadResponses(Fd, 1) > 0);
+    TEST_ASSERT_TRUE(strncmp(s_Reply, "HTTP/1.1 431", 12) == 0);
+    TEST_ASSERT_TRUE(PumpUntilClosed(Fd));
+    close(Fd);
+
+    TEST_ASSERT_EQUAL_INT(413, Request("POST /api/auth HTTP/1.1\r\nContent-Length: 100000\r\n\r\n"));
+}
+
+void Test_Http_Stopped_Returns503(void)
+{
+    PdqApiStop();
+    TEST_ASSERT_EQUAL_INT(503, Request("GET /api/status HTTP/1.1\r\n\r\n"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_Http_Status_RendersSnapshot);
+    RUN_TEST(Test_Http_Metrics_PrometheusText);
+    RUN_TEST(Test_Http_Errors_NotFoundAndMethod);
+    RUN_TEST(Test_Http_KeepAlive_AnswersPipelinedInOrder);
+    RUN_TEST(Test_Http_Auth_TokenUnlocksConfig);
+    RUN_TEST(Test_Http_StalledClient_DoesNotBlockOthers);
+    RUN_TEST(Test_Http_Oversized_Refused);
+    RUN_TEST(Test_Http_Stopped_Returns503);
+    return UNITY_END();
+}
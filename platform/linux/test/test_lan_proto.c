@@ -0,0 +1,184 @@
+/**
+ * @file test_lan_proto.c
+ * @brief Binary LAN work protocol tests against the JSON job path
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "stratum/lan_proto.h"
+#include "stratum/stratum_json.h"
+#include "stratum/stratum_client.h"
+#include "core/target.h"
+
+#define TEST_MAX_TOKENS 64
+
+/* Example notify from the original Stratum V1 documentation */
+static const char* s_Notify =
+    "{\"params\": [\"bf\", \"4d16b6f85af6e2198f44ae2a6de67f78487ae5611b77c6c0440b921e00000000\", "
+    "\"01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff20020862062f503253482f04b8864e5008\", "
+    "\"072f736c7573682f000000000100f2052a010000001976a914d23fcdf86f7e756a64a7a9688ef9903327048ed988ac00000000\", "
+    "[], \"00000002\", \"1c2ac4af\", \"504e86b9\", false], \"id\": null, \"method\": \"mining.notify\"}";
+
+static const uint8_t s_Extranonce1[4] = {0x08, 0x00, 0x00, 0x02};
+
+static PdqJsonToken_t    s_Tokens[TEST_MAX_TOKENS];
+static PdqStratumArena_t s_Arena;
+static PdqMiningJob_t    s_JsonJob;
+
+/* Receive buffer as a device would keep it */
+static uint32_t s_Buffer[PDQ_LAN_MAX_MESSAGE / 4 + 1];
+
+void setUp(void)
+{
+    PdqJsonDoc_t Doc;
+    PdqStratumJob_t Job;
+    memset(&s_JsonJob, 0, sizeof(s_JsonJob));
+    if (PdqJsonParse(&Doc, s_Notify, strlen(s_Notify), s_Tokens, TEST_MAX_TOKENS) != PdqOk) return;
+    if (PdqStratumDecodeNotify(&Doc, PdqJsonObjectGet(&Doc, 0, "params"), &s_Arena, &Job) != PdqOk) return;
+    PdqStratumBuildMiningJob(&Job, s_Extranonce1, 4, 0x11223344, 4, 1.0 / 65536.0, &s_JsonJob);
+    s_JsonJob.NonceStart = 0;
+    s_JsonJob.NonceEnd = 0xFFFFFFFF;
+}
+
+void tearDown(void)
+{
+    PdqStratumArenaFree(&s_Arena);
+}
+
+/* Encode into the receive buffer as the bytes a socket would deliver */
+static size_t SendWork(uint32_t Tag)
+{
+    PdqLanWork_t Work;
+    PdqLanEncodeWork(&s_JsonJob, Tag, PDQ_LAN_WORK_CLEAN, &Work);
+    memcpy(s_Buffer, &Work, sizeof(Work));
+    return sizeof(Work);
+}
+
+void Test_LanProto_Work_DecodesToTheJsonJob(void)
+{
+    TEST_ASSERT_EQUAL_STRING("bf", s_JsonJob.JobId);
+    size_t Len = SendWork(42);
+    TEST_ASSERT_EQUAL_INT((int)Len, PdqLanMessageLength((const uint8_t*)s_Buffer, Len));
+
+    const PdqLanWork_t* p_Work = PdqLanViewWork(s_Buffer, Len);
+    TEST_ASSERT_TRUE(p_Work == (const PdqLanWork_t*)s_Buffer);
+    TEST_ASSERT_EQUAL_HEX32(42, p_Work->JobTag);
+    TEST_ASSERT_EQUAL_HEX32(PDQ_LAN_WORK_CLEAN, p_Work->Flags);
+
+    PdqMiningJob_t Job;
+    memset(&Job, 0xA5, sizeof(Job));
+    PdqLanWorkToJob(p_Work, &Job);
+    TEST_ASSERT_EQUAL_MEMORY(s_JsonJob.Midstate, Job.Midstate, 32);
+    TEST_ASSERT_EQUAL_MEMORY(s_JsonJob.BlockTail, Job.BlockTail, 64);
+    TEST_ASSERT_EQUAL_MEMORY(s_JsonJob.HeaderSwapped, Job.HeaderSwapped, sizeof(Job.HeaderSwapped));
+    TEST_ASSERT_EQUAL_MEMORY(s_JsonJob.Target, Job.Target, sizeof(Job.Target));
+    TEST_ASSERT_EQUAL_MEMORY(s_JsonJob.NetworkTarget, Job.NetworkTarget, sizeof(Job.NetworkTarget));
+    TEST_ASSERT_EQUAL_HEX32(s_JsonJob.NonceStart, Job.NonceStart);
+    TEST_ASSERT_EQUAL_HEX32(s_JsonJob.NonceEnd, Job.NonceEnd);
+    TEST_ASSERT_EQUAL_HEX32(s_JsonJob.NTime, Job.NTime);
+    TEST_ASSERT_EQUAL_HEX32(0x11223344, Job.Extranonce2);
+    TEST_ASSERT_EQUAL_STRING("0000002a", Job.JobId);
+}
+
+void Test_LanProto_DecodedJob_HashesTheSameShare(void)
+{
+    size_t Len = SendWork(7);
+    PdqMiningJob_t Job;
+    PdqLanWorkToJob(PdqLanViewWork(s_Buffer, Len), &Job);
+
+    /* First share on the JSON job, through the full-header path the HW
+     * engine and the share check use */
+    uint32_t Nonce = 0;
+    uint32_t JsonHash[8], LanHash[8];
+    for (;; Nonce++) {
+        PdqTargetHashJob(&s_JsonJob, Nonce, JsonHash);
+        if (PdqTargetCompare(JsonHash, s_JsonJob.Target) <= 0) break;
+    }
+    PdqTargetHashJob(&Job, Nonce, LanHash);
+    TEST_ASSERT_EQUAL_MEMORY(JsonHash, LanHash, sizeof(JsonHash));
+    TEST_ASSERT_EQUAL_INT(PdqHitShare, PdqTargetClassify(&Job, LanHash));
+
+    /* Hashes that miss the target agree as well */
+    PdqTargetHashJob(&s_JsonJob, Nonce - 1, JsonHash);
+    PdqTargetHashJob(&Job, Nonce - 1, LanHash);
+    TEST_ASSERT_EQUAL_MEMORY(JsonHash, LanHash, sizeof(JsonHash));
+}
+
+void Test_LanProto_Share_RoundTripsTheTag(void)
+{
+    size_t Len = SendWork(0xdeadbeef);
+    PdqMiningJob_t Job;
+    PdqLanWorkToJob(PdqLanViewWork(s_Buffer, Len), &Job);
+
+    PdqShareInfo_t Info;
+    memset(&Info, 0, sizeof(Info));
+    strcpy(Info.JobId, Job.JobId);
+    Info.Extranonce2 = Job.Extranonce2;
+    Info.Nonce = 0x01020304;
+    Info.NTime = Job.NTime + 5;
+    Info.BlockCandidate = true;
+
+    PdqLanShare_t Share;
+    PdqLanEncodeShare(&Info, &Share);
+    memcpy(s_Buffer, &Share, sizeof(Share));
+    TEST_ASSERT_EQUAL_INT((int)sizeof(Share), PdqLanMessageLength((const uint8_t*)s_Buffer, sizeof(Share)));
+    TEST_ASSERT_NULL(PdqLanViewWork(s_Buffer, sizeof(Share)));
+
+    const PdqLanShare_t* p_Share = PdqLanViewShare(s_Buffer, sizeof(Share));
+    TEST_ASSERT_NOT_NULL(p_Share);
+    TEST_ASSERT_EQUAL_HEX32(0xdeadbeef, p_Share->JobTag);
+    TEST_ASSERT_EQUAL_HEX32(0x01020304, p_Share->Nonce);
+    TEST_ASSERT_EQUAL_HEX32(Job.NTime + 5, p_Share->NTime);
+    TEST_ASSERT_EQUAL_HEX32(0x11223344, p_Share->Extranonce2);
+    TEST_ASSERT_EQUAL_HEX32(PDQ_LAN_SHARE_BLOCK, p_Share->Flags);
+
+    PdqLanResult_t Result;
+    PdqLanEncodeResult(p_Share->JobTag, p_Share->Nonce, 23, &Result);
+    memcpy(s_Buffer, &Result, sizeof(Result));
+    const PdqLanResult_t* p_Result = PdqLanViewResult(s_Buffer, sizeof(Result));
+    TEST_ASSERT_NOT_NULL(p_Result);
+    TEST_ASSERT_EQUAL_INT(23, p_Result->Code);
+}
+
+void Test_LanProto_Framing_PartialAndForeignInput(void)
+{
+    size_t Len = SendWork(1);
+    const uint8_t* p_Bytes = (const uint8_t*)s_Buffer;
+
+    /* A header still arriving, then a body still arriving */
+    TEST_ASSERT_EQUAL_INT(0, PdqLanMessageLength(p_Bytes, 0));
+    TEST_ASSERT_EQUAL_INT(0, PdqLanMessageLength(p_Bytes, 3));
+    TEST_ASSERT_EQUAL_INT((int)Len, PdqLanMessageLength(p_Bytes, PDQ_LAN_HEADER_SIZE));
+    TEST_ASSERT_NULL(PdqLanViewWork(s_Buffer, Len - 4));
+
+    /* JSON, other versions and impossible lengths are not LAN messages */
+    TEST_ASSERT_EQUAL_INT(-1, PdqLanMessageLength((const uint8_t*)"{\"id\":1}", 8));
+    TEST_ASSERT_EQUAL_INT(-1, PdqLanMessageLength((const uint8_t*)"PX", 2));
+    uint8_t* p_Header = (uint8_t*)s_Buffer;
+    p_Header[2] = PDQ_LAN_VERSION + 1;
+    TEST_ASSERT_EQUAL_INT(-1, PdqLanMessageLength(p_Bytes, Len));
+    TEST_ASSERT_NULL(PdqLanViewWork(s_Buffer, Len));
+    p_Header[2] = PDQ_LAN_VERSION;
+    p_Header[4] = 210;
+    TEST_ASSERT_EQUAL_INT(-1, PdqLanMessageLength(p_Bytes, Len));
+    p_Header[4] = 0;
+    p_Header[5] = 2;
+    TEST_ASSERT_EQUAL_INT(-1, PdqLanMessageLength(p_Bytes, Len));
+
+    /* A valid message seen unaligned is not read in place */
+    SendWork(1);
+    static uint32_t s_Shifted[PDQ_LAN_MAX_MESSAGE / 4 + 2];
+    memcpy((uint8_t*)s_Shifted + 2, s_Buffer, Len);
+    TEST_ASSERT_NULL(PdqLanViewWork((uint8_t*)s_Shifted + 2, Len));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_LanProto_Work_DecodesToTheJsonJob);
+    RUN_TEST(Test_LanProto_DecodedJob_HashesTheSameShare);
+    RUN_TEST(Test_LanProto_Share_RoundTripsTheTag);
+    RUN_TEST(Test_LanProto_Framing_PartialAndForeignInput);
+    return UNITY_END();
+}
@@ -0,0 +1,219 @@
+/**
+ * @file test_mining.c
+ * @brief Mining thread pool tests: weighted split between contexts, resizing
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "linux_mining.h"
+#include "stratum/stratum_client.h"
+#include <string.h>
+
+#define TEST_THREADS    2
+#define TEST_RUN_MS     1500
+
+static PdqMiningPool_t    s_Pool;
+static PdqMiningContext_t s_Contexts[3];
+
+/* A job nothing can meet: every hash is counted, no share is queued */
+static void GiveJob(PdqMiningContext_t* p_Ctx, const char* p_JobId)
+{
+    PdqMiningJob_t Job;
+    memset(&Job, 0, sizeof(Job));
+    snprintf(Job.JobId, sizeof(Job.JobId), "%s", p_JobId);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningCtxSetJob(p_Ctx, &Job));
+}
+
+/* A share every 65536 hashes or so: the engine only checks the hashes
+ * its early test lets through, and each of those meets an all-ones target */
+static void GiveEasyJob(PdqMiningContext_t* p_Ctx, uint32_t Extranonce2)
+{
+    uint8_t Header[80];
+    PdqMiningJob_t Job;
+    memset(Header, 0, sizeof(Header));
+    memset(&Job, 0, sizeof(Job));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumHeaderToMiningJob(Header, &Job));
+    memset(Job.Target, 0xFF, sizeof(Job.Target));
+    memset(Job.NetworkTarget, 0, sizeof(Job.NetworkTarget));
+    snprintf(Job.JobId, sizeof(Job.JobId), "easy");
+    Job.Extranonce2 = Extranonce2;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningCtxSetJob(p_Ctx, &Job));
+}
+
+static uint64_t Hashes(PdqMiningContext_t* p_Ctx)
+{
+    PdqMinerStats_t Stats;
+    PdqMiningCtxGetStats(p_Ctx, &Stats);
+    return Stats.TotalHashes;
+}
+
+void setUp(void)
+{
+    PdqMiningPoolInit(&s_Pool, TEST_THREADS, NULL);
+    for (int i = 0; i < 3; i++) PdqMiningCtxInit(&s_Contexts[i]);
+}
+
+void tearDown(void)
+{
+    if (PdqMiningPoolIsRunning(&s_Pool)) PdqMiningPoolStop(&s_Pool);
+}
+
+static void Test_Mining_Weights_SplitTheThreads(void)
+{
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[0], 3);
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[1], 1);
+    GiveJob(&s_Contexts[0], "a");
+    GiveJob(&s_Contexts[1], "b");
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolStart(&s_Pool));
+
+    SleepMs(TEST_RUN_MS);
+    PdqMiningPoolStop(&s_Pool);
+
+    uint64_t Heavy = Hashes(&s_Contexts[0]);
+    uint64_t Light = Hashes(&s_Contexts[1]);
+    TEST_ASSERT_TRUE(Light > 0);
+    TEST_ASSERT_DOUBLE_WITHIN(0.1, 0.75, (double)Heavy / (double)(Heavy + Light));
+}
+
+static void Test_Mining_NoJobOrPaused_TurnsGoToTheOthers(void)
+{
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[0], 1);
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[1], 1);
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[2], 1);
+    GiveJob(&s_Contexts[0], "a");
+    GiveJob(&s_Contexts[1], "b");
+    PdqMiningCtxPause(&s_Contexts[1]);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolStart(&s_Pool));
+
+    SleepMs(TEST_RUN_MS / 2);
+    TEST_ASSERT_TRUE(Hashes(&s_Contexts[0]) > 0);
+    TEST_ASSERT_TRUE(Hashes(&s_Contexts[1]) == 0);
+    TEST_ASSERT_TRUE(Hashes(&s_Contexts[2]) == 0);
+
+    /* Resumed, it gets its share back */
+    PdqMiningCtxResume(&s_Contexts[1]);
+    SleepMs(TEST_RUN_MS / 2);
+    PdqMiningPoolStop(&s_Pool);
+    TEST_ASSERT_TRUE(Hashes(&s_Contexts[1]) > 0);
+    TEST_ASSERT_TRUE(Hashes(&s_Contexts[2]) == 0);
+}
+
+static void Test_Mining_Attach_OnlyBeforeStartAndUpToTheLimit(void)
+{
+    PdqMiningContext_t Extra[PDQ_MINING_MAX_CONTEXTS + 1];
+    for (int i = 0; i <= PDQ_MINING_MAX_CONTEXTS; i++) PdqMiningCtxInit(&Extra[i]);
+
+    for (int i = 0; i < PDQ_MINING_MAX_CONTEXTS; i++) {
+        TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolAttach(&s_Pool, &Extra[i], 0));
+    }
+    TEST_ASSERT_EQUAL_INT(1, (int)Extra[0].Weight);
+    TEST_ASSERT_EQUAL_INT(PdqErrorNoMemory,
+                          PdqMiningPoolAttach(&s_Pool, &Extra[PDQ_MINING_MAX_CONTEXTS], 1));
+
+    PdqMiningPoolInit(&s_Pool, TEST_THREADS, NULL);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolStart(&s_Pool));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqMiningPoolAttach(&s_Pool, &Extra[0], 1));
+}
+
+static void Test_Mining_Resize_WhileRunning_KeepsHashing(void)
+{
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[0], 1);
+    GiveJob(&s_Contexts[0], "a");
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolStart(&s_Pool));
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolResize(&s_Pool, 4));
+    TEST_ASSERT_EQUAL_INT(4, s_Pool.ThreadCount);
+    SleepMs(TEST_RUN_MS / 3);
+
+    /* The surplus threads are joined before Resize returns */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolResize(&s_Pool, 1));
+    TEST_ASSERT_EQUAL_INT(1, s_Pool.ThreadCount);
+    uint64_t Before = Hashes(&s_Contexts[0]);
+    SleepMs(TEST_RUN_MS / 3);
+    TEST_ASSERT_TRUE(PdqMiningPoolIsRunning(&s_Pool));
+    TEST_ASSERT_TRUE(Hashes(&s_Contexts[0]) > Before);
+}
+
+#define TEST_MAX_SHARES 4096
+
+static PdqShareInfo_t s_Shares[TEST_MAX_SHARES];
+static int            s_ShareCount;
+
+/* Take the queued shares for Ms, counting any seen before */
+static int CollectShares(PdqMiningContext_t* p_Ctx, uint32_t Ms)
+{
+    int Duplicates = 0;
+    for (uint32_t t = 0; t < Ms; t++) {
+        PdqShareInfo_t Share;
+        while (PdqMiningCtxGetShare(p_Ctx, &Share) == PdqOk) {
+            for (int i = 0; i < s_ShareCount; i++) {
+                if (s_Shares[i].Extranonce2 == Share.Extranonce2 && s_Shares[i].Nonce == Share.Nonce) {
+                    Duplicates++;
+                }
+            }
+            if (s_ShareCount < TEST_MAX_SHARES) s_Shares[s_ShareCount++] = Share;
+        }
+        SleepMs(1);
+    }
+    return Duplicates;
+}
+
+static void Test_Mining_Resize_NeverQueuesAShareTwice(void)
+{
+    s_ShareCount = 0;
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[0], 1);
+    GiveEasyJob(&s_Contexts[0], 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolStart(&s_Pool));
+    int Duplicates = CollectShares(&s_Contexts[0], TEST_RUN_MS / 4);
+    int Before = s_ShareCount;
+    TEST_ASSERT_TRUE(Before > 0);
+
+    /* Grown and shrunk on the same job, the threads hash on where they
+     * were rather than start their new ranges over */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolResize(&s_Pool, 4));
+    Duplicates += CollectShares(&s_Contexts[0], TEST_RUN_MS / 4);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolResize(&s_Pool, 1));
+    Duplicates += CollectShares(&s_Contexts[0], TEST_RUN_MS / 4);
+    TEST_ASSERT_TRUE(s_ShareCount > Before);
+
+    /* The next job is split four ways from the start */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolResize(&s_Pool, 4));
+    GiveEasyJob(&s_Contexts[0], 2);
+    Before = s_ShareCount;
+    Duplicates += CollectShares(&s_Contexts[0], TEST_RUN_MS / 4);
+    TEST_ASSERT_TRUE(s_ShareCount > Before);
+    TEST_ASSERT_EQUAL_INT(0, Duplicates);
+}
+
+static void Test_Mining_SetWeight_WhileRunning_ShiftsTheSplit(void)
+{
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[0], 1);
+    PdqMiningPoolAttach(&s_Pool, &s_Contexts[1], 1);
+    GiveJob(&s_Contexts[0], "a");
+    GiveJob(&s_Contexts[1], "b");
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolStart(&s_Pool));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqMiningPoolSetWeight(&s_Pool, &s_Contexts[2], 1));
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqMiningPoolSetWeight(&s_Pool, &s_Contexts[0], 3));
+    uint64_t Heavy = Hashes(&s_Contexts[0]);
+    uint64_t Light = Hashes(&s_Contexts[1]);
+    SleepMs(TEST_RUN_MS);
+    PdqMiningPoolStop(&s_Pool);
+
+    Heavy = Hashes(&s_Contexts[0]) - Heavy;
+    Light = Hashes(&s_Contexts[1]) - Light;
+    TEST_ASSERT_DOUBLE_WITHIN(0.1, 0.75, (double)Heavy / (double)(Heavy + Light));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_Mining_Weights_SplitTheThreads);
+    RUN_TEST(Test_Mining_NoJobOrPaused_TurnsGoToTheOthers);
+    RUN_TEST(Test_Mining_Attach_OnlyBeforeStartAndUpToTheLimit);
+    RUN_TEST(Test_Mining_Resize_WhileRunning_KeepsHashing);
+    RUN_TEST(Test_Mining_Resize_NeverQueuesAShareTwice);
+    RUN_TEST(Test_Mining_SetWeight_WhileRunning_ShiftsTheSplit);
+    return UNITY_END();
+}
@@ -0,0 +1,429 @@
+/**
+ * @file test_pool_supervisor.c
+ * @brief Pool supervisor tests against an in-process fake pool
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "fake_pool.h"
+#include "stratum/stratum_client.h"
+#include "stratum/pool_supervisor.h"
+#include <unistd.h>
+
+#define TEST_WAIT_MS    5000
+
+static PdqFakePool_t             s_Primary;
+static PdqFakePool_t             s_Backup;
+static PdqPoolSupervisor_t       s_Sup;
+static PdqPoolSupervisorConfig_t s_Tuning;
+static PdqDeviceConfig_t         s_Config;
+static uint32_t                  s_Seen;
+
+/* Run the supervisor until one of EventMask is reported; collects every
+ * event seen on the way in s_Seen. */
+static bool RunUntil(uint32_t EventMask, uint32_t TimeoutMs)
+{
+    uint64_t Deadline = GetMillis() + TimeoutMs;
+    while (GetMillis() < Deadline) {
+        uint32_t Events = PdqPoolSupervisorProcess(&s_Sup, GetMillis());
+        s_Seen |= Events;
+        if (Events & EventMask) return true;
+        SleepMs(5);
+    }
+    return false;
+}
+
+/* A loopback port with nothing listening on it */
+static uint16_t ClosedPort(void)
+{
+    PdqFakePool_t Tmp;
+    memset(&Tmp, 0, sizeof(Tmp));
+    PdqFakePoolStart(&Tmp, 0);
+    uint16_t Port = Tmp.Port;
+    PdqFakePoolStop(&Tmp);
+    return Port;
+}
+
+static void SetPool(PdqPoolConfig_t* p_Pool, uint16_t Port)
+{
+    snprintf(p_Pool->Host, sizeof(p_Pool->Host), "127.0.0.1");
+    p_Pool->Port = Port;
+}
+
+void setUp(void)
+{
+    memset(&s_Primary, 0, sizeof(s_Primary));
+    memset(&s_Backup, 0, sizeof(s_Backup));
+    memset(&s_Config, 0, sizeof(s_Config));
+    snprintf(s_Config.WalletAddress, sizeof(s_Config.WalletAddress), "bc1qtest");
+    snprintf(s_Config.WorkerName, sizeof(s_Config.WorkerName), "unit");
+
+    PdqPoolSupervisorDefaults(&s_Tuning);
+    s_Tuning.BackoffMinMs = 20;
+    s_Tuning.BackoffMaxMs = 80;
+    s_Tuning.MaxConsecutiveFail = 3;
+    s_Seen = 0;
+}
+
+void tearDown(void)
+{
+    PdqPoolSupervisorStop(&s_Sup);
+    PdqFakePoolStop(&s_Primary);
+    PdqFakePoolStop(&s_Backup);
+}
+
+void Test_PoolSupervisor_Start_PrimaryUp_ReportsReady(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning));
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(PoolStatePrimaryConnected, PdqPoolSupervisorGetState(&s_Sup));
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Primary.Authorizations));
+    TEST_ASSERT_TRUE(PdqStratumCtxIsReady(PdqPoolSupervisorGetContext(&s_Sup)));
+}
+
+void Test_PoolSupervisor_Init_NoPrimary_ReturnsError(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam,
+                          PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam,
+                          PdqPoolSupervisorInit(NULL, &s_Config, 1.0, &s_Tuning));
+}
+
+void Test_PoolSupervisor_Process_PrimaryDown_BackoffGrowsToCap(void)
+{
+    SetPool(&s_Config.PrimaryPool, ClosedPort());
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+
+    /* No backup: the supervisor keeps retrying the primary with a
+     * doubling, jittered delay that never exceeds the cap. */
+    uint8_t LastFails = 0;
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (s_Sup.Sessions[0].FailCount < 5 && GetMillis() < Deadline) {
+        uint64_t Now = GetMillis();
+        PdqPoolSupervisorProcess(&s_Sup, Now);
+        if (s_Sup.Sessions[0].FailCount != LastFails) {
+            LastFails = s_Sup.Sessions[0].FailCount;
+            uint64_t Delay = s_Sup.Sessions[0].RetryAtMs - Now;
+            TEST_ASSERT_TRUE(Delay >= s_Sup.Sessions[0].BackoffMs / 2);
+            TEST_ASSERT_TRUE(Delay <= s_Sup.Sessions[0].BackoffMs);
+            TEST_ASSERT_TRUE(s_Sup.Sessions[0].BackoffMs <= s_Tuning.BackoffMaxMs);
+        }
+        SleepMs(2);
+    }
+    TEST_ASSERT_EQUAL_INT(5, s_Sup.Sessions[0].FailCount);
+    TEST_ASSERT_EQUAL_INT(s_Tuning.BackoffMaxMs, s_Sup.Sessions[0].BackoffMs);
+    TEST_ASSERT_EQUAL_INT(PoolStatePrimaryFailed, PdqPoolSupervisorGetState(&s_Sup));
+    TEST_ASSERT_EQUAL_INT(0, s_Sup.Failovers);
+}
+
+void Test_PoolSupervisor_Process_PrimaryDown_FailsOverToBackup(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Backup, 0));
+    SetPool(&s_Config.PrimaryPool, ClosedPort());
+    SetPool(&s_Config.BackupPool, s_Backup.Port);
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_TRUE(s_Seen & PDQ_POOL_EVENT_SWITCHED);
+    TEST_ASSERT_EQUAL_INT(PoolStateBackupConnected, PdqPoolSupervisorGetState(&s_Sup));
+    TEST_ASSERT_EQUAL_INT(s_Backup.Port, PdqPoolSupervisorGetActivePool(&s_Sup)->Port);
+    TEST_ASSERT_EQUAL_INT(1, s_Sup.Failovers);
+}
+
+void Test_PoolSupervisor_Process_PrimaryRecovers_ReturnsToPrimary(void)
+{
+    uint16_t PrimaryPort = ClosedPort();
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Backup, 0));
+    SetPool(&s_Config.PrimaryPool, PrimaryPort);
+    SetPool(&s_Config.BackupPool, s_Backup.Port);
+    s_Tuning.PrimaryRecheckMs = 200;
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(1, s_Sup.ActivePool);
+
+    /* First recheck finds the primary still down and falls back */
+    s_Seen = 0;
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(1, s_Sup.ActivePool);
+    TEST_ASSERT_TRUE(s_Seen & PDQ_POOL_EVENT_LOST);
+
+    /* Once it is back, the next recheck stays on it */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, PrimaryPort));
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(PoolStatePrimaryConnected, PdqPoolSupervisorGetState(&s_Sup));
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Primary.Authorizations));
+}
+
+void Test_PoolSupervisor_Process_SilentPool_ReportsLost(void)
+{
+    atomic_store(&s_Primary.Silent, 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+    s_Tuning.SilenceTimeoutMs = 300;
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+
+    uint64_t ReadyAt = GetMillis();
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_LOST, TEST_WAIT_MS));
+    TEST_ASSERT_TRUE(GetMillis() - ReadyAt >= 250);
+    TEST_ASSERT_EQUAL_INT(1, s_Sup.Reconnects);
+    TEST_ASSERT_FALSE(PdqStratumCtxIsReady(PdqPoolSupervisorGetContext(&s_Sup)));
+}
+
+void Test_PoolSupervisor_Process_NotifyingPool_StaysUp(void)
+{
+    s_Primary.NotifyIntervalMs = 50;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+    s_Tuning.SilenceTimeoutMs = 300;
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+
+    TEST_ASSERT_FALSE(RunUntil(PDQ_POOL_EVENT_LOST, 1000));
+    TEST_ASSERT_TRUE(atomic_load(&s_Primary.Notifies) > 5);
+}
+
+void Test_PoolSupervisor_Process_SessionDropped_Reconnects(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+
+    atomic_store(&s_Primary.DropClients, 1);
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_LOST, TEST_WAIT_MS));
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(2, atomic_load(&s_Primary.Connections));
+    TEST_ASSERT_EQUAL_INT(PoolStatePrimaryConnected, PdqPoolSupervisorGetState(&s_Sup));
+}
+
+void Test_PoolSupervisor_SessionDropped_Resumed_KeepsQueuedShares(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_FALSE(PdqPoolSupervisorSessionKept(&s_Sup));
+
+    /* A share found just before the drop waits out the outage */
+    PdqStratumJob_t Job;
+    PdqStratumCtxGetJob(PdqPoolSupervisorGetContext(&s_Sup), &Job);
+
+    atomic_store(&s_Primary.DropClients, 1);
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_LOST, TEST_WAIT_MS));
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Primary.Resumes));
+    TEST_ASSERT_TRUE(PdqPoolSupervisorSessionKept(&s_Sup));
+
+    PdqStratumContext_t* p_Ctx = PdqPoolSupervisorGetContext(&s_Sup);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitShare(p_Ctx, Job.JobId, 1, 0x1234, Job.NTime));
+    RunUntil(0, 200);
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Primary.Submits));
+    TEST_ASSERT_EQUAL_UINT32(0, PdqStratumCtxGetPendingSubmits(p_Ctx));
+
+    /* A fresh session hands out a new extranonce1: the queue is void */
+    atomic_store(&s_Primary.RefuseResume, 1);
+    atomic_store(&s_Primary.DropClients, 1);
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_LOST, TEST_WAIT_MS));
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_FALSE(PdqPoolSupervisorSessionKept(&s_Sup));
+}
+
+void Test_PoolSupervisor_SuggestDifficulty_SentNowAndOnReconnect(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Primary.Suggests));
+
+    PdqPoolSupervisorSuggestDifficulty(&s_Sup, 42.5);
+    RunUntil(0, 200);
+    TEST_ASSERT_EQUAL_INT(2, atomic_load(&s_Primary.Suggests));
+    TEST_ASSERT_EQUAL_INT(42500, atomic_load(&s_Primary.SuggestMilli));
+
+    /* The next session starts from the retuned value, not the initial one */
+    atomic_store(&s_Primary.DropClients, 1);
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_LOST, TEST_WAIT_MS));
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(3, atomic_load(&s_Primary.Suggests));
+    TEST_ASSERT_EQUAL_INT(42500, atomic_load(&s_Primary.SuggestMilli));
+}
+
+void Test_PoolSupervisor_HotStandby_PrimaryDies_SwitchesToPrebuiltJob(void)
+{
+    s_Primary.NotifyIntervalMs = 50;
+    s_Backup.NotifyIntervalMs = 50;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Backup, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+    SetPool(&s_Config.BackupPool, s_Backup.Port);
+    s_Tuning.HotStandby = true;
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(0, s_Sup.ActivePool);
+
+    /* Standby authorizes in parallel and keeps a job built */
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (!s_Sup.HasStandbyJob && GetMillis() < Deadline) {
+        s_Seen |= PdqPoolSupervisorProcess(&s_Sup, GetMillis());
+        SleepMs(5);
+    }
+    TEST_ASSERT_TRUE(s_Sup.HasStandbyJob);
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Backup.Authorizations));
+    TEST_ASSERT_NOT_NULL(PdqPoolSupervisorGetSessionContext(&s_Sup, 1));
+
+    /* Primary dies: switch without parking and without a new handshake */
+    PdqFakePoolStop(&s_Primary);
+    s_Seen = 0;
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_SWITCHED, TEST_WAIT_MS));
+    TEST_ASSERT_FALSE(s_Seen & PDQ_POOL_EVENT_LOST);
+    TEST_ASSERT_EQUAL_INT(PoolStateBackupConnected, PdqPoolSupervisorGetState(&s_Sup));
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Backup.Authorizations));
+
+    PdqMiningJob_t Job;
+    TEST_ASSERT_TRUE(PdqPoolSupervisorTakeSwitchJob(&s_Sup, &Job));
+    TEST_ASSERT_EQUAL_STRING("1eaa720", Job.JobId);
+    TEST_ASSERT_FALSE(PdqPoolSupervisorTakeSwitchJob(&s_Sup, &Job));
+    TEST_ASSERT_TRUE(PdqStratumCtxIsReady(PdqPoolSupervisorGetContext(&s_Sup)));
+}
+
+void Test_PoolSupervisor_HotStandby_PrimaryRecovers_SwitchesBack(void)
+{
+    uint16_t PrimaryPort = ClosedPort();
+    s_Primary.NotifyIntervalMs = 50;
+    s_Backup.NotifyIntervalMs = 50;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Backup, 0));
+    SetPool(&s_Config.PrimaryPool, PrimaryPort);
+    SetPool(&s_Config.BackupPool, s_Backup.Port);
+    s_Tuning.HotStandby = true;
+    s_Tuning.PrimaryRecheckMs = 200;
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+
+    /* Primary refused, backup already up: it takes over */
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_SWITCHED, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(1, s_Sup.ActivePool);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, PrimaryPort));
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_SWITCHED, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(PoolStatePrimaryConnected, PdqPoolSupervisorGetState(&s_Sup));
+
+    PdqMiningJob_t Job;
+    TEST_ASSERT_TRUE(PdqPoolSupervisorTakeSwitchJob(&s_Sup, &Job));
+    TEST_ASSERT_TRUE(PdqStratumCtxIsReady(PdqPoolSupervisorGetSessionContext(&s_Sup, 1)));
+}
+
+void Test_PoolSupervisor_RacePools_PrimaryMute_BackupWins(void)
+{
+    atomic_store(&s_Primary.Mute, 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Backup, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+    SetPool(&s_Config.BackupPool, s_Backup.Port);
+    s_Tuning.RacePools = true;
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+
+    /* Primary accepts TCP but never answers subscribe: backup wins and
+     * the primary attempt is abandoned instead of timing out first */
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_TRUE(s_Seen & PDQ_POOL_EVENT_SWITCHED);
+    TEST_ASSERT_EQUAL_INT(PoolStateBackupConnected, PdqPoolSupervisorGetState(&s_Sup));
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Primary.Connections));
+    TEST_ASSERT_EQUAL_INT(StratumStateDisconnected,
+                          PdqStratumCtxGetState(PdqPoolSupervisorGetSessionContext(&s_Sup, 0)));
+}
+
+void Test_PoolSupervisor_RacePools_BackupRefused_PrimaryWins(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+    SetPool(&s_Config.BackupPool, ClosedPort());
+    s_Tuning.RacePools = true;
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+
+    /* A refused backup drops out of the race without costing a failover */
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_FALSE(s_Seen & PDQ_POOL_EVENT_SWITCHED);
+    TEST_ASSERT_EQUAL_INT(PoolStatePrimaryConnected, PdqPoolSupervisorGetState(&s_Sup));
+    TEST_ASSERT_EQUAL_INT(0, s_Sup.Failovers);
+}
+
+void Test_PoolSupervisor_Resume_HandedOverSession_ReadyWithoutReconnect(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Primary, 0));
+    SetPool(&s_Config.PrimaryPool, s_Primary.Port);
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    PdqPoolSupervisorStart(&s_Sup, GetMillis());
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+
+    /* Hand the session over to a fresh supervisor, as an upgrade does */
+    static uint8_t Blob[PDQ_STRATUM_TX_BUFFER_SIZE + 16384];
+    uint32_t Len = 0;
+    PdqStratumContext_t* p_Ctx = PdqPoolSupervisorGetSessionContext(&s_Sup, 0);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSaveState(p_Ctx, Blob, sizeof(Blob), &Len));
+    int Socket = dup(PdqStratumCtxGetSocket(p_Ctx));
+    PdqPoolSupervisorStop(&s_Sup);
+
+    PdqPoolSupervisorInit(&s_Sup, &s_Config, 1.0, &s_Tuning);
+    TEST_ASSERT_EQUAL_INT(PdqErrorNotConnected, PdqPoolSupervisorResume(&s_Sup, 0, GetMillis()));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqPoolSupervisorResume(&s_Sup, 1, GetMillis()));
+    p_Ctx = PdqPoolSupervisorGetSessionContext(&s_Sup, 0);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxRestoreState(p_Ctx, Socket, Blob, Len));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqPoolSupervisorResume(&s_Sup, 0, GetMillis()));
+
+    s_Seen = 0;
+    TEST_ASSERT_TRUE(RunUntil(PDQ_POOL_EVENT_READY, TEST_WAIT_MS));
+    TEST_ASSERT_EQUAL_INT(PoolStatePrimaryConnected, PdqPoolSupervisorGetState(&s_Sup));
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Primary.Connections));
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Primary.Authorizations));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_PoolSupervisor_Start_PrimaryUp_ReportsReady);
+    RUN_TEST(Test_PoolSupervisor_Init_NoPrimary_ReturnsError);
+    RUN_TEST(Test_PoolSupervisor_Process_PrimaryDown_BackoffGrowsToCap);
+    RUN_TEST(Test_PoolSupervisor_Process_PrimaryDown_FailsOverToBackup);
+    RUN_TEST(Test_PoolSupervisor_Process_PrimaryRecovers_ReturnsToPrimary);
+    RUN_TEST(Test_PoolSupervisor_Process_SilentPool_ReportsLost);
+    RUN_TEST(Test_PoolSupervisor_Process_NotifyingPool_StaysUp);
+    RUN_TEST(Test_PoolSupervisor_Process_SessionDropped_Reconnects);
+    RUN_TEST(Test_PoolSupervisor_SessionDropped_Resumed_KeepsQueuedShares);
+    RUN_TEST(Test_PoolSupervisor_SuggestDifficulty_SentNowAndOnReconnect);
+    RUN_TEST(Test_PoolSupervisor_HotStandby_PrimaryDies_SwitchesToPrebuiltJob);
+    RUN_TEST(Test_PoolSupervisor_HotStandby_PrimaryRecovers_SwitchesBack);
+    RUN_TEST(Test_PoolSupervisor_RacePools_PrimaryMute_BackupWins);
+    RUN_TEST(Test_PoolSupervisor_RacePools_BackupRefused_PrimaryWins);
+    RUN_TEST(Test_PoolSupervisor_Resume_HandedOverSession_ReadyWithoutReconnect);
+    return UNITY_END();
+}
@@ -0,0 +1,582 @@
+/**
+ * @file test_proxy.c
+ * @brief Stratum proxy tests: fake pool upstream, stratum clients as devices
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "fake_pool.h"
+#include "linux_event.h"
+#include "linux_proxy.h"
+#include "stratum/stratum_client.h"
+#include "stratum/lan_proto.h"
+#include "core/target.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#define TEST_WAIT_MS        5000
+#define TEST_DIFFICULTY     (1.0 / 65536.0)
+#define TEST_DEVICES        2
+#define TEST_FD_DEVICES     (FD_SETSIZE / 2 + 64)
+
+static PdqFakePool_t       s_Pool;
+static PdqStratumContext_t s_Upstream;
+static PdqStratumContext_t s_Devices[TEST_DEVICES];
+
+static PdqTestSubmits_t s_Submits;
+
+/* One pass of everything main.c would drive: the proxy's descriptors,
+ * the upstream session and every device session */
+static void Pump(void)
+{
+    PdqEventRunOnce(1);
+    PdqStratumCtxProcess(&s_Upstream);
+    if (PdqStratumCtxHasNewJob(&s_Upstream)) PdqProxyOnJob();
+    for (int i = 0; i < TEST_DEVICES; i++) {
+        PdqStratumContext_t* p_Dev = &s_Devices[i];
+        if (PdqStratumCtxGetState(p_Dev) == StratumStateDisconnected) continue;
+        PdqStratumCtxProcess(p_Dev);
+        if (PdqStratumCtxGetState(p_Dev) == StratumStateConnected) PdqStratumCtxSubscribe(p_Dev);
+        if (PdqStratumCtxGetState(p_Dev) == StratumStateSubscribed) {
+            PdqStratumCtxAuthorize(p_Dev, "bc1qdevice.esp32", "x");
+        }
+    }
+}
+
+static bool PumpUntilReady(PdqStratumContext_t* p_Ctx)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && !PdqStratumCtxIsReady(p_Ctx)) Pump();
+    return PdqStratumCtxIsReady(p_Ctx);
+}
+
+static bool ConnectDevice(PdqStratumContext_t* p_Dev)
+{
+    if (PdqStratumCtxConnectStart(p_Dev, "127.0.0.1", PdqProxyGetPort()) != PdqOk) return false;
+    return PumpUntilReady(p_Dev);
+}
+
+static bool PumpUntilAnswered(PdqStratumContext_t* p_Dev)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && PdqStratumCtxGetPendingSubmits(p_Dev) > 0) Pump();
+    return PdqStratumCtxGetPendingSubmits(p_Dev) == 0;
+}
+
+/* What the pool supervisor does for the proxy's upstream session */
+static bool ConnectUpstream(void)
+{
+    if (PdqStratumCtxConnectStart(&s_Upstream, "127.0.0.1", s_Pool.Port) != PdqOk) return false;
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && !PdqStratumCtxIsReady(&s_Upstream)) {
+        PdqEventRunOnce(0);
+        PdqStratumCtxProcess(&s_Upstream);
+        PdqStratumState_t State = PdqStratumCtxGetState(&s_Upstream);
+        if (State == StratumStateConnected) PdqStratumCtxSubscribe(&s_Upstream);
+        if (State == StratumStateSubscribed) PdqStratumCtxAuthorize(&s_Upstream, "bc1qproxy.fleet", "x");
+        SleepMs(2);
+    }
+    return PdqStratumCtxIsReady(&s_Upstream);
+}
+
+static PdqError_t StartProxy(uint32_t ShareIntervalMs)
+{
+    PdqProxyConfig_t Config;
+    memset(&Config, 0, sizeof(Config));
+    Config.p_BindAddress = "127.0.0.1";
+    Config.Difficulty = TEST_DIFFICULTY;
+    Config.MinDifficulty = TEST_DIFFICULTY / 64.0;
+    Config.ShareIntervalMs = ShareIntervalMs;
+    PdqError_t Err = PdqProxyStart(&Config);
+    if (Err == PdqOk) {
+        PdqProxySetUpstream(&s_Upstream);
+        PdqProxyOnJob();
+    }
+    return Err;
+}
+
+/* First nonce from Start whose hash on the device's current job does (or
+ * does not) meet Difficulty, with the device's extranonce1 and En2 */
+static uint32_t FindNonce(PdqStratumContext_t* p_Dev, const uint8_t* p_En2, double Difficulty,
+                          uint32_t Start, bool Meets)
+{
+    PdqStratumJob_t Job;
+    uint8_t Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t Extranonce1Len = 0;
+    uint8_t Header[80];
+    uint32_t Target[8];
+    uint32_t Hash[8];
+
+    PdqStratumCtxGetJob(p_Dev, &Job);
+    PdqStratumCtxGetExtranonce(p_Dev, Extranonce1, &Extranonce1Len);
+    PdqStratumBuildHeader(&Job, Extranonce1, Extranonce1Len, p_En2,
+                          PdqStratumCtxGetExtranonce2Size(p_Dev), Header);
+    PdqTargetFromDifficulty(Difficulty, Target);
+
+    for (uint32_t Nonce = Start;; Nonce++) {
+        Header[76] = (uint8_t)Nonce;
+        Header[77] = (uint8_t)(Nonce >> 8);
+        Header[78] = (uint8_t)(Nonce >> 16);
+        Header[79] = (uint8_t)(Nonce >> 24);
+        PdqTargetHashHeader(Header, Hash);
+        if ((PdqTargetCompare(Hash, Target) <= 0) == Meets) return Nonce;
+    }
+}
+
+static PdqError_t SubmitNonce(PdqStratumContext_t* p_Dev, const uint8_t* p_En2, uint32_t Nonce)
+{
+    PdqStratumJob_t Job;
+    PdqStratumCtxGetJob(p_Dev, &Job);
+    return PdqStratumCtxSubmitShareBytes(p_Dev, Job.JobId, p_En2, PdqStratumCtxGetExtranonce2Size(p_Dev),
+                                         Nonce, Job.NTime);
+}
+
+/* Plain socket for requests a stratum client would never send */
+static int RawConnect(void)
+{
+    int Fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in Addr;
+    memset(&Addr, 0, sizeof(Addr));
+    Addr.sin_family = AF_INET;
+    Addr.sin_port = htons(PdqProxyGetPort());
+    inet_pton(AF_INET, "127.0.0.1", &Addr.sin_addr);
+    if (Fd < 0 || connect(Fd, (struct sockaddr*)&Addr, sizeof(Addr)) != 0) return -1;
+    return Fd;
+}
+
+static bool RawSend(int Fd, const char* p_Line)
+{
+    size_t Len = strlen(p_Line);
+    return send(Fd, p_Line, Len, 0) == (ssize_t)Len;
+}
+
+/* Pump until a received line contains p_Needle; it is left in p_Out */
+static bool RawReadLine(int Fd, const char* p_Needle, char* p_Out, size_t Size)
+{
+    static char s_Buf[8192];
+    static size_t s_Len = 0;
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+
+    while (GetMillis() < Deadline) {
+        char* Nl;
+        while ((Nl = memchr(s_Buf, '\n', s_Len)) != NULL) {
+            size_t LineLen = (size_t)(Nl - s_Buf);
+            bool Match = false;
+            if (LineLen < Size) {
+                memcpy(p_Out, s_Buf, LineLen);
+                p_Out[LineLen] = '\0';
+                Match = strstr(p_Out, p_Needle) != NULL;
+            }
+            memmove(s_Buf, Nl + 1, s_Len - LineLen - 1);
+            s_Len -= LineLen + 1;
+            if (Match) return true;
+        }
+        Pump();
+        ssize_t N = recv(Fd, s_Buf + s_Len, sizeof(s_Buf) - s_Len, MSG_DONTWAIT);
+        if (N > 0) s_Len += (size_t)N;
+        if (N == 0) break;
+    }
+    s_Len = 0;
+    return false;
+}
+
+/* Pump until a binary message of Type arrives; it is left in p_Out,
+ * which must be 4-byte aligned and PDQ_LAN_MAX_MESSAGE long */
+static size_t RawReadMessage(int Fd, uint8_t Type, void* p_Out)
+{
+    static uint32_t s_Msg[PDQ_LAN_MAX_MESSAGE / 4];
+    size_t Len = 0;
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+
+    while (GetMillis() < Deadline) {
+        int32_t Want = PdqLanMessageLength((const uint8_t*)s_Msg, Len);
+        if (Want < 0) return 0;
+        if (Want > 0 && Len >= (size_t)Want) {
+            Len = 0;
+            if (((const uint8_t*)s_Msg)[3] != Type) continue;
+            memcpy(p_Out, s_Msg, (size_t)Want);
+            return (size_t)Want;
+        }
+        Pump();
+        /* One message at a time: never read past the end of this one */
+        size_t Room = Want > 0 ? (size_t)Want - Len : PDQ_LAN_HEADER_SIZE - Len;
+        ssize_t N = recv(Fd, (uint8_t*)s_Msg + Len, Room, MSG_DONTWAIT);
+        if (N > 0) Len += (size_t)N;
+        if (N == 0) break;
+    }
+    return 0;
+}
+
+static int32_t SendLanShare(int Fd, const PdqShareInfo_t* p_Info)
+{
+    static uint32_t s_Msg[PDQ_LAN_MAX_MESSAGE / 4];
+    PdqLanShare_t Share;
+    PdqLanEncodeShare(p_Info, &Share);
+    if (send(Fd, &Share, sizeof(Share), 0) != (ssize_t)sizeof(Share)) return -1;
+    if (RawReadMessage(Fd, PDQ_LAN_MSG_RESULT, s_Msg) != sizeof(PdqLanResult_t)) return -1;
+    const PdqLanResult_t* p_Result = PdqLanViewResult(s_Msg, sizeof(PdqLanResult_t));
+    if (!p_Result || p_Result->JobTag != Share.JobTag || p_Result->Nonce != Share.Nonce) return -1;
+    return p_Result->Code;
+}
+
+void setUp(void)
+{
+    memset(&s_Pool, 0, sizeof(s_Pool));
+    PdqStratumFlushDnsCache();
+    PdqStratumCtxInit(&s_Upstream);
+    for (int i = 0; i < TEST_DEVICES; i++) {
+        PdqStratumCtxInit(&s_Devices[i]);
+        PdqStratumCtxSetSubmitCallback(&s_Devices[i], PdqTestOnSubmit, &s_Submits);
+    }
+    PdqTestSubmitsReset(&s_Submits);
+
+    /* Upstream session first, then the proxy on top of it */
+    if (PdqFakePoolStart(&s_Pool, 0) != PdqOk) return;
+    ConnectUpstream();
+    PdqStratumCtxHasNewJob(&s_Upstream);
+}
+
+void tearDown(void)
+{
+    PdqProxyStop();
+    for (int i = 0; i < TEST_DEVICES; i++) PdqStratumCtxRelease(&s_Devices[i]);
+    PdqStratumCtxRelease(&s_Upstream);
+    PdqFakePoolStop(&s_Pool);
+}
+
+void Test_Proxy_Subscribe_GivesEachDeviceItsOwnPrefix(void)
+{
+    TEST_ASSERT_TRUE(PdqStratumCtxIsReady(&s_Upstream));
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[1]));
+
+    uint8_t Up[PDQ_STRATUM_MAX_EXTRANONCE_LEN], A[PDQ_STRATUM_MAX_EXTRANONCE_LEN], B[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t UpLen = 0, ALen = 0, BLen = 0;
+    PdqStratumCtxGetExtranonce(&s_Upstream, Up, &UpLen);
+    PdqStratumCtxGetExtranonce(&s_Devices[0], A, &ALen);
+    PdqStratumCtxGetExtranonce(&s_Devices[1], B, &BLen);
+
+    /* 4 upstream extranonce2 bytes: 2 go to the prefix, 2 to the device */
+    TEST_ASSERT_EQUAL_INT(4, PdqStratumCtxGetExtranonce2Size(&s_Upstream));
+    TEST_ASSERT_EQUAL_INT(UpLen + 2, ALen);
+    TEST_ASSERT_EQUAL_INT(UpLen + 2, BLen);
+    TEST_ASSERT_EQUAL_INT(2, PdqStratumCtxGetExtranonce2Size(&s_Devices[0]));
+    TEST_ASSERT_EQUAL_MEMORY(Up, A, UpLen);
+    TEST_ASSERT_EQUAL_MEMORY(Up, B, UpLen);
+    TEST_ASSERT_TRUE(memcmp(A + UpLen, B + UpLen, 2) != 0);
+
+    PdqProxyStats_t Stats;
+    PdqProxyGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(2, Stats.Clients);
+    TEST_ASSERT_EQUAL_INT(1, s_Pool.Connections);
+}
+
+void Test_Proxy_Authorize_SendsCachedJobAtOnce(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+
+    /* The device's job is the pool's, re-serialized, without the pool
+     * having sent anything since the upstream handshake */
+    PdqStratumJob_t Up, Dev;
+    PdqStratumCtxGetJob(&s_Upstream, &Up);
+    PdqStratumCtxGetJob(&s_Devices[0], &Dev);
+    TEST_ASSERT_EQUAL_STRING(Up.JobId, Dev.JobId);
+    TEST_ASSERT_EQUAL_MEMORY(Up.PrevBlockHash, Dev.PrevBlockHash, 32);
+    TEST_ASSERT_EQUAL_INT(Up.Coinbase1Len, Dev.Coinbase1Len);
+    TEST_ASSERT_EQUAL_MEMORY(Up.p_Coinbase1, Dev.p_Coinbase1, Up.Coinbase1Len);
+    TEST_ASSERT_EQUAL_MEMORY(Up.p_Coinbase2, Dev.p_Coinbase2, Up.Coinbase2Len);
+    TEST_ASSERT_EQUAL_INT(Up.MerkleBranchCount, Dev.MerkleBranchCount);
+    TEST_ASSERT_EQUAL_HEX32(Up.NBits, Dev.NBits);
+    TEST_ASSERT_EQUAL_INT(1, s_Pool.Notifies);
+}
+
+void Test_Proxy_ValidShare_AcceptedAndNotForwardedBelowPoolDifficulty(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+
+    /* Found on the device's extranonce1, so it only verifies if the proxy
+     * put the device's prefix in front of its extranonce2 */
+    uint8_t En2[2] = {0x01, 0x00};
+    uint32_t Nonce = FindNonce(&s_Devices[0], En2, TEST_DIFFICULTY, 0, true);
+    TEST_ASSERT_EQUAL_INT(PdqOk, SubmitNonce(&s_Devices[0], En2, Nonce));
+    TEST_ASSERT_TRUE(PumpUntilAnswered(&s_Devices[0]));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitAccepted, s_Submits.LastResult);
+
+    PdqProxyStats_t Stats;
+    PdqProxyGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(1, Stats.SharesAccepted);
+    TEST_ASSERT_EQUAL_INT(0, Stats.SharesForwarded);
+    TEST_ASSERT_TRUE(Stats.TotalHashes >= 65536);
+    TEST_ASSERT_EQUAL_INT(0, s_Pool.Submits);
+}
+
+void Test_Proxy_DuplicateShare_Rejected(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+
+    uint8_t En2[2] = {0x02, 0x00};
+    uint32_t Nonce = FindNonce(&s_Devices[0], En2, TEST_DIFFICULTY, 0, true);
+    TEST_ASSERT_EQUAL_INT(PdqOk, SubmitNonce(&s_Devices[0], En2, Nonce));
+    TEST_ASSERT_TRUE(PumpUntilAnswered(&s_Devices[0]));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitAccepted, s_Submits.LastResult);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, SubmitNonce(&s_Devices[0], En2, Nonce));
+    TEST_ASSERT_TRUE(PumpUntilAnswered(&s_Devices[0]));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitRejected, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_INT(22, s_Submits.LastCode);
+
+    PdqProxyStats_t Stats;
+    PdqProxyGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(1, Stats.SharesAccepted);
+    TEST_ASSERT_EQUAL_INT(1, Stats.SharesDuplicate);
+}
+
+void Test_Proxy_LowDifficultyShare_Rejected(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+
+    uint8_t En2[2] = {0x03, 0x00};
+    uint32_t Nonce = FindNonce(&s_Devices[0], En2, TEST_DIFFICULTY, 0, false);
+    TEST_ASSERT_EQUAL_INT(PdqOk, SubmitNonce(&s_Devices[0], En2, Nonce));
+    TEST_ASSERT_TRUE(PumpUntilAnswered(&s_Devices[0]));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitRejected, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_INT(23, s_Submits.LastCode);
+}
+
+void Test_Proxy_UnknownJobAndBadRequests_Rejected(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    int Fd = RawConnect();
+    TEST_ASSERT_TRUE(Fd >= 0);
+
+    char Line[2048];
+    TEST_ASSERT_TRUE(RawSend(Fd, "{\"id\":1,\"method\":\"mining.authorize\",\"params\":[\"w\",\"x\"]}\n"));
+    TEST_ASSERT_TRUE(RawReadLine(Fd, "\"id\":1", Line, sizeof(Line)));
+    TEST_ASSERT_NOT_NULL(strstr(Line, "[25,"));
+
+    TEST_ASSERT_TRUE(RawSend(Fd, "{\"id\":2,\"method\":\"mining.subscribe\",\"params\":[\"raw/1.0\"]}\n"
+                                 "{\"id\":3,\"method\":\"mining.authorize\",\"params\":[\"w\",\"x\"]}\n"));
+    TEST_ASSERT_TRUE(RawReadLine(Fd, "\"id\":2", Line, sizeof(Line)));
+    TEST_ASSERT_TRUE(RawReadLine(Fd, "mining.notify", Line, sizeof(Line)));
+
+    TEST_ASSERT_TRUE(RawSend(Fd, "{\"id\":4,\"method\":\"mining.submit\","
+                                 "\"params\":[\"w\",\"nosuchjob\",\"0000\",\"69a20ee6\",\"00000000\"]}\n"));
+    TEST_ASSERT_TRUE(RawReadLine(Fd, "\"id\":4", Line, sizeof(Line)));
+    TEST_ASSERT_NOT_NULL(strstr(Line, "[21,"));
+
+    /* Extranonce2 one byte short */
+    TEST_ASSERT_TRUE(RawSend(Fd, "{\"id\":5,\"method\":\"mining.submit\","
+                                 "\"params\":[\"w\",\"1eaa720\",\"00\",\"69a20ee6\",\"00000000\"]}\n"));
+    TEST_ASSERT_TRUE(RawReadLine(Fd, "\"id\":5", Line, sizeof(Line)));
+    TEST_ASSERT_NOT_NULL(strstr(Line, "[20,"));
+
+    TEST_ASSERT_TRUE(RawSend(Fd, "{\"id\":\"six\",\"method\":\"mining.configure\",\"params\":[]}\n"));
+    TEST_ASSERT_TRUE(RawReadLine(Fd, "\"id\":\"six\"", Line, sizeof(Line)));
+    TEST_ASSERT_NOT_NULL(strstr(Line, "[20,"));
+
+    PdqProxyStats_t Stats;
+    PdqProxyGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(1, Stats.SharesStale);
+    TEST_ASSERT_EQUAL_INT(1, Stats.SharesRejected);
+    close(Fd);
+}
+
+void Test_Proxy_Reconnect_ResumesSamePrefix(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+
+    uint8_t Before[PDQ_STRATUM_MAX_EXTRANONCE_LEN], After[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t BeforeLen = 0, AfterLen = 0;
+    PdqStratumCtxGetExtranonce(&s_Devices[0], Before, &BeforeLen);
+
+    /* Another device connecting meanwhile must not get the parked prefix */
+    PdqStratumCtxDisconnect(&s_Devices[0]);
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[1]));
+    PdqStratumCtxGetExtranonce(&s_Devices[1], After, &AfterLen);
+    TEST_ASSERT_TRUE(memcmp(Before, After, BeforeLen) != 0);
+
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+    PdqStratumCtxGetExtranonce(&s_Devices[0], After, &AfterLen);
+    TEST_ASSERT_EQUAL_INT(BeforeLen, AfterLen);
+    TEST_ASSERT_EQUAL_MEMORY(Before, After, BeforeLen);
+    TEST_ASSERT_TRUE(s_Devices[0].Resumed);
+
+    PdqProxyStats_t Stats;
+    PdqProxyGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(1, Stats.Resumes);
+}
+
+void Test_Proxy_UpstreamReconnect_PastFdSetSize(void)
+{
+    /* Enough devices to take the descriptors up to FD_SETSIZE: each holds
+     * two here, ours and the proxy's */
+    int Raw[TEST_FD_DEVICES];
+    static int Held[FD_SETSIZE];
+    int HeldCount = 0;
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    for (int i = 0; i < TEST_FD_DEVICES; i++) {
+        Raw[i] = RawConnect();
+        TEST_ASSERT_TRUE(Raw[i] >= 0);
+        PdqEventRunOnce(0);
+    }
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    PdqProxyStats_t Stats;
+    do {
+        PdqEventRunOnce(1);
+        PdqProxyGetStats(&Stats);
+    } while (GetMillis() < Deadline && Stats.Clients < TEST_FD_DEVICES);
+    TEST_ASSERT_EQUAL_INT(TEST_FD_DEVICES, Stats.Clients);
+
+    atomic_store(&s_Pool.DropClients, 1);
+    Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && PdqStratumCtxGetState(&s_Upstream) != StratumStateDisconnected) Pump();
+
+    /* Hold the holes the old upstream left so the new one lands past them */
+    int Null = open("/dev/null", O_RDONLY);
+    TEST_ASSERT_TRUE(Null >= 0);
+    for (int Fd = dup(Null); Fd >= 0; Fd = dup(Null)) {
+        if (Fd >= FD_SETSIZE || HeldCount == FD_SETSIZE) {
+            close(Fd);
+            break;
+        }
+        Held[HeldCount++] = Fd;
+    }
+    TEST_ASSERT_TRUE(ConnectUpstream());
+    TEST_ASSERT_TRUE(PdqStratumCtxGetSocket(&s_Upstream) >= FD_SETSIZE);
+    PdqProxyOnJob();
+
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+    for (int i = 0; i < TEST_FD_DEVICES; i++) close(Raw[i]);
+    for (int i = 0; i < HeldCount; i++) close(Held[i]);
+    close(Null);
+}
+
+void Test_Proxy_FastDevice_DifficultyRaised(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(20000));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+
+    /* Sixteen shares in well under a second is far off a 20 s target */
+    uint8_t En2[2] = {0x04, 0x00};
+    uint32_t Nonce = 0;
+    for (int i = 0; i < 16; i++) {
+        Nonce = FindNonce(&s_Devices[0], En2, TEST_DIFFICULTY, Nonce, true);
+        TEST_ASSERT_EQUAL_INT(PdqOk, SubmitNonce(&s_Devices[0], En2, Nonce));
+        TEST_ASSERT_TRUE(PumpUntilAnswered(&s_Devices[0]));
+        TEST_ASSERT_EQUAL_INT(PdqSubmitAccepted, s_Submits.LastResult);
+        Nonce++;
+    }
+
+    PdqProxyStats_t Stats;
+    PdqProxyGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(16, Stats.SharesAccepted);
+    TEST_ASSERT_EQUAL_INT(1, Stats.Retargets);
+}
+
+void Test_Proxy_UpstreamExtranonceChange_RekeysDevices(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+
+    /* The pool moves to a 2-byte extranonce2: one prefix byte is left, so
+     * the layout changes and devices must come back for it */
+    atomic_store(&s_Pool.SetExtranonce, 1);
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && PdqStratumCtxIsReady(&s_Devices[0])) Pump();
+    TEST_ASSERT_FALSE(PdqStratumCtxIsReady(&s_Devices[0]));
+
+    TEST_ASSERT_TRUE(ConnectDevice(&s_Devices[0]));
+    uint8_t Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t Len = 0;
+    PdqStratumCtxGetExtranonce(&s_Devices[0], Extranonce1, &Len);
+    const uint8_t Expected[4] = {0xc0, 0xff, 0xee, 0x01};
+    TEST_ASSERT_EQUAL_INT(5, Len);
+    TEST_ASSERT_EQUAL_MEMORY(Expected, Extranonce1, 4);
+    TEST_ASSERT_EQUAL_INT(1, PdqStratumCtxGetExtranonce2Size(&s_Devices[0]));
+}
+
+void Test_Proxy_BinaryDevice_MinesReadyMadeWork(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, StartProxy(0));
+    int Fd = RawConnect();
+    TEST_ASSERT_TRUE(Fd >= 0);
+
+    PdqLanWorkRequest_t Request;
+    PdqLanEncodeWorkRequest("bc1qdevice.esp8266", &Request);
+    TEST_ASSERT_TRUE(send(Fd, &Request, sizeof(Request), 0) == (ssize_t)sizeof(Request));
+
+    static uint32_t s_Msg[PDQ_LAN_MAX_MESSAGE / 4];
+    TEST_ASSERT_EQUAL_INT(sizeof(PdqLanWork_t), RawReadMessage(Fd, PDQ_LAN_MSG_WORK, s_Msg));
+    const PdqLanWork_t* p_Work = PdqLanViewWork(s_Msg, sizeof(PdqLanWork_t));
+    TEST_ASSERT_NOT_NULL(p_Work);
+    TEST_ASSERT_TRUE(p_Work->Flags & PDQ_LAN_WORK_CLEAN);
+
+    /* Searched on the decoded job alone, with no Stratum code at all */
+    PdqMiningJob_t Job;
+    PdqLanWorkToJob(p_Work, &Job);
+    uint32_t Nonce = 0;
+    uint32_t Hash[8];
+    for (;; Nonce++) {
+        PdqTargetHashJob(&Job, Nonce, Hash);
+        if (PdqTargetCompare(Hash, Job.Target) <= 0) break;
+    }
+
+    PdqShareInfo_t Info;
+    memset(&Info, 0, sizeof(Info));
+    strcpy(Info.JobId, Job.JobId);
+    Info.Extranonce2 = Job.Extranonce2;
+    Info.Nonce = Nonce;
+    Info.NTime = Job.NTime;
+    TEST_ASSERT_EQUAL_INT(0, SendLanShare(Fd, &Info));
+    TEST_ASSERT_EQUAL_INT(22, SendLanShare(Fd, &Info));
+    Info.Nonce = Nonce + 1;
+    strcpy(Info.JobId, "0000ffff");
+    TEST_ASSERT_EQUAL_INT(21, SendLanShare(Fd, &Info));
+
+    /* Asking again rolls extranonce2: new work, new tag */
+    TEST_ASSERT_TRUE(send(Fd, &Request, sizeof(Request), 0) == (ssize_t)sizeof(Request));
+    TEST_ASSERT_EQUAL_INT(sizeof(PdqLanWork_t), RawReadMessage(Fd, PDQ_LAN_MSG_WORK, s_Msg));
+    TEST_ASSERT_TRUE(p_Work->JobTag != (uint32_t)strtoul(Job.JobId, NULL, 16));
+    TEST_ASSERT_TRUE(memcmp(p_Work->Midstate, Job.Midstate, 32) != 0);
+
+    PdqProxyStats_t Stats;
+    PdqProxyGetStats(&Stats);
+    TEST_ASSERT_EQUAL_INT(1, Stats.Clients);
+    TEST_ASSERT_EQUAL_INT(1, Stats.SharesAccepted);
+    TEST_ASSERT_EQUAL_INT(1, Stats.SharesDuplicate);
+    TEST_ASSERT_EQUAL_INT(1, Stats.SharesStale);
+    close(Fd);
+}
+
+int main(void)
+{
+    if (PdqEventLoopInit() != PdqOk) return 1;
+    UNITY_BEGIN();
+    RUN_TEST(Test_Proxy_Subscribe_GivesEachDeviceItsOwnPrefix);
+    RUN_TEST(Test_Proxy_Authorize_SendsCachedJobAtOnce);
+    RUN_TEST(Test_Proxy_ValidShare_AcceptedAndNotForwardedBelowPoolDifficulty);
+    RUN_TEST(Test_Proxy_DuplicateShare_Rejected);
+    RUN_TEST(Test_Proxy_LowDifficultyShare_Rejected);
+    RUN_TEST(Test_Proxy_UnknownJobAndBadRequests_Rejected);
+    RUN_TEST(Test_Proxy_Reconnect_ResumesSamePrefix);
+    RUN_TEST(Test_Proxy_UpstreamReconnect_PastFdSetSize);
+    RUN_TEST(Test_Proxy_FastDevice_DifficultyRaised);
+    RUN_TEST(Test_Proxy_UpstreamExtranonceChange_RekeysDevices);
+    RUN_TEST(Test_Proxy_BinaryDevice_MinesReadyMadeWork);
+    int Result = UNITY_END();
+    PdqEventLoopDestroy();
+    return Result;
+}
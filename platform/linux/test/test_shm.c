@@ -0,0 +1,192 @@
+/**
+ * @file test_shm.c
+ * @brief Shared-memory stats: publish, read, history ring and seqlock
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "linux_shm.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static char           s_Name[32];
+static PdqShmWriter_t s_Writer;
+static PdqShmReader_t s_Reader;
+static PdqShmStats_t  s_In;
+static PdqShmStats_t  s_Out;
+static atomic_int     s_Stop;
+
+/* Totals derived from one number, so a torn copy shows */
+static void Fill(PdqShmStats_t* p_Stats, uint32_t Second)
+{
+    memset(p_Stats, 0, sizeof(*p_Stats));
+    p_Stats->UpdatedMs = 1700000000000ull + (uint64_t)Second * 1000;
+    p_Stats->UptimeSec = Second;
+    snprintf(p_Stats->Mode, sizeof(p_Stats->Mode), "pool");
+    p_Stats->Total.HashRate = 1000 + Second;
+    p_Stats->Total.TotalHashes = (uint64_t)Second * 1000;
+    p_Stats->Total.SharesAccepted = Second;
+    p_Stats->ThreadCount = PDQ_SHM_MAX_THREADS;
+    for (uint32_t i = 0; i < PDQ_SHM_MAX_THREADS; i++) {
+        p_Stats->ThreadHashRate[i] = Second;
+        p_Stats->ThreadHashes[i] = Second;
+    }
+    p_Stats->PoolCount = 1;
+    snprintf(p_Stats->Pools[0].Host, sizeof(p_Stats->Pools[0].Host), "pool.example");
+    p_Stats->Pools[0].Port = 3333;
+    p_Stats->Pools[0].Ready = 1;
+    p_Stats->Pools[0].Stats.SharesAccepted = Second;
+}
+
+void setUp(void)
+{
+    snprintf(s_Name, sizeof(s_Name), "pdqtest-%ld", (long)getpid());
+    memset(&s_Reader, 0, sizeof(s_Reader));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmWriterOpen(&s_Writer, s_Name));
+}
+
+void tearDown(void)
+{
+    PdqShmReaderClose(&s_Reader);
+    PdqShmWriterClose(&s_Writer);
+}
+
+void Test_Shm_Open_RejectsBadNames(void)
+{
+    PdqShmWriter_t Writer;
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqShmWriterOpen(&Writer, ""));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqShmWriterOpen(&Writer, "a/b"));
+    TEST_ASSERT_EQUAL_INT(PdqErrorNotConnected, PdqShmReaderOpen(&s_Reader, "pdqtest-missing"));
+}
+
+void Test_Shm_Publish_ReadBack(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmReaderOpen(&s_Reader, s_Name));
+    TEST_ASSERT_EQUAL_INT((int)getpid(), (int)PdqShmReaderGetPid(&s_Reader));
+
+    /* Fresh region: nothing published yet */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmRead(&s_Reader, &s_Out));
+    TEST_ASSERT_EQUAL_UINT32(0, s_Out.HistoryCount);
+    TEST_ASSERT_NULL(PdqShmHistoryAt(&s_Out, 0));
+
+    Fill(&s_In, 7);
+    PdqShmPublish(&s_Writer, &s_In);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmRead(&s_Reader, &s_Out));
+    TEST_ASSERT_EQUAL_STRING("pool", s_Out.Mode);
+    TEST_ASSERT_EQUAL_UINT32(1007, s_Out.Total.HashRate);
+    TEST_ASSERT_EQUAL_UINT32(PDQ_SHM_MAX_THREADS, s_Out.ThreadCount);
+    TEST_ASSERT_EQUAL_UINT32(7, s_Out.ThreadHashRate[PDQ_SHM_MAX_THREADS - 1]);
+    TEST_ASSERT_EQUAL_STRING("pool.example", s_Out.Pools[0].Host);
+    TEST_ASSERT_EQUAL_UINT32(7, s_Out.Pools[0].Stats.SharesAccepted);
+
+    const PdqShmSample_t* p_Sample = PdqShmHistoryAt(&s_Out, 0);
+    TEST_ASSERT_NOT_NULL(p_Sample);
+    TEST_ASSERT_EQUAL_UINT32(1007, p_Sample->HashRate);
+    TEST_ASSERT_TRUE(p_Sample->TimeMs == s_In.UpdatedMs);
+    TEST_ASSERT_TRUE(p_Sample->TotalHashes == 7000);
+}
+
+void Test_Shm_History_WrapsNewestFirst(void)
+{
+    uint32_t Total = PDQ_SHM_HISTORY + 25;
+    for (uint32_t s = 1; s <= Total; s++) {
+        Fill(&s_In, s);
+        PdqShmPublish(&s_Writer, &s_In);
+    }
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmReaderOpen(&s_Reader, s_Name));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmRead(&s_Reader, &s_Out));
+    TEST_ASSERT_EQUAL_UINT32(PDQ_SHM_HISTORY, s_Out.HistoryCount);
+    TEST_ASSERT_EQUAL_UINT32(Total, PdqShmHistoryAt(&s_Out, 0)->SharesAccepted);
+    TEST_ASSERT_EQUAL_UINT32(Total - 1, PdqShmHistoryAt(&s_Out, 1)->SharesAccepted);
+    TEST_ASSERT_EQUAL_UINT32(Total - PDQ_SHM_HISTORY + 1,
+                             PdqShmHistoryAt(&s_Out, PDQ_SHM_HISTORY - 1)->SharesAccepted);
+    TEST_ASSERT_NULL(PdqShmHistoryAt(&s_Out, PDQ_SHM_HISTORY));
+}
+
+void Test_Shm_Reopen_KeepsHistory(void)
+{
+    for (uint32_t s = 1; s <= 5; s++) {
+        Fill(&s_In, s);
+        PdqShmPublish(&s_Writer, &s_In);
+    }
+    /* A restarted or upgraded miner takes the region over */
+    munmap(s_Writer.p_Region, sizeof(PdqShmRegion_t));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmWriterOpen(&s_Writer, s_Name));
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmReaderOpen(&s_Reader, s_Name));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmRead(&s_Reader, &s_Out));
+    TEST_ASSERT_EQUAL_UINT32(5, s_Out.HistoryCount);
+    TEST_ASSERT_EQUAL_UINT32(0, s_Out.Total.HashRate);
+    TEST_ASSERT_EQUAL_UINT32(5, PdqShmHistoryAt(&s_Out, 0)->SharesAccepted);
+}
+
+void Test_Shm_Reader_RefusesOtherVersion(void)
+{
+    s_Writer.p_Region->Version = PDQ_SHM_VERSION + 1;
+    TEST_ASSERT_EQUAL_INT(PdqErrorParse, PdqShmReaderOpen(&s_Reader, s_Name));
+}
+
+void Test_Shm_Read_StuckWriterTimesOut(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmReaderOpen(&s_Reader, s_Name));
+    atomic_fetch_add(&s_Writer.p_Region->Seq, 1);
+    TEST_ASSERT_EQUAL_INT(PdqErrorTimeout, PdqShmRead(&s_Reader, &s_Out));
+    atomic_fetch_add(&s_Writer.p_Region->Seq, 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmRead(&s_Reader, &s_Out));
+}
+
+static void* PublishLoop(void* p_Arg)
+{
+    static PdqShmStats_t Stats;
+    (void)p_Arg;
+    for (uint32_t s = 1; !atomic_load(&s_Stop); s++) {
+        Fill(&Stats, s);
+        PdqShmPublish(&s_Writer, &Stats);
+    }
+    return NULL;
+}
+
+void Test_Shm_Read_NeverTorn(void)
+{
+    pthread_t Thread;
+    atomic_store(&s_Stop, 0);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmReaderOpen(&s_Reader, s_Name));
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&Thread, NULL, PublishLoop, NULL));
+
+    uint32_t Torn = 0;
+    uint32_t Last = 0;
+    for (int i = 0; i < 20000; i++) {
+        TEST_ASSERT_EQUAL_INT(PdqOk, PdqShmRead(&s_Reader, &s_Out));
+        uint32_t Second = s_Out.UptimeSec;
+        bool Same = s_Out.Total.SharesAccepted == Second && s_Out.Pools[0].Stats.SharesAccepted == Second;
+        for (uint32_t t = 0; t < s_Out.ThreadCount; t++) {
+            Same = Same && s_Out.ThreadHashRate[t] == Second && s_Out.ThreadHashes[t] == Second;
+        }
+        const PdqShmSample_t* p_Newest = PdqShmHistoryAt(&s_Out, 0);
+        Same = Same && (Second == 0 || (p_Newest && p_Newest->SharesAccepted == Second));
+        if (!Same || Second < Last) Torn++;
+        Last = Second;
+    }
+    atomic_store(&s_Stop, 1);
+    pthread_join(Thread, NULL);
+    TEST_ASSERT_EQUAL_UINT32(0, Torn);
+    TEST_ASSERT_TRUE(Last > 0);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_Shm_Open_RejectsBadNames);
+    RUN_TEST(Test_Shm_Publish_ReadBack);
+    RUN_TEST(Test_Shm_History_WrapsNewestFirst);
+    RUN_TEST(Test_Shm_Reopen_KeepsHistory);
+    RUN_TEST(Test_Shm_Reader_RefusesOtherVersion);
+    RUN_TEST(Test_Shm_Read_StuckWriterTimesOut);
+    RUN_TEST(Test_Shm_Read_NeverTorn);
+    return UNITY_END();
+}
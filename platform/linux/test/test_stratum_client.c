@@ -0,0 +1,587 @@
+/**
+ * @file test_stratum_client.c
+ * @brief Stratum client connection and submit tests against an in-process fake pool
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "fake_pool.h"
+#include "stratum/stratum_client.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define TEST_WAIT_MS    5000
+
+static PdqFakePool_t       s_Pool;
+static PdqStratumContext_t s_Ctx;
+
+/* Drive the context until it leaves the resolving and connecting stages */
+static PdqStratumState_t RunConnect(void)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline) {
+        PdqStratumCtxProcess(&s_Ctx);
+        PdqStratumState_t State = PdqStratumCtxGetState(&s_Ctx);
+        if (State != StratumStateResolving && State != StratumStateConnecting) return State;
+        SleepMs(5);
+    }
+    return PdqStratumCtxGetState(&s_Ctx);
+}
+
+static bool RunHandshakeTo(PdqStratumState_t Target)
+{
+    return PdqFakePoolHandshake(&s_Pool, &s_Ctx, Target, TEST_WAIT_MS);
+}
+
+/* Complete the handshake up to the first job */
+static bool RunHandshake(void)
+{
+    return RunHandshakeTo(StratumStateReady);
+}
+
+/* Process until no submit is pending any more */
+static bool RunUntilAnswered(void)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && PdqStratumCtxGetPendingSubmits(&s_Ctx) > 0) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+    return PdqStratumCtxGetPendingSubmits(&s_Ctx) == 0;
+}
+
+static PdqTestSubmits_t s_Submits;
+
+void setUp(void)
+{
+    memset(&s_Pool, 0, sizeof(s_Pool));
+    PdqStratumFlushDnsCache();
+    PdqStratumCtxInit(&s_Ctx);
+    PdqStratumCtxSetSubmitCallback(&s_Ctx, PdqTestOnSubmit, &s_Submits);
+    PdqTestSubmitsReset(&s_Submits);
+}
+
+void tearDown(void)
+{
+    PdqStratumCtxRelease(&s_Ctx);
+    PdqFakePoolStop(&s_Pool);
+}
+
+void Test_StratumClient_ConnectStart_Localhost_ReachesPool(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+
+    /* localhost may resolve to ::1 first; the pool only listens on IPv4,
+     * so the refused attempt must hand over to the next address */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxConnectStart(&s_Ctx, "localhost", s_Pool.Port));
+    TEST_ASSERT_EQUAL_INT(StratumStateConnected, RunConnect());
+    TEST_ASSERT_TRUE(PdqStratumCtxGetSocket(&s_Ctx) >= 0);
+    TEST_ASSERT_EQUAL_INT(-1, PdqStratumCtxGetWakeupMs(&s_Ctx));
+}
+
+void Test_StratumClient_ConnectStart_CachedHost_SkipsResolve(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxConnectStart(&s_Ctx, "localhost", s_Pool.Port));
+    TEST_ASSERT_EQUAL_INT(StratumStateConnected, RunConnect());
+    PdqStratumCtxDisconnect(&s_Ctx);
+
+    /* Second connect goes straight to connecting from the cache */
+    PdqStratumCtxConnectStart(&s_Ctx, "localhost", s_Pool.Port);
+    TEST_ASSERT_TRUE(PdqStratumCtxGetState(&s_Ctx) >= StratumStateConnecting);
+    TEST_ASSERT_EQUAL_INT(StratumStateConnected, RunConnect());
+    PdqStratumCtxDisconnect(&s_Ctx);
+
+    PdqStratumFlushDnsCache();
+    PdqStratumCtxConnectStart(&s_Ctx, "localhost", s_Pool.Port);
+    TEST_ASSERT_EQUAL_INT(StratumStateResolving, PdqStratumCtxGetState(&s_Ctx));
+    TEST_ASSERT_EQUAL_INT(StratumStateConnected, RunConnect());
+}
+
+void Test_StratumClient_ConnectStart_AllAddressesRefused_ForgetsCache(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    uint16_t Port = s_Pool.Port;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxConnectStart(&s_Ctx, "localhost", Port));
+    TEST_ASSERT_EQUAL_INT(StratumStateConnected, RunConnect());
+    PdqStratumCtxDisconnect(&s_Ctx);
+    PdqFakePoolStop(&s_Pool);
+
+    PdqStratumCtxConnectStart(&s_Ctx, "localhost", Port);
+    TEST_ASSERT_EQUAL_INT(StratumStateDisconnected, RunConnect());
+
+    /* A failed cached entry is not trusted for the next attempt */
+    PdqStratumCtxConnectStart(&s_Ctx, "localhost", Port);
+    TEST_ASSERT_EQUAL_INT(StratumStateResolving, PdqStratumCtxGetState(&s_Ctx));
+}
+
+void Test_StratumClient_GetPollFds_Connected_ReturnsSocket(void)
+{
+    int Fds[PDQ_STRATUM_MAX_ADDRS];
+    bool WantWrite = true;
+    TEST_ASSERT_EQUAL_INT(0, PdqStratumCtxGetPollFds(&s_Ctx, Fds, PDQ_STRATUM_MAX_ADDRS, &WantWrite));
+    TEST_ASSERT_FALSE(WantWrite);
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxConnect(&s_Ctx, "127.0.0.1", s_Pool.Port));
+    TEST_ASSERT_EQUAL_INT(1, PdqStratumCtxGetPollFds(&s_Ctx, Fds, PDQ_STRATUM_MAX_ADDRS, &WantWrite));
+    TEST_ASSERT_EQUAL_INT(PdqStratumCtxGetSocket(&s_Ctx), Fds[0]);
+    TEST_ASSERT_FALSE(WantWrite);
+}
+
+void Test_StratumClient_SubmitShare_Accepted_RecordsLatency(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 1, 0x1234, 0x69a20ee6));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 2, 0x5678, 0x69a20ee6));
+    TEST_ASSERT_EQUAL_UINT32(2, PdqStratumCtxGetPendingSubmits(&s_Ctx));
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+
+    PdqStratumSubmitStats_t Stats;
+    PdqStratumCtxGetSubmitStats(&s_Ctx, &Stats);
+    TEST_ASSERT_EQUAL_UINT32(2, Stats.Submitted);
+    TEST_ASSERT_EQUAL_UINT32(2, Stats.Accepted);
+    TEST_ASSERT_EQUAL_UINT32(0, Stats.Rejected);
+
+    uint32_t Samples = 0;
+    for (int i = 0; i < PDQ_SUBMIT_LATENCY_BUCKETS; i++) Samples += Stats.LatencyHist[i];
+    TEST_ASSERT_EQUAL_UINT32(2, Samples);
+    TEST_ASSERT_EQUAL_UINT32(2, s_Submits.Callbacks);
+    TEST_ASSERT_EQUAL_INT(PdqSubmitAccepted, s_Submits.LastResult);
+}
+
+void Test_StratumClient_SubmitShare_Rejected_CountsByCode(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    atomic_store(&s_Pool.RejectSubmits, 1);
+
+    PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 1, 0x1234, 0x69a20ee6);
+    PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 2, 0x5678, 0x69a20ee6);
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+
+    PdqStratumSubmitStats_t Stats;
+    PdqStratumCtxGetSubmitStats(&s_Ctx, &Stats);
+    TEST_ASSERT_EQUAL_UINT32(0, Stats.Accepted);
+    TEST_ASSERT_EQUAL_UINT32(2, Stats.Rejected);
+    TEST_ASSERT_EQUAL_INT32(23, Stats.RejectCodes[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, Stats.RejectCounts[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, Stats.RejectCounts[1]);
+    TEST_ASSERT_EQUAL_INT(PdqSubmitRejected, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_INT32(23, s_Submits.LastCode);
+}
+
+void Test_StratumClient_SubmitShare_NoReply_TimesOut(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    atomic_store(&s_Pool.IgnoreSubmits, 1);
+    s_Ctx.SubmitTimeoutMs = 100;
+
+    PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 1, 0x1234, 0x69a20ee6);
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+
+    PdqStratumSubmitStats_t Stats;
+    PdqStratumCtxGetSubmitStats(&s_Ctx, &Stats);
+    TEST_ASSERT_EQUAL_UINT32(1, Stats.TimedOut);
+    TEST_ASSERT_EQUAL_UINT32(0, Stats.Accepted);
+    TEST_ASSERT_EQUAL_INT(PdqSubmitTimedOut, s_Submits.LastResult);
+    TEST_ASSERT_TRUE(PdqStratumCtxIsReady(&s_Ctx));
+}
+
+void Test_StratumClient_Disconnect_PendingSubmits_CountedAsTimedOut(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    atomic_store(&s_Pool.IgnoreSubmits, 1);
+
+    PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 1, 0x1234, 0x69a20ee6);
+    PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 2, 0x5678, 0x69a20ee6);
+    PdqStratumCtxDisconnect(&s_Ctx);
+
+    PdqStratumSubmitStats_t Stats;
+    PdqStratumCtxGetSubmitStats(&s_Ctx, &Stats);
+    TEST_ASSERT_EQUAL_UINT32(2, Stats.TimedOut);
+    TEST_ASSERT_EQUAL_UINT32(0, PdqStratumCtxGetPendingSubmits(&s_Ctx));
+    TEST_ASSERT_EQUAL_UINT32(2, s_Submits.Callbacks);
+}
+
+void Test_StratumClient_SubmitShare_TableFull_EvictsOldest(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    atomic_store(&s_Pool.IgnoreSubmits, 1);
+
+    for (uint32_t i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS + 3; i++) {
+        PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", i, i, 0x69a20ee6);
+    }
+
+    PdqStratumSubmitStats_t Stats;
+    PdqStratumCtxGetSubmitStats(&s_Ctx, &Stats);
+    TEST_ASSERT_EQUAL_UINT32(PDQ_STRATUM_MAX_PENDING_SUBMITS, PdqStratumCtxGetPendingSubmits(&s_Ctx));
+    TEST_ASSERT_EQUAL_UINT32(PDQ_STRATUM_MAX_PENDING_SUBMITS + 3, Stats.Submitted);
+    TEST_ASSERT_EQUAL_UINT32(3, Stats.TimedOut);
+}
+
+void Test_StratumClient_Cork_BurstOfSubmits_OneWrite(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+
+    PdqStratumTxStats_t Before;
+    PdqStratumCtxGetTxStats(&s_Ctx, &Before);
+
+    PdqStratumCtxCork(&s_Ctx, true);
+    for (uint32_t i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", i, i, 0x69a20ee6));
+    }
+    TEST_ASSERT_TRUE(PdqStratumCtxGetTxQueued(&s_Ctx) > 0);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxCork(&s_Ctx, false));
+
+    PdqStratumTxStats_t After;
+    PdqStratumCtxGetTxStats(&s_Ctx, &After);
+    TEST_ASSERT_EQUAL_UINT32(0, PdqStratumCtxGetTxQueued(&s_Ctx));
+    TEST_ASSERT_EQUAL_UINT32(Before.Writes + 1, After.Writes);
+    TEST_ASSERT_EQUAL_UINT32(Before.Messages + 10, After.Messages);
+
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+    PdqStratumSubmitStats_t Stats;
+    PdqStratumCtxGetSubmitStats(&s_Ctx, &Stats);
+    TEST_ASSERT_EQUAL_UINT32(10, Stats.Accepted);
+}
+
+void Test_StratumClient_Flush_PeerStalled_QueuesUntilWritable(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxConnect(&s_Ctx, "127.0.0.1", s_Pool.Port));
+    atomic_store(&s_Pool.Stalled, 1);
+
+    /* Keep the kernel buffers small so the queue backs up quickly */
+    int SndBuf = 4096;
+    setsockopt(PdqStratumCtxGetSocket(&s_Ctx), SOL_SOCKET, SO_SNDBUF, &SndBuf, sizeof(SndBuf));
+
+    PdqError_t Err = PdqOk;
+    for (int i = 0; i < 100000 && Err == PdqOk; i++) {
+        Err = PdqStratumCtxSuggestDifficulty(&s_Ctx, 1.0 + i);
+    }
+    TEST_ASSERT_EQUAL_INT(PdqErrorBufferTooSmall, Err);
+
+    PdqStratumTxStats_t Tx;
+    PdqStratumCtxGetTxStats(&s_Ctx, &Tx);
+    TEST_ASSERT_TRUE(Tx.PartialWrites > 0);
+    TEST_ASSERT_EQUAL_UINT32(1, Tx.Overflows);
+    TEST_ASSERT_TRUE(PdqStratumCtxGetTxQueued(&s_Ctx) > 0);
+
+    int Fds[PDQ_STRATUM_MAX_ADDRS];
+    bool WantWrite = false;
+    TEST_ASSERT_EQUAL_INT(1, PdqStratumCtxGetPollFds(&s_Ctx, Fds, PDQ_STRATUM_MAX_ADDRS, &WantWrite));
+    TEST_ASSERT_TRUE(WantWrite);
+
+    /* Once the pool reads again, processing drains the rest */
+    atomic_store(&s_Pool.Stalled, 0);
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && PdqStratumCtxGetTxQueued(&s_Ctx) > 0) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, PdqStratumCtxGetTxQueued(&s_Ctx));
+    PdqStratumCtxGetPollFds(&s_Ctx, Fds, PDQ_STRATUM_MAX_ADDRS, &WantWrite);
+    TEST_ASSERT_FALSE(WantWrite);
+    TEST_ASSERT_TRUE(PdqStratumCtxIsConnected(&s_Ctx));
+}
+
+void Test_StratumClient_Process_LongNotify_BufferGrows(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    atomic_store(&s_Pool.PadCoinbase, 6000);
+    TEST_ASSERT_TRUE(RunHandshake());
+
+    PdqStratumJob_t Job;
+    PdqStratumCtxGetJob(&s_Ctx, &Job);
+    TEST_ASSERT_EQUAL_STRING("1eaa720", Job.JobId);
+    TEST_ASSERT_EQUAL_UINT32(57 + 6000, Job.Coinbase1Len);
+    TEST_ASSERT_EQUAL_INT(1, Job.MerkleBranchCount);
+    TEST_ASSERT_TRUE(s_Ctx.RecvSize > PDQ_STRATUM_RECV_BUFFER_SIZE);
+    TEST_ASSERT_EQUAL_UINT32(0, s_Ctx.RxMalformed);
+}
+
+void Test_StratumClient_Process_LineOverMax_DroppedAndResynced(void)
+{
+    s_Pool.NotifyIntervalMs = 50;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    PdqStratumCtxHasNewJob(&s_Ctx);
+
+    atomic_store(&s_Pool.PadCoinbase, PDQ_STRATUM_RECV_BUFFER_MAX);
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && s_Ctx.RxOversize == 0) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(1);
+    }
+    TEST_ASSERT_TRUE(s_Ctx.RxOversize > 0);
+    PdqStratumCtxHasNewJob(&s_Ctx);
+
+    /* The rest of the long line is skipped, not parsed as a message */
+    atomic_store(&s_Pool.PadCoinbase, 0);
+    while (GetMillis() < Deadline && !PdqStratumCtxHasNewJob(&s_Ctx)) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(1);
+    }
+    PdqStratumJob_t Job;
+    PdqStratumCtxGetJob(&s_Ctx, &Job);
+    TEST_ASSERT_EQUAL_UINT32(57, Job.Coinbase1Len);
+    TEST_ASSERT_EQUAL_UINT32(0, s_Ctx.RxMalformed);
+    TEST_ASSERT_TRUE(PdqStratumCtxIsReady(&s_Ctx));
+}
+
+void Test_StratumClient_SetExtranonce_MidSession_AppliesToNextJob(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && !s_Ctx.ExtranonceSubscribed) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+    TEST_ASSERT_TRUE(s_Ctx.ExtranonceSubscribed);
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Pool.ExtranonceSubscribes));
+    PdqStratumCtxHasNewJob(&s_Ctx);
+
+    atomic_store(&s_Pool.SetExtranonce, 1);
+    while (GetMillis() < Deadline && s_Ctx.ExtranonceUpdates == 0) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+
+    /* Same job handed out again as a clean job, with the new extranonce */
+    TEST_ASSERT_TRUE(PdqStratumCtxHasNewJob(&s_Ctx));
+    PdqStratumJob_t Job;
+    PdqStratumCtxGetJob(&s_Ctx, &Job);
+    TEST_ASSERT_TRUE(Job.CleanJobs);
+    uint8_t Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t Len = 0;
+    PdqStratumCtxGetExtranonce(&s_Ctx, Extranonce1, &Len);
+    static const uint8_t s_Expected[4] = {0xc0, 0xff, 0xee, 0x01};
+    TEST_ASSERT_EQUAL_INT(4, Len);
+    TEST_ASSERT_EQUAL_MEMORY(s_Expected, Extranonce1, 4);
+    TEST_ASSERT_EQUAL_INT(2, PdqStratumCtxGetExtranonce2Size(&s_Ctx));
+
+    /* Shares carry the new extranonce2 size without a reconnect */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitShare(&s_Ctx, Job.JobId, 0x0201, 0x1234, Job.NTime));
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+    TEST_ASSERT_TRUE(strstr(s_Pool.LastSubmit, "\"0102\"") != NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Pool.Connections));
+}
+
+void Test_StratumClient_SetExtranonce_OldExtranonceShare_DroppedAsStale(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && !s_Ctx.ExtranonceSubscribed) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+    PdqMiningJob_t OldJob;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxBuildNextJob(&s_Ctx, &OldJob));
+
+    atomic_store(&s_Pool.SetExtranonce, 1);
+    while (GetMillis() < Deadline && s_Ctx.ExtranonceUpdates == 0) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+    PdqMiningJob_t NewJob;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxBuildNextJob(&s_Ctx, &NewJob));
+
+    /* Same job id on both sides of the switch: only the generation differs */
+    TEST_ASSERT_EQUAL_STRING(OldJob.JobId, NewJob.JobId);
+    TEST_ASSERT_TRUE(PdqStratumCtxIsJobActive(&s_Ctx, OldJob.JobId));
+
+    PdqShareInfo_t Share = {0};
+    snprintf(Share.JobId, sizeof(Share.JobId), "%s", OldJob.JobId);
+    Share.Extranonce2 = OldJob.Extranonce2;
+    Share.Nonce = 0x1234;
+    Share.NTime = OldJob.NTime;
+    Share.ExtranonceGen = OldJob.ExtranonceGen;
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidJob, PdqStratumCtxSubmitMinedShare(&s_Ctx, &Share));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitStale, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_UINT32(0, PdqStratumCtxGetPendingSubmits(&s_Ctx));
+
+    Share.Extranonce2 = NewJob.Extranonce2;
+    Share.ExtranonceGen = NewJob.ExtranonceGen;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitMinedShare(&s_Ctx, &Share));
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+    TEST_ASSERT_EQUAL_INT(PdqSubmitAccepted, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Pool.Submits));
+}
+
+void Test_StratumClient_Reconnect_SessionResumed_MinesCachedJob(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    TEST_ASSERT_EQUAL_STRING("sess0", s_Ctx.SessionId);
+    PdqStratumCtxHasNewJob(&s_Ctx);
+
+    /* Silent pool: any job after the reconnect can only be the cached one */
+    atomic_store(&s_Pool.Silent, 1);
+    PdqStratumCtxDisconnect(&s_Ctx);
+    TEST_ASSERT_TRUE(RunHandshake());
+    TEST_ASSERT_TRUE(PdqStratumCtxHasNewJob(&s_Ctx));
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Pool.Resumes));
+    TEST_ASSERT_EQUAL_UINT32(1, s_Ctx.Resumes);
+
+    PdqStratumJob_t Job;
+    PdqStratumCtxGetJob(&s_Ctx, &Job);
+    TEST_ASSERT_EQUAL_STRING("1eaa720", Job.JobId);
+}
+
+void Test_StratumClient_Reconnect_ResumeRefused_WaitsForNotify(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    PdqStratumCtxDisconnect(&s_Ctx);
+
+    atomic_store(&s_Pool.RefuseResume, 1);
+    atomic_store(&s_Pool.Silent, 1);
+    TEST_ASSERT_TRUE(RunHandshakeTo(StratumStateAuthorized));
+    for (int i = 0; i < 20; i++) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+    TEST_ASSERT_EQUAL_INT(StratumStateAuthorized, PdqStratumCtxGetState(&s_Ctx));
+    TEST_ASSERT_FALSE(PdqStratumCtxHasNewJob(&s_Ctx));
+    TEST_ASSERT_FALSE(s_Ctx.Resumed);
+    TEST_ASSERT_EQUAL_STRING("sess1", s_Ctx.SessionId);
+}
+
+void Test_StratumClient_SubmitShare_RetiredJob_DroppedAsStale(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    TEST_ASSERT_TRUE(PdqStratumCtxIsJobActive(&s_Ctx, "1eaa720"));
+    TEST_ASSERT_FALSE(PdqStratumCtxIsJobActive(&s_Ctx, "1eaa71f"));
+
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidJob,
+                          PdqStratumCtxSubmitShare(&s_Ctx, "1eaa71f", 1, 0x1234, 0x69a20ee6));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitStale, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_UINT32(0, PdqStratumCtxGetPendingSubmits(&s_Ctx));
+
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 2, 0x5678, 0x69a20ee6));
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+
+    PdqStratumSubmitStats_t Stats;
+    PdqStratumCtxGetSubmitStats(&s_Ctx, &Stats);
+    TEST_ASSERT_EQUAL_UINT32(1, Stats.StaleDropped);
+    TEST_ASSERT_EQUAL_UINT32(1, Stats.Submitted);
+    TEST_ASSERT_EQUAL_UINT32(0, Stats.Rejected);
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Pool.Submits));
+}
+
+void Test_StratumClient_SaveRestore_InheritedSocket_SessionCarriesOn(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunHandshake());
+    PdqStratumCtxHasNewJob(&s_Ctx);
+    atomic_store(&s_Pool.IgnoreSubmits, 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 1, 0x1234, 0x69a20ee6));
+
+    uint8_t Blob[PDQ_STRATUM_TX_BUFFER_SIZE + 16384];
+    uint32_t Len = 0;
+    TEST_ASSERT_TRUE(PdqStratumCtxStateSize(&s_Ctx) <= sizeof(Blob));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSaveState(&s_Ctx, Blob, sizeof(Blob), &Len));
+    uint8_t Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t Extranonce1Len = s_Ctx.Extranonce1Len;
+    memcpy(Extranonce1, s_Ctx.Extranonce1, sizeof(Extranonce1));
+
+    /* What exec does: the socket survives, the context does not */
+    int Socket = dup(PdqStratumCtxGetSocket(&s_Ctx));
+    TEST_ASSERT_TRUE(Socket >= 0);
+    PdqStratumCtxRelease(&s_Ctx);
+    PdqStratumCtxInit(&s_Ctx);
+    PdqStratumCtxSetSubmitCallback(&s_Ctx, PdqTestOnSubmit, &s_Submits);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxRestoreState(&s_Ctx, Socket, Blob, Len));
+
+    TEST_ASSERT_TRUE(PdqStratumCtxIsReady(&s_Ctx));
+    TEST_ASSERT_TRUE(PdqStratumCtxHasNewJob(&s_Ctx));
+    TEST_ASSERT_EQUAL_UINT32(1, PdqStratumCtxGetPendingSubmits(&s_Ctx));
+    TEST_ASSERT_EQUAL_UINT32(Extranonce1Len, s_Ctx.Extranonce1Len);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(Extranonce1, s_Ctx.Extranonce1, Extranonce1Len));
+    TEST_ASSERT_EQUAL_STRING("bc1qtest.unit", s_Ctx.Worker);
+    PdqStratumJob_t Job;
+    PdqStratumCtxGetJob(&s_Ctx, &Job);
+    TEST_ASSERT_EQUAL_STRING("1eaa720", Job.JobId);
+
+    /* Same connection: the pool answers the restored context. Releasing
+     * the old one above reported its copy of submit 1 as timed out. */
+    s_Submits.Callbacks = 0;
+    atomic_store(&s_Pool.IgnoreSubmits, 0);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSubmitShare(&s_Ctx, "1eaa720", 2, 0x5678, 0x69a20ee6));
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && s_Submits.Callbacks == 0) {
+        PdqStratumCtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+    TEST_ASSERT_EQUAL_INT(PdqSubmitAccepted, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_UINT32(1, atomic_load(&s_Pool.Connections));
+}
+
+void Test_StratumClient_RestoreState_BadBlob_Refused(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakePoolStart(&s_Pool, 0));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqStratumCtxSaveState(&s_Ctx, NULL, 0, NULL));
+    TEST_ASSERT_TRUE(RunHandshake());
+
+    uint8_t Blob[PDQ_STRATUM_TX_BUFFER_SIZE + 16384];
+    uint32_t Len = 0;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumCtxSaveState(&s_Ctx, Blob, sizeof(Blob), &Len));
+
+    PdqStratumContext_t Other;
+    PdqStratumCtxInit(&Other);
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqStratumCtxRestoreState(&Other, -1, Blob, Len));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqStratumCtxRestoreState(&Other, 0, Blob, Len / 2));
+    Blob[0] ^= 0xFF;
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqStratumCtxRestoreState(&Other, 0, Blob, Len));
+    TEST_ASSERT_FALSE(PdqStratumCtxIsReady(&Other));
+    PdqStratumCtxRelease(&Other);
+}
+
+void Test_SubmitLatencyBucket_Boundaries_PowersOfTwo(void)
+{
+    TEST_ASSERT_EQUAL_INT(0, PdqSubmitLatencyBucket(0));
+    TEST_ASSERT_EQUAL_INT(1, PdqSubmitLatencyBucket(1));
+    TEST_ASSERT_EQUAL_INT(2, PdqSubmitLatencyBucket(2));
+    TEST_ASSERT_EQUAL_INT(2, PdqSubmitLatencyBucket(3));
+    TEST_ASSERT_EQUAL_INT(7, PdqSubmitLatencyBucket(100));
+    TEST_ASSERT_EQUAL_INT(PDQ_SUBMIT_LATENCY_BUCKETS - 1, PdqSubmitLatencyBucket(UINT32_MAX));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_StratumClient_ConnectStart_Localhost_ReachesPool);
+    RUN_TEST(Test_StratumClient_ConnectStart_CachedHost_SkipsResolve);
+    RUN_TEST(Test_StratumClient_ConnectStart_AllAddressesRefused_ForgetsCache);
+    RUN_TEST(Test_StratumClient_GetPollFds_Connected_ReturnsSocket);
+    RUN_TEST(Test_StratumClient_SubmitShare_Accepted_RecordsLatency);
+    RUN_TEST(Test_StratumClient_SubmitShare_Rejected_CountsByCode);
+    RUN_TEST(Test_StratumClient_SubmitShare_NoReply_TimesOut);
+    RUN_TEST(Test_StratumClient_Disconnect_PendingSubmits_CountedAsTimedOut);
+    RUN_TEST(Test_StratumClient_SubmitShare_TableFull_EvictsOldest);
+    RUN_TEST(Test_StratumClient_Cork_BurstOfSubmits_OneWrite);
+    RUN_TEST(Test_StratumClient_Flush_PeerStalled_QueuesUntilWritable);
+    RUN_TEST(Test_StratumClient_Process_LongNotify_BufferGrows);
+    RUN_TEST(Test_StratumClient_Process_LineOverMax_DroppedAndResynced);
+    RUN_TEST(Test_StratumClient_SetExtranonce_MidSession_AppliesToNextJob);
+    RUN_TEST(Test_StratumClient_SetExtranonce_OldExtranonceShare_DroppedAsStale);
+    RUN_TEST(Test_StratumClient_Reconnect_SessionResumed_MinesCachedJob);
+    RUN_TEST(Test_StratumClient_Reconnect_ResumeRefused_WaitsForNotify);
+    RUN_TEST(Test_StratumClient_SubmitShare_RetiredJob_DroppedAsStale);
+    RUN_TEST(Test_StratumClient_SaveRestore_InheritedSocket_SessionCarriesOn);
+    RUN_TEST(Test_StratumClient_RestoreState_BadBlob_Refused);
+    RUN_TEST(Test_SubmitLatencyBucket_Boundaries_PowersOfTwo);
+    return UNITY_END();
+}
@@ -0,0 +1,312 @@
+/**
+ * @file test_stratum_json.c
+ * @brief JSON tokenizer and mining.notify decoder tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "stratum/stratum_json.h"
+#include "stratum/stratum_client.h"
+#include "core/sha256_engine.h"
+#include <stdio.h>
+
+#define TEST_MAX_TOKENS 64
+
+/* Example notify from the original Stratum V1 documentation */
+static const char* s_Notify =
+    "{\"params\": [\"bf\", \"4d16b6f85af6e2198f44ae2a6de67f78487ae5611b77c6c0440b921e00000000\", "
+    "\"01000000010000000000000000000000000000000000000000000000000000000000000000ffffffff20020862062f503253482f04b8864e5008\", "
+    "\"072f736c7573682f000000000100f2052a010000001976a914d23fcdf86f7e756a64a7a9688ef9903327048ed988ac00000000\", "
+    "[], \"00000002\", \"1c2ac4af\", \"504e86b9\", false], \"id\": null, \"method\": \"mining.notify\"}";
+
+static PdqJsonToken_t    s_Tokens[TEST_MAX_TOKENS];
+static PdqJsonDoc_t      s_Doc;
+static PdqStratumArena_t s_Arena;
+
+static PdqError_t Parse(const char* p_Json)
+{
+    return PdqJsonParse(&s_Doc, p_Json, strlen(p_Json), s_Tokens, TEST_MAX_TOKENS);
+}
+
+void setUp(void)
+{
+    memset(&s_Doc, 0, sizeof(s_Doc));
+}
+
+void tearDown(void)
+{
+    PdqStratumArenaFree(&s_Arena);
+}
+
+void Test_StratumJson_Parse_Notify_TokensInDocumentOrder(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse(s_Notify));
+    TEST_ASSERT_EQUAL_INT(PdqJsonObject, PdqJsonTypeOf(&s_Doc, 0));
+    TEST_ASSERT_EQUAL_INT(3, s_Tokens[0].Size);
+    TEST_ASSERT_EQUAL_INT(s_Doc.Count, s_Tokens[0].Next);
+
+    int Params = PdqJsonObjectGet(&s_Doc, 0, "params");
+    TEST_ASSERT_EQUAL_INT(2, Params);
+    TEST_ASSERT_EQUAL_INT(PdqJsonArray, PdqJsonTypeOf(&s_Doc, Params));
+    TEST_ASSERT_EQUAL_INT(9, s_Tokens[Params].Size);
+
+    TEST_ASSERT_EQUAL_INT(PdqJsonNull, PdqJsonTypeOf(&s_Doc, PdqJsonObjectGet(&s_Doc, 0, "id")));
+    TEST_ASSERT_TRUE(PdqJsonEquals(&s_Doc, PdqJsonObjectGet(&s_Doc, 0, "method"), "mining.notify"));
+    TEST_ASSERT_EQUAL_INT(-1, PdqJsonObjectGet(&s_Doc, 0, "result"));
+}
+
+void Test_StratumJson_Parse_Malformed_Rejected(void)
+{
+    static const char* s_Bad[] = {
+        "", "   ", "{", "}", "{\"a\":}", "{\"a\" 1}", "{a:1}", "{\"a\":1,}", "[1,]", "[1 2]",
+        "tru", "nul", "01", "1.", "-", "1e", ".5", "\"abc", "\"\\x\"", "\"\\u12g4\"",
+        "\"tab\there\"", "{\"a\":1} x", "[1]]", "{\"id\":1}{\"id\":2}",
+    };
+    for (size_t i = 0; i < sizeof(s_Bad) / sizeof(s_Bad[0]); i++) {
+        TEST_ASSERT_TRUE_MESSAGE(Parse(s_Bad[i]) == PdqErrorParse, s_Bad[i]);
+    }
+}
+
+void Test_StratumJson_Parse_ValidScalars_Accepted(void)
+{
+    static const char* s_Good[] = {
+        "0", "-0", "12.5e-3", "1E+2", "true", "false", "null", "\"\"", "\"a\\\"b\\\\c\\u00e9\"",
+        " [ ] ", "{}", "\r\n{\"a\" : [ 1 , { } ] }\r\n",
+    };
+    for (size_t i = 0; i < sizeof(s_Good) / sizeof(s_Good[0]); i++) {
+        TEST_ASSERT_TRUE_MESSAGE(Parse(s_Good[i]) == PdqOk, s_Good[i]);
+    }
+}
+
+void Test_StratumJson_Parse_TooManyTokens_BufferTooSmall(void)
+{
+    PdqJsonToken_t Few[4];
+    const char* p_Json = "[1,2,3,4,5]";
+    TEST_ASSERT_EQUAL_INT(PdqErrorBufferTooSmall, PdqJsonParse(&s_Doc, p_Json, strlen(p_Json), Few, 4));
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqJsonParse(&s_Doc, p_Json, strlen(p_Json), s_Tokens, TEST_MAX_TOKENS));
+    TEST_ASSERT_EQUAL_INT(6, s_Doc.Count);
+}
+
+static void Nest(char* p_Out, int Depth)
+{
+    int n = 0;
+    for (int i = 0; i < Depth; i++) p_Out[n++] = '[';
+    for (int i = 0; i < Depth; i++) p_Out[n++] = ']';
+    p_Out[n] = '\0';
+}
+
+void Test_StratumJson_Parse_DeepNesting_Rejected(void)
+{
+    char Json[2 * PDQ_JSON_MAX_DEPTH + 3];
+    Nest(Json, PDQ_JSON_MAX_DEPTH);
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse(Json));
+    Nest(Json, PDQ_JSON_MAX_DEPTH + 1);
+    TEST_ASSERT_EQUAL_INT(PdqErrorParse, Parse(Json));
+}
+
+void Test_StratumJson_ObjectGet_NestedValues_SkipsSubtrees(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse("{\"a\":[1,[2,{\"c\":3}]],\"b\":{\"c\":true},\"d\":\"x\"}"));
+    TEST_ASSERT_TRUE(PdqJsonEquals(&s_Doc, PdqJsonObjectGet(&s_Doc, 0, "d"), "x"));
+    TEST_ASSERT_EQUAL_INT(-1, PdqJsonObjectGet(&s_Doc, 0, "c"));
+
+    int B = PdqJsonObjectGet(&s_Doc, 0, "b");
+    TEST_ASSERT_EQUAL_INT(PdqJsonTrue, PdqJsonTypeOf(&s_Doc, PdqJsonObjectGet(&s_Doc, B, "c")));
+
+    int A = PdqJsonObjectGet(&s_Doc, 0, "a");
+    int Inner = PdqJsonArrayGet(&s_Doc, A, 1);
+    int64_t Value = 0;
+    TEST_ASSERT_TRUE(PdqJsonGetInt(&s_Doc, PdqJsonArrayGet(&s_Doc, Inner, 0), &Value));
+    TEST_ASSERT_EQUAL_INT(2, Value);
+    TEST_ASSERT_EQUAL_INT(-1, PdqJsonArrayGet(&s_Doc, A, 2));
+    TEST_ASSERT_EQUAL_INT(-1, PdqJsonArrayGet(&s_Doc, B, 0));
+}
+
+void Test_StratumJson_GetInt_FractionOrOverflow_Fails(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse("[42,-7,1.5,2e3,99999999999999999999]"));
+    int64_t Value = 0;
+    TEST_ASSERT_TRUE(PdqJsonGetInt(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 0), &Value));
+    TEST_ASSERT_EQUAL_INT(42, Value);
+    TEST_ASSERT_TRUE(PdqJsonGetInt(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 1), &Value));
+    TEST_ASSERT_EQUAL_INT(-7, Value);
+    TEST_ASSERT_FALSE(PdqJsonGetInt(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 2), &Value));
+    TEST_ASSERT_FALSE(PdqJsonGetInt(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 3), &Value));
+    TEST_ASSERT_FALSE(PdqJsonGetInt(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 4), &Value));
+
+    double Diff = 0.0;
+    TEST_ASSERT_TRUE(PdqJsonGetDouble(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 2), &Diff));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 1.5, Diff);
+}
+
+void Test_StratumJson_GetHex_BadInput_Fails(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse("[\"00ff10\",\"abc\",\"zz\",\"0011223344\",\"1d00ffff\",\"123456789\"]"));
+    uint8_t Out[4];
+    TEST_ASSERT_EQUAL_INT(3, PdqJsonGetHex(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 0), Out, sizeof(Out)));
+    TEST_ASSERT_EQUAL_HEX32(0xFF, Out[1]);
+    TEST_ASSERT_EQUAL_INT(-1, PdqJsonGetHex(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 1), Out, sizeof(Out)));
+    TEST_ASSERT_EQUAL_INT(-1, PdqJsonGetHex(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 2), Out, sizeof(Out)));
+    TEST_ASSERT_EQUAL_INT(-1, PdqJsonGetHex(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 3), Out, sizeof(Out)));
+
+    uint32_t Bits = 0;
+    TEST_ASSERT_TRUE(PdqJsonGetHexU32(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 4), &Bits));
+    TEST_ASSERT_EQUAL_HEX32(0x1d00ffff, Bits);
+    TEST_ASSERT_FALSE(PdqJsonGetHexU32(&s_Doc, PdqJsonArrayGet(&s_Doc, 0, 5), &Bits));
+}
+
+void Test_StratumJson_GetString_Escapes_Decoded(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse("[\"a\\\"b\\\\c\\nd\\u0041\"]"));
+    char Out[16];
+    TEST_ASSERT_EQUAL_INT(8, PdqJsonGetString(&s_Doc, 1, Out, sizeof(Out)));
+    TEST_ASSERT_EQUAL_STRING("a\"b\\c\nd?", Out);
+    TEST_ASSERT_EQUAL_INT(3, PdqJsonGetString(&s_Doc, 1, Out, 4));
+}
+
+void Test_StratumJson_DecodeNotify_DocExample_FieldsDecoded(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse(s_Notify));
+    PdqStratumJob_t Job;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumDecodeNotify(&s_Doc, PdqJsonObjectGet(&s_Doc, 0, "params"), &s_Arena, &Job));
+
+    TEST_ASSERT_EQUAL_STRING("bf", Job.JobId);
+    TEST_ASSERT_EQUAL_HEX32(0x00000002, Job.Version);
+    TEST_ASSERT_EQUAL_HEX32(0x1c2ac4af, Job.NBits);
+    TEST_ASSERT_EQUAL_HEX32(0x504e86b9, Job.NTime);
+    TEST_ASSERT_EQUAL_INT(0, Job.MerkleBranchCount);
+    TEST_ASSERT_EQUAL_INT(58, Job.Coinbase1Len);
+    TEST_ASSERT_EQUAL_INT(51, Job.Coinbase2Len);
+    TEST_ASSERT_FALSE(Job.CleanJobs);
+
+    /* prevhash words are byte-swapped into header order */
+    static const uint8_t s_PrevHead[4] = {0xf8, 0xb6, 0x16, 0x4d};
+    TEST_ASSERT_EQUAL_MEMORY(s_PrevHead, Job.PrevBlockHash, 4);
+}
+
+void Test_StratumJson_DecodeNotify_BadFields_Rejected(void)
+{
+    static const char* s_Bad[] = {
+        /* eight params */
+        "[\"1\",\"00\",\"00\",\"00\",[],\"1\",\"1\",\"1\"]",
+        /* short prevhash */
+        "[\"1\",\"00\",\"00\",\"00\",[],\"1\",\"1\",\"1\",true]",
+        /* branch that is not 32 bytes */
+        "[\"1\",\"0000000000000000000000000000000000000000000000000000000000000000\",\"00\",\"00\","
+        "[\"00\"],\"1\",\"1\",\"1\",true]",
+        /* clean_jobs as a string */
+        "[\"1\",\"0000000000000000000000000000000000000000000000000000000000000000\",\"00\",\"00\","
+        "[],\"1\",\"1\",\"1\",\"true\"]",
+        /* empty job id */
+        "[\"\",\"0000000000000000000000000000000000000000000000000000000000000000\",\"00\",\"00\","
+        "[],\"1\",\"1\",\"1\",true]",
+    };
+    PdqStratumJob_t Job;
+    for (size_t i = 0; i < sizeof(s_Bad) / sizeof(s_Bad[0]); i++) {
+        TEST_ASSERT_EQUAL_INT(PdqOk, Parse(s_Bad[i]));
+        TEST_ASSERT_TRUE_MESSAGE(PdqStratumDecodeNotify(&s_Doc, 0, &s_Arena, &Job) == PdqErrorInvalidJob, s_Bad[i]);
+    }
+}
+
+/* Notify params with a Coinbase1Len-byte coinbase1 of 0xab and Branches
+ * branches whose bytes are all the branch index */
+static void BuildBigNotify(char* p_Out, size_t MaxLen, uint32_t Coinbase1Len, uint16_t Branches)
+{
+    size_t Len = (size_t)snprintf(p_Out, MaxLen, "[\"big\",\"%064d\",\"", 0);
+    for (uint32_t i = 0; i < Coinbase1Len; i++) Len += (size_t)snprintf(p_Out + Len, MaxLen - Len, "ab");
+    Len += (size_t)snprintf(p_Out + Len, MaxLen - Len, "\",\"cdcd\",[");
+    for (uint16_t b = 0; b < Branches; b++) {
+        Len += (size_t)snprintf(p_Out + Len, MaxLen - Len, "%s\"", b ? "," : "");
+        for (int i = 0; i < 32; i++) Len += (size_t)snprintf(p_Out + Len, MaxLen - Len, "%02x", b);
+        Len += (size_t)snprintf(p_Out + Len, MaxLen - Len, "\"");
+    }
+    snprintf(p_Out + Len, MaxLen - Len, "],\"20000000\",\"1d00ffff\",\"5f5e1000\",true]");
+}
+
+void Test_StratumJson_DecodeNotify_LargeCoinbaseManyBranches_SizedFromMessage(void)
+{
+    static char Notify[8192];
+    BuildBigNotify(Notify, sizeof(Notify), 1500, 24);
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse(Notify));
+
+    PdqStratumJob_t Job;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumDecodeNotify(&s_Doc, 0, &s_Arena, &Job));
+    TEST_ASSERT_EQUAL_INT(1500, Job.Coinbase1Len);
+    TEST_ASSERT_EQUAL_INT(2, Job.Coinbase2Len);
+    TEST_ASSERT_EQUAL_INT(24, Job.MerkleBranchCount);
+    TEST_ASSERT_EQUAL_INT(0xab, Job.p_Coinbase1[1499]);
+    TEST_ASSERT_EQUAL_INT(0xcd, Job.p_Coinbase2[1]);
+    TEST_ASSERT_EQUAL_INT(23, Job.p_MerkleBranches[23][31]);
+
+    /* A job of the same shape reuses the arena as is */
+    uint8_t* p_Base = s_Arena.p_Base;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumDecodeNotify(&s_Doc, 0, &s_Arena, &Job));
+    TEST_ASSERT_TRUE(s_Arena.p_Base == p_Base);
+}
+
+void Test_StratumJson_BuildMiningJob_LargeCoinbase_MatchesAssembledHash(void)
+{
+    static char Notify[8192];
+    BuildBigNotify(Notify, sizeof(Notify), 1500, 20);
+    TEST_ASSERT_EQUAL_INT(PdqOk, Parse(Notify));
+    PdqStratumJob_t Job;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumDecodeNotify(&s_Doc, 0, &s_Arena, &Job));
+
+    static const uint8_t s_Extranonce1[4] = {0x01, 0x02, 0x03, 0x04};
+    PdqMiningJob_t Mining;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqStratumBuildMiningJob(&Job, s_Extranonce1, 4, 0x11223344, 4,
+                                                          1.0, &Mining));
+
+    /* Reference: assemble the coinbase, fold the branches, hash the header */
+    static uint8_t Coinbase[1500 + 4 + 4 + 2];
+    size_t Len = 0;
+    memcpy(Coinbase, Job.p_Coinbase1, Job.Coinbase1Len);
+    Len += Job.Coinbase1Len;
+    memcpy(Coinbase + Len, s_Extranonce1, 4);
+    Len += 4;
+    static const uint8_t s_Extranonce2[4] = {0x44, 0x33, 0x22, 0x11};
+    memcpy(Coinbase + Len, s_Extranonce2, 4);
+    Len += 4;
+    memcpy(Coinbase + Len, Job.p_Coinbase2, Job.Coinbase2Len);
+    Len += Job.Coinbase2Len;
+
+    uint8_t Root[32];
+    PdqSha256d(Coinbase, Len, Root);
+    for (uint16_t i = 0; i < Job.MerkleBranchCount; i++) {
+        uint8_t Concat[64];
+        memcpy(Concat, Root, 32);
+        memcpy(Concat + 32, Job.p_MerkleBranches[i], 32);
+        PdqSha256d(Concat, 64, Root);
+    }
+
+    /* Merkle root spans the end of the first block and the start of the tail */
+    uint8_t Header[64];
+    memset(Header, 0, sizeof(Header));
+    Header[0] = 0x00; Header[1] = 0x00; Header[2] = 0x00; Header[3] = 0x20;
+    memcpy(Header + 4, Job.PrevBlockHash, 32);
+    memcpy(Header + 36, Root, 28);
+    uint8_t Midstate[32];
+    PdqSha256Midstate(Header, Midstate);
+    TEST_ASSERT_EQUAL_MEMORY(Midstate, Mining.Midstate, 32);
+    TEST_ASSERT_EQUAL_MEMORY(Root + 28, Mining.BlockTail, 4);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_StratumJson_Parse_Notify_TokensInDocumentOrder);
+    RUN_TEST(Test_StratumJson_Parse_Malformed_Rejected);
+    RUN_TEST(Test_StratumJson_Parse_ValidScalars_Accepted);
+    RUN_TEST(Test_StratumJson_Parse_TooManyTokens_BufferTooSmall);
+    RUN_TEST(Test_StratumJson_Parse_DeepNesting_Rejected);
+    RUN_TEST(Test_StratumJson_ObjectGet_NestedValues_SkipsSubtrees);
+    RUN_TEST(Test_StratumJson_GetInt_FractionOrOverflow_Fails);
+    RUN_TEST(Test_StratumJson_GetHex_BadInput_Fails);
+    RUN_TEST(Test_StratumJson_GetString_Escapes_Decoded);
+    RUN_TEST(Test_StratumJson_DecodeNotify_DocExample_FieldsDecoded);
+    RUN_TEST(Test_StratumJson_DecodeNotify_BadFields_Rejected);
+    RUN_TEST(Test_StratumJson_DecodeNotify_LargeCoinbaseManyBranches_SizedFromMessage);
+    RUN_TEST(Test_StratumJson_BuildMiningJob_LargeCoinbase_MatchesAssembledHash);
+    return UNITY_END();
+}
@@ -0,0 +1,376 @@
+/**
+ * @file test_sv2_client.c
+ * @brief Stratum V2 client tests against an in-process fake SV2 pool
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "fake_sv2_pool.h"
+#include "stratum/sv2_client.h"
+#include "stratum/sv2_proto.h"
+#include "stratum/sv2_noise.h"
+#include "core/secp256k1.h"
+#include "core/target.h"
+#include <fcntl.h>
+
+#define TEST_WAIT_MS    5000
+
+static PdqFakeSv2Pool_t s_Pool;
+static PdqSv2Context_t  s_Ctx;
+
+/* Connect and process until the channel has a job or the session ends */
+static bool RunUntilReady(void)
+{
+    PdqSv2CtxSetAuthorityKey(&s_Ctx, s_Pool.AuthorityKey);
+    if (PdqSv2CtxConnectStart(&s_Ctx, "127.0.0.1", s_Pool.Port, "bc1qtest.sv2", 5e5f) != PdqOk) return false;
+
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && !PdqSv2CtxIsReady(&s_Ctx)) {
+        if (PdqSv2CtxProcess(&s_Ctx) == PdqErrorNotConnected) return false;
+        SleepMs(2);
+    }
+    return PdqSv2CtxIsReady(&s_Ctx);
+}
+
+static bool RunUntilNewJob(void)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline) {
+        PdqSv2CtxProcess(&s_Ctx);
+        if (PdqSv2CtxHasNewJob(&s_Ctx)) return true;
+        SleepMs(2);
+    }
+    return false;
+}
+
+static bool RunUntilAnswered(void)
+{
+    uint64_t Deadline = GetMillis() + TEST_WAIT_MS;
+    while (GetMillis() < Deadline && PdqSv2CtxGetPendingSubmits(&s_Ctx) > 0) {
+        PdqSv2CtxProcess(&s_Ctx);
+        SleepMs(2);
+    }
+    return PdqSv2CtxGetPendingSubmits(&s_Ctx) == 0;
+}
+
+static PdqTestSubmits_t s_Submits;
+
+void setUp(void)
+{
+    memset(&s_Pool, 0, sizeof(s_Pool));
+    PdqSv2CtxInit(&s_Ctx);
+    PdqSv2CtxSetSubmitCallback(&s_Ctx, PdqTestOnSubmit, &s_Submits);
+    PdqTestSubmitsReset(&s_Submits);
+}
+
+void tearDown(void)
+{
+    PdqSv2CtxDisconnect(&s_Ctx);
+    PdqFakeSv2PoolStop(&s_Pool);
+}
+
+void Test_Sv2Proto_Frame_RoundTrips(void)
+{
+    uint8_t Buffer[64];
+    PdqSv2Writer_t W;
+    PdqSv2WriterInit(&W, Buffer, sizeof(Buffer));
+    PdqSv2BeginFrame(&W, true, PDQ_SV2_MSG_SUBMIT_SHARES_ERROR);
+    PdqSv2PutU32(&W, 0x01020304);
+    PdqSv2PutStr(&W, "stale-share");
+    PdqSv2PutU8(&W, 1);
+    PdqSv2PutU32(&W, 0xCAFEBABE);
+    PdqSv2EndFrame(&W);
+    TEST_ASSERT_FALSE(W.Overflow);
+    TEST_ASSERT_EQUAL_INT(PDQ_SV2_HEADER_SIZE + 4 + 12 + 5, W.Len);
+
+    PdqSv2FrameHeader_t Header;
+    PdqSv2DecodeHeader(Buffer, &Header);
+    TEST_ASSERT_EQUAL_HEX32(0x8000, Header.ExtensionType);
+    TEST_ASSERT_EQUAL_INT(PDQ_SV2_MSG_SUBMIT_SHARES_ERROR, Header.MsgType);
+    TEST_ASSERT_EQUAL_INT(21, Header.Length);
+    TEST_ASSERT_EQUAL_HEX32(0x04, Buffer[PDQ_SV2_HEADER_SIZE]);
+
+    PdqSv2Reader_t R;
+    char Str[8];
+    uint32_t Option = 0;
+    PdqSv2ReaderInit(&R, Buffer + PDQ_SV2_HEADER_SIZE, Header.Length);
+    TEST_ASSERT_EQUAL_HEX32(0x01020304, PdqSv2GetU32(&R));
+    PdqSv2GetStr(&R, Str, sizeof(Str));
+    TEST_ASSERT_EQUAL_STRING("stale-s", Str);
+    TEST_ASSERT_TRUE(PdqSv2GetOptionU32(&R, &Option));
+    TEST_ASSERT_EQUAL_HEX32(0xCAFEBABE, Option);
+    TEST_ASSERT_FALSE(R.Error);
+
+    /* Reading past the payload is sticky and yields zeros */
+    TEST_ASSERT_EQUAL_INT(0, PdqSv2GetU16(&R));
+    TEST_ASSERT_TRUE(R.Error);
+}
+
+void Test_Sv2Proto_Writer_OverflowIsSticky(void)
+{
+    uint8_t Buffer[10];
+    PdqSv2Writer_t W;
+    PdqSv2WriterInit(&W, Buffer, sizeof(Buffer));
+    PdqSv2BeginFrame(&W, false, PDQ_SV2_MSG_SETUP_CONNECTION);
+    PdqSv2PutU64(&W, 1);
+    PdqSv2PutU8(&W, 1);
+    TEST_ASSERT_TRUE(W.Overflow);
+    TEST_ASSERT_EQUAL_INT(PDQ_SV2_HEADER_SIZE, W.Len);
+}
+
+static void FromHex(const char* p_Hex, uint8_t* p_Out, size_t Len)
+{
+    for (size_t i = 0; i < Len; i++) {
+        unsigned Byte = 0;
+        sscanf(p_Hex + 2 * i, "%2x", &Byte);
+        p_Out[i] = (uint8_t)Byte;
+    }
+}
+
+void Test_Sv2Noise_ChaChaPoly_MatchesRfc8439(void)
+{
+    /* RFC 8439 section 2.8.2 */
+    static const char s_Text[] = "Ladies and Gentlemen of the class of '99: If I could offer you only "
+                                 "one tip for the future, sunscreen would be it.";
+    uint8_t Key[32];
+    uint8_t Nonce[12];
+    uint8_t Ad[12];
+    uint8_t Expect[16];
+    uint8_t Sealed[sizeof(s_Text) - 1 + PDQ_SV2_NOISE_MAC_SIZE];
+    uint8_t Opened[sizeof(s_Text) - 1];
+    uint32_t Len = sizeof(s_Text) - 1;
+    for (int i = 0; i < 32; i++) Key[i] = (uint8_t)(0x80 + i);
+    FromHex("070000004041424344454647", Nonce, sizeof(Nonce));
+    FromHex("50515253c0c1c2c3c4c5c6c7", Ad, sizeof(Ad));
+
+    PdqSv2AeadSeal(Key, Nonce, Ad, sizeof(Ad), (const uint8_t*)s_Text, Len, Sealed);
+    FromHex("d31a8d34648e60db7b86afbc53ef7ec2", Expect, 16);
+    TEST_ASSERT_EQUAL_MEMORY(Expect, Sealed, 16);
+    FromHex("1ae10b594f09e26a7e902ecbd0600691", Expect, 16);
+    TEST_ASSERT_EQUAL_MEMORY(Expect, Sealed + Len, 16);
+
+    TEST_ASSERT_TRUE(PdqSv2AeadOpen(Key, Nonce, Ad, sizeof(Ad), Sealed, sizeof(Sealed), Opened));
+    TEST_ASSERT_EQUAL_MEMORY(s_Text, Opened, Len);
+    Sealed[3] ^= 1;
+    TEST_ASSERT_FALSE(PdqSv2AeadOpen(Key, Nonce, Ad, sizeof(Ad), Sealed, sizeof(Sealed), Opened));
+}
+
+void Test_Secp256k1_Schnorr_MatchesBip340Vector(void)
+{
+    /* BIP340 test vector 0: secret key 3, zero aux and message */
+    uint8_t SecKey[32] = {0};
+    uint8_t Zero[32] = {0};
+    uint8_t Pub[32];
+    uint8_t Sig[64];
+    uint8_t Expect[64];
+    SecKey[31] = 3;
+
+    TEST_ASSERT_TRUE(PdqSecpPubkeyXOnly(SecKey, Pub));
+    FromHex("f9308a019258c31049344f85f89d5229b531c845836f99b08601f113bce036f9", Expect, 32);
+    TEST_ASSERT_EQUAL_MEMORY(Expect, Pub, 32);
+
+    TEST_ASSERT_TRUE(PdqSecpSchnorrSign(SecKey, Zero, Zero, Sig));
+    FromHex("e907831f80848d1069a5371b402410364bdf1c5f8307b0084c55f1ce2dca8215"
+            "25f66a4a85ea8b71e482a74f382d2ce5ebeee8fdb2172f477df4900d310536c0", Expect, 64);
+    TEST_ASSERT_EQUAL_MEMORY(Expect, Sig, 64);
+    TEST_ASSERT_TRUE(PdqSecpSchnorrVerify(Pub, Zero, Sig));
+    Sig[40] ^= 1;
+    TEST_ASSERT_FALSE(PdqSecpSchnorrVerify(Pub, Zero, Sig));
+}
+
+void Test_Secp256k1_EllSwift_DecodesAndAgrees(void)
+{
+    /* BIP324 decoding vector: u = t = 0 */
+    uint8_t Ell[64] = {0};
+    uint8_t X[32];
+    uint8_t Expect[32];
+    PdqSecpEllSwiftDecode(Ell, X);
+    FromHex("edd1fd3e327ce90cc7a3542614289aee9682003e9cf7dcc9cf2ca9743be5aa0c", Expect, 32);
+    TEST_ASSERT_EQUAL_MEMORY(Expect, X, 32);
+
+    uint8_t KeyA[32], KeyB[32], Rnd[32], EllA[64], EllB[64], SecretA[32], SecretB[32];
+    memset(KeyA, 0x5a, sizeof(KeyA));
+    memset(KeyB, 0xa5, sizeof(KeyB));
+    memset(Rnd, 0x42, sizeof(Rnd));
+    TEST_ASSERT_TRUE(PdqSecpEllSwiftCreate(KeyA, Rnd, EllA));
+    TEST_ASSERT_TRUE(PdqSecpEllSwiftCreate(KeyB, Rnd, EllB));
+    PdqSecpEllSwiftDecode(EllA, X);
+    TEST_ASSERT_TRUE(PdqSecpPubkeyXOnly(KeyA, Expect));
+    TEST_ASSERT_EQUAL_MEMORY(Expect, X, 32);
+
+    TEST_ASSERT_TRUE(PdqSecpEllSwiftXdh(EllA, EllB, KeyA, true, SecretA));
+    TEST_ASSERT_TRUE(PdqSecpEllSwiftXdh(EllA, EllB, KeyB, false, SecretB));
+    TEST_ASSERT_EQUAL_MEMORY(SecretA, SecretB, 32);
+}
+
+void Test_Sv2Noise_ParseAuthorityKey_Base58AndHex(void)
+{
+    uint8_t Key[32];
+    uint8_t Expect[32];
+    FromHex("24ee3c3804a1aaa4c03b80ea19f7a5863c916e8994b7db94a3bad7ee092b6ce7", Expect, 32);
+    TEST_ASSERT_TRUE(PdqSv2ParseAuthorityKey("9auqWEzQDVyd2oe1JVGFLMLHZtCo2FFqZwtKA5gd9xbuEu7PH72", Key));
+    TEST_ASSERT_EQUAL_MEMORY(Expect, Key, 32);
+    TEST_ASSERT_TRUE(PdqSv2ParseAuthorityKey(
+        "24ee3c3804a1aaa4c03b80ea19f7a5863c916e8994b7db94a3bad7ee092b6ce7", Key));
+    TEST_ASSERT_EQUAL_MEMORY(Expect, Key, 32);
+
+    /* Last character changed: checksum mismatch */
+    TEST_ASSERT_FALSE(PdqSv2ParseAuthorityKey("9auqWEzQDVyd2oe1JVGFLMLHZtCo2FFqZwtKA5gd9xbuEu7PH73", Key));
+    TEST_ASSERT_FALSE(PdqSv2ParseAuthorityKey("not-a-key", Key));
+}
+
+void Test_Sv2Client_Handshake_OpensChannelWithJob(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakeSv2PoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunUntilReady());
+
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Pool.Handshakes));
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Pool.Setups));
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Pool.Channels));
+    TEST_ASSERT_EQUAL_STRING("bc1qtest.sv2", s_Pool.LastUser);
+    TEST_ASSERT_EQUAL_INT(7, s_Ctx.ChannelId);
+    TEST_ASSERT_EQUAL_INT(4, s_Ctx.ExtranoncePrefixLen);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 1.0, PdqSv2CtxGetDifficulty(&s_Ctx));
+    TEST_ASSERT_TRUE(PdqSv2CtxHasNewJob(&s_Ctx));
+    TEST_ASSERT_EQUAL_INT(0, s_Ctx.RxMalformed);
+    /* Not handed over on upgrade, so not inherited by the new image */
+    TEST_ASSERT_TRUE(fcntl(s_Ctx.Socket, F_GETFD) & FD_CLOEXEC);
+}
+
+void Test_Sv2Client_SetupRefused_Disconnects(void)
+{
+    atomic_store(&s_Pool.RejectSetup, 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakeSv2PoolStart(&s_Pool, 0));
+    TEST_ASSERT_FALSE(RunUntilReady());
+    TEST_ASSERT_EQUAL_INT(Sv2StateDisconnected, PdqSv2CtxGetState(&s_Ctx));
+}
+
+void Test_Sv2Client_WrongAuthority_RefusesPool(void)
+{
+    atomic_store(&s_Pool.BadCertificate, 1);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakeSv2PoolStart(&s_Pool, 0));
+    TEST_ASSERT_FALSE(RunUntilReady());
+
+    /* Dropped after act 2, before anything is sent under the keys */
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Pool.Handshakes));
+    TEST_ASSERT_EQUAL_INT(0, atomic_load(&s_Pool.Setups));
+    TEST_ASSERT_EQUAL_INT(Sv2StateDisconnected, PdqSv2CtxGetState(&s_Ctx));
+}
+
+void Test_Sv2Client_BuildJob_MatchesGenesisHeader(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakeSv2PoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunUntilReady());
+
+    PdqMiningJob_t Job;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqSv2CtxBuildJob(&s_Ctx, &Job));
+    TEST_ASSERT_EQUAL_STRING("1", Job.JobId);
+    TEST_ASSERT_EQUAL_HEX32(PDQ_FAKE_SV2_GENESIS_NTIME, Job.NTime);
+    TEST_ASSERT_EQUAL_HEX32(0x01000000, Job.HeaderSwapped[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x3ba3edfd, Job.HeaderSwapped[9]);
+    TEST_ASSERT_EQUAL_HEX32(0xffff001d, Job.HeaderSwapped[18]);
+
+    /* The genesis nonce only hashes under the targets if every header
+     * field landed where the V1 path puts it */
+    uint32_t Hash[8];
+    PdqTargetHashJob(&Job, PDQ_FAKE_SV2_GENESIS_NONCE, Hash);
+    TEST_ASSERT_EQUAL_INT(PdqHitBlock, PdqTargetClassify(&Job, Hash));
+}
+
+void Test_Sv2Client_Submit_AcceptedWithJobFields(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakeSv2PoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunUntilReady());
+
+    PdqMiningJob_t Job;
+    PdqSv2CtxBuildJob(&s_Ctx, &Job);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqSv2CtxSubmitShare(&s_Ctx, Job.JobId, PDQ_FAKE_SV2_GENESIS_NONCE, Job.NTime));
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+
+    TEST_ASSERT_EQUAL_INT(PdqSubmitAccepted, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&s_Pool.LastJobId));
+    TEST_ASSERT_EQUAL_HEX32(PDQ_FAKE_SV2_GENESIS_NONCE, atomic_load(&s_Pool.LastNonce));
+    TEST_ASSERT_EQUAL_HEX32(PDQ_FAKE_SV2_GENESIS_NTIME, atomic_load(&s_Pool.LastNTime));
+    TEST_ASSERT_EQUAL_HEX32(1, atomic_load(&s_Pool.LastVersion));
+
+    PdqStratumSubmitStats_t Stats;
+    PdqSv2CtxGetSubmitStats(&s_Ctx, &Stats);
+    TEST_ASSERT_EQUAL_INT(1, Stats.Submitted);
+    TEST_ASSERT_EQUAL_INT(1, Stats.Accepted);
+}
+
+void Test_Sv2Client_Submit_RejectMapsToV1Code(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakeSv2PoolStart(&s_Pool, 0));
+    atomic_store(&s_Pool.RejectSubmits, 1);
+    TEST_ASSERT_TRUE(RunUntilReady());
+
+    PdqMiningJob_t Job;
+    PdqSv2CtxBuildJob(&s_Ctx, &Job);
+    PdqSv2CtxSubmitShare(&s_Ctx, Job.JobId, 1, Job.NTime);
+    TEST_ASSERT_TRUE(RunUntilAnswered());
+    TEST_ASSERT_EQUAL_INT(PdqSubmitRejected, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_INT(23, s_Submits.LastCode);
+}
+
+void Test_Sv2Client_NewPrevHash_SwitchesJobAndRetiresOld(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakeSv2PoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunUntilReady());
+    TEST_ASSERT_TRUE(PdqSv2CtxHasNewJob(&s_Ctx));
+
+    PdqMiningJob_t Old;
+    PdqSv2CtxBuildJob(&s_Ctx, &Old);
+
+    atomic_store(&s_Pool.NewBlock, 1);
+    TEST_ASSERT_TRUE(RunUntilNewJob());
+
+    PdqMiningJob_t Job;
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqSv2CtxBuildJob(&s_Ctx, &Job));
+    TEST_ASSERT_EQUAL_STRING("2", Job.JobId);
+    TEST_ASSERT_EQUAL_HEX32(PDQ_FAKE_SV2_GENESIS_NTIME + 1, Job.NTime);
+    TEST_ASSERT_TRUE(memcmp(Old.Midstate, Job.Midstate, 32) != 0);
+
+    /* The genesis job is gone: its share never reaches the pool */
+    TEST_ASSERT_FALSE(PdqSv2CtxIsJobActive(&s_Ctx, Old.JobId));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidJob,
+                          PdqSv2CtxSubmitShare(&s_Ctx, Old.JobId, PDQ_FAKE_SV2_GENESIS_NONCE, Old.NTime));
+    TEST_ASSERT_EQUAL_INT(PdqSubmitStale, s_Submits.LastResult);
+    TEST_ASSERT_EQUAL_INT(0, atomic_load(&s_Pool.Submits));
+}
+
+void Test_Sv2Client_SetTarget_RaisesDifficulty(void)
+{
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqFakeSv2PoolStart(&s_Pool, 0));
+    TEST_ASSERT_TRUE(RunUntilReady());
+    TEST_ASSERT_TRUE(PdqSv2CtxHasNewJob(&s_Ctx));
+
+    atomic_store(&s_Pool.SetTarget, 1);
+    TEST_ASSERT_TRUE(RunUntilNewJob());
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 2.0, PdqSv2CtxGetDifficulty(&s_Ctx));
+
+    PdqMiningJob_t Job;
+    PdqSv2CtxBuildJob(&s_Ctx, &Job);
+    TEST_ASSERT_EQUAL_HEX32(0x7FFF8000, Job.Target[6]);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_Sv2Proto_Frame_RoundTrips);
+    RUN_TEST(Test_Sv2Proto_Writer_OverflowIsSticky);
+    RUN_TEST(Test_Sv2Noise_ChaChaPoly_MatchesRfc8439);
+    RUN_TEST(Test_Secp256k1_Schnorr_MatchesBip340Vector);
+    RUN_TEST(Test_Secp256k1_EllSwift_DecodesAndAgrees);
+    RUN_TEST(Test_Sv2Noise_ParseAuthorityKey_Base58AndHex);
+    RUN_TEST(Test_Sv2Client_Handshake_OpensChannelWithJob);
+    RUN_TEST(Test_Sv2Client_SetupRefused_Disconnects);
+    RUN_TEST(Test_Sv2Client_WrongAuthority_RefusesPool);
+    RUN_TEST(Test_Sv2Client_BuildJob_MatchesGenesisHeader);
+    RUN_TEST(Test_Sv2Client_Submit_AcceptedWithJobFields);
+    RUN_TEST(Test_Sv2Client_Submit_RejectMapsToV1Code);
+    RUN_TEST(Test_Sv2Client_NewPrevHash_SwitchesJobAndRetiresOld);
+    RUN_TEST(Test_Sv2Client_SetTarget_RaisesDifficulty);
+    return UNITY_END();
+}
@@ -0,0 +1,161 @@
+/**
+ * @file test_target.c
+ * @brief Share/network target arithmetic and hit classification tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "core/target.h"
+#include <stdio.h>
+
+/* Genesis block header: nBits 0x1d00ffff, nonce 0x7c2bac1d */
+static const char* s_GenesisHeader =
+    "0100000000000000000000000000000000000000000000000000000000000000"
+    "000000003ba3edfd7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa"
+    "4b1e5e4a29ab5f49ffff001d1dac2b7c";
+
+static PdqMiningJob_t s_Job;
+
+void setUp(void)
+{
+    memset(&s_Job, 0, sizeof(s_Job));
+}
+
+void tearDown(void)
+{
+}
+
+/* Lay the header out the way PdqStratumBuildMiningJob does */
+static void LoadHeader(const char* p_Hex)
+{
+    uint8_t Header[80];
+    for (int i = 0; i < 80; i++) {
+        unsigned Byte;
+        sscanf(p_Hex + i * 2, "%2x", &Byte);
+        Header[i] = (uint8_t)Byte;
+    }
+    for (int i = 0; i < 20; i++) {
+        s_Job.HeaderSwapped[i] = ((uint32_t)Header[i*4] << 24) | ((uint32_t)Header[i*4+1] << 16) |
+                                 ((uint32_t)Header[i*4+2] << 8) | (uint32_t)Header[i*4+3];
+    }
+}
+
+static void AssertTarget(const uint32_t* p_Expected, const uint32_t* p_Actual)
+{
+    for (int i = 7; i >= 0; i--) {
+        TEST_ASSERT_EQUAL_HEX32(p_Expected[i], p_Actual[i]);
+    }
+}
+
+void Test_Target_FromDifficulty_One_IsPdiff1(void)
+{
+    const uint32_t Expected[8] = {0, 0, 0, 0, 0, 0, 0xFFFF0000, 0};
+    uint32_t Target[8];
+    PdqTargetFromDifficulty(1.0, Target);
+    AssertTarget(Expected, Target);
+}
+
+void Test_Target_FromDifficulty_Fractional_NotTruncated(void)
+{
+    /* 1.5 used to round down to 1 and give the pdiff1 target */
+    const uint32_t Expected[8] = {0, 0, 0, 0, 0, 0, 0xAAAA0000, 0};
+    uint32_t Target[8];
+    PdqTargetFromDifficulty(1.5, Target);
+    AssertTarget(Expected, Target);
+
+    const uint32_t Expected2[8] = {0xdd251565, 0x6298bc92, 0x8b1e9e6f, 0xe7cdd7c4,
+                                   0x0b24364e, 0xb5fb67e3, 0x00351556, 0};
+    PdqTargetFromDifficulty(1234.5678, Target);
+    AssertTarget(Expected2, Target);
+}
+
+void Test_Target_FromDifficulty_BelowOne_AllWordsExact(void)
+{
+    const uint32_t Expected[8] = {0x000013c6, 0xd10d2f00, 0xfffffff2, 0x08c9f735,
+                                  0xdc000000, 0xfffa2405, 0xfc17ffff, 0x000003e7};
+    uint32_t Target[8];
+    PdqTargetFromDifficulty(0.001, Target);
+    AssertTarget(Expected, Target);
+
+    /* Past 2^256 - 1 the target saturates */
+    const uint32_t AllOnes[8] = {~0u, ~0u, ~0u, ~0u, ~0u, ~0u, ~0u, ~0u};
+    PdqTargetFromDifficulty(1e-40, Target);
+    AssertTarget(AllOnes, Target);
+}
+
+void Test_Target_FromNBits_Decodes(void)
+{
+    const uint32_t Genesis[8] = {0, 0, 0, 0, 0, 0, 0xFFFF0000, 0};
+    uint32_t Target[8];
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqTargetFromNBits(0x1d00ffff, Target));
+    AssertTarget(Genesis, Target);
+
+    const uint32_t Mainnet[8] = {0, 0, 0, 0, 0, 0x0003a30c, 0, 0};
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqTargetFromNBits(0x1703a30c, Target));
+    AssertTarget(Mainnet, Target);
+
+    /* Small exponents shift the mantissa right */
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqTargetFromNBits(0x02123456, Target));
+    TEST_ASSERT_EQUAL_HEX32(0x1234, Target[0]);
+}
+
+void Test_Target_FromNBits_NegativeOrOverflow_Rejected(void)
+{
+    uint32_t Target[8];
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqTargetFromNBits(0x1d80ffff, Target));
+    TEST_ASSERT_EQUAL_INT(PdqErrorInvalidParam, PdqTargetFromNBits(0x23010000, Target));
+    for (int i = 0; i < 8; i++) TEST_ASSERT_EQUAL_HEX32(0, Target[i]);
+}
+
+void Test_Target_Classify_GenesisNonce_IsBlock(void)
+{
+    LoadHeader(s_GenesisHeader);
+    PdqTargetFromDifficulty(1.0, s_Job.Target);
+    TEST_ASSERT_EQUAL_INT(PdqOk, PdqTargetFromNBits(0x1d00ffff, s_Job.NetworkTarget));
+
+    uint32_t Hash[8];
+    PdqTargetHashJob(&s_Job, 0x7c2bac1d, Hash);
+    /* 000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f */
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, Hash[7]);
+    TEST_ASSERT_EQUAL_HEX32(0x0019d668, Hash[6]);
+    TEST_ASSERT_EQUAL_HEX32(0x0a8ce26f, Hash[0]);
+    TEST_ASSERT_EQUAL_INT(PdqHitBlock, PdqTargetClassify(&s_Job, Hash));
+    TEST_ASSERT_TRUE(PdqTargetToDifficulty(Hash) > 2536.0);
+}
+
+void Test_Target_Classify_ShareAndFalsePositive(void)
+{
+    LoadHeader(s_GenesisHeader);
+    uint32_t Hash[8];
+    PdqTargetHashJob(&s_Job, 0x7c2bac1d, Hash);
+
+    /* Meets the share target exactly, network target one below it */
+    memcpy(s_Job.Target, Hash, sizeof(Hash));
+    memcpy(s_Job.NetworkTarget, Hash, sizeof(Hash));
+    s_Job.NetworkTarget[0]--;
+    TEST_ASSERT_EQUAL_INT(PdqHitShare, PdqTargetClassify(&s_Job, Hash));
+
+    /* Share target just below the hash: the engine's hit was wrong */
+    s_Job.Target[0]--;
+    TEST_ASSERT_EQUAL_INT(PdqHitInvalid, PdqTargetClassify(&s_Job, Hash));
+
+    /* A different nonce hashes nowhere near either target */
+    PdqTargetFromDifficulty(1.0, s_Job.Target);
+    PdqTargetFromNBits(0x1d00ffff, s_Job.NetworkTarget);
+    PdqTargetHashJob(&s_Job, 0x7c2bac1e, Hash);
+    TEST_ASSERT_EQUAL_INT(PdqHitInvalid, PdqTargetClassify(&s_Job, Hash));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_Target_FromDifficulty_One_IsPdiff1);
+    RUN_TEST(Test_Target_FromDifficulty_Fractional_NotTruncated);
+    RUN_TEST(Test_Target_FromDifficulty_BelowOne_AllWordsExact);
+    RUN_TEST(Test_Target_FromNBits_Decodes);
+    RUN_TEST(Test_Target_FromNBits_NegativeOrOverflow_Rejected);
+    RUN_TEST(Test_Target_Classify_GenesisNonce_IsBlock);
+    RUN_TEST(Test_Target_Classify_ShareAndFalsePositive);
+    return UNITY_END();
+}
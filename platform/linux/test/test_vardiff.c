@@ -0,0 +1,131 @@
+/**
+ * @file test_vardiff.c
+ * @brief Client-side share difficulty controller tests
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pdq_test.h"
+#include "stratum/vardiff.h"
+
+#define HASHES_PER_DIFF1    4294967296.0
+
+static PdqVardiff_t s_Vd;
+static uint64_t     s_NowMs;
+static uint64_t     s_Hashes;
+static uint32_t     s_Shares;
+
+void setUp(void)
+{
+    PdqVardiffInit(&s_Vd, NULL, 1.0);
+    s_NowMs = 1000;
+    s_Hashes = 0;
+    s_Shares = 0;
+}
+
+void tearDown(void)
+{
+}
+
+/* Mine for one retarget window at HashRate, finding Shares shares */
+static bool RunWindow(double HashRate, uint32_t Shares, double PoolDifficulty, double* p_Suggest)
+{
+    if (!s_Vd.Started) PdqVardiffUpdate(&s_Vd, s_NowMs, s_Hashes, s_Shares, PoolDifficulty, p_Suggest);
+    s_NowMs += PDQ_VARDIFF_RETARGET_MS;
+    s_Hashes += (uint64_t)(HashRate * PDQ_VARDIFF_RETARGET_MS / 1000.0);
+    s_Shares += Shares;
+    return PdqVardiffUpdate(&s_Vd, s_NowMs, s_Hashes, s_Shares, PoolDifficulty, p_Suggest);
+}
+
+void Test_Vardiff_FastMiner_SuggestsTargetInterval(void)
+{
+    /* 10 GH/s at difficulty 1 finds a share every 0.43 s */
+    double Suggest = 0.0;
+    TEST_ASSERT_TRUE(RunWindow(10e9, 0, 1.0, &Suggest));
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 10e9 * 20.0 / HASHES_PER_DIFF1, Suggest);
+    TEST_ASSERT_EQUAL_INT(1, s_Vd.Retargets);
+}
+
+void Test_Vardiff_InBand_NoSuggestion(void)
+{
+    /* 200 MH/s at difficulty 1: one share per 21.5 s */
+    double Suggest = 0.0;
+    TEST_ASSERT_FALSE(RunWindow(200e6, 1, 1.0, &Suggest));
+    TEST_ASSERT_FALSE(RunWindow(200e6, 2, 1.0, &Suggest));
+}
+
+void Test_Vardiff_SlowMiner_NeverBelowPoolFloor(void)
+{
+    /* 1 MH/s would need difficulty 0.005; the floor is already in force */
+    double Suggest = 0.0;
+    TEST_ASSERT_FALSE(RunWindow(1e6, 0, 1.0, &Suggest));
+
+    /* After running high it comes back down, but no lower than the floor */
+    TEST_ASSERT_TRUE(RunWindow(1e6, 0, 64.0, &Suggest));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, 1.0, Suggest);
+}
+
+void Test_Vardiff_SlowerThanBand_SuggestsLower(void)
+{
+    /* 1 GH/s at difficulty 1000: one share per 72 minutes */
+    double Suggest = 0.0;
+    TEST_ASSERT_TRUE(RunWindow(1e9, 0, 1000.0, &Suggest));
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 1e9 * 20.0 / HASHES_PER_DIFF1, Suggest);
+}
+
+void Test_Vardiff_Hysteresis_NoRepeatUntilPoolMoves(void)
+{
+    double Suggest = 0.0;
+    TEST_ASSERT_TRUE(RunWindow(10e9, 0, 1.0, &Suggest));
+    double First = Suggest;
+
+    /* Pool has not applied it yet: the same suggestion is not resent */
+    TEST_ASSERT_FALSE(RunWindow(10e9, 0, 1.0, &Suggest));
+
+    /* Applied: now inside the band */
+    TEST_ASSERT_FALSE(RunWindow(10e9, 1, First, &Suggest));
+
+    /* Hashrate grows 5 %: the interval stays inside the band */
+    TEST_ASSERT_FALSE(RunWindow(10.5e9, 2, First, &Suggest));
+
+    /* Hashrate triples: the interval leaves the band */
+    TEST_ASSERT_TRUE(RunWindow(30e9, 3, First, &Suggest));
+    TEST_ASSERT_DOUBLE_WITHIN(0.01, 3.0 * First, Suggest);
+}
+
+void Test_Vardiff_ShareRate_PullsEstimate(void)
+{
+    /* Hashrate alone says 15 s per share, in band; the pool credited 300
+     * shares in the window, so the blended interval drops below 10 s */
+    double Suggest = 0.0;
+    double HashRate = HASHES_PER_DIFF1 / 15.0;
+    TEST_ASSERT_FALSE(RunWindow(HashRate, 2, 1.0, &Suggest));
+    TEST_ASSERT_TRUE(RunWindow(HashRate, 300, 1.0, &Suggest));
+    TEST_ASSERT_TRUE(Suggest > 2.0);
+}
+
+void Test_Vardiff_ShortWindowOrCounterReset_Waits(void)
+{
+    double Suggest = 0.0;
+    PdqVardiffUpdate(&s_Vd, 1000, 0, 0, 1.0, &Suggest);
+    TEST_ASSERT_FALSE(PdqVardiffUpdate(&s_Vd, 1000 + PDQ_VARDIFF_RETARGET_MS / 2,
+                                       (uint64_t)5e12, 0, 1.0, &Suggest));
+
+    /* Counters went back (miner restarted): a fresh window starts */
+    TEST_ASSERT_FALSE(PdqVardiffUpdate(&s_Vd, 1000 + PDQ_VARDIFF_RETARGET_MS,
+                                       (uint64_t)1e9, 0, 1.0, &Suggest));
+    TEST_ASSERT_EQUAL_INT(1000 + PDQ_VARDIFF_RETARGET_MS, (int)s_Vd.WindowStartMs);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(Test_Vardiff_FastMiner_SuggestsTargetInterval);
+    RUN_TEST(Test_Vardiff_InBand_NoSuggestion);
+    RUN_TEST(Test_Vardiff_SlowMiner_NeverBelowPoolFloor);
+    RUN_TEST(Test_Vardiff_SlowerThanBand_SuggestsLower);
+    RUN_TEST(Test_Vardiff_Hysteresis_NoRepeatUntilPoolMoves);
+    RUN_TEST(Test_Vardiff_ShareRate_PullsEstimate);
+    RUN_TEST(Test_Vardiff_ShortWindowOrCounterReset_Waits);
+    return UNITY_END();
+}
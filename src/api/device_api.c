@@ -1,29 +1,493 @@
 /**
  * @file device_api.c
- * @brief REST API for PDQManager communication stub
+ * @brief REST API for PDQManager communication
  * @copyright Copyright (c) 2025 PDQminer Contributors
  * @license GPL-3.0
  */
 
 #include "device_api.h"
+#include "core/sha256_engine.h"
+#include "stratum/stratum_json.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
 
-static bool s_Running = false;
+#define JSON_TYPE           "application/json"
+#define METRICS_TYPE        "text/plain; version=0.0.4; charset=utf-8"
 
-PdqError_t PdqApiInit(void) {
+/* Response body under construction; stops writing once it overflows */
+typedef struct {
+    char*  p_Buf;
+    size_t Size;
+    size_t Len;
+    bool   Overflow;
+} Out_t;
+
+static bool               s_Running = false;
+static PdqApiSnapshotFn_t s_Source = NULL;
+static void*              s_SourceArg = NULL;
+static PdqApiSnapshot_t   s_Snapshot;
+
+static bool     s_HasPassword = false;
+static char     s_Password[PDQ_MAX_PASSWORD_LEN + 1];
+static uint8_t  s_Secret[32];
+static uint32_t s_TokenSeq = 0;
+static char     s_Token[PDQ_API_TOKEN_LEN + 1];
+static uint64_t s_TokenExpiryMs = 0;
+
+static void Put(Out_t* p_Out, const char* p_Format, ...)
+{
+    if (p_Out->Overflow) return;
+    va_list Args;
+    va_start(Args, p_Format);
+    int Len = vsnprintf(p_Out->p_Buf + p_Out->Len, p_Out->Size - p_Out->Len, p_Format, Args);
+    va_end(Args);
+    if (Len < 0 || (size_t)Len >= p_Out->Size - p_Out->Len) {
+        p_Out->Overflow = true;
+        return;
+    }
+    p_Out->Len += (size_t)Len;
+}
+
+/* A JSON string, quotes included */
+static void PutJsonString(Out_t* p_Out, const char* p_Str)
+{
+    Put(p_Out, "\"");
+    for (const char* p = p_Str; *p; p++) {
+        unsigned char Ch = (unsigned char)*p;
+        if (Ch == '"' || Ch == '\\') {
+            Put(p_Out, "\\%c", Ch);
+        } else if (Ch < 0x20) {
+            Put(p_Out, "\\u%04x", Ch);
+        } else {
+            Put(p_Out, "%c", Ch);
+        }
+    }
+    Put(p_Out, "\"");
+}
+
+/* A Prometheus label value, without the quotes */
+static void PutLabel(Out_t* p_Out, const char* p_Str)
+{
+    for (const char* p = p_Str; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            Put(p_Out, "\\%c", *p);
+        } else if (*p == '\n') {
+            Put(p_Out, "\\n");
+        } else {
+            Put(p_Out, "%c", *p);
+        }
+    }
+}
+
+static void SumPools(const PdqApiSnapshot_t* p_Snap, PdqMinerStats_t* p_Total)
+{
+    memset(p_Total, 0, sizeof(*p_Total));
+    for (uint32_t i = 0; i < p_Snap->PoolCount; i++) {
+        const PdqMinerStats_t* p_Own = &p_Snap->Pools[i].Stats;
+        p_Total->HashRate += p_Own->HashRate;
+        p_Total->TotalHashes += p_Own->TotalHashes;
+        p_Total->SharesAccepted += p_Own->SharesAccepted;
+        p_Total->SharesRejected += p_Own->SharesRejected;
+        p_Total->SharesTimedOut += p_Own->SharesTimedOut;
+        p_Total->SharesStale += p_Own->SharesStale;
+        p_Total->BlocksFound += p_Own->BlocksFound;
+        p_Total->SubmitLatencySumMs += p_Own->SubmitLatencySumMs;
+        for (int b = 0; b < PDQ_SUBMIT_LATENCY_BUCKETS; b++) {
+            p_Total->SubmitLatencyHist[b] += p_Own->SubmitLatencyHist[b];
+        }
+    }
+}
+
+/* The pool shown as "the" pool: the first one that is up, else the first */
+static const PdqApiPool_t* MainPool(const PdqApiSnapshot_t* p_Snap)
+{
+    for (uint32_t i = 0; i < p_Snap->PoolCount; i++) {
+        if (p_Snap->Pools[i].Ready) return &p_Snap->Pools[i];
+    }
+    return p_Snap->PoolCount ? &p_Snap->Pools[0] : NULL;
+}
+
+static const char* Bool(bool Value)
+{
+    return Value ? "true" : "false";
+}
+
+/* ---- Bodies ---- */
+
+static void RenderStatus(Out_t* p_Out, const PdqApiSnapshot_t* p_Snap)
+{
+    PdqMinerStats_t Total;
+    SumPools(p_Snap, &Total);
+    const PdqApiPool_t* p_Main = MainPool(p_Snap);
+
+    Put(p_Out, "{\"device_id\":");
+    PutJsonString(p_Out, p_Snap->DeviceId);
+    Put(p_Out, ",\"firmware_version\":\"%d.%d.%d\",\"mode\":\"%s\",\"uptime_s\":%lu,"
+               "\"hashrate_khs\":%.3f,\"threads\":%lu,\"shares_accepted\":%lu,\"shares_rejected\":%lu,"
+               "\"shares_timed_out\":%lu,\"shares_stale\":%lu,\"blocks_found\":%lu,"
+               "\"pool_connected\":%s,\"free_heap\":%lu,\"temperature\":%.1f",
+        PDQ_VERSION_MAJOR, PDQ_VERSION_MINOR, PDQ_VERSION_PATCH, p_Snap->p_Mode ? p_Snap->p_Mode : "pool",
+        (unsigned long)p_Snap->UptimeSec, Total.HashRate / 1000.0, (unsigned long)p_Snap->ThreadCount,
+        (unsigned long)Total.SharesAccepted, (unsigned long)Total.SharesRejected,
+        (unsigned long)Total.SharesTimedOut, (unsigned long)Total.SharesStale,
+        (unsigned long)Total.BlocksFound, Bool(p_Main && p_Main->Ready),
+        (unsigned long)p_Snap->FreeHeap, (double)p_Snap->Temperature);
+    if (p_Main) {
+        Put(p_Out, ",\"pool_host\":");
+        PutJsonString(p_Out, p_Main->Host);
+        Put(p_Out, ",\"pool_port\":%u,\"difficulty\":%.10g", (unsigned)p_Main->Port, p_Main->Difficulty);
+    }
+
+    Put(p_Out, ",\"pools\":[");
+    for (uint32_t i = 0; i < p_Snap->PoolCount; i++) {
+        const PdqApiPool_t* p_Pool = &p_Snap->Pools[i];
+        Put(p_Out, "%s{\"host\":", i ? "," : "");
+        PutJsonString(p_Out, p_Pool->Host);
+        Put(p_Out, ",\"port\":%u,\"connected\":%s,\"backup\":%s,\"parked\":%s,\"weight\":%lu,"
+                   "\"difficulty\":%.10g,\"jobs\":%lu,\"hashrate_khs\":%.3f,"
+                   "\"shares_accepted\":%lu,\"shares_rejected\":%lu}",
+            (unsigned)p_Pool->Port, Bool(p_Pool->Ready), Bool(p_Pool->Backup), Bool(p_Pool->Parked),
+            (unsigned long)p_Pool->Weight, p_Pool->Difficulty, (unsigned long)p_Pool->Jobs,
+            p_Pool->Stats.HashRate / 1000.0, (unsigned long)p_Pool->Stats.SharesAccepted,
+            (unsigned long)p_Pool->Stats.SharesRejected);
+    }
+    Put(p_Out, "]}");
+}
+
+static void RenderInfo(Out_t* p_Out, const PdqApiSnapshot_t* p_Snap)
+{
+    Put(p_Out, "{\"device_id\":");
+    PutJsonString(p_Out, p_Snap->DeviceId);
+    Put(p_Out, ",\"firmware_version\":\"%d.%d.%d\",\"hardware\":", PDQ_VERSION_MAJOR, PDQ_VERSION_MINOR,
+        PDQ_VERSION_PATCH);
+    PutJsonString(p_Out, p_Snap->p_Hardware ? p_Snap->p_Hardware : "");
+    Put(p_Out, ",\"cpu_mhz\":%lu,\"threads\":%lu,\"free_heap\":%lu}", (unsigned long)p_Snap->CpuMhz,
+        (unsigned long)p_Snap->ThreadCount, (unsigned long)p_Snap->FreeHeap);
+}
+
+/* Field names as PDQManager's DeviceConfig; passwords are never sent */
+static void RenderConfig(Out_t* p_Out, const PdqApiSnapshot_t* p_Snap)
+{
+    const PdqDeviceConfig_t* p_Config = &p_Snap->Config;
+    Put(p_Out, "{\"wifi_ssid\":");
+    PutJsonString(p_Out, p_Config->Wifi.Ssid);
+    Put(p_Out, ",\"pool1_host\":");
+    PutJsonString(p_Out, p_Config->PrimaryPool.Host);
+    Put(p_Out, ",\"pool1_port\":%u", (unsigned)p_Config->PrimaryPool.Port);
+    if (p_Config->BackupPool.Host[0]) {
+        Put(p_Out, ",\"pool2_host\":");
+        PutJsonString(p_Out, p_Config->BackupPool.Host);
+        Put(p_Out, ",\"pool2_port\":%u", (unsigned)p_Config->BackupPool.Port);
+    }
+    Put(p_Out, ",\"wallet\":");
+    PutJsonString(p_Out, p_Config->WalletAddress);
+    Put(p_Out, ",\"worker\":");
+    PutJsonString(p_Out, p_Config->WorkerName);
+    Put(p_Out, "}");
+}
+
+static void MetricHead(Out_t* p_Out, const char* p_Name, const char* p_Type, const char* p_Help)
+{
+    Put(p_Out, "# HELP %s %s\n# TYPE %s %s\n", p_Name, p_Help, p_Name, p_Type);
+}
+
+static void PoolLabels(Out_t* p_Out, const PdqApiPool_t* p_Pool, uint32_t Index)
+{
+    Put(p_Out, "session=\"%lu\",pool=\"", (unsigned long)Index);
+    PutLabel(p_Out, p_Pool->Host);
+    Put(p_Out, ":%u\"", (unsigned)p_Pool->Port);
+}
+
+/* One line per pool of a per-pool value */
+static void PoolMetric(Out_t* p_Out, const PdqApiSnapshot_t* p_Snap, const char* p_Name,
+                       double (*Value)(const PdqApiPool_t*))
+{
+    for (uint32_t i = 0; i < p_Snap->PoolCount; i++) {
+        Put(p_Out, "%s{", p_Name);
+        PoolLabels(p_Out, &p_Snap->Pools[i], i);
+        Put(p_Out, "} %.10g\n", Value(&p_Snap->Pools[i]));
+    }
+}
+
+static double PoolUp(const PdqApiPool_t* p_Pool)        { return p_Pool->Ready; }
+static double PoolBackup(const PdqApiPool_t* p_Pool)    { return p_Pool->Backup; }
+static double PoolParked(const PdqApiPool_t* p_Pool)    { return p_Pool->Parked; }
+static double PoolWeight(const PdqApiPool_t* p_Pool)    { return p_Pool->Weight; }
+static double PoolDiff(const PdqApiPool_t* p_Pool)      { return p_Pool->Difficulty; }
+static double PoolRate(const PdqApiPool_t* p_Pool)      { return p_Pool->Stats.HashRate; }
+static double PoolHashes(const PdqApiPool_t* p_Pool)    { return (double)p_Pool->Stats.TotalHashes; }
+static double PoolJobs(const PdqApiPool_t* p_Pool)      { return p_Pool->Jobs; }
+static double PoolClean(const PdqApiPool_t* p_Pool)     { return p_Pool->CleanJobs; }
+static double PoolBlocks(const PdqApiPool_t* p_Pool)    { return p_Pool->Stats.BlocksFound; }
+
+static void RenderMetrics(Out_t* p_Out, const PdqApiSnapshot_t* p_Snap)
+{
+    PdqMinerStats_t Total;
+    SumPools(p_Snap, &Total);
+
+    MetricHead(p_Out, "pdq_info", "gauge", "Firmware version and work source");
+    Put(p_Out, "pdq_info{version=\"%d.%d.%d\",mode=\"%s\",hardware=\"", PDQ_VERSION_MAJOR, PDQ_VERSION_MINOR,
+        PDQ_VERSION_PATCH, p_Snap->p_Mode ? p_Snap->p_Mode : "pool");
+    PutLabel(p_Out, p_Snap->p_Hardware ? p_Snap->p_Hardware : "");
+    Put(p_Out, "\",device_id=\"");
+    PutLabel(p_Out, p_Snap->DeviceId);
+    Put(p_Out, "\"} 1\n");
+    MetricHead(p_Out, "pdq_uptime_seconds", "gauge", "Seconds since the miner started");
+    Put(p_Out, "pdq_uptime_seconds %lu\n", (unsigned long)p_Snap->UptimeSec);
+    MetricHead(p_Out, "pdq_threads", "gauge", "Mining threads running");
+    Put(p_Out, "pdq_threads %lu\n", (unsigned long)p_Snap->ThreadCount);
+    MetricHead(p_Out, "pdq_hashrate_hps", "gauge", "Hashes per second over the last second");
+    Put(p_Out, "pdq_hashrate_hps %lu\n", (unsigned long)Total.HashRate);
+    MetricHead(p_Out, "pdq_hashes_total", "counter", "Hashes computed");
+    Put(p_Out, "pdq_hashes_total %llu\n", (unsigned long long)Total.TotalHashes);
+
+    MetricHead(p_Out, "pdq_thread_hashrate_hps", "gauge", "Hashes per second by mining thread");
+    for (uint32_t t = 0; t < p_Snap->ThreadCount && t < PDQ_API_MAX_THREADS; t++) {
+        Put(p_Out, "pdq_thread_hashrate_hps{thread=\"%lu\"} %lu\n", (unsigned long)t,
+            (unsigned long)p_Snap->ThreadHashRate[t]);
+    }
+    MetricHead(p_Out, "pdq_thread_hashes_total", "counter", "Hashes computed by mining thread");
+    for (uint32_t t = 0; t < p_Snap->ThreadCount && t < PDQ_API_MAX_THREADS; t++) {
+        Put(p_Out, "pdq_thread_hashes_total{thread=\"%lu\"} %llu\n", (unsigned long)t,
+            (unsigned long long)p_Snap->ThreadHashes[t]);
+    }
+
+    static const char* const Outcomes[] = {"accepted", "rejected", "timed_out", "stale"};
+    MetricHead(p_Out, "pdq_shares_total", "counter", "Shares by outcome");
+    for (uint32_t i = 0; i < p_Snap->PoolCount; i++) {
+        const PdqMinerStats_t* p_Stats = &p_Snap->Pools[i].Stats;
+        const uint32_t Counts[] = {p_Stats->SharesAccepted, p_Stats->SharesRejected,
+                                   p_Stats->SharesTimedOut, p_Stats->SharesStale};
+        for (int k = 0; k < 4; k++) {
+            Put(p_Out, "pdq_shares_total{");
+            PoolLabels(p_Out, &p_Snap->Pools[i], i);
+            Put(p_Out, ",outcome=\"%s\"} %lu\n", Outcomes[k], (unsigned long)Counts[k]);
+        }
+    }
+    MetricHead(p_Out, "pdq_blocks_found_total", "counter", "Hits meeting the network target");
+    PoolMetric(p_Out, p_Snap, "pdq_blocks_found_total", PoolBlocks);
+
+    /* Latencies are whole milliseconds, so bucket b, [2^(b-1), 2^b) ms,
+     * holds replies that took under 2^b ms */
+    MetricHead(p_Out, "pdq_submit_latency_seconds", "histogram", "Time from submit to the pool's answer");
+    for (uint32_t i = 0; i < p_Snap->PoolCount; i++) {
+        const PdqMinerStats_t* p_Stats = &p_Snap->Pools[i].Stats;
+        uint64_t Count = 0;
+        for (int b = 0; b < PDQ_SUBMIT_LATENCY_BUCKETS; b++) {
+            Count += p_Stats->SubmitLatencyHist[b];
+            Put(p_Out, "pdq_submit_latency_seconds_bucket{");
+            PoolLabels(p_Out, &p_Snap->Pools[i], i);
+            if (b < PDQ_SUBMIT_LATENCY_BUCKETS - 1) {
+                Put(p_Out, ",le=\"%g\"} %llu\n", (double)(1u << b) / 1000.0, (unsigned long long)Count);
+            } else {
+                Put(p_Out, ",le=\"+Inf\"} %llu\n", (unsigned long long)Count);
+            }
+        }
+        Put(p_Out, "pdq_submit_latency_seconds_sum{");
+        PoolLabels(p_Out, &p_Snap->Pools[i], i);
+        Put(p_Out, "} %.3f\n", p_Stats->SubmitLatencySumMs / 1000.0);
+        Put(p_Out, "pdq_submit_latency_seconds_count{");
+        PoolLabels(p_Out, &p_Snap->Pools[i], i);
+        Put(p_Out, "} %llu\n", (unsigned long long)Count);
+    }
+
+    MetricHead(p_Out, "pdq_jobs_total", "counter", "Jobs handed to the miners");
+    PoolMetric(p_Out, p_Snap, "pdq_jobs_total", PoolJobs);
+    MetricHead(p_Out, "pdq_clean_jobs_total", "counter", "Jobs that retired the previous one");
+    PoolMetric(p_Out, p_Snap, "pdq_clean_jobs_total", PoolClean);
+    MetricHead(p_Out, "pdq_pool_hashrate_hps", "gauge", "Hashes per second for the pool");
+    PoolMetric(p_Out, p_Snap, "pdq_pool_hashrate_hps", PoolRate);
+    MetricHead(p_Out, "pdq_pool_hashes_total", "counter", "Hashes computed for the pool");
+    PoolMetric(p_Out, p_Snap, "pdq_pool_hashes_total", PoolHashes);
+    MetricHead(p_Out, "pdq_pool_up", "gauge", "1 while shares can be submitted");
+    PoolMetric(p_Out, p_Snap, "pdq_pool_up", PoolUp);
+    MetricHead(p_Out, "pdq_pool_backup", "gauge", "1 while on the backup pool");
+    PoolMetric(p_Out, p_Snap, "pdq_pool_backup", PoolBackup);
+    MetricHead(p_Out, "pdq_pool_parked", "gauge", "1 while its miners are paused");
+    PoolMetric(p_Out, p_Snap, "pdq_pool_parked", PoolParked);
+    MetricHead(p_Out, "pdq_pool_weight", "gauge", "Share of the mining threads");
+    PoolMetric(p_Out, p_Snap, "pdq_pool_weight", PoolWeight);
+    MetricHead(p_Out, "pdq_pool_difficulty", "gauge", "Share difficulty set by the pool");
+    PoolMetric(p_Out, p_Snap, "pdq_pool_difficulty", PoolDiff);
+}
+
+/* ---- Authentication ---- */
+
+/* Compares every byte whatever the first mismatch */
+static bool SameSecret(const char* p_A, const char* p_B)
+{
+    size_t LenA = strlen(p_A);
+    size_t LenB = strlen(p_B);
+    uint8_t Diff = (uint8_t)(LenA != LenB);
+    for (size_t i = 0; i < LenA; i++) {
+        Diff |= (uint8_t)(p_A[i] ^ p_B[LenB ? i % LenB : 0]);
+    }
+    return Diff == 0;
+}
+
+static void NewToken(uint64_t NowMs)
+{
+    uint8_t Seed[sizeof(s_Secret) + 12];
+    uint8_t Hash[32];
+    memcpy(Seed, s_Secret, sizeof(s_Secret));
+    s_TokenSeq++;
+    memcpy(Seed + sizeof(s_Secret), &s_TokenSeq, 4);
+    memcpy(Seed + sizeof(s_Secret) + 4, &NowMs, 8);
+    PdqSha256(Seed, sizeof(Seed), Hash);
+    for (int i = 0; i < PDQ_API_TOKEN_LEN / 2; i++) {
+        snprintf(s_Token + 2 * i, 3, "%02x", Hash[i]);
+    }
+    s_TokenExpiryMs = NowMs + (uint64_t)PDQ_API_TOKEN_TTL_S * 1000;
+}
+
+static bool Authorized(const PdqApiRequest_t* p_Request)
+{
+    static const char Prefix[] = "Bearer ";
+    const char* p_Auth = p_Request->p_Authorization;
+    if (!s_Token[0] || p_Request->NowMs >= s_TokenExpiryMs || !p_Auth) return false;
+    if (strncmp(p_Auth, Prefix, sizeof(Prefix) - 1) != 0) return false;
+    return SameSecret(p_Auth + sizeof(Prefix) - 1, s_Token);
+}
+
+static void Fail(Out_t* p_Out, PdqApiResponse_t* p_Response, int Status, const char* p_Message)
+{
+    p_Response->Status = Status;
+    Put(p_Out, "{\"error\":\"%s\"}", p_Message);
+}
+
+static void HandleAuth(const PdqApiRequest_t* p_Request, Out_t* p_Out, PdqApiResponse_t* p_Response)
+{
+    PdqJsonToken_t Tokens[8];
+    PdqJsonDoc_t Doc;
+    char Password[PDQ_MAX_PASSWORD_LEN + 1];
+
+    if (!s_HasPassword) {
+        Fail(p_Out, p_Response, 403, "no password set");
+        return;
+    }
+    int Field = -1;
+    if (p_Request->p_Body &&
+        PdqJsonParse(&Doc, p_Request->p_Body, p_Request->BodyLen, Tokens, 8) == PdqOk &&
+        PdqJsonTypeOf(&Doc, 0) == PdqJsonObject) {
+        Field = PdqJsonObjectGet(&Doc, 0, "password");
+    }
+    if (Field < 0 || PdqJsonGetString(&Doc, Field, Password, sizeof(Password)) < 0) {
+        Fail(p_Out, p_Response, 400, "expected a password");
+        return;
+    }
+    if (!SameSecret(Password, s_Password)) {
+        Fail(p_Out, p_Response, 401, "unauthorized");
+        return;
+    }
+    NewToken(p_Request->NowMs);
+    Put(p_Out, "{\"token\":\"%s\",\"expires_in\":%d}", s_Token, PDQ_API_TOKEN_TTL_S);
+}
+
+/* ---- API ---- */
+
+PdqError_t PdqApiInit(void)
+{
     s_Running = false;
     return PdqOk;
 }
 
-PdqError_t PdqApiStart(void) {
+PdqError_t PdqApiStart(void)
+{
     s_Running = true;
     return PdqOk;
 }
 
-PdqError_t PdqApiStop(void) {
+PdqError_t PdqApiStop(void)
+{
     s_Running = false;
     return PdqOk;
 }
 
-PdqError_t PdqApiProcess(void) {
+/* Requests are answered as the platform's server receives them */
+PdqError_t PdqApiProcess(void)
+{
+    return PdqOk;
+}
+
+void PdqApiSetSource(PdqApiSnapshotFn_t Fn, void* p_Arg)
+{
+    s_Source = Fn;
+    s_SourceArg = p_Arg;
+}
+
+void PdqApiSetPassword(const char* p_Password, const uint8_t* p_Secret, size_t SecretLen)
+{
+    s_HasPassword = p_Password && p_Password[0];
+    snprintf(s_Password, sizeof(s_Password), "%s", s_HasPassword ? p_Password : "");
+    memset(s_Secret, 0, sizeof(s_Secret));
+    if (p_Secret) memcpy(s_Secret, p_Secret, SecretLen < sizeof(s_Secret) ? SecretLen : sizeof(s_Secret));
+    /* Tokens issued under the old password stop working */
+    s_Token[0] = '\0';
+    s_TokenExpiryMs = 0;
+}
+
+PdqError_t PdqApiHandle(const PdqApiRequest_t* p_Request, char* p_Out, size_t OutSize,
+                        PdqApiResponse_t* p_Response)
+{
+    if (!p_Response) return PdqErrorInvalidParam;
+    p_Response->Status = 500;
+    p_Response->p_ContentType = JSON_TYPE;
+    p_Response->Len = 0;
+    if (!p_Request || !p_Request->p_Method || !p_Request->p_Path || !p_Out || OutSize == 0) {
+        return PdqErrorInvalidParam;
+    }
+
+    Out_t Out = {p_Out, OutSize, 0, false};
+    const char* p_Path = p_Request->p_Path;
+    bool Get = strcmp(p_Request->p_Method, "GET") == 0;
+    bool Post = strcmp(p_Request->p_Method, "POST") == 0;
+    p_Response->Status = 200;
+
+    if (!s_Running) {
+        Fail(&Out, p_Response, 503, "api stopped");
+    } else if (strcmp(p_Path, "/api/auth") == 0) {
+        if (Post) {
+            HandleAuth(p_Request, &Out, p_Response);
+        } else {
+            Fail(&Out, p_Response, 405, "method not allowed");
+        }
+    } else if (strcmp(p_Path, "/api/status") == 0 || strcmp(p_Path, "/api/info") == 0 ||
+               strcmp(p_Path, "/api/config") == 0 || strcmp(p_Path, "/metrics") == 0) {
+        bool Config = strcmp(p_Path, "/api/config") == 0;
+        if (!Get) {
+            Fail(&Out, p_Response, 405, "method not allowed");
+        } else if (Config && !s_HasPassword) {
+            Fail(&Out, p_Response, 403, "no password set");
+        } else if (Config && !Authorized(p_Request)) {
+            Fail(&Out, p_Response, 401, "unauthorized");
+        } else {
+            memset(&s_Snapshot, 0, sizeof(s_Snapshot));
+            if (s_Source) s_Source(s_SourceArg, &s_Snapshot);
+            if (s_Snapshot.PoolCount > PDQ_API_MAX_POOLS) s_Snapshot.PoolCount = PDQ_API_MAX_POOLS;
+            if (s_Snapshot.ThreadCount > PDQ_API_MAX_THREADS) s_Snapshot.ThreadCount = PDQ_API_MAX_THREADS;
+
+            if (p_Path[1] == 'm') {
+                p_Response->p_ContentType = METRICS_TYPE;
+                RenderMetrics(&Out, &s_Snapshot);
+            } else if (Config) {
+                RenderConfig(&Out, &s_Snapshot);
+            } else if (strcmp(p_Path, "/api/info") == 0) {
+                RenderInfo(&Out, &s_Snapshot);
+            } else {
+                RenderStatus(&Out, &s_Snapshot);
+            }
+        }
+    } else {
+        Fail(&Out, p_Response, 404, "not found");
+    }
+
+    if (Out.Overflow) {
+        p_Response->Status = 500;
+        p_Response->p_ContentType = JSON_TYPE;
+        p_Response->Len = 0;
+        return PdqErrorBufferTooSmall;
+    }
+    p_Response->Len = Out.Len;
     return PdqOk;
 }
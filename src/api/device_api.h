@@ -3,6 +3,19 @@
  * @brief REST API for PDQManager communication
  * @copyright Copyright (c) 2025 PDQminer Contributors
  * @license GPL-3.0
+ *
+ * Routes one HTTP request to its handler and renders the response body
+ * into the caller's buffer; the platform owns the sockets. Mining state
+ * comes from a snapshot the platform fills on demand, so rendering reads
+ * only a copy and never takes a lock the miners hold.
+ *
+ *   GET  /api/status   hashrate, shares and pool state (JSON, public)
+ *   GET  /api/info     firmware and hardware (JSON, public)
+ *   POST /api/auth     {"password": ...} -> {"token": ..., "expires_in": ...}
+ *   GET  /api/config   pools and credentials, without passwords (Bearer token)
+ *   GET  /metrics      Prometheus text exposition format 0.0.4 (public)
+ *
+ * Protected endpoints answer 403 until a password is set.
  */
 
 #ifndef PDQ_DEVICE_API_H
@@ -14,11 +27,78 @@
 extern "C" {
 #endif
 
+#define PDQ_API_MAX_THREADS     32
+#define PDQ_API_MAX_POOLS       8
+#define PDQ_API_TOKEN_LEN       32      /* Hex characters */
+#define PDQ_API_TOKEN_TTL_S     3600
+
+/* One work source: a pool session, the SV2 channel or the solo node */
+typedef struct {
+    char            Host[PDQ_MAX_HOST_LEN + 1];
+    uint16_t        Port;
+    bool            Ready;          /* Authorized, shares can be submitted */
+    bool            Backup;         /* Running on the backup pool */
+    bool            Parked;         /* Miners paused until it is back */
+    uint32_t        Weight;         /* Share of the threads */
+    double          Difficulty;
+    uint32_t        Jobs;           /* Jobs handed to the miners ... */
+    uint32_t        CleanJobs;      /* ... of which retired the previous one */
+    PdqMinerStats_t Stats;
+} PdqApiPool_t;
+
+typedef struct {
+    char              DeviceId[24];
+    const char*       p_Hardware;
+    const char*       p_Mode;       /* "pool", "sv2", "solo" or "proxy" */
+    uint32_t          UptimeSec;
+    uint32_t          FreeHeap;
+    uint32_t          CpuMhz;
+    float             Temperature;
+    uint32_t          ThreadCount;
+    uint32_t          ThreadHashRate[PDQ_API_MAX_THREADS];
+    uint64_t          ThreadHashes[PDQ_API_MAX_THREADS];
+    uint32_t          PoolCount;
+    PdqApiPool_t      Pools[PDQ_API_MAX_POOLS];
+    PdqDeviceConfig_t Config;
+} PdqApiSnapshot_t;
+
+/* Fills p_Snapshot, which arrives zeroed. Called once per request that
+ * needs it, from the thread that calls PdqApiHandle(). */
+typedef void (*PdqApiSnapshotFn_t)(void* p_Arg, PdqApiSnapshot_t* p_Snapshot);
+
+typedef struct {
+    const char* p_Method;
+    const char* p_Path;             /* Without the query string */
+    const char* p_Authorization;    /* Header value, NULL if absent */
+    const char* p_Body;
+    size_t      BodyLen;
+    uint64_t    NowMs;              /* Monotonic, for token expiry */
+} PdqApiRequest_t;
+
+typedef struct {
+    int         Status;
+    const char* p_ContentType;
+    size_t      Len;                /* Body bytes written */
+} PdqApiResponse_t;
+
 PdqError_t PdqApiInit(void);
 PdqError_t PdqApiStart(void);
 PdqError_t PdqApiStop(void);
 PdqError_t PdqApiProcess(void);
 
+void       PdqApiSetSource(PdqApiSnapshotFn_t Fn, void* p_Arg);
+
+/* Password for /api/auth, NULL to lock the protected endpoints. Tokens
+ * are derived from p_Secret, which should be random. */
+void       PdqApiSetPassword(const char* p_Password, const uint8_t* p_Secret, size_t SecretLen);
+
+/* Render the response to one request. Always fills p_Response; a body
+ * that does not fit in OutSize becomes a 500 with an empty body and
+ * PdqErrorBufferTooSmall. While the API is stopped every request gets
+ * a 503. */
+PdqError_t PdqApiHandle(const PdqApiRequest_t* p_Request, char* p_Out, size_t OutSize,
+                        PdqApiResponse_t* p_Response);
+
 #ifdef __cplusplus
 }
 #endif
@@ -24,6 +24,10 @@ extern "C" {
 #define PDQ_CONFIG_KEY_WALLET     "wallet"
 #define PDQ_CONFIG_KEY_WORKER     "worker"
 #define PDQ_CONFIG_KEY_DISPLAY    "display"
+#define PDQ_CONFIG_KEY_POOLS      "pools"
+#define PDQ_CONFIG_KEY_THREADS    "threads"
+#define PDQ_CONFIG_KEY_DIFFICULTY "difficulty"
+#define PDQ_CONFIG_KEY_SHARE_INTERVAL "share_interval"
 #define PDQ_CONFIG_KEY_VALID      "valid"
 
 #define PDQ_CONFIG_MAGIC          0x50445143
@@ -7,6 +7,7 @@
 
 #include "mining_task.h"
 #include "sha256_engine.h"
+#include "target.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -49,6 +50,10 @@ typedef struct {
     volatile uint32_t       HashRate;
     volatile uint32_t       SharesAccepted;
     volatile uint32_t       SharesRejected;
+    volatile uint32_t       SharesTimedOut;
+    volatile uint32_t       SharesStale;
+    volatile uint32_t       SubmitLatencyHist[PDQ_SUBMIT_LATENCY_BUCKETS];
+    volatile uint64_t       SubmitLatencySumMs;
     volatile uint32_t       BlocksFound;
     volatile bool           PauseRequested;
     volatile uint8_t        PausedCount;
@@ -72,34 +77,17 @@ typedef struct {
 static MiningState_t s_State = {0};
 
 #if PDQ_USE_RTOS
+/* Re-hash the engine's hit in software and classify it: false positives
+ * are dropped, block candidates go to the front of the share queue */
 static void QueueShare(const PdqMiningJob_t* p_Job, uint32_t Nonce) {
-    /* SW verification: reconstruct header, SHA256d, check target */
-    uint8_t Header[80];
-    for (int i = 0; i < 20; i++) {
-        uint32_t w = __builtin_bswap32(p_Job->HeaderSwapped[i]);
-        Header[i*4+0] = (uint8_t)(w);
-        Header[i*4+1] = (uint8_t)(w >> 8);
-        Header[i*4+2] = (uint8_t)(w >> 16);
-        Header[i*4+3] = (uint8_t)(w >> 24);
+    uint32_t Hash[8];
+    PdqTargetHashJob(p_Job, Nonce, Hash);
+    PdqHitClass_t Class = PdqTargetClassify(p_Job, Hash);
+    if (Class == PdqHitInvalid) {
+        printf("[MINING] WARN: nonce=%08x above target (hash[7:6]=%08x_%08x), dropped\n",
+               Nonce, Hash[7], Hash[6]);
+        return;
     }
-    Header[76] = (uint8_t)(Nonce);
-    Header[77] = (uint8_t)(Nonce >> 8);
-    Header[78] = (uint8_t)(Nonce >> 16);
-    Header[79] = (uint8_t)(Nonce >> 24);
-    uint8_t Hash[32];
-    PdqSha256d(Header, 80, Hash);
-    printf("[DBG] Share nonce=%08x hash=", Nonce);
-    for (int i = 31; i >= 0; i--) printf("%02x", Hash[i]);
-    printf("\n");
-    /* Check target (LE uint256) */
-    uint32_t* pH = (uint32_t*)Hash;
-    bool Valid = true;
-    for (int i = 7; i >= 0; i--) {
-        if (pH[i] > p_Job->Target[i]) { Valid = false; break; }
-        if (pH[i] < p_Job->Target[i]) break;
-    }
-    printf("[DBG] SW verify: %s (target[7:6]=%08x_%08x)\n",
-           Valid ? "PASS" : "FAIL", p_Job->Target[7], p_Job->Target[6]);
 
     PdqShareInfo_t Share;
     strncpy(Share.JobId, p_Job->JobId, 64);
@@ -107,7 +95,20 @@ static void QueueShare(const PdqMiningJob_t* p_Job, uint32_t Nonce) {
     Share.Extranonce2 = p_Job->Extranonce2;
     Share.Nonce = Nonce;
     Share.NTime = p_Job->NTime;
-    xQueueSend(s_State.ShareQueue, &Share, 0);
+    Share.ExtranonceGen = p_Job->ExtranonceGen;
+    Share.BlockCandidate = (Class == PdqHitBlock);
+    if (Share.BlockCandidate) {
+        __atomic_fetch_add(&s_State.BlocksFound, 1, __ATOMIC_RELAXED);
+        printf("[MINING] *** BLOCK CANDIDATE *** nonce=%08x\n", Nonce);
+        if (xQueueSendToFront(s_State.ShareQueue, &Share, 0) != pdTRUE) {
+            /* Full of ordinary shares: the oldest one makes room */
+            PdqShareInfo_t Oldest;
+            xQueueReceive(s_State.ShareQueue, &Oldest, 0);
+            xQueueSendToFront(s_State.ShareQueue, &Share, 0);
+        }
+    } else {
+        xQueueSend(s_State.ShareQueue, &Share, 0);
+    }
 }
 
 PDQ_IRAM_ATTR static void MiningTaskCore1(void* p_Param) {
@@ -149,7 +150,6 @@ PDQ_IRAM_ATTR static void MiningTaskCore1(void* p_Param) {
 
             if (Found) {
                 QueueShare(&Job, Nonce);
-                __atomic_fetch_add(&s_State.BlocksFound, 1, __ATOMIC_RELAXED);
             }
 
             uint32_t Now = xTaskGetTickCount() * portTICK_PERIOD_MS;
@@ -225,7 +225,6 @@ PDQ_IRAM_ATTR static void MiningTaskHw(void* p_Param) {
 
             if (Found) {
                 QueueShare(&Job, Nonce);
-                __atomic_fetch_add(&s_State.BlocksFound, 1, __ATOMIC_RELAXED);
             }
 
             /* HW task must yield after every batch to prevent IDLE task WDT.
@@ -261,15 +260,32 @@ PDQ_IRAM_ATTR static void MiningTaskHw(void* p_Param) {
 }
 #else
 static void QueueShareNonRtos(const PdqMiningJob_t* p_Job, uint32_t Nonce) {
+    uint32_t Hash[8];
+    PdqTargetHashJob(p_Job, Nonce, Hash);
+    PdqHitClass_t Class = PdqTargetClassify(p_Job, Hash);
+    if (Class == PdqHitInvalid) return;
+
     uint8_t NextHead = (s_State.ShareHead + 1) % PDQ_SHARE_QUEUE_SIZE;
     if (NextHead != s_State.ShareTail) {
-        PdqShareInfo_t* Share = &s_State.ShareBuffer[s_State.ShareHead];
+        /* Block candidates are pushed at the tail end, to be read first */
+        uint8_t Slot = s_State.ShareHead;
+        if (Class == PdqHitBlock) {
+            Slot = (s_State.ShareTail + PDQ_SHARE_QUEUE_SIZE - 1) % PDQ_SHARE_QUEUE_SIZE;
+            s_State.BlocksFound++;
+        }
+        PdqShareInfo_t* Share = &s_State.ShareBuffer[Slot];
         strncpy(Share->JobId, p_Job->JobId, 64);
         Share->JobId[64] = '\0';
         Share->Extranonce2 = p_Job->Extranonce2;
         Share->Nonce = Nonce;
         Share->NTime = p_Job->NTime;
-        s_State.ShareHead = NextHead;
+        Share->ExtranonceGen = p_Job->ExtranonceGen;
+        Share->BlockCandidate = (Class == PdqHitBlock);
+        if (Class == PdqHitBlock) {
+            s_State.ShareTail = Slot;
+        } else {
+            s_State.ShareHead = NextHead;
+        }
     } else {
         printf("[MINING] WARN: Share queue full, dropping share nonce=%08X\n", Nonce);
     }
@@ -344,6 +360,22 @@ PdqError_t PdqMiningSetJob(const PdqMiningJob_t* p_Job) {
     return PdqOk;
 }
 
+PdqError_t PdqMiningSetLanWork(const PdqLanWork_t* p_Work) {
+    if (p_Work == NULL) return PdqErrorInvalidParam;
+
+#if PDQ_USE_RTOS
+    xSemaphoreTake(s_State.JobMutex, portMAX_DELAY);
+#endif
+    PdqLanWorkToJob(p_Work, &s_State.CurrentJob);
+    s_State.JobVersion++;
+    s_State.HasJob = true;
+#if PDQ_USE_RTOS
+    xSemaphoreGive(s_State.JobMutex);
+#endif
+
+    return PdqOk;
+}
+
 PdqError_t PdqMiningGetStats(PdqMinerStats_t* p_Stats) {
     if (p_Stats == NULL) return PdqErrorInvalidParam;
 
@@ -381,6 +413,12 @@ PdqError_t PdqMiningGetStats(PdqMinerStats_t* p_Stats) {
     p_Stats->TotalHashes = s_State.TotalHashes;
     p_Stats->SharesAccepted = s_State.SharesAccepted;
     p_Stats->SharesRejected = s_State.SharesRejected;
+    p_Stats->SharesTimedOut = s_State.SharesTimedOut;
+    p_Stats->SharesStale = s_State.SharesStale;
+    for (int i = 0; i < PDQ_SUBMIT_LATENCY_BUCKETS; i++) {
+        p_Stats->SubmitLatencyHist[i] = s_State.SubmitLatencyHist[i];
+    }
+    p_Stats->SubmitLatencySumMs = s_State.SubmitLatencySumMs;
     p_Stats->BlocksFound = s_State.BlocksFound;
     p_Stats->Temperature = 0.0f;
     p_Stats->Difficulty = 0.0;
@@ -449,3 +487,14 @@ void PdqMiningResume(void) {
     s_State.PauseRequested = false;
 #endif
 }
+
+void PdqMiningRecordSubmitResult(PdqSubmitResult_t Result, uint32_t LatencyMs) {
+    switch (Result) {
+        case PdqSubmitAccepted: s_State.SharesAccepted++; break;
+        case PdqSubmitRejected: s_State.SharesRejected++; break;
+        case PdqSubmitStale:    s_State.SharesStale++; return;
+        default:                s_State.SharesTimedOut++; return;
+    }
+    s_State.SubmitLatencyHist[PdqSubmitLatencyBucket(LatencyMs)]++;
+    s_State.SubmitLatencySumMs += LatencyMs;
+}
@@ -9,6 +9,7 @@
 #define PDQ_MINING_TASK_H
 
 #include "pdq_types.h"
+#include "stratum/lan_proto.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +19,8 @@ PdqError_t PdqMiningInit(void);
 PdqError_t PdqMiningStart(void);
 PdqError_t PdqMiningStop(void);
 PdqError_t PdqMiningSetJob(const PdqMiningJob_t* p_Job);
+/* Work from a LAN proxy, decoded straight into the current job */
+PdqError_t PdqMiningSetLanWork(const PdqLanWork_t* p_Work);
 PdqError_t PdqMiningGetStats(PdqMinerStats_t* p_Stats);
 bool       PdqMiningIsRunning(void);
 bool       PdqMiningHasShare(void);
@@ -26,6 +29,10 @@ void       PdqMiningClearShares(void);
 void       PdqMiningPause(void);
 void       PdqMiningResume(void);
 
+/* Account for the pool's answer to a submitted share. LatencyMs is the
+ * submit-to-ack time and is ignored for timeouts. */
+void       PdqMiningRecordSubmitResult(PdqSubmitResult_t Result, uint32_t LatencyMs);
+
 #ifdef __cplusplus
 }
 #endif
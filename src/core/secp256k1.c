@@ -0,0 +1,638 @@
+/**
+ * @file secp256k1.c
+ * @brief Minimal secp256k1: x-only keys, BIP340 Schnorr, BIP324 ElligatorSwift
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "secp256k1.h"
+#include "sha256_engine.h"
+#include <string.h>
+
+/* 256-bit value as eight little-endian 32-bit words */
+typedef struct {
+    uint32_t V[8];
+} U256_t;
+
+/* Jacobian coordinates; Z == 0 is the point at infinity */
+typedef struct {
+    U256_t X;
+    U256_t Y;
+    U256_t Z;
+} Point_t;
+
+/* Field prime p = 2^256 - 2^32 - 977 and group order n. Reduction folds
+ * the high half of a product back in times 2^256 mod m, which is small
+ * for both. */
+static const U256_t   s_P = {{0xFFFFFC2F, 0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFF,
+                              0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF}};
+static const uint32_t s_PFold[2] = {0x000003D1, 0x00000001};
+static const U256_t   s_N = {{0xD0364141, 0xBFD25E8C, 0xAF48A03B, 0xBAAEDCE6,
+                              0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF}};
+static const uint32_t s_NFold[5] = {0x2FC9BEBF, 0x402DA173, 0x50B75FC4, 0x45512319, 0x00000001};
+
+/* Exponents for inversion (p - 2), square roots ((p + 1) / 4) */
+static const U256_t s_PMinus2 = {{0xFFFFFC2D, 0xFFFFFFFE, 0xFFFFFFFF, 0xFFFFFFFF,
+                                  0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF}};
+static const U256_t s_SqrtExp = {{0xBFFFFF0C, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
+                                  0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x3FFFFFFF}};
+
+static const Point_t s_G = {
+    {{0x16F81798, 0x59F2815B, 0x2DCE28D9, 0x029BFCDB, 0xCE870B07, 0x55A06295, 0xF9DCBBAC, 0x79BE667E}},
+    {{0xFB10D4B8, 0x9C47D08F, 0xA6855419, 0xFD17B448, 0x0E1108A8, 0x5DA4FBFC, 0x26A3C465, 0x483ADA77}},
+    {{1, 0, 0, 0, 0, 0, 0, 0}}
+};
+
+static void FromBytes(U256_t* p_R, const uint8_t* p_In) {
+    for (int i = 0; i < 8; i++) {
+        const uint8_t* p_Word = p_In + 28 - 4 * i;
+        p_R->V[i] = (uint32_t)p_Word[0] << 24 | (uint32_t)p_Word[1] << 16 |
+                    (uint32_t)p_Word[2] << 8 | p_Word[3];
+    }
+}
+
+static void ToBytes(uint8_t* p_Out, const U256_t* p_A) {
+    for (int i = 0; i < 8; i++) {
+        uint8_t* p_Word = p_Out + 28 - 4 * i;
+        p_Word[0] = (uint8_t)(p_A->V[i] >> 24);
+        p_Word[1] = (uint8_t)(p_A->V[i] >> 16);
+        p_Word[2] = (uint8_t)(p_A->V[i] >> 8);
+        p_Word[3] = (uint8_t)p_A->V[i];
+    }
+}
+
+static void SetWord(U256_t* p_R, uint32_t Value) {
+    memset(p_R, 0, sizeof(*p_R));
+    p_R->V[0] = Value;
+}
+
+static bool IsZero(const U256_t* p_A) {
+    uint32_t Any = 0;
+    for (int i = 0; i < 8; i++) Any |= p_A->V[i];
+    return Any == 0;
+}
+
+static int Compare(const U256_t* p_A, const U256_t* p_B) {
+    for (int i = 7; i >= 0; i--) {
+        if (p_A->V[i] != p_B->V[i]) return p_A->V[i] < p_B->V[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static uint32_t AddRaw(U256_t* p_R, const U256_t* p_A, const U256_t* p_B) {
+    uint64_t Carry = 0;
+    for (int i = 0; i < 8; i++) {
+        Carry += (uint64_t)p_A->V[i] + p_B->V[i];
+        p_R->V[i] = (uint32_t)Carry;
+        Carry >>= 32;
+    }
+    return (uint32_t)Carry;
+}
+
+static uint32_t SubRaw(U256_t* p_R, const U256_t* p_A, const U256_t* p_B) {
+    int64_t Borrow = 0;
+    for (int i = 0; i < 8; i++) {
+        int64_t Diff = (int64_t)p_A->V[i] - p_B->V[i] + Borrow;
+        p_R->V[i] = (uint32_t)Diff;
+        Borrow = Diff < 0 ? -1 : 0;
+    }
+    return Borrow ? 1 : 0;
+}
+
+/* Reduce the Len-word value in p_W (24 words, zero above Len) modulo
+ * p_M, given p_Fold = 2^256 mod p_M. Each pass replaces low + high *
+ * 2^256 with low + high * p_Fold until the value fits in 256 bits. */
+static void ModReduce(U256_t* p_R, uint32_t* p_W, int Len, const U256_t* p_M,
+                      const uint32_t* p_Fold, int FoldLen) {
+    uint32_t Next[24];
+    while (Len > 8) {
+        memset(Next, 0, sizeof(Next));
+        memcpy(Next, p_W, 8 * sizeof(uint32_t));
+        for (int i = 8; i < Len; i++) {
+            uint64_t Carry = 0;
+            int k = i - 8;
+            for (int j = 0; j < FoldLen; j++, k++) {
+                Carry += (uint64_t)p_W[i] * p_Fold[j] + Next[k];
+                Next[k] = (uint32_t)Carry;
+                Carry >>= 32;
+            }
+            for (; Carry != 0; k++) {
+                Carry += Next[k];
+                Next[k] = (uint32_t)Carry;
+                Carry >>= 32;
+            }
+        }
+        memcpy(p_W, Next, sizeof(Next));
+        Len = 24;
+        while (Len > 0 && p_W[Len - 1] == 0) Len--;
+    }
+    memcpy(p_R->V, p_W, sizeof(p_R->V));
+    if (Compare(p_R, p_M) >= 0) SubRaw(p_R, p_R, p_M);
+}
+
+static void ModMul(U256_t* p_R, const U256_t* p_A, const U256_t* p_B, const U256_t* p_M,
+                   const uint32_t* p_Fold, int FoldLen) {
+    uint32_t W[24];
+    memset(W, 0, sizeof(W));
+    for (int i = 0; i < 8; i++) {
+        uint64_t Carry = 0;
+        for (int j = 0; j < 8; j++) {
+            Carry += (uint64_t)p_A->V[i] * p_B->V[j] + W[i + j];
+            W[i + j] = (uint32_t)Carry;
+            Carry >>= 32;
+        }
+        W[i + 8] = (uint32_t)Carry;
+    }
+    ModReduce(p_R, W, 16, p_M, p_Fold, FoldLen);
+}
+
+/* Both operands already below p_M */
+static void ModAdd(U256_t* p_R, const U256_t* p_A, const U256_t* p_B, const U256_t* p_M) {
+    if (AddRaw(p_R, p_A, p_B) || Compare(p_R, p_M) >= 0) SubRaw(p_R, p_R, p_M);
+}
+
+static void ModSub(U256_t* p_R, const U256_t* p_A, const U256_t* p_B, const U256_t* p_M) {
+    if (SubRaw(p_R, p_A, p_B)) AddRaw(p_R, p_R, p_M);
+}
+
+static void FeMul(U256_t* p_R, const U256_t* p_A, const U256_t* p_B) {
+    ModMul(p_R, p_A, p_B, &s_P, s_PFold, 2);
+}
+
+static void FeSqr(U256_t* p_R, const U256_t* p_A) {
+    ModMul(p_R, p_A, p_A, &s_P, s_PFold, 2);
+}
+
+static void FeAdd(U256_t* p_R, const U256_t* p_A, const U256_t* p_B) {
+    ModAdd(p_R, p_A, p_B, &s_P);
+}
+
+static void FeSub(U256_t* p_R, const U256_t* p_A, const U256_t* p_B) {
+    ModSub(p_R, p_A, p_B, &s_P);
+}
+
+static void FeNeg(U256_t* p_R, const U256_t* p_A) {
+    U256_t Zero;
+    SetWord(&Zero, 0);
+    ModSub(p_R, &Zero, p_A, &s_P);
+}
+
+static void FePow(U256_t* p_R, const U256_t* p_A, const U256_t* p_Exp) {
+    U256_t Result;
+    SetWord(&Result, 1);
+    for (int Bit = 255; Bit >= 0; Bit--) {
+        FeSqr(&Result, &Result);
+        if ((p_Exp->V[Bit / 32] >> (Bit % 32)) & 1) FeMul(&Result, &Result, p_A);
+    }
+    *p_R = Result;
+}
+
+static void FeInv(U256_t* p_R, const U256_t* p_A) {
+    FePow(p_R, p_A, &s_PMinus2);
+}
+
+/* p = 3 mod 4, so a^((p+1)/4) is a root whenever one exists. This is
+ * the root the BIP324 reference picks, which XSwiftEC depends on. */
+static bool FeSqrt(U256_t* p_R, const U256_t* p_A) {
+    U256_t Root;
+    U256_t Check;
+    FePow(&Root, p_A, &s_SqrtExp);
+    FeSqr(&Check, &Root);
+    if (Compare(&Check, p_A) != 0) return false;
+    *p_R = Root;
+    return true;
+}
+
+static void FeDiv(U256_t* p_R, const U256_t* p_A, const U256_t* p_B) {
+    U256_t Inv;
+    FeInv(&Inv, p_B);
+    FeMul(p_R, p_A, &Inv);
+}
+
+/* x^3 + 7 */
+static void CurveRhs(U256_t* p_R, const U256_t* p_X) {
+    U256_t Seven;
+    SetWord(&Seven, 7);
+    FeSqr(p_R, p_X);
+    FeMul(p_R, p_R, p_X);
+    FeAdd(p_R, p_R, &Seven);
+}
+
+static bool IsValidX(const U256_t* p_X) {
+    U256_t Rhs;
+    U256_t Root;
+    CurveRhs(&Rhs, p_X);
+    return FeSqrt(&Root, &Rhs);
+}
+
+static void PointDouble(Point_t* p_R, const Point_t* p_A) {
+    if (IsZero(&p_A->Z)) {
+        *p_R = *p_A;
+        return;
+    }
+    U256_t A, B, C, D, E, F, T;
+    Point_t Out;
+    FeSqr(&A, &p_A->X);
+    FeSqr(&B, &p_A->Y);
+    FeSqr(&C, &B);
+    FeAdd(&T, &p_A->X, &B);
+    FeSqr(&T, &T);
+    FeSub(&T, &T, &A);
+    FeSub(&T, &T, &C);
+    FeAdd(&D, &T, &T);
+    FeAdd(&E, &A, &A);
+    FeAdd(&E, &E, &A);
+    FeSqr(&F, &E);
+    FeSub(&Out.X, &F, &D);
+    FeSub(&Out.X, &Out.X, &D);
+    FeSub(&T, &D, &Out.X);
+    FeMul(&Out.Y, &E, &T);
+    FeAdd(&C, &C, &C);
+    FeAdd(&C, &C, &C);
+    FeAdd(&C, &C, &C);
+    FeSub(&Out.Y, &Out.Y, &C);
+    FeMul(&Out.Z, &p_A->Y, &p_A->Z);
+    FeAdd(&Out.Z, &Out.Z, &Out.Z);
+    *p_R = Out;
+}
+
+static void PointAdd(Point_t* p_R, const Point_t* p_A, const Point_t* p_B) {
+    if (IsZero(&p_A->Z)) {
+        *p_R = *p_B;
+        return;
+    }
+    if (IsZero(&p_B->Z)) {
+        *p_R = *p_A;
+        return;
+    }
+    U256_t Z1Z1, Z2Z2, U1, U2, S1, S2, H, R, HH, HHH, V, T;
+    Point_t Out;
+    FeSqr(&Z1Z1, &p_A->Z);
+    FeSqr(&Z2Z2, &p_B->Z);
+    FeMul(&U1, &p_A->X, &Z2Z2);
+    FeMul(&U2, &p_B->X, &Z1Z1);
+    FeMul(&S1, &p_A->Y, &p_B->Z);
+    FeMul(&S1, &S1, &Z2Z2);
+    FeMul(&S2, &p_B->Y, &p_A->Z);
+    FeMul(&S2, &S2, &Z1Z1);
+    FeSub(&H, &U2, &U1);
+    FeSub(&R, &S2, &S1);
+    if (IsZero(&H)) {
+        if (IsZero(&R)) {
+            PointDouble(p_R, p_A);
+        } else {
+            memset(p_R, 0, sizeof(*p_R));
+        }
+        return;
+    }
+    FeSqr(&HH, &H);
+    FeMul(&HHH, &H, &HH);
+    FeMul(&V, &U1, &HH);
+    FeSqr(&Out.X, &R);
+    FeSub(&Out.X, &Out.X, &HHH);
+    FeSub(&Out.X, &Out.X, &V);
+    FeSub(&Out.X, &Out.X, &V);
+    FeSub(&T, &V, &Out.X);
+    FeMul(&Out.Y, &R, &T);
+    FeMul(&T, &S1, &HHH);
+    FeSub(&Out.Y, &Out.Y, &T);
+    FeMul(&Out.Z, &p_A->Z, &p_B->Z);
+    FeMul(&Out.Z, &Out.Z, &H);
+    *p_R = Out;
+}
+
+static void PointMul(Point_t* p_R, const U256_t* p_K, const Point_t* p_P) {
+    Point_t Acc;
+    memset(&Acc, 0, sizeof(Acc));
+    for (int Bit = 255; Bit >= 0; Bit--) {
+        PointDouble(&Acc, &Acc);
+        if ((p_K->V[Bit / 32] >> (Bit % 32)) & 1) PointAdd(&Acc, &Acc, p_P);
+    }
+    *p_R = Acc;
+}
+
+static bool ToAffine(U256_t* p_X, U256_t* p_Y, const Point_t* p_P) {
+    if (IsZero(&p_P->Z)) return false;
+    U256_t ZInv, ZInv2;
+    FeInv(&ZInv, &p_P->Z);
+    FeSqr(&ZInv2, &ZInv);
+    FeMul(p_X, &p_P->X, &ZInv2);
+    if (p_Y) {
+        FeMul(&ZInv2, &ZInv2, &ZInv);
+        FeMul(p_Y, &p_P->Y, &ZInv2);
+    }
+    return true;
+}
+
+/* The point with x coordinate p_X and an even y, as in BIP340 */
+static bool LiftX(Point_t* p_R, const U256_t* p_X) {
+    if (Compare(p_X, &s_P) >= 0) return false;
+    U256_t Rhs;
+    CurveRhs(&Rhs, p_X);
+    if (!FeSqrt(&p_R->Y, &Rhs)) return false;
+    if (p_R->Y.V[0] & 1) FeNeg(&p_R->Y, &p_R->Y);
+    p_R->X = *p_X;
+    SetWord(&p_R->Z, 1);
+    return true;
+}
+
+static void ScMul(U256_t* p_R, const U256_t* p_A, const U256_t* p_B) {
+    ModMul(p_R, p_A, p_B, &s_N, s_NFold, 5);
+}
+
+/* A 32-byte string as a scalar: below 2^256 < 2n, so one subtraction */
+static void ScFromBytes(U256_t* p_R, const uint8_t* p_In) {
+    FromBytes(p_R, p_In);
+    if (Compare(p_R, &s_N) >= 0) SubRaw(p_R, p_R, &s_N);
+}
+
+bool PdqSecpSecKeyValid(const uint8_t* p_SecKey) {
+    if (p_SecKey == NULL) return false;
+    U256_t D;
+    FromBytes(&D, p_SecKey);
+    return !IsZero(&D) && Compare(&D, &s_N) < 0;
+}
+
+bool PdqSecpPubkeyXOnly(const uint8_t* p_SecKey, uint8_t* p_XOnly) {
+    if (!PdqSecpSecKeyValid(p_SecKey) || p_XOnly == NULL) return false;
+    U256_t D, X;
+    Point_t P;
+    FromBytes(&D, p_SecKey);
+    PointMul(&P, &D, &s_G);
+    if (!ToAffine(&X, NULL, &P)) return false;
+    ToBytes(p_XOnly, &X);
+    return true;
+}
+
+void PdqSecpTaggedHash(const char* p_Tag, const uint8_t* p_Msg, size_t Len, uint8_t* p_Hash) {
+    uint8_t TagHash[32];
+    PdqSha256Context_t Ctx;
+    PdqSha256((const uint8_t*)p_Tag, strlen(p_Tag), TagHash);
+    PdqSha256Init(&Ctx);
+    PdqSha256Update(&Ctx, TagHash, 32);
+    PdqSha256Update(&Ctx, TagHash, 32);
+    PdqSha256Update(&Ctx, p_Msg, Len);
+    PdqSha256Final(&Ctx, p_Hash);
+}
+
+/*
+ * ElligatorSwift (BIP324). An encoding is two field elements (u, t);
+ * XSwiftEC maps every pair to a valid x, and XSwiftEcInv finds a t for
+ * a given x and u in one of eight cases, failing for some of them.
+ */
+
+static void MinusThreeSqrt(U256_t* p_R) {
+    U256_t MinusThree;
+    U256_t Three;
+    SetWord(&Three, 3);
+    FeNeg(&MinusThree, &Three);
+    FeSqrt(p_R, &MinusThree);
+}
+
+static void XSwiftEc(U256_t* p_X, const U256_t* p_U, const U256_t* p_T) {
+    U256_t U = *p_U;
+    U256_t T = *p_T;
+    U256_t Sqrt3, G, T2, Sum, X, Y, Den, C, Four, Half, Two;
+    if (Compare(&U, &s_P) >= 0) SubRaw(&U, &U, &s_P);
+    if (Compare(&T, &s_P) >= 0) SubRaw(&T, &T, &s_P);
+    if (IsZero(&U)) SetWord(&U, 1);
+    if (IsZero(&T)) SetWord(&T, 1);
+
+    CurveRhs(&G, &U);
+    FeSqr(&T2, &T);
+    FeAdd(&Sum, &G, &T2);
+    if (IsZero(&Sum)) {
+        FeAdd(&T, &T, &T);
+        FeSqr(&T2, &T);
+    }
+
+    /* X = (g(u) - t^2) / 2t, Y = (X + t) / (sqrt(-3) u) */
+    MinusThreeSqrt(&Sqrt3);
+    FeSub(&X, &G, &T2);
+    FeAdd(&Den, &T, &T);
+    FeDiv(&X, &X, &Den);
+    FeAdd(&Y, &X, &T);
+    FeMul(&Den, &Sqrt3, &U);
+    FeDiv(&Y, &Y, &Den);
+
+    /* First valid of u + 4Y^2, (-X/Y - u)/2, (X/Y - u)/2 */
+    SetWord(&Four, 4);
+    FeSqr(&C, &Y);
+    FeMul(&C, &C, &Four);
+    FeAdd(&C, &C, &U);
+    if (IsValidX(&C)) {
+        *p_X = C;
+        return;
+    }
+    SetWord(&Two, 2);
+    FeInv(&Half, &Two);
+    FeDiv(&C, &X, &Y);
+    FeNeg(&C, &C);
+    FeSub(&C, &C, &U);
+    FeMul(&C, &C, &Half);
+    if (IsValidX(&C)) {
+        *p_X = C;
+        return;
+    }
+    FeDiv(&C, &X, &Y);
+    FeSub(&C, &C, &U);
+    FeMul(p_X, &C, &Half);
+}
+
+static bool XSwiftEcInv(U256_t* p_T, const U256_t* p_X, const U256_t* p_U, int Case) {
+    U256_t S, V, G, W, Tmp, Tmp2, Sqrt3, One, Two, Half;
+    SetWord(&One, 1);
+    SetWord(&Two, 2);
+    FeInv(&Half, &Two);
+    CurveRhs(&G, p_U);
+
+    if ((Case & 2) == 0) {
+        /* Fails when -x - u is itself a valid x */
+        FeNeg(&Tmp, p_X);
+        FeSub(&Tmp, &Tmp, p_U);
+        if (IsValidX(&Tmp)) return false;
+        V = *p_X;
+        /* s = -g(u) / (u^2 + uv + v^2) */
+        FeSqr(&Tmp, p_U);
+        FeMul(&Tmp2, p_U, &V);
+        FeAdd(&Tmp, &Tmp, &Tmp2);
+        FeSqr(&Tmp2, &V);
+        FeAdd(&Tmp, &Tmp, &Tmp2);
+        FeNeg(&S, &G);
+        FeDiv(&S, &S, &Tmp);
+    } else {
+        FeSub(&S, p_X, p_U);
+        if (IsZero(&S)) return false;
+        /* r = sqrt(-s (4 g(u) + 3 s u^2)) */
+        U256_t R, Four, Three;
+        SetWord(&Four, 4);
+        SetWord(&Three, 3);
+        FeMul(&Tmp, &Four, &G);
+        FeSqr(&Tmp2, p_U);
+        FeMul(&Tmp2, &Tmp2, &S);
+        FeMul(&Tmp2, &Tmp2, &Three);
+        FeAdd(&Tmp, &Tmp, &Tmp2);
+        FeMul(&Tmp, &Tmp, &S);
+        FeNeg(&Tmp, &Tmp);
+        if (!FeSqrt(&R, &Tmp)) return false;
+        if ((Case & 1) && IsZero(&R)) return false;
+        /* v = (r/s - u) / 2 */
+        FeDiv(&V, &R, &S);
+        FeSub(&V, &V, p_U);
+        FeMul(&V, &V, &Half);
+    }
+
+    if (!FeSqrt(&W, &S)) return false;
+
+    /* +-w (u (1 -+ sqrt(-3)) / 2 + v) */
+    MinusThreeSqrt(&Sqrt3);
+    if (Case & 1) {
+        FeAdd(&Tmp, &One, &Sqrt3);
+    } else {
+        FeSub(&Tmp, &One, &Sqrt3);
+    }
+    FeMul(&Tmp, &Tmp, p_U);
+    FeMul(&Tmp, &Tmp, &Half);
+    FeAdd(&Tmp, &Tmp, &V);
+    FeMul(p_T, &W, &Tmp);
+    int Sign = Case & 5;
+    if (Sign == 0 || Sign == 5) FeNeg(p_T, p_T);
+    return true;
+}
+
+bool PdqSecpEllSwiftCreate(const uint8_t* p_SecKey, const uint8_t* p_Rnd32, uint8_t* p_Ell64) {
+    if (!PdqSecpSecKeyValid(p_SecKey) || p_Rnd32 == NULL || p_Ell64 == NULL) return false;
+
+    U256_t D, X;
+    Point_t P;
+    FromBytes(&D, p_SecKey);
+    PointMul(&P, &D, &s_G);
+    if (!ToAffine(&X, NULL, &P)) return false;
+
+    /* Candidate u and case from SHA256(rnd || counter) until one maps */
+    uint8_t Seed[36];
+    memcpy(Seed, p_Rnd32, 32);
+    for (uint32_t Counter = 0; Counter < 1000; Counter++) {
+        uint8_t Hash[32];
+        U256_t U, T, Check;
+        Seed[32] = (uint8_t)(Counter >> 24);
+        Seed[33] = (uint8_t)(Counter >> 16);
+        Seed[34] = (uint8_t)(Counter >> 8);
+        Seed[35] = (uint8_t)Counter;
+        PdqSha256(Seed, sizeof(Seed), Hash);
+        FromBytes(&U, Hash);
+        if (Compare(&U, &s_P) >= 0 || IsZero(&U)) continue;
+        if (!XSwiftEcInv(&T, &X, &U, Hash[31] & 7)) continue;
+        XSwiftEc(&Check, &U, &T);
+        if (Compare(&Check, &X) != 0) continue;
+        ToBytes(p_Ell64, &U);
+        ToBytes(p_Ell64 + 32, &T);
+        return true;
+    }
+    return false;
+}
+
+void PdqSecpEllSwiftDecode(const uint8_t* p_Ell64, uint8_t* p_X) {
+    U256_t U, T, X;
+    FromBytes(&U, p_Ell64);
+    FromBytes(&T, p_Ell64 + 32);
+    XSwiftEc(&X, &U, &T);
+    ToBytes(p_X, &X);
+}
+
+bool PdqSecpEllSwiftXdh(const uint8_t* p_EllA, const uint8_t* p_EllB,
+                        const uint8_t* p_SecKey, bool PartyA, uint8_t* p_Secret) {
+    if (p_EllA == NULL || p_EllB == NULL || p_Secret == NULL || !PdqSecpSecKeyValid(p_SecKey)) {
+        return false;
+    }
+
+    /* Only x matters, so either lift of the peer's x will do */
+    uint8_t Buf[160];
+    U256_t D, X;
+    Point_t P;
+    PdqSecpEllSwiftDecode(PartyA ? p_EllB : p_EllA, Buf);
+    FromBytes(&X, Buf);
+    if (!LiftX(&P, &X)) return false;
+    FromBytes(&D, p_SecKey);
+    PointMul(&P, &D, &P);
+    if (!ToAffine(&X, NULL, &P)) return false;
+
+    memcpy(Buf, p_EllA, 64);
+    memcpy(Buf + 64, p_EllB, 64);
+    ToBytes(Buf + 128, &X);
+    PdqSecpTaggedHash("bip324_ellswift_xonly_ecdh", Buf, sizeof(Buf), p_Secret);
+    return true;
+}
+
+bool PdqSecpSchnorrSign(const uint8_t* p_SecKey, const uint8_t* p_Msg32,
+                        const uint8_t* p_Aux32, uint8_t* p_Sig64) {
+    if (!PdqSecpSecKeyValid(p_SecKey) || p_Msg32 == NULL || p_Aux32 == NULL || p_Sig64 == NULL) {
+        return false;
+    }
+
+    U256_t D, K, E, Px, Py, Rx, Ry, S;
+    Point_t P, R;
+    uint8_t Buf[96];
+    uint8_t Hash[32];
+
+    /* d is negated if needed so that P = dG has an even y */
+    FromBytes(&D, p_SecKey);
+    PointMul(&P, &D, &s_G);
+    ToAffine(&Px, &Py, &P);
+    if (Py.V[0] & 1) SubRaw(&D, &s_N, &D);
+
+    /* k from hash(d xor hash(aux) || P || m) */
+    PdqSecpTaggedHash("BIP0340/aux", p_Aux32, 32, Hash);
+    ToBytes(Buf, &D);
+    for (int i = 0; i < 32; i++) Buf[i] ^= Hash[i];
+    ToBytes(Buf + 32, &Px);
+    memcpy(Buf + 64, p_Msg32, 32);
+    PdqSecpTaggedHash("BIP0340/nonce", Buf, 96, Hash);
+    ScFromBytes(&K, Hash);
+    if (IsZero(&K)) return false;
+    PointMul(&R, &K, &s_G);
+    ToAffine(&Rx, &Ry, &R);
+    if (Ry.V[0] & 1) SubRaw(&K, &s_N, &K);
+
+    /* e = hash(R || P || m), s = k + e d */
+    ToBytes(Buf, &Rx);
+    ToBytes(Buf + 32, &Px);
+    memcpy(Buf + 64, p_Msg32, 32);
+    PdqSecpTaggedHash("BIP0340/challenge", Buf, 96, Hash);
+    ScFromBytes(&E, Hash);
+    ScMul(&S, &E, &D);
+    ModAdd(&S, &S, &K, &s_N);
+
+    ToBytes(p_Sig64, &Rx);
+    ToBytes(p_Sig64 + 32, &S);
+    return true;
+}
+
+bool PdqSecpSchnorrVerify(const uint8_t* p_XOnly, const uint8_t* p_Msg32, const uint8_t* p_Sig64) {
+    if (p_XOnly == NULL || p_Msg32 == NULL || p_Sig64 == NULL) return false;
+
+    U256_t Px, R, S, E, Rx, Ry;
+    Point_t P, SG, EP, Sum;
+    uint8_t Buf[96];
+    uint8_t Hash[32];
+
+    FromBytes(&Px, p_XOnly);
+    if (!LiftX(&P, &Px)) return false;
+    FromBytes(&R, p_Sig64);
+    FromBytes(&S, p_Sig64 + 32);
+    if (Compare(&R, &s_P) >= 0 || Compare(&S, &s_N) >= 0) return false;
+
+    memcpy(Buf, p_Sig64, 32);
+    memcpy(Buf + 32, p_XOnly, 32);
+    memcpy(Buf + 64, p_Msg32, 32);
+    PdqSecpTaggedHash("BIP0340/challenge", Buf, 96, Hash);
+    ScFromBytes(&E, Hash);
+
+    /* R = sG - eP must have an even y and x = r */
+    if (!IsZero(&E)) SubRaw(&E, &s_N, &E);
+    PointMul(&SG, &S, &s_G);
+    PointMul(&EP, &E, &P);
+    PointAdd(&Sum, &SG, &EP);
+    if (!ToAffine(&Rx, &Ry, &Sum)) return false;
+    return (Ry.V[0] & 1) == 0 && Compare(&Rx, &R) == 0;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file secp256k1.h
+ * @brief Minimal secp256k1: x-only keys, BIP340 Schnorr, BIP324 ElligatorSwift
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Just what the Stratum V2 Noise handshake needs: ElligatorSwift public
+ * keys and their x-only ECDH (BIP324), and BIP340 signatures for the
+ * pool certificate. Secret keys, messages and x coordinates are 32-byte
+ * big-endian strings, signatures 64 bytes, ElligatorSwift encodings 64
+ * bytes. Plain 32-bit limb arithmetic, portable to the ESP32; it runs a
+ * few scalar multiplications per connection, not per hash, so it is
+ * written for clarity rather than speed and is not constant time.
+ */
+
+#ifndef PDQ_SECP256K1_H
+#define PDQ_SECP256K1_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Whether p_SecKey is a valid secret key: nonzero and below the order */
+bool PdqSecpSecKeyValid(const uint8_t* p_SecKey);
+
+/* x coordinate of p_SecKey * G */
+bool PdqSecpPubkeyXOnly(const uint8_t* p_SecKey, uint8_t* p_XOnly);
+
+/* ElligatorSwift encoding of p_SecKey * G. p_Rnd32 seeds the choice
+ * among the many encodings of the key and should be random. */
+bool PdqSecpEllSwiftCreate(const uint8_t* p_SecKey, const uint8_t* p_Rnd32, uint8_t* p_Ell64);
+
+/* x coordinate of the point an ElligatorSwift encoding stands for. Every
+ * 64-byte string decodes to some point. */
+void PdqSecpEllSwiftDecode(const uint8_t* p_Ell64, uint8_t* p_X);
+
+/* BIP324 x-only ECDH: tagged hash of both encodings and the shared x.
+ * p_EllA belongs to party A (the connection initiator), p_EllB to B;
+ * p_SecKey is A's secret when PartyA, else B's. */
+bool PdqSecpEllSwiftXdh(const uint8_t* p_EllA, const uint8_t* p_EllB,
+                        const uint8_t* p_SecKey, bool PartyA, uint8_t* p_Secret);
+
+/* BIP340 tagged hash SHA256(SHA256(tag) || SHA256(tag) || msg) */
+void PdqSecpTaggedHash(const char* p_Tag, const uint8_t* p_Msg, size_t Len, uint8_t* p_Hash);
+
+bool PdqSecpSchnorrSign(const uint8_t* p_SecKey, const uint8_t* p_Msg32,
+                        const uint8_t* p_Aux32, uint8_t* p_Sig64);
+bool PdqSecpSchnorrVerify(const uint8_t* p_XOnly, const uint8_t* p_Msg32, const uint8_t* p_Sig64);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
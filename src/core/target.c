@@ -0,0 +1,117 @@
+/**
+ * @file target.c
+ * @brief 256-bit share and network target arithmetic
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "target.h"
+#include "sha256_engine.h"
+#include <string.h>
+#include <math.h>
+
+void PdqTargetFromDifficulty(double Difficulty, uint32_t* p_Target) {
+    memset(p_Target, 0, 32);
+    if (!(Difficulty > 0.0)) Difficulty = 1.0;
+    if (isinf(Difficulty)) return;
+
+    /* Difficulty = Mant * 2^(Exp - 53) exactly, with Mant < 2^53, so
+     * target = 0xFFFF * 2^Shift / Mant. Long division one bit at a time:
+     * the remainder stays below Mant and fits in 64 bits, and the
+     * dividend is a run of 16 one bits at Shift. */
+    int Exp;
+    double Frac = frexp(Difficulty, &Exp);
+    uint64_t Mant = (uint64_t)ldexp(Frac, 53);
+    int Shift = 208 - (Exp - 53);
+
+    if (Shift < 0) return;                  /* Quotient below 1 */
+    if (Shift >= 256 + 38) {                /* Quotient at least 2^256 */
+        memset(p_Target, 0xFF, 32);
+        return;
+    }
+
+    uint64_t Rem = 0;
+    for (int Bit = Shift + 15; Bit >= 0; Bit--) {
+        Rem = (Rem << 1) | (Bit >= Shift ? 1 : 0);
+        if (Rem >= Mant) {
+            Rem -= Mant;
+            if (Bit >= 256) {
+                memset(p_Target, 0xFF, 32);
+                return;
+            }
+            p_Target[Bit / 32] |= 1u << (Bit % 32);
+        }
+    }
+}
+
+PdqError_t PdqTargetFromNBits(uint32_t NBits, uint32_t* p_Target) {
+    memset(p_Target, 0, 32);
+
+    uint32_t Size = NBits >> 24;
+    uint32_t Word = NBits & 0x007FFFFF;
+    if (Word == 0) return PdqOk;
+    if (NBits & 0x00800000) return PdqErrorInvalidParam;
+
+    if (Size <= 3) {
+        p_Target[0] = Word >> (8 * (3 - Size));
+        return PdqOk;
+    }
+
+    uint32_t Shift = 8 * (Size - 3);
+    if ((32 - (uint32_t)__builtin_clz(Word)) + Shift > 256) return PdqErrorInvalidParam;
+
+    p_Target[Shift / 32] = Word << (Shift % 32);
+    if (Shift % 32 != 0 && Shift / 32 + 1 < 8) {
+        p_Target[Shift / 32 + 1] = Word >> (32 - Shift % 32);
+    }
+    return PdqOk;
+}
+
+int PdqTargetCompare(const uint32_t* p_A, const uint32_t* p_B) {
+    for (int i = 7; i >= 0; i--) {
+        if (p_A[i] != p_B[i]) return (p_A[i] < p_B[i]) ? -1 : 1;
+    }
+    return 0;
+}
+
+double PdqTargetToDifficulty(const uint32_t* p_Hash) {
+    double Value = 0.0;
+    for (int i = 7; i >= 0; i--) {
+        Value = Value * 4294967296.0 + (double)p_Hash[i];
+    }
+    if (Value == 0.0) return HUGE_VAL;
+    return ldexp(65535.0, 208) / Value;
+}
+
+void PdqTargetHashHeader(const uint8_t* p_Header, uint32_t* p_Hash) {
+    uint8_t Hash[32];
+    PdqSha256d(p_Header, 80, Hash);
+    for (int i = 0; i < 8; i++) {
+        p_Hash[i] = (uint32_t)Hash[i*4] | ((uint32_t)Hash[i*4+1] << 8) |
+                    ((uint32_t)Hash[i*4+2] << 16) | ((uint32_t)Hash[i*4+3] << 24);
+    }
+}
+
+void PdqTargetHashJob(const PdqMiningJob_t* p_Job, uint32_t Nonce, uint32_t* p_Hash) {
+    /* HeaderSwapped holds the header as big-endian words */
+    uint8_t Header[80];
+    for (int i = 0; i < 19; i++) {
+        uint32_t w = p_Job->HeaderSwapped[i];
+        Header[i*4+0] = (uint8_t)(w >> 24);
+        Header[i*4+1] = (uint8_t)(w >> 16);
+        Header[i*4+2] = (uint8_t)(w >> 8);
+        Header[i*4+3] = (uint8_t)(w);
+    }
+    Header[76] = (uint8_t)(Nonce);
+    Header[77] = (uint8_t)(Nonce >> 8);
+    Header[78] = (uint8_t)(Nonce >> 16);
+    Header[79] = (uint8_t)(Nonce >> 24);
+    PdqTargetHashHeader(Header, p_Hash);
+}
+
+PdqHitClass_t PdqTargetClassify(const PdqMiningJob_t* p_Job, const uint32_t* p_Hash) {
+    /* A block is a block even if the pool asked for more work per share */
+    if (PdqTargetCompare(p_Hash, p_Job->NetworkTarget) <= 0) return PdqHitBlock;
+    if (PdqTargetCompare(p_Hash, p_Job->Target) <= 0) return PdqHitShare;
+    return PdqHitInvalid;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file target.h
+ * @brief 256-bit share and network target arithmetic
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Targets and hashes are LE uint256 values stored as eight words with
+ * word 7 the most significant (pn[] order), the layout of
+ * PdqMiningJob_t.Target. All arithmetic is exact integer math.
+ */
+
+#ifndef PDQ_TARGET_H
+#define PDQ_TARGET_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* What a nonce the engine reported turns out to be once re-hashed */
+typedef enum {
+    PdqHitInvalid = 0,  /* Above the share target: engine false positive */
+    PdqHitShare,        /* Meets the pool's share target */
+    PdqHitBlock         /* Meets the network target: a block candidate */
+} PdqHitClass_t;
+
+/* floor(pdiff1 / Difficulty), pdiff1 = 0xFFFF * 2^208. Fractional
+ * difficulties are exact; results above 2^256 - 1 clamp to all ones. */
+void          PdqTargetFromDifficulty(double Difficulty, uint32_t* p_Target);
+
+/* Decode a compact nBits field. Returns PdqErrorInvalidParam for a
+ * negative or overflowing encoding, leaving p_Target zeroed. */
+PdqError_t    PdqTargetFromNBits(uint32_t NBits, uint32_t* p_Target);
+
+/* <0, 0, >0 as A is below, equal to or above B */
+int           PdqTargetCompare(const uint32_t* p_A, const uint32_t* p_B);
+
+/* Share difficulty of a hash, pdiff1 / hash */
+double        PdqTargetToDifficulty(const uint32_t* p_Hash);
+
+/* SHA256d of a serialized 80-byte header, as target words */
+void          PdqTargetHashHeader(const uint8_t* p_Header, uint32_t* p_Hash);
+
+/* SHA256d of the job's header with Nonce in place, as target words */
+void          PdqTargetHashJob(const PdqMiningJob_t* p_Job, uint32_t Nonce, uint32_t* p_Hash);
+
+PdqHitClass_t PdqTargetClassify(const PdqMiningJob_t* p_Job, const uint32_t* p_Hash);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
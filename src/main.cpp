@@ -11,6 +11,7 @@
 #include "config/config_manager.h"
 #include "network/wifi_manager.h"
 #include "stratum/stratum_client.h"
+#include "stratum/vardiff.h"
 #include "core/mining_task.h"
 #include "core/sha256_engine.h"
 #include "api/device_api.h"
@@ -26,9 +27,16 @@ static uint8_t s_Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
 static uint8_t s_Extranonce1Len = 0;
 static uint32_t s_Extranonce2 = 0;
 static uint32_t s_TemplateCount = 0;
+static PdqVardiff_t s_Vardiff;
 
 #define SETUP_TIMEOUT_MS 30000
 
+static void OnSubmitResult(void* p_Arg, PdqSubmitResult_t Result, int32_t ErrorCode, uint32_t LatencyMs) {
+    (void)p_Arg;
+    (void)ErrorCode;
+    PdqMiningRecordSubmitResult(Result, LatencyMs);
+}
+
 void setup() {
     Serial.begin(115200);
     Serial.println("\n[PDQminer] Starting...");
@@ -109,6 +117,7 @@ void setup() {
     Serial.flush();
 
     PdqStratumInit();
+    PdqStratumCtxSetSubmitCallback(PdqStratumGetDefaultContext(), OnSubmitResult, NULL);
     Serial.println("[DBG] Stratum init done"); Serial.flush();
 
     if (PdqStratumConnect(s_Config.PrimaryPool.Host, s_Config.PrimaryPool.Port) != PdqOk) {
@@ -139,6 +148,7 @@ void setup() {
      * At ~1 MH/s, difficulty 1.0 gives ~1 share every ~4.3 seconds. */
     PdqStratumSuggestDifficulty(1.0);
     Serial.println("[DBG] Suggested difficulty 1.0");
+    PdqVardiffInit(&s_Vardiff, NULL, 1.0);
 
     char Worker[PDQ_MAX_WALLET_LEN + 1 + PDQ_MAX_WORKER_LEN + 1];
     snprintf(Worker, sizeof(Worker), "%s.%s", s_Config.WalletAddress, s_Config.WorkerName);
@@ -210,6 +220,9 @@ void loop() {
             PdqMiningClearShares();
         }
 
+        /* The pool may have reassigned extranonce1 (mining.set_extranonce) */
+        PdqStratumGetExtranonce(s_Extranonce1, &s_Extranonce1Len);
+
         PdqMiningJob_t Job;
         s_Extranonce2++;
 
@@ -220,6 +233,7 @@ void loop() {
                                   s_Extranonce2, PdqStratumGetExtranonce2Size(),
                                   Difficulty,
                                   &Job);
+        Job.ExtranonceGen = PdqStratumGetDefaultContext()->ExtranonceGen;
 
         Serial.printf("[DBG] diff=%.1f target[7:6]=%08x_%08x\n",
                       Difficulty, Job.Target[7], Job.Target[6]);
@@ -231,15 +245,25 @@ void loop() {
     }
 
     if (PdqStratumIsReady()) {
-        int SharesThisLoop = 0;
-        while (PdqMiningHasShare() && SharesThisLoop < 5) {
+        /* Every queued share goes out in one write; a backed-up socket
+         * leaves the rest for the next loop */
+        PdqStratumContext_t* p_Ctx = PdqStratumGetDefaultContext();
+        PdqStratumCtxCork(p_Ctx, true);
+        while (PdqMiningHasShare() && PdqStratumCtxGetTxSpace(p_Ctx) >= PDQ_STRATUM_SEND_BUFFER_SIZE) {
             PdqShareInfo_t Share;
             if (PdqMiningGetShare(&Share) == PdqOk) {
-                PdqStratumSubmitShare(Share.JobId, Share.Extranonce2, Share.Nonce, Share.NTime);
-                Serial.printf("[PDQminer] Share submitted: nonce=%08X\n", Share.Nonce);
+                if (PdqStratumCtxSubmitMinedShare(p_Ctx, &Share) == PdqOk) {
+                    if (Share.BlockCandidate) {
+                        /* Block candidates queue first; send without waiting for the batch */
+                        PdqStratumCtxFlush(p_Ctx);
+                        Serial.printf("[PDQminer] Block candidate submitted: nonce=%08X\n", Share.Nonce);
+                    } else {
+                        Serial.printf("[PDQminer] Share submitted: nonce=%08X\n", Share.Nonce);
+                    }
+                }
             }
-            SharesThisLoop++;
         }
+        PdqStratumCtxCork(p_Ctx, false);
     }
 
     PdqMiningGetStats(&s_Stats);
@@ -248,6 +272,17 @@ void loop() {
     s_Stats.Templates = s_TemplateCount;
     s_Stats.WifiConnected = PdqWifiIsConnected();
 
+    /* Retune the suggested difficulty toward one share every ~20 s */
+    double Suggest;
+    if (PdqStratumIsReady() &&
+        PdqVardiffUpdate(&s_Vardiff, millis(), s_Stats.TotalHashes,
+                         s_Stats.SharesAccepted + s_Stats.SharesRejected +
+                         s_Stats.SharesTimedOut + s_Stats.SharesStale,
+                         s_Stats.Difficulty, &Suggest)) {
+        Serial.printf("[PDQminer] Vardiff: suggesting difficulty %.2f\n", Suggest);
+        PdqStratumSuggestDifficulty(Suggest);
+    }
+
     static uint32_t s_LastSerialUpdate = 0;
     if (millis() - s_LastSerialUpdate > 10000) {
         Serial.printf("[PDQminer] %lu KH/s (HW:%lu SW:%lu) | %.0fC | Shares:%lu Rej:%lu | Diff:%.1f | Tmpl:%lu | Up:%lus\n",
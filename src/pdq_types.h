@@ -26,7 +26,8 @@ typedef enum {
     PdqErrorAuthFailed,
     PdqErrorInvalidJob,
     PdqErrorNvsRead,
-    PdqErrorNvsWrite
+    PdqErrorNvsWrite,
+    PdqErrorParse
 } PdqError_t;
 
 typedef struct {
@@ -40,10 +41,12 @@ typedef struct __attribute__((aligned(4))) {
     uint8_t  BlockTail[64];
     uint32_t NonceStart;
     uint32_t NonceEnd;
-    uint32_t Target[8];
+    uint32_t Target[8];          /* Pool share target */
+    uint32_t NetworkTarget[8];   /* Block target decoded from nBits */
     char     JobId[65];
     uint32_t Extranonce2;
     uint32_t NTime;
+    uint32_t ExtranonceGen;      /* Stratum extranonce1 it was built on */
     uint32_t HeaderSwapped[32];  /* 128 bytes: 80-byte header word-swapped + SHA padding for HW SHA */
 } PdqMiningJob_t;
 
@@ -52,8 +55,32 @@ typedef struct {
     uint32_t Extranonce2;
     uint32_t Nonce;
     uint32_t NTime;
+    uint32_t ExtranonceGen;      /* Copied from the job */
+    bool     BlockCandidate;     /* Meets the network target; submit first */
 } PdqShareInfo_t;
 
+/* Outcome of a submitted share */
+typedef enum {
+    PdqSubmitAccepted = 0,
+    PdqSubmitRejected,
+    PdqSubmitTimedOut,      /* No reply in time, or the session closed first */
+    PdqSubmitStale          /* Job already retired by the pool; never sent */
+} PdqSubmitResult_t;
+
+/* Submit-to-ack latency histogram: bucket 0 counts replies under 1 ms,
+ * bucket b counts [2^(b-1), 2^b) ms, the last one everything slower. */
+#define PDQ_SUBMIT_LATENCY_BUCKETS  14
+
+static inline uint8_t PdqSubmitLatencyBucket(uint32_t LatencyMs)
+{
+    uint8_t Bucket = 0;
+    while (LatencyMs && Bucket < PDQ_SUBMIT_LATENCY_BUCKETS - 1) {
+        LatencyMs >>= 1;
+        Bucket++;
+    }
+    return Bucket;
+}
+
 typedef struct {
     uint32_t HashRate;
     uint32_t HashRateSw;  /* Core 1 SW hashrate (H/s) */
@@ -61,7 +88,11 @@ typedef struct {
     uint64_t TotalHashes;
     uint32_t SharesAccepted;
     uint32_t SharesRejected;
-    uint32_t BlocksFound;
+    uint32_t SharesTimedOut;     /* Submits the pool never answered */
+    uint32_t SharesStale;        /* Dropped before submit, job no longer valid */
+    uint32_t SubmitLatencyHist[PDQ_SUBMIT_LATENCY_BUCKETS];
+    uint64_t SubmitLatencySumMs; /* Over the replies in the histogram */
+    uint32_t BlocksFound;        /* Hits meeting the network target */
     uint32_t Uptime;
     float    Temperature;
     double   Difficulty;   /* Current pool difficulty */
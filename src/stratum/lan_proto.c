@@ -0,0 +1,153 @@
+/**
+ * @file lan_proto.c
+ * @brief Fixed-layout binary work protocol implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "lan_proto.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The structs are the wire format: no padding, whole 32-bit words */
+_Static_assert(sizeof(PdqLanHeader_t) == PDQ_LAN_HEADER_SIZE, "LAN header layout");
+_Static_assert(sizeof(PdqLanWorkRequest_t) == 44, "LAN work request layout");
+_Static_assert(sizeof(PdqLanWork_t) == 208, "LAN work layout");
+_Static_assert(sizeof(PdqLanShare_t) == 28, "LAN share layout");
+_Static_assert(sizeof(PdqLanResult_t) == 20, "LAN result layout");
+_Static_assert(sizeof(PdqLanWork_t) <= PDQ_LAN_MAX_MESSAGE, "LAN message bound");
+
+static void PutHeader(PdqLanHeader_t* p_Header, uint8_t Type, uint16_t Length)
+{
+    p_Header->Magic[0] = PDQ_LAN_MAGIC0;
+    p_Header->Magic[1] = PDQ_LAN_MAGIC1;
+    p_Header->Version = PDQ_LAN_VERSION;
+    p_Header->Type = Type;
+    p_Header->Length = Length;
+    p_Header->Reserved = 0;
+}
+
+int32_t PdqLanMessageLength(const uint8_t* p_Data, size_t Len)
+{
+    if (Len >= 1 && p_Data[0] != PDQ_LAN_MAGIC0) return -1;
+    if (Len >= 2 && p_Data[1] != PDQ_LAN_MAGIC1) return -1;
+    if (Len < PDQ_LAN_HEADER_SIZE) return 0;
+    if (p_Data[2] != PDQ_LAN_VERSION) return -1;
+
+    uint16_t Length = (uint16_t)(p_Data[4] | (p_Data[5] << 8));
+    if (Length < PDQ_LAN_HEADER_SIZE || Length > PDQ_LAN_MAX_MESSAGE || (Length & 3) != 0) return -1;
+    return Length;
+}
+
+static const void* View(const void* p_Msg, size_t Len, uint8_t Type, size_t Size)
+{
+    if (p_Msg == NULL || Len < Size || ((uintptr_t)p_Msg & 3) != 0) return NULL;
+    const PdqLanHeader_t* p_Header = (const PdqLanHeader_t*)p_Msg;
+    if (p_Header->Magic[0] != PDQ_LAN_MAGIC0 || p_Header->Magic[1] != PDQ_LAN_MAGIC1 ||
+        p_Header->Version != PDQ_LAN_VERSION || p_Header->Type != Type || p_Header->Length != Size) {
+        return NULL;
+    }
+    return p_Msg;
+}
+
+const PdqLanWorkRequest_t* PdqLanViewWorkRequest(const void* p_Msg, size_t Len)
+{
+    return (const PdqLanWorkRequest_t*)View(p_Msg, Len, PDQ_LAN_MSG_WORK_REQUEST, sizeof(PdqLanWorkRequest_t));
+}
+
+const PdqLanWork_t* PdqLanViewWork(const void* p_Msg, size_t Len)
+{
+    return (const PdqLanWork_t*)View(p_Msg, Len, PDQ_LAN_MSG_WORK, sizeof(PdqLanWork_t));
+}
+
+const PdqLanShare_t* PdqLanViewShare(const void* p_Msg, size_t Len)
+{
+    return (const PdqLanShare_t*)View(p_Msg, Len, PDQ_LAN_MSG_SHARE, sizeof(PdqLanShare_t));
+}
+
+const PdqLanResult_t* PdqLanViewResult(const void* p_Msg, size_t Len)
+{
+    return (const PdqLanResult_t*)View(p_Msg, Len, PDQ_LAN_MSG_RESULT, sizeof(PdqLanResult_t));
+}
+
+void PdqLanEncodeWorkRequest(const char* p_Worker, PdqLanWorkRequest_t* p_Out)
+{
+    memset(p_Out, 0, sizeof(*p_Out));
+    PutHeader(&p_Out->Header, PDQ_LAN_MSG_WORK_REQUEST, sizeof(*p_Out));
+    if (p_Worker) strncpy(p_Out->Worker, p_Worker, PDQ_LAN_WORKER_LEN - 1);
+}
+
+void PdqLanEncodeWork(const PdqMiningJob_t* p_Job, uint32_t JobTag, uint32_t Flags, PdqLanWork_t* p_Out)
+{
+    PutHeader(&p_Out->Header, PDQ_LAN_MSG_WORK, sizeof(*p_Out));
+    p_Out->JobTag = JobTag;
+    p_Out->Flags = Flags;
+    p_Out->NonceStart = p_Job->NonceStart;
+    p_Out->NonceEnd = p_Job->NonceEnd;
+    p_Out->NTime = p_Job->NTime;
+    p_Out->Extranonce2 = p_Job->Extranonce2;
+    memcpy(p_Out->Target, p_Job->Target, sizeof(p_Out->Target));
+    memcpy(p_Out->NetworkTarget, p_Job->NetworkTarget, sizeof(p_Out->NetworkTarget));
+    memcpy(p_Out->Midstate, p_Job->Midstate, sizeof(p_Out->Midstate));
+    memcpy(p_Out->BlockTail, p_Job->BlockTail, sizeof(p_Out->BlockTail));
+    for (int i = 0; i < 16; i++) {
+        uint32_t Word = __builtin_bswap32(p_Job->HeaderSwapped[i]);
+        memcpy(p_Out->HeaderHead + i * 4, &Word, 4);
+    }
+}
+
+void PdqLanWorkToJob(const PdqLanWork_t* p_Work, PdqMiningJob_t* p_Job)
+{
+    memcpy(p_Job->Midstate, p_Work->Midstate, 32);
+
+    memcpy(p_Job->BlockTail, p_Work->BlockTail, 16);
+    p_Job->BlockTail[16] = 0x80;
+    memset(p_Job->BlockTail + 17, 0, 45);
+    p_Job->BlockTail[62] = 0x02;
+    p_Job->BlockTail[63] = 0x80;
+
+    /* Same layout as PdqStratumHeaderToMiningJob: big-endian header words
+     * and the SHA padding for an 80-byte message */
+    for (int i = 0; i < 16; i++) {
+        uint32_t Word;
+        memcpy(&Word, p_Work->HeaderHead + i * 4, 4);
+        p_Job->HeaderSwapped[i] = __builtin_bswap32(Word);
+    }
+    for (int i = 0; i < 4; i++) {
+        uint32_t Word;
+        memcpy(&Word, p_Work->BlockTail + i * 4, 4);
+        p_Job->HeaderSwapped[16 + i] = __builtin_bswap32(Word);
+    }
+    p_Job->HeaderSwapped[20] = 0x80000000;
+    for (int i = 21; i < 31; i++) {
+        p_Job->HeaderSwapped[i] = 0;
+    }
+    p_Job->HeaderSwapped[31] = 0x00000280;
+
+    p_Job->NonceStart = p_Work->NonceStart;
+    p_Job->NonceEnd = p_Work->NonceEnd;
+    memcpy(p_Job->Target, p_Work->Target, sizeof(p_Job->Target));
+    memcpy(p_Job->NetworkTarget, p_Work->NetworkTarget, sizeof(p_Job->NetworkTarget));
+    snprintf(p_Job->JobId, sizeof(p_Job->JobId), "%08x", (unsigned)p_Work->JobTag);
+    p_Job->Extranonce2 = p_Work->Extranonce2;
+    p_Job->NTime = p_Work->NTime;
+}
+
+void PdqLanEncodeShare(const PdqShareInfo_t* p_Share, PdqLanShare_t* p_Out)
+{
+    PutHeader(&p_Out->Header, PDQ_LAN_MSG_SHARE, sizeof(*p_Out));
+    p_Out->JobTag = (uint32_t)strtoul(p_Share->JobId, NULL, 16);
+    p_Out->Nonce = p_Share->Nonce;
+    p_Out->NTime = p_Share->NTime;
+    p_Out->Extranonce2 = p_Share->Extranonce2;
+    p_Out->Flags = p_Share->BlockCandidate ? PDQ_LAN_SHARE_BLOCK : 0;
+}
+
+void PdqLanEncodeResult(uint32_t JobTag, uint32_t Nonce, int32_t Code, PdqLanResult_t* p_Out)
+{
+    PutHeader(&p_Out->Header, PDQ_LAN_MSG_RESULT, sizeof(*p_Out));
+    p_Out->JobTag = JobTag;
+    p_Out->Nonce = Nonce;
+    p_Out->Code = Code;
+}
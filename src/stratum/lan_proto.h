@@ -0,0 +1,131 @@
+/**
+ * @file lan_proto.h
+ * @brief Fixed-layout binary work protocol for LAN fleets
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * A device on the LAN can take its work from a proxy as ready-to-hash
+ * binary messages instead of mining.notify: no JSON to scan, no coinbase
+ * or merkle root to hash, just the midstate and header the engines use.
+ * Shares go back the same way, tagged with the work they were found on.
+ *
+ * Every message is a struct laid out exactly as it travels: an 8-byte
+ * header, then 32-bit little-endian fields, sized to a multiple of four.
+ * A receiver that keeps its buffer 4-byte aligned and consumes whole
+ * messages reads them in place; the View functions only check the header
+ * and return a pointer into the buffer. All supported targets (ESP32,
+ * ESP8266, x86, ARM) are little-endian, so there is no byte swapping.
+ */
+
+#ifndef PDQ_LAN_PROTO_H
+#define PDQ_LAN_PROTO_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "lan_proto.h messages are read in place and need a little-endian target"
+#endif
+
+#define PDQ_LAN_MAGIC0              'P'
+#define PDQ_LAN_MAGIC1              'Q'
+#define PDQ_LAN_VERSION             1
+#define PDQ_LAN_HEADER_SIZE         8
+#define PDQ_LAN_MAX_MESSAGE         256     /* Longest message of any type */
+
+#define PDQ_LAN_MSG_WORK_REQUEST    0x01    /* Device -> host */
+#define PDQ_LAN_MSG_WORK            0x02    /* Host -> device */
+#define PDQ_LAN_MSG_SHARE           0x03    /* Device -> host */
+#define PDQ_LAN_MSG_RESULT          0x04    /* Host -> device */
+
+#define PDQ_LAN_WORK_CLEAN          0x00000001  /* Abandon earlier work */
+#define PDQ_LAN_SHARE_BLOCK         0x00000001  /* Met the network target */
+#define PDQ_LAN_WORKER_LEN          32
+
+typedef struct {
+    uint8_t  Magic[2];
+    uint8_t  Version;
+    uint8_t  Type;
+    uint16_t Length;            /* Whole message, header included */
+    uint16_t Reserved;
+} PdqLanHeader_t;
+
+/* Opens the session on the first send; every later one asks for fresh
+ * work, e.g. once the nonce range is exhausted */
+typedef struct {
+    PdqLanHeader_t Header;
+    uint32_t       Flags;       /* Reserved, 0 */
+    char           Worker[PDQ_LAN_WORKER_LEN];  /* NUL-padded, for the host's logs */
+} PdqLanWorkRequest_t;
+
+/* PdqMiningJob_t without the parts a device can rebuild: the tail's SHA
+ * padding and the byte-swapped header. The first header block travels
+ * as well, because the ESP32 SHA peripheral cannot start from a
+ * midstate and hashes the whole header. */
+typedef struct {
+    PdqLanHeader_t Header;
+    uint32_t       JobTag;      /* Echoed in shares found on this work */
+    uint32_t       Flags;       /* PDQ_LAN_WORK_CLEAN */
+    uint32_t       NonceStart;
+    uint32_t       NonceEnd;
+    uint32_t       NTime;
+    uint32_t       Extranonce2; /* For the device's logs; the tag identifies the work */
+    uint32_t       Target[8];
+    uint32_t       NetworkTarget[8];
+    uint8_t        Midstate[32];
+    uint8_t        BlockTail[16];   /* Header bytes 64-79, nonce zero */
+    uint8_t        HeaderHead[64];  /* Header bytes 0-63 */
+} PdqLanWork_t;
+
+typedef struct {
+    PdqLanHeader_t Header;
+    uint32_t       JobTag;
+    uint32_t       Nonce;
+    uint32_t       NTime;
+    uint32_t       Extranonce2;
+    uint32_t       Flags;       /* PDQ_LAN_SHARE_BLOCK */
+} PdqLanShare_t;
+
+/* The answer to a share, or JobTag 0 for a refused work request */
+typedef struct {
+    PdqLanHeader_t Header;
+    uint32_t       JobTag;
+    uint32_t       Nonce;
+    int32_t        Code;        /* 0 accepted, else the Stratum V1 error code */
+} PdqLanResult_t;
+
+/* Length of the message starting at p_Data once its header is in: 0
+ * while fewer than PDQ_LAN_HEADER_SIZE bytes are buffered, -1 if this is
+ * not a LAN message or its length is impossible */
+int32_t PdqLanMessageLength(const uint8_t* p_Data, size_t Len);
+
+/* Zero-copy views: p_Msg itself if it holds a complete message of that
+ * type and size, else NULL. p_Msg must be 4-byte aligned. */
+const PdqLanWorkRequest_t* PdqLanViewWorkRequest(const void* p_Msg, size_t Len);
+const PdqLanWork_t*        PdqLanViewWork(const void* p_Msg, size_t Len);
+const PdqLanShare_t*       PdqLanViewShare(const void* p_Msg, size_t Len);
+const PdqLanResult_t*      PdqLanViewResult(const void* p_Msg, size_t Len);
+
+void PdqLanEncodeWorkRequest(const char* p_Worker, PdqLanWorkRequest_t* p_Out);
+
+/* From a job built the Stratum way (PdqStratumBuildMiningJob or
+ * PdqStratumHeaderToMiningJob); the header is taken from HeaderSwapped */
+void PdqLanEncodeWork(const PdqMiningJob_t* p_Job, uint32_t JobTag, uint32_t Flags, PdqLanWork_t* p_Out);
+
+/* The job the work describes, identical to the one it was encoded from
+ * except for JobId, which becomes the tag as 8 hex digits */
+void PdqLanWorkToJob(const PdqLanWork_t* p_Work, PdqMiningJob_t* p_Job);
+
+/* A share from a job made by PdqLanWorkToJob; its JobId is the tag */
+void PdqLanEncodeShare(const PdqShareInfo_t* p_Share, PdqLanShare_t* p_Out);
+
+void PdqLanEncodeResult(uint32_t JobTag, uint32_t Nonce, int32_t Code, PdqLanResult_t* p_Out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,596 @@
+/**
+ * @file pool_supervisor.c
+ * @brief Pool connection supervisor implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "pool_supervisor.h"
+#include <string.h>
+#include <stdio.h>
+
+/* Outcome of driving one session for a tick */
+typedef enum {
+    SessionIdle = 0,
+    SessionUp,          /* Handshake completed */
+    SessionDropped,     /* A working session went away */
+    SessionSilent,      /* A working session stopped talking and was dropped */
+    SessionFailed       /* A connection attempt failed before authorizing */
+} SessionOutcome_t;
+
+static const char* PoolName(uint8_t Index)
+{
+    return Index ? "backup" : "primary";
+}
+
+static bool IsHot(const PdqPoolSupervisor_t* p_Sup)
+{
+    return p_Sup->Tuning.HotStandby && p_Sup->HasBackup;
+}
+
+static uint32_t NextRandom(PdqPoolSupervisor_t* p_Sup)
+{
+    /* xorshift32: only used to spread reconnects, not for security */
+    uint32_t X = p_Sup->Rng;
+    X ^= X << 13;
+    X ^= X >> 17;
+    X ^= X << 5;
+    p_Sup->Rng = X;
+    return X;
+}
+
+/* Exponential backoff with "equal jitter": half the window is fixed, the
+ * other half random, so a fleet that lost the same pool does not come
+ * back in lockstep. */
+static uint32_t NextBackoff(PdqPoolSupervisor_t* p_Sup, PdqPoolSession_t* p_Session)
+{
+    uint32_t Window = p_Session->BackoffMs ? p_Session->BackoffMs * 2 : p_Sup->Tuning.BackoffMinMs;
+    if (Window > p_Sup->Tuning.BackoffMaxMs || Window < p_Session->BackoffMs) {
+        Window = p_Sup->Tuning.BackoffMaxMs;
+    }
+    p_Session->BackoffMs = Window;
+
+    uint32_t Half = Window / 2;
+    return Half + NextRandom(p_Sup) % (Half + 1);
+}
+
+static void ScheduleRetry(PdqPoolSupervisor_t* p_Sup, uint8_t Index, uint64_t NowMs)
+{
+    PdqPoolSession_t* p_Session = &p_Sup->Sessions[Index];
+    uint32_t Delay = NextBackoff(p_Sup, p_Session);
+    p_Session->RetryAtMs = NowMs + Delay;
+    printf("[POOL] Attempt %u on %s pool failed, retry in %lu ms\n",
+           (unsigned)p_Session->FailCount, PoolName(Index), (unsigned long)Delay);
+}
+
+static void ResetSession(PdqPoolSession_t* p_Session, uint64_t NowMs)
+{
+    p_Session->FailCount = 0;
+    p_Session->BackoffMs = 0;
+    p_Session->RetryAtMs = NowMs;
+}
+
+static void BeginAttempt(PdqPoolSupervisor_t* p_Sup, uint8_t Index)
+{
+    const PdqPoolConfig_t* p_Pool = &p_Sup->Pools[Index];
+    PdqPoolSession_t* p_Session = &p_Sup->Sessions[Index];
+    printf("[POOL] Connecting to %s pool %s:%u\n", PoolName(Index), p_Pool->Host, p_Pool->Port);
+
+    p_Session->Connecting = true;
+    p_Session->SessionUp = false;
+    p_Session->LastStratumState = -1;
+    PdqStratumCtxConnectStart(p_Session->p_Ctx, p_Pool->Host, p_Pool->Port);
+}
+
+static void DropSession(PdqPoolSupervisor_t* p_Sup, uint8_t Index)
+{
+    PdqPoolSession_t* p_Session = &p_Sup->Sessions[Index];
+    PdqStratumCtxDisconnect(p_Session->p_Ctx);
+    p_Session->LastStratumState = (int)StratumStateDisconnected;
+    p_Session->Connecting = false;
+    p_Session->SessionUp = false;
+}
+
+/* React to Stratum state changes: finish the handshake, notice drops */
+static SessionOutcome_t Advance(PdqPoolSupervisor_t* p_Sup, uint8_t Index, uint64_t NowMs)
+{
+    PdqPoolSession_t* p_Session = &p_Sup->Sessions[Index];
+    PdqStratumContext_t* p_Ctx = p_Session->p_Ctx;
+
+    int State = (int)PdqStratumCtxGetState(p_Ctx);
+    if (State == p_Session->LastStratumState) return SessionIdle;
+    p_Session->LastStratumState = State;
+
+    switch ((PdqStratumState_t)State) {
+        case StratumStateConnected:
+            PdqStratumCtxSubscribe(p_Ctx);
+            break;
+
+        case StratumStateSubscribed: {
+            if (p_Ctx->Extranonce1Len == 0) {
+                printf("[POOL] Invalid extranonce1 (zero length)\n");
+                DropSession(p_Sup, Index);
+                return SessionFailed;
+            }
+            const PdqPoolConfig_t* p_Pool = &p_Sup->Pools[Index];
+            PdqStratumCtxSuggestDifficulty(p_Ctx, p_Sup->Difficulty);
+            PdqStratumCtxAuthorize(p_Ctx, p_Sup->Worker,
+                                   p_Pool->Password[0] ? p_Pool->Password : "x");
+            break;
+        }
+
+        case StratumStateAuthorized:
+        case StratumStateReady:
+            if (!p_Session->SessionUp) {
+                p_Session->SessionUp = true;
+                p_Session->Connecting = false;
+                p_Session->FailCount = 0;
+                p_Session->BackoffMs = 0;
+                p_Session->UpSinceMs = NowMs;
+                printf("[POOL] Session up on %s pool\n", PoolName(Index));
+                return SessionUp;
+            }
+            break;
+
+        case StratumStateDisconnected: {
+            bool WasUp = p_Session->SessionUp;
+            p_Session->Connecting = false;
+            p_Session->SessionUp = false;
+            return WasUp ? SessionDropped : SessionFailed;
+        }
+
+        default:
+            break;
+    }
+    return SessionIdle;
+}
+
+/* Connect when due, pump the socket, and watch for a silent pool */
+static SessionOutcome_t DriveSession(PdqPoolSupervisor_t* p_Sup, uint8_t Index, uint64_t NowMs)
+{
+    PdqPoolSession_t* p_Session = &p_Sup->Sessions[Index];
+
+    if (!p_Session->Connecting && !p_Session->SessionUp) {
+        if (NowMs < p_Session->RetryAtMs) return SessionIdle;
+        BeginAttempt(p_Sup, Index);
+    }
+
+    PdqStratumCtxProcess(p_Session->p_Ctx);
+    SessionOutcome_t Outcome = Advance(p_Sup, Index, NowMs);
+    if (Outcome != SessionIdle || !p_Session->SessionUp) return Outcome;
+
+    /* Dead-pool watchdog: a connected but silent pool is as bad as none */
+    uint64_t LastRx = PdqStratumCtxGetLastRxMs(p_Session->p_Ctx);
+    if (NowMs > LastRx && NowMs - LastRx > p_Sup->Tuning.SilenceTimeoutMs) {
+        printf("[POOL] No data from %s pool for %lu ms, dropping it\n",
+               PoolName(Index), (unsigned long)(NowMs - LastRx));
+        DropSession(p_Sup, Index);
+        return SessionSilent;
+    }
+    return SessionIdle;
+}
+
+/* Keep the standby's latest notify built into a ready-to-mine job */
+static void RefreshStandbyJob(PdqPoolSupervisor_t* p_Sup, uint8_t Index)
+{
+    PdqStratumContext_t* p_Ctx = p_Sup->Sessions[Index].p_Ctx;
+    if (!PdqStratumCtxHasNewJob(p_Ctx)) return;
+    if (PdqStratumCtxBuildNextJob(p_Ctx, &p_Sup->StandbyJob) == PdqOk) {
+        p_Sup->HasStandbyJob = true;
+    }
+}
+
+static void UpdateState(PdqPoolSupervisor_t* p_Sup)
+{
+    const PdqPoolSession_t* p_Session = &p_Sup->Sessions[p_Sup->ActivePool];
+    if (p_Session->SessionUp) {
+        p_Sup->State = p_Sup->ActivePool ? PoolStateBackupConnected : PoolStatePrimaryConnected;
+    } else if (p_Session->Connecting) {
+        p_Sup->State = PoolStateReconnecting;
+    } else {
+        p_Sup->State = p_Sup->ActivePool ? PoolStateBackupFailed : PoolStatePrimaryFailed;
+    }
+}
+
+/* ---- Cold failover: one session, moved between pools ---- */
+
+static uint32_t ColdAttemptFailed(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs)
+{
+    uint8_t Active = p_Sup->ActivePool;
+    PdqPoolSession_t* p_Session = &p_Sup->Sessions[Active];
+    p_Session->FailCount++;
+
+    if (p_Sup->ProbingPrimary) {
+        /* Primary still unhealthy: return to the backup without waiting */
+        p_Sup->ProbingPrimary = false;
+        p_Sup->ActivePool = 1;
+        ResetSession(&p_Sup->Sessions[1], NowMs);
+        printf("[POOL] Primary still down, returning to backup\n");
+        return PDQ_POOL_EVENT_SWITCHED;
+    }
+
+    if (p_Sup->HasBackup && p_Session->FailCount >= p_Sup->Tuning.MaxConsecutiveFail) {
+        printf("[POOL] %u consecutive failures on %s pool, failing over\n",
+               (unsigned)p_Session->FailCount, PoolName(Active));
+        p_Sup->ActivePool = (uint8_t)(Active ^ 1);
+        ResetSession(&p_Sup->Sessions[p_Sup->ActivePool], NowMs);
+        p_Sup->Failovers++;
+        return PDQ_POOL_EVENT_SWITCHED;
+    }
+
+    ScheduleRetry(p_Sup, Active, NowMs);
+    return 0;
+}
+
+static uint32_t ProcessCold(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs)
+{
+    uint32_t Events = 0;
+    uint8_t Active = p_Sup->ActivePool;
+    PdqPoolSession_t* p_Session = &p_Sup->Sessions[Active];
+
+    switch (DriveSession(p_Sup, Active, NowMs)) {
+        case SessionUp:
+            p_Sup->ProbingPrimary = false;
+            if (Active) p_Sup->OnBackupSinceMs = NowMs;
+            Events |= PDQ_POOL_EVENT_READY;
+            break;
+
+        case SessionDropped:
+            /* A working session dropped: try the same pool again right away */
+            Events |= PDQ_POOL_EVENT_LOST;
+            p_Sup->Reconnects++;
+            p_Session->RetryAtMs = NowMs;
+            printf("[POOL] Lost session on %s pool, reconnecting\n", PoolName(Active));
+            break;
+
+        case SessionSilent:
+            /* Counted as a failed attempt so a pool that accepts connections
+             * but never talks still leads to failover */
+            Events |= PDQ_POOL_EVENT_LOST;
+            p_Sup->Reconnects++;
+            Events |= ColdAttemptFailed(p_Sup, NowMs);
+            break;
+
+        case SessionFailed:
+            Events |= ColdAttemptFailed(p_Sup, NowMs);
+            break;
+
+        default:
+            break;
+    }
+
+    /* Periodically give the primary another chance while on the backup */
+    if (p_Sup->ActivePool == 1 && p_Sup->Sessions[1].SessionUp &&
+        NowMs - p_Sup->OnBackupSinceMs >= p_Sup->Tuning.PrimaryRecheckMs) {
+        printf("[POOL] Rechecking primary pool\n");
+        DropSession(p_Sup, 1);
+        p_Sup->ProbingPrimary = true;
+        p_Sup->ActivePool = 0;
+        ResetSession(&p_Sup->Sessions[0], NowMs);
+        Events |= PDQ_POOL_EVENT_LOST | PDQ_POOL_EVENT_SWITCHED;
+    }
+
+    return Events;
+}
+
+/* ---- Startup race: both pools dialled, first to subscribe wins ---- */
+
+static uint32_t ProcessRace(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs)
+{
+    int Winner = -1;
+    uint32_t Events = 0;
+
+    for (uint8_t i = 0; i < 2 && Winner < 0; i++) {
+        PdqPoolSession_t* p_Session = &p_Sup->Sessions[i];
+        if (!p_Session->Connecting && !p_Session->SessionUp) continue;
+
+        SessionOutcome_t Outcome = DriveSession(p_Sup, i, NowMs);
+        if (Outcome == SessionFailed) {
+            p_Session->FailCount++;
+        } else if (Outcome == SessionUp) {
+            Events |= PDQ_POOL_EVENT_READY;
+            Winner = i;
+        } else if (PdqStratumCtxGetState(p_Session->p_Ctx) >= StratumStateSubscribed) {
+            Winner = i;
+        }
+    }
+
+    if (Winner < 0) {
+        if (p_Sup->Sessions[0].Connecting || p_Sup->Sessions[1].Connecting) return 0;
+        /* Both lost: fall back to the normal primary-first schedule */
+        printf("[POOL] No pool answered the startup race\n");
+        p_Sup->Racing = false;
+        p_Sup->ActivePool = 0;
+        ScheduleRetry(p_Sup, 0, NowMs);
+        if (IsHot(p_Sup)) ScheduleRetry(p_Sup, 1, NowMs);
+        return 0;
+    }
+
+    uint8_t Loser = (uint8_t)(Winner ^ 1);
+    p_Sup->Racing = false;
+    p_Sup->ActivePool = (uint8_t)Winner;
+    if (Winner == 1) {
+        p_Sup->OnBackupSinceMs = NowMs;
+        Events |= PDQ_POOL_EVENT_SWITCHED;
+    }
+    printf("[POOL] %s pool won the connection race\n", Winner ? "Backup" : "Primary");
+
+    if (!IsHot(p_Sup)) {
+        DropSession(p_Sup, Loser);
+        ResetSession(&p_Sup->Sessions[Loser], NowMs);
+    } else if (!p_Sup->Sessions[Loser].Connecting && !p_Sup->Sessions[Loser].SessionUp) {
+        ScheduleRetry(p_Sup, Loser, NowMs);
+    }
+    return Events;
+}
+
+/* ---- Hot standby: both pools connected, active one chosen ---- */
+
+static uint32_t HotSwitch(PdqPoolSupervisor_t* p_Sup, uint8_t To, const char* p_Reason)
+{
+    RefreshStandbyJob(p_Sup, To);
+    p_Sup->ActivePool = To;
+    p_Sup->HasSwitchJob = p_Sup->HasStandbyJob;
+    p_Sup->HasStandbyJob = false;
+    if (To == 1) p_Sup->Failovers++;
+    printf("[POOL] Switched to %s pool (%s)%s\n", PoolName(To), p_Reason,
+           p_Sup->HasSwitchJob ? ", prebuilt job ready" : "");
+    return PDQ_POOL_EVENT_SWITCHED | PDQ_POOL_EVENT_READY;
+}
+
+static uint32_t ProcessHot(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs)
+{
+    uint32_t Events = 0;
+
+    for (uint8_t i = 0; i < 2; i++) {
+        PdqPoolSession_t* p_Session = &p_Sup->Sessions[i];
+        SessionOutcome_t Outcome = DriveSession(p_Sup, i, NowMs);
+        uint8_t Other = (uint8_t)(i ^ 1);
+        bool IsActive = (i == p_Sup->ActivePool);
+
+        switch (Outcome) {
+            case SessionUp:
+                if (IsActive) {
+                    Events |= PDQ_POOL_EVENT_READY;
+                } else if (!p_Sup->Sessions[Other].SessionUp &&
+                           !p_Sup->Sessions[Other].Connecting) {
+                    /* Active pool is down and backing off: take this one */
+                    Events |= HotSwitch(p_Sup, i, "active pool unavailable");
+                }
+                break;
+
+            case SessionDropped:
+                /* A working session dropped: try the same pool again right away */
+                p_Sup->Reconnects++;
+                p_Session->RetryAtMs = NowMs;
+                break;
+
+            case SessionSilent:
+                p_Sup->Reconnects++;
+                p_Session->FailCount++;
+                ScheduleRetry(p_Sup, i, NowMs);
+                break;
+
+            case SessionFailed:
+                p_Session->FailCount++;
+                ScheduleRetry(p_Sup, i, NowMs);
+                break;
+
+            default:
+                break;
+        }
+
+        if (Outcome == SessionIdle || Outcome == SessionUp) continue;
+
+        if (!IsActive) {
+            p_Sup->HasStandbyJob = false;
+        } else if (p_Sup->Sessions[Other].SessionUp) {
+            Events |= HotSwitch(p_Sup, Other, "active pool lost");
+        } else if (Outcome != SessionFailed) {
+            Events |= PDQ_POOL_EVENT_LOST;
+        }
+    }
+
+    uint8_t Standby = (uint8_t)(p_Sup->ActivePool ^ 1);
+    if (p_Sup->Sessions[Standby].SessionUp) RefreshStandbyJob(p_Sup, Standby);
+
+    /* Move back once the primary has stayed healthy for the recheck period */
+    if (p_Sup->ActivePool == 1 && p_Sup->Sessions[0].SessionUp && p_Sup->HasStandbyJob &&
+        NowMs - p_Sup->Sessions[0].UpSinceMs >= p_Sup->Tuning.PrimaryRecheckMs) {
+        Events |= HotSwitch(p_Sup, 0, "primary recovered");
+    }
+
+    return Events;
+}
+
+// Public API functions for the pool supervisor
+
+void PdqPoolSupervisorDefaults(PdqPoolSupervisorConfig_t* p_Tuning)
+{
+    if (p_Tuning == NULL) return;
+    p_Tuning->BackoffMinMs = PDQ_POOL_BACKOFF_MIN_MS;
+    p_Tuning->BackoffMaxMs = PDQ_POOL_BACKOFF_MAX_MS;
+    p_Tuning->SilenceTimeoutMs = PDQ_POOL_SILENCE_TIMEOUT_MS;
+    p_Tuning->PrimaryRecheckMs = PDQ_POOL_PRIMARY_RECHECK_MS;
+    p_Tuning->MaxConsecutiveFail = PDQ_POOL_MAX_CONSECUTIVE_FAIL;
+    p_Tuning->HotStandby = false;
+    p_Tuning->RacePools = false;
+}
+
+PdqError_t PdqPoolSupervisorInit(PdqPoolSupervisor_t* p_Sup,
+                                 const PdqDeviceConfig_t* p_Config,
+                                 double Difficulty,
+                                 const PdqPoolSupervisorConfig_t* p_Tuning)
+{
+    if (p_Sup == NULL || p_Config == NULL) return PdqErrorInvalidParam;
+    if (p_Config->PrimaryPool.Host[0] == '\0' || p_Config->PrimaryPool.Port == 0) {
+        return PdqErrorInvalidParam;
+    }
+
+    memset(p_Sup, 0, sizeof(*p_Sup));
+    p_Sup->Pools[0] = p_Config->PrimaryPool;
+    p_Sup->Pools[1] = p_Config->BackupPool;
+    p_Sup->HasBackup = (p_Config->BackupPool.Host[0] != '\0' && p_Config->BackupPool.Port != 0);
+
+    if (p_Config->WorkerName[0]) {
+        snprintf(p_Sup->Worker, sizeof(p_Sup->Worker), "%s.%s",
+                 p_Config->WalletAddress, p_Config->WorkerName);
+    } else {
+        snprintf(p_Sup->Worker, sizeof(p_Sup->Worker), "%s", p_Config->WalletAddress);
+    }
+    p_Sup->Difficulty = Difficulty;
+
+    if (p_Tuning) {
+        p_Sup->Tuning = *p_Tuning;
+    } else {
+        PdqPoolSupervisorDefaults(&p_Sup->Tuning);
+    }
+    if (p_Sup->Tuning.MaxConsecutiveFail == 0) p_Sup->Tuning.MaxConsecutiveFail = 1;
+    if (p_Sup->Tuning.BackoffMinMs == 0) p_Sup->Tuning.BackoffMinMs = 1;
+
+    for (int i = 0; i < 2; i++) {
+        PdqStratumCtxInit(&p_Sup->Contexts[i]);
+        p_Sup->Sessions[i].p_Ctx = &p_Sup->Contexts[i];
+        p_Sup->Sessions[i].LastStratumState = -1;
+    }
+
+    p_Sup->ReadyPool = UINT8_MAX;
+    p_Sup->State = PoolStateReconnecting;
+    return PdqOk;
+}
+
+/* Seed the jitter from time and worker so co-located miners differ */
+static void SeedJitter(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs)
+{
+    uint32_t Seed = (uint32_t)NowMs ^ 0x9E3779B9u;
+    for (const char* p = p_Sup->Worker; *p; p++) Seed = Seed * 31u + (uint8_t)*p;
+    p_Sup->Rng = Seed ? Seed : 1;
+}
+
+PdqError_t PdqPoolSupervisorStart(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs)
+{
+    if (p_Sup == NULL) return PdqErrorInvalidParam;
+
+    SeedJitter(p_Sup, NowMs);
+    p_Sup->ActivePool = 0;
+    p_Sup->Racing = p_Sup->Tuning.RacePools && p_Sup->HasBackup;
+    ResetSession(&p_Sup->Sessions[0], NowMs);
+    BeginAttempt(p_Sup, 0);
+    if (IsHot(p_Sup) || p_Sup->Racing) {
+        ResetSession(&p_Sup->Sessions[1], NowMs);
+        BeginAttempt(p_Sup, 1);
+    }
+    return PdqOk;
+}
+
+PdqError_t PdqPoolSupervisorResume(PdqPoolSupervisor_t* p_Sup, uint8_t Index, uint64_t NowMs)
+{
+    if (p_Sup == NULL || Index > 1 || (Index == 1 && !p_Sup->HasBackup)) return PdqErrorInvalidParam;
+    if (!PdqStratumCtxIsReady(p_Sup->Sessions[Index].p_Ctx)) return PdqErrorNotConnected;
+
+    SeedJitter(p_Sup, NowMs);
+    p_Sup->ActivePool = Index;
+    p_Sup->Racing = false;
+
+    /* Counted as an attempt in flight, so Advance sees the session come up */
+    PdqPoolSession_t* p_Session = &p_Sup->Sessions[Index];
+    ResetSession(p_Session, NowMs);
+    p_Session->Connecting = true;
+    p_Session->SessionUp = false;
+    p_Session->LastStratumState = -1;
+    printf("[POOL] Resumed session on %s pool %s:%u\n", PoolName(Index),
+           p_Sup->Pools[Index].Host, p_Sup->Pools[Index].Port);
+
+    if (IsHot(p_Sup)) {
+        uint8_t Other = (uint8_t)(Index ^ 1);
+        ResetSession(&p_Sup->Sessions[Other], NowMs);
+        BeginAttempt(p_Sup, Other);
+    }
+    return PdqOk;
+}
+
+uint32_t PdqPoolSupervisorProcess(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs)
+{
+    if (p_Sup == NULL) return 0;
+    uint32_t Events;
+    if (p_Sup->Racing) {
+        Events = ProcessRace(p_Sup, NowMs);
+    } else {
+        Events = IsHot(p_Sup) ? ProcessHot(p_Sup, NowMs) : ProcessCold(p_Sup, NowMs);
+    }
+    UpdateState(p_Sup);
+    if (Events & PDQ_POOL_EVENT_READY) {
+        p_Sup->SessionKept = p_Sup->ReadyPool == p_Sup->ActivePool &&
+                             p_Sup->Contexts[p_Sup->ActivePool].Resumed;
+        p_Sup->ReadyPool = p_Sup->ActivePool;
+    }
+    return Events;
+}
+
+void PdqPoolSupervisorStop(PdqPoolSupervisor_t* p_Sup)
+{
+    if (p_Sup == NULL) return;
+    for (uint8_t i = 0; i < 2; i++) {
+        if (p_Sup->Sessions[i].p_Ctx) DropSession(p_Sup, i);
+        PdqStratumCtxRelease(&p_Sup->Contexts[i]);
+    }
+    p_Sup->HasStandbyJob = false;
+    p_Sup->HasSwitchJob = false;
+    p_Sup->State = PoolStateReconnecting;
+}
+
+PdqPoolState_t PdqPoolSupervisorGetState(const PdqPoolSupervisor_t* p_Sup)
+{
+    return p_Sup ? p_Sup->State : PoolStateReconnecting;
+}
+
+const PdqPoolConfig_t* PdqPoolSupervisorGetActivePool(const PdqPoolSupervisor_t* p_Sup)
+{
+    return p_Sup ? &p_Sup->Pools[p_Sup->ActivePool] : NULL;
+}
+
+PdqStratumContext_t* PdqPoolSupervisorGetContext(PdqPoolSupervisor_t* p_Sup)
+{
+    return p_Sup ? p_Sup->Sessions[p_Sup->ActivePool].p_Ctx : NULL;
+}
+
+PdqStratumContext_t* PdqPoolSupervisorGetSessionContext(PdqPoolSupervisor_t* p_Sup, uint8_t Index)
+{
+    if (p_Sup == NULL || Index > 1) return NULL;
+    if (Index == 1 && !p_Sup->HasBackup) return NULL;
+    return p_Sup->Sessions[Index].p_Ctx;
+}
+
+int PdqPoolSupervisorGetWakeupMs(PdqPoolSupervisor_t* p_Sup)
+{
+    int Wakeup = -1;
+    for (uint8_t i = 0; p_Sup && i < 2; i++) {
+        int Ms = PdqStratumCtxGetWakeupMs(p_Sup->Sessions[i].p_Ctx);
+        if (Ms >= 0 && (Wakeup < 0 || Ms < Wakeup)) Wakeup = Ms;
+    }
+    return Wakeup;
+}
+
+void PdqPoolSupervisorSuggestDifficulty(PdqPoolSupervisor_t* p_Sup, double Difficulty)
+{
+    if (p_Sup == NULL) return;
+    p_Sup->Difficulty = Difficulty;
+    for (uint8_t i = 0; i < 2; i++) {
+        if (p_Sup->Sessions[i].SessionUp) {
+            PdqStratumCtxSuggestDifficulty(p_Sup->Sessions[i].p_Ctx, Difficulty);
+        }
+    }
+}
+
+bool PdqPoolSupervisorTakeSwitchJob(PdqPoolSupervisor_t* p_Sup, PdqMiningJob_t* p_Job)
+{
+    if (p_Sup == NULL || p_Job == NULL || !p_Sup->HasSwitchJob) return false;
+    *p_Job = p_Sup->StandbyJob;
+    p_Sup->HasSwitchJob = false;
+    return true;
+}
+
+bool PdqPoolSupervisorSessionKept(const PdqPoolSupervisor_t* p_Sup)
+{
+    return p_Sup != NULL && p_Sup->SessionKept;
+}
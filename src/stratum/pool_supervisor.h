@@ -0,0 +1,152 @@
+/**
+ * @file pool_supervisor.h
+ * @brief Pool connection supervisor: reconnect, watchdog and failover
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Owns the lifecycle of the Stratum session (connect, subscribe,
+ * authorize) and implements the failover logic from SDD 4.5.6:
+ *
+ *   Primary Pool ──[fail]──▶ Backup Pool ──[fail]──▶ Primary Pool (retry)
+ *         ▲                        │
+ *         └────[recovered]─────────┘
+ *
+ * With HotStandby set, the backup keeps its own authorized session and a
+ * prebuilt job while the primary is in use, so a dead primary costs one
+ * job switch instead of a full reconnect. With RacePools set, startup
+ * connects to both pools at once and keeps whichever answers subscribe
+ * first. Each session has its own PdqStratumContext_t.
+ *
+ * The supervisor is driven by PdqPoolSupervisorProcess(), called whenever
+ * the pool descriptor is ready and at least once per second. NowMs is a
+ * monotonic millisecond clock, the same one the Stratum client uses for
+ * its receive timestamps.
+ */
+
+#ifndef PDQ_POOL_SUPERVISOR_H
+#define PDQ_POOL_SUPERVISOR_H
+
+#include "pdq_types.h"
+#include "stratum_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_POOL_BACKOFF_MIN_MS         1000
+#define PDQ_POOL_BACKOFF_MAX_MS         60000
+#define PDQ_POOL_MAX_CONSECUTIVE_FAIL   3       /* Switch to backup after 3 fails */
+#define PDQ_POOL_SILENCE_TIMEOUT_MS     120000  /* No RX for 2 min = dead pool */
+#define PDQ_POOL_PRIMARY_RECHECK_MS     300000  /* Try primary again after 5 min */
+
+/* Bits returned by PdqPoolSupervisorProcess() */
+#define PDQ_POOL_EVENT_READY            0x01    /* New session authorized */
+#define PDQ_POOL_EVENT_LOST             0x02    /* Active session went away */
+#define PDQ_POOL_EVENT_SWITCHED         0x04    /* Active pool changed */
+
+typedef enum {
+    PoolStatePrimaryConnected,
+    PoolStatePrimaryFailed,
+    PoolStateBackupConnected,
+    PoolStateBackupFailed,
+    PoolStateReconnecting
+} PdqPoolState_t;
+
+typedef struct {
+    uint32_t BackoffMinMs;
+    uint32_t BackoffMaxMs;
+    uint32_t SilenceTimeoutMs;
+    uint32_t PrimaryRecheckMs;
+    uint8_t  MaxConsecutiveFail;
+    bool     HotStandby;            /* Keep the backup session up in parallel */
+    bool     RacePools;             /* Connect to both pools at startup, keep the fastest */
+} PdqPoolSupervisorConfig_t;
+
+/* Connection state of one pool */
+typedef struct {
+    PdqStratumContext_t* p_Ctx;
+    int                  LastStratumState;
+    bool                 Connecting;        /* Attempt in flight */
+    bool                 SessionUp;         /* Reached authorized */
+    uint8_t              FailCount;
+    uint32_t             BackoffMs;
+    uint64_t             RetryAtMs;
+    uint64_t             UpSinceMs;
+} PdqPoolSession_t;
+
+typedef struct {
+    PdqPoolConfig_t           Pools[2];     /* [0] primary, [1] backup */
+    bool                      HasBackup;
+    char                      Worker[PDQ_MAX_WALLET_LEN + 1 + PDQ_MAX_WORKER_LEN + 1];
+    double                    Difficulty;   /* Suggested to each new session */
+    PdqPoolSupervisorConfig_t Tuning;
+
+    PdqStratumContext_t       Contexts[2];
+    PdqPoolSession_t          Sessions[2];
+
+    PdqPoolState_t            State;
+    uint8_t                   ActivePool;
+    bool                      ProbingPrimary;
+    bool                      Racing;       /* Startup race still undecided */
+    uint64_t                  OnBackupSinceMs;
+    uint32_t                  Rng;
+
+    /* Hot standby: latest job of the standby session, ready to mine */
+    PdqMiningJob_t            StandbyJob;
+    bool                      HasStandbyJob;
+    bool                      HasSwitchJob; /* StandbyJob now belongs to the active pool */
+
+    /* Pool the miners last went READY on, and whether the latest READY
+     * resumed that very session */
+    uint8_t                   ReadyPool;
+    bool                      SessionKept;
+
+    uint32_t                  Reconnects;
+    uint32_t                  Failovers;
+} PdqPoolSupervisor_t;
+
+void           PdqPoolSupervisorDefaults(PdqPoolSupervisorConfig_t* p_Tuning);
+PdqError_t     PdqPoolSupervisorInit(PdqPoolSupervisor_t* p_Sup,
+                                     const PdqDeviceConfig_t* p_Config,
+                                     double Difficulty,
+                                     const PdqPoolSupervisorConfig_t* p_Tuning);
+PdqError_t     PdqPoolSupervisorStart(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs);
+
+/* Start with pool Index already connected: its context holds a session
+ * restored after a binary upgrade (PdqStratumCtxRestoreState). The first
+ * Process reports it READY; a hot standby is dialled as usual. */
+PdqError_t     PdqPoolSupervisorResume(PdqPoolSupervisor_t* p_Sup, uint8_t Index, uint64_t NowMs);
+uint32_t       PdqPoolSupervisorProcess(PdqPoolSupervisor_t* p_Sup, uint64_t NowMs);
+void           PdqPoolSupervisorStop(PdqPoolSupervisor_t* p_Sup);
+PdqPoolState_t PdqPoolSupervisorGetState(const PdqPoolSupervisor_t* p_Sup);
+const PdqPoolConfig_t* PdqPoolSupervisorGetActivePool(const PdqPoolSupervisor_t* p_Sup);
+
+/* Context of the active pool: submit shares and take jobs from this one */
+PdqStratumContext_t*   PdqPoolSupervisorGetContext(PdqPoolSupervisor_t* p_Sup);
+
+/* Context driven for pool Index (0 primary, 1 backup), or NULL when that
+ * pool is not configured. Used to watch descriptors. */
+PdqStratumContext_t*   PdqPoolSupervisorGetSessionContext(PdqPoolSupervisor_t* p_Sup, uint8_t Index);
+
+/* Milliseconds until a session needs driving outside socket activity
+ * (a staggered connect attempt), or -1 when only descriptors matter */
+int                    PdqPoolSupervisorGetWakeupMs(PdqPoolSupervisor_t* p_Sup);
+
+/* Suggest a new share difficulty to every authorized session, and to the
+ * ones that come up later */
+void                   PdqPoolSupervisorSuggestDifficulty(PdqPoolSupervisor_t* p_Sup, double Difficulty);
+
+/* After a hot switch, hands out the job prebuilt on the new active pool
+ * so miners can start on it without waiting for a notify. */
+bool                   PdqPoolSupervisorTakeSwitchJob(PdqPoolSupervisor_t* p_Sup, PdqMiningJob_t* p_Job);
+
+/* After PDQ_POOL_EVENT_READY: true when the pool resumed the session the
+ * miners were already working for (same pool, same extranonce1), so shares
+ * queued across the outage are still valid and can be submitted. */
+bool                   PdqPoolSupervisorSessionKept(const PdqPoolSupervisor_t* p_Sup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,9 @@
 
 #include "stratum_client.h"
 #include "core/sha256_engine.h"
+#include "core/target.h"
+#include "stratum_json.h"
+#include "sv2_proto.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,59 +18,98 @@
 #ifdef ESP32
 #include <lwip/sockets.h>
 #include <lwip/netdb.h>
+#include <sys/poll.h>
 #include <errno.h>
+#include "esp_timer.h"
 #else
 #include <sys/socket.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#endif
+
+/* Name resolution runs on a helper thread on hosts that have pthreads,
+ * so a slow DNS server never blocks the caller. lwIP resolves inline. */
+#if defined(PDQ_LINUX)
+#include <pthread.h>
+#define PDQ_STRATUM_ASYNC_RESOLVE 1
+#else
+#define PDQ_STRATUM_ASYNC_RESOLVE 0
 #endif
 
 #define JSON_ID_SUBSCRIBE       1
 #define JSON_ID_AUTHORIZE       2
 #define JSON_ID_SUGGEST_DIFF    3
+#define JSON_ID_EXTRANONCE_SUB  4
 #define JSON_ID_SUBMIT_BASE     100
 
+/* A pool that resets the connection must not kill the process */
+#ifdef MSG_NOSIGNAL
+#define PDQ_SEND_FLAGS          MSG_NOSIGNAL
+#else
+#define PDQ_SEND_FLAGS          0
+#endif
+
 typedef struct {
-    PdqStratumState_t State;
-    int               Socket;
-    char              RecvBuffer[PDQ_STRATUM_RECV_BUFFER_SIZE];
-    uint16_t          RecvLen;
-    char              SendBuffer[PDQ_STRATUM_SEND_BUFFER_SIZE];
-    uint8_t           Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
-    uint8_t           Extranonce1Len;
-    uint32_t          Extranonce2Size;
-    double            Difficulty;
-    uint32_t          SubmitId;
-    PdqStratumJob_t   CurrentJob;
-    bool              HasNewJob;
-    char              Worker[PDQ_MAX_WORKER_LEN + 1];
-    char              Password[PDQ_MAX_PASSWORD_LEN + 1];
-} StratumContext_t;
-
-static StratumContext_t s_Ctx;
-
-static int32_t HexCharToNibble(char c)
-{
-    if (c >= '0' && c <= '9') return c - '0';
-    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-    return -1;
-}
-
-static int32_t HexToBytes(const char* p_Hex, uint8_t* p_Out, size_t MaxLen)
-{
-    if (p_Hex == NULL || p_Out == NULL) return -1;
-    size_t HexLen = strlen(p_Hex);
-    if (HexLen % 2 != 0 || HexLen / 2 > MaxLen) return -1;
-    
-    for (size_t i = 0; i < HexLen / 2; i++) {
-        int32_t Hi = HexCharToNibble(p_Hex[i * 2]);
-        int32_t Lo = HexCharToNibble(p_Hex[i * 2 + 1]);
-        if (Hi < 0 || Lo < 0) return -1;
-        p_Out[i] = (uint8_t)((Hi << 4) | Lo);
-    }
-    return (int32_t)(HexLen / 2);
+    struct sockaddr_storage Addr;
+    socklen_t               Len;
+} PoolAddr_t;
+
+typedef struct PdqStratumResolve {
+    char             Host[PDQ_MAX_HOST_LEN + 1];
+    char             Port[8];
+    struct addrinfo* p_Result;
+    int              Error;
+    int              Done;
+    int              Refs;      /* Owner + resolver thread */
+    int              Pipe[2];   /* Resolver writes one byte when done */
+
+    /* Connection race, only touched by the owner */
+    PoolAddr_t       Addrs[PDQ_STRATUM_MAX_ADDRS];
+    uint8_t          AddrCount;
+    uint8_t          NextAddr;
+    int              Attempts[PDQ_STRATUM_MAX_ADDRS];  /* Socket per address, -1 if none */
+    uint64_t         NextAttemptMs;
+} ResolveRequest_t;
+
+/* Resolved pool addresses. getaddrinfo() does not report record TTLs, so
+ * entries live for a fixed PDQ_STRATUM_DNS_CACHE_TTL_MS, and an entry
+ * whose addresses all refused a connect is dropped straight away. Only
+ * used from the thread that drives the contexts. */
+typedef struct {
+    char       Host[PDQ_MAX_HOST_LEN + 1];
+    char       Port[8];
+    PoolAddr_t Addrs[PDQ_STRATUM_MAX_ADDRS];
+    uint8_t    AddrCount;
+    uint64_t   ExpiresMs;
+} DnsCacheEntry_t;
+
+static DnsCacheEntry_t s_DnsCache[PDQ_STRATUM_DNS_CACHE_SIZE];
+
+/* Context behind the single-session API kept for existing callers */
+static PdqStratumContext_t s_DefaultCtx;
+
+static uint64_t GetMillis(void)
+{
+#ifdef ESP32
+    return (uint64_t)(esp_timer_get_time() / 1000);
+#else
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000 + (uint64_t)Ts.tv_nsec / 1000000;
+#endif
+}
+
+static void EnterState(PdqStratumContext_t* p_Ctx, PdqStratumState_t State)
+{
+    p_Ctx->State = State;
+    p_Ctx->StageStartMs = GetMillis();
 }
 
 static void BytesToHex(const uint8_t* p_In, size_t Len, char* p_Out)
@@ -112,429 +154,1007 @@ static int32_t JsonEscapeString(const char* p_In, char* p_Out, size_t MaxLen)
     return (int32_t)j;
 }
 
-static PdqError_t SendJson(const char* p_Json)
+/* Write as much of the outbound queue as the socket takes. The ring
+ * wraps at most once, so one sendmsg() with two segments covers it. */
+static PdqError_t FlushTx(PdqStratumContext_t* p_Ctx)
+{
+    if (p_Ctx->Socket < 0) return PdqErrorNotConnected;
+
+    while (p_Ctx->TxLen > 0) {
+        size_t First = PDQ_STRATUM_TX_BUFFER_SIZE - p_Ctx->TxHead;
+        if (First > p_Ctx->TxLen) First = p_Ctx->TxLen;
+
+        struct iovec Iov[2];
+        Iov[0].iov_base = p_Ctx->TxRing + p_Ctx->TxHead;
+        Iov[0].iov_len = First;
+        Iov[1].iov_base = p_Ctx->TxRing;
+        Iov[1].iov_len = p_Ctx->TxLen - First;
+
+        struct msghdr Msg;
+        memset(&Msg, 0, sizeof(Msg));
+        Msg.msg_iov = Iov;
+        Msg.msg_iovlen = (Iov[1].iov_len > 0) ? 2 : 1;
+
+        ssize_t Sent = sendmsg(p_Ctx->Socket, &Msg, PDQ_SEND_FLAGS);
+        if (Sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                p_Ctx->TxStats.PartialWrites++;
+                return PdqOk;
+            }
+            PdqStratumCtxDisconnect(p_Ctx);
+            return PdqErrorNotConnected;
+        }
+
+        p_Ctx->TxStats.Writes++;
+        p_Ctx->TxStats.Bytes += (uint64_t)Sent;
+        p_Ctx->TxHead = (uint16_t)((p_Ctx->TxHead + (size_t)Sent) % PDQ_STRATUM_TX_BUFFER_SIZE);
+        p_Ctx->TxLen -= (uint16_t)Sent;
+        if (p_Ctx->TxLen > 0) {
+            /* Send buffer is full; the rest waits for writability */
+            p_Ctx->TxStats.PartialWrites++;
+            break;
+        }
+    }
+
+    if (p_Ctx->TxLen == 0) p_Ctx->TxHead = 0;
+    return PdqOk;
+}
+
+static void TxPut(PdqStratumContext_t* p_Ctx, const char* p_Data, size_t Len)
+{
+    size_t Tail = (p_Ctx->TxHead + p_Ctx->TxLen) % PDQ_STRATUM_TX_BUFFER_SIZE;
+    size_t First = PDQ_STRATUM_TX_BUFFER_SIZE - Tail;
+    if (First > Len) First = Len;
+    memcpy(p_Ctx->TxRing + Tail, p_Data, First);
+    memcpy(p_Ctx->TxRing, p_Data + First, Len - First);
+    p_Ctx->TxLen += (uint16_t)Len;
+}
+
+static PdqError_t SendJson(PdqStratumContext_t* p_Ctx, const char* p_Json)
 {
-    if (s_Ctx.Socket < 0) return PdqErrorNotConnected;
+    if (p_Ctx->Socket < 0) return PdqErrorNotConnected;
 
     printf("[STRATUM] TX: %s\n", p_Json);
 
+    /* A full queue gets one chance to drain, corked or not */
     size_t Len = strlen(p_Json);
-    ssize_t Sent = send(s_Ctx.Socket, p_Json, Len, 0);
-    if (Sent != (ssize_t)Len) {
-        PdqStratumDisconnect();
-        return PdqErrorNotConnected;
+    if (Len + 1 > (size_t)(PDQ_STRATUM_TX_BUFFER_SIZE - p_Ctx->TxLen)) {
+        if (FlushTx(p_Ctx) != PdqOk) return PdqErrorNotConnected;
+        if (Len + 1 > (size_t)(PDQ_STRATUM_TX_BUFFER_SIZE - p_Ctx->TxLen)) {
+            printf("[STRATUM] WARN: send queue full (%u bytes), message dropped\n", p_Ctx->TxLen);
+            p_Ctx->TxStats.Overflows++;
+            return PdqErrorBufferTooSmall;
+        }
     }
 
-    Sent = send(s_Ctx.Socket, "\n", 1, 0);
-    if (Sent != 1) {
-        PdqStratumDisconnect();
-        return PdqErrorNotConnected;
+    TxPut(p_Ctx, p_Json, Len);
+    TxPut(p_Ctx, "\n", 1);
+    if (p_Ctx->p_OnLine != NULL) p_Ctx->p_OnLine(p_Ctx->p_OnLineArg, true, p_Json, Len);
+    p_Ctx->TxStats.Messages++;
+    if (p_Ctx->TxLen > p_Ctx->TxStats.QueuedPeak) p_Ctx->TxStats.QueuedPeak = p_Ctx->TxLen;
+
+    if (p_Ctx->TxCorked) return PdqOk;
+    return FlushTx(p_Ctx);
+}
+
+static void ClearJobHistory(PdqStratumContext_t* p_Ctx)
+{
+    p_Ctx->JobHistoryCount = 0;
+    p_Ctx->JobHistoryNext = 0;
+}
+
+static void PushJobHistory(PdqStratumContext_t* p_Ctx, const char* p_JobId)
+{
+    if (PdqStratumCtxIsJobActive(p_Ctx, p_JobId)) return;
+    snprintf(p_Ctx->JobHistory[p_Ctx->JobHistoryNext], sizeof(p_Ctx->JobHistory[0]), "%s", p_JobId);
+    p_Ctx->JobHistoryNext = (uint8_t)((p_Ctx->JobHistoryNext + 1) % PDQ_STRATUM_JOB_HISTORY);
+    if (p_Ctx->JobHistoryCount < PDQ_STRATUM_JOB_HISTORY) p_Ctx->JobHistoryCount++;
+}
+
+/* Subscription id to offer on the next subscribe. Taken from the
+ * mining.notify subscription, else the first one listed; only plain
+ * alphanumeric ids are kept since they are echoed back unescaped. */
+static void StoreSessionId(PdqStratumContext_t* p_Ctx, const PdqJsonDoc_t* p_Doc, int Subscriptions)
+{
+    int Id = -1;
+    if (PdqJsonTypeOf(p_Doc, PdqJsonArrayGet(p_Doc, Subscriptions, 0)) == PdqJsonString) {
+        Id = PdqJsonArrayGet(p_Doc, Subscriptions, 1);  /* A single flat pair */
+    } else if (PdqJsonTypeOf(p_Doc, Subscriptions) == PdqJsonArray) {
+        for (uint16_t i = 0; i < p_Doc->p_Tokens[Subscriptions].Size; i++) {
+            int Pair = PdqJsonArrayGet(p_Doc, Subscriptions, i);
+            if (Id < 0 || PdqJsonEquals(p_Doc, PdqJsonArrayGet(p_Doc, Pair, 0), "mining.notify")) {
+                Id = PdqJsonArrayGet(p_Doc, Pair, 1);
+            }
+        }
+    }
+
+    char SessionId[PDQ_STRATUM_MAX_SESSION_ID_LEN + 1];
+    int32_t Len = PdqJsonGetString(p_Doc, Id, SessionId, sizeof(SessionId));
+    for (int32_t i = 0; i < Len; i++) {
+        char c = SessionId[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) Len = 0;
+    }
+    if (Len > 0) {
+        memcpy(p_Ctx->SessionId, SessionId, (size_t)Len + 1);
+    } else {
+        p_Ctx->SessionId[0] = '\0';
+    }
+}
+
+/* result: [[subscriptions...], "extranonce1", extranonce2_size]. A pool
+ * that honours the session id we offered hands back the same extranonce1,
+ * which is how a resumed session is recognised. */
+static PdqError_t HandleSubscribeResult(PdqStratumContext_t* p_Ctx, const PdqJsonDoc_t* p_Doc)
+{
+    int Result = PdqJsonObjectGet(p_Doc, 0, "result");
+    int Extranonce1 = PdqJsonArrayGet(p_Doc, Result, 1);
+    uint8_t NewExtranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    int32_t ByteLen = PdqJsonGetHex(p_Doc, Extranonce1, NewExtranonce1, PDQ_STRATUM_MAX_EXTRANONCE_LEN);
+    if (ByteLen < 0) return PdqErrorInvalidJob;
+
+    uint32_t Extranonce2Size = p_Ctx->Extranonce2Size;
+    int64_t En2 = 0;
+    if (PdqJsonGetInt(p_Doc, PdqJsonArrayGet(p_Doc, Result, 2), &En2)) {
+        if (En2 < 0) En2 = 0;
+        if (En2 > PDQ_STRATUM_MAX_EXTRANONCE_LEN) En2 = PDQ_STRATUM_MAX_EXTRANONCE_LEN;
+        Extranonce2Size = (uint32_t)En2;
     }
 
+    p_Ctx->Resumed = p_Ctx->SessionOffered && ByteLen > 0 &&
+                     ByteLen == p_Ctx->Extranonce1Len &&
+                     memcmp(NewExtranonce1, p_Ctx->Extranonce1, (size_t)ByteLen) == 0 &&
+                     Extranonce2Size == p_Ctx->Extranonce2Size &&
+                     p_Ctx->CurrentJob.JobId[0] != '\0' &&
+                     GetMillis() - p_Ctx->JobRxMs <= PDQ_STRATUM_RESUME_MAX_AGE_MS;
+
+    /* A new session starts with none of the old jobs */
+    if (!p_Ctx->Resumed) {
+        ClearJobHistory(p_Ctx);
+        p_Ctx->ExtranonceGen++;
+    }
+    memcpy(p_Ctx->Extranonce1, NewExtranonce1, (size_t)ByteLen);
+    p_Ctx->Extranonce1Len = (uint8_t)ByteLen;
+    p_Ctx->Extranonce2Size = Extranonce2Size;
+    StoreSessionId(p_Ctx, p_Doc, PdqJsonArrayGet(p_Doc, Result, 0));
+
+    EnterState(p_Ctx, StratumStateSubscribed);
+    printf("[STRATUM] Extranonce1(%d bytes): ", p_Ctx->Extranonce1Len);
+    for (int i = 0; i < p_Ctx->Extranonce1Len; i++) printf("%02x", p_Ctx->Extranonce1[i]);
+    printf(" | Extranonce2Size: %u%s\n", (unsigned)p_Ctx->Extranonce2Size,
+           p_Ctx->Resumed ? " | session resumed" : "");
     return PdqOk;
 }
 
-static char* FindJsonString(const char* p_Json, const char* p_Key, char* p_Out, size_t MaxLen)
-{
-    char Pattern[64];
-    snprintf(Pattern, sizeof(Pattern), "\"%s\"", p_Key);
-    char* p_Start = strstr(p_Json, Pattern);
-    if (p_Start == NULL) return NULL;
-    
-    p_Start = strchr(p_Start + strlen(Pattern), ':');
-    if (p_Start == NULL) return NULL;
-    
-    while (*p_Start == ' ' || *p_Start == ':') p_Start++;
-    
-    if (*p_Start == '"') {
-        p_Start++;
-        char* p_End = strchr(p_Start, '"');
-        if (p_End == NULL) return NULL;
-        size_t Len = (size_t)(p_End - p_Start);
-        if (Len >= MaxLen) Len = MaxLen - 1;
-        memcpy(p_Out, p_Start, Len);
-        p_Out[Len] = '\0';
-        return p_Out;
+static PdqError_t HandleAuthorizeResult(PdqStratumContext_t* p_Ctx, const PdqJsonDoc_t* p_Doc)
+{
+    if (PdqJsonTypeOf(p_Doc, PdqJsonObjectGet(p_Doc, 0, "result")) == PdqJsonTrue) {
+        EnterState(p_Ctx, StratumStateAuthorized);
+
+        /* Resumed session: the cached job is still the pool's, so mining
+         * continues on it without waiting for the next notify */
+        if (p_Ctx->Resumed) {
+            p_Ctx->Resumes++;
+            p_Ctx->HasNewJob = true;
+            EnterState(p_Ctx, StratumStateReady);
+            printf("[STRATUM] Session resumed, continuing job %s\n", p_Ctx->CurrentJob.JobId);
+        }
+
+        /* Ask to be told about extranonce1 reassignments instead of
+         * having every share rejected after one. Pools that do not know
+         * the method answer with an error, which is harmless. */
+        snprintf(p_Ctx->SendBuffer, sizeof(p_Ctx->SendBuffer),
+                 "{\"id\":%d,\"method\":\"mining.extranonce.subscribe\",\"params\":[]}",
+                 JSON_ID_EXTRANONCE_SUB);
+        SendJson(p_Ctx, p_Ctx->SendBuffer);
+        return PdqOk;
     }
-    return NULL;
+    return PdqErrorAuthFailed;
 }
 
-static int32_t FindJsonInt(const char* p_Json, const char* p_Key)
+static PdqError_t HandleExtranonceSubscribeResult(PdqStratumContext_t* p_Ctx, const PdqJsonDoc_t* p_Doc)
 {
-    char Pattern[64];
-    snprintf(Pattern, sizeof(Pattern), "\"%s\"", p_Key);
-    char* p_Start = strstr(p_Json, Pattern);
-    if (p_Start == NULL) return -1;
-    
-    p_Start = strchr(p_Start + strlen(Pattern), ':');
-    if (p_Start == NULL) return -1;
-    
-    while (*p_Start == ' ' || *p_Start == ':') p_Start++;
-    char* p_End = NULL;
-    long Val = strtol(p_Start, &p_End, 10);
-    if (p_End == p_Start) return -1;  /* No digits parsed */
-    if (Val < INT32_MIN) return INT32_MIN;
-    if (Val > INT32_MAX) return INT32_MAX;
-    return (int32_t)Val;
+    p_Ctx->ExtranonceSubscribed =
+        PdqJsonTypeOf(p_Doc, PdqJsonObjectGet(p_Doc, 0, "result")) == PdqJsonTrue;
+    printf("[STRATUM] extranonce.subscribe %s\n",
+           p_Ctx->ExtranonceSubscribed ? "accepted" : "not supported by pool");
+    return PdqOk;
 }
 
-static bool FindJsonBool(const char* p_Json, const char* p_Key)
+/* params: [extranonce1, extranonce2_size]. Both take effect together for
+ * the next job built; the current job is re-issued as a clean job so the
+ * miner drops work hashed with the old coinbase. Its id stays active, so
+ * shares still in flight from the old coinbase are told apart by the
+ * extranonce generation instead. */
+static PdqError_t HandleSetExtranonce(PdqStratumContext_t* p_Ctx, const PdqJsonDoc_t* p_Doc, int Params)
 {
-    char Pattern[64];
-    snprintf(Pattern, sizeof(Pattern), "\"%s\"", p_Key);
-    char* p_Start = strstr(p_Json, Pattern);
-    if (p_Start == NULL) return false;
+    uint8_t Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    int32_t ByteLen = PdqJsonGetHex(p_Doc, PdqJsonArrayGet(p_Doc, Params, 0),
+                                    Extranonce1, PDQ_STRATUM_MAX_EXTRANONCE_LEN);
+    int64_t En2 = (int64_t)p_Ctx->Extranonce2Size;
+    int En2Token = PdqJsonArrayGet(p_Doc, Params, 1);
+    if (ByteLen < 0 ||
+        (En2Token >= 0 && (!PdqJsonGetInt(p_Doc, En2Token, &En2) ||
+                           En2 < 1 || En2 > PDQ_STRATUM_MAX_EXTRANONCE_LEN))) {
+        printf("[STRATUM] WARN: malformed mining.set_extranonce ignored\n");
+        return PdqErrorInvalidJob;
+    }
 
-    p_Start = strchr(p_Start + strlen(Pattern), ':');
-    if (p_Start == NULL) return false;
+    memcpy(p_Ctx->Extranonce1, Extranonce1, (size_t)ByteLen);
+    p_Ctx->Extranonce1Len = (uint8_t)ByteLen;
+    p_Ctx->Extranonce2Size = (uint32_t)En2;
+    p_Ctx->Extranonce2Next = 0;
+    p_Ctx->ExtranonceUpdates++;
+    p_Ctx->ExtranonceGen++;
+
+    printf("[STRATUM] New extranonce1(%d bytes): ", p_Ctx->Extranonce1Len);
+    for (int i = 0; i < p_Ctx->Extranonce1Len; i++) printf("%02x", p_Ctx->Extranonce1[i]);
+    printf(" | Extranonce2Size: %u\n", (unsigned)p_Ctx->Extranonce2Size);
+
+    /* Older jobs were only ever built on the old extranonce1 */
+    ClearJobHistory(p_Ctx);
+    if (p_Ctx->CurrentJob.JobId[0] != '\0') {
+        PushJobHistory(p_Ctx, p_Ctx->CurrentJob.JobId);
+        p_Ctx->CurrentJob.CleanJobs = true;
+        p_Ctx->HasNewJob = true;
+    }
+    return PdqOk;
+}
 
-    while (*p_Start == ' ' || *p_Start == ':') p_Start++;
-    return (strncmp(p_Start, "true", 4) == 0);
+static void CountRejectCode(PdqStratumSubmitStats_t* p_Stats, int32_t Code)
+{
+    for (int i = 0; i < PDQ_STRATUM_MAX_REJECT_CODES; i++) {
+        if (p_Stats->RejectCounts[i] == 0) p_Stats->RejectCodes[i] = Code;
+        if (p_Stats->RejectCodes[i] == Code) {
+            p_Stats->RejectCounts[i]++;
+            return;
+        }
+    }
+    p_Stats->RejectOther++;
 }
 
-static PdqError_t HandleSubscribeResult(const char* p_Json)
+/* Retire a pending submit: count it, then tell the owner */
+static void FinishSubmit(PdqStratumContext_t* p_Ctx, PdqStratumPendingSubmit_t* p_Entry,
+                         PdqSubmitResult_t Result, int32_t Code, uint64_t NowMs)
 {
-    char Extranonce1[17] = {0};
+    PdqStratumSubmitStats_t* p_Stats = &p_Ctx->SubmitStats;
+    uint32_t LatencyMs = (NowMs > p_Entry->SentMs) ? (uint32_t)(NowMs - p_Entry->SentMs) : 0;
+    p_Entry->Id = 0;
 
-    char* p_Result = strstr(p_Json, "\"result\"");
-    if (p_Result == NULL) return PdqErrorInvalidJob;
+    if (Result == PdqSubmitTimedOut) {
+        p_Stats->TimedOut++;
+    } else {
+        if (Result == PdqSubmitAccepted) {
+            p_Stats->Accepted++;
+        } else {
+            p_Stats->Rejected++;
+            CountRejectCode(p_Stats, Code);
+        }
+        p_Stats->LatencyHist[PdqSubmitLatencyBucket(LatencyMs)]++;
+        p_Stats->LatencySumMs += LatencyMs;
+        if (LatencyMs > p_Stats->LatencyMaxMs) p_Stats->LatencyMaxMs = LatencyMs;
+    }
 
-    char* p_Arr = strchr(p_Result, '[');
-    if (p_Arr == NULL) return PdqErrorInvalidJob;
+    if (p_Ctx->p_OnSubmit) p_Ctx->p_OnSubmit(p_Ctx->p_OnSubmitArg, Result, Code, LatencyMs);
+}
 
-    p_Arr = strchr(p_Arr + 1, '[');
-    if (p_Arr) {
-        char* p_End = strchr(p_Arr, ']');
-        if (p_End) {
-            p_Arr = p_End + 1;
+static void TrackSubmit(PdqStratumContext_t* p_Ctx, uint32_t Id)
+{
+    PdqStratumPendingSubmit_t* p_Slot = NULL;
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        PdqStratumPendingSubmit_t* p_Entry = &p_Ctx->Pending[i];
+        if (p_Entry->Id == 0) {
+            p_Slot = p_Entry;
+            break;
         }
+        if (p_Slot == NULL || p_Entry->SentMs < p_Slot->SentMs) p_Slot = p_Entry;
     }
 
-    char* p_Quote = strchr(p_Arr, '"');
-    if (p_Quote == NULL) return PdqErrorInvalidJob;
-    p_Quote++;
-    char* p_EndQuote = strchr(p_Quote, '"');
-    if (p_EndQuote == NULL) return PdqErrorInvalidJob;
+    /* Table full: the oldest entry is the least likely to be answered */
+    uint64_t Now = GetMillis();
+    if (p_Slot->Id != 0) FinishSubmit(p_Ctx, p_Slot, PdqSubmitTimedOut, 0, Now);
 
-    size_t Len = (size_t)(p_EndQuote - p_Quote);
-    if (Len > 16) Len = 16;
-    memcpy(Extranonce1, p_Quote, Len);
+    p_Slot->Id = Id;
+    p_Slot->SentMs = Now;
+    p_Ctx->SubmitStats.Submitted++;
+}
 
-    int32_t ByteLen = HexToBytes(Extranonce1, s_Ctx.Extranonce1, PDQ_STRATUM_MAX_EXTRANONCE_LEN);
-    if (ByteLen < 0) return PdqErrorInvalidJob;
-    s_Ctx.Extranonce1Len = (uint8_t)ByteLen;
-
-    p_Quote = strchr(p_EndQuote + 1, ',');
-    if (p_Quote) {
-        while (*p_Quote == ',' || *p_Quote == ' ') p_Quote++;
-        char* p_NumEnd = NULL;
-        long En2 = strtol(p_Quote, &p_NumEnd, 10);
-        if (p_NumEnd == p_Quote || En2 < 0) En2 = 0;
-        s_Ctx.Extranonce2Size = (uint32_t)En2;
-        if (s_Ctx.Extranonce2Size > PDQ_STRATUM_MAX_EXTRANONCE_LEN) {
-            s_Ctx.Extranonce2Size = PDQ_STRATUM_MAX_EXTRANONCE_LEN;
-        }
+static void ExpireSubmits(PdqStratumContext_t* p_Ctx, bool All)
+{
+    uint64_t Now = GetMillis();
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        PdqStratumPendingSubmit_t* p_Entry = &p_Ctx->Pending[i];
+        if (p_Entry->Id == 0) continue;
+        if (!All && Now - p_Entry->SentMs < p_Ctx->SubmitTimeoutMs) continue;
+        printf("[STRATUM] No reply to submit %u after %lu ms\n",
+               (unsigned)p_Entry->Id, (unsigned long)(Now - p_Entry->SentMs));
+        FinishSubmit(p_Ctx, p_Entry, PdqSubmitTimedOut, 0, Now);
     }
-
-    s_Ctx.State = StratumStateSubscribed;
-    printf("[STRATUM] Extranonce1(%d bytes): ", s_Ctx.Extranonce1Len);
-    for (int i = 0; i < s_Ctx.Extranonce1Len; i++) printf("%02x", s_Ctx.Extranonce1[i]);
-    printf(" | Extranonce2Size: %u\n", (unsigned)s_Ctx.Extranonce2Size);
-    return PdqOk;
 }
 
-static PdqError_t HandleAuthorizeResult(const char* p_Json)
+/* Submit replies carry "result":true, or an error array [code, "msg", ...] */
+static PdqError_t HandleSubmitResult(PdqStratumContext_t* p_Ctx, uint32_t Id, const PdqJsonDoc_t* p_Doc)
 {
-    if (strstr(p_Json, "\"result\":true") || strstr(p_Json, "\"result\": true")) {
-        s_Ctx.State = StratumStateAuthorized;
+    PdqStratumPendingSubmit_t* p_Entry = NULL;
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS && p_Entry == NULL; i++) {
+        if (p_Ctx->Pending[i].Id == Id) p_Entry = &p_Ctx->Pending[i];
+    }
+    if (p_Entry == NULL) {
+        p_Ctx->SubmitStats.Unmatched++;
+        printf("[STRATUM] Reply to unknown submit %u\n", (unsigned)Id);
         return PdqOk;
     }
-    return PdqErrorAuthFailed;
+
+    uint64_t Now = GetMillis();
+    if (PdqJsonTypeOf(p_Doc, PdqJsonObjectGet(p_Doc, 0, "result")) == PdqJsonTrue) {
+        printf("[STRATUM] Share accepted (%lu ms)\n", (unsigned long)(Now - p_Entry->SentMs));
+        FinishSubmit(p_Ctx, p_Entry, PdqSubmitAccepted, 0, Now);
+        return PdqOk;
+    }
+
+    int64_t Code = 0;
+    char Reason[64] = "no reason given";
+    int Error = PdqJsonObjectGet(p_Doc, 0, "error");
+    PdqJsonGetInt(p_Doc, PdqJsonArrayGet(p_Doc, Error, 0), &Code);
+    PdqJsonGetString(p_Doc, PdqJsonArrayGet(p_Doc, Error, 1), Reason, sizeof(Reason));
+
+    printf("[STRATUM] Share rejected (%d: %s) after %lu ms\n", (int)Code, Reason,
+           (unsigned long)(Now - p_Entry->SentMs));
+    FinishSubmit(p_Ctx, p_Entry, PdqSubmitRejected, (int32_t)Code, Now);
+    return PdqOk;
 }
 
-static PdqError_t HandleSetDifficulty(const char* p_Json)
+static PdqError_t HandleSetDifficulty(PdqStratumContext_t* p_Ctx, const PdqJsonDoc_t* p_Doc, int Params)
 {
-    char* p_Params = strstr(p_Json, "\"params\"");
-    if (p_Params == NULL) return PdqErrorInvalidJob;
-
-    char* p_Arr = strchr(p_Params, '[');
-    if (p_Arr == NULL) return PdqErrorInvalidJob;
+    double Diff = 0.0;
+    if (!PdqJsonGetDouble(p_Doc, PdqJsonArrayGet(p_Doc, Params, 0), &Diff)) return PdqErrorInvalidJob;
 
-    double Diff = strtod(p_Arr + 1, NULL);
     printf("[STRATUM] Pool requested difficulty: %f\n", Diff);
     /* Enforce minimum difficulty of 1.0 to avoid "Difficulty too low" rejections.
      * Some pools (e.g. public-pool.io) send set_difficulty below their actual
      * acceptance threshold. */
-    if (Diff < 1.0) Diff = 1.0;
-    s_Ctx.Difficulty = Diff > 0.0 ? Diff : 1.0;
-    printf("[STRATUM] Using difficulty: %f\n", s_Ctx.Difficulty);
+    if (Diff < PDQ_STRATUM_MIN_DIFFICULTY) Diff = PDQ_STRATUM_MIN_DIFFICULTY;
+    p_Ctx->Difficulty = Diff;
+    printf("[STRATUM] Using difficulty: %f\n", p_Ctx->Difficulty);
     return PdqOk;
 }
 
-static PdqError_t HandleNotify(const char* p_Json)
-{
-    char* p_Params = strstr(p_Json, "\"params\"");
-    if (p_Params == NULL) return PdqErrorInvalidJob;
-
-    char* p_Arr = strchr(p_Params, '[');
-    if (p_Arr == NULL) return PdqErrorInvalidJob;
-
-    char Buffer[256];
-    char* p = p_Arr + 1;
-    int Field = 0;
-
-    static PdqStratumJob_t Job;
-    memset(&Job, 0, sizeof(Job));
-
-    while (*p && Field < 9) {
-        while (*p == ' ' || *p == ',') p++;
-
-        if (*p == '"') {
-            p++;
-            char* p_End = strchr(p, '"');
-            if (p_End == NULL) break;
-            size_t Len = (size_t)(p_End - p);
-            if (Len >= sizeof(Buffer)) Len = sizeof(Buffer) - 1;
-            memcpy(Buffer, p, Len);
-            Buffer[Len] = '\0';
-
-            switch (Field) {
-                case 0:
-                    strncpy(Job.JobId, Buffer, PDQ_STRATUM_MAX_JOBID_LEN);
-                    Job.JobId[PDQ_STRATUM_MAX_JOBID_LEN] = '\0';
-                    break;
-                case 1:
-                    HexToBytes(Buffer, Job.PrevBlockHash, 32);
-                    /* Stratum prevhash: each 4-byte word is byte-reversed (LE).
-                     * Swap bytes within each word to get internal byte order
-                     * for the block header. (NOT a full 32-byte reverse.) */
-                    for (int w = 0; w < 8; w++) {
-                        uint32_t* pw = (uint32_t*)(Job.PrevBlockHash + w * 4);
-                        *pw = __builtin_bswap32(*pw);
-                    }
-                    break;
-                case 2: {
-                    int32_t Len = HexToBytes(Buffer, Job.Coinbase1, PDQ_STRATUM_MAX_COINBASE_LEN);
-                    Job.Coinbase1Len = (Len > 0) ? (uint16_t)Len : 0;
-                    break;
-                }
-                case 3: {
-                    int32_t Len = HexToBytes(Buffer, Job.Coinbase2, PDQ_STRATUM_MAX_COINBASE_LEN);
-                    Job.Coinbase2Len = (Len > 0) ? (uint16_t)Len : 0;
-                    break;
-                }
-                case 5:
-                    Job.Version = (uint32_t)strtoul(Buffer, NULL, 16);
-                    break;
-                case 6:
-                    Job.NBits = (uint32_t)strtoul(Buffer, NULL, 16);
-                    break;
-                case 7:
-                    Job.NTime = (uint32_t)strtoul(Buffer, NULL, 16);
-                    break;
-            }
-            p = p_End + 1;
-            Field++;
-        } else if (*p == '[') {
-            if (Field == 4) {
-                p++;
-                Job.MerkleBranchCount = 0;
-                while (*p && *p != ']' && Job.MerkleBranchCount < PDQ_STRATUM_MAX_MERKLE_BRANCHES) {
-                    while (*p == ' ' || *p == ',') p++;
-                    if (*p == '"') {
-                        p++;
-                        char* p_End = strchr(p, '"');
-                        if (p_End == NULL) break;
-                        size_t Len = (size_t)(p_End - p);
-                        if (Len == 64) {
-                            memcpy(Buffer, p, 64);
-                            Buffer[64] = '\0';
-                            HexToBytes(Buffer, Job.MerkleBranches[Job.MerkleBranchCount], 32);
-                            Job.MerkleBranchCount++;
-                        }
-                        p = p_End + 1;
-                    } else {
-                        p++;
-                    }
-                }
-                if (*p == ']') p++;
-                Field++;
-            } else {
-                p++;
-            }
-        } else if (strncmp(p, "true", 4) == 0 || strncmp(p, "false", 5) == 0) {
-            if (Field == 8) {
-                Job.CleanJobs = (strncmp(p, "true", 4) == 0);
-            }
-            p += (strncmp(p, "true", 4) == 0) ? 4 : 5;
-            Field++;
-        } else {
-            p++;
-        }
+static PdqError_t HandleNotify(PdqStratumContext_t* p_Ctx, const PdqJsonDoc_t* p_Doc, int Params)
+{
+    /* Decode into the spare arena so a bad notify leaves the current job
+     * alone; on success the two arenas swap roles. */
+    uint8_t Spare = p_Ctx->JobArenaActive ^ 1;
+    PdqStratumJob_t Job;
+    PdqError_t Result = PdqStratumDecodeNotify(p_Doc, Params, &p_Ctx->JobArena[Spare], &Job);
+    if (Result != PdqOk) {
+        printf("[STRATUM] WARN: %s mining.notify ignored\n",
+               Result == PdqErrorNoMemory ? "oversized" : "malformed");
+        return Result;
     }
 
-    memcpy(&s_Ctx.CurrentJob, &Job, sizeof(Job));
-    s_Ctx.HasNewJob = true;
-    if (s_Ctx.State == StratumStateAuthorized) {
-        s_Ctx.State = StratumStateReady;
+    /* Work on an older prevhash, or one the pool told us to drop, can
+     * only produce stale shares */
+    if (Job.CleanJobs || memcmp(Job.PrevBlockHash, p_Ctx->CurrentJob.PrevBlockHash, 32) != 0) {
+        ClearJobHistory(p_Ctx);
+    }
+    PushJobHistory(p_Ctx, Job.JobId);
+
+    p_Ctx->CurrentJob = Job;
+    p_Ctx->JobArenaActive = Spare;
+    p_Ctx->JobRxMs = GetMillis();
+    p_Ctx->HasNewJob = true;
+    if (p_Ctx->State == StratumStateAuthorized) {
+        EnterState(p_Ctx, StratumStateReady);
     }
 
     return PdqOk;
 }
 
-static PdqError_t ProcessLine(const char* p_Line)
+/* Allocate the token array on first use, then double it for lines that
+ * need more. A line of Len bytes never holds more than Len / 2 + 1
+ * tokens, so growth stops there. Returns false when it cannot grow. */
+static bool GrowTokens(PdqStratumContext_t* p_Ctx, size_t Len)
+{
+    size_t Limit = Len / 2 + 1;
+    if (Limit > UINT16_MAX) Limit = UINT16_MAX;
+
+    size_t Cap = PDQ_STRATUM_MAX_TOKENS;
+    if (p_Ctx->TokenCap != 0) {
+        if (p_Ctx->TokenCap >= Limit) return false;
+        Cap = (size_t)p_Ctx->TokenCap * 2;
+        if (Cap > Limit) Cap = Limit;
+    }
+
+    PdqJsonToken_t* p_Tokens = (PdqJsonToken_t*)realloc(p_Ctx->p_Tokens, Cap * sizeof(PdqJsonToken_t));
+    if (p_Tokens == NULL) return false;
+    p_Ctx->p_Tokens = p_Tokens;
+    p_Ctx->TokenCap = (uint16_t)Cap;
+    return true;
+}
+
+/* Tokenize once, then dispatch on the method name or the reply id */
+static PdqError_t ProcessLine(PdqStratumContext_t* p_Ctx, const char* p_Line, size_t Len)
 {
     printf("[STRATUM] RX: %s\n", p_Line);
-    if (strstr(p_Line, "\"method\"")) {
-        if (strstr(p_Line, "mining.set_difficulty")) {
+    p_Ctx->LastRxMs = GetMillis();
+    if (p_Ctx->p_OnLine != NULL) p_Ctx->p_OnLine(p_Ctx->p_OnLineArg, false, p_Line, Len);
+
+    PdqJsonDoc_t Doc;
+    PdqError_t Parsed = PdqErrorNoMemory;
+    if (p_Ctx->p_Tokens != NULL || GrowTokens(p_Ctx, Len)) {
+        Parsed = PdqJsonParse(&Doc, p_Line, Len, p_Ctx->p_Tokens, p_Ctx->TokenCap);
+    }
+    while (Parsed == PdqErrorBufferTooSmall && GrowTokens(p_Ctx, Len)) {
+        Parsed = PdqJsonParse(&Doc, p_Line, Len, p_Ctx->p_Tokens, p_Ctx->TokenCap);
+    }
+    if (Parsed != PdqOk || PdqJsonTypeOf(&Doc, 0) != PdqJsonObject) {
+        p_Ctx->RxMalformed++;
+        printf("[STRATUM] WARN: malformed message ignored\n");
+        return PdqErrorParse;
+    }
+
+    int Method = PdqJsonObjectGet(&Doc, 0, "method");
+    if (Method >= 0) {
+        int Params = PdqJsonObjectGet(&Doc, 0, "params");
+        if (PdqJsonEquals(&Doc, Method, "mining.set_difficulty")) {
             printf("[STRATUM] Got set_difficulty\n");
-            return HandleSetDifficulty(p_Line);
-        } else if (strstr(p_Line, "mining.notify")) {
+            return HandleSetDifficulty(p_Ctx, &Doc, Params);
+        } else if (PdqJsonEquals(&Doc, Method, "mining.notify")) {
             printf("[STRATUM] Got mining.notify!\n");
-            return HandleNotify(p_Line);
-        }
-    } else if (strstr(p_Line, "\"id\"")) {
-        int Id = FindJsonInt(p_Line, "id");
-        if (Id == JSON_ID_SUBSCRIBE) {
-            printf("[STRATUM] Got subscribe result\n");
-            return HandleSubscribeResult(p_Line);
-        } else if (Id == JSON_ID_AUTHORIZE) {
-            printf("[STRATUM] Got authorize result\n");
-            return HandleAuthorizeResult(p_Line);
+            return HandleNotify(p_Ctx, &Doc, Params);
+        } else if (PdqJsonEquals(&Doc, Method, "mining.set_extranonce")) {
+            return HandleSetExtranonce(p_Ctx, &Doc, Params);
         }
+        return PdqOk;
+    }
+
+    int64_t Id = 0;
+    if (!PdqJsonGetInt(&Doc, PdqJsonObjectGet(&Doc, 0, "id"), &Id)) return PdqOk;
+    if (Id == JSON_ID_SUBSCRIBE) {
+        printf("[STRATUM] Got subscribe result\n");
+        return HandleSubscribeResult(p_Ctx, &Doc);
+    } else if (Id == JSON_ID_AUTHORIZE) {
+        printf("[STRATUM] Got authorize result\n");
+        return HandleAuthorizeResult(p_Ctx, &Doc);
+    } else if (Id == JSON_ID_EXTRANONCE_SUB) {
+        return HandleExtranonceSubscribeResult(p_Ctx, &Doc);
+    } else if (Id > JSON_ID_SUBMIT_BASE && Id <= UINT32_MAX) {
+        return HandleSubmitResult(p_Ctx, (uint32_t)Id, &Doc);
     }
     return PdqOk;
 }
 
-// Public API functions for stratum client
+/* Allocate the receive buffer on first use, or double it while a line
+ * is still incomplete. Returns false once it is at its maximum. */
+static bool GrowRecvBuffer(PdqStratumContext_t* p_Ctx)
+{
+    uint32_t Size = PDQ_STRATUM_RECV_BUFFER_SIZE;
+    if (p_Ctx->RecvSize != 0) {
+        if (p_Ctx->RecvSize >= PDQ_STRATUM_RECV_BUFFER_MAX) return false;
+        Size = p_Ctx->RecvSize * 2;
+        if (Size > PDQ_STRATUM_RECV_BUFFER_MAX) Size = PDQ_STRATUM_RECV_BUFFER_MAX;
+    }
 
-PdqError_t PdqStratumInit(void)
+    char* p_Buffer = (char*)realloc(p_Ctx->p_RecvBuffer, Size);
+    if (p_Buffer == NULL) return false;
+    p_Ctx->p_RecvBuffer = p_Buffer;
+    p_Ctx->RecvSize = Size;
+    return true;
+}
+
+// Public API functions for stratum client contexts
+
+PdqError_t PdqStratumCtxInit(PdqStratumContext_t* p_Ctx)
 {
-    memset(&s_Ctx, 0, sizeof(s_Ctx));
-    s_Ctx.Socket = -1;
-    s_Ctx.State = StratumStateDisconnected;
-    s_Ctx.Difficulty = 1.0;
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    memset(p_Ctx, 0, sizeof(*p_Ctx));
+    p_Ctx->Socket = -1;
+    p_Ctx->State = StratumStateDisconnected;
+    p_Ctx->Difficulty = 1.0;
+    p_Ctx->SubmitTimeoutMs = PDQ_STRATUM_SUBMIT_TIMEOUT_MS;
     return PdqOk;
 }
 
-PdqError_t PdqStratumConnect(const char* p_Host, uint16_t Port)
+void PdqStratumCtxRelease(PdqStratumContext_t* p_Ctx)
 {
-    if (p_Host == NULL || Port == 0) return PdqErrorInvalidParam;
-    if (s_Ctx.Socket >= 0) PdqStratumDisconnect();
+    if (p_Ctx == NULL) return;
+    PdqStratumCtxDisconnect(p_Ctx);
+    free(p_Ctx->p_RecvBuffer);
+    p_Ctx->p_RecvBuffer = NULL;
+    p_Ctx->RecvSize = 0;
+    free(p_Ctx->p_Tokens);
+    p_Ctx->p_Tokens = NULL;
+    p_Ctx->TokenCap = 0;
+    PdqStratumArenaFree(&p_Ctx->JobArena[0]);
+    PdqStratumArenaFree(&p_Ctx->JobArena[1]);
+    memset(&p_Ctx->CurrentJob, 0, sizeof(p_Ctx->CurrentJob));
+}
 
-    s_Ctx.State = StratumStateConnecting;
+static void ResolveRelease(ResolveRequest_t* p_Req)
+{
+    if (__atomic_sub_fetch(&p_Req->Refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    if (p_Req->p_Result) freeaddrinfo(p_Req->p_Result);
+    if (p_Req->Pipe[0] >= 0) close(p_Req->Pipe[0]);
+    if (p_Req->Pipe[1] >= 0) close(p_Req->Pipe[1]);
+    free(p_Req);
+}
 
-    struct addrinfo hints, *res;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
+static void ResolveRun(ResolveRequest_t* p_Req)
+{
+    struct addrinfo Hints;
+    memset(&Hints, 0, sizeof(Hints));
+    Hints.ai_family = AF_UNSPEC;
+    Hints.ai_socktype = SOCK_STREAM;
+#ifdef AI_ADDRCONFIG
+    Hints.ai_flags = AI_ADDRCONFIG;
+#endif
 
-    char PortStr[8];
-    snprintf(PortStr, sizeof(PortStr), "%d", Port);
+    p_Req->Error = getaddrinfo(p_Req->Host, p_Req->Port, &Hints, &p_Req->p_Result);
+    if (p_Req->Error == 0 && p_Req->p_Result == NULL) p_Req->Error = EAI_FAIL;
+    __atomic_store_n(&p_Req->Done, 1, __ATOMIC_RELEASE);
+}
 
-    int err = getaddrinfo(p_Host, PortStr, &hints, &res);
-    if (err != 0 || res == NULL) {
-        s_Ctx.State = StratumStateDisconnected;
-        return PdqErrorNotConnected;
+#if PDQ_STRATUM_ASYNC_RESOLVE
+static void* ResolveThread(void* p_Arg)
+{
+    ResolveRequest_t* p_Req = (ResolveRequest_t*)p_Arg;
+    ResolveRun(p_Req);
+    uint8_t Byte = 1;
+    ssize_t Written = write(p_Req->Pipe[1], &Byte, 1);
+    (void)Written;
+    ResolveRelease(p_Req);
+    return NULL;
+}
+#endif
+
+/* Order the resolver's answer for racing: getaddrinfo() already sorts by
+ * preference, the families are then interleaved (RFC 8305 section 4) so a
+ * broken IPv6 path costs one attempt delay rather than every v6 address. */
+static void CollectAddrs(ResolveRequest_t* p_Req)
+{
+    const struct addrinfo* p_Lists[2] = {NULL, NULL};
+    int FirstFamily = p_Req->p_Result->ai_family;
+
+    for (int Pass = 0; Pass < 2; Pass++) {
+        for (const struct addrinfo* p = p_Req->p_Result; p; p = p->ai_next) {
+            if ((p->ai_family == FirstFamily) == (Pass == 0)) {
+                p_Lists[Pass] = p;
+                break;
+            }
+        }
     }
 
-    s_Ctx.Socket = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-    if (s_Ctx.Socket < 0) {
-        freeaddrinfo(res);
-        s_Ctx.State = StratumStateDisconnected;
-        return PdqErrorNotConnected;
+    p_Req->AddrCount = 0;
+    while ((p_Lists[0] || p_Lists[1]) && p_Req->AddrCount < PDQ_STRATUM_MAX_ADDRS) {
+        for (int i = 0; i < 2 && p_Req->AddrCount < PDQ_STRATUM_MAX_ADDRS; i++) {
+            const struct addrinfo* p = p_Lists[i];
+            if (p == NULL) continue;
+            if (p->ai_addrlen <= sizeof(struct sockaddr_storage)) {
+                PoolAddr_t* p_Addr = &p_Req->Addrs[p_Req->AddrCount++];
+                memcpy(&p_Addr->Addr, p->ai_addr, p->ai_addrlen);
+                p_Addr->Len = (socklen_t)p->ai_addrlen;
+            }
+            /* Advance to the next entry of the same family */
+            int Family = p->ai_family;
+            for (p = p->ai_next; p && p->ai_family != Family; p = p->ai_next) {}
+            p_Lists[i] = p;
+        }
+    }
+}
+
+static DnsCacheEntry_t* CacheFind(const char* p_Host, const char* p_Port, bool Live)
+{
+    uint64_t Now = GetMillis();
+    for (int i = 0; i < PDQ_STRATUM_DNS_CACHE_SIZE; i++) {
+        DnsCacheEntry_t* p_Entry = &s_DnsCache[i];
+        if (p_Entry->AddrCount == 0) continue;
+        if (strcmp(p_Entry->Host, p_Host) != 0 || strcmp(p_Entry->Port, p_Port) != 0) continue;
+        if (Live && Now >= p_Entry->ExpiresMs) return NULL;
+        return p_Entry;
     }
+    return NULL;
+}
 
-    struct timeval Timeout;
-    Timeout.tv_sec = PDQ_STRATUM_DEFAULT_TIMEOUT_MS / 1000;
-    Timeout.tv_usec = (PDQ_STRATUM_DEFAULT_TIMEOUT_MS % 1000) * 1000;
-    setsockopt(s_Ctx.Socket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
-    setsockopt(s_Ctx.Socket, SOL_SOCKET, SO_SNDTIMEO, &Timeout, sizeof(Timeout));
+static void CacheStore(const ResolveRequest_t* p_Req)
+{
+    if (p_Req->AddrCount == 0) return;
 
-    if (connect(s_Ctx.Socket, res->ai_addr, res->ai_addrlen) < 0) {
-        close(s_Ctx.Socket);
-        s_Ctx.Socket = -1;
-        freeaddrinfo(res);
-        s_Ctx.State = StratumStateDisconnected;
-        return PdqErrorNotConnected;
+    /* Reuse the entry for this host, else the one closest to expiry */
+    DnsCacheEntry_t* p_Entry = CacheFind(p_Req->Host, p_Req->Port, false);
+    for (int i = 0; p_Entry == NULL && i < PDQ_STRATUM_DNS_CACHE_SIZE; i++) {
+        if (s_DnsCache[i].AddrCount == 0) p_Entry = &s_DnsCache[i];
+    }
+    if (p_Entry == NULL) {
+        p_Entry = &s_DnsCache[0];
+        for (int i = 1; i < PDQ_STRATUM_DNS_CACHE_SIZE; i++) {
+            if (s_DnsCache[i].ExpiresMs < p_Entry->ExpiresMs) p_Entry = &s_DnsCache[i];
+        }
+    }
+
+    snprintf(p_Entry->Host, sizeof(p_Entry->Host), "%s", p_Req->Host);
+    snprintf(p_Entry->Port, sizeof(p_Entry->Port), "%s", p_Req->Port);
+    memcpy(p_Entry->Addrs, p_Req->Addrs, sizeof(p_Entry->Addrs));
+    p_Entry->AddrCount = p_Req->AddrCount;
+    p_Entry->ExpiresMs = GetMillis() + PDQ_STRATUM_DNS_CACHE_TTL_MS;
+}
+
+static void CacheForget(const char* p_Host, const char* p_Port)
+{
+    DnsCacheEntry_t* p_Entry = CacheFind(p_Host, p_Port, false);
+    if (p_Entry) p_Entry->AddrCount = 0;
+}
+
+static void CloseAttempts(ResolveRequest_t* p_Req)
+{
+    for (int i = 0; i < PDQ_STRATUM_MAX_ADDRS; i++) {
+        if (p_Req->Attempts[i] >= 0) {
+            close(p_Req->Attempts[i]);
+            p_Req->Attempts[i] = -1;
+        }
     }
+}
+
+static void CloseSocket(PdqStratumContext_t* p_Ctx)
+{
+    if (p_Ctx->Socket >= 0) {
+        close(p_Ctx->Socket);
+        p_Ctx->Socket = -1;
+    }
+}
+
+static void ReleaseConnectState(PdqStratumContext_t* p_Ctx)
+{
+    if (p_Ctx->p_Resolve) {
+        CloseAttempts(p_Ctx->p_Resolve);
+        ResolveRelease(p_Ctx->p_Resolve);
+        p_Ctx->p_Resolve = NULL;
+    }
+}
+
+static PdqError_t FailConnect(PdqStratumContext_t* p_Ctx, const char* p_Stage)
+{
+    printf("[STRATUM] %s failed for %s:%s\n", p_Stage,
+           p_Ctx->p_Resolve ? p_Ctx->p_Resolve->Host : "pool",
+           p_Ctx->p_Resolve ? p_Ctx->p_Resolve->Port : "?");
+    PdqStratumCtxDisconnect(p_Ctx);
+    return PdqErrorNotConnected;
+}
+
+/* Socket is connected. It stays non-blocking: the outbound queue keeps
+ * whatever a full send buffer refuses, and reads only follow readiness.
+ * Nagle would hold a share back until the previous one is acknowledged. */
+static void FinishConnect(PdqStratumContext_t* p_Ctx)
+{
+    int NoDelay = 1;
+    setsockopt(p_Ctx->Socket, IPPROTO_TCP, TCP_NODELAY, &NoDelay, sizeof(NoDelay));
+
+    ReleaseConnectState(p_Ctx);
+    EnterState(p_Ctx, StratumStateConnected);
+    p_Ctx->LastRxMs = p_Ctx->StageStartMs;
+}
 
-    freeaddrinfo(res);
-    s_Ctx.State = StratumStateConnected;
+/* Open a non-blocking connect to the next address not tried yet.
+ * Returns false once every address has been used. */
+static bool StartNextAttempt(ResolveRequest_t* p_Req)
+{
+    while (p_Req->NextAddr < p_Req->AddrCount) {
+        uint8_t Index = p_Req->NextAddr++;
+        const PoolAddr_t* p_Addr = &p_Req->Addrs[Index];
+
+        int Fd = socket(p_Addr->Addr.ss_family, SOCK_STREAM, 0);
+        if (Fd < 0) continue;
+#ifdef FD_CLOEXEC
+        /* Only a session handed over on purpose survives a re-exec */
+        fcntl(Fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+        int Flags = fcntl(Fd, F_GETFL, 0);
+        if (Flags >= 0 && fcntl(Fd, F_SETFL, Flags | O_NONBLOCK) == 0 &&
+            (connect(Fd, (const struct sockaddr*)&p_Addr->Addr, p_Addr->Len) == 0 ||
+             errno == EINPROGRESS)) {
+            /* An immediate connect shows up as writable on the next pass */
+            p_Req->Attempts[Index] = Fd;
+            p_Req->NextAttemptMs = GetMillis() + PDQ_STRATUM_ATTEMPT_DELAY_MS;
+            return true;
+        }
+        close(Fd);
+    }
+    return false;
+}
+
+static PdqError_t StartConnect(PdqStratumContext_t* p_Ctx)
+{
+    ResolveRequest_t* p_Req = p_Ctx->p_Resolve;
+    if (p_Req->AddrCount == 0) {
+        if (p_Req->Error == 0) CollectAddrs(p_Req);
+        if (p_Req->AddrCount == 0) return FailConnect(p_Ctx, "DNS lookup");
+        CacheStore(p_Req);
+    }
+
+    EnterState(p_Ctx, StratumStateConnecting);
+    if (!StartNextAttempt(p_Req)) {
+        CacheForget(p_Req->Host, p_Req->Port);
+        return FailConnect(p_Ctx, "connect()");
+    }
     return PdqOk;
 }
 
-PdqError_t PdqStratumDisconnect(void)
+static PdqError_t ProcessResolving(PdqStratumContext_t* p_Ctx)
 {
-    if (s_Ctx.Socket >= 0) {
-        close(s_Ctx.Socket);
-        s_Ctx.Socket = -1;
+    if (!__atomic_load_n(&p_Ctx->p_Resolve->Done, __ATOMIC_ACQUIRE)) {
+        if (GetMillis() - p_Ctx->StageStartMs > PDQ_STRATUM_RESOLVE_TIMEOUT_MS) {
+            return FailConnect(p_Ctx, "DNS lookup (timeout)");
+        }
+        return PdqOk;
+    }
+    return StartConnect(p_Ctx);
+}
+
+/* Happy eyeballs: each address gets PDQ_STRATUM_ATTEMPT_DELAY_MS head
+ * start before the next one is tried in parallel, a refused attempt hands
+ * over at once, and the first connect to complete wins. */
+static PdqError_t ProcessConnecting(PdqStratumContext_t* p_Ctx)
+{
+    ResolveRequest_t* p_Req = p_Ctx->p_Resolve;
+    struct pollfd Polls[PDQ_STRATUM_MAX_ADDRS];
+    int Slots[PDQ_STRATUM_MAX_ADDRS];
+    nfds_t Count = 0;
+
+    /* poll(), not select(): a proxy or fleet holding thousands of sockets
+     * hands out descriptors past FD_SETSIZE */
+    for (int i = 0; i < p_Req->AddrCount; i++) {
+        if (p_Req->Attempts[i] < 0) continue;
+        Polls[Count].fd = p_Req->Attempts[i];
+        Polls[Count].events = POLLOUT;
+        Polls[Count].revents = 0;
+        Slots[Count++] = i;
+    }
+
+    bool InFlight = false;
+    if (Count > 0 && poll(Polls, Count, 0) > 0) {
+        for (nfds_t k = 0; k < Count; k++) {
+            int i = Slots[k];
+            int Fd = p_Req->Attempts[i];
+            if (!(Polls[k].revents & (POLLOUT | POLLERR | POLLHUP))) continue;
+
+            int SockErr = 0;
+            socklen_t ErrLen = sizeof(SockErr);
+            if (getsockopt(Fd, SOL_SOCKET, SO_ERROR, &SockErr, &ErrLen) == 0 && SockErr == 0) {
+                if (p_Req->AddrCount > 1) {
+                    printf("[STRATUM] Connected to %s via %s address %d of %u\n", p_Req->Host,
+                           p_Req->Addrs[i].Addr.ss_family == AF_INET ? "IPv4" : "IPv6",
+                           i + 1, (unsigned)p_Req->AddrCount);
+                }
+                p_Ctx->Socket = Fd;
+                p_Req->Attempts[i] = -1;
+                FinishConnect(p_Ctx);
+                return PdqOk;
+            }
+            close(Fd);
+            p_Req->Attempts[i] = -1;
+            p_Req->NextAttemptMs = 0;
+        }
+    }
+
+    for (int i = 0; i < p_Req->AddrCount; i++) {
+        if (p_Req->Attempts[i] >= 0) InFlight = true;
+    }
+
+    if ((!InFlight || GetMillis() >= p_Req->NextAttemptMs) && StartNextAttempt(p_Req)) {
+        InFlight = true;
+    }
+    if (!InFlight) {
+        CacheForget(p_Req->Host, p_Req->Port);
+        return FailConnect(p_Ctx, "connect()");
+    }
+    if (GetMillis() - p_Ctx->StageStartMs > PDQ_STRATUM_CONNECT_TIMEOUT_MS) {
+        CacheForget(p_Req->Host, p_Req->Port);
+        return FailConnect(p_Ctx, "connect (timeout)");
     }
-    s_Ctx.State = StratumStateDisconnected;
-    s_Ctx.HasNewJob = false;
     return PdqOk;
 }
 
-PdqError_t PdqStratumSubscribe(void)
+PdqError_t PdqStratumCtxConnectStart(PdqStratumContext_t* p_Ctx, const char* p_Host, uint16_t Port)
+{
+    if (p_Ctx == NULL || p_Host == NULL || Port == 0) return PdqErrorInvalidParam;
+    if (p_Ctx->State != StratumStateDisconnected) PdqStratumCtxDisconnect(p_Ctx);
+
+    /* A session id only means something to the pool that issued it */
+    if (p_Ctx->SessionPort != Port || strcmp(p_Ctx->SessionHost, p_Host) != 0) {
+        p_Ctx->SessionId[0] = '\0';
+        snprintf(p_Ctx->SessionHost, sizeof(p_Ctx->SessionHost), "%s", p_Host);
+        p_Ctx->SessionPort = Port;
+    }
+
+    ResolveRequest_t* p_Req = (ResolveRequest_t*)calloc(1, sizeof(ResolveRequest_t));
+    if (p_Req == NULL) return PdqErrorNoMemory;
+    snprintf(p_Req->Host, sizeof(p_Req->Host), "%s", p_Host);
+    snprintf(p_Req->Port, sizeof(p_Req->Port), "%u", (unsigned)Port);
+    p_Req->Pipe[0] = -1;
+    p_Req->Pipe[1] = -1;
+    p_Req->Refs = 1;
+    for (int i = 0; i < PDQ_STRATUM_MAX_ADDRS; i++) p_Req->Attempts[i] = -1;
+
+    p_Ctx->p_Resolve = p_Req;
+    EnterState(p_Ctx, StratumStateResolving);
+
+    /* Reconnects within the cache lifetime skip the resolver */
+    const DnsCacheEntry_t* p_Cached = CacheFind(p_Req->Host, p_Req->Port, true);
+    if (p_Cached) {
+        memcpy(p_Req->Addrs, p_Cached->Addrs, sizeof(p_Req->Addrs));
+        p_Req->AddrCount = p_Cached->AddrCount;
+        return StartConnect(p_Ctx);
+    }
+
+#if PDQ_STRATUM_ASYNC_RESOLVE
+    if (pipe(p_Req->Pipe) == 0) {
+        fcntl(p_Req->Pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(p_Req->Pipe[0], F_SETFD, FD_CLOEXEC);
+        fcntl(p_Req->Pipe[1], F_SETFD, FD_CLOEXEC);
+
+        pthread_t Thread;
+        pthread_attr_t Attr;
+        pthread_attr_init(&Attr);
+        pthread_attr_setdetachstate(&Attr, PTHREAD_CREATE_DETACHED);
+        p_Req->Refs = 2;
+        if (pthread_create(&Thread, &Attr, ResolveThread, p_Req) == 0) {
+            pthread_attr_destroy(&Attr);
+            return PdqOk;
+        }
+        pthread_attr_destroy(&Attr);
+        p_Req->Refs = 1;
+    }
+#endif
+
+    /* No helper thread: resolve inline and go straight to connect */
+    ResolveRun(p_Req);
+    return StartConnect(p_Ctx);
+}
+
+/* Wait until one of the current stage's descriptors is ready or
+ * TimeoutMs passes */
+static void WaitPollFd(PdqStratumContext_t* p_Ctx, uint32_t TimeoutMs)
 {
-    if (s_Ctx.State != StratumStateConnected) return PdqErrorNotConnected;
+    bool WantWrite = false;
+    int Fds[PDQ_STRATUM_MAX_ADDRS];
+    int Count = PdqStratumCtxGetPollFds(p_Ctx, Fds, PDQ_STRATUM_MAX_ADDRS, &WantWrite);
+    int Wakeup = PdqStratumCtxGetWakeupMs(p_Ctx);
+    if (Wakeup >= 0 && (uint32_t)Wakeup < TimeoutMs) TimeoutMs = (uint32_t)Wakeup;
+
+    struct pollfd Polls[PDQ_STRATUM_MAX_ADDRS];
+    for (int i = 0; i < Count; i++) {
+        Polls[i].fd = Fds[i];
+        Polls[i].events = WantWrite ? (POLLIN | POLLOUT) : POLLIN;
+        Polls[i].revents = 0;
+    }
+    poll(Polls, (nfds_t)(Count > 0 ? Count : 0), (int)TimeoutMs);
+}
 
-    s_Ctx.State = StratumStateSubscribing;
-    snprintf(s_Ctx.SendBuffer, sizeof(s_Ctx.SendBuffer),
-             "{\"id\":%d,\"method\":\"mining.subscribe\",\"params\":[\"PDQminer/%d.%d.%d\"]}",
-             JSON_ID_SUBSCRIBE, PDQ_VERSION_MAJOR, PDQ_VERSION_MINOR, PDQ_VERSION_PATCH);
+PdqError_t PdqStratumCtxConnect(PdqStratumContext_t* p_Ctx, const char* p_Host, uint16_t Port)
+{
+    PdqError_t Err = PdqStratumCtxConnectStart(p_Ctx, p_Host, Port);
+    if (Err != PdqOk) return Err;
 
-    return SendJson(s_Ctx.SendBuffer);
+    while (p_Ctx->State == StratumStateResolving || p_Ctx->State == StratumStateConnecting) {
+        WaitPollFd(p_Ctx, 100);
+        PdqStratumCtxProcess(p_Ctx);
+    }
+    return (p_Ctx->State == StratumStateConnected) ? PdqOk : PdqErrorNotConnected;
 }
 
-PdqError_t PdqStratumSuggestDifficulty(double Difficulty)
+PdqError_t PdqStratumCtxDisconnect(PdqStratumContext_t* p_Ctx)
 {
-    if (s_Ctx.Socket < 0) return PdqErrorNotConnected;
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    CloseSocket(p_Ctx);
+    ReleaseConnectState(p_Ctx);
+    p_Ctx->TxHead = 0;
+    p_Ctx->TxLen = 0;
+    p_Ctx->RecvLen = 0;
+    p_Ctx->RecvSkipLine = false;
+    p_Ctx->ExtranonceSubscribed = false;
+    ExpireSubmits(p_Ctx, true);
+    EnterState(p_Ctx, StratumStateDisconnected);
+    p_Ctx->HasNewJob = false;
+    return PdqOk;
+}
 
-    snprintf(s_Ctx.SendBuffer, sizeof(s_Ctx.SendBuffer),
+PdqError_t PdqStratumCtxSubscribe(PdqStratumContext_t* p_Ctx)
+{
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->State != StratumStateConnected) return PdqErrorNotConnected;
+
+    EnterState(p_Ctx, StratumStateSubscribing);
+
+    /* Offer the previous session so the pool can keep our extranonce1 */
+    p_Ctx->SessionOffered = p_Ctx->SessionId[0] != '\0';
+    p_Ctx->Resumed = false;
+    if (p_Ctx->SessionOffered) {
+        snprintf(p_Ctx->SendBuffer, sizeof(p_Ctx->SendBuffer),
+                 "{\"id\":%d,\"method\":\"mining.subscribe\",\"params\":[\"PDQminer/%d.%d.%d\",\"%s\"]}",
+                 JSON_ID_SUBSCRIBE, PDQ_VERSION_MAJOR, PDQ_VERSION_MINOR, PDQ_VERSION_PATCH,
+                 p_Ctx->SessionId);
+    } else {
+        snprintf(p_Ctx->SendBuffer, sizeof(p_Ctx->SendBuffer),
+                 "{\"id\":%d,\"method\":\"mining.subscribe\",\"params\":[\"PDQminer/%d.%d.%d\"]}",
+                 JSON_ID_SUBSCRIBE, PDQ_VERSION_MAJOR, PDQ_VERSION_MINOR, PDQ_VERSION_PATCH);
+    }
+
+    return SendJson(p_Ctx, p_Ctx->SendBuffer);
+}
+
+PdqError_t PdqStratumCtxSuggestDifficulty(PdqStratumContext_t* p_Ctx, double Difficulty)
+{
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->Socket < 0) return PdqErrorNotConnected;
+    /* Anything lower would be raised again by HandleSetDifficulty */
+    if (Difficulty < PDQ_STRATUM_MIN_DIFFICULTY) Difficulty = PDQ_STRATUM_MIN_DIFFICULTY;
+
+    snprintf(p_Ctx->SendBuffer, sizeof(p_Ctx->SendBuffer),
              "{\"id\":%d,\"method\":\"mining.suggest_difficulty\",\"params\":[%g]}",
              JSON_ID_SUGGEST_DIFF, Difficulty);
 
-    return SendJson(s_Ctx.SendBuffer);
+    return SendJson(p_Ctx, p_Ctx->SendBuffer);
 }
 
-PdqError_t PdqStratumAuthorize(const char* p_Worker, const char* p_Password)
+PdqError_t PdqStratumCtxAuthorize(PdqStratumContext_t* p_Ctx, const char* p_Worker, const char* p_Password)
 {
-    if (s_Ctx.State != StratumStateSubscribed) return PdqErrorNotConnected;
-    if (p_Worker == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx == NULL || p_Worker == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->State != StratumStateSubscribed) return PdqErrorNotConnected;
 
-    strncpy(s_Ctx.Worker, p_Worker, PDQ_MAX_WORKER_LEN);
-    s_Ctx.Worker[PDQ_MAX_WORKER_LEN] = '\0';
-    strncpy(s_Ctx.Password, p_Password ? p_Password : "x", PDQ_MAX_PASSWORD_LEN);
-    s_Ctx.Password[PDQ_MAX_PASSWORD_LEN] = '\0';
+    strncpy(p_Ctx->Worker, p_Worker, PDQ_MAX_WORKER_LEN);
+    p_Ctx->Worker[PDQ_MAX_WORKER_LEN] = '\0';
+    strncpy(p_Ctx->Password, p_Password ? p_Password : "x", PDQ_MAX_PASSWORD_LEN);
+    p_Ctx->Password[PDQ_MAX_PASSWORD_LEN] = '\0';
 
     /* Escape worker and password for safe JSON embedding */
     char EscWorker[PDQ_MAX_WORKER_LEN * 2 + 1];
     char EscPassword[PDQ_MAX_PASSWORD_LEN * 2 + 1];
-    JsonEscapeString(s_Ctx.Worker, EscWorker, sizeof(EscWorker));
-    JsonEscapeString(s_Ctx.Password, EscPassword, sizeof(EscPassword));
+    JsonEscapeString(p_Ctx->Worker, EscWorker, sizeof(EscWorker));
+    JsonEscapeString(p_Ctx->Password, EscPassword, sizeof(EscPassword));
 
-    s_Ctx.State = StratumStateAuthorizing;
-    snprintf(s_Ctx.SendBuffer, sizeof(s_Ctx.SendBuffer),
+    EnterState(p_Ctx, StratumStateAuthorizing);
+    snprintf(p_Ctx->SendBuffer, sizeof(p_Ctx->SendBuffer),
              "{\"id\":%d,\"method\":\"mining.authorize\",\"params\":[\"%s\",\"%s\"]}",
              JSON_ID_AUTHORIZE, EscWorker, EscPassword);
 
-    return SendJson(s_Ctx.SendBuffer);
+    return SendJson(p_Ctx, p_Ctx->SendBuffer);
 }
 
-PdqError_t PdqStratumSubmitShare(const char* p_JobId, uint32_t Extranonce2, uint32_t Nonce, uint32_t NTime)
+static PdqError_t DropStale(PdqStratumContext_t* p_Ctx, const char* p_JobId)
+{
+    p_Ctx->SubmitStats.StaleDropped++;
+    printf("[STRATUM] Dropped stale share for job %s\n", p_JobId);
+    if (p_Ctx->p_OnSubmit) p_Ctx->p_OnSubmit(p_Ctx->p_OnSubmitArg, PdqSubmitStale, 0, 0);
+    return PdqErrorInvalidJob;
+}
+
+PdqError_t PdqStratumCtxSubmitShare(PdqStratumContext_t* p_Ctx, const char* p_JobId,
+                                    uint32_t Extranonce2, uint32_t Nonce, uint32_t NTime)
 {
-    if (s_Ctx.State != StratumStateReady) return PdqErrorNotConnected;
-    if (p_JobId == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
 
-    char Extranonce2Hex[17] = {0};
-    uint8_t Extranonce2Bytes[8];
-    uint32_t En2Size = s_Ctx.Extranonce2Size;
+    uint8_t Extranonce2Bytes[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint32_t En2Size = p_Ctx->Extranonce2Size;
     if (En2Size > PDQ_STRATUM_MAX_EXTRANONCE_LEN) En2Size = PDQ_STRATUM_MAX_EXTRANONCE_LEN;
     for (int i = 0; i < (int)En2Size; i++) {
         Extranonce2Bytes[i] = (uint8_t)(Extranonce2 >> (i * 8));
     }
-    BytesToHex(Extranonce2Bytes, En2Size, Extranonce2Hex);
+    return PdqStratumCtxSubmitShareBytes(p_Ctx, p_JobId, Extranonce2Bytes, (uint8_t)En2Size, Nonce, NTime);
+}
+
+PdqError_t PdqStratumCtxSubmitShareBytes(PdqStratumContext_t* p_Ctx, const char* p_JobId,
+                                         const uint8_t* p_Extranonce2, uint8_t Extranonce2Len,
+                                         uint32_t Nonce, uint32_t NTime)
+{
+    if (p_Ctx == NULL || p_JobId == NULL || p_Extranonce2 == NULL) return PdqErrorInvalidParam;
+    if (Extranonce2Len > PDQ_STRATUM_MAX_EXTRANONCE_LEN) return PdqErrorInvalidParam;
+    if (p_Ctx->State != StratumStateReady) return PdqErrorNotConnected;
+
+    /* The pool already retired this job; sending would only earn a reject */
+    if (!PdqStratumCtxIsJobActive(p_Ctx, p_JobId)) return DropStale(p_Ctx, p_JobId);
+
+    char Extranonce2Hex[2 * PDQ_STRATUM_MAX_EXTRANONCE_LEN + 1] = {0};
+    BytesToHex(p_Extranonce2, Extranonce2Len, Extranonce2Hex);
 
     char NTimeHex[9] = {0};
     snprintf(NTimeHex, sizeof(NTimeHex), "%08x", NTime);
@@ -542,251 +1162,597 @@ PdqError_t PdqStratumSubmitShare(const char* p_JobId, uint32_t Extranonce2, uint
     char NonceHex[9] = {0};
     snprintf(NonceHex, sizeof(NonceHex), "%08x", Nonce);
 
-    s_Ctx.SubmitId++;
-    snprintf(s_Ctx.SendBuffer, sizeof(s_Ctx.SendBuffer),
+    p_Ctx->SubmitId++;
+    uint32_t Id = JSON_ID_SUBMIT_BASE + p_Ctx->SubmitId;
+    snprintf(p_Ctx->SendBuffer, sizeof(p_Ctx->SendBuffer),
              "{\"id\":%u,\"method\":\"mining.submit\",\"params\":[\"%s\",\"%s\",\"%s\",\"%s\",\"%s\"]}",
-             JSON_ID_SUBMIT_BASE + s_Ctx.SubmitId, s_Ctx.Worker, p_JobId,
-             Extranonce2Hex, NTimeHex, NonceHex);
+             (unsigned)Id, p_Ctx->Worker, p_JobId, Extranonce2Hex, NTimeHex, NonceHex);
 
-    return SendJson(s_Ctx.SendBuffer);
+    PdqError_t Err = SendJson(p_Ctx, p_Ctx->SendBuffer);
+    if (Err == PdqOk) TrackSubmit(p_Ctx, Id);
+    return Err;
 }
 
-PdqError_t PdqStratumProcess(void)
+PdqError_t PdqStratumCtxSubmitMinedShare(PdqStratumContext_t* p_Ctx, const PdqShareInfo_t* p_Share)
 {
-    if (s_Ctx.Socket < 0) return PdqErrorNotConnected;
+    if (p_Ctx == NULL || p_Share == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->State != StratumStateReady) return PdqErrorNotConnected;
 
-    /* Guard against buffer-full condition: if buffer has no room for more data
-     * and no complete line was found, discard the buffer to prevent deadlock. */
-    if (s_Ctx.RecvLen >= PDQ_STRATUM_RECV_BUFFER_SIZE - 1) {
-        printf("[STRATUM] WARN: recv buffer full (%u bytes), discarding\n", s_Ctx.RecvLen);
-        s_Ctx.RecvLen = 0;
-        s_Ctx.RecvBuffer[0] = '\0';
-    }
+    /* Coinbase built on an extranonce1 the pool no longer credits us with */
+    if (p_Share->ExtranonceGen != p_Ctx->ExtranonceGen) return DropStale(p_Ctx, p_Share->JobId);
+    return PdqStratumCtxSubmitShare(p_Ctx, p_Share->JobId, p_Share->Extranonce2,
+                                    p_Share->Nonce, p_Share->NTime);
+}
 
-    fd_set ReadSet;
-    struct timeval Timeout = {0, 100000};
+PdqError_t PdqStratumCtxProcess(PdqStratumContext_t* p_Ctx)
+{
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    switch (p_Ctx->State) {
+        case StratumStateDisconnected:
+            return PdqErrorNotConnected;
+        case StratumStateResolving:
+            return ProcessResolving(p_Ctx);
+        case StratumStateConnecting:
+            return ProcessConnecting(p_Ctx);
+        case StratumStateSubscribing:
+        case StratumStateAuthorizing:
+            if (GetMillis() - p_Ctx->StageStartMs > PDQ_STRATUM_HANDSHAKE_TIMEOUT_MS) {
+                printf("[STRATUM] %s timeout\n",
+                       p_Ctx->State == StratumStateSubscribing ? "Subscribe" : "Authorize");
+                PdqStratumCtxDisconnect(p_Ctx);
+                return PdqErrorTimeout;
+            }
+            break;
+        default:
+            break;
+    }
+    if (p_Ctx->Socket < 0) return PdqErrorNotConnected;
 
-    FD_ZERO(&ReadSet);
-    FD_SET(s_Ctx.Socket, &ReadSet);
+    if (p_Ctx->TxLen > 0 && !p_Ctx->TxCorked && FlushTx(p_Ctx) != PdqOk) {
+        return PdqErrorNotConnected;
+    }
+    ExpireSubmits(p_Ctx, false);
+
+    /* A line that does not fit grows the buffer; past the maximum the
+     * line is dropped and reading resumes at the next newline. */
+    if (p_Ctx->RecvLen + 1 >= p_Ctx->RecvSize && !GrowRecvBuffer(p_Ctx)) {
+        printf("[STRATUM] WARN: line exceeds %u bytes, discarding\n", (unsigned)p_Ctx->RecvSize);
+        p_Ctx->RxOversize++;
+        p_Ctx->RecvLen = 0;
+        p_Ctx->RecvSkipLine = true;
+    }
+    if (p_Ctx->p_RecvBuffer == NULL) return PdqErrorNoMemory;
 
-    int Ready = select(s_Ctx.Socket + 1, &ReadSet, NULL, NULL, &Timeout);
-    if (Ready <= 0) return PdqOk;
+    /* Zero timeout: callers either wait for readiness on the socket
+     * (PdqStratumGetSocket) or already pace their own loop. */
+    struct pollfd Poll = {p_Ctx->Socket, POLLIN, 0};
+    if (poll(&Poll, 1, 0) <= 0) return PdqOk;
 
-    ssize_t Bytes = recv(s_Ctx.Socket, s_Ctx.RecvBuffer + s_Ctx.RecvLen,
-                         PDQ_STRATUM_RECV_BUFFER_SIZE - s_Ctx.RecvLen - 1, 0);
+    ssize_t Bytes = recv(p_Ctx->Socket, p_Ctx->p_RecvBuffer + p_Ctx->RecvLen,
+                         p_Ctx->RecvSize - p_Ctx->RecvLen - 1, 0);
 
     if (Bytes <= 0) {
-        PdqStratumDisconnect();
+        PdqStratumCtxDisconnect(p_Ctx);
         return PdqErrorNotConnected;
     }
 
-    s_Ctx.RecvLen += (uint16_t)Bytes;
-    s_Ctx.RecvBuffer[s_Ctx.RecvLen] = '\0';
-
-    char* p_Line = s_Ctx.RecvBuffer;
+    char* p_Start = p_Ctx->p_RecvBuffer;
+    char* p_End = p_Start + p_Ctx->RecvLen + (size_t)Bytes;
+    char* p_Scan = p_Start + p_Ctx->RecvLen;   /* Earlier bytes hold no newline */
+    char* p_Line = p_Start;
     char* p_Newline;
 
-    while ((p_Newline = strchr(p_Line, '\n')) != NULL) {
+    while ((p_Newline = (char*)memchr(p_Scan, '\n', (size_t)(p_End - p_Scan))) != NULL) {
         *p_Newline = '\0';
-        ProcessLine(p_Line);
+        if (p_Ctx->RecvSkipLine) {
+            p_Ctx->RecvSkipLine = false;
+        } else {
+            ProcessLine(p_Ctx, p_Line, (size_t)(p_Newline - p_Line));
+        }
         p_Line = p_Newline + 1;
+        p_Scan = p_Line;
     }
 
-    if (p_Line != s_Ctx.RecvBuffer) {
-        size_t Remaining = strlen(p_Line);
-        memmove(s_Ctx.RecvBuffer, p_Line, Remaining + 1);
-        s_Ctx.RecvLen = (uint16_t)Remaining;
-    }
+    /* Nothing of a line being dropped needs to be kept */
+    p_Ctx->RecvLen = p_Ctx->RecvSkipLine ? 0 : (uint32_t)(p_End - p_Line);
+    if (p_Line != p_Start && p_Ctx->RecvLen > 0) memmove(p_Start, p_Line, p_Ctx->RecvLen);
+    p_Start[p_Ctx->RecvLen] = '\0';
 
     return PdqOk;
 }
 
-bool PdqStratumIsConnected(void)
+bool PdqStratumCtxIsConnected(const PdqStratumContext_t* p_Ctx)
 {
-    return s_Ctx.State >= StratumStateConnected;
+    return p_Ctx != NULL && p_Ctx->State >= StratumStateConnected;
 }
 
-bool PdqStratumIsReady(void)
+bool PdqStratumCtxIsReady(const PdqStratumContext_t* p_Ctx)
 {
-    return s_Ctx.State == StratumStateReady;
+    return p_Ctx != NULL && p_Ctx->State == StratumStateReady;
 }
 
-bool PdqStratumHasNewJob(void)
+bool PdqStratumCtxHasNewJob(PdqStratumContext_t* p_Ctx)
 {
-    bool Has = s_Ctx.HasNewJob;
-    s_Ctx.HasNewJob = false;
+    if (p_Ctx == NULL) return false;
+    bool Has = p_Ctx->HasNewJob;
+    p_Ctx->HasNewJob = false;
     return Has;
 }
 
-PdqStratumState_t PdqStratumGetState(void)
+uint64_t PdqStratumCtxGetLastRxMs(const PdqStratumContext_t* p_Ctx)
 {
-    return s_Ctx.State;
+    return p_Ctx ? p_Ctx->LastRxMs : 0;
 }
 
-PdqError_t PdqStratumGetJob(PdqStratumJob_t* p_Job)
+int PdqStratumCtxGetSocket(const PdqStratumContext_t* p_Ctx)
+{
+    return p_Ctx ? p_Ctx->Socket : -1;
+}
+
+int PdqStratumCtxGetPollFd(const PdqStratumContext_t* p_Ctx, bool* p_WantWrite)
+{
+    int Fd = -1;
+    PdqStratumCtxGetPollFds(p_Ctx, &Fd, 1, p_WantWrite);
+    return Fd;
+}
+
+int PdqStratumCtxGetPollFds(const PdqStratumContext_t* p_Ctx, int* p_Fds, int MaxFds, bool* p_WantWrite)
+{
+    if (p_WantWrite) {
+        *p_WantWrite = p_Ctx != NULL && (p_Ctx->State == StratumStateConnecting ||
+                                         (p_Ctx->Socket >= 0 && p_Ctx->TxLen > 0));
+    }
+    if (p_Ctx == NULL || p_Fds == NULL || MaxFds <= 0) return 0;
+
+    const ResolveRequest_t* p_Req = p_Ctx->p_Resolve;
+    int Count = 0;
+    if (p_Ctx->State == StratumStateResolving) {
+        if (p_Req && p_Req->Pipe[0] >= 0) p_Fds[Count++] = p_Req->Pipe[0];
+    } else if (p_Ctx->State == StratumStateConnecting) {
+        for (int i = 0; p_Req && i < p_Req->AddrCount && Count < MaxFds; i++) {
+            if (p_Req->Attempts[i] >= 0) p_Fds[Count++] = p_Req->Attempts[i];
+        }
+    } else if (p_Ctx->Socket >= 0) {
+        p_Fds[Count++] = p_Ctx->Socket;
+    }
+    return Count;
+}
+
+int PdqStratumCtxGetWakeupMs(const PdqStratumContext_t* p_Ctx)
+{
+    if (p_Ctx == NULL || p_Ctx->State != StratumStateConnecting || p_Ctx->p_Resolve == NULL) {
+        return -1;
+    }
+    const ResolveRequest_t* p_Req = p_Ctx->p_Resolve;
+    if (p_Req->NextAddr >= p_Req->AddrCount) return -1;
+
+    uint64_t Now = GetMillis();
+    return (Now >= p_Req->NextAttemptMs) ? 0 : (int)(p_Req->NextAttemptMs - Now);
+}
+
+PdqStratumState_t PdqStratumCtxGetState(const PdqStratumContext_t* p_Ctx)
+{
+    return p_Ctx ? p_Ctx->State : StratumStateDisconnected;
+}
+
+PdqError_t PdqStratumCtxGetJob(const PdqStratumContext_t* p_Ctx, PdqStratumJob_t* p_Job)
 {
-    if (p_Job == NULL) return PdqErrorInvalidParam;
-    memcpy(p_Job, &s_Ctx.CurrentJob, sizeof(PdqStratumJob_t));
+    if (p_Ctx == NULL || p_Job == NULL) return PdqErrorInvalidParam;
+    memcpy(p_Job, &p_Ctx->CurrentJob, sizeof(PdqStratumJob_t));
     return PdqOk;
 }
 
-double PdqStratumGetDifficulty(void)
+double PdqStratumCtxGetDifficulty(const PdqStratumContext_t* p_Ctx)
 {
-    return s_Ctx.Difficulty;
+    return p_Ctx ? p_Ctx->Difficulty : 1.0;
 }
 
-void PdqStratumGetExtranonce(uint8_t* p_Buffer, uint8_t* p_Len)
+void PdqStratumCtxGetExtranonce(const PdqStratumContext_t* p_Ctx, uint8_t* p_Buffer, uint8_t* p_Len)
 {
-    if (p_Buffer && p_Len) {
-        memcpy(p_Buffer, s_Ctx.Extranonce1, s_Ctx.Extranonce1Len);
-        *p_Len = s_Ctx.Extranonce1Len;
+    if (p_Ctx && p_Buffer && p_Len) {
+        memcpy(p_Buffer, p_Ctx->Extranonce1, p_Ctx->Extranonce1Len);
+        *p_Len = p_Ctx->Extranonce1Len;
     }
 }
 
-uint8_t PdqStratumGetExtranonce2Size(void)
+uint8_t PdqStratumCtxGetExtranonce2Size(const PdqStratumContext_t* p_Ctx)
 {
-    return (uint8_t)s_Ctx.Extranonce2Size;
+    return p_Ctx ? (uint8_t)p_Ctx->Extranonce2Size : 0;
 }
 
-static void DifficultyToTarget(double Difficulty, uint32_t* p_Target)
+void PdqStratumCtxSetSubmitCallback(PdqStratumContext_t* p_Ctx,
+                                    PdqStratumSubmitCallback_t Callback, void* p_Arg)
 {
-    /* Bitcoin pool difficulty 1 target (pdiff) as LE uint256 (pn[] format):
-     *   Number: 0x00000000_FFFF0000_00000000_00000000_00000000_00000000_00000000_00000000
-     *   = 0xFFFF * 2^208
-     *   pn[7]=0, pn[6]=0xFFFF0000, pn[5..0]=0  (pn[7] = most significant word)
-     *
-     * For arbitrary difficulty D: target = pdiff1 / D
-     * We compute pn[7]:pn[6] from 0x00000000FFFF0000 / D
-     * Hash comparison: pn[7] first (most significant), down to pn[0]. */
-    if (Difficulty <= 0.0) Difficulty = 1.0;
+    if (p_Ctx == NULL) return;
+    p_Ctx->p_OnSubmit = Callback;
+    p_Ctx->p_OnSubmitArg = p_Arg;
+}
 
-    memset(p_Target, 0, 32);  /* All words zero */
+void PdqStratumCtxSetLineCallback(PdqStratumContext_t* p_Ctx,
+                                  PdqStratumLineCallback_t Callback, void* p_Arg)
+{
+    if (p_Ctx == NULL) return;
+    p_Ctx->p_OnLine = Callback;
+    p_Ctx->p_OnLineArg = p_Arg;
+}
 
-    if (Difficulty < 1.0) {
-        /* Fractional difficulty: target > pdiff1.
-         * Compute full division; result may overflow into pn[7]. */
-        double top64_f = (double)0x00000000FFFF0000ULL / Difficulty;
-        if (top64_f >= (double)UINT64_MAX) {
-            /* Overflow: accept (almost) everything */
-            memset(p_Target, 0xFF, 32);
-        } else {
-            uint64_t top64 = (uint64_t)top64_f;
-            p_Target[7] = (uint32_t)(top64 >> 32);
-            p_Target[6] = (uint32_t)(top64 & 0xFFFFFFFF);
-            /* Fill lower words with 0xFF for easy targets */
-            memset(p_Target, 0xFF, 24);  /* p_Target[0..5] = 0xFFFFFFFF */
-        }
-    } else {
-        /* Integer difficulty >= 1: standard case */
-        uint64_t top64 = 0x00000000FFFF0000ULL / (uint64_t)Difficulty;
-        p_Target[7] = (uint32_t)(top64 >> 32);
-        p_Target[6] = (uint32_t)(top64 & 0xFFFFFFFF);
-        /* p_Target[5..0] remain 0 from memset */
+bool PdqStratumCtxIsJobActive(const PdqStratumContext_t* p_Ctx, const char* p_JobId)
+{
+    if (p_Ctx == NULL || p_JobId == NULL) return false;
+    for (uint8_t i = 0; i < p_Ctx->JobHistoryCount; i++) {
+        if (strcmp(p_Ctx->JobHistory[i], p_JobId) == 0) return true;
     }
+    return false;
 }
 
-PdqError_t PdqStratumBuildMiningJob(const PdqStratumJob_t* p_StratumJob,
-                                     const uint8_t* p_Extranonce1, uint8_t Extranonce1Len,
-                                     uint32_t Extranonce2, uint8_t Extranonce2Len,
-                                     double Difficulty,
-                                     PdqMiningJob_t* p_MiningJob)
+void PdqStratumCtxGetSubmitStats(const PdqStratumContext_t* p_Ctx, PdqStratumSubmitStats_t* p_Stats)
 {
-    if (p_StratumJob == NULL || p_MiningJob == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx && p_Stats) *p_Stats = p_Ctx->SubmitStats;
+}
 
-    memset(p_MiningJob, 0, sizeof(PdqMiningJob_t));
+uint32_t PdqStratumCtxGetPendingSubmits(const PdqStratumContext_t* p_Ctx)
+{
+    uint32_t Count = 0;
+    for (int i = 0; p_Ctx && i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        if (p_Ctx->Pending[i].Id != 0) Count++;
+    }
+    return Count;
+}
+
+PdqError_t PdqStratumCtxCork(PdqStratumContext_t* p_Ctx, bool Cork)
+{
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    p_Ctx->TxCorked = Cork;
+    if (Cork || p_Ctx->TxLen == 0) return PdqOk;
+    return FlushTx(p_Ctx);
+}
 
-    uint8_t Coinbase[600];
-    size_t CoinbaseLen = 0;
+PdqError_t PdqStratumCtxFlush(PdqStratumContext_t* p_Ctx)
+{
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    return FlushTx(p_Ctx);
+}
 
-    /* Bounds-check total coinbase length before assembly.
-     * Max: Coinbase1(256) + Extranonce1(8) + Extranonce2(8) + Coinbase2(256) = 528. */
-    size_t TotalLen = (size_t)p_StratumJob->Coinbase1Len + Extranonce1Len +
-                      Extranonce2Len + (size_t)p_StratumJob->Coinbase2Len;
-    if (TotalLen > sizeof(Coinbase)) {
-        printf("[STRATUM] ERROR: coinbase too large (%u bytes), max %u\n",
-               (unsigned)TotalLen, (unsigned)sizeof(Coinbase));
-        return PdqErrorInvalidJob;
+uint32_t PdqStratumCtxGetTxQueued(const PdqStratumContext_t* p_Ctx)
+{
+    return p_Ctx ? p_Ctx->TxLen : 0;
+}
+
+uint32_t PdqStratumCtxGetTxSpace(const PdqStratumContext_t* p_Ctx)
+{
+    return p_Ctx ? (uint32_t)(PDQ_STRATUM_TX_BUFFER_SIZE - p_Ctx->TxLen) : 0;
+}
+
+void PdqStratumCtxGetTxStats(const PdqStratumContext_t* p_Ctx, PdqStratumTxStats_t* p_Stats)
+{
+    if (p_Ctx && p_Stats) *p_Stats = p_Ctx->TxStats;
+}
+
+PdqError_t PdqStratumCtxBuildNextJob(PdqStratumContext_t* p_Ctx, PdqMiningJob_t* p_MiningJob)
+{
+    if (p_Ctx == NULL || p_MiningJob == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->Extranonce1Len == 0) return PdqErrorNotConnected;
+
+    p_Ctx->Extranonce2Next++;
+    PdqError_t Err = PdqStratumBuildMiningJob(&p_Ctx->CurrentJob,
+                                              p_Ctx->Extranonce1, p_Ctx->Extranonce1Len,
+                                              p_Ctx->Extranonce2Next, (uint8_t)p_Ctx->Extranonce2Size,
+                                              p_Ctx->Difficulty, p_MiningJob);
+    p_MiningJob->ExtranonceGen = p_Ctx->ExtranonceGen;
+    return Err;
+}
+
+/* Everything SaveState writes besides the variable parts below */
+#define STATE_FIXED_SIZE    1024
+
+uint32_t PdqStratumCtxStateSize(const PdqStratumContext_t* p_Ctx)
+{
+    if (p_Ctx == NULL) return 0;
+    const PdqStratumJob_t* p_Job = &p_Ctx->CurrentJob;
+    return STATE_FIXED_SIZE + p_Ctx->TxLen + p_Ctx->RecvLen +
+           (uint32_t)p_Job->MerkleBranchCount * 32 + p_Job->Coinbase1Len + p_Job->Coinbase2Len +
+           PDQ_STRATUM_JOB_HISTORY * (PDQ_STRATUM_MAX_JOBID_LEN + 1) +
+           PDQ_STRATUM_MAX_PENDING_SUBMITS * 12;
+}
+
+/* Fields in a fixed order behind the magic and version. Timestamps are
+ * CLOCK_MONOTONIC milliseconds, which carry over an exec unchanged. */
+PdqError_t PdqStratumCtxSaveState(const PdqStratumContext_t* p_Ctx, uint8_t* p_Buffer,
+                                  uint32_t Size, uint32_t* p_Len)
+{
+    if (p_Ctx == NULL || p_Buffer == NULL || p_Len == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->State != StratumStateReady || p_Ctx->Socket < 0) return PdqErrorNotConnected;
+
+    PdqSv2Writer_t W;
+    PdqSv2WriterInit(&W, p_Buffer, Size);
+    PdqSv2PutU32(&W, PDQ_STRATUM_STATE_MAGIC);
+    PdqSv2PutU8(&W, PDQ_STRATUM_STATE_VERSION);
+
+    PdqSv2PutB032(&W, p_Ctx->Extranonce1, p_Ctx->Extranonce1Len);
+    PdqSv2PutU32(&W, p_Ctx->Extranonce2Size);
+    PdqSv2PutU32(&W, p_Ctx->Extranonce2Next);
+    PdqSv2PutU8(&W, p_Ctx->ExtranonceSubscribed);
+    PdqSv2PutStr(&W, p_Ctx->SessionId);
+    PdqSv2PutStr(&W, p_Ctx->SessionHost);
+    PdqSv2PutU16(&W, p_Ctx->SessionPort);
+    uint64_t DiffBits;
+    memcpy(&DiffBits, &p_Ctx->Difficulty, sizeof(DiffBits));
+    PdqSv2PutU64(&W, DiffBits);
+    PdqSv2PutU32(&W, p_Ctx->SubmitId);
+    PdqSv2PutU32(&W, p_Ctx->SubmitTimeoutMs);
+    PdqSv2PutU64(&W, p_Ctx->LastRxMs);
+    PdqSv2PutStr(&W, p_Ctx->Worker);
+    PdqSv2PutStr(&W, p_Ctx->Password);
+
+    uint8_t Pending = 0;
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) Pending += (p_Ctx->Pending[i].Id != 0);
+    PdqSv2PutU8(&W, Pending);
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        if (p_Ctx->Pending[i].Id == 0) continue;
+        PdqSv2PutU32(&W, p_Ctx->Pending[i].Id);
+        PdqSv2PutU64(&W, p_Ctx->Pending[i].SentMs);
+    }
+
+    /* Unsent output, unwrapped from the ring */
+    size_t First = PDQ_STRATUM_TX_BUFFER_SIZE - p_Ctx->TxHead;
+    if (First > p_Ctx->TxLen) First = p_Ctx->TxLen;
+    PdqSv2PutU32(&W, p_Ctx->TxLen);
+    PdqSv2PutBytes(&W, (const uint8_t*)p_Ctx->TxRing + p_Ctx->TxHead, (uint32_t)First);
+    PdqSv2PutBytes(&W, (const uint8_t*)p_Ctx->TxRing, (uint32_t)(p_Ctx->TxLen - First));
+
+    PdqSv2PutU8(&W, p_Ctx->RecvSkipLine);
+    PdqSv2PutU32(&W, p_Ctx->RecvLen);
+    PdqSv2PutBytes(&W, (const uint8_t*)p_Ctx->p_RecvBuffer, p_Ctx->RecvLen);
+
+    const PdqStratumJob_t* p_Job = &p_Ctx->CurrentJob;
+    PdqSv2PutStr(&W, p_Job->JobId);
+    PdqSv2PutBytes(&W, p_Job->PrevBlockHash, 32);
+    PdqSv2PutU32(&W, p_Job->Version);
+    PdqSv2PutU32(&W, p_Job->NBits);
+    PdqSv2PutU32(&W, p_Job->NTime);
+    PdqSv2PutU8(&W, p_Job->CleanJobs);
+    PdqSv2PutU64(&W, p_Ctx->JobRxMs);
+    PdqSv2PutU16(&W, p_Job->MerkleBranchCount);
+    PdqSv2PutBytes(&W, (const uint8_t*)p_Job->p_MerkleBranches, (uint32_t)p_Job->MerkleBranchCount * 32);
+    PdqSv2PutU32(&W, p_Job->Coinbase1Len);
+    PdqSv2PutBytes(&W, p_Job->p_Coinbase1, p_Job->Coinbase1Len);
+    PdqSv2PutU32(&W, p_Job->Coinbase2Len);
+    PdqSv2PutBytes(&W, p_Job->p_Coinbase2, p_Job->Coinbase2Len);
+
+    /* Oldest first, so replaying them rebuilds the same ring */
+    PdqSv2PutU8(&W, p_Ctx->JobHistoryCount);
+    for (uint8_t i = 0; i < p_Ctx->JobHistoryCount; i++) {
+        uint8_t Slot = (uint8_t)((p_Ctx->JobHistoryNext + PDQ_STRATUM_JOB_HISTORY - p_Ctx->JobHistoryCount + i) %
+                                 PDQ_STRATUM_JOB_HISTORY);
+        PdqSv2PutStr(&W, p_Ctx->JobHistory[Slot]);
     }
 
-    memcpy(Coinbase + CoinbaseLen, p_StratumJob->Coinbase1, p_StratumJob->Coinbase1Len);
-    CoinbaseLen += p_StratumJob->Coinbase1Len;
+    if (W.Overflow) return PdqErrorBufferTooSmall;
+    *p_Len = W.Len;
+    return PdqOk;
+}
+
+PdqError_t PdqStratumCtxRestoreState(PdqStratumContext_t* p_Ctx, int Socket,
+                                     const uint8_t* p_Data, uint32_t Len)
+{
+    if (p_Ctx == NULL || p_Data == NULL || Socket < 0) return PdqErrorInvalidParam;
+    if (p_Ctx->State != StratumStateDisconnected) return PdqErrorInvalidParam;
 
-    if (p_Extranonce1 && Extranonce1Len > 0) {
-        memcpy(Coinbase + CoinbaseLen, p_Extranonce1, Extranonce1Len);
-        CoinbaseLen += Extranonce1Len;
+    PdqSv2Reader_t R;
+    PdqSv2ReaderInit(&R, p_Data, Len);
+    if (PdqSv2GetU32(&R) != PDQ_STRATUM_STATE_MAGIC || PdqSv2GetU8(&R) != PDQ_STRATUM_STATE_VERSION) {
+        return PdqErrorInvalidParam;
     }
 
-    /* Clamp Extranonce2Len to prevent overflow */
-    if (Extranonce2Len > PDQ_STRATUM_MAX_EXTRANONCE_LEN) Extranonce2Len = PDQ_STRATUM_MAX_EXTRANONCE_LEN;
-    for (int i = 0; i < Extranonce2Len; i++) {
-        Coinbase[CoinbaseLen++] = (uint8_t)(Extranonce2 >> (i * 8));
+    uint8_t Extranonce1[32];
+    uint8_t Extranonce1Len = PdqSv2GetB032(&R, Extranonce1);
+    if (Extranonce1Len > PDQ_STRATUM_MAX_EXTRANONCE_LEN) R.Error = true;
+    if (!R.Error) memcpy(p_Ctx->Extranonce1, Extranonce1, Extranonce1Len);
+    p_Ctx->Extranonce1Len = R.Error ? 0 : Extranonce1Len;
+    p_Ctx->Extranonce2Size = PdqSv2GetU32(&R);
+    p_Ctx->Extranonce2Next = PdqSv2GetU32(&R);
+    p_Ctx->ExtranonceSubscribed = PdqSv2GetU8(&R) != 0;
+    PdqSv2GetStr(&R, p_Ctx->SessionId, sizeof(p_Ctx->SessionId));
+    PdqSv2GetStr(&R, p_Ctx->SessionHost, sizeof(p_Ctx->SessionHost));
+    p_Ctx->SessionPort = PdqSv2GetU16(&R);
+    uint64_t DiffBits = PdqSv2GetU64(&R);
+    memcpy(&p_Ctx->Difficulty, &DiffBits, sizeof(DiffBits));
+    p_Ctx->SubmitId = PdqSv2GetU32(&R);
+    p_Ctx->SubmitTimeoutMs = PdqSv2GetU32(&R);
+    p_Ctx->LastRxMs = PdqSv2GetU64(&R);
+    PdqSv2GetStr(&R, p_Ctx->Worker, sizeof(p_Ctx->Worker));
+    PdqSv2GetStr(&R, p_Ctx->Password, sizeof(p_Ctx->Password));
+
+    uint8_t Pending = PdqSv2GetU8(&R);
+    if (Pending > PDQ_STRATUM_MAX_PENDING_SUBMITS) R.Error = true;
+    for (uint8_t i = 0; i < Pending && !R.Error; i++) {
+        p_Ctx->Pending[i].Id = PdqSv2GetU32(&R);
+        p_Ctx->Pending[i].SentMs = PdqSv2GetU64(&R);
     }
 
-    memcpy(Coinbase + CoinbaseLen, p_StratumJob->Coinbase2, p_StratumJob->Coinbase2Len);
-    CoinbaseLen += p_StratumJob->Coinbase2Len;
+    uint32_t TxLen = PdqSv2GetU32(&R);
+    if (TxLen > PDQ_STRATUM_TX_BUFFER_SIZE) R.Error = true;
+    if (!R.Error) PdqSv2GetBytes(&R, (uint8_t*)p_Ctx->TxRing, TxLen);
+    p_Ctx->TxHead = 0;
+    p_Ctx->TxLen = R.Error ? 0 : (uint16_t)TxLen;
+
+    p_Ctx->RecvSkipLine = PdqSv2GetU8(&R) != 0;
+    uint32_t RecvLen = PdqSv2GetU32(&R);
+    if (RecvLen >= PDQ_STRATUM_RECV_BUFFER_MAX) R.Error = true;
+    while (!R.Error && p_Ctx->RecvSize <= RecvLen) {
+        if (!GrowRecvBuffer(p_Ctx)) return PdqErrorNoMemory;
+    }
+    if (!R.Error) {
+        PdqSv2GetBytes(&R, (uint8_t*)p_Ctx->p_RecvBuffer, RecvLen);
+        p_Ctx->p_RecvBuffer[RecvLen] = '\0';
+        p_Ctx->RecvLen = RecvLen;
+    }
 
-    uint8_t MerkleRoot[32];
-    PdqSha256d(Coinbase, CoinbaseLen, MerkleRoot);
+    PdqStratumJob_t* p_Job = &p_Ctx->CurrentJob;
+    memset(p_Job, 0, sizeof(*p_Job));
+    PdqSv2GetStr(&R, p_Job->JobId, sizeof(p_Job->JobId));
+    PdqSv2GetBytes(&R, p_Job->PrevBlockHash, 32);
+    p_Job->Version = PdqSv2GetU32(&R);
+    p_Job->NBits = PdqSv2GetU32(&R);
+    p_Job->NTime = PdqSv2GetU32(&R);
+    p_Job->CleanJobs = PdqSv2GetU8(&R) != 0;
+    p_Ctx->JobRxMs = PdqSv2GetU64(&R);
+
+    /* Same arena layout as a decoded notify: branches, then coinbase */
+    uint16_t BranchCount = PdqSv2GetU16(&R);
+    uint32_t BranchBytes = (uint32_t)BranchCount * 32;
+    if (R.Error || BranchBytes > R.Len - R.Pos) return PdqErrorInvalidParam;
+    const uint8_t* p_Branches = R.p_Data + R.Pos;
+    R.Pos += BranchBytes;
+    uint32_t Coinbase1Len = PdqSv2GetU32(&R);
+    if (R.Error || Coinbase1Len > R.Len - R.Pos) return PdqErrorInvalidParam;
+    const uint8_t* p_Coinbase1 = R.p_Data + R.Pos;
+    R.Pos += Coinbase1Len;
+    uint32_t Coinbase2Len = PdqSv2GetU32(&R);
+    if (R.Error || Coinbase2Len > R.Len - R.Pos) return PdqErrorInvalidParam;
+    const uint8_t* p_Coinbase2 = R.p_Data + R.Pos;
+    R.Pos += Coinbase2Len;
+
+    PdqStratumArena_t* p_Arena = &p_Ctx->JobArena[0];
+    uint32_t Need = BranchBytes + Coinbase1Len + Coinbase2Len;
+    if (Need > p_Arena->Size) {
+        uint8_t* p_Base = (uint8_t*)realloc(p_Arena->p_Base, Need ? Need : 1);
+        if (p_Base == NULL) return PdqErrorNoMemory;
+        p_Arena->p_Base = p_Base;
+        p_Arena->Size = Need;
+    }
+    if (BranchBytes) memcpy(p_Arena->p_Base, p_Branches, BranchBytes);
+    if (Coinbase1Len) memcpy(p_Arena->p_Base + BranchBytes, p_Coinbase1, Coinbase1Len);
+    if (Coinbase2Len) memcpy(p_Arena->p_Base + BranchBytes + Coinbase1Len, p_Coinbase2, Coinbase2Len);
+    p_Job->p_MerkleBranches = (const uint8_t (*)[32])p_Arena->p_Base;
+    p_Job->MerkleBranchCount = BranchCount;
+    p_Job->p_Coinbase1 = p_Arena->p_Base + BranchBytes;
+    p_Job->Coinbase1Len = Coinbase1Len;
+    p_Job->p_Coinbase2 = p_Arena->p_Base + BranchBytes + Coinbase1Len;
+    p_Job->Coinbase2Len = Coinbase2Len;
+    p_Ctx->JobArenaActive = 0;
+
+    ClearJobHistory(p_Ctx);
+    uint8_t History = PdqSv2GetU8(&R);
+    for (uint8_t i = 0; i < History && !R.Error; i++) {
+        char JobId[PDQ_STRATUM_MAX_JOBID_LEN + 1];
+        PdqSv2GetStr(&R, JobId, sizeof(JobId));
+        PushJobHistory(p_Ctx, JobId);
+    }
 
-    printf("[DBG] CoinbaseHash: ");
-    for (int i = 0; i < 32; i++) printf("%02x", MerkleRoot[i]);
-    printf("\n");
+    if (R.Error || p_Ctx->Extranonce1Len == 0 || p_Job->JobId[0] == '\0') {
+        memset(p_Ctx->Pending, 0, sizeof(p_Ctx->Pending));
+        p_Ctx->TxLen = 0;
+        p_Ctx->RecvLen = 0;
+        p_Ctx->Extranonce1Len = 0;
+        return PdqErrorInvalidParam;
+    }
 
-    for (uint8_t i = 0; i < p_StratumJob->MerkleBranchCount; i++) {
-        uint8_t Concat[64];
-        memcpy(Concat, MerkleRoot, 32);
-        memcpy(Concat + 32, p_StratumJob->MerkleBranches[i], 32);
-        PdqSha256d(Concat, 64, MerkleRoot);
-        if (i < 2) {
-            printf("[DBG] Branch[%d]: ", i);
-            for (int j = 0; j < 32; j++) printf("%02x", p_StratumJob->MerkleBranches[i][j]);
-            printf(" -> MR: ");
-            for (int j = 0; j < 32; j++) printf("%02x", MerkleRoot[j]);
-            printf("\n");
-        }
+#ifdef FD_CLOEXEC
+    fcntl(Socket, F_SETFD, FD_CLOEXEC);
+#endif
+    p_Ctx->Socket = Socket;
+    EnterState(p_Ctx, StratumStateReady);
+    p_Ctx->HasNewJob = true;
+    return PdqOk;
+}
+
+void PdqStratumArenaFree(PdqStratumArena_t* p_Arena)
+{
+    if (p_Arena == NULL) return;
+    free(p_Arena->p_Base);
+    p_Arena->p_Base = NULL;
+    p_Arena->Size = 0;
+}
+
+/* params: [job_id, prevhash, coinb1, coinb2, [branches], version, nbits,
+ * ntime, clean_jobs]. Hex fields decode straight from the receive buffer. */
+PdqError_t PdqStratumDecodeNotify(const PdqJsonDoc_t* p_Doc, int Params,
+                                  PdqStratumArena_t* p_Arena, PdqStratumJob_t* p_Job)
+{
+    if (p_Doc == NULL || p_Arena == NULL || p_Job == NULL) return PdqErrorInvalidParam;
+    if (PdqJsonTypeOf(p_Doc, Params) != PdqJsonArray || p_Doc->p_Tokens[Params].Size < 9) {
+        return PdqErrorInvalidJob;
     }
 
-    uint8_t Header[80];
-    Header[0] = (uint8_t)(p_StratumJob->Version);
-    Header[1] = (uint8_t)(p_StratumJob->Version >> 8);
-    Header[2] = (uint8_t)(p_StratumJob->Version >> 16);
-    Header[3] = (uint8_t)(p_StratumJob->Version >> 24);
+    int Field[9];
+    Field[0] = Params + 1;
+    for (int i = 1; i < 9; i++) Field[i] = p_Doc->p_Tokens[Field[i - 1]].Next;
+
+    memset(p_Job, 0, sizeof(*p_Job));
+    int32_t JobIdLen = PdqJsonGetString(p_Doc, Field[0], p_Job->JobId, sizeof(p_Job->JobId));
+    if (JobIdLen <= 0) return PdqErrorInvalidJob;
+
+    if (PdqJsonGetHex(p_Doc, Field[1], p_Job->PrevBlockHash, 32) != 32) return PdqErrorInvalidJob;
+    /* Stratum prevhash: each 4-byte word is byte-reversed (LE).
+     * Swap bytes within each word to get internal byte order
+     * for the block header. (NOT a full 32-byte reverse.) */
+    for (int w = 0; w < 8; w++) {
+        uint32_t* pw = (uint32_t*)(p_Job->PrevBlockHash + w * 4);
+        *pw = __builtin_bswap32(*pw);
+    }
 
-    memcpy(Header + 4, p_StratumJob->PrevBlockHash, 32);
-    memcpy(Header + 36, MerkleRoot, 32);
+    /* Size the arena from the message: branches first, then both
+     * coinbase halves. Hex strings hold two digits per byte. */
+    int Branches = Field[4];
+    if (PdqJsonTypeOf(p_Doc, Field[2]) != PdqJsonString ||
+        PdqJsonTypeOf(p_Doc, Field[3]) != PdqJsonString ||
+        PdqJsonTypeOf(p_Doc, Branches) != PdqJsonArray) {
+        return PdqErrorInvalidJob;
+    }
+    uint16_t BranchCount = p_Doc->p_Tokens[Branches].Size;
+    size_t Coinbase1Max = (p_Doc->p_Tokens[Field[2]].End - p_Doc->p_Tokens[Field[2]].Start) / 2;
+    size_t Coinbase2Max = (p_Doc->p_Tokens[Field[3]].End - p_Doc->p_Tokens[Field[3]].Start) / 2;
+    size_t Need = (size_t)BranchCount * 32 + Coinbase1Max + Coinbase2Max;
+    if (Need > UINT32_MAX) return PdqErrorNoMemory;
+    if (Need > p_Arena->Size) {
+        uint8_t* p_Base = (uint8_t*)realloc(p_Arena->p_Base, Need);
+        if (p_Base == NULL) return PdqErrorNoMemory;
+        p_Arena->p_Base = p_Base;
+        p_Arena->Size = (uint32_t)Need;
+    }
 
-    Header[68] = (uint8_t)(p_StratumJob->NTime);
-    Header[69] = (uint8_t)(p_StratumJob->NTime >> 8);
-    Header[70] = (uint8_t)(p_StratumJob->NTime >> 16);
-    Header[71] = (uint8_t)(p_StratumJob->NTime >> 24);
+    uint8_t (*p_Branches)[32] = (uint8_t (*)[32])p_Arena->p_Base;
+    uint8_t* p_Coinbase1 = p_Arena->p_Base + (size_t)BranchCount * 32;
+    uint8_t* p_Coinbase2 = p_Coinbase1 + Coinbase1Max;
+
+    int32_t Len = PdqJsonGetHex(p_Doc, Field[2], p_Coinbase1, Coinbase1Max);
+    if (Len < 0) return PdqErrorInvalidJob;
+    p_Job->p_Coinbase1 = p_Coinbase1;
+    p_Job->Coinbase1Len = (uint32_t)Len;
+    Len = PdqJsonGetHex(p_Doc, Field[3], p_Coinbase2, Coinbase2Max);
+    if (Len < 0) return PdqErrorInvalidJob;
+    p_Job->p_Coinbase2 = p_Coinbase2;
+    p_Job->Coinbase2Len = (uint32_t)Len;
+
+    /* A truncated branch list would mine a wrong merkle root */
+    int Branch = Branches + 1;
+    for (uint16_t i = 0; i < BranchCount; i++) {
+        if (PdqJsonGetHex(p_Doc, Branch, p_Branches[i], 32) != 32) return PdqErrorInvalidJob;
+        Branch = p_Doc->p_Tokens[Branch].Next;
+    }
+    p_Job->p_MerkleBranches = (const uint8_t (*)[32])p_Branches;
+    p_Job->MerkleBranchCount = BranchCount;
 
-    Header[72] = (uint8_t)(p_StratumJob->NBits);
-    Header[73] = (uint8_t)(p_StratumJob->NBits >> 8);
-    Header[74] = (uint8_t)(p_StratumJob->NBits >> 16);
-    Header[75] = (uint8_t)(p_StratumJob->NBits >> 24);
+    if (!PdqJsonGetHexU32(p_Doc, Field[5], &p_Job->Version) ||
+        !PdqJsonGetHexU32(p_Doc, Field[6], &p_Job->NBits) ||
+        !PdqJsonGetHexU32(p_Doc, Field[7], &p_Job->NTime)) {
+        return PdqErrorInvalidJob;
+    }
 
-    memset(Header + 76, 0, 4);
+    PdqJsonType_t Clean = PdqJsonTypeOf(p_Doc, Field[8]);
+    if (Clean != PdqJsonTrue && Clean != PdqJsonFalse) return PdqErrorInvalidJob;
+    p_Job->CleanJobs = (Clean == PdqJsonTrue);
+    return PdqOk;
+}
 
-    /* Debug: print extranonce1, merkle root, coinbase, and full header */
-    printf("[DBG] EN1(%d): ", Extranonce1Len);
-    for (int i = 0; i < Extranonce1Len; i++) printf("%02x", p_Extranonce1[i]);
-    printf("\n");
-    printf("[DBG] EN2(%d): ", Extranonce2Len);
-    for (int i = 0; i < Extranonce2Len; i++) printf("%02x", (uint8_t)(Extranonce2 >> (i * 8)));
-    printf("\n");
-    printf("[DBG] Coinbase(%d): ", (int)CoinbaseLen);
-    for (size_t i = 0; i < CoinbaseLen; i++) printf("%02x", Coinbase[i]);
-    printf("\n");
-    printf("[DBG] MerkleRoot: ");
-    for (int i = 0; i < 32; i++) printf("%02x", MerkleRoot[i]);
-    printf("\n");
-    printf("[DBG] Header(80B): ");
-    for (int i = 0; i < 80; i++) printf("%02x", Header[i]);
-    printf("\n");
+PdqError_t PdqStratumHeaderToMiningJob(const uint8_t* p_Header, PdqMiningJob_t* p_MiningJob)
+{
+    if (p_Header == NULL || p_MiningJob == NULL) return PdqErrorInvalidParam;
 
-    PdqSha256Midstate(Header, p_MiningJob->Midstate);
+    PdqSha256Midstate(p_Header, p_MiningJob->Midstate);
 
-    memcpy(p_MiningJob->BlockTail, Header + 64, 16);
+    memcpy(p_MiningJob->BlockTail, p_Header + 64, 16);
     p_MiningJob->BlockTail[16] = 0x80;
     memset(p_MiningJob->BlockTail + 17, 0, 45);
     p_MiningJob->BlockTail[62] = 0x02;
@@ -795,7 +1761,9 @@ PdqError_t PdqStratumBuildMiningJob(const PdqStratumJob_t* p_StratumJob,
     /* Prepare byte-swapped header + padding for HW SHA engine (ESP32-D0).
      * The HW SHA peripheral expects big-endian words written to registers. */
     for (int i = 0; i < 20; i++) {
-        p_MiningJob->HeaderSwapped[i] = __builtin_bswap32(((const uint32_t*)Header)[i]);
+        uint32_t Word;
+        memcpy(&Word, p_Header + i * 4, 4);
+        p_MiningJob->HeaderSwapped[i] = __builtin_bswap32(Word);
     }
     /* SHA padding for 80 bytes: 0x80 byte, zeros, then length = 640 bits = 0x280 */
     p_MiningJob->HeaderSwapped[20] = 0x80000000;
@@ -804,7 +1772,105 @@ PdqError_t PdqStratumBuildMiningJob(const PdqStratumJob_t* p_StratumJob,
     }
     p_MiningJob->HeaderSwapped[31] = 0x00000280;
 
-    DifficultyToTarget(Difficulty, p_MiningJob->Target);
+    uint32_t NBits = (uint32_t)p_Header[72] | ((uint32_t)p_Header[73] << 8) |
+                     ((uint32_t)p_Header[74] << 16) | ((uint32_t)p_Header[75] << 24);
+    if (PdqTargetFromNBits(NBits, p_MiningJob->NetworkTarget) != PdqOk) {
+        printf("[STRATUM] Invalid nbits %08x, block detection off\n", (unsigned)NBits);
+    }
+    return PdqOk;
+}
+
+PdqError_t PdqStratumBuildHeader(const PdqStratumJob_t* p_StratumJob,
+                                 const uint8_t* p_Extranonce1, uint8_t Extranonce1Len,
+                                 const uint8_t* p_Extranonce2, uint8_t Extranonce2Len,
+                                 uint8_t* p_Header)
+{
+    if (p_StratumJob == NULL || p_Header == NULL) return PdqErrorInvalidParam;
+
+    /* Hash the coinbase pieces in place rather than assembling a copy,
+     * so its length is bounded only by what the job decoder accepted. */
+    PdqSha256Context_t Sha;
+    uint8_t MerkleRoot[32];
+    PdqSha256Init(&Sha);
+    PdqSha256Update(&Sha, p_StratumJob->p_Coinbase1, p_StratumJob->Coinbase1Len);
+    if (p_Extranonce1 && Extranonce1Len > 0) PdqSha256Update(&Sha, p_Extranonce1, Extranonce1Len);
+    if (p_Extranonce2 && Extranonce2Len > 0) PdqSha256Update(&Sha, p_Extranonce2, Extranonce2Len);
+    PdqSha256Update(&Sha, p_StratumJob->p_Coinbase2, p_StratumJob->Coinbase2Len);
+    PdqSha256Final(&Sha, MerkleRoot);
+    PdqSha256(MerkleRoot, 32, MerkleRoot);
+
+    for (uint16_t i = 0; i < p_StratumJob->MerkleBranchCount; i++) {
+        uint8_t Concat[64];
+        memcpy(Concat, MerkleRoot, 32);
+        memcpy(Concat + 32, p_StratumJob->p_MerkleBranches[i], 32);
+        PdqSha256d(Concat, 64, MerkleRoot);
+    }
+
+    p_Header[0] = (uint8_t)(p_StratumJob->Version);
+    p_Header[1] = (uint8_t)(p_StratumJob->Version >> 8);
+    p_Header[2] = (uint8_t)(p_StratumJob->Version >> 16);
+    p_Header[3] = (uint8_t)(p_StratumJob->Version >> 24);
+
+    memcpy(p_Header + 4, p_StratumJob->PrevBlockHash, 32);
+    memcpy(p_Header + 36, MerkleRoot, 32);
+
+    p_Header[68] = (uint8_t)(p_StratumJob->NTime);
+    p_Header[69] = (uint8_t)(p_StratumJob->NTime >> 8);
+    p_Header[70] = (uint8_t)(p_StratumJob->NTime >> 16);
+    p_Header[71] = (uint8_t)(p_StratumJob->NTime >> 24);
+
+    p_Header[72] = (uint8_t)(p_StratumJob->NBits);
+    p_Header[73] = (uint8_t)(p_StratumJob->NBits >> 8);
+    p_Header[74] = (uint8_t)(p_StratumJob->NBits >> 16);
+    p_Header[75] = (uint8_t)(p_StratumJob->NBits >> 24);
+
+    memset(p_Header + 76, 0, 4);
+    return PdqOk;
+}
+
+PdqError_t PdqStratumBuildMiningJob(const PdqStratumJob_t* p_StratumJob,
+                                     const uint8_t* p_Extranonce1, uint8_t Extranonce1Len,
+                                     uint32_t Extranonce2, uint8_t Extranonce2Len,
+                                     double Difficulty,
+                                     PdqMiningJob_t* p_MiningJob)
+{
+    if (p_StratumJob == NULL || p_MiningJob == NULL) return PdqErrorInvalidParam;
+
+    memset(p_MiningJob, 0, sizeof(PdqMiningJob_t));
+
+    if (Extranonce2Len > PDQ_STRATUM_MAX_EXTRANONCE_LEN) Extranonce2Len = PDQ_STRATUM_MAX_EXTRANONCE_LEN;
+    uint8_t Extranonce2Bytes[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    for (int i = 0; i < Extranonce2Len; i++) {
+        Extranonce2Bytes[i] = (uint8_t)(Extranonce2 >> (i * 8));
+    }
+
+    uint8_t Header[80];
+    PdqStratumBuildHeader(p_StratumJob, p_Extranonce1, Extranonce1Len,
+                          Extranonce2Bytes, Extranonce2Len, Header);
+
+    /* Debug: print extranonce1, merkle root, coinbase, and full header */
+    printf("[DBG] EN1(%d): ", Extranonce1Len);
+    for (int i = 0; i < Extranonce1Len; i++) printf("%02x", p_Extranonce1[i]);
+    printf("\n");
+    printf("[DBG] EN2(%d): ", Extranonce2Len);
+    for (int i = 0; i < Extranonce2Len; i++) printf("%02x", Extranonce2Bytes[i]);
+    printf("\n");
+    printf("[DBG] Coinbase(%u): ", (unsigned)(p_StratumJob->Coinbase1Len + Extranonce1Len +
+                                               Extranonce2Len + p_StratumJob->Coinbase2Len));
+    for (uint32_t i = 0; i < p_StratumJob->Coinbase1Len; i++) printf("%02x", p_StratumJob->p_Coinbase1[i]);
+    for (int i = 0; i < Extranonce1Len; i++) printf("%02x", p_Extranonce1[i]);
+    for (int i = 0; i < Extranonce2Len; i++) printf("%02x", Extranonce2Bytes[i]);
+    for (uint32_t i = 0; i < p_StratumJob->Coinbase2Len; i++) printf("%02x", p_StratumJob->p_Coinbase2[i]);
+    printf("\n");
+    printf("[DBG] MerkleRoot: ");
+    for (int i = 36; i < 68; i++) printf("%02x", Header[i]);
+    printf("\n");
+    printf("[DBG] Header(80B): ");
+    for (int i = 0; i < 80; i++) printf("%02x", Header[i]);
+    printf("\n");
+
+    PdqStratumHeaderToMiningJob(Header, p_MiningJob);
+    PdqTargetFromDifficulty(Difficulty, p_MiningJob->Target);
 
     strncpy(p_MiningJob->JobId, p_StratumJob->JobId, 64);
     p_MiningJob->JobId[64] = '\0';
@@ -812,4 +1878,116 @@ PdqError_t PdqStratumBuildMiningJob(const PdqStratumJob_t* p_StratumJob,
     p_MiningJob->NTime = p_StratumJob->NTime;
 
     return PdqOk;
-}
\ No newline at end of file
+}
+
+// Single-session API, backed by the default context
+
+PdqStratumContext_t* PdqStratumGetDefaultContext(void)
+{
+    return &s_DefaultCtx;
+}
+
+void PdqStratumFlushDnsCache(void)
+{
+    memset(s_DnsCache, 0, sizeof(s_DnsCache));
+}
+
+PdqError_t PdqStratumInit(void)
+{
+    return PdqStratumCtxInit(&s_DefaultCtx);
+}
+
+PdqError_t PdqStratumConnect(const char* p_Host, uint16_t Port)
+{
+    return PdqStratumCtxConnect(&s_DefaultCtx, p_Host, Port);
+}
+
+PdqError_t PdqStratumConnectStart(const char* p_Host, uint16_t Port)
+{
+    return PdqStratumCtxConnectStart(&s_DefaultCtx, p_Host, Port);
+}
+
+PdqError_t PdqStratumDisconnect(void)
+{
+    return PdqStratumCtxDisconnect(&s_DefaultCtx);
+}
+
+PdqError_t PdqStratumSubscribe(void)
+{
+    return PdqStratumCtxSubscribe(&s_DefaultCtx);
+}
+
+PdqError_t PdqStratumSuggestDifficulty(double Difficulty)
+{
+    return PdqStratumCtxSuggestDifficulty(&s_DefaultCtx, Difficulty);
+}
+
+PdqError_t PdqStratumAuthorize(const char* p_Worker, const char* p_Password)
+{
+    return PdqStratumCtxAuthorize(&s_DefaultCtx, p_Worker, p_Password);
+}
+
+PdqError_t PdqStratumSubmitShare(const char* p_JobId, uint32_t Extranonce2, uint32_t Nonce, uint32_t NTime)
+{
+    return PdqStratumCtxSubmitShare(&s_DefaultCtx, p_JobId, Extranonce2, Nonce, NTime);
+}
+
+PdqError_t PdqStratumProcess(void)
+{
+    return PdqStratumCtxProcess(&s_DefaultCtx);
+}
+
+bool PdqStratumIsConnected(void)
+{
+    return PdqStratumCtxIsConnected(&s_DefaultCtx);
+}
+
+bool PdqStratumIsReady(void)
+{
+    return PdqStratumCtxIsReady(&s_DefaultCtx);
+}
+
+bool PdqStratumHasNewJob(void)
+{
+    return PdqStratumCtxHasNewJob(&s_DefaultCtx);
+}
+
+PdqStratumState_t PdqStratumGetState(void)
+{
+    return PdqStratumCtxGetState(&s_DefaultCtx);
+}
+
+int PdqStratumGetSocket(void)
+{
+    return PdqStratumCtxGetSocket(&s_DefaultCtx);
+}
+
+uint64_t PdqStratumGetLastRxMs(void)
+{
+    return PdqStratumCtxGetLastRxMs(&s_DefaultCtx);
+}
+
+int PdqStratumGetPollFd(bool* p_WantWrite)
+{
+    return PdqStratumCtxGetPollFd(&s_DefaultCtx, p_WantWrite);
+}
+
+PdqError_t PdqStratumGetJob(PdqStratumJob_t* p_Job)
+{
+    return PdqStratumCtxGetJob(&s_DefaultCtx, p_Job);
+}
+
+double PdqStratumGetDifficulty(void)
+{
+    return PdqStratumCtxGetDifficulty(&s_DefaultCtx);
+}
+
+void PdqStratumGetExtranonce(uint8_t* p_Buffer, uint8_t* p_Len)
+{
+    PdqStratumCtxGetExtranonce(&s_DefaultCtx, p_Buffer, p_Len);
+}
+
+uint8_t PdqStratumGetExtranonce2Size(void)
+{
+    return PdqStratumCtxGetExtranonce2Size(&s_DefaultCtx);
+}
@@ -9,6 +9,7 @@
 #define PDQ_STRATUM_CLIENT_H
 
 #include "pdq_types.h"
+#include "stratum_json.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,29 +17,60 @@ extern "C" {
 
 #define PDQ_STRATUM_MAX_JOBID_LEN       64
 #define PDQ_STRATUM_MAX_EXTRANONCE_LEN  8
-#define PDQ_STRATUM_MAX_COINBASE_LEN    256
-#define PDQ_STRATUM_MAX_MERKLE_BRANCHES 16
-#define PDQ_STRATUM_RECV_BUFFER_SIZE    4096
+#define PDQ_STRATUM_RECV_BUFFER_SIZE    4096    /* Initial size; doubles for long lines */
+#ifndef PDQ_STRATUM_RECV_BUFFER_MAX
+#define PDQ_STRATUM_RECV_BUFFER_MAX     65536   /* Longest line kept; longer ones are dropped */
+#endif
 #define PDQ_STRATUM_SEND_BUFFER_SIZE    512
 #define PDQ_STRATUM_DEFAULT_TIMEOUT_MS  30000
+#define PDQ_STRATUM_RESOLVE_TIMEOUT_MS  10000
+#define PDQ_STRATUM_CONNECT_TIMEOUT_MS  10000
+#define PDQ_STRATUM_HANDSHAKE_TIMEOUT_MS 30000
+#define PDQ_STRATUM_MAX_ADDRS           8       /* Resolved addresses raced per connect */
+#define PDQ_STRATUM_ATTEMPT_DELAY_MS    250     /* Head start per address (RFC 8305) */
+#define PDQ_STRATUM_DNS_CACHE_SIZE      4
+#define PDQ_STRATUM_DNS_CACHE_TTL_MS    300000
+#define PDQ_STRATUM_MAX_PENDING_SUBMITS 32
+#define PDQ_STRATUM_SUBMIT_TIMEOUT_MS   60000
+#define PDQ_STRATUM_MAX_REJECT_CODES    8
+#define PDQ_STRATUM_TX_BUFFER_SIZE      4096    /* Outbound queue, several submits deep */
+#define PDQ_STRATUM_MAX_TOKENS          64      /* Initial JSON tokens per line; grows */
+#define PDQ_STRATUM_MAX_SESSION_ID_LEN  64
+#define PDQ_STRATUM_JOB_HISTORY         8       /* Recent job ids still accepted for submit */
+#define PDQ_STRATUM_RESUME_MAX_AGE_MS   120000  /* Older cached jobs are not mined on resume */
+#define PDQ_STRATUM_MIN_DIFFICULTY      1.0     /* Floor for set_difficulty and suggestions */
+#define PDQ_STRATUM_STATE_MAGIC         0x53514450u /* "PDQS", leads a saved session */
+#define PDQ_STRATUM_STATE_VERSION       1
+
+/* Backing store for a job's coinbase halves and merkle branches. It is
+ * sized from each notify and never shrinks, so once it has held the
+ * largest job a pool sends, decoding allocates nothing. */
+typedef struct {
+    uint8_t* p_Base;
+    uint32_t Size;
+} PdqStratumArena_t;
 
+/* The coinbase and branch pointers refer to the arena the job was decoded
+ * into; a job taken from a context stays valid until the context decodes
+ * its next mining.notify. */
 typedef struct {
-    char     JobId[PDQ_STRATUM_MAX_JOBID_LEN + 1];
-    uint8_t  PrevBlockHash[32];
-    uint8_t  Coinbase1[PDQ_STRATUM_MAX_COINBASE_LEN];
-    uint16_t Coinbase1Len;
-    uint8_t  Coinbase2[PDQ_STRATUM_MAX_COINBASE_LEN];
-    uint16_t Coinbase2Len;
-    uint8_t  MerkleBranches[PDQ_STRATUM_MAX_MERKLE_BRANCHES][32];
-    uint8_t  MerkleBranchCount;
-    uint32_t Version;
-    uint32_t NBits;
-    uint32_t NTime;
-    bool     CleanJobs;
+    char           JobId[PDQ_STRATUM_MAX_JOBID_LEN + 1];
+    uint8_t        PrevBlockHash[32];
+    const uint8_t* p_Coinbase1;
+    uint32_t       Coinbase1Len;
+    const uint8_t* p_Coinbase2;
+    uint32_t       Coinbase2Len;
+    const uint8_t (*p_MerkleBranches)[32];
+    uint16_t       MerkleBranchCount;
+    uint32_t       Version;
+    uint32_t       NBits;
+    uint32_t       NTime;
+    bool           CleanJobs;
 } PdqStratumJob_t;
 
 typedef enum {
     StratumStateDisconnected = 0,
+    StratumStateResolving,
     StratumStateConnecting,
     StratumStateConnected,
     StratumStateSubscribing,
@@ -48,8 +80,203 @@ typedef enum {
     StratumStateReady
 } PdqStratumState_t;
 
+struct PdqStratumResolve;
+
+/* mining.submit waiting for the pool's reply. Id 0 marks a free slot. */
+typedef struct {
+    uint32_t Id;
+    uint64_t SentMs;
+} PdqStratumPendingSubmit_t;
+
+typedef struct {
+    uint32_t Submitted;
+    uint32_t Accepted;
+    uint32_t Rejected;
+    uint32_t TimedOut;
+    uint32_t Unmatched;         /* Replies to ids no longer pending */
+    int32_t  RejectCodes[PDQ_STRATUM_MAX_REJECT_CODES];
+    uint32_t RejectCounts[PDQ_STRATUM_MAX_REJECT_CODES];
+    uint32_t RejectOther;       /* Codes beyond the table */
+    uint32_t StaleDropped;      /* Shares for retired jobs, never sent */
+    uint32_t LatencyHist[PDQ_SUBMIT_LATENCY_BUCKETS];
+    uint64_t LatencySumMs;
+    uint32_t LatencyMaxMs;
+} PdqStratumSubmitStats_t;
+
+/* Outbound queue counters. QueuedPeak is the high-water mark in bytes. */
+typedef struct {
+    uint32_t Messages;          /* Lines queued */
+    uint32_t Writes;            /* sendmsg() calls that moved data */
+    uint64_t Bytes;
+    uint32_t PartialWrites;     /* Socket took less than was queued */
+    uint32_t Overflows;         /* Lines refused, queue full */
+    uint32_t QueuedPeak;
+} PdqStratumTxStats_t;
+
+/* Called once per submit when the pool answers or the entry times out */
+typedef void (*PdqStratumSubmitCallback_t)(void* p_Arg, PdqSubmitResult_t Result,
+                                           int32_t ErrorCode, uint32_t LatencyMs);
+
+/* Called with every line sent to or received from the pool, without its
+ * newline. Used to record sessions. */
+typedef void (*PdqStratumLineCallback_t)(void* p_Arg, bool Outbound, const char* p_Line, size_t Len);
+
+/* One pool session. Callers that need more than one session (hot standby,
+ * multi-pool) own their contexts and use the PdqStratumCtx* API; the
+ * classic PdqStratum* API below operates on a built-in default context. */
+typedef struct {
+    PdqStratumState_t         State;
+    int                       Socket;
+    uint64_t                  StageStartMs;
+    uint64_t                  LastRxMs;
+    struct PdqStratumResolve* p_Resolve;
+    char*                     p_RecvBuffer; /* Grows up to PDQ_STRATUM_RECV_BUFFER_MAX */
+    uint32_t                  RecvSize;
+    uint32_t                  RecvLen;
+    bool                      RecvSkipLine; /* Dropping the rest of an over-long line */
+    PdqJsonToken_t*           p_Tokens;
+    uint16_t                  TokenCap;
+    uint32_t                  RxMalformed;  /* Lines that failed to parse */
+    uint32_t                  RxOversize;   /* Lines longer than the receive buffer */
+    char                      SendBuffer[PDQ_STRATUM_SEND_BUFFER_SIZE];
+    char                      TxRing[PDQ_STRATUM_TX_BUFFER_SIZE];
+    uint16_t                  TxHead;       /* Oldest unsent byte */
+    uint16_t                  TxLen;
+    bool                      TxCorked;     /* Queue without writing */
+    PdqStratumTxStats_t       TxStats;
+    uint8_t                   Extranonce1[PDQ_STRATUM_MAX_EXTRANONCE_LEN];
+    uint8_t                   Extranonce1Len;
+    uint32_t                  Extranonce2Size;
+    uint32_t                  Extranonce2Next;  /* Last value used by BuildNextJob */
+    bool                      ExtranonceSubscribed; /* Pool accepted extranonce.subscribe */
+    uint32_t                  ExtranonceUpdates;    /* mining.set_extranonce applied */
+    uint32_t                  ExtranonceGen;    /* Bumped whenever extranonce1 is replaced */
+    char                      SessionId[PDQ_STRATUM_MAX_SESSION_ID_LEN + 1]; /* Offered on resubscribe */
+    char                      SessionHost[PDQ_MAX_HOST_LEN + 1];  /* Pool that issued SessionId */
+    uint16_t                  SessionPort;
+    bool                      SessionOffered;
+    bool                      Resumed;      /* Pool kept our session on this connection */
+    uint32_t                  Resumes;
+    double                    Difficulty;
+    uint32_t                  SubmitId;
+    uint32_t                  SubmitTimeoutMs;
+    PdqStratumPendingSubmit_t Pending[PDQ_STRATUM_MAX_PENDING_SUBMITS];
+    PdqStratumSubmitStats_t   SubmitStats;
+    PdqStratumSubmitCallback_t p_OnSubmit;
+    void*                     p_OnSubmitArg;
+    PdqStratumLineCallback_t  p_OnLine;
+    void*                     p_OnLineArg;
+    PdqStratumJob_t           CurrentJob;
+    uint64_t                  JobRxMs;      /* When CurrentJob arrived */
+    char                      JobHistory[PDQ_STRATUM_JOB_HISTORY][PDQ_STRATUM_MAX_JOBID_LEN + 1];
+    uint8_t                   JobHistoryCount;
+    uint8_t                   JobHistoryNext;   /* Slot the next job id goes in */
+    PdqStratumArena_t         JobArena[2];  /* CurrentJob's and the next notify's */
+    uint8_t                   JobArenaActive;
+    bool                      HasNewJob;
+    char                      Worker[PDQ_MAX_WORKER_LEN + 1];
+    char                      Password[PDQ_MAX_PASSWORD_LEN + 1];
+} PdqStratumContext_t;
+
+/* Init does not free; PdqStratumCtxRelease gives back the receive, token
+ * and job buffers of a context that is no longer used. Buffers are
+ * allocated on first use, so a released context can be used again. */
+PdqError_t        PdqStratumCtxInit(PdqStratumContext_t* p_Ctx);
+void              PdqStratumCtxRelease(PdqStratumContext_t* p_Ctx);
+PdqError_t        PdqStratumCtxConnect(PdqStratumContext_t* p_Ctx, const char* p_Host, uint16_t Port);
+PdqError_t        PdqStratumCtxConnectStart(PdqStratumContext_t* p_Ctx, const char* p_Host, uint16_t Port);
+PdqError_t        PdqStratumCtxDisconnect(PdqStratumContext_t* p_Ctx);
+PdqError_t        PdqStratumCtxSubscribe(PdqStratumContext_t* p_Ctx);
+PdqError_t        PdqStratumCtxSuggestDifficulty(PdqStratumContext_t* p_Ctx, double Difficulty);
+PdqError_t        PdqStratumCtxAuthorize(PdqStratumContext_t* p_Ctx, const char* p_Worker, const char* p_Password);
+PdqError_t        PdqStratumCtxSubmitShare(PdqStratumContext_t* p_Ctx, const char* p_JobId,
+                                           uint32_t Extranonce2, uint32_t Nonce, uint32_t NTime);
+/* Same, with the extranonce2 bytes as they go into the coinbase. Used
+ * when the extranonce2 is wider than 32 bits or built elsewhere, as for
+ * shares a proxy forwards from its downstream miners. */
+PdqError_t        PdqStratumCtxSubmitShareBytes(PdqStratumContext_t* p_Ctx, const char* p_JobId,
+                                                const uint8_t* p_Extranonce2, uint8_t Extranonce2Len,
+                                                uint32_t Nonce, uint32_t NTime);
+/* Same, for a share mined on a job from PdqStratumCtxBuildNextJob. A
+ * share hashed on an extranonce1 the pool has since replaced is dropped
+ * like one for a retired job: its job id may well still be active. */
+PdqError_t        PdqStratumCtxSubmitMinedShare(PdqStratumContext_t* p_Ctx, const PdqShareInfo_t* p_Share);
+PdqError_t        PdqStratumCtxProcess(PdqStratumContext_t* p_Ctx);
+
+bool              PdqStratumCtxIsConnected(const PdqStratumContext_t* p_Ctx);
+bool              PdqStratumCtxIsReady(const PdqStratumContext_t* p_Ctx);
+bool              PdqStratumCtxHasNewJob(PdqStratumContext_t* p_Ctx);
+PdqStratumState_t PdqStratumCtxGetState(const PdqStratumContext_t* p_Ctx);
+int               PdqStratumCtxGetSocket(const PdqStratumContext_t* p_Ctx);
+uint64_t          PdqStratumCtxGetLastRxMs(const PdqStratumContext_t* p_Ctx);
+int               PdqStratumCtxGetPollFd(const PdqStratumContext_t* p_Ctx, bool* p_WantWrite);
+
+/* Every descriptor to watch; several while connects to different
+ * addresses race each other. Returns the number written to p_Fds. */
+int               PdqStratumCtxGetPollFds(const PdqStratumContext_t* p_Ctx, int* p_Fds, int MaxFds,
+                                          bool* p_WantWrite);
+
+/* Milliseconds until the next staggered connect attempt is due, or -1
+ * when none is pending. Event loops use it as their wait timeout. */
+int               PdqStratumCtxGetWakeupMs(const PdqStratumContext_t* p_Ctx);
+PdqError_t        PdqStratumCtxGetJob(const PdqStratumContext_t* p_Ctx, PdqStratumJob_t* p_Job);
+double            PdqStratumCtxGetDifficulty(const PdqStratumContext_t* p_Ctx);
+void              PdqStratumCtxGetExtranonce(const PdqStratumContext_t* p_Ctx, uint8_t* p_Buffer, uint8_t* p_Len);
+uint8_t           PdqStratumCtxGetExtranonce2Size(const PdqStratumContext_t* p_Ctx);
+
+/* Submit accounting. Stats survive reconnects; submits still pending
+ * when the session closes are counted as timed out. */
+void              PdqStratumCtxSetSubmitCallback(PdqStratumContext_t* p_Ctx,
+                                                 PdqStratumSubmitCallback_t Callback, void* p_Arg);
+void              PdqStratumCtxGetSubmitStats(const PdqStratumContext_t* p_Ctx,
+                                              PdqStratumSubmitStats_t* p_Stats);
+uint32_t          PdqStratumCtxGetPendingSubmits(const PdqStratumContext_t* p_Ctx);
+
+/* Line tap for session recording; NULL removes it. Lines a full send
+ * queue refuses are not reported. */
+void              PdqStratumCtxSetLineCallback(PdqStratumContext_t* p_Ctx,
+                                               PdqStratumLineCallback_t Callback, void* p_Arg);
+
+/* Whether shares for this job id would still be accepted: it is one of
+ * the last PDQ_STRATUM_JOB_HISTORY jobs since the last clean_jobs,
+ * prevhash change or new session. SubmitShare drops other shares
+ * with PdqErrorInvalidJob and reports them as PdqSubmitStale. */
+bool              PdqStratumCtxIsJobActive(const PdqStratumContext_t* p_Ctx, const char* p_JobId);
+
+/* Outbound queue. Messages are queued and written immediately unless
+ * the context is corked; uncorking writes everything queued in one
+ * call. A socket that takes only part of the queue keeps the rest for
+ * the next PdqStratumCtxProcess(), and GetPollFds asks for writability
+ * until it is gone. */
+PdqError_t        PdqStratumCtxCork(PdqStratumContext_t* p_Ctx, bool Cork);
+PdqError_t        PdqStratumCtxFlush(PdqStratumContext_t* p_Ctx);
+uint32_t          PdqStratumCtxGetTxQueued(const PdqStratumContext_t* p_Ctx);
+uint32_t          PdqStratumCtxGetTxSpace(const PdqStratumContext_t* p_Ctx);
+void              PdqStratumCtxGetTxStats(const PdqStratumContext_t* p_Ctx, PdqStratumTxStats_t* p_Stats);
+
+/* Build the context's current job with its next extranonce2 value */
+PdqError_t        PdqStratumCtxBuildNextJob(PdqStratumContext_t* p_Ctx, PdqMiningJob_t* p_MiningJob);
+
+/* Session handoff for binary upgrades. SaveState serializes a Ready
+ * session: subscription, extranonce2 counter, current job and job
+ * history, submits awaiting a reply, unsent output and a partly received
+ * line. RestoreState rebuilds it around the inherited socket in an
+ * initialized context of the new process, which is Ready with the saved
+ * job reported as new. StateSize bounds what SaveState writes. */
+uint32_t          PdqStratumCtxStateSize(const PdqStratumContext_t* p_Ctx);
+PdqError_t        PdqStratumCtxSaveState(const PdqStratumContext_t* p_Ctx, uint8_t* p_Buffer,
+                                         uint32_t Size, uint32_t* p_Len);
+PdqError_t        PdqStratumCtxRestoreState(PdqStratumContext_t* p_Ctx, int Socket,
+                                            const uint8_t* p_Data, uint32_t Len);
+
+PdqStratumContext_t* PdqStratumGetDefaultContext(void);
+
+/* Forget all cached pool addresses; the next connect resolves again */
+void              PdqStratumFlushDnsCache(void);
+
 PdqError_t PdqStratumInit(void);
 PdqError_t PdqStratumConnect(const char* p_Host, uint16_t Port);
+PdqError_t PdqStratumConnectStart(const char* p_Host, uint16_t Port);
 PdqError_t PdqStratumDisconnect(void);
 PdqError_t PdqStratumSubscribe(void);
 PdqError_t PdqStratumSuggestDifficulty(double Difficulty);
@@ -61,10 +288,31 @@ bool              PdqStratumIsConnected(void);
 bool              PdqStratumIsReady(void);
 bool              PdqStratumHasNewJob(void);
 PdqStratumState_t PdqStratumGetState(void);
+int               PdqStratumGetSocket(void);
+uint64_t          PdqStratumGetLastRxMs(void);
+int               PdqStratumGetPollFd(bool* p_WantWrite);
 PdqError_t        PdqStratumGetJob(PdqStratumJob_t* p_Job);
 double            PdqStratumGetDifficulty(void);
 void              PdqStratumGetExtranonce(uint8_t* p_Buffer, uint8_t* p_Len);
 uint8_t           PdqStratumGetExtranonce2Size(void);
+/* Decode mining.notify params (token index Params of a parsed message).
+ * Coinbase and branches are stored in p_Arena, which grows to fit.
+ * Rejects missing fields and bad hex. */
+PdqError_t        PdqStratumDecodeNotify(const PdqJsonDoc_t* p_Doc, int Params,
+                                         PdqStratumArena_t* p_Arena, PdqStratumJob_t* p_Job);
+void              PdqStratumArenaFree(PdqStratumArena_t* p_Arena);
+/* Midstate, tail, word-swapped header and network target of an 80-byte
+ * header. Leaves the share target, job id and nonce range to the caller;
+ * shared by every protocol that ends up with a header. */
+PdqError_t        PdqStratumHeaderToMiningJob(const uint8_t* p_Header, PdqMiningJob_t* p_MiningJob);
+
+/* The 80-byte header of a job for one extranonce pair, nonce zero.
+ * Computes the coinbase hash and merkle root; prints nothing. */
+PdqError_t        PdqStratumBuildHeader(const PdqStratumJob_t* p_StratumJob,
+                                        const uint8_t* p_Extranonce1, uint8_t Extranonce1Len,
+                                        const uint8_t* p_Extranonce2, uint8_t Extranonce2Len,
+                                        uint8_t* p_Header);
+
 PdqError_t        PdqStratumBuildMiningJob(const PdqStratumJob_t* p_StratumJob,
                                            const uint8_t* p_Extranonce1, uint8_t Extranonce1Len,
                                            uint32_t Extranonce2, uint8_t Extranonce2Len,
@@ -0,0 +1,372 @@
+/**
+ * @file stratum_json.c
+ * @brief Single-pass JSON tokenizer for Stratum messages
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "stratum_json.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+
+typedef struct {
+    const char*     p_Json;
+    size_t          Len;
+    size_t          Pos;
+    PdqJsonToken_t* p_Tokens;
+    uint16_t        MaxTokens;
+    uint16_t        Count;
+    bool            OutOfTokens;
+} JsonParser_t;
+
+static bool ParseValue(JsonParser_t* p_Parser, uint8_t Depth);
+
+/* Nibble value + 1 for hex digits, 0 for everything else */
+static const uint8_t s_HexValue[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+static int32_t HexNibble(char c)
+{
+    return (int32_t)s_HexValue[(uint8_t)c] - 1;
+}
+
+static void SkipSpace(JsonParser_t* p_Parser)
+{
+    while (p_Parser->Pos < p_Parser->Len) {
+        char c = p_Parser->p_Json[p_Parser->Pos];
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n') break;
+        p_Parser->Pos++;
+    }
+}
+
+static int NewToken(JsonParser_t* p_Parser, PdqJsonType_t Type, size_t Start)
+{
+    if (p_Parser->Count >= p_Parser->MaxTokens) {
+        p_Parser->OutOfTokens = true;
+        return -1;
+    }
+    int Index = p_Parser->Count++;
+    PdqJsonToken_t* p_Tok = &p_Parser->p_Tokens[Index];
+    p_Tok->Start = (uint32_t)Start;
+    p_Tok->End = (uint32_t)Start;
+    p_Tok->Next = (uint16_t)(Index + 1);
+    p_Tok->Size = 0;
+    p_Tok->Type = (uint8_t)Type;
+    return Index;
+}
+
+static bool ParseString(JsonParser_t* p_Parser)
+{
+    int Index = NewToken(p_Parser, PdqJsonString, p_Parser->Pos + 1);
+    if (Index < 0) return false;
+
+    /* Plain characters are the common case: hex fields have no escapes */
+    const unsigned char* p = (const unsigned char*)p_Parser->p_Json + p_Parser->Pos + 1;
+    const unsigned char* p_End = (const unsigned char*)p_Parser->p_Json + p_Parser->Len;
+    while (p < p_End) {
+        unsigned char c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            p++;
+            continue;
+        }
+        if (c == '"') {
+            size_t Pos = (size_t)(p - (const unsigned char*)p_Parser->p_Json);
+            p_Parser->p_Tokens[Index].End = (uint32_t)Pos;
+            p_Parser->Pos = Pos + 1;
+            return true;
+        }
+        if (c < 0x20 || ++p >= p_End) return false;
+
+        c = *p;
+        if (c == 'u') {
+            if (p_End - p <= 4) return false;
+            for (int i = 1; i <= 4; i++) {
+                if (HexNibble((char)p[i]) < 0) return false;
+            }
+            p += 4;
+        } else if (c == '\0' || strchr("\"\\/bfnrt", c) == NULL) {
+            return false;
+        }
+        p++;
+    }
+    return false;
+}
+
+static bool IsDigit(JsonParser_t* p_Parser)
+{
+    return p_Parser->Pos < p_Parser->Len &&
+           p_Parser->p_Json[p_Parser->Pos] >= '0' && p_Parser->p_Json[p_Parser->Pos] <= '9';
+}
+
+/* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
+static bool ParseNumber(JsonParser_t* p_Parser)
+{
+    const char* p_Json = p_Parser->p_Json;
+    int Index = NewToken(p_Parser, PdqJsonNumber, p_Parser->Pos);
+    if (Index < 0) return false;
+
+    if (p_Json[p_Parser->Pos] == '-') p_Parser->Pos++;
+    if (!IsDigit(p_Parser)) return false;
+    if (p_Json[p_Parser->Pos] == '0') {
+        p_Parser->Pos++;
+    } else {
+        while (IsDigit(p_Parser)) p_Parser->Pos++;
+    }
+    if (p_Parser->Pos < p_Parser->Len && p_Json[p_Parser->Pos] == '.') {
+        p_Parser->Pos++;
+        if (!IsDigit(p_Parser)) return false;
+        while (IsDigit(p_Parser)) p_Parser->Pos++;
+    }
+    if (p_Parser->Pos < p_Parser->Len && (p_Json[p_Parser->Pos] == 'e' || p_Json[p_Parser->Pos] == 'E')) {
+        p_Parser->Pos++;
+        if (p_Parser->Pos < p_Parser->Len && (p_Json[p_Parser->Pos] == '+' || p_Json[p_Parser->Pos] == '-')) {
+            p_Parser->Pos++;
+        }
+        if (!IsDigit(p_Parser)) return false;
+        while (IsDigit(p_Parser)) p_Parser->Pos++;
+    }
+    p_Parser->p_Tokens[Index].End = (uint32_t)p_Parser->Pos;
+    return true;
+}
+
+static bool ParseLiteral(JsonParser_t* p_Parser, const char* p_Word, PdqJsonType_t Type)
+{
+    size_t Len = strlen(p_Word);
+    if (p_Parser->Len - p_Parser->Pos < Len ||
+        memcmp(p_Parser->p_Json + p_Parser->Pos, p_Word, Len) != 0) {
+        return false;
+    }
+    int Index = NewToken(p_Parser, Type, p_Parser->Pos);
+    if (Index < 0) return false;
+    p_Parser->Pos += Len;
+    p_Parser->p_Tokens[Index].End = (uint32_t)p_Parser->Pos;
+    return true;
+}
+
+/* Objects and arrays share one loop; objects read "key": before each value */
+static bool ParseContainer(JsonParser_t* p_Parser, uint8_t Depth)
+{
+    bool IsObject = (p_Parser->p_Json[p_Parser->Pos] == '{');
+    char Close = IsObject ? '}' : ']';
+    if (Depth >= PDQ_JSON_MAX_DEPTH) return false;
+
+    int Index = NewToken(p_Parser, IsObject ? PdqJsonObject : PdqJsonArray, p_Parser->Pos);
+    if (Index < 0) return false;
+    p_Parser->Pos++;
+
+    SkipSpace(p_Parser);
+    if (p_Parser->Pos < p_Parser->Len && p_Parser->p_Json[p_Parser->Pos] == Close) {
+        p_Parser->Pos++;
+    } else {
+        for (;;) {
+            if (IsObject) {
+                SkipSpace(p_Parser);
+                if (p_Parser->Pos >= p_Parser->Len || p_Parser->p_Json[p_Parser->Pos] != '"') return false;
+                if (!ParseString(p_Parser)) return false;
+                SkipSpace(p_Parser);
+                if (p_Parser->Pos >= p_Parser->Len || p_Parser->p_Json[p_Parser->Pos] != ':') return false;
+                p_Parser->Pos++;
+            }
+            if (!ParseValue(p_Parser, (uint8_t)(Depth + 1))) return false;
+            p_Parser->p_Tokens[Index].Size++;
+
+            SkipSpace(p_Parser);
+            if (p_Parser->Pos >= p_Parser->Len) return false;
+            char c = p_Parser->p_Json[p_Parser->Pos++];
+            if (c == Close) break;
+            if (c != ',') return false;
+        }
+    }
+
+    p_Parser->p_Tokens[Index].End = (uint32_t)p_Parser->Pos;
+    p_Parser->p_Tokens[Index].Next = p_Parser->Count;
+    return true;
+}
+
+static bool ParseValue(JsonParser_t* p_Parser, uint8_t Depth)
+{
+    SkipSpace(p_Parser);
+    if (p_Parser->Pos >= p_Parser->Len) return false;
+
+    char c = p_Parser->p_Json[p_Parser->Pos];
+    switch (c) {
+        case '{':
+        case '[':
+            return ParseContainer(p_Parser, Depth);
+        case '"':
+            return ParseString(p_Parser);
+        case 't':
+            return ParseLiteral(p_Parser, "true", PdqJsonTrue);
+        case 'f':
+            return ParseLiteral(p_Parser, "false", PdqJsonFalse);
+        case 'n':
+            return ParseLiteral(p_Parser, "null", PdqJsonNull);
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) return ParseNumber(p_Parser);
+            return false;
+    }
+}
+
+// Public API functions for the JSON tokenizer
+
+PdqError_t PdqJsonParse(PdqJsonDoc_t* p_Doc, const char* p_Json, size_t Len,
+                        PdqJsonToken_t* p_Tokens, uint16_t MaxTokens)
+{
+    if (p_Doc == NULL || p_Json == NULL || p_Tokens == NULL || MaxTokens == 0) {
+        return PdqErrorInvalidParam;
+    }
+
+    JsonParser_t Parser = {p_Json, Len, 0, p_Tokens, MaxTokens, 0, false};
+    p_Doc->p_Json = p_Json;
+    p_Doc->p_Tokens = p_Tokens;
+    p_Doc->MaxTokens = MaxTokens;
+    p_Doc->Count = 0;
+
+    bool Ok = ParseValue(&Parser, 0);
+    if (Ok) {
+        SkipSpace(&Parser);
+        Ok = (Parser.Pos == Len);
+    }
+    if (!Ok) return Parser.OutOfTokens ? PdqErrorBufferTooSmall : PdqErrorParse;
+
+    p_Doc->Count = Parser.Count;
+    return PdqOk;
+}
+
+int PdqJsonObjectGet(const PdqJsonDoc_t* p_Doc, int Object, const char* p_Key)
+{
+    if (PdqJsonTypeOf(p_Doc, Object) != PdqJsonObject || p_Key == NULL) return -1;
+
+    int Key = Object + 1;
+    for (uint16_t i = 0; i < p_Doc->p_Tokens[Object].Size; i++) {
+        if (PdqJsonEquals(p_Doc, Key, p_Key)) return Key + 1;
+        Key = p_Doc->p_Tokens[Key + 1].Next;
+    }
+    return -1;
+}
+
+int PdqJsonArrayGet(const PdqJsonDoc_t* p_Doc, int Array, uint16_t Index)
+{
+    if (PdqJsonTypeOf(p_Doc, Array) != PdqJsonArray) return -1;
+    if (Index >= p_Doc->p_Tokens[Array].Size) return -1;
+
+    int Token = Array + 1;
+    for (uint16_t i = 0; i < Index; i++) Token = p_Doc->p_Tokens[Token].Next;
+    return Token;
+}
+
+PdqJsonType_t PdqJsonTypeOf(const PdqJsonDoc_t* p_Doc, int Token)
+{
+    if (p_Doc == NULL || Token < 0 || Token >= p_Doc->Count) return PdqJsonNone;
+    return (PdqJsonType_t)p_Doc->p_Tokens[Token].Type;
+}
+
+bool PdqJsonEquals(const PdqJsonDoc_t* p_Doc, int Token, const char* p_Str)
+{
+    if (PdqJsonTypeOf(p_Doc, Token) != PdqJsonString || p_Str == NULL) return false;
+    const PdqJsonToken_t* p_Tok = &p_Doc->p_Tokens[Token];
+    size_t Len = p_Tok->End - p_Tok->Start;
+    return strlen(p_Str) == Len && memcmp(p_Doc->p_Json + p_Tok->Start, p_Str, Len) == 0;
+}
+
+/* Numbers are copied out because the buffer need not be terminated */
+static bool CopyNumber(const PdqJsonDoc_t* p_Doc, int Token, char* p_Buffer, size_t Size)
+{
+    if (PdqJsonTypeOf(p_Doc, Token) != PdqJsonNumber) return false;
+    const PdqJsonToken_t* p_Tok = &p_Doc->p_Tokens[Token];
+    size_t Len = p_Tok->End - p_Tok->Start;
+    if (Len >= Size) return false;
+    memcpy(p_Buffer, p_Doc->p_Json + p_Tok->Start, Len);
+    p_Buffer[Len] = '\0';
+    return true;
+}
+
+bool PdqJsonGetDouble(const PdqJsonDoc_t* p_Doc, int Token, double* p_Value)
+{
+    char Buffer[40];
+    if (p_Value == NULL || !CopyNumber(p_Doc, Token, Buffer, sizeof(Buffer))) return false;
+    *p_Value = strtod(Buffer, NULL);
+    return true;
+}
+
+bool PdqJsonGetInt(const PdqJsonDoc_t* p_Doc, int Token, int64_t* p_Value)
+{
+    char Buffer[24];
+    if (p_Value == NULL || !CopyNumber(p_Doc, Token, Buffer, sizeof(Buffer))) return false;
+    if (strpbrk(Buffer, ".eE") != NULL) return false;
+
+    errno = 0;
+    long long Value = strtoll(Buffer, NULL, 10);
+    if (errno == ERANGE) return false;
+    *p_Value = (int64_t)Value;
+    return true;
+}
+
+int32_t PdqJsonGetString(const PdqJsonDoc_t* p_Doc, int Token, char* p_Out, size_t MaxLen)
+{
+    if (PdqJsonTypeOf(p_Doc, Token) != PdqJsonString || p_Out == NULL || MaxLen == 0) return -1;
+
+    const PdqJsonToken_t* p_Tok = &p_Doc->p_Tokens[Token];
+    const char* p = p_Doc->p_Json + p_Tok->Start;
+    const char* p_End = p_Doc->p_Json + p_Tok->End;
+    size_t j = 0;
+    while (p < p_End && j + 1 < MaxLen) {
+        char c = *p++;
+        if (c == '\\') {
+            c = *p++;
+            switch (c) {
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case 'u': c = '?'; p += 4; break;
+                default: break;
+            }
+        }
+        p_Out[j++] = c;
+    }
+    p_Out[j] = '\0';
+    return (int32_t)j;
+}
+
+int32_t PdqJsonGetHex(const PdqJsonDoc_t* p_Doc, int Token, uint8_t* p_Out, size_t MaxLen)
+{
+    if (PdqJsonTypeOf(p_Doc, Token) != PdqJsonString || p_Out == NULL) return -1;
+
+    const PdqJsonToken_t* p_Tok = &p_Doc->p_Tokens[Token];
+    const char* p_Hex = p_Doc->p_Json + p_Tok->Start;
+    size_t HexLen = p_Tok->End - p_Tok->Start;
+    if (HexLen % 2 != 0 || HexLen / 2 > MaxLen) return -1;
+
+    for (size_t i = 0; i < HexLen / 2; i++) {
+        uint8_t Hi = s_HexValue[(uint8_t)p_Hex[i * 2]];
+        uint8_t Lo = s_HexValue[(uint8_t)p_Hex[i * 2 + 1]];
+        if (Hi == 0 || Lo == 0) return -1;
+        p_Out[i] = (uint8_t)(((Hi - 1) << 4) | (Lo - 1));
+    }
+    return (int32_t)(HexLen / 2);
+}
+
+bool PdqJsonGetHexU32(const PdqJsonDoc_t* p_Doc, int Token, uint32_t* p_Value)
+{
+    if (PdqJsonTypeOf(p_Doc, Token) != PdqJsonString || p_Value == NULL) return false;
+
+    const PdqJsonToken_t* p_Tok = &p_Doc->p_Tokens[Token];
+    size_t Len = p_Tok->End - p_Tok->Start;
+    if (Len == 0 || Len > 8) return false;
+
+    uint32_t Value = 0;
+    for (size_t i = 0; i < Len; i++) {
+        int32_t Nibble = HexNibble(p_Doc->p_Json[p_Tok->Start + i]);
+        if (Nibble < 0) return false;
+        Value = (Value << 4) | (uint32_t)Nibble;
+    }
+    *p_Value = Value;
+    return true;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file stratum_json.h
+ * @brief Single-pass JSON tokenizer for Stratum messages
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Parses one message in a single left-to-right pass into a flat array of
+ * tokens that hold offsets into the caller's buffer; nothing is copied
+ * or allocated. Tokens are stored in document order, and each one
+ * records where its subtree ends, so lookups skip whole values without
+ * rescanning text. Input that is not a single well-formed JSON value is
+ * rejected.
+ */
+
+#ifndef PDQ_STRATUM_JSON_H
+#define PDQ_STRATUM_JSON_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_JSON_MAX_DEPTH      16
+
+typedef enum {
+    PdqJsonNone = 0,
+    PdqJsonObject,
+    PdqJsonArray,
+    PdqJsonString,
+    PdqJsonNumber,
+    PdqJsonTrue,
+    PdqJsonFalse,
+    PdqJsonNull
+} PdqJsonType_t;
+
+typedef struct {
+    uint32_t Start;     /* First byte; strings exclude the quotes */
+    uint32_t End;       /* One past the last byte */
+    uint16_t Next;      /* Index of the first token after this subtree */
+    uint16_t Size;      /* Members of an object, elements of an array */
+    uint8_t  Type;      /* PdqJsonType_t */
+} PdqJsonToken_t;
+
+/* Object members are stored as a key string token followed by the
+ * value's tokens. Token 0 is the root value. */
+typedef struct {
+    const char*     p_Json;
+    PdqJsonToken_t* p_Tokens;
+    uint16_t        MaxTokens;
+    uint16_t        Count;
+} PdqJsonDoc_t;
+
+/* Returns PdqErrorParse for malformed input and PdqErrorBufferTooSmall
+ * when the message needs more than MaxTokens tokens. */
+PdqError_t PdqJsonParse(PdqJsonDoc_t* p_Doc, const char* p_Json, size_t Len,
+                        PdqJsonToken_t* p_Tokens, uint16_t MaxTokens);
+
+/* Token index of the member value or array element, or -1 */
+int        PdqJsonObjectGet(const PdqJsonDoc_t* p_Doc, int Object, const char* p_Key);
+int        PdqJsonArrayGet(const PdqJsonDoc_t* p_Doc, int Array, uint16_t Index);
+
+PdqJsonType_t PdqJsonTypeOf(const PdqJsonDoc_t* p_Doc, int Token);
+bool       PdqJsonEquals(const PdqJsonDoc_t* p_Doc, int Token, const char* p_Str);
+bool       PdqJsonGetInt(const PdqJsonDoc_t* p_Doc, int Token, int64_t* p_Value);
+bool       PdqJsonGetDouble(const PdqJsonDoc_t* p_Doc, int Token, double* p_Value);
+
+/* Copies a string value, decoding escapes (\u escapes become '?').
+ * Truncates to MaxLen - 1; returns the copied length or -1. */
+int32_t    PdqJsonGetString(const PdqJsonDoc_t* p_Doc, int Token, char* p_Out, size_t MaxLen);
+
+/* Decode a hex string value straight from the buffer. Returns the byte
+ * count, or -1 for odd length, bad digits or more than MaxLen bytes. */
+int32_t    PdqJsonGetHex(const PdqJsonDoc_t* p_Doc, int Token, uint8_t* p_Out, size_t MaxLen);
+
+/* Big-endian hex string of at most 8 digits, as in notify version/nbits/ntime */
+bool       PdqJsonGetHexU32(const PdqJsonDoc_t* p_Doc, int Token, uint32_t* p_Value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
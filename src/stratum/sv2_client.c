@@ -0,0 +1,867 @@
+/**
+ * @file sv2_client.c
+ * @brief Stratum V2 mining protocol client implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "sv2_client.h"
+#include "sv2_proto.h"
+#include "core/target.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef ESP32
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+#include <sys/poll.h>
+#include <errno.h>
+#include "esp_timer.h"
+#else
+#include <sys/socket.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define PDQ_SEND_FLAGS          MSG_NOSIGNAL
+#else
+#define PDQ_SEND_FLAGS          0
+#endif
+
+/* SV2 reports share errors as strings; they are counted under the
+ * Stratum V1 numeric codes that mean the same thing. */
+typedef struct {
+    const char* p_Name;
+    int32_t     Code;
+} ErrorCodeMap_t;
+
+static const ErrorCodeMap_t s_ErrorCodes[] = {
+    {"stale-share",          21},
+    {"invalid-job-id",       21},
+    {"duplicate-share",      22},
+    {"difficulty-too-low",   23},
+    {"invalid-channel-id",   25},
+};
+
+static uint64_t GetMillis(void)
+{
+#ifdef ESP32
+    return (uint64_t)(esp_timer_get_time() / 1000);
+#else
+    struct timespec Ts;
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000 + (uint64_t)Ts.tv_nsec / 1000000;
+#endif
+}
+
+static void EnterState(PdqSv2Context_t* p_Ctx, PdqSv2State_t State)
+{
+    p_Ctx->State = State;
+    p_Ctx->StageStartMs = GetMillis();
+}
+
+static int32_t MapErrorCode(const char* p_Name)
+{
+    for (size_t i = 0; i < sizeof(s_ErrorCodes) / sizeof(s_ErrorCodes[0]); i++) {
+        if (strcmp(p_Name, s_ErrorCodes[i].p_Name) == 0) return s_ErrorCodes[i].Code;
+    }
+    return 20;
+}
+
+static PdqError_t FlushTx(PdqSv2Context_t* p_Ctx)
+{
+    if (p_Ctx->Socket < 0) return PdqErrorNotConnected;
+
+    uint32_t Done = 0;
+    while (Done < p_Ctx->TxLen) {
+        ssize_t Sent = send(p_Ctx->Socket, p_Ctx->TxBuffer + Done, p_Ctx->TxLen - Done, PDQ_SEND_FLAGS);
+        if (Sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            PdqSv2CtxDisconnect(p_Ctx);
+            return PdqErrorNotConnected;
+        }
+        Done += (uint32_t)Sent;
+    }
+
+    p_Ctx->TxLen -= Done;
+    if (Done > 0 && p_Ctx->TxLen > 0) memmove(p_Ctx->TxBuffer, p_Ctx->TxBuffer + Done, p_Ctx->TxLen);
+    return PdqOk;
+}
+
+/* Frames are encoded into TxFrame, then sealed onto the outbound queue */
+static void BeginTx(PdqSv2Context_t* p_Ctx, PdqSv2Writer_t* p_W, bool ChannelMsg, uint8_t MsgType)
+{
+    PdqSv2WriterInit(p_W, p_Ctx->TxFrame, sizeof(p_Ctx->TxFrame));
+    PdqSv2BeginFrame(p_W, ChannelMsg, MsgType);
+}
+
+static PdqError_t CommitTx(PdqSv2Context_t* p_Ctx, PdqSv2Writer_t* p_W)
+{
+    PdqSv2EndFrame(p_W);
+    if (p_W->Overflow || PdqSv2NoiseFrameSize(p_W->Len) > PDQ_SV2_TX_BUFFER_SIZE - p_Ctx->TxLen) {
+        printf("[SV2] Outbound queue full, message dropped\n");
+        return PdqErrorBufferTooSmall;
+    }
+    PdqSv2NoiseSealFrame(&p_Ctx->TxCipher, p_W->p_Data, p_W->Len, p_Ctx->TxBuffer + p_Ctx->TxLen);
+    p_Ctx->TxLen += PdqSv2NoiseFrameSize(p_W->Len);
+    return FlushTx(p_Ctx);
+}
+
+static PdqError_t SendSetupConnection(PdqSv2Context_t* p_Ctx)
+{
+    char Firmware[16];
+    snprintf(Firmware, sizeof(Firmware), "%d.%d.%d",
+             PDQ_VERSION_MAJOR, PDQ_VERSION_MINOR, PDQ_VERSION_PATCH);
+
+    PdqSv2Writer_t W;
+    BeginTx(p_Ctx, &W, false, PDQ_SV2_MSG_SETUP_CONNECTION);
+    PdqSv2PutU8(&W, PDQ_SV2_PROTOCOL_MINING);
+    PdqSv2PutU16(&W, PDQ_SV2_VERSION);
+    PdqSv2PutU16(&W, PDQ_SV2_VERSION);
+    PdqSv2PutU32(&W, PDQ_SV2_SETUP_REQUIRES_STANDARD_JOBS);
+    PdqSv2PutStr(&W, p_Ctx->Host);
+    PdqSv2PutU16(&W, p_Ctx->Port);
+    PdqSv2PutStr(&W, "PDQminer");
+    PdqSv2PutStr(&W, "");
+    PdqSv2PutStr(&W, Firmware);
+    PdqSv2PutStr(&W, "");
+    return CommitTx(p_Ctx, &W);
+}
+
+static PdqError_t SendOpenChannel(PdqSv2Context_t* p_Ctx)
+{
+    /* Accept any target the pool picks */
+    uint32_t MaxTarget[8];
+    memset(MaxTarget, 0xFF, sizeof(MaxTarget));
+
+    PdqSv2Writer_t W;
+    BeginTx(p_Ctx, &W, false, PDQ_SV2_MSG_OPEN_STANDARD_CHANNEL);
+    PdqSv2PutU32(&W, ++p_Ctx->RequestId);
+    PdqSv2PutStr(&W, p_Ctx->Worker);
+    PdqSv2PutF32(&W, p_Ctx->NominalHashRate);
+    PdqSv2PutU256Words(&W, MaxTarget);
+    return CommitTx(p_Ctx, &W);
+}
+
+static PdqSv2Job_t* FindJob(PdqSv2Context_t* p_Ctx, uint32_t JobId)
+{
+    for (int i = 0; i < PDQ_SV2_MAX_JOBS; i++) {
+        if (p_Ctx->Jobs[i].Used && p_Ctx->Jobs[i].JobId == JobId) return &p_Ctx->Jobs[i];
+    }
+    return NULL;
+}
+
+/* A free slot, or the oldest-numbered job; SV2 job ids only grow */
+static PdqSv2Job_t* AllocJob(PdqSv2Context_t* p_Ctx)
+{
+    PdqSv2Job_t* p_Slot = NULL;
+    for (int i = 0; i < PDQ_SV2_MAX_JOBS; i++) {
+        PdqSv2Job_t* p_Job = &p_Ctx->Jobs[i];
+        if (!p_Job->Used) return p_Job;
+        if (p_Ctx->HasActiveJob && p_Job->JobId == p_Ctx->ActiveJobId) continue;
+        if (p_Slot == NULL || p_Job->JobId < p_Slot->JobId) p_Slot = p_Job;
+    }
+    return p_Slot;
+}
+
+static void Activate(PdqSv2Context_t* p_Ctx, uint32_t JobId)
+{
+    p_Ctx->ActiveJobId = JobId;
+    p_Ctx->HasActiveJob = true;
+    p_Ctx->HasNewJob = true;
+    if (p_Ctx->State == Sv2StateOpen) EnterState(p_Ctx, Sv2StateReady);
+}
+
+static void FinishSubmit(PdqSv2Context_t* p_Ctx, PdqSv2PendingSubmit_t* p_Entry,
+                         PdqSubmitResult_t Result, int32_t Code, uint64_t NowMs)
+{
+    PdqStratumSubmitStats_t* p_Stats = &p_Ctx->SubmitStats;
+    uint32_t LatencyMs = (NowMs > p_Entry->SentMs) ? (uint32_t)(NowMs - p_Entry->SentMs) : 0;
+    p_Entry->Used = false;
+
+    if (Result == PdqSubmitTimedOut) {
+        p_Stats->TimedOut++;
+    } else {
+        if (Result == PdqSubmitAccepted) {
+            p_Stats->Accepted++;
+        } else {
+            p_Stats->Rejected++;
+            bool Counted = false;
+            for (int i = 0; i < PDQ_STRATUM_MAX_REJECT_CODES && !Counted; i++) {
+                if (p_Stats->RejectCounts[i] == 0) p_Stats->RejectCodes[i] = Code;
+                if (p_Stats->RejectCodes[i] == Code) {
+                    p_Stats->RejectCounts[i]++;
+                    Counted = true;
+                }
+            }
+            if (!Counted) p_Stats->RejectOther++;
+        }
+        p_Stats->LatencyHist[PdqSubmitLatencyBucket(LatencyMs)]++;
+        p_Stats->LatencySumMs += LatencyMs;
+        if (LatencyMs > p_Stats->LatencyMaxMs) p_Stats->LatencyMaxMs = LatencyMs;
+    }
+
+    if (p_Ctx->p_OnSubmit) p_Ctx->p_OnSubmit(p_Ctx->p_OnSubmitArg, Result, Code, LatencyMs);
+}
+
+static void TrackSubmit(PdqSv2Context_t* p_Ctx, uint32_t Sequence)
+{
+    PdqSv2PendingSubmit_t* p_Slot = NULL;
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        PdqSv2PendingSubmit_t* p_Entry = &p_Ctx->Pending[i];
+        if (!p_Entry->Used) {
+            p_Slot = p_Entry;
+            break;
+        }
+        if (p_Slot == NULL || p_Entry->SentMs < p_Slot->SentMs) p_Slot = p_Entry;
+    }
+
+    uint64_t Now = GetMillis();
+    if (p_Slot->Used) FinishSubmit(p_Ctx, p_Slot, PdqSubmitTimedOut, 0, Now);
+
+    p_Slot->Used = true;
+    p_Slot->Sequence = Sequence;
+    p_Slot->SentMs = Now;
+    p_Ctx->SubmitStats.Submitted++;
+}
+
+static void ExpireSubmits(PdqSv2Context_t* p_Ctx, bool All)
+{
+    uint64_t Now = GetMillis();
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        PdqSv2PendingSubmit_t* p_Entry = &p_Ctx->Pending[i];
+        if (!p_Entry->Used) continue;
+        if (!All && Now - p_Entry->SentMs < p_Ctx->SubmitTimeoutMs) continue;
+        printf("[SV2] No reply to share %u after %lu ms\n",
+               (unsigned)p_Entry->Sequence, (unsigned long)(Now - p_Entry->SentMs));
+        FinishSubmit(p_Ctx, p_Entry, PdqSubmitTimedOut, 0, Now);
+    }
+}
+
+static void HandleSetupSuccess(PdqSv2Context_t* p_Ctx, PdqSv2Reader_t* p_R)
+{
+    uint16_t Version = PdqSv2GetU16(p_R);
+    uint32_t Flags = PdqSv2GetU32(p_R);
+    if (p_R->Error || p_Ctx->State != Sv2StateSetup) return;
+
+    printf("[SV2] Connection set up (version %u, flags %08x)\n", (unsigned)Version, (unsigned)Flags);
+    if (SendOpenChannel(p_Ctx) == PdqOk) EnterState(p_Ctx, Sv2StateOpening);
+}
+
+static void HandleOpenSuccess(PdqSv2Context_t* p_Ctx, PdqSv2Reader_t* p_R)
+{
+    uint32_t RequestId = PdqSv2GetU32(p_R);
+    uint32_t ChannelId = PdqSv2GetU32(p_R);
+    uint32_t Target[8];
+    PdqSv2GetU256Words(p_R, Target);
+    uint8_t Prefix[32];
+    uint8_t PrefixLen = PdqSv2GetB032(p_R, Prefix);
+    if (p_R->Error) {
+        p_Ctx->RxMalformed++;
+        return;
+    }
+    if (p_Ctx->State != Sv2StateOpening || RequestId != p_Ctx->RequestId) return;
+
+    p_Ctx->ChannelId = ChannelId;
+    memcpy(p_Ctx->Target, Target, sizeof(Target));
+    memcpy(p_Ctx->ExtranoncePrefix, Prefix, PrefixLen);
+    p_Ctx->ExtranoncePrefixLen = PrefixLen;
+    printf("[SV2] Channel %u open, difficulty %.4g\n", (unsigned)ChannelId,
+           PdqTargetToDifficulty(Target));
+    EnterState(p_Ctx, Sv2StateOpen);
+
+    /* NewMiningJob and SetNewPrevHash may already have arrived with it */
+    if (p_Ctx->HasActiveJob) EnterState(p_Ctx, Sv2StateReady);
+}
+
+static void HandleNewMiningJob(PdqSv2Context_t* p_Ctx, PdqSv2Reader_t* p_R)
+{
+    uint32_t ChannelId = PdqSv2GetU32(p_R);
+    uint32_t JobId = PdqSv2GetU32(p_R);
+    uint32_t MinNTime = 0;
+    bool Current = PdqSv2GetOptionU32(p_R, &MinNTime);
+    uint32_t Version = PdqSv2GetU32(p_R);
+    uint8_t MerkleRoot[32];
+    PdqSv2GetBytes(p_R, MerkleRoot, 32);
+    if (p_R->Error) {
+        p_Ctx->RxMalformed++;
+        return;
+    }
+    if (ChannelId != p_Ctx->ChannelId) return;
+
+    PdqSv2Job_t* p_Job = FindJob(p_Ctx, JobId);
+    if (p_Job == NULL) p_Job = AllocJob(p_Ctx);
+    p_Job->Used = true;
+    p_Job->Future = !Current;
+    p_Job->JobId = JobId;
+    p_Job->Version = Version;
+    p_Job->MinNTime = MinNTime;
+    memcpy(p_Job->MerkleRoot, MerkleRoot, 32);
+
+    /* A job with min_ntime applies to the prevhash in force right away */
+    if (Current && p_Ctx->HasPrevHash) Activate(p_Ctx, JobId);
+}
+
+static void HandleSetNewPrevHash(PdqSv2Context_t* p_Ctx, PdqSv2Reader_t* p_R)
+{
+    uint32_t ChannelId = PdqSv2GetU32(p_R);
+    uint32_t JobId = PdqSv2GetU32(p_R);
+    uint8_t PrevHash[32];
+    PdqSv2GetBytes(p_R, PrevHash, 32);
+    uint32_t MinNTime = PdqSv2GetU32(p_R);
+    uint32_t NBits = PdqSv2GetU32(p_R);
+    if (p_R->Error) {
+        p_Ctx->RxMalformed++;
+        return;
+    }
+    if (ChannelId != p_Ctx->ChannelId) return;
+
+    memcpy(p_Ctx->PrevHash, PrevHash, 32);
+    p_Ctx->PrevHashNTime = MinNTime;
+    p_Ctx->NBits = NBits;
+    p_Ctx->HasPrevHash = true;
+
+    /* Every job built on the old prevhash is stale now; future jobs
+     * announced for the new one stay. */
+    for (int i = 0; i < PDQ_SV2_MAX_JOBS; i++) {
+        PdqSv2Job_t* p_Job = &p_Ctx->Jobs[i];
+        if (p_Job->Used && !p_Job->Future && p_Job->JobId != JobId) p_Job->Used = false;
+    }
+    p_Ctx->HasActiveJob = false;
+
+    PdqSv2Job_t* p_Job = FindJob(p_Ctx, JobId);
+    if (p_Job == NULL) {
+        printf("[SV2] SetNewPrevHash for unknown job %u\n", (unsigned)JobId);
+        return;
+    }
+    p_Job->Future = false;
+    p_Job->MinNTime = MinNTime;
+    Activate(p_Ctx, JobId);
+}
+
+static void HandleSetTarget(PdqSv2Context_t* p_Ctx, PdqSv2Reader_t* p_R)
+{
+    uint32_t ChannelId = PdqSv2GetU32(p_R);
+    uint32_t Target[8];
+    PdqSv2GetU256Words(p_R, Target);
+    if (p_R->Error) {
+        p_Ctx->RxMalformed++;
+        return;
+    }
+    if (ChannelId != p_Ctx->ChannelId) return;
+
+    memcpy(p_Ctx->Target, Target, sizeof(Target));
+    printf("[SV2] Difficulty set to %.4g\n", PdqTargetToDifficulty(Target));
+    /* The next job the miner builds picks up the new target */
+    if (p_Ctx->HasActiveJob) p_Ctx->HasNewJob = true;
+}
+
+static void HandleSubmitSuccess(PdqSv2Context_t* p_Ctx, PdqSv2Reader_t* p_R)
+{
+    PdqSv2GetU32(p_R);
+    uint32_t LastSequence = PdqSv2GetU32(p_R);
+    uint32_t Count = PdqSv2GetU32(p_R);
+    PdqSv2GetU64(p_R);
+    if (p_R->Error) {
+        p_Ctx->RxMalformed++;
+        return;
+    }
+
+    /* Acknowledges every pending share up to LastSequence */
+    uint64_t Now = GetMillis();
+    uint32_t Matched = 0;
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        PdqSv2PendingSubmit_t* p_Entry = &p_Ctx->Pending[i];
+        if (!p_Entry->Used || (int32_t)(p_Entry->Sequence - LastSequence) > 0) continue;
+        printf("[SV2] Share accepted (%lu ms)\n", (unsigned long)(Now - p_Entry->SentMs));
+        FinishSubmit(p_Ctx, p_Entry, PdqSubmitAccepted, 0, Now);
+        Matched++;
+    }
+    if (Matched < Count) p_Ctx->SubmitStats.Unmatched += Count - Matched;
+}
+
+static void HandleSubmitError(PdqSv2Context_t* p_Ctx, PdqSv2Reader_t* p_R)
+{
+    PdqSv2GetU32(p_R);
+    uint32_t Sequence = PdqSv2GetU32(p_R);
+    char Reason[64];
+    PdqSv2GetStr(p_R, Reason, sizeof(Reason));
+    if (p_R->Error) {
+        p_Ctx->RxMalformed++;
+        return;
+    }
+
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        PdqSv2PendingSubmit_t* p_Entry = &p_Ctx->Pending[i];
+        if (!p_Entry->Used || p_Entry->Sequence != Sequence) continue;
+        uint64_t Now = GetMillis();
+        printf("[SV2] Share rejected (%s) after %lu ms\n", Reason, (unsigned long)(Now - p_Entry->SentMs));
+        FinishSubmit(p_Ctx, p_Entry, PdqSubmitRejected, MapErrorCode(Reason), Now);
+        return;
+    }
+    p_Ctx->SubmitStats.Unmatched++;
+}
+
+static void ProcessFrame(PdqSv2Context_t* p_Ctx, const PdqSv2FrameHeader_t* p_Header,
+                         const uint8_t* p_Payload)
+{
+    PdqSv2Reader_t R;
+    PdqSv2ReaderInit(&R, p_Payload, p_Header->Length);
+    p_Ctx->RxFrames++;
+
+    /* Extensions are not negotiated, so only extension 0 is expected */
+    if ((p_Header->ExtensionType & ~PDQ_SV2_CHANNEL_MSG) != 0) {
+        p_Ctx->RxUnknown++;
+        return;
+    }
+
+    switch (p_Header->MsgType) {
+        case PDQ_SV2_MSG_SETUP_CONNECTION_SUCCESS:
+            HandleSetupSuccess(p_Ctx, &R);
+            break;
+        case PDQ_SV2_MSG_SETUP_CONNECTION_ERROR:
+        case PDQ_SV2_MSG_OPEN_CHANNEL_ERROR: {
+            /* flags or request_id, then error_code */
+            char Reason[64];
+            PdqSv2GetU32(&R);
+            PdqSv2GetStr(&R, Reason, sizeof(Reason));
+            printf("[SV2] %s refused: %s\n",
+                   p_Header->MsgType == PDQ_SV2_MSG_SETUP_CONNECTION_ERROR ? "Setup" : "Channel open",
+                   R.Error ? "?" : Reason);
+            PdqSv2CtxDisconnect(p_Ctx);
+            break;
+        }
+        case PDQ_SV2_MSG_OPEN_STANDARD_CHANNEL_SUCCESS:
+            HandleOpenSuccess(p_Ctx, &R);
+            break;
+        case PDQ_SV2_MSG_NEW_MINING_JOB:
+            HandleNewMiningJob(p_Ctx, &R);
+            break;
+        case PDQ_SV2_MSG_SET_NEW_PREV_HASH:
+            HandleSetNewPrevHash(p_Ctx, &R);
+            break;
+        case PDQ_SV2_MSG_SET_TARGET:
+            HandleSetTarget(p_Ctx, &R);
+            break;
+        case PDQ_SV2_MSG_SUBMIT_SHARES_SUCCESS:
+            HandleSubmitSuccess(p_Ctx, &R);
+            break;
+        case PDQ_SV2_MSG_SUBMIT_SHARES_ERROR:
+            HandleSubmitError(p_Ctx, &R);
+            break;
+        case PDQ_SV2_MSG_CLOSE_CHANNEL:
+        case PDQ_SV2_MSG_RECONNECT:
+            printf("[SV2] Pool closed the channel\n");
+            PdqSv2CtxDisconnect(p_Ctx);
+            break;
+        default:
+            p_Ctx->RxUnknown++;
+            break;
+    }
+}
+
+static void FinishHandshake(PdqSv2Context_t* p_Ctx, const uint8_t* p_Act2)
+{
+    /* An unset clock cannot judge the certificate's validity window */
+    time_t Now = time(NULL);
+    PdqError_t Err = PdqSv2NoiseFinish(&p_Ctx->Noise, p_Act2,
+                                       p_Ctx->HasAuthorityKey ? p_Ctx->AuthorityKey : NULL,
+                                       Now > 0 ? (uint32_t)Now : 0, &p_Ctx->TxCipher, &p_Ctx->RxCipher);
+    if (Err != PdqOk) {
+        printf("[SV2] Handshake with %s:%u failed: bad MAC or pool certificate\n",
+               p_Ctx->Host, (unsigned)p_Ctx->Port);
+        PdqSv2CtxDisconnect(p_Ctx);
+        return;
+    }
+    if (!p_Ctx->HasAuthorityKey) {
+        printf("[SV2] WARN: no pool authority key set, certificate not verified\n");
+    }
+
+    if (SendSetupConnection(p_Ctx) == PdqOk) EnterState(p_Ctx, Sv2StateSetup);
+}
+
+static PdqError_t ProcessConnecting(PdqSv2Context_t* p_Ctx)
+{
+    /* poll() has no FD_SETSIZE limit on the descriptor number */
+    struct pollfd Poll = {p_Ctx->Socket, POLLOUT, 0};
+    if (poll(&Poll, 1, 0) <= 0) {
+        if (GetMillis() - p_Ctx->StageStartMs > PDQ_STRATUM_CONNECT_TIMEOUT_MS) {
+            printf("[SV2] Connect to %s:%u timed out\n", p_Ctx->Host, (unsigned)p_Ctx->Port);
+            PdqSv2CtxDisconnect(p_Ctx);
+            return PdqErrorTimeout;
+        }
+        return PdqOk;
+    }
+
+    int SockErr = 0;
+    socklen_t ErrLen = sizeof(SockErr);
+    if (getsockopt(p_Ctx->Socket, SOL_SOCKET, SO_ERROR, &SockErr, &ErrLen) != 0 || SockErr != 0) {
+        printf("[SV2] Connect to %s:%u failed\n", p_Ctx->Host, (unsigned)p_Ctx->Port);
+        PdqSv2CtxDisconnect(p_Ctx);
+        return PdqErrorNotConnected;
+    }
+
+    int NoDelay = 1;
+    setsockopt(p_Ctx->Socket, IPPROTO_TCP, TCP_NODELAY, &NoDelay, sizeof(NoDelay));
+    p_Ctx->LastRxMs = GetMillis();
+
+    /* Act 1 is the bare ephemeral key; SetupConnection follows act 2 */
+    PdqError_t Err = PdqSv2NoiseStart(&p_Ctx->Noise, p_Ctx->TxBuffer);
+    if (Err != PdqOk) {
+        printf("[SV2] No randomness for the handshake key\n");
+        PdqSv2CtxDisconnect(p_Ctx);
+        return Err;
+    }
+    p_Ctx->TxLen = PDQ_SV2_NOISE_ACT1_SIZE;
+    Err = FlushTx(p_Ctx);
+    if (Err != PdqOk) return Err;
+    EnterState(p_Ctx, Sv2StateNoise);
+    return PdqOk;
+}
+
+PdqError_t PdqSv2CtxInit(PdqSv2Context_t* p_Ctx)
+{
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    memset(p_Ctx, 0, sizeof(*p_Ctx));
+    p_Ctx->Socket = -1;
+    p_Ctx->SubmitTimeoutMs = PDQ_STRATUM_SUBMIT_TIMEOUT_MS;
+    return PdqOk;
+}
+
+PdqError_t PdqSv2CtxConnectStart(PdqSv2Context_t* p_Ctx, const char* p_Host, uint16_t Port,
+                                 const char* p_Worker, float HashRate)
+{
+    if (p_Ctx == NULL || p_Host == NULL || p_Worker == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->Socket >= 0) PdqSv2CtxDisconnect(p_Ctx);
+
+    strncpy(p_Ctx->Host, p_Host, PDQ_MAX_HOST_LEN);
+    p_Ctx->Host[PDQ_MAX_HOST_LEN] = '\0';
+    p_Ctx->Port = Port;
+    strncpy(p_Ctx->Worker, p_Worker, PDQ_MAX_WORKER_LEN);
+    p_Ctx->Worker[PDQ_MAX_WORKER_LEN] = '\0';
+    p_Ctx->NominalHashRate = HashRate > 0.0f ? HashRate : PDQ_SV2_DEFAULT_HASHRATE;
+
+    char PortStr[8];
+    snprintf(PortStr, sizeof(PortStr), "%u", (unsigned)Port);
+    struct addrinfo Hints;
+    struct addrinfo* p_Result = NULL;
+    memset(&Hints, 0, sizeof(Hints));
+    Hints.ai_family = AF_UNSPEC;
+    Hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(p_Host, PortStr, &Hints, &p_Result) != 0 || p_Result == NULL) {
+        printf("[SV2] DNS lookup failed for %s\n", p_Host);
+        return PdqErrorNotConnected;
+    }
+
+    int Fd = -1;
+    for (struct addrinfo* p_Ai = p_Result; p_Ai != NULL && Fd < 0; p_Ai = p_Ai->ai_next) {
+        Fd = socket(p_Ai->ai_family, p_Ai->ai_socktype, p_Ai->ai_protocol);
+        if (Fd < 0) continue;
+#ifdef FD_CLOEXEC
+        /* SV2 sessions are not handed over; a re-exec must not inherit one */
+        fcntl(Fd, F_SETFD, FD_CLOEXEC);
+#endif
+        int Flags = fcntl(Fd, F_GETFL, 0);
+        if (Flags < 0 || fcntl(Fd, F_SETFL, Flags | O_NONBLOCK) != 0 ||
+            (connect(Fd, p_Ai->ai_addr, p_Ai->ai_addrlen) != 0 && errno != EINPROGRESS)) {
+            close(Fd);
+            Fd = -1;
+        }
+    }
+    freeaddrinfo(p_Result);
+    if (Fd < 0) {
+        printf("[SV2] Connect to %s:%u failed\n", p_Host, (unsigned)Port);
+        return PdqErrorNotConnected;
+    }
+
+    p_Ctx->Socket = Fd;
+    p_Ctx->RecvLen = 0;
+    p_Ctx->RecvSkip = 0;
+    p_Ctx->HasRxHeader = false;
+    p_Ctx->TxLen = 0;
+    p_Ctx->Sequence = 0;
+    p_Ctx->HasActiveJob = false;
+    p_Ctx->HasPrevHash = false;
+    p_Ctx->HasNewJob = false;
+    memset(p_Ctx->Jobs, 0, sizeof(p_Ctx->Jobs));
+    EnterState(p_Ctx, Sv2StateConnecting);
+    return PdqOk;
+}
+
+PdqError_t PdqSv2CtxDisconnect(PdqSv2Context_t* p_Ctx)
+{
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->Socket >= 0) {
+        close(p_Ctx->Socket);
+        p_Ctx->Socket = -1;
+    }
+    /* Shares of a closed channel can no longer be answered */
+    ExpireSubmits(p_Ctx, true);
+    p_Ctx->TxLen = 0;
+    memset(&p_Ctx->Noise, 0, sizeof(p_Ctx->Noise));
+    memset(&p_Ctx->TxCipher, 0, sizeof(p_Ctx->TxCipher));
+    memset(&p_Ctx->RxCipher, 0, sizeof(p_Ctx->RxCipher));
+    p_Ctx->HasActiveJob = false;
+    p_Ctx->HasNewJob = false;
+    EnterState(p_Ctx, Sv2StateDisconnected);
+    return PdqOk;
+}
+
+void PdqSv2CtxSetAuthorityKey(PdqSv2Context_t* p_Ctx, const uint8_t* p_Key)
+{
+    if (p_Ctx == NULL) return;
+    p_Ctx->HasAuthorityKey = p_Key != NULL;
+    if (p_Key) memcpy(p_Ctx->AuthorityKey, p_Key, sizeof(p_Ctx->AuthorityKey));
+}
+
+PdqError_t PdqSv2CtxProcess(PdqSv2Context_t* p_Ctx)
+{
+    if (p_Ctx == NULL) return PdqErrorInvalidParam;
+    switch (p_Ctx->State) {
+        case Sv2StateDisconnected:
+            return PdqErrorNotConnected;
+        case Sv2StateConnecting:
+            return ProcessConnecting(p_Ctx);
+        case Sv2StateNoise:
+        case Sv2StateSetup:
+        case Sv2StateOpening:
+            if (GetMillis() - p_Ctx->StageStartMs > PDQ_SV2_HANDSHAKE_TIMEOUT_MS) {
+                printf("[SV2] %s timeout\n", p_Ctx->State == Sv2StateNoise ? "Noise handshake" :
+                       p_Ctx->State == Sv2StateSetup ? "Setup" : "Channel open");
+                PdqSv2CtxDisconnect(p_Ctx);
+                return PdqErrorTimeout;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (p_Ctx->TxLen > 0 && FlushTx(p_Ctx) != PdqOk) return PdqErrorNotConnected;
+    ExpireSubmits(p_Ctx, false);
+
+    struct pollfd Poll = {p_Ctx->Socket, POLLIN, 0};
+    if (poll(&Poll, 1, 0) <= 0) return PdqOk;
+
+    ssize_t Bytes = recv(p_Ctx->Socket, p_Ctx->RecvBuffer + p_Ctx->RecvLen,
+                         sizeof(p_Ctx->RecvBuffer) - p_Ctx->RecvLen, 0);
+    if (Bytes <= 0) {
+        PdqSv2CtxDisconnect(p_Ctx);
+        return PdqErrorNotConnected;
+    }
+    p_Ctx->LastRxMs = GetMillis();
+
+    uint32_t End = p_Ctx->RecvLen + (uint32_t)Bytes;
+    uint32_t Pos = 0;
+
+    /* Rest of a frame too long for the buffer */
+    if (p_Ctx->RecvSkip > 0) {
+        uint32_t Skip = p_Ctx->RecvSkip < End ? p_Ctx->RecvSkip : End;
+        p_Ctx->RecvSkip -= Skip;
+        Pos = Skip;
+    }
+
+    if (p_Ctx->State == Sv2StateNoise && End - Pos >= PDQ_SV2_NOISE_ACT2_SIZE) {
+        FinishHandshake(p_Ctx, p_Ctx->RecvBuffer + Pos);
+        Pos += PDQ_SV2_NOISE_ACT2_SIZE;
+    }
+
+    /* The sealed header is opened as soon as it is in, so the payload
+     * alone has to fit the buffer */
+    while (p_Ctx->Socket >= 0 && p_Ctx->State != Sv2StateNoise) {
+        if (!p_Ctx->HasRxHeader) {
+            uint8_t Plain[PDQ_SV2_HEADER_SIZE];
+            if (End - Pos < PDQ_SV2_NOISE_HEADER_SIZE) break;
+            if (!PdqSv2CipherOpen(&p_Ctx->RxCipher, p_Ctx->RecvBuffer + Pos, PDQ_SV2_NOISE_HEADER_SIZE, Plain)) {
+                printf("[SV2] Frame header failed to decrypt, closing\n");
+                PdqSv2CtxDisconnect(p_Ctx);
+                break;
+            }
+            Pos += PDQ_SV2_NOISE_HEADER_SIZE;
+            PdqSv2DecodeHeader(Plain, &p_Ctx->RxHeader);
+
+            if (PDQ_SV2_HEADER_SIZE + p_Ctx->RxHeader.Length > PDQ_SV2_RECV_BUFFER_SIZE) {
+                printf("[SV2] WARN: frame type %02x of %u bytes, discarding\n",
+                       (unsigned)p_Ctx->RxHeader.MsgType, (unsigned)p_Ctx->RxHeader.Length);
+                p_Ctx->RxOversize++;
+                /* Its chunks still used up receive nonces */
+                p_Ctx->RxCipher.Nonce += PdqSv2NoiseChunkCount(p_Ctx->RxHeader.Length);
+                uint32_t Sealed = PdqSv2NoisePayloadSize(p_Ctx->RxHeader.Length);
+                uint32_t Avail = End - Pos;
+                if (Sealed > Avail) {
+                    p_Ctx->RecvSkip = Sealed - Avail;
+                    Pos = End;
+                } else {
+                    Pos += Sealed;
+                }
+                continue;
+            }
+            p_Ctx->HasRxHeader = true;
+        }
+
+        uint32_t Sealed = PdqSv2NoisePayloadSize(p_Ctx->RxHeader.Length);
+        uint8_t* p_Payload = p_Ctx->RecvBuffer + Pos;
+        if (End - Pos < Sealed) break;
+        if (Sealed > 0 && !PdqSv2CipherOpen(&p_Ctx->RxCipher, p_Payload, Sealed, p_Payload)) {
+            printf("[SV2] Frame failed to decrypt, closing\n");
+            PdqSv2CtxDisconnect(p_Ctx);
+            break;
+        }
+        p_Ctx->HasRxHeader = false;
+        ProcessFrame(p_Ctx, &p_Ctx->RxHeader, p_Payload);
+        Pos += Sealed;
+    }
+    if (p_Ctx->Socket < 0) return PdqErrorNotConnected;
+
+    p_Ctx->RecvLen = End - Pos;
+    if (Pos > 0 && p_Ctx->RecvLen > 0) memmove(p_Ctx->RecvBuffer, p_Ctx->RecvBuffer + Pos, p_Ctx->RecvLen);
+    return PdqOk;
+}
+
+PdqSv2State_t PdqSv2CtxGetState(const PdqSv2Context_t* p_Ctx)
+{
+    return p_Ctx ? p_Ctx->State : Sv2StateDisconnected;
+}
+
+bool PdqSv2CtxIsReady(const PdqSv2Context_t* p_Ctx)
+{
+    return p_Ctx != NULL && p_Ctx->State == Sv2StateReady;
+}
+
+bool PdqSv2CtxHasNewJob(PdqSv2Context_t* p_Ctx)
+{
+    if (p_Ctx == NULL || !p_Ctx->HasNewJob) return false;
+    p_Ctx->HasNewJob = false;
+    return true;
+}
+
+int PdqSv2CtxGetPollFd(const PdqSv2Context_t* p_Ctx, bool* p_WantWrite)
+{
+    if (p_WantWrite) {
+        *p_WantWrite = p_Ctx != NULL && p_Ctx->Socket >= 0 &&
+                       (p_Ctx->State == Sv2StateConnecting || p_Ctx->TxLen > 0);
+    }
+    return p_Ctx ? p_Ctx->Socket : -1;
+}
+
+uint64_t PdqSv2CtxGetLastRxMs(const PdqSv2Context_t* p_Ctx)
+{
+    return p_Ctx ? p_Ctx->LastRxMs : 0;
+}
+
+double PdqSv2CtxGetDifficulty(const PdqSv2Context_t* p_Ctx)
+{
+    if (p_Ctx == NULL || p_Ctx->State < Sv2StateOpen) return 0.0;
+    return PdqTargetToDifficulty(p_Ctx->Target);
+}
+
+PdqError_t PdqSv2CtxBuildJob(PdqSv2Context_t* p_Ctx, PdqMiningJob_t* p_MiningJob)
+{
+    if (p_Ctx == NULL || p_MiningJob == NULL) return PdqErrorInvalidParam;
+    if (!p_Ctx->HasActiveJob || !p_Ctx->HasPrevHash) return PdqErrorInvalidJob;
+    const PdqSv2Job_t* p_Job = FindJob(p_Ctx, p_Ctx->ActiveJobId);
+    if (p_Job == NULL) return PdqErrorInvalidJob;
+
+    /* version | prev_hash | merkle_root | ntime | nbits | nonce, all in
+     * the byte order SV2 already sends them in */
+    uint8_t Header[80];
+    uint32_t NTime = p_Job->MinNTime;
+    for (int i = 0; i < 4; i++) Header[i] = (uint8_t)(p_Job->Version >> (8 * i));
+    memcpy(Header + 4, p_Ctx->PrevHash, 32);
+    memcpy(Header + 36, p_Job->MerkleRoot, 32);
+    for (int i = 0; i < 4; i++) {
+        Header[68 + i] = (uint8_t)(NTime >> (8 * i));
+        Header[72 + i] = (uint8_t)(p_Ctx->NBits >> (8 * i));
+        Header[76 + i] = 0;
+    }
+
+    memset(p_MiningJob, 0, sizeof(*p_MiningJob));
+    PdqStratumHeaderToMiningJob(Header, p_MiningJob);
+    memcpy(p_MiningJob->Target, p_Ctx->Target, sizeof(p_MiningJob->Target));
+    snprintf(p_MiningJob->JobId, sizeof(p_MiningJob->JobId), "%x", (unsigned)p_Job->JobId);
+    p_MiningJob->Extranonce2 = 0;
+    p_MiningJob->NTime = NTime;
+    p_MiningJob->NonceStart = 0;
+    p_MiningJob->NonceEnd = 0xFFFFFFFF;
+    return PdqOk;
+}
+
+static bool ParseJobId(const char* p_JobId, uint32_t* p_Value)
+{
+    char* p_End = NULL;
+    unsigned long Value = strtoul(p_JobId, &p_End, 16);
+    if (p_End == p_JobId || *p_End != '\0' || Value > 0xFFFFFFFFul) return false;
+    *p_Value = (uint32_t)Value;
+    return true;
+}
+
+bool PdqSv2CtxIsJobActive(const PdqSv2Context_t* p_Ctx, const char* p_JobId)
+{
+    uint32_t JobId;
+    if (p_Ctx == NULL || p_JobId == NULL || !ParseJobId(p_JobId, &JobId)) return false;
+    for (int i = 0; i < PDQ_SV2_MAX_JOBS; i++) {
+        const PdqSv2Job_t* p_Job = &p_Ctx->Jobs[i];
+        if (p_Job->Used && !p_Job->Future && p_Job->JobId == JobId) return true;
+    }
+    return false;
+}
+
+PdqError_t PdqSv2CtxSubmitShare(PdqSv2Context_t* p_Ctx, const char* p_JobId,
+                                uint32_t Nonce, uint32_t NTime)
+{
+    if (p_Ctx == NULL || p_JobId == NULL) return PdqErrorInvalidParam;
+    if (p_Ctx->State != Sv2StateReady) return PdqErrorNotConnected;
+
+    uint32_t JobId;
+    if (!PdqSv2CtxIsJobActive(p_Ctx, p_JobId) || !ParseJobId(p_JobId, &JobId)) {
+        p_Ctx->SubmitStats.StaleDropped++;
+        printf("[SV2] Dropped stale share for job %s\n", p_JobId);
+        if (p_Ctx->p_OnSubmit) p_Ctx->p_OnSubmit(p_Ctx->p_OnSubmitArg, PdqSubmitStale, 0, 0);
+        return PdqErrorInvalidJob;
+    }
+    const PdqSv2Job_t* p_Job = FindJob(p_Ctx, JobId);
+
+    uint32_t Sequence = p_Ctx->Sequence++;
+    PdqSv2Writer_t W;
+    BeginTx(p_Ctx, &W, true, PDQ_SV2_MSG_SUBMIT_SHARES_STANDARD);
+    PdqSv2PutU32(&W, p_Ctx->ChannelId);
+    PdqSv2PutU32(&W, Sequence);
+    PdqSv2PutU32(&W, JobId);
+    PdqSv2PutU32(&W, Nonce);
+    PdqSv2PutU32(&W, NTime);
+    PdqSv2PutU32(&W, p_Job->Version);
+    PdqError_t Err = CommitTx(p_Ctx, &W);
+    if (Err == PdqOk) TrackSubmit(p_Ctx, Sequence);
+    return Err;
+}
+
+void PdqSv2CtxSetSubmitCallback(PdqSv2Context_t* p_Ctx, PdqStratumSubmitCallback_t Callback, void* p_Arg)
+{
+    if (p_Ctx == NULL) return;
+    p_Ctx->p_OnSubmit = Callback;
+    p_Ctx->p_OnSubmitArg = p_Arg;
+}
+
+void PdqSv2CtxGetSubmitStats(const PdqSv2Context_t* p_Ctx, PdqStratumSubmitStats_t* p_Stats)
+{
+    if (p_Ctx == NULL || p_Stats == NULL) return;
+    *p_Stats = p_Ctx->SubmitStats;
+}
+
+uint32_t PdqSv2CtxGetPendingSubmits(const PdqSv2Context_t* p_Ctx)
+{
+    uint32_t Count = 0;
+    if (p_Ctx == NULL) return 0;
+    for (int i = 0; i < PDQ_STRATUM_MAX_PENDING_SUBMITS; i++) {
+        if (p_Ctx->Pending[i].Used) Count++;
+    }
+    return Count;
+}
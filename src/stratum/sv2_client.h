@@ -0,0 +1,157 @@
+/**
+ * @file sv2_client.h
+ * @brief Stratum V2 mining protocol client (standard channels)
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Opens one standard channel: SetupConnection, OpenStandardMiningChannel,
+ * then NewMiningJob / SetNewPrevHash / SetTarget from the pool and
+ * SubmitSharesStandard back. A standard job is a ready merkle root, so
+ * building work is one 80-byte header and no coinbase hashing; jobs come
+ * out as the same PdqMiningJob_t the V1 client builds.
+ *
+ * The connection opens with the Noise NX handshake (sv2_noise.h) and
+ * every frame after it is encrypted. The pool's certificate is checked
+ * against the authority key given with PdqSv2CtxSetAuthorityKey; without
+ * one the channel is still encrypted but the pool is not authenticated.
+ */
+
+#ifndef PDQ_SV2_CLIENT_H
+#define PDQ_SV2_CLIENT_H
+
+#include "pdq_types.h"
+#include "stratum_client.h"
+#include "sv2_noise.h"
+#include "sv2_proto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_SV2_RECV_BUFFER_SIZE        512     /* Largest frame kept; longer ones are skipped */
+#define PDQ_SV2_TX_BUFFER_SIZE          1024    /* Sealed frames waiting for the socket */
+#define PDQ_SV2_TX_FRAME_SIZE           512     /* Largest outbound frame before sealing */
+#define PDQ_SV2_MAX_JOBS                8       /* Future and current jobs per channel */
+#define PDQ_SV2_HANDSHAKE_TIMEOUT_MS    30000
+#define PDQ_SV2_DEFAULT_HASHRATE        1e6f    /* nominal_hash_rate when none is given */
+
+typedef enum {
+    Sv2StateDisconnected = 0,
+    Sv2StateConnecting,
+    Sv2StateNoise,          /* Handshake act 1 sent, waiting for act 2 */
+    Sv2StateSetup,          /* SetupConnection sent */
+    Sv2StateOpening,        /* OpenStandardMiningChannel sent */
+    Sv2StateOpen,           /* Channel open, waiting for the first job */
+    Sv2StateReady
+} PdqSv2State_t;
+
+/* Job slot. JobId 0 is valid in SV2, so Used marks the slot. */
+typedef struct {
+    bool     Used;
+    bool     Future;        /* Waits for a SetNewPrevHash naming it */
+    uint32_t JobId;
+    uint32_t Version;
+    uint32_t MinNTime;
+    uint8_t  MerkleRoot[32];
+} PdqSv2Job_t;
+
+/* SubmitSharesStandard waiting for the pool. SV2 acknowledges in bulk:
+ * a success covers every sequence number up to its last_sequence_number. */
+typedef struct {
+    bool     Used;
+    uint32_t Sequence;
+    uint64_t SentMs;
+} PdqSv2PendingSubmit_t;
+
+typedef struct {
+    PdqSv2State_t             State;
+    int                       Socket;
+    uint64_t                  StageStartMs;
+    uint64_t                  LastRxMs;
+    /* Sealed bytes; room for a kept frame's payload and its MAC */
+    uint8_t                   RecvBuffer[PDQ_SV2_RECV_BUFFER_SIZE + PDQ_SV2_NOISE_MAC_SIZE];
+    uint32_t                  RecvLen;
+    uint32_t                  RecvSkip;     /* Bytes of an oversized frame still to drop */
+    PdqSv2FrameHeader_t       RxHeader;     /* Decrypted header of the frame being received */
+    bool                      HasRxHeader;
+    uint32_t                  RxFrames;
+    uint32_t                  RxMalformed;  /* Frames whose payload did not decode */
+    uint32_t                  RxOversize;
+    uint32_t                  RxUnknown;    /* Message types this client ignores */
+    uint8_t                   TxBuffer[PDQ_SV2_TX_BUFFER_SIZE];
+    uint32_t                  TxLen;
+    uint8_t                   TxFrame[PDQ_SV2_TX_FRAME_SIZE];
+    PdqSv2Noise_t             Noise;
+    PdqSv2Cipher_t            TxCipher;
+    PdqSv2Cipher_t            RxCipher;
+    uint8_t                   AuthorityKey[32];
+    bool                      HasAuthorityKey;
+    char                      Host[PDQ_MAX_HOST_LEN + 1];
+    uint16_t                  Port;
+    char                      Worker[PDQ_MAX_WORKER_LEN + 1];
+    float                     NominalHashRate;
+    uint32_t                  RequestId;
+    uint32_t                  ChannelId;
+    uint32_t                  Target[8];    /* Channel share target */
+    uint8_t                   ExtranoncePrefix[32];
+    uint8_t                   ExtranoncePrefixLen;
+    PdqSv2Job_t               Jobs[PDQ_SV2_MAX_JOBS];
+    uint32_t                  ActiveJobId;
+    bool                      HasActiveJob;
+    uint8_t                   PrevHash[32];
+    uint32_t                  NBits;
+    uint32_t                  PrevHashNTime;  /* min_ntime from SetNewPrevHash */
+    bool                      HasPrevHash;
+    bool                      HasNewJob;
+    uint32_t                  Sequence;
+    uint32_t                  SubmitTimeoutMs;
+    PdqSv2PendingSubmit_t     Pending[PDQ_STRATUM_MAX_PENDING_SUBMITS];
+    PdqStratumSubmitStats_t   SubmitStats;
+    PdqStratumSubmitCallback_t p_OnSubmit;
+    void*                     p_OnSubmitArg;
+} PdqSv2Context_t;
+
+PdqError_t    PdqSv2CtxInit(PdqSv2Context_t* p_Ctx);
+
+/* Resolve (blocking) and start a non-blocking connect. The handshake and
+ * channel open run from PdqSv2CtxProcess; the channel is opened for
+ * p_Worker announcing HashRate (H/s, 0 for the default). */
+PdqError_t    PdqSv2CtxConnectStart(PdqSv2Context_t* p_Ctx, const char* p_Host, uint16_t Port,
+                                    const char* p_Worker, float HashRate);
+PdqError_t    PdqSv2CtxDisconnect(PdqSv2Context_t* p_Ctx);
+/* Pool authority key (32-byte x-only, see PdqSv2ParseAuthorityKey) the
+ * handshake certificate must be signed with; NULL accepts any pool */
+void          PdqSv2CtxSetAuthorityKey(PdqSv2Context_t* p_Ctx, const uint8_t* p_Key);
+PdqError_t    PdqSv2CtxProcess(PdqSv2Context_t* p_Ctx);
+
+PdqSv2State_t PdqSv2CtxGetState(const PdqSv2Context_t* p_Ctx);
+bool          PdqSv2CtxIsReady(const PdqSv2Context_t* p_Ctx);
+bool          PdqSv2CtxHasNewJob(PdqSv2Context_t* p_Ctx);
+int           PdqSv2CtxGetPollFd(const PdqSv2Context_t* p_Ctx, bool* p_WantWrite);
+uint64_t      PdqSv2CtxGetLastRxMs(const PdqSv2Context_t* p_Ctx);
+/* Share difficulty equivalent of the channel target */
+double        PdqSv2CtxGetDifficulty(const PdqSv2Context_t* p_Ctx);
+
+/* Header of the active job with the channel target. JobId is the SV2
+ * job id in hex, Extranonce2 is 0: a standard channel has no extranonce
+ * to roll, each job is one 2^32 nonce range. */
+PdqError_t    PdqSv2CtxBuildJob(PdqSv2Context_t* p_Ctx, PdqMiningJob_t* p_MiningJob);
+
+/* Whether shares for this job (hex id from BuildJob) would be accepted */
+bool          PdqSv2CtxIsJobActive(const PdqSv2Context_t* p_Ctx, const char* p_JobId);
+
+/* SubmitSharesStandard. Shares for jobs retired by a SetNewPrevHash are
+ * dropped with PdqErrorInvalidJob and reported as PdqSubmitStale. */
+PdqError_t    PdqSv2CtxSubmitShare(PdqSv2Context_t* p_Ctx, const char* p_JobId,
+                                   uint32_t Nonce, uint32_t NTime);
+
+void          PdqSv2CtxSetSubmitCallback(PdqSv2Context_t* p_Ctx,
+                                         PdqStratumSubmitCallback_t Callback, void* p_Arg);
+void          PdqSv2CtxGetSubmitStats(const PdqSv2Context_t* p_Ctx, PdqStratumSubmitStats_t* p_Stats);
+uint32_t      PdqSv2CtxGetPendingSubmits(const PdqSv2Context_t* p_Ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
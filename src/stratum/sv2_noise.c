@@ -0,0 +1,587 @@
+/**
+ * @file sv2_noise.c
+ * @brief Stratum V2 Noise NX handshake and encrypted transport implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "sv2_noise.h"
+#include "sv2_proto.h"
+#include "core/secp256k1.h"
+#include "core/sha256_engine.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#ifdef ESP32
+#include "esp_random.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define PROTOCOL_NAME   "Noise_NX_Secp256k1+EllSwift_ChaChaPoly_SHA256"
+#define CHUNK_PAYLOAD   (PDQ_SV2_NOISE_MAX_CHUNK - PDQ_SV2_NOISE_MAC_SIZE)
+
+static uint32_t Load32(const uint8_t* p_In)
+{
+    return (uint32_t)p_In[0] | (uint32_t)p_In[1] << 8 | (uint32_t)p_In[2] << 16 | (uint32_t)p_In[3] << 24;
+}
+
+static void Store32(uint8_t* p_Out, uint32_t Value)
+{
+    for (int i = 0; i < 4; i++) p_Out[i] = (uint8_t)(Value >> (8 * i));
+}
+
+static void Store64(uint8_t* p_Out, uint64_t Value)
+{
+    for (int i = 0; i < 8; i++) p_Out[i] = (uint8_t)(Value >> (8 * i));
+}
+
+/* ---- ChaCha20 (RFC 8439 section 2.3) ---- */
+
+#define ROTL32(x, n)    (((x) << (n)) | ((x) >> (32 - (n))))
+#define QUARTER(a, b, c, d) do {                        \
+    a += b; d ^= a; d = ROTL32(d, 16);                  \
+    c += d; b ^= c; b = ROTL32(b, 12);                  \
+    a += b; d ^= a; d = ROTL32(d, 8);                   \
+    c += d; b ^= c; b = ROTL32(b, 7);                   \
+} while (0)
+
+static void ChaChaBlock(const uint8_t* p_Key, uint32_t Counter, const uint8_t* p_Nonce, uint8_t* p_Out)
+{
+    uint32_t In[16];
+    uint32_t X[16];
+    In[0] = 0x61707865;
+    In[1] = 0x3320646e;
+    In[2] = 0x79622d32;
+    In[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) In[4 + i] = Load32(p_Key + 4 * i);
+    In[12] = Counter;
+    for (int i = 0; i < 3; i++) In[13 + i] = Load32(p_Nonce + 4 * i);
+
+    memcpy(X, In, sizeof(X));
+    for (int Round = 0; Round < 10; Round++) {
+        QUARTER(X[0], X[4], X[8],  X[12]);
+        QUARTER(X[1], X[5], X[9],  X[13]);
+        QUARTER(X[2], X[6], X[10], X[14]);
+        QUARTER(X[3], X[7], X[11], X[15]);
+        QUARTER(X[0], X[5], X[10], X[15]);
+        QUARTER(X[1], X[6], X[11], X[12]);
+        QUARTER(X[2], X[7], X[8],  X[13]);
+        QUARTER(X[3], X[4], X[9],  X[14]);
+    }
+    for (int i = 0; i < 16; i++) Store32(p_Out + 4 * i, X[i] + In[i]);
+}
+
+static void ChaChaXor(const uint8_t* p_Key, uint32_t Counter, const uint8_t* p_Nonce,
+                      const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    uint8_t Block[64];
+    while (Len > 0) {
+        uint32_t Take = Len < 64 ? Len : 64;
+        ChaChaBlock(p_Key, Counter++, p_Nonce, Block);
+        for (uint32_t i = 0; i < Take; i++) p_Out[i] = p_In[i] ^ Block[i];
+        p_In += Take;
+        p_Out += Take;
+        Len -= Take;
+    }
+}
+
+/* ---- Poly1305 (RFC 8439 section 2.5), 26-bit limbs ---- */
+
+typedef struct {
+    uint32_t R[5];
+    uint32_t H[5];
+    uint32_t Pad[4];
+} Poly1305_t;
+
+static void PolyInit(Poly1305_t* p_P, const uint8_t* p_Key)
+{
+    p_P->R[0] = Load32(p_Key) & 0x3ffffff;
+    p_P->R[1] = (Load32(p_Key + 3) >> 2) & 0x3ffff03;
+    p_P->R[2] = (Load32(p_Key + 6) >> 4) & 0x3ffc0ff;
+    p_P->R[3] = (Load32(p_Key + 9) >> 6) & 0x3f03fff;
+    p_P->R[4] = (Load32(p_Key + 12) >> 8) & 0x00fffff;
+    memset(p_P->H, 0, sizeof(p_P->H));
+    for (int i = 0; i < 4; i++) p_P->Pad[i] = Load32(p_Key + 16 + 4 * i);
+}
+
+/* One 16-byte block; shorter tails are zero padded, as the AEAD wants */
+static void PolyBlock(Poly1305_t* p_P, const uint8_t* p_Block)
+{
+    const uint32_t* R = p_P->R;
+    uint32_t* H = p_P->H;
+    uint32_t S1 = R[1] * 5, S2 = R[2] * 5, S3 = R[3] * 5, S4 = R[4] * 5;
+
+    H[0] += Load32(p_Block) & 0x3ffffff;
+    H[1] += (Load32(p_Block + 3) >> 2) & 0x3ffffff;
+    H[2] += (Load32(p_Block + 6) >> 4) & 0x3ffffff;
+    H[3] += (Load32(p_Block + 9) >> 6) & 0x3ffffff;
+    H[4] += (Load32(p_Block + 12) >> 8) | (1u << 24);
+
+    uint64_t D0 = (uint64_t)H[0] * R[0] + (uint64_t)H[1] * S4 + (uint64_t)H[2] * S3 +
+                  (uint64_t)H[3] * S2 + (uint64_t)H[4] * S1;
+    uint64_t D1 = (uint64_t)H[0] * R[1] + (uint64_t)H[1] * R[0] + (uint64_t)H[2] * S4 +
+                  (uint64_t)H[3] * S3 + (uint64_t)H[4] * S2;
+    uint64_t D2 = (uint64_t)H[0] * R[2] + (uint64_t)H[1] * R[1] + (uint64_t)H[2] * R[0] +
+                  (uint64_t)H[3] * S4 + (uint64_t)H[4] * S3;
+    uint64_t D3 = (uint64_t)H[0] * R[3] + (uint64_t)H[1] * R[2] + (uint64_t)H[2] * R[1] +
+                  (uint64_t)H[3] * R[0] + (uint64_t)H[4] * S4;
+    uint64_t D4 = (uint64_t)H[0] * R[4] + (uint64_t)H[1] * R[3] + (uint64_t)H[2] * R[2] +
+                  (uint64_t)H[3] * R[1] + (uint64_t)H[4] * R[0];
+
+    uint32_t C = (uint32_t)(D0 >> 26); H[0] = (uint32_t)D0 & 0x3ffffff;
+    D1 += C; C = (uint32_t)(D1 >> 26); H[1] = (uint32_t)D1 & 0x3ffffff;
+    D2 += C; C = (uint32_t)(D2 >> 26); H[2] = (uint32_t)D2 & 0x3ffffff;
+    D3 += C; C = (uint32_t)(D3 >> 26); H[3] = (uint32_t)D3 & 0x3ffffff;
+    D4 += C; C = (uint32_t)(D4 >> 26); H[4] = (uint32_t)D4 & 0x3ffffff;
+    H[0] += C * 5; C = H[0] >> 26; H[0] &= 0x3ffffff;
+    H[1] += C;
+}
+
+static void PolyUpdate(Poly1305_t* p_P, const uint8_t* p_Data, uint32_t Len)
+{
+    uint8_t Block[16];
+    while (Len > 0) {
+        uint32_t Take = Len < 16 ? Len : 16;
+        memset(Block, 0, sizeof(Block));
+        memcpy(Block, p_Data, Take);
+        PolyBlock(p_P, Block);
+        p_Data += Take;
+        Len -= Take;
+    }
+}
+
+static void PolyFinish(Poly1305_t* p_P, uint8_t* p_Tag)
+{
+    uint32_t* H = p_P->H;
+    uint32_t C, G[5];
+
+    C = H[1] >> 26; H[1] &= 0x3ffffff;
+    H[2] += C; C = H[2] >> 26; H[2] &= 0x3ffffff;
+    H[3] += C; C = H[3] >> 26; H[3] &= 0x3ffffff;
+    H[4] += C; C = H[4] >> 26; H[4] &= 0x3ffffff;
+    H[0] += C * 5; C = H[0] >> 26; H[0] &= 0x3ffffff;
+    H[1] += C;
+
+    /* h - p, kept when it does not borrow */
+    G[0] = H[0] + 5; C = G[0] >> 26; G[0] &= 0x3ffffff;
+    G[1] = H[1] + C; C = G[1] >> 26; G[1] &= 0x3ffffff;
+    G[2] = H[2] + C; C = G[2] >> 26; G[2] &= 0x3ffffff;
+    G[3] = H[3] + C; C = G[3] >> 26; G[3] &= 0x3ffffff;
+    G[4] = H[4] + C - (1u << 26);
+    uint32_t Mask = (G[4] >> 31) - 1;
+    for (int i = 0; i < 5; i++) H[i] = (H[i] & ~Mask) | (G[i] & Mask);
+
+    uint32_t W0 = H[0] | H[1] << 26;
+    uint32_t W1 = H[1] >> 6 | H[2] << 20;
+    uint32_t W2 = H[2] >> 12 | H[3] << 14;
+    uint32_t W3 = H[3] >> 18 | H[4] << 8;
+    uint64_t F = (uint64_t)W0 + p_P->Pad[0];
+    Store32(p_Tag, (uint32_t)F);
+    F = (uint64_t)W1 + p_P->Pad[1] + (F >> 32);
+    Store32(p_Tag + 4, (uint32_t)F);
+    F = (uint64_t)W2 + p_P->Pad[2] + (F >> 32);
+    Store32(p_Tag + 8, (uint32_t)F);
+    F = (uint64_t)W3 + p_P->Pad[3] + (F >> 32);
+    Store32(p_Tag + 12, (uint32_t)F);
+}
+
+/* ---- ChaCha20-Poly1305 AEAD (RFC 8439 section 2.8) ---- */
+
+static void AeadTag(const uint8_t* p_Key, const uint8_t* p_Nonce, const uint8_t* p_Ad, uint32_t AdLen,
+                    const uint8_t* p_Cipher, uint32_t Len, uint8_t* p_Tag)
+{
+    uint8_t Block[64];
+    uint8_t Lengths[16];
+    Poly1305_t Poly;
+
+    ChaChaBlock(p_Key, 0, p_Nonce, Block);
+    PolyInit(&Poly, Block);
+    PolyUpdate(&Poly, p_Ad, AdLen);
+    PolyUpdate(&Poly, p_Cipher, Len);
+    Store64(Lengths, AdLen);
+    Store64(Lengths + 8, Len);
+    PolyUpdate(&Poly, Lengths, sizeof(Lengths));
+    PolyFinish(&Poly, p_Tag);
+}
+
+static void MakeNonce(uint64_t Counter, uint8_t* p_Nonce)
+{
+    memset(p_Nonce, 0, 4);
+    Store64(p_Nonce + 4, Counter);
+}
+
+void PdqSv2AeadSeal(const uint8_t* p_Key, const uint8_t* p_Nonce, const uint8_t* p_Ad, uint32_t AdLen,
+                    const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    ChaChaXor(p_Key, 1, p_Nonce, p_In, Len, p_Out);
+    AeadTag(p_Key, p_Nonce, p_Ad, AdLen, p_Out, Len, p_Out + Len);
+}
+
+bool PdqSv2AeadOpen(const uint8_t* p_Key, const uint8_t* p_Nonce, const uint8_t* p_Ad, uint32_t AdLen,
+                    const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    if (Len < PDQ_SV2_NOISE_MAC_SIZE) return false;
+    uint32_t TextLen = Len - PDQ_SV2_NOISE_MAC_SIZE;
+    uint8_t Tag[PDQ_SV2_NOISE_MAC_SIZE];
+    AeadTag(p_Key, p_Nonce, p_Ad, AdLen, p_In, TextLen, Tag);
+
+    uint8_t Diff = 0;
+    for (int i = 0; i < PDQ_SV2_NOISE_MAC_SIZE; i++) Diff |= Tag[i] ^ p_In[TextLen + i];
+    if (Diff != 0) return false;
+    ChaChaXor(p_Key, 1, p_Nonce, p_In, TextLen, p_Out);
+    return true;
+}
+
+/* Noise AEAD under p_Cipher's key and next nonce */
+static void CipherSealAd(PdqSv2Cipher_t* p_Cipher, const uint8_t* p_Ad, uint32_t AdLen,
+                         const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    uint8_t Nonce[12];
+    MakeNonce(p_Cipher->Nonce++, Nonce);
+    PdqSv2AeadSeal(p_Cipher->Key, Nonce, p_Ad, AdLen, p_In, Len, p_Out);
+}
+
+static bool CipherOpenAd(PdqSv2Cipher_t* p_Cipher, const uint8_t* p_Ad, uint32_t AdLen,
+                         const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    uint8_t Nonce[12];
+    MakeNonce(p_Cipher->Nonce++, Nonce);
+    return PdqSv2AeadOpen(p_Cipher->Key, Nonce, p_Ad, AdLen, p_In, Len, p_Out);
+}
+
+void PdqSv2CipherSeal(PdqSv2Cipher_t* p_Cipher, const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    CipherSealAd(p_Cipher, NULL, 0, p_In, Len, p_Out);
+}
+
+bool PdqSv2CipherOpen(PdqSv2Cipher_t* p_Cipher, const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    return CipherOpenAd(p_Cipher, NULL, 0, p_In, Len, p_Out);
+}
+
+uint32_t PdqSv2NoiseChunkCount(uint32_t PayloadLen)
+{
+    return (PayloadLen + CHUNK_PAYLOAD - 1) / CHUNK_PAYLOAD;
+}
+
+uint32_t PdqSv2NoisePayloadSize(uint32_t PayloadLen)
+{
+    return PayloadLen + PdqSv2NoiseChunkCount(PayloadLen) * PDQ_SV2_NOISE_MAC_SIZE;
+}
+
+uint32_t PdqSv2NoiseFrameSize(uint32_t FrameLen)
+{
+    return PDQ_SV2_NOISE_HEADER_SIZE + PdqSv2NoisePayloadSize(FrameLen - PDQ_SV2_HEADER_SIZE);
+}
+
+void PdqSv2NoiseSealFrame(PdqSv2Cipher_t* p_Cipher, const uint8_t* p_Frame, uint32_t FrameLen,
+                          uint8_t* p_Out)
+{
+    PdqSv2CipherSeal(p_Cipher, p_Frame, PDQ_SV2_HEADER_SIZE, p_Out);
+    p_Out += PDQ_SV2_NOISE_HEADER_SIZE;
+
+    const uint8_t* p_Payload = p_Frame + PDQ_SV2_HEADER_SIZE;
+    uint32_t Left = FrameLen - PDQ_SV2_HEADER_SIZE;
+    while (Left > 0) {
+        uint32_t Take = Left < CHUNK_PAYLOAD ? Left : CHUNK_PAYLOAD;
+        PdqSv2CipherSeal(p_Cipher, p_Payload, Take, p_Out);
+        p_Payload += Take;
+        p_Out += Take + PDQ_SV2_NOISE_MAC_SIZE;
+        Left -= Take;
+    }
+}
+
+bool PdqSv2NoiseRandom(uint8_t* p_Out, size_t Len)
+{
+#ifdef ESP32
+    esp_fill_random(p_Out, Len);
+    return true;
+#else
+    int Fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (Fd < 0) return false;
+    size_t Done = 0;
+    while (Done < Len) {
+        ssize_t Got = read(Fd, p_Out + Done, Len - Done);
+        if (Got <= 0) break;
+        Done += (size_t)Got;
+    }
+    close(Fd);
+    return Done == Len;
+#endif
+}
+
+/* ---- HMAC-SHA256 and the Noise HKDF ---- */
+
+static void Hmac(const uint8_t* p_Key, const uint8_t* p_Data, size_t Len,
+                 const uint8_t* p_Data2, size_t Len2, uint8_t* p_Mac)
+{
+    uint8_t Pad[64];
+    uint8_t Inner[32];
+    PdqSha256Context_t Ctx;
+
+    memset(Pad, 0x36, sizeof(Pad));
+    for (int i = 0; i < 32; i++) Pad[i] ^= p_Key[i];
+    PdqSha256Init(&Ctx);
+    PdqSha256Update(&Ctx, Pad, sizeof(Pad));
+    PdqSha256Update(&Ctx, p_Data, Len);
+    PdqSha256Update(&Ctx, p_Data2, Len2);
+    PdqSha256Final(&Ctx, Inner);
+
+    memset(Pad, 0x5c, sizeof(Pad));
+    for (int i = 0; i < 32; i++) Pad[i] ^= p_Key[i];
+    PdqSha256Init(&Ctx);
+    PdqSha256Update(&Ctx, Pad, sizeof(Pad));
+    PdqSha256Update(&Ctx, Inner, sizeof(Inner));
+    PdqSha256Final(&Ctx, p_Mac);
+}
+
+static void Hkdf2(const uint8_t* p_Ck, const uint8_t* p_Ikm, size_t IkmLen, uint8_t* p_Out1, uint8_t* p_Out2)
+{
+    static const uint8_t One = 0x01;
+    static const uint8_t Two = 0x02;
+    uint8_t Temp[32];
+    uint8_t Out1[32];
+    Hmac(p_Ck, p_Ikm, IkmLen, NULL, 0, Temp);
+    Hmac(Temp, &One, 1, NULL, 0, Out1);
+    Hmac(Temp, Out1, 32, &Two, 1, p_Out2);
+    memcpy(p_Out1, Out1, 32);
+}
+
+/* ---- Noise symmetric state ---- */
+
+static void MixHash(PdqSv2Noise_t* p_Noise, const uint8_t* p_Data, size_t Len)
+{
+    PdqSha256Context_t Ctx;
+    PdqSha256Init(&Ctx);
+    PdqSha256Update(&Ctx, p_Noise->H, 32);
+    PdqSha256Update(&Ctx, p_Data, Len);
+    PdqSha256Final(&Ctx, p_Noise->H);
+}
+
+static void MixKey(PdqSv2Noise_t* p_Noise, const uint8_t* p_Ikm)
+{
+    Hkdf2(p_Noise->Ck, p_Ikm, 32, p_Noise->Ck, p_Noise->Cipher.Key);
+    p_Noise->Cipher.Nonce = 0;
+}
+
+static void EncryptAndHash(PdqSv2Noise_t* p_Noise, const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    CipherSealAd(&p_Noise->Cipher, p_Noise->H, 32, p_In, Len, p_Out);
+    MixHash(p_Noise, p_Out, Len + PDQ_SV2_NOISE_MAC_SIZE);
+}
+
+static bool DecryptAndHash(PdqSv2Noise_t* p_Noise, const uint8_t* p_In, uint32_t Len, uint8_t* p_Out)
+{
+    if (!CipherOpenAd(&p_Noise->Cipher, p_Noise->H, 32, p_In, Len, p_Out)) return false;
+    MixHash(p_Noise, p_In, Len);
+    return true;
+}
+
+static void InitSymmetric(PdqSv2Noise_t* p_Noise)
+{
+    memset(p_Noise, 0, sizeof(*p_Noise));
+    /* The name is longer than a hash, so h starts as its hash; the
+     * prologue is empty but still mixed in */
+    PdqSha256((const uint8_t*)PROTOCOL_NAME, strlen(PROTOCOL_NAME), p_Noise->H);
+    memcpy(p_Noise->Ck, p_Noise->H, 32);
+    MixHash(p_Noise, NULL, 0);
+}
+
+static void Split(const PdqSv2Noise_t* p_Noise, PdqSv2Cipher_t* p_First, PdqSv2Cipher_t* p_Second)
+{
+    Hkdf2(p_Noise->Ck, NULL, 0, p_First->Key, p_Second->Key);
+    p_First->Nonce = 0;
+    p_Second->Nonce = 0;
+}
+
+static bool NewKey(uint8_t* p_SecKey, uint8_t* p_Ell)
+{
+    uint8_t Rnd[32];
+    do {
+        if (!PdqSv2NoiseRandom(p_SecKey, 32)) return false;
+    } while (!PdqSecpSecKeyValid(p_SecKey));
+    return PdqSv2NoiseRandom(Rnd, sizeof(Rnd)) && PdqSecpEllSwiftCreate(p_SecKey, Rnd, p_Ell);
+}
+
+/* SHA256(version || valid_from || not_valid_after || static x-only key) */
+static void CertificateHash(const uint8_t* p_Cert, const uint8_t* p_StaticX, uint8_t* p_Hash)
+{
+    PdqSha256Context_t Ctx;
+    PdqSha256Init(&Ctx);
+    PdqSha256Update(&Ctx, p_Cert, 10);
+    PdqSha256Update(&Ctx, p_StaticX, 32);
+    PdqSha256Final(&Ctx, p_Hash);
+}
+
+PdqError_t PdqSv2NoiseStart(PdqSv2Noise_t* p_Noise, uint8_t* p_Act1)
+{
+    if (p_Noise == NULL || p_Act1 == NULL) return PdqErrorInvalidParam;
+    InitSymmetric(p_Noise);
+    if (!NewKey(p_Noise->EphemeralKey, p_Noise->EphemeralEll)) return PdqErrorNoMemory;
+
+    /* -> e, and an empty payload */
+    MixHash(p_Noise, p_Noise->EphemeralEll, 64);
+    MixHash(p_Noise, NULL, 0);
+    memcpy(p_Act1, p_Noise->EphemeralEll, PDQ_SV2_NOISE_ACT1_SIZE);
+    return PdqOk;
+}
+
+PdqError_t PdqSv2NoiseFinish(PdqSv2Noise_t* p_Noise, const uint8_t* p_Act2,
+                             const uint8_t* p_AuthorityKey, uint32_t NowSec,
+                             PdqSv2Cipher_t* p_Send, PdqSv2Cipher_t* p_Recv)
+{
+    if (p_Noise == NULL || p_Act2 == NULL || p_Send == NULL || p_Recv == NULL) return PdqErrorInvalidParam;
+
+    uint8_t Secret[32];
+    uint8_t StaticEll[64];
+    uint8_t Cert[PDQ_SV2_NOISE_CERT_SIZE];
+    PdqError_t Err = PdqErrorAuthFailed;
+
+    /* <- e, ee */
+    const uint8_t* p_RemoteEph = p_Act2;
+    MixHash(p_Noise, p_RemoteEph, 64);
+    if (!PdqSecpEllSwiftXdh(p_Noise->EphemeralEll, p_RemoteEph, p_Noise->EphemeralKey, true, Secret)) {
+        goto Done;
+    }
+    MixKey(p_Noise, Secret);
+
+    /* s, es */
+    if (!DecryptAndHash(p_Noise, p_Act2 + 64, 64 + PDQ_SV2_NOISE_MAC_SIZE, StaticEll)) goto Done;
+    if (!PdqSecpEllSwiftXdh(p_Noise->EphemeralEll, StaticEll, p_Noise->EphemeralKey, true, Secret)) {
+        goto Done;
+    }
+    MixKey(p_Noise, Secret);
+
+    /* Certificate payload */
+    if (!DecryptAndHash(p_Noise, p_Act2 + 144, PDQ_SV2_NOISE_CERT_SIZE + PDQ_SV2_NOISE_MAC_SIZE, Cert)) {
+        goto Done;
+    }
+    uint32_t ValidFrom = Load32(Cert + 2);
+    uint32_t NotValidAfter = Load32(Cert + 6);
+    if (NowSec >= PDQ_SV2_NOISE_SANE_TIME && (NowSec < ValidFrom || NowSec > NotValidAfter)) goto Done;
+    if (p_AuthorityKey != NULL) {
+        uint8_t StaticX[32];
+        uint8_t Hash[32];
+        PdqSecpEllSwiftDecode(StaticEll, StaticX);
+        CertificateHash(Cert, StaticX, Hash);
+        if (!PdqSecpSchnorrVerify(p_AuthorityKey, Hash, Cert + 10)) goto Done;
+    }
+
+    Split(p_Noise, p_Send, p_Recv);
+    Err = PdqOk;
+
+Done:
+    memset(Secret, 0, sizeof(Secret));
+    memset(p_Noise, 0, sizeof(*p_Noise));
+    return Err;
+}
+
+PdqError_t PdqSv2NoiseRespond(const uint8_t* p_Act1, const uint8_t* p_StaticKey, const uint8_t* p_Cert,
+                              uint8_t* p_Act2, PdqSv2Cipher_t* p_Send, PdqSv2Cipher_t* p_Recv)
+{
+    if (p_Act1 == NULL || p_StaticKey == NULL || p_Cert == NULL || p_Act2 == NULL ||
+        p_Send == NULL || p_Recv == NULL) {
+        return PdqErrorInvalidParam;
+    }
+
+    PdqSv2Noise_t Noise;
+    uint8_t Secret[32];
+    uint8_t StaticEll[64];
+    uint8_t Rnd[32];
+    PdqError_t Err = PdqErrorAuthFailed;
+
+    /* -> e */
+    InitSymmetric(&Noise);
+    MixHash(&Noise, p_Act1, 64);
+    MixHash(&Noise, NULL, 0);
+
+    /* <- e, ee */
+    if (!NewKey(Noise.EphemeralKey, Noise.EphemeralEll)) goto Done;
+    memcpy(p_Act2, Noise.EphemeralEll, 64);
+    MixHash(&Noise, Noise.EphemeralEll, 64);
+    if (!PdqSecpEllSwiftXdh(p_Act1, Noise.EphemeralEll, Noise.EphemeralKey, false, Secret)) goto Done;
+    MixKey(&Noise, Secret);
+
+    /* s, es */
+    if (!PdqSv2NoiseRandom(Rnd, sizeof(Rnd)) || !PdqSecpEllSwiftCreate(p_StaticKey, Rnd, StaticEll)) goto Done;
+    EncryptAndHash(&Noise, StaticEll, 64, p_Act2 + 64);
+    if (!PdqSecpEllSwiftXdh(p_Act1, StaticEll, p_StaticKey, false, Secret)) goto Done;
+    MixKey(&Noise, Secret);
+
+    EncryptAndHash(&Noise, p_Cert, PDQ_SV2_NOISE_CERT_SIZE, p_Act2 + 144);
+
+    /* The initiator sends with the first key */
+    Split(&Noise, p_Recv, p_Send);
+    Err = PdqOk;
+
+Done:
+    memset(Secret, 0, sizeof(Secret));
+    memset(&Noise, 0, sizeof(Noise));
+    return Err;
+}
+
+PdqError_t PdqSv2NoiseSignCertificate(const uint8_t* p_AuthorityKey, const uint8_t* p_StaticKey,
+                                      uint32_t ValidFrom, uint32_t NotValidAfter, uint8_t* p_Cert)
+{
+    if (p_AuthorityKey == NULL || p_StaticKey == NULL || p_Cert == NULL) return PdqErrorInvalidParam;
+
+    uint8_t StaticX[32];
+    uint8_t Hash[32];
+    uint8_t Aux[32];
+    if (!PdqSecpPubkeyXOnly(p_StaticKey, StaticX)) return PdqErrorInvalidParam;
+    if (!PdqSv2NoiseRandom(Aux, sizeof(Aux))) return PdqErrorNoMemory;
+
+    p_Cert[0] = (uint8_t)PDQ_SV2_NOISE_CERT_VERSION;
+    p_Cert[1] = (uint8_t)(PDQ_SV2_NOISE_CERT_VERSION >> 8);
+    Store32(p_Cert + 2, ValidFrom);
+    Store32(p_Cert + 6, NotValidAfter);
+    CertificateHash(p_Cert, StaticX, Hash);
+    return PdqSecpSchnorrSign(p_AuthorityKey, Hash, Aux, p_Cert + 10) ? PdqOk : PdqErrorInvalidParam;
+}
+
+/* Base58check payload: version U16 (1) then the x-only key */
+static bool ParseBase58Key(const char* p_Str, uint8_t* p_Key)
+{
+    static const char s_Alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+    uint8_t Raw[38];
+    memset(Raw, 0, sizeof(Raw));
+
+    for (const char* p_C = p_Str; *p_C != '\0'; p_C++) {
+        const char* p_Hit = strchr(s_Alphabet, *p_C);
+        if (p_Hit == NULL) return false;
+        uint32_t Carry = (uint32_t)(p_Hit - s_Alphabet);
+        for (int i = (int)sizeof(Raw) - 1; i >= 0; i--) {
+            Carry += (uint32_t)Raw[i] * 58;
+            Raw[i] = (uint8_t)Carry;
+            Carry >>= 8;
+        }
+        if (Carry != 0) return false;
+    }
+
+    uint8_t Check[32];
+    PdqSha256d(Raw, 34, Check);
+    if (memcmp(Check, Raw + 34, 4) != 0 || Raw[0] != 0x01 || Raw[1] != 0x00) return false;
+    memcpy(p_Key, Raw + 2, 32);
+    return true;
+}
+
+bool PdqSv2ParseAuthorityKey(const char* p_Str, uint8_t* p_Key)
+{
+    if (p_Str == NULL || p_Key == NULL) return false;
+
+    uint8_t Key[32];
+    if (strlen(p_Str) == 64) {
+        for (int i = 0; i < 32; i++) {
+            char Pair[3] = {p_Str[2 * i], p_Str[2 * i + 1], '\0'};
+            if (!isxdigit((unsigned char)Pair[0]) || !isxdigit((unsigned char)Pair[1])) return false;
+            Key[i] = (uint8_t)strtoul(Pair, NULL, 16);
+        }
+    } else if (!ParseBase58Key(p_Str, Key)) {
+        return false;
+    }
+    memcpy(p_Key, Key, 32);
+    return true;
+}
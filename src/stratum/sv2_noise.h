@@ -0,0 +1,111 @@
+/**
+ * @file sv2_noise.h
+ * @brief Stratum V2 Noise NX handshake and encrypted transport
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Noise_NX_Secp256k1+EllSwift_ChaChaPoly_SHA256 as the SV2 spec defines
+ * it. The miner (initiator) sends a 64-byte ElligatorSwift ephemeral
+ * key; the pool answers with its ephemeral key, its static key and a
+ * certificate over that static key signed by the pool's authority key,
+ * the last two encrypted. Both sides then split the chaining key into
+ * one ChaCha20-Poly1305 key per direction.
+ *
+ * After the handshake every SV2 frame goes out as its 6-byte header
+ * sealed on its own (22 bytes) followed by the payload sealed in chunks
+ * of at most PDQ_SV2_NOISE_MAX_CHUNK bytes. Each seal uses the next
+ * nonce of that direction's cipher.
+ */
+
+#ifndef PDQ_SV2_NOISE_H
+#define PDQ_SV2_NOISE_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_SV2_NOISE_KEY_SIZE          32
+#define PDQ_SV2_NOISE_MAC_SIZE          16
+#define PDQ_SV2_NOISE_ACT1_SIZE         64      /* Initiator ephemeral key */
+#define PDQ_SV2_NOISE_ACT2_SIZE         234     /* 64 + (64 + 16) + (74 + 16) */
+#define PDQ_SV2_NOISE_CERT_SIZE         74      /* version, valid_from, not_valid_after, signature */
+#define PDQ_SV2_NOISE_HEADER_SIZE       22      /* Sealed frame header */
+#define PDQ_SV2_NOISE_MAX_CHUNK         65535   /* Sealed payload chunk, MAC included */
+#define PDQ_SV2_NOISE_CERT_VERSION      0
+/* Wall clock readings before this (2020-01-01) mean the clock is unset,
+ * and the certificate validity window is not checked. */
+#define PDQ_SV2_NOISE_SANE_TIME         1577836800u
+
+typedef struct {
+    uint8_t  Key[PDQ_SV2_NOISE_KEY_SIZE];
+    uint64_t Nonce;
+} PdqSv2Cipher_t;
+
+/* Handshake state between act 1 and act 2 */
+typedef struct {
+    uint8_t        H[32];
+    uint8_t        Ck[32];
+    PdqSv2Cipher_t Cipher;
+    uint8_t        EphemeralKey[32];
+    uint8_t        EphemeralEll[64];
+} PdqSv2Noise_t;
+
+/* ChaCha20-Poly1305 (RFC 8439) with a 12-byte nonce. Seal writes Len +
+ * MAC bytes; Open takes Len including the MAC, checks it before
+ * decrypting, and may run in place. */
+void     PdqSv2AeadSeal(const uint8_t* p_Key, const uint8_t* p_Nonce, const uint8_t* p_Ad, uint32_t AdLen,
+                        const uint8_t* p_In, uint32_t Len, uint8_t* p_Out);
+bool     PdqSv2AeadOpen(const uint8_t* p_Key, const uint8_t* p_Nonce, const uint8_t* p_Ad, uint32_t AdLen,
+                        const uint8_t* p_In, uint32_t Len, uint8_t* p_Out);
+
+/* Transport messages: no associated data, and the Noise nonce of four
+ * zero bytes and the little-endian counter, advanced per message */
+void     PdqSv2CipherSeal(PdqSv2Cipher_t* p_Cipher, const uint8_t* p_In, uint32_t Len, uint8_t* p_Out);
+bool     PdqSv2CipherOpen(PdqSv2Cipher_t* p_Cipher, const uint8_t* p_In, uint32_t Len, uint8_t* p_Out);
+
+/* Wire size of a sealed payload of PayloadLen bytes, and of a whole
+ * plaintext frame (header included) once sealed */
+uint32_t PdqSv2NoisePayloadSize(uint32_t PayloadLen);
+uint32_t PdqSv2NoiseFrameSize(uint32_t FrameLen);
+/* Number of sealed chunks a payload takes; a dropped frame must still
+ * advance the receive nonce by this much */
+uint32_t PdqSv2NoiseChunkCount(uint32_t PayloadLen);
+/* Seal one plaintext frame (header and payload) into
+ * PdqSv2NoiseFrameSize(FrameLen) bytes at p_Out */
+void     PdqSv2NoiseSealFrame(PdqSv2Cipher_t* p_Cipher, const uint8_t* p_Frame, uint32_t FrameLen,
+                              uint8_t* p_Out);
+
+/* Fill p_Out from the system RNG */
+bool     PdqSv2NoiseRandom(uint8_t* p_Out, size_t Len);
+
+/* Initiator: act 1 into p_Act1 */
+PdqError_t PdqSv2NoiseStart(PdqSv2Noise_t* p_Noise, uint8_t* p_Act1);
+
+/* Initiator: process act 2 and derive the transport ciphers. The
+ * certificate is checked against p_AuthorityKey (32-byte x-only) when
+ * given, and its validity window against NowSec when that is a sane
+ * wall clock. PdqErrorAuthFailed covers a bad MAC and a bad certificate. */
+PdqError_t PdqSv2NoiseFinish(PdqSv2Noise_t* p_Noise, const uint8_t* p_Act2,
+                             const uint8_t* p_AuthorityKey, uint32_t NowSec,
+                             PdqSv2Cipher_t* p_Send, PdqSv2Cipher_t* p_Recv);
+
+/* Responder: answer act 1 with act 2 for static key p_StaticKey and
+ * its certificate p_Cert */
+PdqError_t PdqSv2NoiseRespond(const uint8_t* p_Act1, const uint8_t* p_StaticKey, const uint8_t* p_Cert,
+                              uint8_t* p_Act2, PdqSv2Cipher_t* p_Send, PdqSv2Cipher_t* p_Recv);
+
+/* Certificate for p_StaticKey's public key signed with p_AuthorityKey */
+PdqError_t PdqSv2NoiseSignCertificate(const uint8_t* p_AuthorityKey, const uint8_t* p_StaticKey,
+                                      uint32_t ValidFrom, uint32_t NotValidAfter, uint8_t* p_Cert);
+
+/* Pool authority public key, either as the base58check string SV2 pools
+ * publish or as 64 hex characters, into a 32-byte x-only key */
+bool     PdqSv2ParseAuthorityKey(const char* p_Str, uint8_t* p_Key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
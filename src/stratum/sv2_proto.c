@@ -0,0 +1,221 @@
+/**
+ * @file sv2_proto.c
+ * @brief Stratum V2 binary framing and field codec implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "sv2_proto.h"
+#include <string.h>
+
+void PdqSv2DecodeHeader(const uint8_t* p_Data, PdqSv2FrameHeader_t* p_Header)
+{
+    p_Header->ExtensionType = (uint16_t)(p_Data[0] | (p_Data[1] << 8));
+    p_Header->MsgType = p_Data[2];
+    p_Header->Length = (uint32_t)p_Data[3] | ((uint32_t)p_Data[4] << 8) | ((uint32_t)p_Data[5] << 16);
+}
+
+void PdqSv2WriterInit(PdqSv2Writer_t* p_W, uint8_t* p_Buffer, uint32_t Size)
+{
+    p_W->p_Data = p_Buffer;
+    p_W->Size = Size;
+    p_W->Len = 0;
+    p_W->FrameStart = 0;
+    p_W->Overflow = false;
+}
+
+static uint8_t* Reserve(PdqSv2Writer_t* p_W, uint32_t Len)
+{
+    if (p_W->Overflow || p_W->Size - p_W->Len < Len) {
+        p_W->Overflow = true;
+        return NULL;
+    }
+    uint8_t* p_Out = p_W->p_Data + p_W->Len;
+    p_W->Len += Len;
+    return p_Out;
+}
+
+void PdqSv2BeginFrame(PdqSv2Writer_t* p_W, bool ChannelMsg, uint8_t MsgType)
+{
+    p_W->FrameStart = p_W->Len;
+    PdqSv2PutU16(p_W, ChannelMsg ? PDQ_SV2_CHANNEL_MSG : 0);
+    PdqSv2PutU8(p_W, MsgType);
+    PdqSv2PutU8(p_W, 0);
+    PdqSv2PutU16(p_W, 0);
+}
+
+void PdqSv2EndFrame(PdqSv2Writer_t* p_W)
+{
+    if (p_W->Overflow) return;
+    uint32_t Length = p_W->Len - p_W->FrameStart - PDQ_SV2_HEADER_SIZE;
+    uint8_t* p_Len = p_W->p_Data + p_W->FrameStart + 3;
+    p_Len[0] = (uint8_t)Length;
+    p_Len[1] = (uint8_t)(Length >> 8);
+    p_Len[2] = (uint8_t)(Length >> 16);
+}
+
+void PdqSv2PutU8(PdqSv2Writer_t* p_W, uint8_t Value)
+{
+    uint8_t* p_Out = Reserve(p_W, 1);
+    if (p_Out) p_Out[0] = Value;
+}
+
+void PdqSv2PutU16(PdqSv2Writer_t* p_W, uint16_t Value)
+{
+    uint8_t* p_Out = Reserve(p_W, 2);
+    if (p_Out == NULL) return;
+    p_Out[0] = (uint8_t)Value;
+    p_Out[1] = (uint8_t)(Value >> 8);
+}
+
+void PdqSv2PutU32(PdqSv2Writer_t* p_W, uint32_t Value)
+{
+    uint8_t* p_Out = Reserve(p_W, 4);
+    if (p_Out == NULL) return;
+    for (int i = 0; i < 4; i++) p_Out[i] = (uint8_t)(Value >> (8 * i));
+}
+
+void PdqSv2PutU64(PdqSv2Writer_t* p_W, uint64_t Value)
+{
+    uint8_t* p_Out = Reserve(p_W, 8);
+    if (p_Out == NULL) return;
+    for (int i = 0; i < 8; i++) p_Out[i] = (uint8_t)(Value >> (8 * i));
+}
+
+void PdqSv2PutF32(PdqSv2Writer_t* p_W, float Value)
+{
+    uint32_t Bits;
+    memcpy(&Bits, &Value, sizeof(Bits));
+    PdqSv2PutU32(p_W, Bits);
+}
+
+void PdqSv2PutBytes(PdqSv2Writer_t* p_W, const uint8_t* p_Data, uint32_t Len)
+{
+    uint8_t* p_Out = Reserve(p_W, Len);
+    if (p_Out && Len) memcpy(p_Out, p_Data, Len);
+}
+
+void PdqSv2PutStr(PdqSv2Writer_t* p_W, const char* p_Str)
+{
+    size_t Len = p_Str ? strlen(p_Str) : 0;
+    if (Len > 255) {
+        p_W->Overflow = true;
+        return;
+    }
+    PdqSv2PutU8(p_W, (uint8_t)Len);
+    PdqSv2PutBytes(p_W, (const uint8_t*)p_Str, (uint32_t)Len);
+}
+
+void PdqSv2PutB032(PdqSv2Writer_t* p_W, const uint8_t* p_Data, uint8_t Len)
+{
+    if (Len > 32) {
+        p_W->Overflow = true;
+        return;
+    }
+    PdqSv2PutU8(p_W, Len);
+    PdqSv2PutBytes(p_W, p_Data, Len);
+}
+
+void PdqSv2PutU256Words(PdqSv2Writer_t* p_W, const uint32_t* p_Words)
+{
+    for (int i = 0; i < 8; i++) PdqSv2PutU32(p_W, p_Words[i]);
+}
+
+void PdqSv2ReaderInit(PdqSv2Reader_t* p_R, const uint8_t* p_Data, uint32_t Len)
+{
+    p_R->p_Data = p_Data;
+    p_R->Len = Len;
+    p_R->Pos = 0;
+    p_R->Error = false;
+}
+
+static const uint8_t* Take(PdqSv2Reader_t* p_R, uint32_t Len)
+{
+    if (p_R->Error || p_R->Len - p_R->Pos < Len) {
+        p_R->Error = true;
+        return NULL;
+    }
+    const uint8_t* p_In = p_R->p_Data + p_R->Pos;
+    p_R->Pos += Len;
+    return p_In;
+}
+
+uint8_t PdqSv2GetU8(PdqSv2Reader_t* p_R)
+{
+    const uint8_t* p_In = Take(p_R, 1);
+    return p_In ? p_In[0] : 0;
+}
+
+uint16_t PdqSv2GetU16(PdqSv2Reader_t* p_R)
+{
+    const uint8_t* p_In = Take(p_R, 2);
+    return p_In ? (uint16_t)(p_In[0] | (p_In[1] << 8)) : 0;
+}
+
+uint32_t PdqSv2GetU32(PdqSv2Reader_t* p_R)
+{
+    const uint8_t* p_In = Take(p_R, 4);
+    if (p_In == NULL) return 0;
+    return (uint32_t)p_In[0] | ((uint32_t)p_In[1] << 8) |
+           ((uint32_t)p_In[2] << 16) | ((uint32_t)p_In[3] << 24);
+}
+
+uint64_t PdqSv2GetU64(PdqSv2Reader_t* p_R)
+{
+    uint64_t Low = PdqSv2GetU32(p_R);
+    uint64_t High = PdqSv2GetU32(p_R);
+    return Low | (High << 32);
+}
+
+float PdqSv2GetF32(PdqSv2Reader_t* p_R)
+{
+    uint32_t Bits = PdqSv2GetU32(p_R);
+    float Value;
+    memcpy(&Value, &Bits, sizeof(Value));
+    return Value;
+}
+
+void PdqSv2GetBytes(PdqSv2Reader_t* p_R, uint8_t* p_Out, uint32_t Len)
+{
+    const uint8_t* p_In = Take(p_R, Len);
+    if (p_In) {
+        memcpy(p_Out, p_In, Len);
+    } else {
+        memset(p_Out, 0, Len);
+    }
+}
+
+void PdqSv2GetStr(PdqSv2Reader_t* p_R, char* p_Out, uint32_t Size)
+{
+    uint8_t Len = PdqSv2GetU8(p_R);
+    const uint8_t* p_In = Take(p_R, Len);
+    if (Size == 0) return;
+    uint32_t Copy = (p_In && Len < Size) ? Len : (p_In ? Size - 1 : 0);
+    if (Copy) memcpy(p_Out, p_In, Copy);
+    p_Out[Copy] = '\0';
+}
+
+uint8_t PdqSv2GetB032(PdqSv2Reader_t* p_R, uint8_t* p_Out)
+{
+    uint8_t Len = PdqSv2GetU8(p_R);
+    if (Len > 32) {
+        p_R->Error = true;
+        return 0;
+    }
+    PdqSv2GetBytes(p_R, p_Out, Len);
+    return p_R->Error ? 0 : Len;
+}
+
+void PdqSv2GetU256Words(PdqSv2Reader_t* p_R, uint32_t* p_Words)
+{
+    for (int i = 0; i < 8; i++) p_Words[i] = PdqSv2GetU32(p_R);
+}
+
+bool PdqSv2GetOptionU32(PdqSv2Reader_t* p_R, uint32_t* p_Value)
+{
+    uint8_t Count = PdqSv2GetU8(p_R);
+    if (Count > 1) p_R->Error = true;
+    if (Count != 1) return false;
+    *p_Value = PdqSv2GetU32(p_R);
+    return !p_R->Error;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file sv2_proto.h
+ * @brief Stratum V2 binary framing and field codec
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Every SV2 message is a 6-byte frame header followed by its payload:
+ * extension_type U16 (bit 15 set for channel messages), msg_type U8 and
+ * msg_length U24, all little-endian. Payload fields use the SV2 data
+ * types (U8..U64, U256, STR0_255, B0_32, OPTION[T]) encoded in place, so
+ * a writer is a cursor over a caller buffer and a reader a cursor over
+ * a received frame. Neither allocates; errors are sticky and checked
+ * once at the end.
+ */
+
+#ifndef PDQ_SV2_PROTO_H
+#define PDQ_SV2_PROTO_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_SV2_HEADER_SIZE             6
+#define PDQ_SV2_CHANNEL_MSG             0x8000  /* extension_type bit 15 */
+#define PDQ_SV2_PROTOCOL_MINING         0
+#define PDQ_SV2_VERSION                 2
+#define PDQ_SV2_SETUP_REQUIRES_STANDARD_JOBS 0x00000001
+
+/* Common messages */
+#define PDQ_SV2_MSG_SETUP_CONNECTION            0x00
+#define PDQ_SV2_MSG_SETUP_CONNECTION_SUCCESS    0x01
+#define PDQ_SV2_MSG_SETUP_CONNECTION_ERROR      0x02
+
+/* Mining protocol */
+#define PDQ_SV2_MSG_OPEN_STANDARD_CHANNEL       0x10
+#define PDQ_SV2_MSG_OPEN_STANDARD_CHANNEL_SUCCESS 0x11
+#define PDQ_SV2_MSG_OPEN_CHANNEL_ERROR          0x12
+#define PDQ_SV2_MSG_NEW_MINING_JOB              0x15
+#define PDQ_SV2_MSG_UPDATE_CHANNEL              0x16
+#define PDQ_SV2_MSG_CLOSE_CHANNEL               0x18
+#define PDQ_SV2_MSG_SUBMIT_SHARES_STANDARD      0x1a
+#define PDQ_SV2_MSG_SUBMIT_SHARES_SUCCESS       0x1c
+#define PDQ_SV2_MSG_SUBMIT_SHARES_ERROR         0x1d
+#define PDQ_SV2_MSG_SET_NEW_PREV_HASH           0x20
+#define PDQ_SV2_MSG_SET_TARGET                  0x21
+#define PDQ_SV2_MSG_RECONNECT                   0x25
+
+typedef struct {
+    uint16_t ExtensionType;     /* Channel bit included */
+    uint8_t  MsgType;
+    uint32_t Length;            /* Payload bytes after the header */
+} PdqSv2FrameHeader_t;
+
+typedef struct {
+    uint8_t* p_Data;
+    uint32_t Size;
+    uint32_t Len;
+    uint32_t FrameStart;        /* Header offset of the open frame */
+    bool     Overflow;
+} PdqSv2Writer_t;
+
+typedef struct {
+    const uint8_t* p_Data;
+    uint32_t       Len;
+    uint32_t       Pos;
+    bool           Error;       /* Read past the end or bad length prefix */
+} PdqSv2Reader_t;
+
+/* Decode a frame header from PDQ_SV2_HEADER_SIZE bytes */
+void     PdqSv2DecodeHeader(const uint8_t* p_Data, PdqSv2FrameHeader_t* p_Header);
+
+void     PdqSv2WriterInit(PdqSv2Writer_t* p_W, uint8_t* p_Buffer, uint32_t Size);
+/* Start a frame; EndFrame fills in its length. Frames do not nest. */
+void     PdqSv2BeginFrame(PdqSv2Writer_t* p_W, bool ChannelMsg, uint8_t MsgType);
+void     PdqSv2EndFrame(PdqSv2Writer_t* p_W);
+void     PdqSv2PutU8(PdqSv2Writer_t* p_W, uint8_t Value);
+void     PdqSv2PutU16(PdqSv2Writer_t* p_W, uint16_t Value);
+void     PdqSv2PutU32(PdqSv2Writer_t* p_W, uint32_t Value);
+void     PdqSv2PutU64(PdqSv2Writer_t* p_W, uint64_t Value);
+void     PdqSv2PutF32(PdqSv2Writer_t* p_W, float Value);
+void     PdqSv2PutBytes(PdqSv2Writer_t* p_W, const uint8_t* p_Data, uint32_t Len);
+/* STR0_255 from a C string; longer strings are an overflow */
+void     PdqSv2PutStr(PdqSv2Writer_t* p_W, const char* p_Str);
+/* B0_32 */
+void     PdqSv2PutB032(PdqSv2Writer_t* p_W, const uint8_t* p_Data, uint8_t Len);
+/* U256 from eight little-endian words, word 7 most significant */
+void     PdqSv2PutU256Words(PdqSv2Writer_t* p_W, const uint32_t* p_Words);
+
+void     PdqSv2ReaderInit(PdqSv2Reader_t* p_R, const uint8_t* p_Data, uint32_t Len);
+uint8_t  PdqSv2GetU8(PdqSv2Reader_t* p_R);
+uint16_t PdqSv2GetU16(PdqSv2Reader_t* p_R);
+uint32_t PdqSv2GetU32(PdqSv2Reader_t* p_R);
+uint64_t PdqSv2GetU64(PdqSv2Reader_t* p_R);
+float    PdqSv2GetF32(PdqSv2Reader_t* p_R);
+void     PdqSv2GetBytes(PdqSv2Reader_t* p_R, uint8_t* p_Out, uint32_t Len);
+/* STR0_255 into a NUL-terminated buffer, truncated to fit */
+void     PdqSv2GetStr(PdqSv2Reader_t* p_R, char* p_Out, uint32_t Size);
+/* B0_32; returns the length, copied into p_Out (32 bytes) */
+uint8_t  PdqSv2GetB032(PdqSv2Reader_t* p_R, uint8_t* p_Out);
+void     PdqSv2GetU256Words(PdqSv2Reader_t* p_R, uint32_t* p_Words);
+/* OPTION[U32]: false when absent */
+bool     PdqSv2GetOptionU32(PdqSv2Reader_t* p_R, uint32_t* p_Value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
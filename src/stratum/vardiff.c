@@ -0,0 +1,108 @@
+/**
+ * @file vardiff.c
+ * @brief Client-side share difficulty controller implementation
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ */
+
+#include "vardiff.h"
+#include "stratum_client.h"
+#include <string.h>
+
+/* Hashes per share at difficulty 1 */
+#define HASHES_PER_DIFF1    4294967296.0
+
+static bool Near(double A, double B)
+{
+    if (B <= 0.0) return false;
+    double Ratio = A / B;
+    return Ratio > 1.0 - PDQ_VARDIFF_MIN_STEP && Ratio < 1.0 + PDQ_VARDIFF_MIN_STEP;
+}
+
+static void StartWindow(PdqVardiff_t* p_Vd, uint64_t NowMs, uint64_t TotalHashes, uint32_t TotalShares)
+{
+    p_Vd->Started = true;
+    p_Vd->WindowStartMs = NowMs;
+    p_Vd->WindowHashes = TotalHashes;
+    p_Vd->WindowShares = TotalShares;
+}
+
+void PdqVardiffDefaults(PdqVardiffConfig_t* p_Config, uint32_t TargetMs)
+{
+    if (p_Config == NULL) return;
+    if (TargetMs == 0) TargetMs = PDQ_VARDIFF_TARGET_MS;
+    p_Config->TargetIntervalMs = TargetMs;
+    p_Config->IntervalLowMs = TargetMs / 2;
+    p_Config->IntervalHighMs = TargetMs + TargetMs / 2;
+    p_Config->RetargetMs = PDQ_VARDIFF_RETARGET_MS;
+    p_Config->MinDifficulty = PDQ_STRATUM_MIN_DIFFICULTY;
+    p_Config->MaxDifficulty = PDQ_VARDIFF_MAX_DIFFICULTY;
+}
+
+void PdqVardiffInit(PdqVardiff_t* p_Vd, const PdqVardiffConfig_t* p_Config, double Initial)
+{
+    if (p_Vd == NULL) return;
+    memset(p_Vd, 0, sizeof(*p_Vd));
+    if (p_Config) {
+        p_Vd->Config = *p_Config;
+    } else {
+        PdqVardiffDefaults(&p_Vd->Config, 0);
+    }
+    if (p_Vd->Config.MinDifficulty < PDQ_STRATUM_MIN_DIFFICULTY) {
+        p_Vd->Config.MinDifficulty = PDQ_STRATUM_MIN_DIFFICULTY;
+    }
+    if (p_Vd->Config.MaxDifficulty < p_Vd->Config.MinDifficulty) {
+        p_Vd->Config.MaxDifficulty = p_Vd->Config.MinDifficulty;
+    }
+    p_Vd->Suggested = Initial;
+}
+
+bool PdqVardiffUpdate(PdqVardiff_t* p_Vd, uint64_t NowMs, uint64_t TotalHashes,
+                      uint32_t TotalShares, double PoolDifficulty, double* p_Suggest)
+{
+    if (p_Vd == NULL || p_Suggest == NULL) return false;
+
+    /* First sample, or the miner restarted (or the clock wrapped) and the
+     * counters went back */
+    if (!p_Vd->Started || NowMs < p_Vd->WindowStartMs ||
+        TotalHashes < p_Vd->WindowHashes || TotalShares < p_Vd->WindowShares) {
+        StartWindow(p_Vd, NowMs, TotalHashes, TotalShares);
+        return false;
+    }
+
+    uint64_t ElapsedMs = NowMs - p_Vd->WindowStartMs;
+    if (ElapsedMs == 0 || ElapsedMs < p_Vd->Config.RetargetMs) return false;
+
+    uint64_t Hashes = TotalHashes - p_Vd->WindowHashes;
+    uint32_t Shares = TotalShares - p_Vd->WindowShares;
+    StartWindow(p_Vd, NowMs, TotalHashes, TotalShares);
+    if (Hashes == 0) return false;
+    if (PoolDifficulty < PDQ_STRATUM_MIN_DIFFICULTY) PoolDifficulty = PDQ_STRATUM_MIN_DIFFICULTY;
+
+    /* Expected interval from the hashrate is exact but blind to what the
+     * pool actually credits; once enough shares were found in the window
+     * the observed interval is averaged in. */
+    double HashesPerMs = (double)Hashes / (double)ElapsedMs;
+    double IntervalMs = PoolDifficulty * HASHES_PER_DIFF1 / HashesPerMs;
+    if (Shares >= PDQ_VARDIFF_MIN_SHARES) {
+        IntervalMs = (IntervalMs + (double)ElapsedMs / Shares) / 2.0;
+    }
+
+    if (IntervalMs >= p_Vd->Config.IntervalLowMs && IntervalMs <= p_Vd->Config.IntervalHighMs) {
+        return false;
+    }
+
+    double Ideal = PoolDifficulty * p_Vd->Config.TargetIntervalMs / IntervalMs;
+    if (Ideal < p_Vd->Config.MinDifficulty) Ideal = p_Vd->Config.MinDifficulty;
+    if (Ideal > p_Vd->Config.MaxDifficulty) Ideal = p_Vd->Config.MaxDifficulty;
+
+    /* Already in force, or asked for and the pool has not answered it */
+    if (Near(Ideal, PoolDifficulty)) return false;
+    if (Near(Ideal, p_Vd->Suggested) && PoolDifficulty == p_Vd->SuggestedAtPool) return false;
+
+    p_Vd->Suggested = Ideal;
+    p_Vd->SuggestedAtPool = PoolDifficulty;
+    p_Vd->Retargets++;
+    *p_Suggest = Ideal;
+    return true;
+}
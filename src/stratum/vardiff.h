@@ -0,0 +1,70 @@
+/**
+ * @file vardiff.h
+ * @brief Client-side share difficulty controller
+ * @copyright Copyright (c) 2025 PDQminer Contributors
+ * @license GPL-3.0
+ *
+ * Picks the difficulty to send in mining.suggest_difficulty so the miner
+ * finds about one share per TargetIntervalMs, whatever its hashrate.
+ * Every RetargetMs it measures the hashrate and share rate over the
+ * window and estimates the current share interval; while that stays
+ * inside [IntervalLowMs, IntervalHighMs] nothing is sent. Outside the
+ * band it suggests the difficulty that lands on the target, unless that
+ * is within PDQ_VARDIFF_MIN_STEP of what is already in force, or of the
+ * last suggestion while the pool has not moved since.
+ *
+ * The controller only does arithmetic on cumulative counters the caller
+ * passes in; sending the suggestion is up to the caller.
+ */
+
+#ifndef PDQ_VARDIFF_H
+#define PDQ_VARDIFF_H
+
+#include "pdq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PDQ_VARDIFF_TARGET_MS       20000
+#define PDQ_VARDIFF_RETARGET_MS     30000
+#define PDQ_VARDIFF_MAX_DIFFICULTY  1e12
+#define PDQ_VARDIFF_MIN_SHARES      4       /* Shares in a window before the share rate counts */
+#define PDQ_VARDIFF_MIN_STEP        0.1     /* Ignore changes under 10% */
+
+typedef struct {
+    uint32_t TargetIntervalMs;
+    uint32_t IntervalLowMs;
+    uint32_t IntervalHighMs;
+    uint32_t RetargetMs;
+    double   MinDifficulty;     /* Raised to the pool floor if lower */
+    double   MaxDifficulty;
+} PdqVardiffConfig_t;
+
+typedef struct {
+    PdqVardiffConfig_t Config;
+    double             Suggested;       /* Last difficulty handed out */
+    double             SuggestedAtPool; /* Pool difficulty when it was, 0 if unknown */
+    bool               Started;
+    uint64_t           WindowStartMs;
+    uint64_t           WindowHashes;    /* Counters at the window start */
+    uint32_t           WindowShares;
+    uint32_t           Retargets;
+} PdqVardiff_t;
+
+/* Target interval TargetMs with the band at half and one and a half times
+ * it; TargetMs 0 uses PDQ_VARDIFF_TARGET_MS */
+void PdqVardiffDefaults(PdqVardiffConfig_t* p_Config, uint32_t TargetMs);
+void PdqVardiffInit(PdqVardiff_t* p_Vd, const PdqVardiffConfig_t* p_Config, double Initial);
+
+/* Feed cumulative hash and found-share counts and the difficulty the pool
+ * has in force. Returns true with *p_Suggest set when a new difficulty
+ * should be suggested. */
+bool PdqVardiffUpdate(PdqVardiff_t* p_Vd, uint64_t NowMs, uint64_t TotalHashes,
+                      uint32_t TotalShares, double PoolDifficulty, double* p_Suggest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif